@@ -1,4 +1,16 @@
 #include "crosscore.hpp"
+#include "skin_cpu.hpp"
+#include "occlusion.hpp"
+#include "obj_bvh.hpp"
+#include "shadow_csm.hpp"
+#include "draw_pkt.hpp"
+#include "draw_cmd.hpp"
+#include "draw_stats.hpp"
+#include "vtx_quant.hpp"
+#include "prim_batch.hpp"
+#include "scene.hpp"
+#include "sph_grid.hpp"
+#include "oglsys.hpp"
 
 // ~~~~~~~~~~~~~~~~~
 
@@ -112,3 +124,3142 @@ void test_sleep() {
 	::printf("elapsed %f millis\n", dt / 1e3);
 }
 
+static void bgd_test_job(const sxJobContext* pCtx) {
+	int32_t* pCnt = (int32_t*)pCtx->mpJob->mpData;
+	nxSys::atomic_inc(pCnt);
+}
+
+/* brigades created, run once and destroyed back to back: wait() must not return before the jobs of the first
+   exec are done (a worker's startup signal is not the end of a job), and destroy() must not hang on workers
+   that finish their last exec while being stopped */
+void test_brigade_handshake() {
+	const int nrep = 2000;
+	const int njob = 16;
+	sxJob jobs[njob];
+	sxJobQueue* pQue = nxTask::queue_create(njob);
+	int32_t cnt = 0;
+	for (int i = 0; i < njob; ++i) {
+		jobs[i].mFunc = bgd_test_job;
+		jobs[i].mpData = &cnt;
+		jobs[i].mId = i;
+		jobs[i].mParam = 0;
+	}
+	int nerr = 0;
+	double t0 = nxSys::time_micros();
+	for (int i = 0; i < nrep; ++i) {
+		cxBrigade* pBgd = cxBrigade::create(1 + (i & 3));
+		nxTask::queue_purge(pQue);
+		for (int j = 0; j < njob; ++j) {
+			nxTask::queue_add(pQue, &jobs[j]);
+		}
+		cnt = 0;
+		nxTask::queue_exec(pQue, pBgd);
+		if (cnt != njob) ++nerr;
+		cxBrigade::destroy(pBgd);
+	}
+	double dt = nxSys::time_micros() - t0;
+	nxTask::queue_destroy(pQue);
+	::printf("brigade handshake: %d create/exec/destroy cycles, %.1f us each: %d errors\n", nrep, dt / nrep, nerr);
+}
+
+
+
+// ~~~~~~~~~~~~~~~~~ skinning
+
+static float skin_test_max_err(const float* pA, const float* pB, const int n) {
+	float err = 0.0f;
+	for (int i = 0; i < n; ++i) {
+		err = nxCalc::max(err, ::fabsf(pA[i] - pB[i]));
+	}
+	return err;
+}
+
+/* skinned geometry with the points and skin of a model: weights stored as is, joints mapped to model skin ids */
+static sxGeometryData* skin_test_geo_from_model(const sxModelData* pMdl) {
+	int npnt = pMdl->mPntNum;
+	int jntSize = pMdl->mSknNum <= (1 << 8) ? 1 : 2;
+	size_t headSize = XD_ALIGN(sizeof(sxGeometryData), 0x10);
+	size_t pntOffs = headSize;
+	size_t sknOffs = pntOffs + npnt * sizeof(cxVec);
+	size_t wgtOffs = sknOffs + XD_ALIGN(npnt * (sizeof(uint32_t) + 1), 4);
+	size_t size = wgtOffs + npnt * XD_ALIGN(4 * (sizeof(float) + jntSize), 4);
+	void* pMem = nxCore::mem_alloc(size, "SkinTest:Geo");
+	if (!pMem) return nullptr;
+	::memset(pMem, 0, size);
+	sxGeometryData* pGeo = ::new (pMem) sxGeometryData();
+	pGeo->mKind = sxGeometryData::KIND;
+	pGeo->mFileSize = uint32_t(size);
+	pGeo->mHeadSize = uint32_t(headSize);
+	pGeo->mBBox = pMdl->mBBox;
+	pGeo->mPntNum = npnt;
+	pGeo->mSkinNodeNum = pMdl->mSknNum;
+	pGeo->mMaxSkinWgtNum = 4;
+	pGeo->mPntOffs = uint32_t(pntOffs);
+	pGeo->mSkinOffs = uint32_t(sknOffs);
+	cxVec* pPnts = pGeo->get_pnt_top();
+	uint32_t* pSknTbl = (uint32_t*)XD_INCR_PTR(pGeo, sknOffs);
+	uint8_t* pWgtNum = (uint8_t*)&pSknTbl[npnt];
+	for (int i = 0; i < npnt; ++i) {
+		pPnts[i] = pMdl->get_pnt_pos(i);
+		pSknTbl[i] = uint32_t(wgtOffs + i * XD_ALIGN(4 * (sizeof(float) + jntSize), 4));
+	}
+	for (uint32_t ibat = 0; ibat < pMdl->mBatNum; ++ibat) {
+		const sxModelData::Batch* pBat = pMdl->get_batch_ptr(ibat);
+		const int32_t* pLst = pMdl->get_batch_jnt_list(ibat);
+		if (!pBat || !pLst) continue;
+		for (int i = pBat->mMinIdx; i <= pBat->mMaxIdx; ++i) {
+			sxModelData::PntSkin skn = pMdl->get_pnt_skin(i);
+			float* pWgt = (float*)XD_INCR_PTR(pGeo, pSknTbl[i]);
+			uint8_t* pJnt = (uint8_t*)&pWgt[skn.num];
+			for (int j = 0; j < skn.num; ++j) {
+				int jnt = pLst[skn.idx[j]];
+				pWgt[j] = skn.wgt[j];
+				if (jntSize == 1) {
+					pJnt[j] = uint8_t(jnt);
+				} else {
+					pJnt[j*2] = uint8_t(jnt & 0xFF);
+					pJnt[j*2 + 1] = uint8_t(jnt >> 8);
+				}
+			}
+			pWgtNum[i] = uint8_t(skn.num);
+		}
+	}
+	return pGeo;
+}
+
+void test_skin_cpu() {
+	const int nvtx = 100000;
+	const int njnt = 64;
+	const int nrep = 10;
+	sxRNG rng;
+	nxCore::rng_seed(&rng, 1);
+	SkinCPU::Input in;
+	if (!in.alloc(nvtx, njnt, true)) return;
+	for (int i = 0; i < nvtx; ++i) {
+		cxVec pos(nxCore::rng_f01(&rng) - 0.5f, nxCore::rng_f01(&rng) * 2.0f, nxCore::rng_f01(&rng) - 0.5f);
+		cxVec nrm(nxCore::rng_f01(&rng) - 0.5f, nxCore::rng_f01(&rng) - 0.5f, nxCore::rng_f01(&rng) - 0.5f);
+		pos.to_mem(&in.mpPos[i * 3]);
+		nrm.get_normalized().to_mem(&in.mpNrm[i * 3]);
+		int nwgt = 1 + int(nxCore::rng_next(&rng) % 4);
+		float sum = 0.0f;
+		for (int j = 0; j < nwgt; ++j) {
+			in.mpWgt[i * 4 + j] = 0.1f + nxCore::rng_f01(&rng);
+			in.mpJnt[i * 4 + j] = int32_t(nxCore::rng_next(&rng) % njnt);
+			sum += in.mpWgt[i * 4 + j];
+		}
+		for (int j = 0; j < nwgt; ++j) {
+			in.mpWgt[i * 4 + j] /= sum;
+		}
+	}
+	SkinCPU::Palette pal;
+	cxMtx* pMtx = (cxMtx*)nxCore::mem_alloc(njnt * sizeof(cxMtx), "SkinTest:Mtx");
+	for (int i = 0; i < njnt; ++i) {
+		pMtx[i].set_rot_degrees(cxVec(nxCore::rng_f01(&rng) * 360.0f, nxCore::rng_f01(&rng) * 360.0f, nxCore::rng_f01(&rng) * 360.0f));
+		pMtx[i].set_translation(cxVec(nxCore::rng_f01(&rng), nxCore::rng_f01(&rng), nxCore::rng_f01(&rng)));
+	}
+	pal.set(pMtx, njnt);
+	nxCore::mem_free(pMtx);
+	float* pRefPos = (float*)nxCore::mem_alloc(nvtx * 3 * sizeof(float), "SkinTest:RefPos");
+	float* pRefNrm = (float*)nxCore::mem_alloc(nvtx * 3 * sizeof(float), "SkinTest:RefNrm");
+	float* pPos = (float*)nxCore::mem_alloc(nvtx * 3 * sizeof(float), "SkinTest:Pos");
+	float* pNrm = (float*)nxCore::mem_alloc(nvtx * 3 * sizeof(float), "SkinTest:Nrm");
+	cxBrigade* pBgd = cxBrigade::create(4);
+	SkinCPU::Work wk;
+	wk.init(256);
+	static const char* pModeNames[] = { "linear", "dual quat" };
+	SkinCPU::Mode modes[] = { SkinCPU::Mode::LINEAR, SkinCPU::Mode::DUAL_QUAT };
+	for (int imode = 0; imode < 2; ++imode) {
+		SkinCPU::Mode mode = modes[imode];
+		double t0 = nxSys::time_micros();
+		for (int i = 0; i < nrep; ++i) {
+			SkinCPU::exec_range_ref(in, pal, mode, pRefPos, pRefNrm, 0, nvtx);
+		}
+		double tref = (nxSys::time_micros() - t0) / nrep;
+		t0 = nxSys::time_micros();
+		for (int i = 0; i < nrep; ++i) {
+			wk.exec(in, pal, mode, pPos, pNrm);
+		}
+		double t1 = (nxSys::time_micros() - t0) / nrep;
+		float posErr = skin_test_max_err(pPos, pRefPos, nvtx * 3);
+		float nrmErr = skin_test_max_err(pNrm, pRefNrm, nvtx * 3);
+		t0 = nxSys::time_micros();
+		for (int i = 0; i < nrep; ++i) {
+			wk.exec(in, pal, mode, pPos, pNrm, pBgd);
+		}
+		double tmt = (nxSys::time_micros() - t0) / nrep;
+		posErr = nxCalc::max(posErr, skin_test_max_err(pPos, pRefPos, nvtx * 3));
+		nrmErr = nxCalc::max(nrmErr, skin_test_max_err(pNrm, pRefNrm, nvtx * 3));
+		::printf("skin %s: pos err %g, nrm err %g\n", pModeNames[imode], posErr, nrmErr);
+		::printf("  ref %.2f Mvtx/s, %s kernel %.2f Mvtx/s, brigade x%d %.2f Mvtx/s\n",
+		         double(nvtx) / tref, SkinCPU::avx_enabled() ? "AVX" : "scalar", double(nvtx) / t1, pBgd ? pBgd->get_workers_num() : 0, double(nvtx) / tmt);
+	}
+
+	/* sample model: the inputs from the model and from a geometry with the same skin must match,
+	   the rest pose (identity palette) gives back the model points and a rigid pose moves them as one */
+	sxModelData* pMdl = nxData::load_as<sxModelData>("../data/Lin/Lin.xmdl");
+	if (pMdl && pMdl->has_skin()) {
+		int nerr = 0;
+		int ndiff = 0;
+		SkinCPU::Input mdlIn;
+		SkinCPU::Input geoIn;
+		if (!mdlIn.from_model(pMdl) || mdlIn.mVtxNum != int(pMdl->mPntNum) || mdlIn.mJntNum != int(pMdl->mSknNum)) ++nerr;
+		sxGeometryData* pGeo = skin_test_geo_from_model(pMdl);
+		if (!geoIn.from_geometry(pGeo) || geoIn.mVtxNum != mdlIn.mVtxNum || geoIn.mJntNum != mdlIn.mJntNum) ++nerr;
+		int nmdl = mdlIn.mVtxNum;
+		if (nerr == 0) {
+			if (::memcmp(mdlIn.mpPos, geoIn.mpPos, nmdl * 3 * sizeof(float)) != 0) ++ndiff;
+			for (int i = 0; i < nmdl * 4; ++i) {
+				if (mdlIn.mpWgt[i] != geoIn.mpWgt[i] || mdlIn.mpJnt[i] != geoIn.mpJnt[i]) ++ndiff;
+			}
+			for (int i = 0; i < nmdl; ++i) {
+				float sum = 0.0f;
+				for (int j = 0; j < 4; ++j) {
+					sum += mdlIn.mpWgt[i*4 + j];
+					if (!mdlIn.mpNrm || uint32_t(mdlIn.mpJnt[i*4 + j]) >= pMdl->mSknNum) ++nerr;
+				}
+				if (::fabsf(sum - 1.0f) > 1e-5f) ++nerr;
+			}
+		}
+		float ext = pMdl->mBBox.get_size_vec().max_abs_elem();
+		float restErr = 0.0f;
+		float rigidErr = 0.0f;
+		float nrmErr = 0.0f;
+		if (nerr == 0 && nmdl <= nvtx) {
+			cxMtx* pPoseMtx = (cxMtx*)nxCore::mem_alloc(pMdl->mSknNum * sizeof(cxMtx), "SkinTest:Mtx");
+			cxMtx wm;
+			wm.set_rot_degrees(cxVec(10.0f, 70.0f, -20.0f));
+			wm.set_translation(cxVec(1.0f, -2.0f, 3.0f));
+			for (int ipose = 0; ipose < 2; ++ipose) {
+				for (uint32_t i = 0; i < pMdl->mSknNum; ++i) {
+					pPoseMtx[i] = ipose ? wm : nxMtx::identity();
+				}
+				SkinCPU::Palette mdlPal;
+				mdlPal.set(pPoseMtx, pMdl->mSknNum);
+				for (int imode = 0; imode < 2; ++imode) {
+					wk.exec(mdlIn, mdlPal, modes[imode], pPos, pNrm, pBgd);
+					SkinCPU::exec_range_ref(geoIn, mdlPal, modes[imode], pRefPos, pRefNrm, 0, nmdl);
+					if (::memcmp(pPos, pRefPos, nmdl * 3 * sizeof(float)) != 0 && skin_test_max_err(pPos, pRefPos, nmdl * 3) > ext * 1e-5f) ++nerr;
+					for (int i = 0; i < nmdl; ++i) {
+						cxVec pos = ipose ? wm.calc_pnt(pMdl->get_pnt_pos(i)) : pMdl->get_pnt_pos(i);
+						cxVec nrm = ipose ? wm.calc_vec(pMdl->get_pnt_nrm(i)) : pMdl->get_pnt_nrm(i);
+						float perr = nxVec::dist(pos, cxVec(pPos[i*3], pPos[i*3 + 1], pPos[i*3 + 2]));
+						if (ipose) {
+							rigidErr = nxCalc::max(rigidErr, perr);
+						} else {
+							restErr = nxCalc::max(restErr, perr);
+						}
+						nrmErr = nxCalc::max(nrmErr, nxVec::dist(nrm.get_normalized(), cxVec(pNrm[i*3], pNrm[i*3 + 1], pNrm[i*3 + 2])));
+					}
+				}
+			}
+			nxCore::mem_free(pPoseMtx);
+			if (restErr > ext * 1e-5f || rigidErr > ext * 1e-5f || nrmErr > 1e-4f) ++nerr;
+		}
+		nerr += ndiff;
+		::printf("skin %s: %d vtx, %d joints, model/geometry input diffs %d, rest err %g, rigid err %g, nrm err %g, %d errors\n",
+		         pMdl->get_name(), nmdl, int(pMdl->mSknNum), ndiff, restErr, rigidErr, nrmErr, nerr);
+		nxCore::mem_free(pGeo);
+	}
+	nxData::unload(pMdl);
+
+	wk.reset();
+	cxBrigade::destroy(pBgd);
+	nxCore::mem_free(pRefPos);
+	nxCore::mem_free(pRefNrm);
+	nxCore::mem_free(pPos);
+	nxCore::mem_free(pNrm);
+}
+
+
+// ~~~~~~~~~~~~~~~~~ model clusters
+
+/* unit UV sphere, CW seen from outside: (nlat + 1) * nlon points, nlat * nlon * 2 triangles */
+static void test_sphere_mesh(cxVec* pPnts, uint32_t* pIdx, const int nlat, const int nlon) {
+	for (int i = 0; i <= nlat; ++i) {
+		float t = XD_PI * float(i) / float(nlat);
+		for (int j = 0; j < nlon; ++j) {
+			float p = XD_PI * 2.0f * float(j) / float(nlon);
+			pPnts[i*nlon + j].set(::sinf(t) * ::cosf(p), ::cosf(t), ::sinf(t) * ::sinf(p));
+		}
+	}
+	int itri = 0;
+	for (int i = 0; i < nlat; ++i) {
+		for (int j = 0; j < nlon; ++j) {
+			uint32_t a = i*nlon + j;
+			uint32_t b = i*nlon + (j + 1) % nlon;
+			uint32_t c = (i + 1)*nlon + j;
+			uint32_t d = (i + 1)*nlon + (j + 1) % nlon;
+			uint32_t tri[6] = { a, b, c, b, d, c };
+			::memcpy(&pIdx[itri * 3], tri, sizeof(tri));
+			itri += 2;
+		}
+	}
+}
+
+static int cls_tri_cmp(const void* pA, const void* pB) {
+	const uint32_t* pTriA = (const uint32_t*)pA;
+	const uint32_t* pTriB = (const uint32_t*)pB;
+	for (int i = 0; i < 3; ++i) {
+		if (pTriA[i] != pTriB[i]) return pTriA[i] < pTriB[i] ? -1 : 1;
+	}
+	return 0;
+}
+
+/* every source triangle exactly once, contiguous clusters within limits, bounds and cones conservative */
+static int cls_test_ck(const sxModelData::Cluster* pCls, const int ncls, const uint32_t* pSrcIdx, const uint32_t* pIdx, const int ntri, const cxVec* pPnts, const int maxVtx, const int maxTri, const cxVec& viewPos) {
+	int nerr = 0;
+	int org = 0;
+	int nbackface = 0;
+	for (int i = 0; i < ncls; ++i) {
+		const sxModelData::Cluster& cls = pCls[i];
+		if (cls.mTriOrg != org || cls.mTriNum < 1 || cls.mTriNum > maxTri || cls.mVtxNum > maxVtx) ++nerr;
+		cxVec c(cls.mCenter.x, cls.mCenter.y, cls.mCenter.z);
+		cxVec axis(cls.mConeAxis.x, cls.mConeAxis.y, cls.mConeAxis.z);
+		bool backface = cls.is_backfacing(viewPos);
+		if (backface) ++nbackface;
+		for (int j = cls.mTriOrg; j < cls.mTriOrg + cls.mTriNum && j < ntri; ++j) {
+			cxVec v[3];
+			for (int k = 0; k < 3; ++k) {
+				v[k] = pPnts[pIdx[j*3 + k]];
+				if (nxVec::dist(v[k], c) > cls.mRadius * 1.0001f + 1e-5f) ++nerr;
+			}
+			cxVec n = nxGeom::tri_normal_cw(v[0], v[1], v[2]);
+			if (n.mag2() == 0.0f) continue; /* degenerate */
+			if (cls.has_cone() && n.dot(axis) < cls.mConeCos - 1e-5f) ++nerr;
+			if (backface && n.dot(viewPos - v[0]) > 1e-5f) ++nerr;
+		}
+		org += cls.mTriNum;
+	}
+	if (org != ntri) ++nerr;
+	size_t idxSize = ntri * 3 * sizeof(uint32_t);
+	uint32_t* pSrcSorted = (uint32_t*)nxCore::mem_alloc(idxSize, "ClsTest:Src");
+	uint32_t* pSorted = (uint32_t*)nxCore::mem_alloc(idxSize, "ClsTest:Dst");
+	::memcpy(pSrcSorted, pSrcIdx, idxSize);
+	::memcpy(pSorted, pIdx, idxSize);
+	::qsort(pSrcSorted, ntri, sizeof(uint32_t) * 3, cls_tri_cmp);
+	::qsort(pSorted, ntri, sizeof(uint32_t) * 3, cls_tri_cmp);
+	if (::memcmp(pSrcSorted, pSorted, idxSize) != 0) ++nerr;
+	nxCore::mem_free(pSrcSorted);
+	nxCore::mem_free(pSorted);
+	::printf("  %d tris -> %d clusters (%.1f tris/cluster), %d back-facing from view, %d errors\n",
+	         ntri, ncls, double(ntri) / double(ncls ? ncls : 1), nbackface, nerr);
+	return nerr;
+}
+
+void test_mdl_clusters() {
+	const int nlat = 96;
+	const int nlon = 192;
+	const int maxVtx = 64;
+	const int maxTri = 124;
+	int npnt = (nlat + 1) * nlon;
+	int ntri = nlat * nlon * 2;
+	cxVec* pPnts = (cxVec*)nxCore::mem_alloc(npnt * sizeof(cxVec), "ClsTest:Pnts");
+	uint32_t* pSrcIdx = (uint32_t*)nxCore::mem_alloc(ntri * 3 * sizeof(uint32_t), "ClsTest:SrcIdx");
+	uint32_t* pIdx = (uint32_t*)nxCore::mem_alloc(ntri * 3 * sizeof(uint32_t), "ClsTest:Idx");
+	sxModelData::Cluster* pCls = (sxModelData::Cluster*)nxCore::mem_alloc(ntri * sizeof(sxModelData::Cluster), "ClsTest:Cls");
+	/* triangles in random order */
+	test_sphere_mesh(pPnts, pSrcIdx, nlat, nlon);
+	sxRNG rng;
+	nxCore::rng_seed(&rng, 7);
+	for (int i = ntri - 1; i > 0; --i) {
+		int k = int(nxCore::rng_next(&rng) % uint32_t(i + 1));
+		for (int j = 0; j < 3; ++j) {
+			uint32_t tmp = pSrcIdx[i*3 + j];
+			pSrcIdx[i*3 + j] = pSrcIdx[k*3 + j];
+			pSrcIdx[k*3 + j] = tmp;
+		}
+	}
+	::memcpy(pIdx, pSrcIdx, ntri * 3 * sizeof(uint32_t));
+	cxVec viewPos(0.0f, 0.5f, 4.0f);
+	double t0 = nxSys::time_micros();
+	int ncls = nxCluster::build(pCls, pIdx, ntri, pPnts, npnt, maxVtx, maxTri);
+	double dt = nxSys::time_micros() - t0;
+	::printf("clusters sphere: %.2f ms\n", dt / 1e3);
+	cls_test_ck(pCls, ncls, pSrcIdx, pIdx, ntri, pPnts, maxVtx, maxTri, viewPos);
+	nxCore::mem_free(pPnts);
+	nxCore::mem_free(pSrcIdx);
+	nxCore::mem_free(pIdx);
+	nxCore::mem_free(pCls);
+
+	sxModelData* pMdl = nxData::load_as<sxModelData>("../data/Lin/Lin.xmdl");
+	if (!pMdl) return;
+	sxModelData* pClsMdl = nxCluster::build_model(pMdl, maxVtx, maxTri);
+	if (pClsMdl) {
+		::printf("clusters %s: %d batches\n", pMdl->get_name(), pMdl->mBatNum);
+		for (uint32_t ibat = 0; ibat < pMdl->mBatNum; ++ibat) {
+			const sxModelData::Batch* pBat = pMdl->get_batch_ptr(ibat);
+			int nbtri = pBat->mTriNum;
+			int nbpnt = pBat->mMaxIdx - pBat->mMinIdx + 1;
+			pPnts = (cxVec*)nxCore::mem_alloc(nbpnt * sizeof(cxVec), "ClsTest:Pnts");
+			pSrcIdx = (uint32_t*)nxCore::mem_alloc(nbtri * 3 * sizeof(uint32_t), "ClsTest:SrcIdx");
+			pIdx = (uint32_t*)nxCore::mem_alloc(nbtri * 3 * sizeof(uint32_t), "ClsTest:Idx");
+			for (int i = 0; i < nbpnt; ++i) {
+				pPnts[i] = pMdl->get_pnt_pos(pBat->mMinIdx + i);
+			}
+			for (int i = 0; i < nbtri; ++i) {
+				xt_int3 srcTri = pMdl->get_batch_tri_indices(ibat, i);
+				xt_int3 tri = pClsMdl->get_batch_tri_indices(ibat, i);
+				for (int j = 0; j < 3; ++j) {
+					pSrcIdx[i*3 + j] = uint32_t(srcTri[j] - pBat->mMinIdx);
+					pIdx[i*3 + j] = uint32_t(tri[j] - pBat->mMinIdx);
+				}
+			}
+			cls_test_ck(pClsMdl->get_batch_clusters(ibat), pClsMdl->get_batch_clusters_num(ibat), pSrcIdx, pIdx, nbtri, pPnts, maxVtx, maxTri, viewPos);
+			nxCore::mem_free(pPnts);
+			nxCore::mem_free(pSrcIdx);
+			nxCore::mem_free(pIdx);
+		}
+		nxData::unload(pClsMdl);
+	}
+	nxData::unload(pMdl);
+}
+
+
+// ~~~~~~~~~~~~~~~~~ LOD
+
+/* triangle counts, error order and index validity of a level list */
+static int lod_test_ck(const uint32_t* pDst, const int* pLvlTri, const float* pLvlErr, const int* pTargets, const int nlvl, const int npnt) {
+	int nerr = 0;
+	const uint32_t* pTri = pDst;
+	for (int i = 0; i < nlvl; ++i) {
+		if (pTargets && pLvlTri[i] > pTargets[i]) ++nerr;
+		if (i > 0 && (pLvlErr[i] < pLvlErr[i - 1] || pLvlTri[i] > pLvlTri[i - 1])) ++nerr;
+		for (int j = 0; j < pLvlTri[i]; ++j) {
+			for (int k = 0; k < 3; ++k) {
+				if (pTri[k] >= uint32_t(npnt)) ++nerr;
+			}
+			if (pTri[0] == pTri[1] || pTri[1] == pTri[2] || pTri[2] == pTri[0]) ++nerr;
+			pTri += 3;
+		}
+	}
+	return nerr;
+}
+
+void test_mdl_lod() {
+	const int nlat = 96;
+	const int nlon = 192;
+	const int nlvl = 4;
+	int npnt = (nlat + 1) * nlon;
+	int ntri = nlat * nlon * 2;
+	cxVec* pPnts = (cxVec*)nxCore::mem_alloc(npnt * sizeof(cxVec), "LODTest:Pnts");
+	uint32_t* pIdx = (uint32_t*)nxCore::mem_alloc(ntri * 3 * sizeof(uint32_t), "LODTest:Idx");
+	uint32_t* pDst = (uint32_t*)nxCore::mem_alloc(ntri * 3 * nlvl * sizeof(uint32_t), "LODTest:Dst");
+	float* pAttrs = (float*)nxCore::mem_alloc(npnt * sizeof(float), "LODTest:Attrs");
+	test_sphere_mesh(pPnts, pIdx, nlat, nlon);
+
+	/* triangle-count targets: each level reaches its target, errors grow, chord sag stays near the reported error */
+	int targets[nlvl] = { ntri / 2, ntri / 4, ntri / 8, ntri / 50 };
+	int lvlTri[nlvl];
+	float lvlErr[nlvl];
+	double t0 = nxSys::time_micros();
+	int nout = nxLOD::simplify(pDst, lvlTri, lvlErr, nlvl, targets, FLT_MAX, pIdx, ntri, pPnts, npnt);
+	double dt = nxSys::time_micros() - t0;
+	int nerr = lod_test_ck(pDst, lvlTri, lvlErr, targets, nlvl, npnt);
+	int nsum = 0;
+	for (int i = 0; i < nlvl; ++i) {
+		nsum += lvlTri[i];
+	}
+	if (nout != nsum) ++nerr;
+	::printf("LOD sphere: %d tris, %.2f ms, %d errors\n", ntri, dt / 1e3, nerr);
+	const uint32_t* pTri = pDst;
+	for (int i = 0; i < nlvl; ++i) {
+		float sag = 0.0f;
+		for (int j = 0; j < lvlTri[i]; ++j) {
+			cxVec c = (pPnts[pTri[0]] + pPnts[pTri[1]] + pPnts[pTri[2]]) / 3.0f;
+			sag = nxCalc::max(sag, 1.0f - c.mag());
+			pTri += 3;
+		}
+		::printf("  level %d: %d tris (target %d), err %g, max sag %g\n", i, lvlTri[i], targets[i], lvlErr[i], sag);
+	}
+
+	/* error bound: no collapse beyond maxErr, a looser bound removes more */
+	float errLims[2] = { 1e-3f, 1e-2f };
+	int zero = 0;
+	int limTri[2];
+	for (int i = 0; i < 2; ++i) {
+		nxLOD::simplify(pDst, &limTri[i], &lvlErr[0], 1, &zero, errLims[i], pIdx, ntri, pPnts, npnt);
+		nerr = lvlErr[0] > errLims[i] ? 1 : 0;
+		nerr += lod_test_ck(pDst, &limTri[i], &lvlErr[0], nullptr, 1, npnt);
+		if (i > 0 && limTri[i] >= limTri[i - 1]) ++nerr;
+		::printf("  max err %g: %d tris, err %g, %d errors\n", errLims[i], limTri[i], lvlErr[0], nerr);
+	}
+
+	/* attributes: a noisy scalar keeps points that geometry alone would remove */
+	sxRNG rng;
+	nxCore::rng_seed(&rng, 3);
+	for (int i = 0; i < npnt; ++i) {
+		pAttrs[i] = nxCore::rng_f01(&rng);
+	}
+	int attrTri = 0;
+	nxLOD::simplify(pDst, &attrTri, &lvlErr[0], 1, &zero, errLims[1], pIdx, ntri, pPnts, npnt, pAttrs, 1);
+	nerr = attrTri > limTri[1] ? 0 : 1;
+	::printf("  with attributes: %d tris, err %g, %d errors\n", attrTri, lvlErr[0], nerr);
+	nxCore::mem_free(pPnts);
+	nxCore::mem_free(pIdx);
+	nxCore::mem_free(pDst);
+	nxCore::mem_free(pAttrs);
+
+	sxModelData* pMdl = nxData::load_as<sxModelData>("../data/Lin/Lin.xmdl");
+	if (!pMdl) return;
+	sxModelData* pLodMdl = nxLOD::build_model(pMdl);
+	if (pLodMdl) {
+		::printf("LOD %s: %d levels\n", pMdl->get_name(), pLodMdl->get_lods_num());
+		for (int ilod = 0; ilod < pLodMdl->get_lods_num(); ++ilod) {
+			nerr = 0;
+			for (uint32_t ibat = 0; ibat < pLodMdl->mBatNum; ++ibat) {
+				const sxModelData::Batch* pBat = pLodMdl->get_batch_ptr(ibat);
+				for (int i = 0; i < pLodMdl->get_lod_batch_tri_num(ilod, ibat); ++i) {
+					xt_int3 tri = pLodMdl->get_lod_batch_tri_indices(ilod, ibat, i);
+					for (int j = 0; j < 3; ++j) {
+						if (tri[j] < pBat->mMinIdx || tri[j] > pBat->mMaxIdx) ++nerr;
+					}
+				}
+			}
+			if (ilod > 0 && pLodMdl->get_lod_tri_num(ilod) >= pLodMdl->get_lod_tri_num(ilod - 1)) ++nerr;
+			::printf("  LOD %d: %d tris, err %g, %d errors\n", ilod, pLodMdl->get_lod_tri_num(ilod), pLodMdl->get_lod_error(ilod), nerr);
+		}
+		nxData::unload(pLodMdl);
+	}
+	nxData::unload(pMdl);
+}
+
+
+// ~~~~~~~~~~~~~~~~~ frustum culling
+
+struct FstTestJobData {
+	const cxFrustum* mpFst;
+	const sxAABB8* mpBlks;
+	uint32_t* mpBits;
+	int mBoxNum;
+	int mJobNum;
+};
+
+/* whole 32-box words per job, so jobs never share a bit word */
+static void fst_test_job(const sxJobContext* pCtx) {
+	FstTestJobData* pData = (FstTestJobData*)pCtx->mpJob->mpData;
+	int nwords = XD_BIT_ARY_SIZE(uint32_t, pData->mBoxNum);
+	int id = pCtx->mpJob->mId;
+	int org = nwords * id / pData->mJobNum;
+	int end = nwords * (id + 1) / pData->mJobNum;
+	if (org >= end) return;
+	int nbox = nxCalc::min(end * 32, pData->mBoxNum) - org * 32;
+	pData->mpFst->cull_boxes(&pData->mpBlks[org * 4], nbox, &pData->mpBits[org]);
+}
+
+void test_frustum_cull() {
+	const int nbox = 100000;
+	const int nrep = 20;
+	const int njob = 16;
+	int nblk = sxAABB8::calc_blocks_num(nbox);
+	int nwords = XD_BIT_ARY_SIZE(uint32_t, nbox);
+	cxAABB* pBoxes = (cxAABB*)nxCore::mem_alloc(nbox * sizeof(cxAABB), "FstTest:Boxes");
+	sxAABB8* pBlks = (sxAABB8*)nxCore::mem_alloc(nblk * sizeof(sxAABB8), "FstTest:Blks");
+	uint32_t* pRefBits = (uint32_t*)nxCore::mem_alloc(nwords * sizeof(uint32_t), "FstTest:RefBits");
+	uint32_t* pBits = (uint32_t*)nxCore::mem_alloc(nwords * sizeof(uint32_t), "FstTest:Bits");
+	/* boxes of all sizes around and across the frustum planes */
+	sxRNG rng;
+	nxCore::rng_seed(&rng, 11);
+	for (int i = 0; i < nbox; ++i) {
+		cxVec c(nxCore::rng_f01(&rng) * 200.0f - 100.0f, nxCore::rng_f01(&rng) * 40.0f - 20.0f, nxCore::rng_f01(&rng) * 200.0f - 100.0f);
+		cxVec r(nxCore::rng_f01(&rng) * 4.0f, nxCore::rng_f01(&rng) * 4.0f, nxCore::rng_f01(&rng) * 4.0f);
+		pBoxes[i].set(c - r, c + r);
+	}
+	cxMtx view;
+	cxMtx invView;
+	view.mk_view(cxVec(3.0f, 2.0f, 10.0f), cxVec(-10.0f, 0.0f, -20.0f), nxVec::get_axis(exAxis::PLUS_Y), &invView);
+	cxFrustum fst;
+	fst.init(invView, XD_DEG2RAD(50.0f), 16.0f / 9.0f, 0.1f, 80.0f);
+
+	double t0 = nxSys::time_micros();
+	for (int k = 0; k < nrep; ++k) {
+		::memset(pRefBits, 0, nwords * sizeof(uint32_t));
+		for (int i = 0; i < nbox; ++i) {
+			if (fst.cull(pBoxes[i])) {
+				XD_BIT_ARY_ST(uint32_t, pRefBits, i);
+			}
+		}
+	}
+	double tref = (nxSys::time_micros() - t0) / nrep;
+	int nculled = 0;
+	for (int i = 0; i < nbox; ++i) {
+		nculled += XD_BIT_ARY_CK(uint32_t, pRefBits, i);
+	}
+
+	t0 = nxSys::time_micros();
+	sxAABB8::pack(pBlks, pBoxes, nbox);
+	double tpack = nxSys::time_micros() - t0;
+	t0 = nxSys::time_micros();
+	for (int k = 0; k < nrep; ++k) {
+		::memset(pBits, 0, nwords * sizeof(uint32_t));
+		fst.cull_boxes(pBlks, nbox, pBits);
+	}
+	double tsimd = (nxSys::time_micros() - t0) / nrep;
+	int nerr = ::memcmp(pBits, pRefBits, nwords * sizeof(uint32_t)) != 0;
+
+	/* odd counts leave the last block partly filled, bits past the end must stay untouched */
+	const int tails[] = { 1, 7, 9, 33, 1001 };
+	for (int i = 0; i < int(XD_ARY_LEN(tails)); ++i) {
+		::memset(pBits, 0, nwords * sizeof(uint32_t));
+		sxAABB8::pack(pBlks, pBoxes, tails[i]);
+		fst.cull_boxes(pBlks, tails[i], pBits);
+		for (int j = 0; j < int(XD_BIT_ARY_SIZE(uint32_t, tails[i]) * 32); ++j) {
+			bool ref = j < tails[i] ? XD_BIT_ARY_CK(uint32_t, pRefBits, j) : false;
+			if (XD_BIT_ARY_CK(uint32_t, pBits, j) != ref) ++nerr;
+		}
+	}
+	sxAABB8::pack(pBlks, pBoxes, nbox);
+
+	cxBrigade* pBgd = cxBrigade::create(4);
+	double tmt = 0.0;
+	if (pBgd) {
+		sxJobQueue* pQue = nxTask::queue_create(njob);
+		sxJob jobs[njob];
+		FstTestJobData data;
+		data.mpFst = &fst;
+		data.mpBlks = pBlks;
+		data.mpBits = pBits;
+		data.mBoxNum = nbox;
+		data.mJobNum = njob;
+		::memset(jobs, 0, sizeof(jobs));
+		for (int i = 0; i < njob; ++i) {
+			jobs[i].mFunc = fst_test_job;
+			jobs[i].mpData = &data;
+			jobs[i].mId = i;
+		}
+		t0 = nxSys::time_micros();
+		for (int k = 0; k < nrep; ++k) {
+			::memset(pBits, 0, nwords * sizeof(uint32_t));
+			nxTask::queue_purge(pQue);
+			for (int i = 0; i < njob; ++i) {
+				nxTask::queue_add(pQue, &jobs[i]);
+			}
+			nxTask::queue_exec(pQue, pBgd);
+		}
+		tmt = (nxSys::time_micros() - t0) / nrep;
+		nerr += ::memcmp(pBits, pRefBits, nwords * sizeof(uint32_t)) != 0;
+		nxTask::queue_destroy(pQue);
+	}
+	::printf("frustum cull: %d boxes, %d culled, %d errors\n", nbox, nculled, nerr);
+	::printf("  scalar %.3f ms, pack %.3f ms, simd %.3f ms, brigade x%d %.3f ms\n",
+	         tref / 1e3, tpack / 1e3, tsimd / 1e3, pBgd ? pBgd->get_workers_num() : 0, tmt / 1e3);
+	cxBrigade::destroy(pBgd);
+
+	/* model work: batch bits match the per-batch scalar test */
+	sxModelData* pMdl = nxData::load_as<sxModelData>("../data/Lin/Lin.xmdl");
+	if (pMdl) {
+		cxModelWork* pWk = cxModelWork::create(pMdl);
+		if (pWk) {
+			nerr = 0;
+			cxMtx wm;
+			for (int k = 0; k < 64; ++k) {
+				wm.set_rot_degrees(cxVec(0.0f, float(k) * 5.625f, 0.0f));
+				wm.set_translation(cxVec(nxCore::rng_f01(&rng) * 40.0f - 20.0f, 0.0f, nxCore::rng_f01(&rng) * 40.0f - 20.0f));
+				if (pWk->mpWorldXform) {
+					*pWk->mpWorldXform = nxMtx::xmtx_from_mtx(wm);
+				} else if (pWk->mpSkinXforms) {
+					for (uint32_t i = 0; i < pMdl->mSknNum; ++i) {
+						pWk->mpSkinXforms[i] = nxMtx::xmtx_from_mtx(wm);
+					}
+				}
+				pWk->update_bounds();
+				pWk->frustum_cull(&fst, false);
+				for (int i = 0; i < pWk->get_batches_num(); ++i) {
+					bool cull = fst.cull(pWk->mpBatBBoxes[i]);
+					if (XD_BIT_ARY_CK(uint32_t, pWk->mpCullBits, i) != cull) ++nerr;
+				}
+			}
+			::printf("frustum cull %s: %d batches, %d errors\n", pMdl->get_name(), pWk->get_batches_num(), nerr);
+			cxModelWork::destroy(pWk);
+		}
+		nxData::unload(pMdl);
+	}
+	nxCore::mem_free(pBoxes);
+	nxCore::mem_free(pBlks);
+	nxCore::mem_free(pRefBits);
+	nxCore::mem_free(pBits);
+}
+
+
+// ~~~~~~~~~~~~~~~~~ occlusion
+
+/* nx * ny quads over the rectangle org + u*[0, 1] + v*[0, 1], points appended to pPnts (shared by position), returns the number of triangles */
+static int occ_test_grid(cxVec* pPnts, int* pNpnt, uint32_t* pIdx, const cxVec& org, const cxVec& u, const cxVec& v, const int nx, const int ny) {
+	int ntri = 0;
+	for (int i = 0; i < ny; ++i) {
+		for (int j = 0; j < nx; ++j) {
+			uint32_t q[4];
+			for (int k = 0; k < 4; ++k) {
+				float fu = float(j + (k & 1)) / float(nx);
+				float fv = float(i + (k >> 1)) / float(ny);
+				cxVec p = org + u*fu + v*fv;
+				int ipnt = 0;
+				while (ipnt < *pNpnt && nxVec::dist(pPnts[ipnt], p) > 1e-4f) {
+					++ipnt;
+				}
+				if (ipnt == *pNpnt) {
+					pPnts[(*pNpnt)++] = p;
+				}
+				q[k] = uint32_t(ipnt);
+			}
+			uint32_t tri[6] = { q[0], q[1], q[2], q[1], q[3], q[2] };
+			::memcpy(&pIdx[ntri * 3], tri, sizeof(tri));
+			ntri += 2;
+		}
+	}
+	return ntri;
+}
+
+static bool occ_test_in_view(const cxMtx& vp, const cxVec& p) {
+	xt_float4 c;
+	cxVec q = vp.calc_pnt(p);
+	c.w = p.x*vp.m[0][3] + p.y*vp.m[1][3] + p.z*vp.m[2][3] + vp.m[3][3];
+	c.x = q.x;
+	c.y = q.y;
+	c.z = q.z;
+	return c.w > 0.0f && c.z >= 0.0f && c.z <= c.w && ::fabsf(c.x) <= c.w && ::fabsf(c.y) <= c.w;
+}
+
+static void occ_test_box_corners(const cxAABB& box, cxVec* pCorners) {
+	cxVec bb[2] = { box.get_min_pos(), box.get_max_pos() };
+	for (int i = 0; i < 8; ++i) {
+		pCorners[i].set(bb[i & 1].x, bb[(i >> 1) & 1].y, bb[(i >> 2) & 1].z);
+	}
+}
+
+static float occ_test_view_w(const cxMtx& vp, const cxVec& p) {
+	return p.x*vp.m[0][3] + p.y*vp.m[1][3] + p.z*vp.m[2][3] + vp.m[3][3];
+}
+
+/* wall rectangle at z = 0: ray from the eye to a corner behind the wall passes through [x0, x1] x [y0, y1], pHit gets the crossing */
+static bool occ_test_wall_blocks(const cxVec& eye, const cxVec& p, const float x0, const float x1, const float y0, const float y1, cxVec* pHit = nullptr) {
+	if (p.z >= 0.0f) return false;
+	float t = eye.z / (eye.z - p.z);
+	cxVec h = eye + (p - eye)*t;
+	if (pHit) {
+		*pHit = h;
+	}
+	return h.x >= x0 && h.x <= x1 && h.y >= y0 && h.y <= y1;
+}
+
+static int occ_test_cmp_jobs(Occlusion::Buffer& occ, const cxAABB* pBoxes, const int nbox, uint32_t* pBits, uint32_t* pRefBits, cxBrigade* pBgd) {
+	int nerr = 0;
+	int nwords = XD_BIT_ARY_SIZE(uint32_t, nbox);
+	occ.test_boxes(pBoxes, nbox, pRefBits);
+	int n = occ.get_width() * occ.get_height();
+	float* pRefDepth = (float*)nxCore::mem_alloc(n * sizeof(float), "OccTest:RefDepth");
+	::memcpy(pRefDepth, occ.get_depth(), n * sizeof(float));
+	occ.rasterize(pBgd);
+	if (::memcmp(pRefDepth, occ.get_depth(), n * sizeof(float)) != 0) ++nerr;
+	occ.test_boxes(pBoxes, nbox, pBits, pBgd);
+	if (::memcmp(pRefBits, pBits, nwords * sizeof(uint32_t)) != 0) ++nerr;
+	nxCore::mem_free(pRefDepth);
+	return nerr;
+}
+
+void test_occlusion() {
+	const int w = 256;
+	const int h = 128;
+	const int nbox = 20000;
+	cxVec* pPnts = (cxVec*)nxCore::mem_alloc(1024 * sizeof(cxVec), "OccTest:Pnts");
+	uint32_t* pIdx = (uint32_t*)nxCore::mem_alloc(1024 * 3 * sizeof(uint32_t), "OccTest:Idx");
+	cxAABB* pBoxes = (cxAABB*)nxCore::mem_alloc(nbox * sizeof(cxAABB), "OccTest:Boxes");
+	uint32_t* pBits = (uint32_t*)nxCore::mem_alloc(XD_BIT_ARY_SIZE(uint32_t, nbox) * sizeof(uint32_t), "OccTest:Bits");
+	uint32_t* pRefBits = (uint32_t*)nxCore::mem_alloc(XD_BIT_ARY_SIZE(uint32_t, nbox) * sizeof(uint32_t), "OccTest:RefBits");
+	cxBrigade* pBgd = cxBrigade::create(4);
+	Occlusion::Buffer occ;
+	occ.init(w, h, 4096, 8);
+	sxRNG rng;
+	nxCore::rng_seed(&rng, 5);
+	cxMtx view;
+	cxMtx proj;
+	proj.mk_proj(XD_DEG2RAD(60.0f), float(w) / float(h), 0.1f, 200.0f);
+	cxVec corners[8];
+
+	/* tessellated wall at z = 0: boxes fully in its shadow are culled, a box with a corner in sight never is */
+	const float wx0 = -8.0f;
+	const float wx1 = 8.0f;
+	const float wy0 = -1.0f;
+	const float wy1 = 5.0f;
+	int npnt = 0;
+	int ntri = occ_test_grid(pPnts, &npnt, pIdx, cxVec(wx0, wy0, 0.0f), cxVec(wx1 - wx0, 0.0f, 0.0f), cxVec(0.0f, wy1 - wy0, 0.0f), 8, 4);
+	cxVec eye(2.0f, 1.5f, 12.0f);
+	view.mk_view(eye, cxVec(-1.0f, 1.0f, 0.0f), nxVec::get_axis(exAxis::PLUS_Y));
+	cxMtx vp = view * proj;
+	occ.begin(vp);
+	occ.add_tris(pPnts, pIdx, ntri);
+	double t0 = nxSys::time_micros();
+	occ.rasterize();
+	double traster = nxSys::time_micros() - t0;
+	for (int i = 0; i < nbox; ++i) {
+		cxVec c(nxCore::rng_f01(&rng) * 40.0f - 20.0f, nxCore::rng_f01(&rng) * 11.0f - 3.0f, nxCore::rng_f01(&rng) * 50.0f - 40.0f);
+		cxVec r(nxCore::rng_f01(&rng) * 1.5f + 0.05f, nxCore::rng_f01(&rng) * 1.5f + 0.05f, nxCore::rng_f01(&rng) * 1.5f + 0.05f);
+		pBoxes[i].set(c - r, c + r);
+	}
+	t0 = nxSys::time_micros();
+	occ.test_boxes(pBoxes, nbox, pBits);
+	double ttest = nxSys::time_micros() - t0;
+	int nvis = 0;
+	int nwrong = 0;
+	int nshadow = 0;
+	int nculled = 0;
+	int ndeep = 0;
+	int nmissed = 0;
+	for (int i = 0; i < nbox; ++i) {
+		bool hidden = XD_BIT_ARY_CK(uint32_t, pBits, i);
+		occ_test_box_corners(pBoxes[i], corners);
+		bool vis = false;
+		bool shadow = true;
+		/* deep: well inside the wall outline and nearer side farther than the wall anywhere over the box */
+		bool deep = true;
+		float boxNear = FLT_MAX;
+		float wallFar = 0.0f;
+		for (int j = 0; j < 8; ++j) {
+			bool blocked = occ_test_wall_blocks(eye, corners[j], wx0, wx1, wy0, wy1);
+			if (!blocked && occ_test_in_view(vp, corners[j])) vis = true;
+			if (!blocked) shadow = false;
+			cxVec hit;
+			if (!occ_test_in_view(vp, corners[j]) || !occ_test_wall_blocks(eye, corners[j], wx0 + 0.5f, wx1 - 0.5f, wy0 + 0.5f, wy1 - 0.5f, &hit)) {
+				deep = false;
+			} else {
+				boxNear = nxCalc::min(boxNear, occ_test_view_w(vp, corners[j]));
+				wallFar = nxCalc::max(wallFar, occ_test_view_w(vp, hit));
+			}
+		}
+		if (deep && boxNear < wallFar + 0.5f) deep = false;
+		if (vis) {
+			++nvis;
+			if (hidden) ++nwrong;
+		}
+		if (shadow) {
+			++nshadow;
+			if (hidden) ++nculled;
+		}
+		if (deep) {
+			++ndeep;
+			if (!hidden) ++nmissed;
+		}
+	}
+	int nerr = nwrong + nmissed;
+	int njoberr = occ_test_cmp_jobs(occ, pBoxes, nbox, pBits, pRefBits, pBgd);
+	::printf("occlusion wall: %d tris, %d boxes, %d visible (%d culled), %d in shadow (%d culled), %d deep (%d missed), %d job mismatches\n",
+	         occ.get_tris_num(), nbox, nvis, nwrong, nshadow, nculled, ndeep, nmissed, njoberr);
+	::printf("  raster %.3f ms, test %.3f ms\n", traster / 1e3, ttest / 1e3);
+	nerr += njoberr;
+
+	/* closed room around the camera: everything outside is culled, nothing inside is */
+	npnt = 0;
+	ntri = 0;
+	const float rs = 5.0f;
+	const int ndiv = 4;
+	ntri += occ_test_grid(pPnts, &npnt, &pIdx[ntri * 3], cxVec(-rs, -rs, -rs), cxVec(rs*2.0f, 0.0f, 0.0f), cxVec(0.0f, rs*2.0f, 0.0f), ndiv, ndiv);
+	ntri += occ_test_grid(pPnts, &npnt, &pIdx[ntri * 3], cxVec(-rs, -rs, rs), cxVec(rs*2.0f, 0.0f, 0.0f), cxVec(0.0f, rs*2.0f, 0.0f), ndiv, ndiv);
+	ntri += occ_test_grid(pPnts, &npnt, &pIdx[ntri * 3], cxVec(-rs, -rs, -rs), cxVec(0.0f, 0.0f, rs*2.0f), cxVec(0.0f, rs*2.0f, 0.0f), ndiv, ndiv);
+	ntri += occ_test_grid(pPnts, &npnt, &pIdx[ntri * 3], cxVec(rs, -rs, -rs), cxVec(0.0f, 0.0f, rs*2.0f), cxVec(0.0f, rs*2.0f, 0.0f), ndiv, ndiv);
+	ntri += occ_test_grid(pPnts, &npnt, &pIdx[ntri * 3], cxVec(-rs, -rs, -rs), cxVec(rs*2.0f, 0.0f, 0.0f), cxVec(0.0f, 0.0f, rs*2.0f), ndiv, ndiv);
+	ntri += occ_test_grid(pPnts, &npnt, &pIdx[ntri * 3], cxVec(-rs, rs, -rs), cxVec(rs*2.0f, 0.0f, 0.0f), cxVec(0.0f, 0.0f, rs*2.0f), ndiv, ndiv);
+	eye.set(0.5f, 0.2f, 1.0f);
+	view.mk_view(eye, cxVec(-2.0f, -1.5f, -3.0f), nxVec::get_axis(exAxis::PLUS_Y));
+	vp = view * proj;
+	occ.begin(vp);
+	occ.add_tris(pPnts, pIdx, ntri);
+	occ.rasterize();
+	int nout = 0;
+	int ninside = 0;
+	for (int i = 0; i < nbox; ++i) {
+		cxVec r(nxCore::rng_f01(&rng) * 1.5f + 0.05f, nxCore::rng_f01(&rng) * 1.5f + 0.05f, nxCore::rng_f01(&rng) * 1.5f + 0.05f);
+		cxVec c;
+		if (i & 1) {
+			c.set(nxCore::rng_f01(&rng) * 8.0f - 4.0f, nxCore::rng_f01(&rng) * 8.0f - 4.0f, nxCore::rng_f01(&rng) * 8.0f - 4.0f);
+			r.scl(1.0f / 3.0f);
+		} else {
+			do {
+				c.set(nxCore::rng_f01(&rng) * 60.0f - 30.0f, nxCore::rng_f01(&rng) * 60.0f - 30.0f, nxCore::rng_f01(&rng) * 60.0f - 30.0f);
+			} while (::fabsf(c.x) < rs + 0.5f + r.x && ::fabsf(c.y) < rs + 0.5f + r.y && ::fabsf(c.z) < rs + 0.5f + r.z);
+		}
+		pBoxes[i].set(c - r, c + r);
+	}
+	occ.test_boxes(pBoxes, nbox, pBits);
+	/* outside boxes must be culled once they are farther than any point of the room */
+	float roomFar = 0.0f;
+	for (int i = 0; i < 8; ++i) {
+		cxVec p((i & 1) ? rs : -rs, (i & 2) ? rs : -rs, (i & 4) ? rs : -rs);
+		roomFar = nxCalc::max(roomFar, occ_test_view_w(vp, p));
+	}
+	nvis = 0;
+	nwrong = 0;
+	ndeep = 0;
+	nmissed = 0;
+	for (int i = 0; i < nbox; ++i) {
+		bool hidden = XD_BIT_ARY_CK(uint32_t, pBits, i);
+		occ_test_box_corners(pBoxes[i], corners);
+		int nin = 0;
+		float boxNear = FLT_MAX;
+		for (int j = 0; j < 8; ++j) {
+			nin += occ_test_in_view(vp, corners[j]) ? 1 : 0;
+			boxNear = nxCalc::min(boxNear, occ_test_view_w(vp, corners[j]));
+		}
+		if (i & 1) {
+			++ninside;
+			if (nin > 0) {
+				++nvis;
+				if (hidden) ++nwrong;
+			}
+		} else {
+			++nout;
+			if (nin == 8 && boxNear > roomFar + 0.5f) {
+				++ndeep;
+				if (!hidden) ++nmissed;
+			}
+		}
+	}
+	njoberr = occ_test_cmp_jobs(occ, pBoxes, nbox, pBits, pRefBits, pBgd);
+	::printf("occlusion room: %d tris, %d inside (%d in view, %d culled), %d outside (%d behind the room, %d missed), %d job mismatches\n",
+	         occ.get_tris_num(), ninside, nvis, nwrong, nout, ndeep, nmissed, njoberr);
+	nerr += nwrong + nmissed + njoberr;
+	::printf("occlusion: %d errors\n", nerr);
+
+	occ.reset();
+	cxBrigade::destroy(pBgd);
+	nxCore::mem_free(pPnts);
+	nxCore::mem_free(pIdx);
+	nxCore::mem_free(pBoxes);
+	nxCore::mem_free(pBits);
+	nxCore::mem_free(pRefBits);
+}
+
+
+// ~~~~~~~~~~~~~~~~~ obj_bvh
+
+struct ObjBVHTestMark {
+	uint8_t* mpFlg;
+	int mCnt;
+
+	void operator()(int id, void* pData) {
+		mpFlg[(intptr_t)pData] = 1;
+		++mCnt;
+	}
+};
+
+static void obj_bvh_test_box(sxRNG* pRng, const float ext, cxAABB* pBox) {
+	cxVec c(nxCore::rng_f01(pRng) - 0.5f, nxCore::rng_f01(pRng) - 0.5f, nxCore::rng_f01(pRng) - 0.5f);
+	c.scl(ext * 2.0f);
+	cxVec r(0.5f + nxCore::rng_f01(pRng) * 1.5f, 0.5f + nxCore::rng_f01(pRng) * 1.5f, 0.5f + nxCore::rng_f01(pRng) * 1.5f);
+	pBox->set(c - r, c + r);
+}
+
+/* number of items where the query marks differ from the brute force predicate */
+template<typename PRED> static int obj_bvh_test_cmp(const uint8_t* pFlg, const cxAABB* pBoxes, const int n, PRED& pred) {
+	int nerr = 0;
+	for (int i = 0; i < n; ++i) {
+		if (!!pFlg[i] != pred(pBoxes[i])) ++nerr;
+	}
+	return nerr;
+}
+
+struct ObjBVHTestPlanesPred {
+	const cxPlane* mpPlanes;
+	int mNum;
+
+	bool operator()(const cxAABB& box) const { return ObjBVH::Tree::box_in_planes(box, mpPlanes, mNum); }
+};
+
+struct ObjBVHTestSphPred {
+	cxSphere mSph;
+
+	bool operator()(const cxAABB& box) const { return ObjBVH::Tree::box_in_sphere_range(box, mSph); }
+};
+
+static const cxAABB* s_pObjBVHTestBoxes = nullptr;
+
+static bool obj_bvh_test_item_box(void* pData, cxAABB* pBox) {
+	*pBox = s_pObjBVHTestBoxes[(intptr_t)pData];
+	return true;
+}
+
+void test_obj_bvh() {
+	static const int s_sizes[] = { 1000, 10000, 100000 };
+	const int nmax = s_sizes[XD_ARY_LEN(s_sizes) - 1];
+	const int nframes = 8;
+	cxAABB* pBoxes = (cxAABB*)nxCore::mem_alloc(nmax * sizeof(cxAABB), "OBVHTest:Boxes");
+	int* pIds = (int*)nxCore::mem_alloc(nmax * sizeof(int), "OBVHTest:Ids");
+	int* pRIds = (int*)nxCore::mem_alloc(nmax * sizeof(int), "OBVHTest:RIds");
+	uint8_t* pFlg = (uint8_t*)nxCore::mem_alloc(nmax, "OBVHTest:Flg");
+	cxBrigade* pBgd = cxBrigade::create(4);
+	s_pObjBVHTestBoxes = pBoxes;
+	sxRNG rng;
+	nxCore::rng_seed(&rng, 7);
+	int nerrTotal = 0;
+	for (int isize = 0; isize < int(XD_ARY_LEN(s_sizes)); ++isize) {
+		int n = s_sizes[isize];
+		float ext = 10.0f * ::cbrtf(float(n));
+		ObjBVH::Tree tree;
+		tree.init(n, 0.5f);
+		for (int i = 0; i < n; ++i) {
+			obj_bvh_test_box(&rng, ext, &pBoxes[i]);
+		}
+		double t0 = nxSys::time_micros();
+		for (int i = 0; i < n; ++i) {
+			pIds[i] = tree.add(pBoxes[i], (void*)(intptr_t)i);
+		}
+		double tbuild = nxSys::time_micros() - t0;
+		int nerr = tree.check();
+		int hbuild = tree.get_height();
+		/* the same items and moves through refit_items() */
+		ObjBVH::Tree rtree;
+		rtree.init(n, 0.5f, pBgd ? pBgd->get_workers_num() * 2 : 0);
+		for (int i = 0; i < n; ++i) {
+			pRIds[i] = rtree.add(pBoxes[i], (void*)(intptr_t)i);
+		}
+
+		/* a quarter of the items wander around, a few leave and come back elsewhere */
+		double tupd = 0.0;
+		double trefit = 0.0;
+		int nreins = 0;
+		int rreins = 0;
+		for (int f = 0; f < nframes; ++f) {
+			for (int i = 0; i < n; ++i) {
+				if ((i & 3) == (f & 3)) {
+					cxVec v(nxCore::rng_f01(&rng) - 0.5f, nxCore::rng_f01(&rng) - 0.5f, nxCore::rng_f01(&rng) - 0.5f);
+					pBoxes[i].set(pBoxes[i].get_min_pos() + v, pBoxes[i].get_max_pos() + v);
+				}
+			}
+			t0 = nxSys::time_micros();
+			for (int i = 0; i < n; ++i) {
+				if ((i & 3) == (f & 3)) {
+					nreins += tree.update(pIds[i], pBoxes[i]) ? 1 : 0;
+				}
+			}
+			tupd += nxSys::time_micros() - t0;
+			t0 = nxSys::time_micros();
+			rreins += rtree.refit_items(obj_bvh_test_item_box, pBgd);
+			trefit += nxSys::time_micros() - t0;
+			for (int i = f; i < n; i += 97) {
+				tree.remove(pIds[i]);
+				rtree.remove(pRIds[i]);
+				obj_bvh_test_box(&rng, ext, &pBoxes[i]);
+				pIds[i] = tree.add(pBoxes[i], (void*)(intptr_t)i);
+				pRIds[i] = rtree.add(pBoxes[i], (void*)(intptr_t)i);
+			}
+			if (f == nframes / 2) {
+				/* refit only: structure kept, boxes follow */
+				for (int i = 0; i < n; i += 5) {
+					cxVec v(nxCore::rng_f01(&rng) * 3.0f, 0.0f, 0.0f);
+					pBoxes[i].set(pBoxes[i].get_min_pos() + v, pBoxes[i].get_max_pos() + v);
+					tree.refit(pIds[i], pBoxes[i]);
+				}
+				rreins += rtree.refit_items(obj_bvh_test_item_box, pBgd);
+			}
+			nerr += tree.check() + rtree.check();
+		}
+
+		/* frustum: same set as the brute force predicate and nothing cxFrustum keeps is dropped */
+		cxMtx view;
+		cxMtx inv;
+		cxVec eye(ext * 0.1f, ext * 0.05f, ext * 0.2f);
+		view.mk_view(eye, cxVec(-ext * 0.3f, 0.0f, -ext * 0.5f), nxVec::get_axis(exAxis::PLUS_Y), &inv);
+		cxFrustum fst;
+		fst.init(inv, XD_DEG2RAD(50.0f), 1.5f, 0.1f, ext);
+		cxPlane pln[ObjBVH::Tree::MAX_CASTER_PLANES];
+		ObjBVH::Tree::calc_frustum_planes(fst, pln);
+		ObjBVHTestMark mark;
+		mark.mpFlg = pFlg;
+		::memset(pFlg, 0, n);
+		mark.mCnt = 0;
+		t0 = nxSys::time_micros();
+		tree.query_frustum(fst, mark);
+		double tqry = nxSys::time_micros() - t0;
+		int nvis = mark.mCnt;
+		ObjBVHTestPlanesPred planesPred;
+		planesPred.mpPlanes = pln;
+		planesPred.mNum = 6;
+		nerr += obj_bvh_test_cmp(pFlg, pBoxes, n, planesPred);
+		t0 = nxSys::time_micros();
+		int nbrute = 0;
+		for (int i = 0; i < n; ++i) {
+			nbrute += fst.cull(pBoxes[i]) ? 0 : 1;
+		}
+		double tbrute = nxSys::time_micros() - t0;
+		int nlost = 0;
+		for (int i = 0; i < n; ++i) {
+			if (!pFlg[i] && !fst.cull(pBoxes[i])) ++nlost;
+		}
+		nerr += nlost;
+		::memset(pFlg, 0, n);
+		t0 = nxSys::time_micros();
+		rtree.query_frustum(fst, mark);
+		double trqry = nxSys::time_micros() - t0;
+		nerr += obj_bvh_test_cmp(pFlg, pBoxes, n, planesPred);
+
+		/* sphere */
+		cxSphere sph(pBoxes[0].get_center(), ext * 0.2f);
+		::memset(pFlg, 0, n);
+		mark.mCnt = 0;
+		tree.query_sphere(sph, mark);
+		int nsph = mark.mCnt;
+		ObjBVHTestSphPred sphPred;
+		sphPred.mSph = sph;
+		nerr += obj_bvh_test_cmp(pFlg, pBoxes, n, sphPred);
+
+		/* casters: brute force match, everything in view is a caster, and the volume holds the frustum swept toward the light */
+		cxVec ldir = nxQuat::from_degrees(70.0f, 140.0f, 0.0f).apply(nxVec::get_axis(exAxis::PLUS_Z));
+		int ncpln = ObjBVH::Tree::calc_caster_planes(fst, ldir, pln);
+		::memset(pFlg, 0, n);
+		mark.mCnt = 0;
+		tree.query_casters(fst, ldir, mark);
+		int ncast = mark.mCnt;
+		planesPred.mNum = ncpln;
+		nerr += obj_bvh_test_cmp(pFlg, pBoxes, n, planesPred);
+		for (int i = 0; i < n; ++i) {
+			if (!pFlg[i] && !fst.cull(pBoxes[i])) ++nerr;
+		}
+		for (int i = 0; i < 1000; ++i) {
+			cxVec p = nxVec::lerp(
+				nxVec::lerp(fst.get_vertex(i & 3), fst.get_vertex((i + 1) & 3), nxCore::rng_f01(&rng)),
+				nxVec::lerp(fst.get_vertex(4 + ((i + 2) & 3)), fst.get_vertex(4 + ((i + 3) & 3)), nxCore::rng_f01(&rng)),
+				nxCore::rng_f01(&rng));
+			p -= ldir * (nxCore::rng_f01(&rng) * ext * 4.0f);
+			if (!ObjBVH::Tree::box_in_planes(cxAABB(p, p), pln, ncpln)) ++nerr;
+		}
+
+		::printf("obj_bvh %d items: height %d (%d after updates), area ratio %.1f, %d reinserted of %d moves, %d errors\n",
+		         n, hbuild, tree.get_height(), tree.get_area_ratio(), nreins, nframes * n / 4, nerr);
+		::printf("  build %.3f ms, update %.3f ms/frame, frustum %d items: tree %.3f ms, brute force %.3f ms (%d), sphere %d, casters %d (%d planes)\n",
+		         tbuild / 1e3, tupd / 1e3 / nframes, nvis, tqry / 1e3, tbrute / 1e3, nbrute, nsph, ncast, ncpln);
+		::printf("  refit_items (%d workers): %.3f ms/frame, %d reinserted, height %d, area ratio %.1f, frustum %.3f ms\n",
+		         pBgd ? pBgd->get_workers_num() : 0, trefit / 1e3 / nframes, rreins, rtree.get_height(), rtree.get_area_ratio(), trqry / 1e3);
+		nerrTotal += nerr;
+
+		for (int i = 0; i < n; ++i) {
+			tree.remove(pIds[i]);
+			rtree.remove(pRIds[i]);
+		}
+		nerrTotal += tree.check() + (tree.get_items_num() != 0 ? 1 : 0);
+		nerrTotal += rtree.check() + (rtree.get_items_num() != 0 ? 1 : 0);
+	}
+
+	/* clip planes of an orthographic shadow-style matrix */
+	{
+		cxMtx view;
+		view.mk_view(cxVec(3.0f, 20.0f, 5.0f), cxVec(0.0f), nxVec::get_axis(exAxis::PLUS_Y));
+		cxMtx proj = nxMtx::identity();
+		proj.m[0][0] = 1.0f / 30.0f;
+		proj.m[1][1] = 1.0f / 30.0f;
+		proj.m[2][2] = 1.0f / (1.0f - 80.0f);
+		proj.m[3][2] = proj.m[2][2];
+		cxMtx vp = view * proj;
+		cxPlane pln[6];
+		int npln = ObjBVH::Tree::calc_clip_planes(vp, pln, 2.0f, false);
+		int nerr = npln == 4 ? 0 : 1;
+		for (int i = 0; i < 10000; ++i) {
+			cxVec p(nxCore::rng_f01(&rng) * 200.0f - 100.0f, nxCore::rng_f01(&rng) * 200.0f - 100.0f, nxCore::rng_f01(&rng) * 200.0f - 100.0f);
+			cxVec c = vp.calc_pnt(p);
+			float lim = nxCalc::max(::fabsf(c.x), ::fabsf(c.y));
+			if (::fabsf(lim - 2.0f) < 1e-3f) continue;
+			if ((lim <= 2.0f) != ObjBVH::Tree::box_in_planes(cxAABB(p, p), pln, npln)) ++nerr;
+		}
+		::printf("obj_bvh clip planes: %d errors\n", nerr);
+		nerrTotal += nerr;
+	}
+	::printf("obj_bvh: %d errors\n", nerrTotal);
+
+	s_pObjBVHTestBoxes = nullptr;
+	cxBrigade::destroy(pBgd);
+	nxCore::mem_free(pBoxes);
+	nxCore::mem_free(pIds);
+	nxCore::mem_free(pRIds);
+	nxCore::mem_free(pFlg);
+}
+
+/* random point of the view slice [dn, df] of cascade i */
+static cxVec csm_test_slice_pnt(sxRNG& rng, const cxMtx& invView, const float tanX, const float tanY, const float dn, const float df) {
+	float d = nxCalc::lerp(dn, df, nxCore::rng_f01(&rng));
+	float u = nxCore::rng_f01(&rng) * 2.0f - 1.0f;
+	float v = nxCore::rng_f01(&rng) * 2.0f - 1.0f;
+	cxVec fwd = invView.get_row_vec(2).neg_val();
+	return invView.get_translation() + fwd*d + invView.get_row_vec(0)*(u*d*tanX) + invView.get_row_vec(1)*(v*d*tanY);
+}
+
+static float csm_test_texel_frac(const ShadowCSM::Cascade& csc, const int mapSize, const cxVec& pos) {
+	cxVec c = csc.mViewProjMtx.calc_pnt(pos);
+	float t = (c.x + 1.0f) * 0.5f * float(mapSize);
+	return t - ::floorf(t);
+}
+
+/* best of nrep culls, in microseconds */
+static double csm_test_time(ShadowCSM::Cascades& csm, const cxAABB* pBoxes, const int nbox, cxBrigade* pBgd, const int nrep = 5) {
+	double tmin = 0.0;
+	for (int i = 0; i < nrep; ++i) {
+		double t0 = nxSys::time_micros();
+		csm.cull(pBoxes, nbox, pBgd);
+		double t = nxSys::time_micros() - t0;
+		tmin = i ? nxCalc::min(tmin, t) : t;
+	}
+	return tmin;
+}
+
+void test_shadow_csm() {
+	const int ncsc = 4;
+	const int mapSize = 1024;
+	const float margin = 30.0f;
+	const int nbox = 100000;
+	sxRNG rng;
+	nxCore::rng_seed(&rng, 13);
+	cxAABB* pBoxes = (cxAABB*)nxCore::mem_alloc(nbox * sizeof(cxAABB), "CSMTest:Boxes");
+	uint8_t* pMasks = (uint8_t*)nxCore::mem_alloc(nbox, "CSMTest:Masks");
+	cxBrigade* pBgd = cxBrigade::create(4);
+	ShadowCSM::Cascades csm;
+	csm.init(ncsc, mapSize, 0.75f, margin, 8);
+	cxMtx proj;
+	proj.mk_proj(XD_DEG2RAD(50.0f), 16.0f / 9.0f, 0.1f, 500.0f);
+	float tanX = nxCalc::rcp0(proj.m[0][0]);
+	float tanY = nxCalc::rcp0(proj.m[1][1]);
+	const float znear = 0.1f;
+	const float zfar = 120.0f;
+	cxVec ldir = cxVec(0.3f, -1.0f, 0.45f).get_normalized();
+	int nerr = 0;
+
+	/* splits: end points, monotonic, uniform and logarithmic extremes */
+	for (int i = 0; i <= ncsc; ++i) {
+		float t = float(i) / float(ncsc);
+		float lin = ShadowCSM::Cascades::calc_split(i, ncsc, znear, zfar, 0.0f);
+		float lg = ShadowCSM::Cascades::calc_split(i, ncsc, znear, zfar, 1.0f);
+		if (::fabsf(lin - nxCalc::lerp(znear, zfar, t)) > 1e-3f) ++nerr;
+		if (::fabsf(lg - znear * ::powf(zfar / znear, t)) > 1e-3f) ++nerr;
+		if (i > 0 && ShadowCSM::Cascades::calc_split(i, ncsc, znear, zfar, 0.75f) <= ShadowCSM::Cascades::calc_split(i - 1, ncsc, znear, zfar, 0.75f)) ++nerr;
+	}
+	::printf("csm splits: %d errors\n", nerr);
+
+	/* coverage: slice points and casters up to the margin toward the light land inside their cascade */
+	cxMtx view;
+	cxMtx invView;
+	view.mk_view(cxVec(3.0f, 4.0f, 10.0f), cxVec(-5.0f, 1.0f, -20.0f), nxVec::get_axis(exAxis::PLUS_Y), &invView);
+	csm.update(invView, tanX, tanY, znear, zfar, ldir);
+	int ncov = 0;
+	for (int i = 0; i < ncsc; ++i) {
+		const ShadowCSM::Cascade* pCsc = csm.get_cascade(i);
+		for (int j = 0; j < 2000; ++j) {
+			cxVec p = csm_test_slice_pnt(rng, invView, tanX, tanY, pCsc->mSplitNear, pCsc->mSplitFar);
+			cxVec q = p - ldir*(nxCore::rng_f01(&rng) * margin * 0.99f);
+			for (int k = 0; k < 2; ++k) {
+				cxVec c = pCsc->mViewProjMtx.calc_pnt(k ? q : p);
+				if (::fabsf(c.x) > 1.0f || ::fabsf(c.y) > 1.0f || c.z < 0.0f || c.z > 1.0f) ++ncov;
+			}
+			float d = (p - invView.get_translation()).dot(invView.get_row_vec(2).neg_val());
+			if (d > pCsc->mSplitNear + 1e-3f && d < pCsc->mSplitFar - 1e-3f && csm.find_cascade(p) != i) ++ncov;
+		}
+	}
+	::printf("csm coverage: %d errors\n", ncov);
+	nerr += ncov;
+
+	/* stability: the size does not change when the camera moves or turns, translation moves the maps by whole texels */
+	{
+		float rad[ncsc];
+		float frac[ncsc];
+		cxVec ref(1.0f, 0.5f, -3.0f);
+		for (int i = 0; i < ncsc; ++i) {
+			rad[i] = csm.get_cascade(i)->mBounds.get_radius();
+			frac[i] = csm_test_texel_frac(*csm.get_cascade(i), mapSize, ref);
+		}
+		int nstab = 0;
+		float maxFrac = 0.0f;
+		for (int f = 0; f < 200; ++f) {
+			cxVec pos(3.0f + nxCore::rng_f01(&rng) * 4.0f, 4.0f + nxCore::rng_f01(&rng), 10.0f - nxCore::rng_f01(&rng) * 4.0f);
+			bool turn = (f & 1) != 0;
+			cxVec tgt = turn ? pos + cxVec(nxCore::rng_f01(&rng) - 0.5f, -0.2f, -1.0f) : pos + cxVec(-8.0f, -3.0f, -30.0f);
+			view.mk_view(pos, tgt, nxVec::get_axis(exAxis::PLUS_Y), &invView);
+			csm.update(invView, tanX, tanY, znear, zfar, ldir);
+			for (int i = 0; i < ncsc; ++i) {
+				const ShadowCSM::Cascade* pCsc = csm.get_cascade(i);
+				if (::fabsf(pCsc->mBounds.get_radius() - rad[i]) > rad[i] * 1e-5f) ++nstab;
+				float d = ::fabsf(csm_test_texel_frac(*pCsc, mapSize, ref) - frac[i]);
+				d = nxCalc::min(d, 1.0f - d);
+				maxFrac = nxCalc::max(maxFrac, d);
+			}
+		}
+		if (maxFrac > 0.02f) ++nstab;
+		::printf("csm stability: max texel phase drift %.4f, %d errors\n", maxFrac, nstab);
+		nerr += nstab;
+	}
+
+	/* culling: masks against brute force, serial and brigade agree, every box holding a caster point is listed */
+	view.mk_view(cxVec(3.0f, 4.0f, 10.0f), cxVec(-5.0f, 1.0f, -20.0f), nxVec::get_axis(exAxis::PLUS_Y), &invView);
+	csm.update(invView, tanX, tanY, znear, zfar, ldir);
+	for (int i = 0; i < nbox; ++i) {
+		cxVec c(nxCore::rng_f01(&rng) * 400.0f - 200.0f, nxCore::rng_f01(&rng) * 30.0f - 5.0f, nxCore::rng_f01(&rng) * 400.0f - 300.0f);
+		cxVec r(0.2f + nxCore::rng_f01(&rng) * 3.0f, 0.2f + nxCore::rng_f01(&rng) * 3.0f, 0.2f + nxCore::rng_f01(&rng) * 3.0f);
+		pBoxes[i] = cxAABB(c - r, c + r);
+	}
+	int ncull = 0;
+	csm.cull(pBoxes, nbox);
+	double tser = csm_test_time(csm, pBoxes, nbox, nullptr);
+	for (int i = 0; i < nbox; ++i) {
+		uint32_t mask = 0;
+		for (int j = 0; j < ncsc; ++j) {
+			if (ShadowCSM::Cascades::box_in_cascade(pBoxes[i], *csm.get_cascade(j))) mask |= 1U << j;
+		}
+		if (csm.get_caster_mask(i) != mask) ++ncull;
+		pMasks[i] = uint8_t(mask);
+	}
+	int nlisted[ncsc];
+	for (int j = 0; j < ncsc; ++j) {
+		nlisted[j] = csm.get_casters_num(j);
+		const int32_t* pList = csm.get_casters(j);
+		for (int k = 0; k < nlisted[j]; ++k) {
+			if (!(pMasks[pList[k]] & (1U << j))) ++ncull;
+			if (k > 0 && pList[k] <= pList[k - 1]) ++ncull;
+		}
+	}
+	for (int i = 0; i < ncsc; ++i) {
+		const ShadowCSM::Cascade* pCsc = csm.get_cascade(i);
+		for (int j = 0; j < 200; ++j) {
+			cxVec p = csm_test_slice_pnt(rng, invView, tanX, tanY, pCsc->mSplitNear, pCsc->mSplitFar);
+			cxVec q = p - ldir*(nxCore::rng_f01(&rng) * margin * 0.99f);
+			for (int k = 0; k < nbox; ++k) {
+				if (pBoxes[k].contains(q) && !(pMasks[k] & (1U << i))) ++ncull;
+			}
+		}
+	}
+	double tmt = csm_test_time(csm, pBoxes, nbox, pBgd);
+	for (int i = 0; i < nbox; ++i) {
+		if (csm.get_caster_mask(i) != pMasks[i]) ++ncull;
+	}
+	for (int j = 0; j < ncsc; ++j) {
+		if (csm.get_casters_num(j) != nlisted[j]) ++ncull;
+	}
+	::printf("csm culling %d boxes: %d/%d/%d/%d casters, serial %.3f ms, brigade %.3f ms, %d errors\n",
+	         nbox, nlisted[0], nlisted[1], nlisted[2], nlisted[3], tser / 1e3, tmt / 1e3, ncull);
+	nerr += ncull;
+
+	/* below MIN_JOB_BOXES per job the brigade call takes the serial path */
+	const int nsmall = ShadowCSM::Cascades::MIN_JOB_BOXES + ShadowCSM::Cascades::MIN_JOB_BOXES / 2;
+	int nsml = 0;
+	double tsmlSer = csm_test_time(csm, pBoxes, nsmall, nullptr);
+	double tsmlMT = csm_test_time(csm, pBoxes, nsmall, pBgd);
+	for (int i = 0; i < nsmall; ++i) {
+		if (csm.get_caster_mask(i) != pMasks[i]) ++nsml;
+	}
+	for (int j = 0; j < ncsc; ++j) {
+		const int32_t* pList = csm.get_casters(j);
+		int cnt = 0;
+		for (int i = 0; i < nsmall; ++i) {
+			if (pMasks[i] & (1U << j)) {
+				if (cnt >= csm.get_casters_num(j) || pList[cnt] != i) ++nsml;
+				++cnt;
+			}
+		}
+		if (cnt != csm.get_casters_num(j)) ++nsml;
+	}
+	::printf("csm culling %d boxes: serial %.3f ms, brigade %.3f ms, %d errors\n", nsmall, tsmlSer / 1e3, tsmlMT / 1e3, nsml);
+	nerr += nsml;
+	::printf("csm: %d errors\n", nerr);
+
+	csm.reset();
+	cxBrigade::destroy(pBgd);
+	nxCore::mem_free(pBoxes);
+	nxCore::mem_free(pMasks);
+}
+
+static int draw_pkt_test_cmp(const void* pA, const void* pB) {
+	const DrawPkt::Packet* pPktA = (const DrawPkt::Packet*)pA;
+	const DrawPkt::Packet* pPktB = (const DrawPkt::Packet*)pB;
+	if (pPktA->mKey < pPktB->mKey) return -1;
+	if (pPktA->mKey > pPktB->mKey) return 1;
+	return pPktA->mParam - pPktB->mParam;
+}
+
+void test_draw_pkt() {
+	const int npkt = 200000;
+	sxRNG rng;
+	nxCore::rng_seed(&rng, 7);
+	int nerr = 0;
+
+	/* keys: passes in order, state first then depth front-to-back for opaque, depth back-to-front first for blended */
+	{
+		using namespace DrawPkt;
+		if (!(make_key(PASS_SHADOW, 0xFF, 0xFFF, 0xFFFF, 1e6f) < make_key(PASS_OPAQ, 0, 0, 0, 0.0f))) ++nerr;
+		if (!(make_key(PASS_OPAQ, 0xFF, 0xFFF, 0xFFFF, 1e6f) < make_key(PASS_SEMI, 0, 0, 0, 1e6f))) ++nerr;
+		if (!(make_key(PASS_SEMI, 0, 0, 0, 0.0f) < make_key(PASS_BLEND, 0xFF, 0xFFF, 0xFFFF, 1e6f))) ++nerr;
+		if (!(make_key(PASS_OPAQ, 1, 0, 0, 100.0f) < make_key(PASS_OPAQ, 2, 0, 0, 1.0f))) ++nerr;
+		if (!(make_key(PASS_OPAQ, 1, 5, 0, 100.0f) < make_key(PASS_OPAQ, 1, 6, 0, 1.0f))) ++nerr;
+		if (!(make_key(PASS_OPAQ, 1, 5, 3, 100.0f) < make_key(PASS_OPAQ, 1, 5, 4, 1.0f))) ++nerr;
+		if (!(make_key(PASS_OPAQ, 1, 5, 3, 1.0f) < make_key(PASS_OPAQ, 1, 5, 3, 1.001f))) ++nerr;
+		if (!(make_key(PASS_SEMI, 0xFF, 0xFFF, 0xFFFF, 10.0f) < make_key(PASS_SEMI, 0, 0, 0, 9.99f))) ++nerr;
+		if (!(make_key(PASS_BLEND, 2, 0, 0, 5.0f) < make_key(PASS_BLEND, 3, 0, 0, 5.0f))) ++nerr;
+		if (get_key_pass(make_key(PASS_BLEND, 0xFF, 0xFFF, 0xFFFF, 0.0f)) != PASS_BLEND) ++nerr;
+		if (depth_code(-1.0f) != 0 || depth_code(0.0f) != 0) ++nerr;
+		float d0 = 0.0f;
+		for (int i = 0; i < 10000; ++i) {
+			float d1 = d0 + nxCore::rng_f01(&rng) * 0.5f + 1e-3f;
+			if (depth_code(d1) < depth_code(d0)) ++nerr;
+			d0 = d1;
+		}
+	}
+	::printf("draw packet keys: %d errors\n", nerr);
+
+	/* sort: serial and brigade results match a stable reference, keys with many ties */
+	DrawPkt::Packet* pRef = (DrawPkt::Packet*)nxCore::mem_alloc(npkt * sizeof(DrawPkt::Packet), "PktTest:Ref");
+	cxBrigade* pBgd = cxBrigade::create(4);
+	DrawPkt::List lst;
+	lst.init(8);
+	for (int pass = 0; pass < 2; ++pass) {
+		DrawPkt::Packet* pPkts = lst.alloc(npkt);
+		for (int i = 0; i < npkt; ++i) {
+			int pktPass = int(nxCore::rng_f01(&rng) * 3.99f);
+			uint32_t sdr = uint32_t(nxCore::rng_f01(&rng) * 8.0f);
+			uint32_t mtl = uint32_t(nxCore::rng_f01(&rng) * 64.0f);
+			uint32_t tex = uint32_t(nxCore::rng_f01(&rng) * 32.0f);
+			float d = float(int(nxCore::rng_f01(&rng) * 200.0f)) * 0.5f;
+			pPkts[i].mKey = DrawPkt::make_key(pktPass, sdr, mtl, tex, d);
+			pPkts[i].mpData = nullptr;
+			pPkts[i].mParam = i;
+			pPkts[i].mReserved = 0;
+		}
+		::memcpy(pRef, pPkts, npkt * sizeof(DrawPkt::Packet));
+		::qsort(pRef, npkt, sizeof(DrawPkt::Packet), draw_pkt_test_cmp);
+		lst.set_num(npkt);
+		double t0 = nxSys::time_micros();
+		lst.sort(pass ? pBgd : nullptr);
+		double t1 = nxSys::time_micros();
+		int nsrt = 0;
+		for (int i = 0; i < npkt; ++i) {
+			const DrawPkt::Packet* pPkt = lst.get_packet(i);
+			if (pPkt->mKey != pRef[i].mKey || pPkt->mParam != pRef[i].mParam) ++nsrt;
+		}
+		if (!lst.ck_sorted()) ++nsrt;
+		for (int p = 0; p < 4; ++p) {
+			int idx = lst.find_pass(p);
+			if (idx > 0 && DrawPkt::get_key_pass(lst.get_packet(idx - 1)->mKey) >= p) ++nsrt;
+			if (idx < npkt && DrawPkt::get_key_pass(lst.get_packet(idx)->mKey) < p) ++nsrt;
+		}
+		::printf("draw packet sort (%s): %d errors, %.2f millis\n", pass ? "brigade" : "serial", nsrt, (t1 - t0) / 1000.0);
+		nerr += nsrt;
+	}
+	::printf("draw packets: %d errors\n", nerr);
+	lst.reset();
+	cxBrigade::destroy(pBgd);
+	nxCore::mem_free(pRef);
+}
+
+struct DrawCmdTestRec {
+	int32_t idx;
+	int32_t bat;
+	int32_t mode;
+	int32_t ninst;
+	float sum; /* stands for the constants a backend would pack */
+};
+
+struct DrawCmdTestLog {
+	int32_t* pOrder;
+	int num;
+	int nerr;
+	int nrec;
+};
+
+static bool draw_cmd_test_record(void* pRec, const DrawCmd::Cmd& cmd, void* pUsr) {
+	int idx = int(intptr_t(cmd.mpObj)) - 1;
+	if ((idx % 7) == 0) return false;
+	DrawCmdTestRec* pTestRec = (DrawCmdTestRec*)pRec;
+	pTestRec->idx = idx;
+	pTestRec->bat = cmd.mBatId;
+	pTestRec->mode = cmd.mMode;
+	pTestRec->ninst = cmd.mInstNum;
+	float sum = 0.0f;
+	for (int i = 0; i < 64; ++i) {
+		sum += float((idx + i) & 0xFF);
+	}
+	pTestRec->sum = sum;
+	return true;
+}
+
+static void draw_cmd_test_replay(const void* pRec, const DrawCmd::Cmd& cmd, const xt_xmtx* pXforms, void* pUsr) {
+	DrawCmdTestLog* pLog = (DrawCmdTestLog*)pUsr;
+	int idx = int(intptr_t(cmd.mpObj)) - 1;
+	pLog->pOrder[pLog->num++] = idx;
+	if (cmd.mpWk != (void*)(intptr_t(idx) * 3) || cmd.mBatId != idx % 13 || cmd.mMode != idx % 3) ++pLog->nerr;
+	if (pRec) {
+		const DrawCmdTestRec* pTestRec = (const DrawCmdTestRec*)pRec;
+		float sum = 0.0f;
+		for (int i = 0; i < 64; ++i) {
+			sum += float((idx + i) & 0xFF);
+		}
+		if (pTestRec->idx != idx || pTestRec->bat != cmd.mBatId || pTestRec->mode != cmd.mMode) ++pLog->nerr;
+		if (pTestRec->ninst != cmd.mInstNum || pTestRec->sum != sum) ++pLog->nerr;
+		++pLog->nrec;
+	} else if ((idx % 7) != 0) {
+		++pLog->nerr;
+	}
+	if ((idx % 5) == 0) {
+		if (!pXforms || cmd.mInstNum != 1 + (idx % 4)) {
+			++pLog->nerr;
+		} else {
+			for (int i = 0; i < cmd.mInstNum; ++i) {
+				if (pXforms[i].m[0][3] != float(idx + i)) ++pLog->nerr;
+			}
+		}
+	} else if (pXforms || cmd.mInstNum != 0) {
+		++pLog->nerr;
+	}
+}
+
+void test_draw_cmd() {
+	const int ncmd = 20000;
+	const int chunk = 777;
+	int nerr = 0;
+	int32_t* pOrder = (int32_t*)nxCore::mem_alloc(ncmd * sizeof(int32_t), "CmdTest:Order");
+	cxBrigade* pBgd = cxBrigade::create(4);
+	for (int pass = 0; pass < 2; ++pass) {
+		DrawCmd::List lst;
+		lst.init(sizeof(DrawCmdTestRec), chunk, pass ? 8 : 0);
+		if (lst.get_rec_size() < sizeof(DrawCmdTestRec) || (lst.get_rec_size() & 0xF) != 0) ++nerr;
+		xt_xmtx xforms[4];
+		for (int i = 0; i < ncmd; ++i) {
+			int ninst = 0;
+			if ((i % 5) == 0) {
+				ninst = 1 + (i % 4);
+				for (int j = 0; j < ninst; ++j) {
+					xforms[j].identity();
+					xforms[j].m[0][3] = float(i + j);
+				}
+			}
+			if (!lst.add((void*)(intptr_t(i) + 1), (void*)(intptr_t(i) * 3), nullptr, i % 13, i % 3, ninst ? xforms : nullptr, ninst)) ++nerr;
+			/* the list keeps its own copy */
+			for (int j = 0; j < ninst; ++j) {
+				xforms[j].m[0][3] = -1.0f;
+			}
+		}
+		if (lst.get_num() != ncmd) ++nerr;
+		DrawCmdTestLog log;
+		log.pOrder = pOrder;
+		log.num = 0;
+		log.nerr = 0;
+		log.nrec = 0;
+		double t0 = nxSys::time_micros();
+		lst.flush(draw_cmd_test_record, draw_cmd_test_replay, &log, pass ? pBgd : nullptr);
+		double t1 = nxSys::time_micros();
+		int ncmp = log.nerr;
+		if (log.num != ncmd) ++ncmp;
+		for (int i = 0; i < log.num; ++i) {
+			if (pOrder[i] != i) ++ncmp;
+		}
+		if (log.nrec != ncmd - (ncmd + 6) / 7) ++ncmp;
+		if (lst.get_num() != 0) ++ncmp;
+		if (pass && lst.get_lists_num() < 2) ++ncmp;
+		::printf("draw cmds (%s, %d lists): %d errors, %.2f millis\n", pass ? "brigade" : "serial", lst.get_lists_num(), ncmp, (t1 - t0) / 1000.0);
+		nerr += ncmp;
+
+		/* replay without recording */
+		lst.add((void*)1, nullptr, nullptr, 0, 0);
+		log.num = 0;
+		lst.flush(nullptr, draw_cmd_test_replay, &log, pass ? pBgd : nullptr);
+		if (log.num != 1) ++nerr;
+		lst.reset();
+	}
+	::printf("draw cmds: %d errors\n", nerr);
+	cxBrigade::destroy(pBgd);
+	nxCore::mem_free(pOrder);
+}
+
+void test_draw_stats() {
+	const int window = 8;
+	const int nframes = 20;
+	int nerr = 0;
+	DrawStats::Counters cnt;
+	cnt.init(window);
+	if (cnt.get_counters_num() != DrawStats::BUILTIN_NUM) ++nerr;
+	if (cnt.find_counter("draw_calls") != DrawStats::DRAW_CALLS || cnt.find_counter("upload_bytes") != DrawStats::UPLOAD_BYTES) ++nerr;
+	int idUsr = cnt.add_counter("user");
+	if (idUsr != DrawStats::BUILTIN_NUM || cnt.add_counter("user") != idUsr) ++nerr;
+	if (cnt.add_counter("a_name_that_does_not_fit_the_table") >= 0 || cnt.add_counter("") >= 0) ++nerr;
+	if (cnt.get_frame_val(DrawStats::DRAW_CALLS) != 0 || cnt.get_avg(DrawStats::DRAW_CALLS) != 0.0) ++nerr;
+
+	/* frame i: i shadow draws, 2i opaque, 3 semi and 1 other; user counter i*i in the opaque pass */
+	for (int i = 0; i < nframes; ++i) {
+		cnt.set_pass(DrawStats::PASS_SHADOW);
+		cnt.add(DrawStats::DRAW_CALLS, i);
+		cnt.set_pass(DrawStats::PASS_OPAQ);
+		cnt.add(DrawStats::DRAW_CALLS, 2 * i);
+		cnt.add(idUsr, i * i);
+		cnt.set_pass(DrawStats::PASS_SEMI);
+		cnt.add(DrawStats::DRAW_CALLS, 3);
+		cnt.set_pass(DrawStats::PASS_OTHER);
+		cnt.add(DrawStats::DRAW_CALLS);
+		cnt.add(-1);
+		cnt.add(DrawStats::Counters::MAX_COUNTERS);
+		if (cnt.get_cur(DrawStats::DRAW_CALLS) != uint64_t(3 * i + 4)) ++nerr;
+		cnt.frame_end();
+		if (cnt.get_cur(DrawStats::DRAW_CALLS) != 0 || cnt.get_pass() != DrawStats::PASS_OTHER) ++nerr;
+	}
+	if (cnt.get_frames_num() != window || cnt.get_frame_cnt() != nframes) ++nerr;
+	int last = nframes - 1;
+	int first = nframes - window;
+	if (cnt.get_frame_val(DrawStats::DRAW_CALLS) != uint64_t(3 * last + 4)) ++nerr;
+	if (cnt.get_frame_val(DrawStats::DRAW_CALLS, DrawStats::PASS_SHADOW, 1) != uint64_t(last - 1)) ++nerr;
+	if (cnt.get_frame_val(DrawStats::DRAW_CALLS, DrawStats::PASS_OPAQ, window - 1) != uint64_t(2 * first)) ++nerr;
+	if (cnt.get_frame_val(DrawStats::DRAW_CALLS, -1, window) != 0) ++nerr;
+	if (cnt.get_min(DrawStats::DRAW_CALLS) != uint64_t(3 * first + 4) || cnt.get_max(DrawStats::DRAW_CALLS) != uint64_t(3 * last + 4)) ++nerr;
+	if (cnt.get_min(DrawStats::DRAW_CALLS, DrawStats::PASS_SEMI) != 3 || cnt.get_max(DrawStats::DRAW_CALLS, DrawStats::PASS_OTHER) != 1) ++nerr;
+	if (::fabs(cnt.get_avg(DrawStats::DRAW_CALLS, DrawStats::PASS_SHADOW) - double(first + last) * 0.5) > 1e-9) ++nerr;
+	if (cnt.get_max(idUsr, DrawStats::PASS_OPAQ) != uint64_t(last * last) || cnt.get_max(idUsr, DrawStats::PASS_SEMI) != 0) ++nerr;
+	::printf("draw stats queries: %d errors\n", nerr);
+
+	/* CSV: header plus one line per frame in the window, oldest first */
+	FILE* pCSV = ::tmpfile();
+	if (pCSV) {
+		cnt.write_csv(pCSV);
+		::rewind(pCSV);
+		char line[4096];
+		int nlines = 0;
+		int ncols = 0;
+		while (::fgets(line, sizeof(line), pCSV)) {
+			int n = 1;
+			for (const char* p = line; *p; ++p) {
+				if (*p == ',') ++n;
+			}
+			if (nlines == 0) {
+				ncols = n;
+				if (::strncmp(line, "frame,draw_calls,draw_calls.other,draw_calls.shadow,", 52) != 0) ++nerr;
+			} else {
+				if (n != ncols) ++nerr;
+				unsigned long long frame = 0;
+				unsigned long long dc = 0;
+				if (::sscanf(line, "%llu,%llu", &frame, &dc) != 2) ++nerr;
+				if (frame != unsigned(first + nlines - 1) || dc != 3 * frame + 4) ++nerr;
+			}
+			++nlines;
+		}
+		if (nlines != window + 1 || ncols != 1 + cnt.get_counters_num() * (1 + DrawStats::PASS_NUM)) ++nerr;
+		::fclose(pCSV);
+	}
+	cnt.clear_frames();
+	if (cnt.get_frames_num() != 0 || cnt.get_max(DrawStats::DRAW_CALLS) != 0) ++nerr;
+	::printf("draw stats: %d errors\n", nerr);
+	cnt.reset();
+}
+
+
+// ~~~~~~~~~~~~~~~~~ vertex quantization
+
+/* decodes every vertex of the encoder, returns the number of streams out of tolerance or with a wrong error report */
+static int vq_test_ck(const VtxQuant::Encoder& enc, const VtxQuant::Input& in, const VtxQuant::Tolerance& tol) {
+	int nerr = 0;
+	for (int i = 0; i < enc.get_streams_num(); ++i) {
+		const VtxQuant::Stream* pStr = enc.get_stream(i);
+		VtxQuant::Error err;
+		err.zero();
+		for (int j = 0; j < pStr->mVtxNum; ++j) {
+			int idx = pStr->mVtxOrg + j;
+			VtxQuant::Vertex vtx;
+			enc.decode(i, j, &vtx);
+			cxVec pos(in.mpPos[idx*3], in.mpPos[idx*3 + 1], in.mpPos[idx*3 + 2]);
+			err.mPos = nxCalc::max(err.mPos, nxVec::dist(pos, vtx.pos));
+			if (in.mpNrm) {
+				cxVec nrm(in.mpNrm[idx*3], in.mpNrm[idx*3 + 1], in.mpNrm[idx*3 + 2]);
+				float d = nxCalc::clamp(nrm.get_normalized().dot(vtx.nrm), -1.0f, 1.0f);
+				err.mNrm = nxCalc::max(err.mNrm, XD_RAD2DEG(::acosf(d)));
+			}
+			if (in.mpTex) {
+				err.mTex = nxCalc::max(err.mTex, ::fabsf(vtx.tex.u - in.mpTex[idx*2]));
+				err.mTex = nxCalc::max(err.mTex, ::fabsf(vtx.tex.v - in.mpTex[idx*2 + 1]));
+			}
+			if (in.mpClr) {
+				for (int k = 0; k < 4; ++k) {
+					err.mClr = nxCalc::max(err.mClr, ::fabsf(vtx.clr.ch[k] - in.mpClr[idx*4 + k]));
+				}
+			}
+			if (in.mpWgt) {
+				float sum = 0.0f;
+				for (int k = 0; k < 4; ++k) {
+					err.mWgt = nxCalc::max(err.mWgt, ::fabsf(vtx.wgt[k] - in.mpWgt[idx*4 + k]));
+					if (vtx.jnt[k] != in.mpJnt[idx*4 + k]) ++nerr;
+					sum += vtx.wgt[k];
+				}
+				if (::fabsf(sum - 1.0f) > 1e-5f) ++nerr;
+			}
+		}
+		const VtxQuant::Error& rep = pStr->mErr;
+		const float eps = 1e-5f;
+		if (::fabsf(err.mPos - rep.mPos) > eps || ::fabsf(err.mNrm - rep.mNrm) > 1e-2f || ::fabsf(err.mTex - rep.mTex) > eps) ++nerr;
+		if (::fabsf(err.mClr - rep.mClr) > eps || ::fabsf(err.mWgt - rep.mWgt) > eps) ++nerr;
+		if (pStr->mFmt.mPos != VtxQuant::POS_F32 && err.mPos > tol.mPos) ++nerr;
+		if (pStr->mFmt.mNrm != VtxQuant::NRM_OCT16 && err.mNrm > tol.mNrm) ++nerr;
+		if (pStr->mFmt.mTex != VtxQuant::TEX_F32 && err.mTex > tol.mTex) ++nerr;
+		if (pStr->mFmt.mClr != VtxQuant::CLR_HALF && err.mClr > tol.mClr) ++nerr;
+		if (pStr->mFmt.mWgt != VtxQuant::WGT_U16 && err.mWgt > tol.mWgt) ++nerr;
+		if (pStr->mFmt.mStride & 3) ++nerr;
+	}
+	return nerr;
+}
+
+void test_vtx_quant() {
+	const int nlat = 24;
+	const int nlon = 48;
+	const int nvtx = (nlat + 1) * nlon;
+	const int njnt = 6;
+	const float radius = 1.5f;
+	int nerr = 0;
+	cxVec* pPnts = (cxVec*)nxCore::mem_alloc(nvtx * sizeof(cxVec), "Test:VQ:Pnts");
+	uint32_t* pIdx = (uint32_t*)nxCore::mem_alloc(nlat * nlon * 6 * sizeof(uint32_t), "Test:VQ:Idx");
+	test_sphere_mesh(pPnts, pIdx, nlat, nlon);
+
+	VtxQuant::Input in;
+	in.alloc(nvtx, true, true, true, true);
+	for (int i = 0; i < nvtx; ++i) {
+		cxVec pos = pPnts[i] * radius;
+		pos.to_mem(&in.mpPos[i*3]);
+		pPnts[i].to_mem(&in.mpNrm[i*3]);
+		in.mpTex[i*2] = float(i % nlon) / float(nlon);
+		in.mpTex[i*2 + 1] = float(i / nlon) / float(nlat);
+		in.mpClr[i*4] = nxCalc::fit(pPnts[i].x, -1.0f, 1.0f, 0.0f, 1.0f);
+		in.mpClr[i*4 + 1] = nxCalc::fit(pPnts[i].y, -1.0f, 1.0f, 0.0f, 1.0f);
+		in.mpClr[i*4 + 2] = 0.25f;
+		in.mpClr[i*4 + 3] = 1.0f;
+		/* two joints blended along the height */
+		float h = nxCalc::fit(pPnts[i].y, -1.0f, 1.0f, 0.0f, float(njnt - 1));
+		int j0 = nxCalc::min(int(h), njnt - 2);
+		float t = h - float(j0);
+		in.mpWgt[i*4] = 1.0f - t;
+		in.mpWgt[i*4 + 1] = t;
+		in.mpWgt[i*4 + 2] = 0.0f;
+		in.mpWgt[i*4 + 3] = 0.0f;
+		in.mpJnt[i*4] = j0;
+		in.mpJnt[i*4 + 1] = j0 + 1;
+		in.mpJnt[i*4 + 2] = 0;
+		in.mpJnt[i*4 + 3] = 0;
+	}
+	/* float source: pos + nrm + tex + clr + 4 weights + 4 joints */
+	const size_t srcVtxSize = (3 + 3 + 2 + 4 + 4) * sizeof(float) + 4 * sizeof(int32_t);
+	VtxQuant::Range ranges[3];
+	ranges[0].mOrg = 0;
+	ranges[0].mNum = nvtx / 2;
+	ranges[1].mOrg = nvtx / 2;
+	ranges[1].mNum = nvtx - nvtx / 2;
+	ranges[2].mOrg = 0;
+	ranges[2].mNum = nvtx;
+
+	VtxQuant::Tolerance tol;
+	tol.set_defaults();
+	VtxQuant::Encoder enc;
+	if (!enc.encode(in, ranges, 3, tol, srcVtxSize)) ++nerr;
+	nerr += vq_test_ck(enc, in, tol);
+	for (int i = 0; i < enc.get_streams_num(); ++i) {
+		const VtxQuant::Stream* pStr = enc.get_stream(i);
+		::printf("vq stream %d: %d vtx, stride %d (src %d), pos %d nrm %d tex %d clr %d wgt %d, err pos %.2e nrm %.3f tex %.2e\n",
+			i, pStr->mVtxNum, pStr->mFmt.mStride, int(srcVtxSize), pStr->mFmt.mPos, pStr->mFmt.mNrm, pStr->mFmt.mTex, pStr->mFmt.mClr, pStr->mFmt.mWgt,
+			pStr->mErr.mPos, pStr->mErr.mNrm, pStr->mErr.mTex);
+		if (pStr->mDataOffs & 0xF) ++nerr;
+	}
+	::printf("vq: %d -> %d bytes (%.1f%%)\n", int(enc.get_src_size()), int(enc.get_data_size()), double(enc.get_data_size()) * 100.0 / double(enc.get_src_size()));
+	if (enc.get_data_size() * 2 > enc.get_src_size()) ++nerr;
+	::printf("vq default tolerance: %d errors\n", nerr);
+
+	/* tighter tolerances must select wider formats, still within tolerance where not the widest */
+	VtxQuant::Tolerance tight = tol;
+	tight.mPos = 1e-5f;
+	tight.mNrm = 0.05f;
+	tight.mTex = 1e-6f;
+	tight.mClr = 1e-4f;
+	tight.mWgt = 1e-4f;
+	VtxQuant::Encoder encTight;
+	encTight.encode(in, ranges, 3, tight, srcVtxSize);
+	nerr += vq_test_ck(encTight, in, tight);
+	for (int i = 0; i < encTight.get_streams_num(); ++i) {
+		const VtxQuant::Format& fmt = encTight.get_stream(i)->mFmt;
+		const VtxQuant::Format& ref = enc.get_stream(i)->mFmt;
+		if (fmt.mPos < ref.mPos || fmt.mNrm < ref.mNrm || fmt.mTex < ref.mTex || fmt.mClr < ref.mClr || fmt.mWgt < ref.mWgt) ++nerr;
+		if (fmt.mStride <= ref.mStride) ++nerr;
+	}
+	if (encTight.get_data_size() <= enc.get_data_size()) ++nerr;
+
+	/* rigid mesh with a constant color: no per-vertex color data */
+	VtxQuant::Input rigid;
+	rigid.alloc(nvtx, true, true, true, false);
+	::memcpy(rigid.mpPos, in.mpPos, nvtx * 3 * sizeof(float));
+	::memcpy(rigid.mpNrm, in.mpNrm, nvtx * 3 * sizeof(float));
+	::memcpy(rigid.mpTex, in.mpTex, nvtx * 2 * sizeof(float));
+	for (int i = 0; i < nvtx * 4; ++i) {
+		rigid.mpClr[i] = 0.5f;
+	}
+	VtxQuant::Encoder encRigid;
+	encRigid.encode(rigid, ranges, 2, tol, (3 + 3 + 2 + 4) * sizeof(float));
+	nerr += vq_test_ck(encRigid, rigid, tol);
+	for (int i = 0; i < encRigid.get_streams_num(); ++i) {
+		const VtxQuant::Format& fmt = encRigid.get_stream(i)->mFmt;
+		if (fmt.mClr != VtxQuant::CLR_CONST || fmt.mWgt != VtxQuant::WGT_NONE) ++nerr;
+	}
+	::printf("vq rigid: %d -> %d bytes\n", int(encRigid.get_src_size()), int(encRigid.get_data_size()));
+
+	/* degenerate ranges */
+	VtxQuant::Range bad[2];
+	bad[0].mOrg = nvtx - 4;
+	bad[0].mNum = 100;
+	bad[1].mOrg = 0;
+	bad[1].mNum = 0;
+	VtxQuant::Encoder encBad;
+	encBad.encode(rigid, bad, 2, tol, 4);
+	if (encBad.get_streams_num() != 2 || encBad.get_stream(0)->mVtxNum != 4 || encBad.get_stream(1)->mVtxNum != 0) ++nerr;
+	VtxQuant::Vertex vtx;
+	if (encBad.decode(1, 0, &vtx) || encBad.decode(0, 4, &vtx) || encBad.decode(2, 0, &vtx)) ++nerr;
+	nerr += vq_test_ck(encBad, rigid, tol);
+
+	/* sample model: one stream per batch over its index range, decoded against the model's own vertices */
+	sxModelData* pMdl = nxData::load_as<sxModelData>("../data/Lin/Lin.xmdl");
+	if (pMdl) {
+		VtxQuant::Input mdlIn;
+		if (!mdlIn.from_model(pMdl) || mdlIn.mVtxNum != int(pMdl->mPntNum)) ++nerr;
+		if (pMdl->has_skin() != (mdlIn.mpWgt != nullptr)) ++nerr;
+		VtxQuant::Encoder encMdl;
+		if (!encMdl.encode(pMdl, tol) || encMdl.get_streams_num() != int(pMdl->mBatNum)) ++nerr;
+		for (int i = 0; i < encMdl.get_streams_num(); ++i) {
+			const sxModelData::Batch* pBat = pMdl->get_batch_ptr(i);
+			const VtxQuant::Stream* pStr = encMdl.get_stream(i);
+			if (pStr->mVtxOrg != pBat->mMinIdx || pStr->mVtxNum != pBat->mMaxIdx - pBat->mMinIdx + 1) ++nerr;
+		}
+		nerr += vq_test_ck(encMdl, mdlIn, tol);
+		VtxQuant::Error err = encMdl.get_max_error();
+		::printf("vq %s: %d batches, %d -> %d bytes (%.1f%% saved), err pos %.2e nrm %.3f tex %.2e clr %.2e wgt %.2e\n",
+		         pMdl->get_name(), pMdl->mBatNum, int(encMdl.get_src_size()), int(encMdl.get_data_size()),
+		         100.0 - double(encMdl.get_data_size()) * 100.0 / double(encMdl.get_src_size() ? encMdl.get_src_size() : 1),
+		         err.mPos, err.mNrm, err.mTex, err.mClr, err.mWgt);
+		if (encMdl.get_data_size() >= encMdl.get_src_size()) ++nerr;
+		nxData::unload(pMdl);
+	}
+
+	::printf("vtx quant: %d errors\n", nerr);
+	nxCore::mem_free(pPnts);
+	nxCore::mem_free(pIdx);
+}
+
+
+// ~~~~~~~~~~~~~~~~~ prim batching
+
+struct PrimBatTestJob {
+	PrimBatch::Buffer* pBuf;
+	int org;
+	int num;
+};
+
+/* prim i: material i % 6 (0 and 3 alike), a sprite every 6th, otherwise a fan of 3 + i % 5 vertices; pos.x is the prim id, pos.y the vertex */
+static PrimBatch::Material prim_bat_test_mtl(const int i) {
+	PrimBatch::Material mtl;
+	int imtl = i % 6;
+	mtl.set((sxTextureData*)(intptr_t(0x100) * (imtl % 3 + 1)), imtl == 5 ? PrimBatch::TYPE_SPRITE : PrimBatch::TYPE_POLY, false, imtl != 1);
+	return mtl;
+}
+
+static void prim_bat_test_add(PrimBatch::Buffer* pBuf, const int i) {
+	PrimBatch::Material mtl = prim_bat_test_mtl(i);
+	if (mtl.mType == PrimBatch::TYPE_SPRITE) {
+		pBuf->add_sprite(mtl, cxVec(float(i), 0.0f, 0.0f), 1.0f, 0.0f, cxColor(1.0f));
+		return;
+	}
+	sxPrimVtx vtx[8];
+	uint16_t idx[18];
+	int nvtx = 3 + i % 5;
+	for (int j = 0; j < nvtx; ++j) {
+		vtx[j].pos.set(float(i), float(j), 0.0f, 1.0f);
+		vtx[j].clr.fill(1.0f);
+		vtx[j].tex.fill(0.0f);
+		vtx[j].prm.fill(0.0f);
+	}
+	int nidx = 0;
+	for (int j = 1; j < nvtx - 1; ++j) {
+		idx[nidx++] = 0;
+		idx[nidx++] = uint16_t(j);
+		idx[nidx++] = uint16_t(j + 1);
+	}
+	pBuf->add(mtl, vtx, nvtx, idx, nidx);
+}
+
+static void prim_bat_test_job(const sxJobContext* pCtx) {
+	PrimBatTestJob* pJob = (PrimBatTestJob*)pCtx->mpJob->mpData;
+	for (int i = pJob->org; i < pJob->org + pJob->num; ++i) {
+		prim_bat_test_add(pJob->pBuf, i);
+	}
+}
+
+/* every accepted prim exactly once, in a batch of its material, with contiguous indices pointing at its own vertices */
+static int prim_bat_test_ck(const PrimBatch::Buffer& buf, const int nprims, const int baseVtx, int* pCnt) {
+	int nerr = 0;
+	::memset(pCnt, 0, nprims * sizeof(int));
+	const uint16_t* pIdx = buf.get_draw_idx_data();
+	const sxPrimVtx* pVtx = buf.get_vtx_data();
+	int idxEnd = 0;
+	for (int i = 0; i < buf.get_batches_num(); ++i) {
+		const PrimBatch::Batch* pBat = buf.get_batch(i);
+		if (pBat->mIdxOrg != idxEnd || pBat->mIdxNum % 3) ++nerr;
+		idxEnd = pBat->mIdxOrg + pBat->mIdxNum;
+		for (int j = 0; j < i; ++j) {
+			if (buf.get_batch(j)->mMtl.same(pBat->mMtl)) ++nerr;
+		}
+		int prev = -1;
+		int nprm = 0;
+		for (int j = pBat->mIdxOrg; j < idxEnd; ++j) {
+			int ivtx = int(pIdx[j]) - baseVtx;
+			if (ivtx < 0 || ivtx >= buf.get_vtx_num()) {
+				++nerr;
+				continue;
+			}
+			int id = int(pVtx[ivtx].pos.x);
+			if (id < 0 || id >= nprims || !prim_bat_test_mtl(id).same(pBat->mMtl)) {
+				++nerr;
+				continue;
+			}
+			if (id != prev) {
+				if (pCnt[id]) ++nerr;
+				prev = id;
+				++nprm;
+			}
+			++pCnt[id];
+		}
+		if (nprm != pBat->mPrimsNum) ++nerr;
+	}
+	if (idxEnd != buf.get_draw_idx_num()) ++nerr;
+	for (int i = 0; i < nprims; ++i) {
+		if (!pCnt[i]) continue;
+		PrimBatch::Material mtl = prim_bat_test_mtl(i);
+		int nidx = mtl.mType == PrimBatch::TYPE_SPRITE ? 6 : (1 + i % 5) * 3;
+		if (pCnt[i] != nidx) ++nerr;
+	}
+	return nerr;
+}
+
+void test_prim_batch() {
+	const int nprims = 3000;
+	const int njobs = 8;
+	const int baseVtx = 1000;
+	int nerr = 0;
+	int* pCnt = (int*)nxCore::mem_alloc(nprims * sizeof(int), "Test:PrimBat:Cnt");
+	cxBrigade* pBgd = cxBrigade::create(4);
+	sxJobQueue* pQue = nxTask::queue_create(njobs);
+	sxJob jobs[njobs];
+	PrimBatTestJob jobInfo[njobs];
+
+	PrimBatch::Buffer buf;
+	buf.init(0x10000, 0x10000, nprims);
+	for (int pass = 0; pass < 2; ++pass) {
+		if (pass) {
+			nxTask::queue_purge(pQue);
+			for (int i = 0; i < njobs; ++i) {
+				jobInfo[i].pBuf = &buf;
+				jobInfo[i].org = nprims * i / njobs;
+				jobInfo[i].num = nprims * (i + 1) / njobs - jobInfo[i].org;
+				jobs[i].mFunc = prim_bat_test_job;
+				jobs[i].mpData = &jobInfo[i];
+				jobs[i].mId = i;
+				nxTask::queue_add(pQue, &jobs[i]);
+			}
+			nxTask::queue_exec(pQue, pBgd);
+		} else {
+			for (int i = 0; i < nprims; ++i) {
+				prim_bat_test_add(&buf, i);
+			}
+		}
+		int nbat = buf.build(baseVtx);
+		int ncmp = prim_bat_test_ck(buf, nprims, baseVtx, pCnt);
+		for (int i = 0; i < nprims; ++i) {
+			if (!pCnt[i]) ++ncmp;
+		}
+		/* materials 0 and 3 are the same */
+		if (nbat != 5 || buf.get_prims_num() != nprims || buf.get_stats().mDroppedNum != 0) ++ncmp;
+		/* opaque material first */
+		if (buf.get_batch(0)->mMtl.mAlphaBlend) ++ncmp;
+		::printf("prim batch (%s): %d prims -> %d draws, %d vtx, %d idx: %d errors\n", pass ? "brigade" : "serial",
+			buf.get_prims_num(), nbat, buf.get_vtx_num(), buf.get_draw_idx_num(), ncmp);
+		nerr += ncmp;
+		buf.clear();
+	}
+
+	/* capacity: what does not fit is dropped and reported, the rest is still drawn */
+	PrimBatch::Buffer small;
+	small.init(500, 600, 80);
+	int nadded = 0;
+	for (int i = 0; i < 200; ++i) {
+		int nbefore = small.get_dropped_num();
+		prim_bat_test_add(&small, i);
+		if (small.get_dropped_num() == nbefore) ++nadded;
+	}
+	small.build();
+	nerr += prim_bat_test_ck(small, 200, 0, pCnt);
+	int ndrawn = 0;
+	for (int i = 0; i < 200; ++i) {
+		if (pCnt[i]) ++ndrawn;
+	}
+	const PrimBatch::Stats& stats = small.get_stats();
+	if (ndrawn != nadded || stats.mDroppedNum != 200 - nadded || stats.mDroppedNum <= 0) ++nerr;
+	if (stats.mVtxNum > 500 || stats.mIdxNum > 600 || stats.mPrimsNum != 80 || stats.mPeakDroppedNum != stats.mDroppedNum) ++nerr;
+	::printf("prim batch capacity: %d of 200 prims drawn, %d vtx, %d idx\n", ndrawn, stats.mVtxNum, stats.mIdxNum);
+	small.clear();
+	small.build();
+	if (small.get_stats().mDroppedNum != 0 || small.get_stats().mPeakDroppedNum == 0 || small.get_batches_num() != 0) ++nerr;
+	small.clear_peaks();
+	if (small.get_stats().mPeakVtxNum != 0) ++nerr;
+
+	/* non-indexed triangles, CPU transform, rejected input */
+	PrimBatch::Material mtl;
+	mtl.set(nullptr);
+	sxPrimVtx tri[4];
+	for (int i = 0; i < 4; ++i) {
+		tri[i].pos.set(float(i), 1.0f, 2.0f, 1.0f);
+		tri[i].clr.fill(1.0f);
+		tri[i].tex.fill(0.0f);
+		tri[i].prm.fill(0.0f);
+		tri[i].encode_normal(nxVec::get_axis(exAxis::PLUS_X));
+	}
+	cxMtx m;
+	m.set_rot_y(XD_DEG2RAD(90.0f));
+	m.set_translation(cxVec(10.0f, 0.0f, 0.0f));
+	if (!small.add(mtl, tri, 4, nullptr, 0, &m)) ++nerr;
+	uint16_t badIdx[3] = { 0, 1, 4 };
+	if (small.add(mtl, tri, 4, badIdx, 3) || small.add(mtl, tri, 2)) ++nerr;
+	small.build(7);
+	if (small.get_batches_num() != 1 || small.get_draw_idx_num() != 3) ++nerr;
+	for (int i = 0; i < 3; ++i) {
+		if (small.get_draw_idx_data()[i] != 7 + i) ++nerr;
+		const sxPrimVtx& vtx = small.get_vtx_data()[i];
+		cxVec pos = m.calc_pnt(cxVec(float(i), 1.0f, 2.0f));
+		if (nxVec::dist(pos, cxVec(vtx.pos.x, vtx.pos.y, vtx.pos.z)) > 1e-4f) ++nerr;
+		xt_float2 oct;
+		oct.set(vtx.prm.x, vtx.prm.y);
+		cxVec nrm = m.calc_vec(nxVec::get_axis(exAxis::PLUS_X));
+		if (nxVec::dist(nxVec::decode_octa(oct), nrm) > 1e-3f) ++nerr;
+	}
+
+	::printf("prim batch: %d errors\n", nerr);
+	nxTask::queue_destroy(pQue);
+	cxBrigade::destroy(pBgd);
+	nxCore::mem_free(pCnt);
+}
+
+
+// ~~~~~~~~~~~~~~~~~ collision
+
+struct ColTestKey {
+	float val;
+	int32_t id;
+};
+
+static int col_test_key_cmp(const void* pA, const void* pB) {
+	const ColTestKey* pKeyA = (const ColTestKey*)pA;
+	const ColTestKey* pKeyB = (const ColTestKey*)pB;
+	if (pKeyA->val != pKeyB->val) return pKeyA->val < pKeyB->val ? -1 : 1;
+	return pKeyA->id - pKeyB->id;
+}
+
+struct ColTestBuilder {
+	const cxAABB* mpTriBBox;
+	ColTestKey* mpKeys;
+	cxAABB* mpNodeBBox;
+	sxCollisionData::BVHNodeInfo* mpNodeInfo;
+	int mNodesNum;
+
+	/* median split along the longest axis, leaves hold one triangle */
+	int build(const int org, const int num) {
+		int inode = mNodesNum++;
+		cxAABB bbox;
+		bbox.init();
+		for (int i = 0; i < num; ++i) {
+			bbox.merge(mpTriBBox[mpKeys[org + i].id]);
+		}
+		mpNodeBBox[inode] = bbox;
+		if (num == 1) {
+			mpNodeInfo[inode].mLeft = mpKeys[org].id;
+			mpNodeInfo[inode].mRight = -1;
+			return inode;
+		}
+		cxVec size = bbox.get_size_vec();
+		int axis = size.x > size.y ? (size.x > size.z ? 0 : 2) : (size.y > size.z ? 1 : 2);
+		for (int i = 0; i < num; ++i) {
+			ColTestKey* pKey = &mpKeys[org + i];
+			pKey->val = mpTriBBox[pKey->id].get_center()[axis];
+		}
+		::qsort(&mpKeys[org], num, sizeof(ColTestKey), col_test_key_cmp);
+		int nleft = num / 2;
+		int ileft = build(org, nleft);
+		int iright = build(org + nleft, num - nleft);
+		mpNodeInfo[inode].mLeft = ileft;
+		mpNodeInfo[inode].mRight = iright;
+		return inode;
+	}
+};
+
+/* n x n cells of unit size, 2 triangles each, in a single block with the layout of xcol files (all tris, no names);
+   every 7th point is raised by up to bump to make walls, withBVH = false leaves the BVH offsets empty */
+static sxCollisionData* col_test_create(const int n, const float bump, const uint64_t seed, const bool withBVH = true) {
+	int npnt = (n + 1) * (n + 1);
+	int ntri = n * n * 2;
+	int nnodes = withBVH ? ntri * 2 - 1 : 0;
+	uint32_t headSize = uint32_t(XD_ALIGN(sizeof(sxCollisionData), 16));
+	uint32_t pntOffs = headSize;
+	uint32_t idxOrgOffs = pntOffs + uint32_t(npnt * sizeof(cxVec));
+	uint32_t idxOffs = idxOrgOffs + uint32_t(ntri * sizeof(int32_t));
+	uint32_t polBBoxOffs = idxOffs + uint32_t(ntri * 3 * sizeof(int32_t));
+	uint32_t bvhBBoxOffs = polBBoxOffs + uint32_t(ntri * sizeof(cxAABB));
+	uint32_t bvhInfoOffs = bvhBBoxOffs + uint32_t(nnodes * sizeof(cxAABB));
+	uint32_t size = bvhInfoOffs + uint32_t(nnodes * sizeof(sxCollisionData::BVHNodeInfo));
+	void* pMem = nxCore::mem_alloc(size, "ColTest:Data");
+	if (!pMem) return nullptr;
+	::memset(pMem, 0, size);
+	sxCollisionData* pCol = ::new (pMem) sxCollisionData();
+	pCol->mKind = sxCollisionData::KIND;
+	pCol->mFlags = 1; /* all polygons of the same size */
+	pCol->mFileSize = size;
+	pCol->mHeadSize = headSize;
+	pCol->mNameId = -1;
+	pCol->mPathId = -1;
+	pCol->mPntNum = npnt;
+	pCol->mPolNum = ntri;
+	pCol->mGrpNum = 0;
+	pCol->mTriNum = ntri;
+	pCol->mMaxVtxPerPol = 3;
+	pCol->mPntOffs = pntOffs;
+	pCol->mPolIdxOrgOffs = idxOrgOffs;
+	pCol->mPolIdxOffs = idxOffs;
+	pCol->mPolBBoxOffs = polBBoxOffs;
+
+	sxRNG rng;
+	nxCore::rng_seed(&rng, seed);
+	cxVec* pPnts = (cxVec*)XD_INCR_PTR(pCol, pntOffs);
+	for (int i = 0; i < npnt; ++i) {
+		float y = (i % 7) == 0 ? nxCore::rng_f01(&rng) * bump : 0.0f;
+		pPnts[i].set(float(i % (n + 1)), y, float(i / (n + 1)));
+	}
+	int32_t* pOrg = (int32_t*)XD_INCR_PTR(pCol, idxOrgOffs);
+	int32_t* pIdx = (int32_t*)XD_INCR_PTR(pCol, idxOffs);
+	cxAABB* pTriBBox = (cxAABB*)XD_INCR_PTR(pCol, polBBoxOffs);
+	for (int i = 0; i < n * n; ++i) {
+		int i00 = (i / n) * (n + 1) + (i % n);
+		int i01 = i00 + 1;
+		int i10 = i00 + n + 1;
+		int i11 = i10 + 1;
+		int32_t quad[6] = { i00, i01, i10, i01, i11, i10 };
+		for (int j = 0; j < 6; ++j) {
+			pIdx[i * 6 + j] = quad[j];
+		}
+	}
+	cxAABB bbox;
+	bbox.init();
+	for (int i = 0; i < ntri; ++i) {
+		pOrg[i] = i * 3;
+		pTriBBox[i].init();
+		for (int j = 0; j < 3; ++j) {
+			pTriBBox[i].add_pnt(pPnts[pIdx[i * 3 + j]]);
+		}
+		bbox.merge(pTriBBox[i]);
+	}
+	pCol->mBBox = bbox;
+
+	if (withBVH) {
+		ColTestBuilder bld;
+		bld.mpTriBBox = pTriBBox;
+		bld.mpKeys = (ColTestKey*)nxCore::mem_alloc(ntri * sizeof(ColTestKey), "ColTest:Keys");
+		bld.mpNodeBBox = (cxAABB*)XD_INCR_PTR(pCol, bvhBBoxOffs);
+		bld.mpNodeInfo = (sxCollisionData::BVHNodeInfo*)XD_INCR_PTR(pCol, bvhInfoOffs);
+		bld.mNodesNum = 0;
+		if (bld.mpKeys) {
+			for (int i = 0; i < ntri; ++i) {
+				bld.mpKeys[i].id = i;
+			}
+			bld.build(0, ntri);
+			nxCore::mem_free(bld.mpKeys);
+			pCol->mBVHBBoxOffs = bvhBBoxOffs;
+			pCol->mBVHInfoOffs = bvhInfoOffs;
+		}
+	}
+	return pCol;
+}
+
+static void col_test_destroy(sxCollisionData* pCol) {
+	nxCore::mem_free(pCol);
+}
+
+static int col_test_hit_cmp(const sxCollisionData::NearestHit& ref, const sxCollisionData::NearestHit& hit) {
+	if (ref.count != hit.count) return 1;
+	if (ref.count == 0) return 0;
+	int res = ::memcmp(&ref.pos, &hit.pos, sizeof(cxVec)) != 0;
+	res |= ::memcmp(&ref.nrm, &hit.nrm, sizeof(cxVec)) != 0;
+	res |= ref.dist != hit.dist;
+	return res;
+}
+
+/* ground probes (coherent, straight down) and incoherent segments, some axis-aligned or missing everything:
+   streams have to return exactly what nearest_hit() does, counts included, and BVH culling must not lose
+   any crossing brute force finds */
+void test_col_packet() {
+	const int nseg = 20000;
+	const int nrep = 5;
+	const int nsub = nseg / 16;
+	const int n = 128;
+	cxLineSeg* pSegs = (cxLineSeg*)nxCore::mem_alloc(nseg * sizeof(cxLineSeg), "Test:ColPkt:Segs");
+	cxLineSeg* pSubSegs = (cxLineSeg*)nxCore::mem_alloc(nsub * sizeof(cxLineSeg), "Test:ColPkt:SubSegs");
+	sxCollisionData::NearestHit* pRef = (sxCollisionData::NearestHit*)nxCore::mem_alloc(nseg * sizeof(sxCollisionData::NearestHit), "Test:ColPkt:Ref");
+	sxCollisionData::NearestHit* pHits = (sxCollisionData::NearestHit*)nxCore::mem_alloc(nseg * sizeof(sxCollisionData::NearestHit), "Test:ColPkt:Hits");
+	int32_t* pWk = (int32_t*)nxCore::mem_alloc(nseg * 2 * sizeof(int32_t), "Test:ColPkt:Wk");
+	sxCollisionData* pCol = col_test_create(n, 1.5f, 3, true);
+	sxCollisionData* pBrute = col_test_create(n, 1.5f, 3, false);
+	if (pCol && pBrute) {
+		for (int mode = 0; mode < 2; ++mode) {
+			sxRNG rng;
+			nxCore::rng_seed(&rng, 5 + mode);
+			float ext = float(n);
+			for (int i = 0; i < nseg; ++i) {
+				cxVec p0(nxCore::rng_f01(&rng) * ext, 2.0f, nxCore::rng_f01(&rng) * ext);
+				cxVec p1;
+				if (mode == 0) {
+					p1 = p0 - cxVec(0.0f, 4.0f, 0.0f);
+				} else {
+					p0.y = nxCore::rng_f01(&rng) * 3.0f - 0.5f;
+					cxVec dir(nxCore::rng_f01(&rng) - 0.5f, nxCore::rng_f01(&rng) - 0.5f, nxCore::rng_f01(&rng) - 0.5f);
+					if ((i % 13) == 0) dir.x = 0.0f;
+					if ((i % 17) == 0) dir.set(0.0f, 0.0f, 1.0f);
+					p1 = p0 + dir * (nxCore::rng_f01(&rng) * 8.0f);
+				}
+				pSegs[i].set(p0, p1);
+			}
+			int nerr = 0;
+			int nhit = 0;
+			int ncross = 0;
+			double tref = 0.0;
+			double tstm = 0.0;
+			for (int r = 0; r < nrep; ++r) {
+				double t0 = nxSys::time_micros();
+				for (int i = 0; i < nseg; ++i) {
+					pRef[i] = pCol->nearest_hit(pSegs[i]);
+				}
+				double t1 = nxSys::time_micros();
+				pCol->nearest_hit_stream(pSegs, pHits, nseg, pWk);
+				double t2 = nxSys::time_micros();
+				for (int i = 0; i < nseg; ++i) {
+					nerr += col_test_hit_cmp(pRef[i], pHits[i]);
+				}
+				tref = r ? nxCalc::min(tref, t1 - t0) : t1 - t0;
+				tstm = r ? nxCalc::min(tstm, t2 - t1) : t2 - t1;
+			}
+			for (int i = 0; i < nseg; ++i) {
+				nhit += pRef[i].count > 0 ? 1 : 0;
+				ncross += pRef[i].count;
+			}
+			/* null work memory: stream allocates its own */
+			pCol->nearest_hit_stream(pSegs, pHits, nseg);
+			for (int i = 0; i < nseg; ++i) {
+				nerr += col_test_hit_cmp(pRef[i], pHits[i]);
+			}
+			/* brute force on every 16th segment, single and streamed */
+			int nbrute = 0;
+			for (int i = 0; i < nsub; ++i) {
+				pSubSegs[i] = pSegs[i * 16];
+			}
+			pBrute->nearest_hit_stream(pSubSegs, pHits, nsub);
+			for (int i = 0; i < nsub; ++i) {
+				nbrute += col_test_hit_cmp(pRef[i * 16], pHits[i]);
+				if ((i & 7) == 0) {
+					nbrute += col_test_hit_cmp(pRef[i * 16], pBrute->nearest_hit(pSubSegs[i]));
+				}
+			}
+			nerr += nbrute;
+			::printf("col stream (%s): %d tris, %d segs, %d hits, %d crossings, Mseg/s single %.2f, stream %.2f: %d errors (%d vs brute force)\n",
+			         mode ? "incoherent" : "probes", int(pCol->mTriNum), nseg, nhit, ncross,
+			         nseg / tref, nseg / tstm, nerr, nbrute);
+		}
+	}
+	if (pCol) col_test_destroy(pCol);
+	if (pBrute) col_test_destroy(pBrute);
+	nxCore::mem_free(pWk);
+	nxCore::mem_free(pHits);
+	nxCore::mem_free(pRef);
+	nxCore::mem_free(pSubSegs);
+	nxCore::mem_free(pSegs);
+}
+
+
+// ~~~~~~~~~~~~~~~~~ scene
+
+struct WallAdjTestJob {
+	sxCollisionData* pCol;
+	const cxVec* pOld;
+	const cxVec* pNew;
+	cxVec* pAdj;
+	int org;
+	int num;
+};
+
+static void wall_adj_test_job(const sxJobContext* pCtx) {
+	WallAdjTestJob* pJob = (WallAdjTestJob*)pCtx->mpJob->mpData;
+	for (int i = pJob->org; i < pJob->org + pJob->num; ++i) {
+		pJob->pAdj[i] = pJob->pNew[i];
+		Scene::wall_adj_base(pCtx, pJob->pCol, pJob->pNew[i], pJob->pOld[i], 0.3f, &pJob->pAdj[i]);
+	}
+}
+
+/* 10k adjustments per frame through a private context, through jobs without a worker id
+   (queue_exec() without a brigade: serial, or the OMP team with XD_USE_OMP) and through jobs of a brigade
+   that is not the scene's (worker ids that do not own the scene's contexts), results must not differ */
+void test_wall_adj() {
+	static const int s_grids[] = { 64, 256, 512 };
+	const int ncalls = 10000;
+	const int nframes = 10;
+	const int njobs = 64;
+	cxVec* pOld = (cxVec*)nxCore::mem_alloc(ncalls * sizeof(cxVec), "Test:WallAdj:Old");
+	cxVec* pNew = (cxVec*)nxCore::mem_alloc(ncalls * sizeof(cxVec), "Test:WallAdj:New");
+	cxVec* pRef = (cxVec*)nxCore::mem_alloc(ncalls * sizeof(cxVec), "Test:WallAdj:Ref");
+	cxVec* pAdj = (cxVec*)nxCore::mem_alloc(ncalls * sizeof(cxVec), "Test:WallAdj:Adj");
+	sxJobQueue* pQue = nxTask::queue_create(njobs);
+	sxJob jobs[njobs];
+	WallAdjTestJob jobInfo[njobs];
+	Scene::alloc_wall_adj_ctxs();
+	Scene::WallAdjCtx* pCtx = Scene::wall_adj_ctx_create();
+	cxBrigade* pBgd = cxBrigade::create(4);
+	for (int igrid = 0; igrid < int(XD_ARY_LEN(s_grids)); ++igrid) {
+		int n = s_grids[igrid];
+		sxCollisionData* pCol = col_test_create(n, 1.5f, 7);
+		if (!pCol) continue;
+		sxRNG rng;
+		nxCore::rng_seed(&rng, 11);
+		for (int i = 0; i < ncalls; ++i) {
+			pOld[i].set(1.0f + nxCore::rng_f01(&rng) * (n - 2), 0.5f, 1.0f + nxCore::rng_f01(&rng) * (n - 2));
+			pNew[i] = pOld[i] + cxVec(nxCore::rng_f01(&rng) - 0.5f, 0.0f, nxCore::rng_f01(&rng) - 0.5f) * 0.3f;
+		}
+		int nerr = 0;
+		int nadj = 0;
+		double tctx = 0.0;
+		double tjob = 0.0;
+		double tbgd = 0.0;
+		for (int f = 0; f < nframes; ++f) {
+			double t0 = nxSys::time_micros();
+			for (int i = 0; i < ncalls; ++i) {
+				pRef[i] = pNew[i];
+				Scene::wall_adj_base(pCtx, pCol, pNew[i], pOld[i], 0.3f, &pRef[i]);
+			}
+			double dt = nxSys::time_micros() - t0;
+			tctx = f ? nxCalc::min(tctx, dt) : dt;
+
+			nxTask::queue_purge(pQue);
+			for (int i = 0; i < njobs; ++i) {
+				jobInfo[i].pCol = pCol;
+				jobInfo[i].pOld = pOld;
+				jobInfo[i].pNew = pNew;
+				jobInfo[i].pAdj = pAdj;
+				jobInfo[i].org = ncalls * i / njobs;
+				jobInfo[i].num = ncalls * (i + 1) / njobs - jobInfo[i].org;
+				jobs[i].mFunc = wall_adj_test_job;
+				jobs[i].mpData = &jobInfo[i];
+				jobs[i].mId = i;
+				nxTask::queue_add(pQue, &jobs[i]);
+			}
+			t0 = nxSys::time_micros();
+			nxTask::queue_exec(pQue, nullptr);
+			dt = nxSys::time_micros() - t0;
+			tjob = f ? nxCalc::min(tjob, dt) : dt;
+			for (int i = 0; i < ncalls; ++i) {
+				if (::memcmp(&pRef[i], &pAdj[i], sizeof(cxVec)) != 0) ++nerr;
+			}
+			t0 = nxSys::time_micros();
+			nxTask::queue_exec(pQue, pBgd);
+			dt = nxSys::time_micros() - t0;
+			tbgd = f ? nxCalc::min(tbgd, dt) : dt;
+			for (int i = 0; i < ncalls; ++i) {
+				if (::memcmp(&pRef[i], &pAdj[i], sizeof(cxVec)) != 0) ++nerr;
+			}
+		}
+		for (int i = 0; i < ncalls; ++i) {
+			if (::memcmp(&pRef[i], &pNew[i], sizeof(cxVec)) != 0) ++nadj;
+		}
+		if (Scene::wall_adj_ctx_capacity(pCtx) < int(pCol->mTriNum)) ++nerr;
+		/* the shared contexts were claimed and released, not bypassed for private ones */
+		Scene::WallAdjCtx* pShared = Scene::get_job_wall_adj_ctx(nullptr);
+		if (!pShared || Scene::wall_adj_ctx_capacity(pShared) < int(pCol->mTriNum)) ++nerr;
+		Scene::release_job_wall_adj_ctx(pShared);
+		::printf("wall adj: %d tris, %d calls/frame, %d adjusted, ctx %.2f ms, jobs %.2f ms, brigade jobs %.2f ms (best of %d): %d errors\n",
+		         int(pCol->mTriNum), ncalls, nadj, tctx / 1e3, tjob / 1e3, tbgd / 1e3, nframes, nerr);
+		col_test_destroy(pCol);
+	}
+	cxBrigade::destroy(pBgd);
+	Scene::wall_adj_ctx_destroy(pCtx);
+	Scene::free_wall_adj_ctxs();
+	nxTask::queue_destroy(pQue);
+	nxCore::mem_free(pAdj);
+	nxCore::mem_free(pRef);
+	nxCore::mem_free(pNew);
+	nxCore::mem_free(pOld);
+}
+
+/* get_ground_heights() against per-point get_ground_height(): identical without the cache,
+   within the cache tolerance with it; a cache built for another collision must be ignored */
+void test_gnd_cache() {
+	static const struct { int n; float bump; } s_cfgs[] = { { 64, 0.0f }, { 64, 1.5f }, { 256, 1.5f } };
+	const int npos = 20000;
+	const float cellSize = 0.5f;
+	const float tol = 0.01f;
+	const float offsTop = 3.0f;
+	const float offsBtm = 3.0f;
+	cxVec* pPos = (cxVec*)nxCore::mem_alloc(npos * sizeof(cxVec), "Test:Gnd:Pos");
+	float* pRef = (float*)nxCore::mem_alloc(npos * sizeof(float), "Test:Gnd:Ref");
+	float* pHgt = (float*)nxCore::mem_alloc(npos * sizeof(float), "Test:Gnd:Hgt");
+	for (int icfg = 0; icfg < int(XD_ARY_LEN(s_cfgs)); ++icfg) {
+		int n = s_cfgs[icfg].n;
+		sxCollisionData* pCol = col_test_create(n, s_cfgs[icfg].bump, 5);
+		sxCollisionData* pOther = col_test_create(8, 0.0f, 5);
+		if (!pCol || !pOther) {
+			col_test_destroy(pCol);
+			col_test_destroy(pOther);
+			continue;
+		}
+		sxRNG rng;
+		nxCore::rng_seed(&rng, 13);
+		for (int i = 0; i < npos; ++i) {
+			/* a few points off the terrain to exercise the fallback */
+			float x = -1.0f + nxCore::rng_f01(&rng) * float(n + 2);
+			float z = -1.0f + nxCore::rng_f01(&rng) * float(n + 2);
+			pPos[i].set(x, 1.0f, z);
+		}
+		int nerr = 0;
+		double t0 = nxSys::time_micros();
+		for (int i = 0; i < npos; ++i) {
+			pRef[i] = Scene::get_ground_height(pCol, pPos[i], offsTop, offsBtm);
+		}
+		double tray = nxSys::time_micros() - t0;
+		Scene::get_ground_heights(pCol, pPos, pHgt, npos, offsTop, offsBtm);
+		if (::memcmp(pRef, pHgt, npos * sizeof(float)) != 0) ++nerr;
+
+		t0 = nxSys::time_micros();
+		Scene::GroundCache* pCache = Scene::ground_cache_create(pCol, cellSize, tol);
+		double tbuild = nxSys::time_micros() - t0;
+		Scene::GroundCache* pOtherCache = Scene::ground_cache_create(pOther, cellSize, tol);
+		if (!pCache || !pOtherCache) ++nerr;
+		float cov = Scene::ground_cache_coverage(pCache);
+		if (s_cfgs[icfg].bump == 0.0f && cov < 1.0f) ++nerr;
+
+		t0 = nxSys::time_micros();
+		Scene::get_ground_heights(pCol, pPos, pHgt, npos, offsTop, offsBtm, pCache);
+		double tcache = nxSys::time_micros() - t0;
+		float maxErr = 0.0f;
+		for (int i = 0; i < npos; ++i) {
+			maxErr = nxCalc::max(maxErr, ::fabsf(pHgt[i] - pRef[i]));
+		}
+		/* bilinear vs. the triangle pair inside a checked cell: the checks bound it to ~tol */
+		if (maxErr > tol * 2.0f) ++nerr;
+
+		Scene::get_ground_heights(pCol, pPos, pHgt, npos, offsTop, offsBtm, pOtherCache);
+		if (::memcmp(pRef, pHgt, npos * sizeof(float)) != 0) ++nerr;
+
+		::printf("gnd cache: %d tris, coverage %.1f%%, build %.2f ms, %d queries: ray %.2f ms, cache %.2f ms, max err %f: %d errors\n",
+		         int(pCol->mTriNum), cov * 100.0f, tbuild / 1e3, npos, tray / 1e3, tcache / 1e3, maxErr, nerr);
+		Scene::ground_cache_destroy(pOtherCache);
+		Scene::ground_cache_destroy(pCache);
+		col_test_destroy(pOther);
+		col_test_destroy(pCol);
+	}
+	nxCore::mem_free(pHgt);
+	nxCore::mem_free(pRef);
+	nxCore::mem_free(pPos);
+}
+
+struct SphGridTestPairs {
+	const int32_t* mpRef; /* i, j of the reference pairs */
+	int mRefNum;
+	int mNum;
+	int mErrs;
+
+	void operator()(const int i, const int j) {
+		if (mNum >= mRefNum || mpRef[mNum * 2] != i || mpRef[mNum * 2 + 1] != j) {
+			++mErrs;
+		}
+		++mNum;
+	}
+};
+
+/* SphGrid::Grid::for_each_pair() against all pairs checked in O(n^2), pairs and their order must match,
+   serial and on a brigade; same agent density at every count */
+void test_sph_grid() {
+	static const int s_nums[] = { 1000, 5000, 20000, 50000 };
+	const float margin = 0.05f;
+	const int maxNum = s_nums[XD_ARY_LEN(s_nums) - 1];
+	cxSphere* pSph = (cxSphere*)nxCore::mem_alloc(maxNum * sizeof(cxSphere), "Test:SphGrid:Sph");
+	int refMax = maxNum * 16;
+	int32_t* pRef = (int32_t*)nxCore::mem_alloc(refMax * 2 * sizeof(int32_t), "Test:SphGrid:Ref");
+	cxBrigade* pBgd = cxBrigade::create(4);
+	for (int inum = 0; inum < int(XD_ARY_LEN(s_nums)); ++inum) {
+		int n = s_nums[inum];
+		float ext = ::sqrtf(float(n)) * 1.5f;
+		sxRNG rng;
+		nxCore::rng_seed(&rng, 21);
+		for (int i = 0; i < n; ++i) {
+			float x = nxCore::rng_f01(&rng) * ext;
+			float y = nxCore::rng_f01(&rng) * 2.0f;
+			float z = nxCore::rng_f01(&rng) * ext;
+			pSph[i] = cxSphere(x, y, z, 0.3f + nxCore::rng_f01(&rng) * 0.4f);
+		}
+		int nerr = 0;
+		int nref = 0;
+		double t0 = nxSys::time_micros();
+		for (int i = 0; i < n; ++i) {
+			cxVec c = pSph[i].get_center();
+			float r = pSph[i].get_radius() + margin;
+			for (int j = i + 1; j < n; ++j) {
+				float rr = r + pSph[j].get_radius();
+				if (nxVec::dist2(c, pSph[j].get_center()) <= rr*rr) {
+					if (nref < refMax) {
+						pRef[nref * 2] = i;
+						pRef[nref * 2 + 1] = j;
+					}
+					++nref;
+				}
+			}
+		}
+		double tref = nxSys::time_micros() - t0;
+		if (nref > refMax) ++nerr;
+		double tbld[2] = { 0.0, 0.0 };
+		for (int mode = 0; mode < 2; ++mode) {
+			cxBrigade* pWrk = mode ? pBgd : nullptr;
+			SphGrid::Grid grid;
+			grid.init(n, 16);
+			for (int rep = 0; rep < 5; ++rep) {
+				t0 = nxSys::time_micros();
+				grid.build(pSph, n, margin, pWrk);
+				double dt = nxSys::time_micros() - t0;
+				tbld[mode] = rep ? nxCalc::min(tbld[mode], dt) : dt;
+			}
+			SphGridTestPairs pairs;
+			pairs.mpRef = pRef;
+			pairs.mRefNum = nxCalc::min(nref, refMax);
+			pairs.mNum = 0;
+			pairs.mErrs = 0;
+			grid.for_each_pair(pairs);
+			if (pairs.mNum != nref) ++nerr;
+			if (grid.get_pairs_num() != nref) ++nerr;
+			nerr += pairs.mErrs;
+			grid.reset();
+		}
+		::printf("sph grid: %d agents, %d pairs, O(n^2) %.2f ms, build %.2f ms, %.2f ms on %d workers: %d errors\n",
+		         n, nref, tref / 1e3, tbld[0] / 1e3, tbld[1] / 1e3, pBgd ? pBgd->get_workers_num() : 0, nerr);
+	}
+	cxBrigade::destroy(pBgd);
+	nxCore::mem_free(pRef);
+	nxCore::mem_free(pSph);
+}
+
+#ifdef OGLSYS_DUMMY
+
+/* Scene tests: frames go through the dummy GL backend and are checked against its draw record */
+
+struct ScnTestMtl {
+	const char* pTexName; /* nullptr: untextured */
+	bool alpha;
+	bool forceBlend;
+	bool dblSided;
+};
+
+/* rigid model of flat strips facing +Z, one material per batch; batch i has (i + 1) * 2 triangles so that
+   draw records can be told apart by their index count; textures get dummy GL handles up front */
+static sxModelData* scn_test_model(const char* pName, const ScnTestMtl* pMtls, const int nbat) {
+	const int maxTex = 16;
+	const char* pTexNames[maxTex];
+	int ntex = 0;
+	int npnt = 0;
+	int ntri = 0;
+	for (int i = 0; i < nbat; ++i) {
+		npnt += (i + 2) * 2;
+		ntri += (i + 1) * 2;
+		if (pMtls[i].pTexName) {
+			bool found = false;
+			for (int j = 0; j < ntex; ++j) {
+				found |= nxCore::str_eq(pTexNames[j], pMtls[i].pTexName);
+			}
+			if (!found && ntex < maxTex) {
+				pTexNames[ntex++] = pMtls[i].pTexName;
+			}
+		}
+	}
+	char mtlNames[maxTex][8];
+	int nstr = 1 + nbat + ntex;
+	size_t strDataSize = ::strlen(pName) + 1;
+	for (int i = 0; i < nbat; ++i) {
+		XD_SPRINTF(XD_SPRINTF_BUF(mtlNames[i], sizeof(mtlNames[i])), "mtl%d", i);
+		strDataSize += ::strlen(mtlNames[i]) + 1;
+	}
+	for (int i = 0; i < ntex; ++i) {
+		strDataSize += ::strlen(pTexNames[i]) + 1;
+	}
+	size_t offs = XD_ALIGN(sizeof(sxModelData), 16);
+	size_t hs = offs;
+	size_t pntOffs = offs;
+	offs = XD_ALIGN(offs + npnt * sizeof(sxModelData::VtxRigidHalf), 16);
+	size_t mtlOffs = offs;
+	offs = XD_ALIGN(offs + nbat * sizeof(sxModelData::Material), 16);
+	size_t texOffs = offs;
+	offs = XD_ALIGN(offs + ntex * sizeof(sxModelData::TexInfo), 16);
+	size_t batOffs = offs;
+	offs = XD_ALIGN(offs + nbat * (sizeof(cxAABB) + sizeof(sxModelData::Batch)), 16);
+	size_t idxOffs = offs;
+	offs = XD_ALIGN(offs + ntri * 3 * sizeof(uint16_t), 16);
+	size_t strOffs = offs;
+	size_t strHeadSize = sizeof(uint32_t) * 2 + nstr * (sizeof(uint32_t) + sizeof(uint16_t));
+	offs = XD_ALIGN(offs + strHeadSize + strDataSize, 16);
+	uint8_t* pMem = (uint8_t*)nxCore::mem_alloc(offs, "Test:Scn:Mdl");
+	if (!pMem) return nullptr;
+	::memset(pMem, 0, offs);
+
+	sxStrList* pStrLst = (sxStrList*)(pMem + strOffs);
+	pStrLst->mSize = uint32_t(strHeadSize + strDataSize);
+	pStrLst->mNum = nstr;
+	char* pStrDst = (char*)pStrLst + strHeadSize;
+	for (int i = 0; i < nstr; ++i) {
+		const char* pStr = i == 0 ? pName : (i <= nbat ? mtlNames[i - 1] : pTexNames[i - 1 - nbat]);
+		size_t len = ::strlen(pStr) + 1;
+		::memcpy(pStrDst, pStr, len);
+		pStrLst->mOffs[i] = uint32_t(pStrDst - (char*)pStrLst);
+		pStrLst->get_hash_top()[i] = nxCore::str_hash16(pStr);
+		pStrDst += len;
+	}
+
+	sxModelData* pMdl = (sxModelData*)pMem;
+	pMdl->mKind = sxModelData::KIND;
+	pMdl->mFlags = 2; /* half encoding */
+	pMdl->mFileSize = uint32_t(offs);
+	pMdl->mHeadSize = uint32_t(hs);
+	pMdl->mOffsStr = uint32_t(strOffs);
+	pMdl->mNameId = 0;
+	pMdl->mPathId = -1;
+	pMdl->mPntNum = npnt;
+	pMdl->mTriNum = ntri;
+	pMdl->mMtlNum = nbat;
+	pMdl->mTexNum = ntex;
+	pMdl->mBatNum = nbat;
+	pMdl->mIdx16Num = ntri * 3;
+	pMdl->mPntOffs = uint32_t(pntOffs);
+	pMdl->mMtlOffs = uint32_t(mtlOffs);
+	pMdl->mTexOffs = ntex > 0 ? uint32_t(texOffs) : 0;
+	pMdl->mBatOffs = uint32_t(batOffs);
+	pMdl->mIdx16Offs = uint32_t(idxOffs);
+
+	sxModelData::TexInfo* pTexInfos = (sxModelData::TexInfo*)(pMem + texOffs);
+	for (int i = 0; i < ntex; ++i) {
+		pTexInfos[i].mNameId = 1 + nbat + i;
+		pTexInfos[i].mPathId = -1;
+		glGenTextures(1, pTexInfos[i].get_wk<GLuint>());
+	}
+
+	sxModelData::VtxRigidHalf* pVtx = (sxModelData::VtxRigidHalf*)(pMem + pntOffs);
+	sxModelData::Material* pMtl = (sxModelData::Material*)(pMem + mtlOffs);
+	cxAABB* pBatBoxes = (cxAABB*)(pMem + batOffs);
+	sxModelData::Batch* pBat = (sxModelData::Batch*)(pMem + batOffs + nbat * sizeof(cxAABB));
+	uint16_t* pIdx = (uint16_t*)(pMem + idxOffs);
+	xt_float2 oct = cxVec(0.0f, 0.0f, 1.0f).encode_octa();
+	cxAABB mdlBox;
+	mdlBox.init();
+	int ipnt = 0;
+	int iidx = 0;
+	for (int i = 0; i < nbat; ++i) {
+		const ScnTestMtl& src = pMtls[i];
+		pMtl[i].mNameId = 1 + i;
+		pMtl[i].mPathId = -1;
+		pMtl[i].mBaseTexId = -1;
+		for (int j = 0; j < ntex; ++j) {
+			if (src.pTexName && nxCore::str_eq(pTexNames[j], src.pTexName)) {
+				pMtl[i].mBaseTexId = j;
+			}
+		}
+		pMtl[i].mSpecTexId = -1;
+		pMtl[i].mBumpTexId = -1;
+		pMtl[i].mSurfTexId = -1;
+		pMtl[i].mExtTexId = -1;
+		pMtl[i].mFlags.alpha = src.alpha;
+		pMtl[i].mFlags.forceBlend = src.forceBlend;
+		pMtl[i].mFlags.dblSided = src.dblSided;
+		pMtl[i].mFlags.shadowCast = 1;
+		pMtl[i].mFlags.shadowRecv = 1;
+		pMtl[i].mBaseColor.set(1.0f, 1.0f, 1.0f);
+		pMtl[i].mSpecColor.set(1.0f, 1.0f, 1.0f);
+		pMtl[i].mRoughness = 0.5f;
+		pMtl[i].mFresnel = 0.04f;
+
+		int ncol = i + 2;
+		float z = float(i) * 0.25f;
+		cxAABB box;
+		box.init();
+		for (int c = 0; c < ncol; ++c) {
+			for (int r = 0; r < 2; ++r) {
+				cxVec pos(float(c) * 0.5f - 1.0f, float(r), z);
+				sxModelData::VtxRigidHalf* pV = &pVtx[ipnt + c * 2 + r];
+				pV->pos.set(pos.x, pos.y, pos.z);
+				pV->oct.set(oct);
+				pV->tex.set(float(c) / float(ncol - 1), float(r));
+				pV->clr.set(1.0f, 1.0f, 1.0f, 1.0f);
+				box.add_pnt(pos);
+			}
+		}
+		for (int c = 0; c < ncol - 1; ++c) {
+			int v0 = c * 2;
+			uint16_t quad[6] = { uint16_t(v0), uint16_t(v0 + 2), uint16_t(v0 + 1), uint16_t(v0 + 1), uint16_t(v0 + 2), uint16_t(v0 + 3) };
+			::memcpy(&pIdx[iidx + c * 6], quad, sizeof(quad));
+		}
+		pBat[i].mNameId = -1;
+		pBat[i].mMtlId = i;
+		pBat[i].mMinIdx = ipnt;
+		pBat[i].mMaxIdx = ipnt + ncol * 2 - 1;
+		pBat[i].mIdxOrg = iidx;
+		pBat[i].mTriNum = (ncol - 1) * 2;
+		pBat[i].mJntNum = 0;
+		pBat[i].mJntInfoOrg = -1;
+		pBatBoxes[i] = box;
+		mdlBox.merge(box);
+		ipnt += ncol * 2;
+		iidx += (ncol - 1) * 6;
+	}
+	pMdl->mBBox = mdlBox;
+	return pMdl;
+}
+
+static void scn_test_model_free(sxModelData* pMdl) {
+	if (!pMdl) return;
+	cxResourceManager* pRsrcMgr = Scene::get_rsrc_mgr();
+	if (pRsrcMgr && pRsrcMgr->get_gfx_ifc().releaseModel) {
+		pRsrcMgr->get_gfx_ifc().releaseModel(pMdl);
+	}
+	for (uint32_t i = 0; i < pMdl->mTexNum; ++i) {
+		glDeleteTextures(1, pMdl->get_tex_info(i)->get_wk<GLuint>());
+	}
+	nxCore::mem_free(pMdl);
+}
+
+static bool scn_test_init() {
+	OGLSysCfg ocfg;
+	ocfg.x = 0;
+	ocfg.y = 0;
+	ocfg.width = 640;
+	ocfg.height = 480;
+	ocfg.msaa = 0;
+	ocfg.reduceRes = false;
+	ocfg.hideSysIcons = false;
+	ocfg.withoutCtx = false;
+	OGLSys::init(ocfg);
+	ScnCfg cfg;
+	cfg.set_defaults();
+	cfg.numWorkers = 4;
+	Scene::init(cfg);
+	return Scene::get_rsrc_mgr() != nullptr;
+}
+
+static void scn_test_reset() {
+	Scene::reset();
+	OGLSys::reset();
+}
+
+static int scn_test_frame(dummygl::DrawRec* pRecs, const int maxRecs) {
+	dummygl::rec_start(pRecs, maxRecs);
+	Scene::frame_begin();
+	Scene::exec();
+	Scene::visibility();
+	Scene::draw();
+	Scene::frame_end();
+	return dummygl::rec_stop();
+}
+
+static int scn_test_rec_cmp(const void* pA, const void* pB) {
+	return ::memcmp(pA, pB, sizeof(dummygl::DrawRec));
+}
+
+/* same draws, in any order */
+static bool scn_test_same_draws(const dummygl::DrawRec* pRecsA, const dummygl::DrawRec* pRecsB, const int n, dummygl::DrawRec* pTmp) {
+	::memcpy(pTmp, pRecsA, n * sizeof(dummygl::DrawRec));
+	::memcpy(pTmp + n, pRecsB, n * sizeof(dummygl::DrawRec));
+	::qsort(pTmp, n, sizeof(dummygl::DrawRec), scn_test_rec_cmp);
+	::qsort(pTmp + n, n, sizeof(dummygl::DrawRec), scn_test_rec_cmp);
+	return ::memcmp(pTmp, pTmp + n, n * sizeof(dummygl::DrawRec)) == 0;
+}
+
+/* framebuffer, program, texture and, with pMtls, the culling mode of the batch (draw records are told apart by their index count) */
+static bool scn_test_same_state(const dummygl::DrawRec& recA, const dummygl::DrawRec& recB, const ScnTestMtl* pMtls) {
+	if (recA.fbo != recB.fbo || recA.prog != recB.prog || recA.tex != recB.tex) return false;
+	return !pMtls || pMtls[recA.count / 6 - 1].dblSided == pMtls[recB.count / 6 - 1].dblSided;
+}
+
+static int scn_test_state_changes(const dummygl::DrawRec* pRecs, const int n, const ScnTestMtl* pMtls) {
+	int nchg = 0;
+	for (int i = 1; i < n; ++i) {
+		if (!scn_test_same_state(pRecs[i - 1], pRecs[i], pMtls)) ++nchg;
+	}
+	return nchg;
+}
+
+/* states that come back after their run of draws has ended */
+static int scn_test_split_states(const dummygl::DrawRec* pRecs, const int n, const ScnTestMtl* pMtls) {
+	int nsplit = 0;
+	for (int i = 1; i < n; ++i) {
+		if (scn_test_same_state(pRecs[i - 1], pRecs[i], pMtls)) continue;
+		for (int j = 0; j < i - 1; ++j) {
+			if (scn_test_same_state(pRecs[j], pRecs[i], pMtls)) {
+				++nsplit;
+				break;
+			}
+		}
+	}
+	return nsplit;
+}
+
+/* Scene::enable_draw_sort(): one frame of opaque, double-sided and alpha batches over a few objects, drawn unsorted
+   and sorted; the sorted record must hold the same draws with the shadow pass first, opaque states in unbroken runs,
+   semi then blended batches after all opaque ones, back-to-front */
+void test_scene_draw_order() {
+	static const ScnTestMtl s_mtls[] = {
+		{ "texA", false, false, false },
+		{ "texB", false, false, false },
+		{ "texA", false, false, true },
+		{ nullptr, false, false, false },
+		{ "texB", true, false, false },
+		{ "texA", true, true, false }
+	};
+	const int nbat = XD_ARY_LEN(s_mtls);
+	const int nobj = 6;
+	const int maxRecs = 1024;
+	if (!scn_test_init()) {
+		::printf("scene draw order: no scene\n");
+		scn_test_reset();
+		return;
+	}
+	sxModelData* pMdl = scn_test_model("scn_test", s_mtls, nbat);
+	for (int i = 0; i < nobj; ++i) {
+		ScnObj* pObj = Scene::add_obj(pMdl);
+		if (pObj) {
+			pObj->set_world_quat_pos(nxQuat::identity(), cxVec(float(i % 3) * 3.0f - 3.0f, 0.0f, -float(i / 3) * 3.0f));
+		}
+	}
+	cxVec viewPos(0.0f, 2.0f, 8.0f);
+	Scene::set_view(viewPos, cxVec(0.0f, 0.5f, 0.0f));
+	dummygl::DrawRec* pRecs = (dummygl::DrawRec*)nxCore::mem_alloc(maxRecs * 4 * sizeof(dummygl::DrawRec), "Test:Scn:Recs");
+	dummygl::DrawRec* pRefRecs = pRecs + maxRecs;
+	dummygl::DrawRec* pTmp = pRecs + maxRecs * 2;
+	int nerr = 0;
+	int nref = scn_test_frame(pRefRecs, maxRecs);
+	Scene::enable_draw_sort();
+	int nrec = scn_test_frame(pRecs, maxRecs);
+	cxVec viewDir = Scene::get_view_dir();
+	Scene::disable_draw_sort();
+	if (nrec != nref || nrec <= 0 || nrec >= maxRecs) ++nerr;
+	if (nerr == 0 && !scn_test_same_draws(pRecs, pRefRecs, nrec, pTmp)) ++nerr;
+	int nshadow = 0;
+	while (nshadow < nrec && pRecs[nshadow].fbo != 0) {
+		++nshadow;
+	}
+	if (nshadow == 0 || nshadow == nrec) ++nerr;
+	int nopaq = 0;
+	int nsemi = 0;
+	int nblend = 0;
+	float prevDepth = 0.0f;
+	for (int i = nshadow; i < nrec; ++i) {
+		const dummygl::DrawRec& rec = pRecs[i];
+		if (rec.fbo != 0) ++nerr;
+		int ibat = rec.count / 6 - 1;
+		if (ibat < 0 || ibat >= nbat) {
+			++nerr;
+			continue;
+		}
+		const ScnTestMtl& mtl = s_mtls[ibat];
+		float depth = (cxVec(rec.world[3], rec.world[7], rec.world[11]) - viewPos).dot(viewDir);
+		if (!mtl.alpha) {
+			if (nsemi + nblend > 0) ++nerr;
+			++nopaq;
+		} else if (!mtl.forceBlend) {
+			if (nblend > 0) ++nerr;
+			if (nsemi > 0 && depth > prevDepth) ++nerr;
+			++nsemi;
+		} else {
+			if (nblend > 0 && depth > prevDepth) ++nerr;
+			++nblend;
+		}
+		prevDepth = depth;
+	}
+	if (nopaq == 0 || nsemi == 0 || nblend == 0) ++nerr;
+	nerr += scn_test_split_states(pRecs, nshadow, nullptr) + scn_test_split_states(pRecs + nshadow, nopaq, s_mtls);
+	int nchg = scn_test_state_changes(pRecs, nshadow, nullptr) + scn_test_state_changes(pRecs + nshadow, nopaq, s_mtls);
+	int nrefChg = scn_test_state_changes(pRefRecs, nshadow, nullptr) + scn_test_state_changes(pRefRecs + nshadow, nopaq, s_mtls);
+	if (nchg > nrefChg) ++nerr;
+	::printf("scene draw order: %d draws (%d shadow, %d opaque, %d semi, %d blended), state changes %d sorted / %d unsorted: %d errors\n",
+	         nrec, nshadow, nopaq, nsemi, nblend, nchg, nrefChg, nerr);
+	Scene::del_all_objs();
+	scn_test_model_free(pMdl);
+	nxCore::mem_free(pRecs);
+	scn_test_reset();
+}
+
+static void scn_test_bat_func(ScnObj* pObj, const int ibat) {
+}
+
+/* Scene::enable_draw_mt_record(): commands packed on the brigade must reach GL exactly as the sorted frame
+   drawn directly on this thread, with several chunks per flush and with whole passes split over the workers;
+   one object keeps a batch callback (drawn directly) and one does not receive shadows */
+void test_scene_mt_record() {
+	static const ScnTestMtl s_mtls[] = {
+		{ "texA", false, false, false },
+		{ "texB", false, false, false },
+		{ "texA", false, false, true },
+		{ "texB", true, false, false },
+		{ "texA", true, true, false }
+	};
+	static const int s_chunks[] = { 64, 1024 };
+	const int nbat = XD_ARY_LEN(s_mtls);
+	const int nobj = 48;
+	const int maxRecs = 2048;
+	if (!scn_test_init()) {
+		::printf("scene mt record: no scene\n");
+		scn_test_reset();
+		return;
+	}
+	sxModelData* pMdl = scn_test_model("scn_test", s_mtls, nbat);
+	for (int i = 0; i < nobj; ++i) {
+		ScnObj* pObj = Scene::add_obj(pMdl);
+		if (pObj) {
+			pObj->set_world_quat_pos(nxQuat::from_degrees(0.0f, float(i) * 7.0f, 0.0f), cxVec(float(i % 8) * 2.5f - 9.0f, 0.0f, -float(i / 8) * 2.5f));
+			if (i == 5) {
+				pObj->mBatchPreDrawFunc = scn_test_bat_func;
+			}
+			if (i == 11) {
+				pObj->mDisableShadowRecv = true;
+			}
+		}
+	}
+	Scene::set_view(cxVec(0.0f, 4.0f, 10.0f), cxVec(0.0f, 0.5f, -6.0f));
+	dummygl::DrawRec* pRecs = (dummygl::DrawRec*)nxCore::mem_alloc(maxRecs * 2 * sizeof(dummygl::DrawRec), "Test:Scn:Recs");
+	dummygl::DrawRec* pRefRecs = pRecs + maxRecs;
+	int nerr = 0;
+	Scene::enable_draw_sort();
+	int nref = scn_test_frame(pRefRecs, maxRecs);
+	if (nref <= 0 || nref >= maxRecs) ++nerr;
+	int nlst = 0;
+	for (int i = 0; i < int(XD_ARY_LEN(s_chunks)); ++i) {
+		Scene::enable_draw_mt_record(s_chunks[i]);
+		if (!Scene::is_draw_mt_record_enabled()) ++nerr;
+		int nrec = scn_test_frame(pRecs, maxRecs);
+		nlst = nxCalc::max(nlst, Scene::get_draw_mt_record_lists_num());
+		Scene::disable_draw_mt_record();
+		if (nrec != nref) {
+			++nerr;
+			continue;
+		}
+		for (int j = 0; j < nrec; ++j) {
+			if (::memcmp(&pRecs[j], &pRefRecs[j], sizeof(dummygl::DrawRec)) != 0) ++nerr;
+		}
+	}
+	Scene::disable_draw_sort();
+	if (nlst < 2) ++nerr;
+	::printf("scene mt record: %d draws, up to %d worker lists: %d errors\n", nref, nlst, nerr);
+	Scene::del_all_objs();
+	scn_test_model_free(pMdl);
+	nxCore::mem_free(pRecs);
+	scn_test_reset();
+}
+
+static const int SCN_PRIM_TEST_QUADS = 40;
+static const int SCN_PRIM_TEST_GEOMS = 30;
+
+/* screen quads in runs of 10 alternating between two textures, a prim_geom() upload per triangle drawn with
+   one tris_semi(), then a world prim added after the quads */
+static int scn_prim_test_frame(dummygl::DrawRec* pRecs, const int maxRecs, sxTextureData* pTexs, const bool batch) {
+	if (batch) {
+		Scene::enable_prim_batch(2048, 2048, 6144, 6144, 256);
+	}
+	dummygl::rec_start(pRecs, maxRecs);
+	Scene::frame_begin();
+	Scene::exec();
+	Scene::visibility();
+	Scene::draw();
+	xt_float2 tex[4];
+	tex[0].set(0.0f, 0.0f);
+	tex[1].set(1.0f, 0.0f);
+	tex[2].set(1.0f, 1.0f);
+	tex[3].set(0.0f, 1.0f);
+	for (int i = 0; i < SCN_PRIM_TEST_QUADS; ++i) {
+		float x = float(i % 10) * 32.0f;
+		float y = float(i / 10) * 32.0f;
+		xt_float2 pos[4];
+		pos[0].set(x, y);
+		pos[1].set(x + 30.0f, y);
+		pos[2].set(x + 30.0f, y + 30.0f);
+		pos[3].set(x, y + 30.0f);
+		Scene::quad(pos, tex, cxColor(1.0f, 0.5f, 0.25f, 0.75f), &pTexs[(i / 10) & 1]);
+	}
+	sxPrimVtx vtx[3];
+	for (int i = 0; i < 3; ++i) {
+		vtx[i].pos.set(float(i & 1), float(i >> 1), 0.0f, 1.0f);
+		vtx[i].clr.fill(1.0f);
+		vtx[i].tex.fill(0.0f);
+		vtx[i].prm.fill(0.0f);
+		vtx[i].encode_normal(cxVec(0.0f, 0.0f, 1.0f));
+	}
+	for (int i = 0; i < SCN_PRIM_TEST_GEOMS; ++i) {
+		Scene::prim_verts(uint32_t(i * 3), 3, vtx);
+	}
+	Scene::tris_semi(0, SCN_PRIM_TEST_GEOMS, nullptr, &pTexs[0]);
+	Scene::prim_batch_tris(vtx, 3, nullptr, 0, &pTexs[1]);
+	Scene::frame_end();
+	int nrec = dummygl::rec_stop();
+	return nrec;
+}
+
+/* Scene::enable_prim_batch(): quad() goes into the batch as screen prims drawn over the world prims in add order,
+   one call per run of a texture, and contiguous prim_geom() uploads reach GL as one; drawn without batching,
+   every quad and every upload is a call of its own */
+void test_scene_prim_batch() {
+	const int maxRecs = 256;
+	if (!scn_test_init()) {
+		::printf("scene prim batch: no scene\n");
+		scn_test_reset();
+		return;
+	}
+	Scene::init_prims(8192, 8192 * 3);
+	sxTextureData texs[2];
+	::memset(texs, 0, sizeof(texs));
+	for (int i = 0; i < 2; ++i) {
+		glGenTextures(1, texs[i].get_gpu_wk<GLuint>());
+	}
+	GLuint htex[2] = { *texs[0].get_gpu_wk<GLuint>(), *texs[1].get_gpu_wk<GLuint>() };
+	Scene::set_view(cxVec(0.0f, 0.0f, 4.0f), cxVec(0.0f));
+	dummygl::DrawRec* pRecs = (dummygl::DrawRec*)nxCore::mem_alloc(maxRecs * 2 * sizeof(dummygl::DrawRec), "Test:Scn:Recs");
+	dummygl::DrawRec* pRefRecs = pRecs + maxRecs;
+	DrawStats::Counters* pStats = DrawStats::get_counters();
+	int nerr = 0;
+
+	int nref = scn_prim_test_frame(pRefRecs, maxRecs, texs, false);
+	int refUploads = int(pStats->get_frame_val(DrawStats::BUF_UPLOADS));
+	/* quads, the tris and the world prim dropped as batching is off */
+	if (nref != SCN_PRIM_TEST_QUADS + 1) ++nerr;
+	GLuint quadProg = nref > 0 ? pRefRecs[0].prog : 0;
+	GLuint primProg = nref > 0 ? pRefRecs[nref - 1].prog : 0;
+	for (int i = 0; i < nref; ++i) {
+		const dummygl::DrawRec& rec = pRefRecs[i];
+		if (i < SCN_PRIM_TEST_QUADS) {
+			if (rec.prog != quadProg || rec.count != 4 || rec.tex != htex[(i / 10) & 1]) ++nerr;
+		} else {
+			if (rec.prog != primProg || rec.count != SCN_PRIM_TEST_GEOMS * 3) ++nerr;
+		}
+	}
+	if (quadProg == primProg) ++nerr;
+
+	int nrec = scn_prim_test_frame(pRecs, maxRecs, texs, true);
+	int batUploads = int(pStats->get_frame_val(DrawStats::BUF_UPLOADS));
+	/* the tris right away, then the world prim and the quads in runs of 10 at frame_end() */
+	static const int s_runTex[4] = { 0, 1, 0, 1 };
+	if (nrec != 2 + 4) ++nerr;
+	for (int i = 0; i < nrec; ++i) {
+		const dummygl::DrawRec& rec = pRecs[i];
+		if (rec.prog != primProg || rec.fbo != 0) ++nerr;
+		if (i == 0) {
+			if (rec.count != SCN_PRIM_TEST_GEOMS * 3 || rec.tex != htex[0]) ++nerr;
+		} else if (i == 1) {
+			if (rec.count != 3 || rec.tex != htex[1]) ++nerr;
+		} else {
+			if (rec.count != 10 * 6 || rec.tex != htex[s_runTex[(i - 2) & 3]]) ++nerr;
+		}
+	}
+	if (Scene::get_prim_batch_draws_num() != 5) ++nerr;
+	if (Scene::get_prim_batch_prims_num() != SCN_PRIM_TEST_QUADS + 1) ++nerr;
+	if (Scene::get_prim_batch_dropped_num() != 0) ++nerr;
+	/* one staged vertex upload instead of one per prim_geom(), plus the batch vertices and indices */
+	if (batUploads != refUploads - SCN_PRIM_TEST_GEOMS + 1 + 2) ++nerr;
+	Scene::disable_prim_batch();
+
+	::printf("scene prim batch: %d draws batched, %d unbatched; %d uploads batched, %d unbatched: %d errors\n", nrec, nref, batUploads, refUploads, nerr);
+	for (int i = 0; i < 2; ++i) {
+		glDeleteTextures(1, texs[i].get_gpu_wk<GLuint>());
+	}
+	nxCore::mem_free(pRecs);
+	scn_test_reset();
+}
+
+/* object whose world transform a draw record was made with, -1 if none */
+static int scn_inst_test_find_obj(const dummygl::DrawRec& rec, ScnObj** ppObjs, const int nobj) {
+	for (int i = 0; i < nobj; ++i) {
+		const xt_xmtx* pWorld = ppObjs[i]->mpMdlWk->mpWorldXform;
+		if (pWorld && ::memcmp(rec.world, pWorld, sizeof(rec.world)) == 0) return i;
+	}
+	return -1;
+}
+
+/* Scene::enable_draw_instancing(): identical rigid objects, every one visible and casting; each batch of each pass
+   must be one instanced draw through a program of its own, with every object's world transform exactly once
+   among the instances */
+void test_scene_inst() {
+	static const ScnTestMtl s_mtls[] = {
+		{ "texA", false, false, false },
+		{ "texB", false, false, false }
+	};
+	const int nbat = XD_ARY_LEN(s_mtls);
+	const int nobj = 12;
+	const int maxRecs = 256;
+	if (!scn_test_init()) {
+		::printf("scene inst: no scene\n");
+		scn_test_reset();
+		return;
+	}
+	sxModelData* pMdl = scn_test_model("scn_test", s_mtls, nbat);
+	ScnObj* pObjs[nobj];
+	int nerr = 0;
+	for (int i = 0; i < nobj; ++i) {
+		pObjs[i] = Scene::add_obj(pMdl);
+		if (pObjs[i]) {
+			pObjs[i]->set_world_quat_pos(nxQuat::from_degrees(0.0f, float(i) * 15.0f, 0.0f), cxVec(float(i % 4) * 2.0f - 3.0f, 0.0f, -float(i / 4) * 2.0f));
+		} else {
+			++nerr;
+		}
+	}
+	if (nerr > 0) {
+		::printf("scene inst: no objects\n");
+		Scene::del_all_objs();
+		scn_test_model_free(pMdl);
+		scn_test_reset();
+		return;
+	}
+	Scene::set_view(cxVec(0.0f, 4.0f, 12.0f), cxVec(0.0f, 0.0f, -2.0f));
+	dummygl::DrawRec* pRecs = (dummygl::DrawRec*)nxCore::mem_alloc(maxRecs * 2 * sizeof(dummygl::DrawRec), "Test:Scn:Recs");
+	dummygl::DrawRec* pRefRecs = pRecs + maxRecs;
+	const int nslots = 2 * nbat * nobj;
+	int hits[nslots];
+	::memset(hits, 0, sizeof(hits));
+
+	Scene::enable_draw_sort();
+	int nref = scn_test_frame(pRefRecs, maxRecs);
+	/* both passes, one draw per object and batch */
+	if (nref != nslots) ++nerr;
+	for (int i = 0; i < nref; ++i) {
+		if (pRefRecs[i].inst != -1 || scn_inst_test_find_obj(pRefRecs[i], pObjs, nobj) < 0) ++nerr;
+	}
+
+	Scene::enable_draw_instancing();
+	int nrec = scn_test_frame(pRecs, maxRecs);
+	int ngrp = Scene::get_draw_inst_groups_num();
+	int nbats = Scene::get_draw_inst_batches_num();
+	Scene::disable_draw_instancing();
+	Scene::disable_draw_sort();
+	if (ngrp != 2 * nbat) ++nerr;
+	if (nbats != nslots) ++nerr;
+	if (nrec != nslots) ++nerr;
+	int ndraws = 0;
+	for (int i = 0; i < nrec; ++i) {
+		const dummygl::DrawRec& rec = pRecs[i];
+		if (rec.inst == 0) ++ndraws;
+		if (rec.inst < 0 || rec.inst >= nobj) ++nerr;
+		for (int j = 0; j < nref; ++j) {
+			if (rec.prog == pRefRecs[j].prog) {
+				++nerr;
+				break;
+			}
+		}
+		int ibat = rec.count / 6 - 1;
+		int iobj = scn_inst_test_find_obj(rec, pObjs, nobj);
+		if (ibat < 0 || ibat >= nbat || iobj < 0) {
+			++nerr;
+			continue;
+		}
+		++hits[((rec.fbo != 0 ? 0 : 1) * nbat + ibat) * nobj + iobj];
+	}
+	if (ndraws != ngrp) ++nerr;
+	for (int i = 0; i < nslots; ++i) {
+		if (hits[i] != 1) ++nerr;
+	}
+	::printf("scene inst: %d instanced draws of %d batches, %d direct draws: %d errors\n", ndraws, nbats, nref, nerr);
+	Scene::del_all_objs();
+	scn_test_model_free(pMdl);
+	nxCore::mem_free(pRecs);
+	scn_test_reset();
+}
+
+#endif
@@ -85,6 +85,8 @@ const uint32_t sxImageData::KIND = XD_FOURCC('X', 'I', 'M', 'G');
 const uint32_t sxKeyframesData::KIND = XD_FOURCC('X', 'K', 'F', 'R');
 const uint32_t sxExprLibData::KIND = XD_FOURCC('X', 'C', 'E', 'L');
 const uint32_t sxModelData::KIND = XD_FOURCC('X', 'M', 'D', 'L');
+const uint32_t sxModelData::CLUSTERS_EXT = XD_FOURCC('C', 'L', 'S', 'T');
+const uint32_t sxModelData::LODS_EXT = XD_FOURCC('L', 'O', 'D', 'S');
 const uint32_t sxTextureData::KIND = XD_FOURCC('X', 'T', 'E', 'X');
 const uint32_t sxMotionData::KIND = XD_FOURCC('X', 'M', 'O', 'T');
 const uint32_t sxCollisionData::KIND = XD_FOURCC('X', 'C', 'O', 'L');
@@ -445,6 +447,8 @@ sxWorker* worker_create(xt_worker_func func, void* pData) {
 		pWrk->mhThread = ::CreateThread(NULL, 0, wnd_wrk_entry, pWrk, CREATE_SUSPENDED, &pWrk->mTID);
 		if (pWrk->mhThread) {
 			::ResumeThread(pWrk->mhThread);
+			/* the thread signals done once running: take that here, not as the end of the first exec */
+			signal_wait(pWrk->mpSigDone);
 		}
 	}
 	return pWrk;
@@ -476,7 +480,7 @@ void worker_stop(sxWorker* pWrk) {
 	if (pWrk && !pWrk->mEndFlg) {
 		pWrk->mEndFlg = true;
 		worker_exec(pWrk);
-		worker_wait(pWrk);
+		/* a worker between its done signal and the loop check exits without another one, only the join is reliable */
 		::WaitForSingleObject(pWrk->mhThread, INFINITE);
 		::CloseHandle(pWrk->mhThread);
 	}
@@ -606,6 +610,8 @@ sxWorker* worker_create(xt_worker_func func, void* pData) {
 #if defined(XD_SYS_LINUX)
 		pthread_setname_np(pWrk->mThread, s_pXWorkerTag);
 #endif
+		/* the thread signals done once running: take that here, not as the end of the first exec */
+		signal_wait(pWrk->mpSigDone);
 	}
 	return pWrk;
 }
@@ -637,7 +643,7 @@ void worker_stop(sxWorker* pWrk) {
 		void* exitRes = (void*)-1;
 		pWrk->mEndFlg = true;
 		worker_exec(pWrk);
-		worker_wait(pWrk);
+		/* a worker between its done signal and the loop check exits without another one, only the join is reliable */
 		pthread_join(pWrk->mThread, &exitRes);
 	}
 }
@@ -762,6 +768,8 @@ sxWorker* worker_create(xt_worker_func func, void* pData) {
 		pWrk->mpSigDone = signal_create();
 		pWrk->mEndFlg = false;
 		::new ((void*)&pWrk->mThread) std::thread(std_wrk_func, pWrk);
+		/* the thread signals done once running: take that here, not as the end of the first exec */
+		signal_wait(pWrk->mpSigDone);
 	}
 	return pWrk;
 }
@@ -793,7 +801,7 @@ void worker_stop(sxWorker* pWrk) {
 	if (pWrk && !pWrk->mEndFlg) {
 		pWrk->mEndFlg = true;
 		worker_exec(pWrk);
-		worker_wait(pWrk);
+		/* a worker between its done signal and the loop check exits without another one, only the join is reliable */
 		pWrk->mThread.join();
 	}
 }
@@ -4617,6 +4625,100 @@ bool cxFrustum::overlaps(const cxAABB& box) const {
 	return false;
 }
 
+#if defined(__AVX__)
+#	define XD_FST_SIMD 2
+#	include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#	define XD_FST_SIMD 1
+#	include <emmintrin.h>
+#else
+#	define XD_FST_SIMD 0
+#endif
+
+void sxAABB8::pack(sxAABB8* pBlks, const cxAABB* pBoxes, const int nboxes) {
+	if (!pBlks || !pBoxes || nboxes <= 0) return;
+	int nblk = calc_blocks_num(nboxes);
+	::memset(&pBlks[nblk - 1], 0, sizeof(sxAABB8));
+	for (int i = 0; i < nboxes; ++i) {
+		pBlks[i >> 3].set(i & 7, pBoxes[i]);
+	}
+}
+
+/* the operation order of cull(cxAABB) is kept lane-wise, so both give the same bits */
+void cxFrustum::cull_boxes(const sxAABB8* pBlks, const int nboxes, uint32_t* pCullBits) const {
+	if (!pBlks || !pCullBits || nboxes <= 0) return;
+	int nblk = sxAABB8::calc_blocks_num(nboxes);
+	for (int ib = 0; ib < nblk; ++ib) {
+		const sxAABB8* pBlk = &pBlks[ib];
+		uint32_t mask = 0;
+#if XD_FST_SIMD == 2
+		__m256 cx = _mm256_loadu_ps(pBlk->mCenterX);
+		__m256 cy = _mm256_loadu_ps(pBlk->mCenterY);
+		__m256 cz = _mm256_loadu_ps(pBlk->mCenterZ);
+		__m256 rx = _mm256_loadu_ps(pBlk->mRadiusX);
+		__m256 ry = _mm256_loadu_ps(pBlk->mRadiusY);
+		__m256 rz = _mm256_loadu_ps(pBlk->mRadiusZ);
+		__m256 res = _mm256_setzero_ps();
+		const cxVec* pPnt = &mPnt[0];
+		for (int i = 0; i < 6; ++i) {
+			if (i == 3) pPnt = &mPnt[6];
+			cxVec n = mNrm[i];
+			cxVec a = n.abs_val();
+			__m256 vx = _mm256_sub_ps(cx, _mm256_set1_ps(pPnt->x));
+			__m256 vy = _mm256_sub_ps(cy, _mm256_set1_ps(pPnt->y));
+			__m256 vz = _mm256_sub_ps(cz, _mm256_set1_ps(pPnt->z));
+			__m256 rd = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(rx, _mm256_set1_ps(a.x)), _mm256_mul_ps(ry, _mm256_set1_ps(a.y))), _mm256_mul_ps(rz, _mm256_set1_ps(a.z)));
+			__m256 vd = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(vx, _mm256_set1_ps(n.x)), _mm256_mul_ps(vy, _mm256_set1_ps(n.y))), _mm256_mul_ps(vz, _mm256_set1_ps(n.z)));
+			res = _mm256_or_ps(res, _mm256_cmp_ps(rd, vd, _CMP_LT_OQ));
+		}
+		mask = uint32_t(_mm256_movemask_ps(res));
+#elif XD_FST_SIMD == 1
+		for (int h = 0; h < 2; ++h) {
+			int offs = h * 4;
+			__m128 cx = _mm_loadu_ps(&pBlk->mCenterX[offs]);
+			__m128 cy = _mm_loadu_ps(&pBlk->mCenterY[offs]);
+			__m128 cz = _mm_loadu_ps(&pBlk->mCenterZ[offs]);
+			__m128 rx = _mm_loadu_ps(&pBlk->mRadiusX[offs]);
+			__m128 ry = _mm_loadu_ps(&pBlk->mRadiusY[offs]);
+			__m128 rz = _mm_loadu_ps(&pBlk->mRadiusZ[offs]);
+			__m128 res = _mm_setzero_ps();
+			const cxVec* pPnt = &mPnt[0];
+			for (int i = 0; i < 6; ++i) {
+				if (i == 3) pPnt = &mPnt[6];
+				cxVec n = mNrm[i];
+				cxVec a = n.abs_val();
+				__m128 vx = _mm_sub_ps(cx, _mm_set1_ps(pPnt->x));
+				__m128 vy = _mm_sub_ps(cy, _mm_set1_ps(pPnt->y));
+				__m128 vz = _mm_sub_ps(cz, _mm_set1_ps(pPnt->z));
+				__m128 rd = _mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, _mm_set1_ps(a.x)), _mm_mul_ps(ry, _mm_set1_ps(a.y))), _mm_mul_ps(rz, _mm_set1_ps(a.z)));
+				__m128 vd = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, _mm_set1_ps(n.x)), _mm_mul_ps(vy, _mm_set1_ps(n.y))), _mm_mul_ps(vz, _mm_set1_ps(n.z)));
+				res = _mm_or_ps(res, _mm_cmplt_ps(rd, vd));
+			}
+			mask |= uint32_t(_mm_movemask_ps(res)) << offs;
+		}
+#else
+		for (int j = 0; j < 8; ++j) {
+			cxVec c(pBlk->mCenterX[j], pBlk->mCenterY[j], pBlk->mCenterZ[j]);
+			cxVec r(pBlk->mRadiusX[j], pBlk->mRadiusY[j], pBlk->mRadiusZ[j]);
+			cxVec v = c - mPnt[0];
+			for (int i = 0; i < 6; ++i) {
+				cxVec n = mNrm[i];
+				if (i == 3) v = c - mPnt[6];
+				if (r.dot(n.abs_val()) < v.dot(n)) {
+					mask |= 1U << j;
+					break;
+				}
+			}
+		}
+#endif
+		int nlanes = nboxes - (ib << 3);
+		if (nlanes < 8) {
+			mask &= (1U << nlanes) - 1;
+		}
+		pCullBits[ib >> 2] |= mask << ((ib & 3) << 3);
+	}
+}
+
 void cxFrustum::dump_geo(FILE* pOut) const {
 	if (!pOut) return;
 	const int nedges = XD_ARY_LEN(s_frustumEdgeTbl);
@@ -11387,6 +11489,146 @@ int sxModelData::count_alpha_batches() const {
 	return n;
 }
 
+const sxModelData::ClusterInfo* sxModelData::get_cluster_info() const {
+	const ClusterInfo* pInfo = nullptr;
+	uint32_t offs = find_ext_offs(CLUSTERS_EXT);
+	if (offs > 0) {
+		pInfo = reinterpret_cast<const ClusterInfo*>(XD_INCR_PTR(this, offs));
+	}
+	return pInfo;
+}
+
+int sxModelData::get_batch_clusters_num(const int ibat) const {
+	int n = 0;
+	const ClusterInfo* pInfo = get_cluster_info();
+	if (pInfo && ck_batch_id(ibat)) {
+		n = pInfo->mBatOrg[ibat + 1] - pInfo->mBatOrg[ibat];
+	}
+	return n;
+}
+
+const sxModelData::Cluster* sxModelData::get_batch_clusters(const int ibat) const {
+	const Cluster* pCls = nullptr;
+	const ClusterInfo* pInfo = get_cluster_info();
+	if (pInfo && ck_batch_id(ibat)) {
+		pCls = reinterpret_cast<const Cluster*>(XD_INCR_PTR(pInfo, pInfo->mClsOffs)) + pInfo->mBatOrg[ibat];
+	}
+	return pCls;
+}
+
+// Every triangle is back-facing if all normals in the cone see every point of the sphere from behind:
+//   |v| * cos(angle(v, axis) + coneAngle) >= radius, v = center - viewPos.
+bool sxModelData::Cluster::is_backfacing(const cxVec& viewPos) const {
+	if (!has_cone()) return false;
+	cxVec v = cxVec(mCenter.x, mCenter.y, mCenter.z) - viewPos;
+	cxVec axis(mConeAxis.x, mConeAxis.y, mConeAxis.z);
+	float vd = v.dot(axis);
+	float vp = ::sqrtf(nxCalc::max(v.mag2() - vd*vd, 0.0f));
+	float coneSin = ::sqrtf(nxCalc::max(1.0f - mConeCos*mConeCos, 0.0f));
+	return vd*mConeCos - vp*coneSin >= mRadius;
+}
+
+const sxModelData::LodInfo* sxModelData::get_lod_info() const {
+	const LodInfo* pInfo = nullptr;
+	uint32_t offs = find_ext_offs(LODS_EXT);
+	if (offs > 0) {
+		pInfo = reinterpret_cast<const LodInfo*>(XD_INCR_PTR(this, offs));
+	}
+	return pInfo;
+}
+
+int sxModelData::get_lods_num() const {
+	const LodInfo* pInfo = get_lod_info();
+	return pInfo ? int(pInfo->mLodNum) + 1 : 1;
+}
+
+const sxModelData::Lod* sxModelData::get_lod(const int ilod) const {
+	const Lod* pLod = nullptr;
+	const LodInfo* pInfo = get_lod_info();
+	if (pInfo && ilod > 0 && ilod <= int(pInfo->mLodNum)) {
+		pLod = reinterpret_cast<const Lod*>(XD_INCR_PTR(pInfo, pInfo->mLodsOffs)) + (ilod - 1);
+	}
+	return pLod;
+}
+
+float sxModelData::get_lod_error(const int ilod) const {
+	const Lod* pLod = get_lod(ilod);
+	return pLod ? pLod->mError : 0.0f;
+}
+
+int sxModelData::get_lod_tri_num(const int ilod) const {
+	int n = 0;
+	if (ilod == 0) {
+		n = int(mTriNum);
+	} else {
+		const Lod* pLod = get_lod(ilod);
+		if (pLod) {
+			n = int(pLod->mTriNum);
+		}
+	}
+	return n;
+}
+
+const sxModelData::LodBatch* sxModelData::get_lod_batch_ptr(const int ilod, const int ibat) const {
+	const LodBatch* pLodBat = nullptr;
+	const LodInfo* pInfo = get_lod_info();
+	if (pInfo && ilod > 0 && ilod <= int(pInfo->mLodNum) && ck_batch_id(ibat)) {
+		pLodBat = reinterpret_cast<const LodBatch*>(XD_INCR_PTR(pInfo, pInfo->mBatsOffs)) + (ilod - 1)*mBatNum + ibat;
+	}
+	return pLodBat;
+}
+
+int sxModelData::get_lod_batch_tri_num(const int ilod, const int ibat) const {
+	int n = 0;
+	if (ilod == 0) {
+		const Batch* pBat = get_batch_ptr(ibat);
+		if (pBat) {
+			n = pBat->mTriNum;
+		}
+	} else {
+		const LodBatch* pLodBat = get_lod_batch_ptr(ilod, ibat);
+		if (pLodBat) {
+			n = pLodBat->mTriNum;
+		}
+	}
+	return n;
+}
+
+xt_int3 sxModelData::get_lod_batch_tri_indices(const int ilod, const int ibat, const int itri) const {
+	if (ilod == 0) {
+		return get_batch_tri_indices(ibat, itri);
+	}
+	xt_int3 vidx;
+	vidx.fill(-1);
+	const Batch* pBat = get_batch_ptr(ibat);
+	const LodBatch* pLodBat = get_lod_batch_ptr(ilod, ibat);
+	if (pBat && pLodBat && itri >= 0 && itri < pLodBat->mTriNum) {
+		const LodInfo* pInfo = get_lod_info();
+		if (pBat->is_idx16()) {
+			const uint16_t* pIdx = reinterpret_cast<const uint16_t*>(XD_INCR_PTR(pInfo, pInfo->mIdx16Offs));
+			for (int i = 0; i < 3; ++i) {
+				vidx[i] = pBat->mMinIdx + pIdx[pLodBat->mIdxOrg + (itri * 3) + i];
+			}
+		} else {
+			const uint32_t* pIdx = reinterpret_cast<const uint32_t*>(XD_INCR_PTR(pInfo, pInfo->mIdx32Offs));
+			for (int i = 0; i < 3; ++i) {
+				vidx[i] = int32_t(pBat->mMinIdx + pIdx[pLodBat->mIdxOrg + (itri * 3) + i]);
+			}
+		}
+	}
+	return vidx;
+}
+
+int sxModelData::find_lod(const float maxErr) const {
+	int ilod = 0;
+	int nlod = get_lods_num();
+	for (int i = 1; i < nlod; ++i) {
+		if (get_lod_error(i) > maxErr) break;
+		ilod = i;
+	}
+	return ilod;
+}
+
 const sxModelData::TexInfo* sxModelData::get_tex_info(const int tid) const {
 	const TexInfo* pTex = nullptr;
 	if (mTexOffs && ck_tex_id(tid)) {
@@ -12371,54 +12613,342 @@ XD_NOINLINE int sxCollisionData::for_tris_in_range(const TriFunc func, const cxA
 	return ctx.mTriCnt;
 }
 
+#define XD_RAY_PKT_SIZE sxCollisionData::PACKET_SIZE
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#	define XD_RAY_PKT_SSE 1
+#	include <emmintrin.h>
+#else
+#	define XD_RAY_PKT_SSE 0
+#endif
+
+#define XD_RAY_PKT_TOL 1.0e-5f
+
+/* SoA segments; tests are conservative, exact per-ray tests confirm the candidates */
+struct sxRayPacket {
+	float mOrg[3][XD_RAY_PKT_SIZE];
+	float mDir[3][XD_RAY_PKT_SIZE];
+	float mInv[3][XD_RAY_PKT_SIZE];
+	float mOrgInv[3][XD_RAY_PKT_SIZE];
+	float mDirL1[XD_RAY_PKT_SIZE];
+	cxAABB mSegBBox[XD_RAY_PKT_SIZE];
+	float mPktMin[3];
+	float mPktMax[3];
+	float mTol;
+	uint32_t mMask;
+
+	void init(const cxLineSeg* pSegs, int n, const cxAABB& bbox) {
+		cxAABB pktBBox;
+		pktBBox.init();
+		mMask = 0;
+		for (int i = 0; i < n; ++i) {
+			mSegBBox[i].from_seg(pSegs[i]);
+			pktBBox.merge(mSegBBox[i]);
+			mMask |= 1U << i;
+		}
+		/* a lone segment only ever takes its own bbox test */
+		if (n < 2) return;
+		/* lanes past n only fill out the last group of 4 */
+		int nfill = nxCalc::min((n + 3) & ~3, XD_RAY_PKT_SIZE);
+		for (int i = 0; i < nfill; ++i) {
+			cxVec p0(0.0f);
+			cxVec dir(0.0f);
+			if (i < n) {
+				p0 = pSegs[i].get_pos0();
+				dir = pSegs[i].get_dir();
+			}
+			float o[3] = { p0.x, p0.y, p0.z };
+			float d[3] = { dir.x, dir.y, dir.z };
+			for (int j = 0; j < 3; ++j) {
+				mOrg[j][i] = o[j];
+				mDir[j][i] = d[j];
+				mInv[j][i] = d[j] != 0.0f ? 1.0f / d[j] : 1.0e30f;
+				mOrgInv[j][i] = o[j] * mInv[j][i];
+			}
+			mDirL1[i] = ::fabsf(d[0]) + ::fabsf(d[1]) + ::fabsf(d[2]);
+		}
+		pktBBox.get_min_pos().to_mem(mPktMin);
+		pktBBox.get_max_pos().to_mem(mPktMax);
+		/* scaled to the largest coordinate involved, absorbs rounding differences from the exact tests */
+		float absMax = nxCalc::max(bbox.get_min_pos().max_abs_elem(), bbox.get_max_pos().max_abs_elem());
+		for (int j = 0; j < 3; ++j) {
+			absMax = nxCalc::max(absMax, nxCalc::max(::fabsf(mPktMin[j]), ::fabsf(mPktMax[j])));
+		}
+		mTol = XD_RAY_PKT_TOL * (1.0f + absMax);
+		for (int j = 0; j < 3; ++j) {
+			mPktMin[j] -= mTol;
+			mPktMax[j] += mTol;
+		}
+	}
+
+	/* lanes of mask whose segments may cross the box */
+	uint32_t box_mask(const cxAABB& box, uint32_t mask) const {
+		if (mask & (mask - 1)) return slab_mask(box, mask);
+		/* a lone segment gets the bbox test it would get traced alone */
+		if (!mask) return 0;
+		int i = 0;
+		while (!(mask & (1U << i))) {
+			++i;
+		}
+		return mSegBBox[i].overlaps(box) ? mask : 0;
+	}
+
+	uint32_t slab_mask(const cxAABB& box, uint32_t mask) const {
+		cxVec bmin = box.get_min_pos();
+		cxVec bmax = box.get_max_pos();
+		if (mPktMin[0] > bmax.x || mPktMin[1] > bmax.y || mPktMin[2] > bmax.z) return 0;
+		if (mPktMax[0] < bmin.x || mPktMax[1] < bmin.y || mPktMax[2] < bmin.z) return 0;
+		float lo[3] = { bmin.x - mTol, bmin.y - mTol, bmin.z - mTol };
+		float hi[3] = { bmax.x + mTol, bmax.y + mTol, bmax.z + mTol };
+		uint32_t res = 0;
+#if XD_RAY_PKT_SSE
+		for (int c = 0; c < XD_RAY_PKT_SIZE; c += 4) {
+			if (!((mask >> c) & 0xF)) continue;
+			__m128 tmin = _mm_setzero_ps();
+			__m128 tmax = _mm_set1_ps(1.0f);
+			for (int j = 0; j < 3; ++j) {
+				__m128 inv = _mm_loadu_ps(&mInv[j][c]);
+				__m128 ofs = _mm_loadu_ps(&mOrgInv[j][c]);
+				__m128 t1 = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(lo[j]), inv), ofs);
+				__m128 t2 = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(hi[j]), inv), ofs);
+				tmin = _mm_max_ps(tmin, _mm_min_ps(t1, t2));
+				tmax = _mm_min_ps(tmax, _mm_max_ps(t1, t2));
+			}
+			res |= uint32_t(_mm_movemask_ps(_mm_cmple_ps(tmin, tmax))) << c;
+		}
+#else
+		for (int i = 0; i < XD_RAY_PKT_SIZE; ++i) {
+			if (!(mask & (1U << i))) continue;
+			float tmin = 0.0f;
+			float tmax = 1.0f;
+			for (int j = 0; j < 3; ++j) {
+				float t1 = lo[j] * mInv[j][i] - mOrgInv[j][i];
+				float t2 = hi[j] * mInv[j][i] - mOrgInv[j][i];
+				tmin = nxCalc::max(tmin, nxCalc::min(t1, t2));
+				tmax = nxCalc::min(tmax, nxCalc::max(t1, t2));
+			}
+			if (tmin <= tmax) {
+				res |= 1U << i;
+			}
+		}
+#endif
+		return res & mask;
+	}
+
+	/* passes segments that may cross the triangle from either side */
+	uint32_t tri_mask(const cxVec& v0, const cxVec& v1, const cxVec& v2, uint32_t mask) const {
+		if (!mask) return 0;
+		cxVec vtx[3] = { v0, v1, v2 };
+		cxVec edge[3] = { v1 - v0, v2 - v1, v0 - v2 };
+		cxVec n = nxVec::cross(edge[0], v2 - v0);
+		float nL1 = ::fabsf(n.x) + ::fabsf(n.y) + ::fabsf(n.z);
+		float eL1[3];
+		for (int k = 0; k < 3; ++k) {
+			eL1[k] = ::fabsf(edge[k].x) + ::fabsf(edge[k].y) + ::fabsf(edge[k].z);
+		}
+		uint32_t res = 0;
+#if XD_RAY_PKT_SSE
+		const __m128 absMsk = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+		const __m128 tol = _mm_set1_ps(XD_RAY_PKT_TOL);
+		const __m128 zero = _mm_setzero_ps();
+		for (int c = 0; c < XD_RAY_PKT_SIZE; c += 4) {
+			if (!((mask >> c) & 0xF)) continue;
+			__m128 dx = _mm_loadu_ps(&mDir[0][c]);
+			__m128 dy = _mm_loadu_ps(&mDir[1][c]);
+			__m128 dz = _mm_loadu_ps(&mDir[2][c]);
+			__m128 dL1 = _mm_loadu_ps(&mDirL1[c]);
+			__m128 ox = _mm_loadu_ps(&mOrg[0][c]);
+			__m128 oy = _mm_loadu_ps(&mOrg[1][c]);
+			__m128 oz = _mm_loadu_ps(&mOrg[2][c]);
+			__m128 pos = _mm_cmpge_ps(dL1, zero);
+			__m128 neg = pos;
+			__m128 plane = zero;
+			for (int k = 0; k < 3; ++k) {
+				__m128 vx = _mm_sub_ps(ox, _mm_set1_ps(vtx[k].x));
+				__m128 vy = _mm_sub_ps(oy, _mm_set1_ps(vtx[k].y));
+				__m128 vz = _mm_sub_ps(oz, _mm_set1_ps(vtx[k].z));
+				__m128 vL1 = _mm_add_ps(_mm_add_ps(_mm_and_ps(vx, absMsk), _mm_and_ps(vy, absMsk)), _mm_and_ps(vz, absMsk));
+				if (k == 0) {
+					__m128 d0 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, _mm_set1_ps(n.x)), _mm_mul_ps(vy, _mm_set1_ps(n.y))), _mm_mul_ps(vz, _mm_set1_ps(n.z)));
+					__m128 dn = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, _mm_set1_ps(n.x)), _mm_mul_ps(dy, _mm_set1_ps(n.y))), _mm_mul_ps(dz, _mm_set1_ps(n.z)));
+					__m128 d1 = _mm_add_ps(d0, dn);
+					__m128 tolP = _mm_mul_ps(_mm_mul_ps(_mm_add_ps(vL1, dL1), _mm_set1_ps(nL1)), tol);
+					plane = _mm_cmple_ps(_mm_mul_ps(d0, d1), zero);
+					plane = _mm_or_ps(plane, _mm_cmple_ps(_mm_and_ps(d0, absMsk), tolP));
+					plane = _mm_or_ps(plane, _mm_cmple_ps(_mm_and_ps(d1, absMsk), tolP));
+				}
+				__m128 cx = _mm_sub_ps(_mm_mul_ps(dy, vz), _mm_mul_ps(dz, vy));
+				__m128 cy = _mm_sub_ps(_mm_mul_ps(dz, vx), _mm_mul_ps(dx, vz));
+				__m128 cz = _mm_sub_ps(_mm_mul_ps(dx, vy), _mm_mul_ps(dy, vx));
+				__m128 t = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(edge[k].x)), _mm_mul_ps(cy, _mm_set1_ps(edge[k].y))), _mm_mul_ps(cz, _mm_set1_ps(edge[k].z)));
+				__m128 tolT = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(vL1, dL1), _mm_set1_ps(eL1[k])), tol);
+				pos = _mm_and_ps(pos, _mm_cmpge_ps(t, _mm_sub_ps(zero, tolT)));
+				neg = _mm_and_ps(neg, _mm_cmple_ps(t, tolT));
+			}
+			__m128 ok = _mm_and_ps(plane, _mm_or_ps(pos, neg));
+			res |= uint32_t(_mm_movemask_ps(ok)) << c;
+		}
+#else
+		for (int i = 0; i < XD_RAY_PKT_SIZE; ++i) {
+			if (!(mask & (1U << i))) continue;
+			cxVec dir(mDir[0][i], mDir[1][i], mDir[2][i]);
+			cxVec org(mOrg[0][i], mOrg[1][i], mOrg[2][i]);
+			bool pos = true;
+			bool neg = true;
+			bool plane = false;
+			for (int k = 0; k < 3; ++k) {
+				cxVec v = org - vtx[k];
+				float vL1 = ::fabsf(v.x) + ::fabsf(v.y) + ::fabsf(v.z);
+				if (k == 0) {
+					float d0 = v.dot(n);
+					float d1 = d0 + dir.dot(n);
+					float tolP = (vL1 + mDirL1[i]) * nL1 * XD_RAY_PKT_TOL;
+					plane = d0*d1 <= 0.0f || ::fabsf(d0) <= tolP || ::fabsf(d1) <= tolP;
+				}
+				float t = nxVec::cross(dir, v).dot(edge[k]);
+				float tolT = vL1 * mDirL1[i] * eL1[k] * XD_RAY_PKT_TOL;
+				pos = pos && t >= -tolT;
+				neg = neg && t <= tolT;
+			}
+			if (plane && (pos || neg)) {
+				res |= 1U << i;
+			}
+		}
+#endif
+		return res & mask;
+	}
+};
+
+static int ray_pkt_stream_cmp(const void* pA, const void* pB) {
+	const uint32_t* pItemA = (const uint32_t*)pA;
+	const uint32_t* pItemB = (const uint32_t*)pB;
+	if (pItemA[0] != pItemB[0]) {
+		return pItemA[0] < pItemB[0] ? -1 : 1;
+	}
+	return int(pItemA[1]) - int(pItemB[1]);
+}
+
+static uint32_t ray_pkt_morton_spread(uint32_t x) {
+	x &= 0x3FF;
+	x = (x | (x << 16)) & 0x030000FF;
+	x = (x | (x << 8)) & 0x0300F00F;
+	x = (x | (x << 4)) & 0x030C30C3;
+	x = (x | (x << 2)) & 0x09249249;
+	return x;
+}
+
+/* pSort: nseg (key, segment index) pairs ordered by direction octant, then by Morton code of the origin in bbox */
+static void ray_pkt_stream_sort(const cxLineSeg* pSegs, const int nseg, const cxAABB& bbox, int32_t* pSort) {
+	cxVec bbMin = bbox.get_min_pos();
+	cxVec bbSize = bbox.get_size_vec();
+	float sx = nxCalc::rcp0(bbSize.x) * 1023.0f;
+	float sy = nxCalc::rcp0(bbSize.y) * 1023.0f;
+	float sz = nxCalc::rcp0(bbSize.z) * 1023.0f;
+	for (int i = 0; i < nseg; ++i) {
+		cxVec org = pSegs[i].get_pos0();
+		cxVec dir = pSegs[i].get_dir();
+		uint32_t oct = (dir.x < 0.0f ? 1 : 0) | (dir.y < 0.0f ? 2 : 0) | (dir.z < 0.0f ? 4 : 0);
+		uint32_t ix = (uint32_t)nxCalc::clamp((org.x - bbMin.x) * sx, 0.0f, 1023.0f);
+		uint32_t iy = (uint32_t)nxCalc::clamp((org.y - bbMin.y) * sy, 0.0f, 1023.0f);
+		uint32_t iz = (uint32_t)nxCalc::clamp((org.z - bbMin.z) * sz, 0.0f, 1023.0f);
+		uint32_t code = ray_pkt_morton_spread(ix) | (ray_pkt_morton_spread(iy) << 1) | (ray_pkt_morton_spread(iz) << 2);
+		pSort[i * 2] = (int32_t)((oct << 29) | (code >> 1));
+		pSort[i * 2 + 1] = i;
+	}
+	::qsort(pSort, nseg, sizeof(int32_t) * 2, ray_pkt_stream_cmp);
+}
+
+/* number of sorted segments from org on that make up the next packet, which never mixes direction octants */
+static int ray_pkt_stream_next(const int32_t* pSort, const int org, const int nseg, const int nmax) {
+	uint32_t oct = uint32_t(pSort[org * 2]) >> 29;
+	int nlim = nxCalc::min(nseg - org, nmax);
+	int n = 1;
+	while (n < nlim && (uint32_t(pSort[(org + n) * 2]) >> 29) == oct) {
+		++n;
+	}
+	return n;
+}
+
+/* segments traced together down the BVH: packet slab and triangle tests cull, each segment's own bbox gate and
+   exact intersection decide, so every segment sees the same crossings as when traced alone */
 struct sxColHitCtx {
-	cxAABB mBBox;
-	cxLineSeg mSeg;
+	sxRayPacket mPkt;
+	void* mpFuncWk[sxCollisionData::PACKET_SIZE];
+	const cxLineSeg* mpSegs;
 	const sxCollisionData* mpCol;
 	const sxCollisionData::HitFunc* mpFunc;
-	void* mpFuncWk;
+	int mSegNum;
 	int mHitCnt;
-	bool mContinue;
 
-	void for_pol_tris(const int ipol) {
+	void init(const sxCollisionData* pCol, const sxCollisionData::HitFunc* pFunc, const cxLineSeg* pSegs, const int nseg) {
+		mpCol = pCol;
+		mpFunc = pFunc;
+		mpSegs = pSegs;
+		mSegNum = nxCalc::min(nseg, int(sxCollisionData::PACKET_SIZE));
+		mHitCnt = 0;
+		mPkt.init(pSegs, mSegNum, pCol->mBBox);
+	}
+
+	void for_pol_tris(const int ipol, uint32_t mask) {
 		cxAABB polBBox = mpCol->get_pol_bbox(ipol);
-		if (mBBox.overlaps(polBBox) && polBBox.seg_ck(mSeg)) {
-			sxCollisionData::Tri tri;
-			const cxVec* pPnts = reinterpret_cast<const cxVec*>(XD_INCR_PTR(mpCol, mpCol->mPntOffs));
-			int ipnt[3];
-			tri.ipol = ipol;
-			tri.nrm = mpCol->get_pol_normal(ipol);
-			int ntris = mpCol->get_pol_num_tris(ipol);
-			for (int i = 0; i < ntris; ++i) {
-				tri.itri = i;
-				for (int j = 0; j < 3; ++j) {
-					ipnt[j] = mpCol->get_pol_tri_pnt_idx(ipol, i, j);
-				}
-				for (int j = 0; j < 3; ++j) {
-					tri.vtx[j] = pPnts[ipnt[j]];
-				}
+		uint32_t polMask = 0;
+		for (int i = 0; i < mSegNum; ++i) {
+			if ((mask & (1U << i)) && mPkt.mSegBBox[i].overlaps(polBBox) && polBBox.seg_ck(mpSegs[i])) {
+				polMask |= 1U << i;
+			}
+		}
+		if (!polMask) return;
+		sxCollisionData::Tri tri;
+		const cxVec* pPnts = reinterpret_cast<const cxVec*>(XD_INCR_PTR(mpCol, mpCol->mPntOffs));
+		tri.ipol = ipol;
+		tri.nrm = mpCol->get_pol_normal(ipol);
+		int ntris = mpCol->get_pol_num_tris(ipol);
+		for (int i = 0; i < ntris; ++i) {
+			tri.itri = i;
+			for (int j = 0; j < 3; ++j) {
+				tri.vtx[j] = pPnts[mpCol->get_pol_tri_pnt_idx(ipol, i, j)];
+			}
+			uint32_t triMask = (polMask & (polMask - 1)) ? mPkt.tri_mask(tri.vtx[0], tri.vtx[1], tri.vtx[2], polMask) : polMask;
+			for (int j = 0; j < mSegNum; ++j) {
+				if (!(triMask & (1U << j))) continue;
+				cxVec p0 = mpSegs[j].get_pos0();
 				cxVec hitPos;
-				bool hitFlg = nxGeom::seg_tri_intersect_cw(mSeg.get_pos0(), mSeg.get_pos1(), tri.vtx[0], tri.vtx[1], tri.vtx[2], &hitPos, &tri.nrm);
-				if (hitFlg) {
-					float dist = nxVec::dist(mSeg.get_pos0(), hitPos);
-					mContinue = (*mpFunc)(*mpCol, tri, hitPos, dist, mpFuncWk);
+				if (nxGeom::seg_tri_intersect_cw(p0, mpSegs[j].get_pos1(), tri.vtx[0], tri.vtx[1], tri.vtx[2], &hitPos, &tri.nrm)) {
+					float dist = nxVec::dist(p0, hitPos);
 					++mHitCnt;
+					if (!(*mpFunc)(*mpCol, tri, hitPos, dist, mpFuncWk[j])) {
+						mPkt.mMask &= ~(1U << j);
+						polMask &= ~(1U << j);
+					}
 				}
-				if (!mContinue) break;
 			}
+			if (!polMask) break;
 		}
 	}
 
-	void for_bvh_tris(const int inode) {
-		if (!mContinue) return;
+	void for_bvh_tris(const int inode, uint32_t mask) {
+		mask &= mPkt.mMask;
+		if (!mask) return;
 		const cxAABB* pNodeBBox = reinterpret_cast<const cxAABB*>(XD_INCR_PTR(mpCol, mpCol->mBVHBBoxOffs)) + inode;
-		if (mBBox.overlaps(*pNodeBBox)) {
+		mask = mPkt.box_mask(*pNodeBBox, mask);
+		if (mask) {
 			const sxCollisionData::BVHNodeInfo* pNodeInfo = reinterpret_cast<const sxCollisionData::BVHNodeInfo*>(XD_INCR_PTR(mpCol, mpCol->mBVHInfoOffs)) + inode;
 			if (pNodeInfo->is_leaf()) {
-				for_pol_tris(pNodeInfo->get_pol_id());
+				for_pol_tris(pNodeInfo->get_pol_id(), mask);
 			} else {
-				for_bvh_tris(pNodeInfo->mLeft);
-				for_bvh_tris(pNodeInfo->mRight);
+				for_bvh_tris(pNodeInfo->mLeft, mask);
+				for_bvh_tris(pNodeInfo->mRight, mask);
+			}
+		}
+	}
+
+	void exec() {
+		if (mpCol->mBVHBBoxOffs && mpCol->mBVHInfoOffs) {
+			for_bvh_tris(0, mPkt.mMask);
+		} else {
+			for (uint32_t i = 0; i < mpCol->mPolNum; ++i) {
+				for_pol_tris(i, mPkt.mMask);
+				if (!mPkt.mMask) break;
 			}
 		}
 	}
@@ -12426,21 +12956,9 @@ struct sxColHitCtx {
 
 XD_NOINLINE int sxCollisionData::hit_check(const HitFunc func, const cxLineSeg& seg, void* pWk) {
 	sxColHitCtx ctx;
-	ctx.mSeg = seg;
-	ctx.mBBox.from_seg(seg);
-	ctx.mpCol = this;
-	ctx.mpFunc = &func;
-	ctx.mpFuncWk = pWk;
-	ctx.mContinue = true;
-	ctx.mHitCnt = 0;
-	if (mBVHBBoxOffs && mBVHInfoOffs) {
-		ctx.for_bvh_tris(0);
-	} else {
-		for (uint32_t i = 0; i < mPolNum; ++i) {
-			ctx.for_pol_tris(i);
-			if (!ctx.mContinue) break;
-		}
-	}
+	ctx.init(this, &func, &seg, 1);
+	ctx.mpFuncWk[0] = pWk;
+	ctx.exec();
 	return ctx.mHitCnt;
 }
 
@@ -12462,15 +12980,57 @@ static bool xcol_nearest_hit_func(const sxCollisionData& col, const sxCollisionD
 	return true;
 }
 
+static void xcol_nearest_hit_init(sxCollisionData::NearestHit* pHit, const cxLineSeg& seg) {
+	pHit->pos = seg.get_pos0();
+	pHit->nrm.zero();
+	pHit->dist = 0.0f;
+	pHit->count = 0;
+}
+
 sxCollisionData::NearestHit sxCollisionData::nearest_hit(const cxLineSeg& seg) {
 	NearestHit hit;
-	hit.pos = seg.get_pos0();
-	hit.dist = 0.0f;
-	hit.count = 0;
+	xcol_nearest_hit_init(&hit, seg);
 	sxCollisionData::hit_check(xcol_nearest_hit_func, seg, &hit);
 	return hit;
 }
 
+void sxCollisionData::nearest_hit_stream(const cxLineSeg* pSegs, NearestHit* pHits, const int nseg, int32_t* pWk) const {
+	if (!pSegs || !pHits || nseg <= 0) return;
+	for (int i = 0; i < nseg; ++i) {
+		xcol_nearest_hit_init(&pHits[i], pSegs[i]);
+	}
+	const HitFunc func = xcol_nearest_hit_func;
+	sxColHitCtx ctx;
+	int32_t* pSort = pWk ? pWk : (int32_t*)nxCore::mem_alloc(nseg * 2 * sizeof(int32_t), "xCol:StreamWk");
+	if (!pSort) {
+		for (int i = 0; i < nseg; i += PACKET_SIZE) {
+			ctx.init(this, &func, &pSegs[i], nseg - i);
+			for (int j = 0; j < ctx.mSegNum; ++j) {
+				ctx.mpFuncWk[j] = &pHits[i + j];
+			}
+			ctx.exec();
+		}
+		return;
+	}
+	ray_pkt_stream_sort(pSegs, nseg, mBBox, pSort);
+	cxLineSeg segs[PACKET_SIZE];
+	int i = 0;
+	while (i < nseg) {
+		int n = ray_pkt_stream_next(pSort, i, nseg, PACKET_SIZE);
+		for (int j = 0; j < n; ++j) {
+			int iseg = pSort[(i + j) * 2 + 1];
+			segs[j] = pSegs[iseg];
+			ctx.mpFuncWk[j] = &pHits[iseg];
+		}
+		ctx.init(this, &func, segs, n);
+		ctx.exec();
+		i += n;
+	}
+	if (pSort != pWk) {
+		nxCore::mem_free(pSort);
+	}
+}
+
 void sxCollisionData::dump_pol_geo(FILE* pOut) const {
 	if (!pOut) return;
 	if (!mPntOffs) return;
@@ -13062,6 +13622,14 @@ void cxModelWork::update_bounds() {
 	} else if (mpData->is_static()) {
 		mBoundsValid = true;
 	}
+	if (mBoundsValid && mpBatBBoxes && !mpData->is_static()) {
+		update_batch_box_blocks();
+	}
+}
+
+void cxModelWork::update_batch_box_blocks() {
+	if (!mpData || !mpBatBBoxes || !mpBatBoxBlks) return;
+	sxAABB8::pack(mpBatBoxBlks, mpBatBBoxes, mpData->mBatNum);
 }
 
 void cxModelWork::frustum_cull(const cxFrustum* pFst, const bool precise) {
@@ -13070,6 +13638,19 @@ void cxModelWork::frustum_cull(const cxFrustum* pFst, const bool precise) {
 	::memset(mpCullBits, 0, XD_BIT_ARY_SIZE(uint8_t, nbat));
 	if (!pFst) return;
 	if (!mBoundsValid) return;
+	if (mpBatBoxBlks) {
+		pFst->cull_boxes(mpBatBoxBlks, nbat, mpCullBits);
+		if (precise) {
+			for (int i = 0; i < nbat; ++i) {
+				if (!XD_BIT_ARY_CK(uint32_t, mpCullBits, i)) {
+					if (!pFst->overlaps(mpBatBBoxes[i])) {
+						XD_BIT_ARY_ST(uint32_t, mpCullBits, i);
+					}
+				}
+			}
+		}
+		return;
+	}
 	for (int i = 0; i < nbat; ++i) {
 		cxAABB batBB = mpBatBBoxes[i];
 		bool cull = pFst->cull(batBB);
@@ -13104,6 +13685,109 @@ bool cxModelWork::calc_batch_visibility(const cxFrustum* pFst, const int ibat, c
 	return visible;
 }
 
+int cxModelWork::cull_clusters(const int ibat, const cxFrustum* pFst, const cxVec* pViewPos, uint32_t* pVisBits) const {
+	if (!mpData) return 0;
+	int ncls = mpData->get_batch_clusters_num(ibat);
+	const sxModelData::Cluster* pCls = mpData->get_batch_clusters(ibat);
+	if (!pCls || ncls <= 0) return 0;
+	if (pVisBits) {
+		::memset(pVisBits, 0, XD_BIT_ARY_SIZE(uint32_t, ncls) * sizeof(uint32_t));
+	}
+	bool skinned = mpData->has_skin();
+	if (skinned) {
+		/* cluster bounds are in rest pose */
+		if (pVisBits) {
+			for (int i = 0; i < ncls; ++i) {
+				XD_BIT_ARY_ST(uint32_t, pVisBits, i);
+			}
+		}
+		return ncls;
+	}
+	cxMtx wm;
+	wm.identity();
+	if (mpWorldXform) {
+		wm = nxMtx::mtx_from_xmtx(*mpWorldXform);
+	}
+	float rscl = nxCalc::max(wm.get_row_vec(0).mag(), wm.get_row_vec(1).mag(), wm.get_row_vec(2).mag());
+	bool coneCull = pViewPos != nullptr;
+	const sxModelData::Material* pMtl = mpData->get_batch_material(ibat);
+	if (pMtl && pMtl->mFlags.dblSided) {
+		coneCull = false;
+	}
+	cxVec viewPos(0.0f);
+	if (coneCull) {
+		/* facing is affine-invariant, so the cone test runs in model space unless the transform mirrors */
+		float det = wm.get_row_vec(0).dot(nxVec::cross(wm.get_row_vec(1), wm.get_row_vec(2)));
+		if (det > 0.0f) {
+			viewPos = wm.get_inverted().calc_pnt(*pViewPos);
+		} else {
+			coneCull = false;
+		}
+	}
+	int nvis = 0;
+	for (int i = 0; i < ncls; ++i) {
+		bool vis = true;
+		if (pFst) {
+			cxSphere sph = pCls[i].get_sphere();
+			vis = !pFst->cull(cxSphere(wm.calc_pnt(sph.get_center()), sph.get_radius() * rscl));
+		}
+		if (vis && coneCull) {
+			vis = !pCls[i].is_backfacing(viewPos);
+		}
+		if (vis) {
+			++nvis;
+			if (pVisBits) {
+				XD_BIT_ARY_ST(uint32_t, pVisBits, i);
+			}
+		}
+	}
+	return nvis;
+}
+
+int cxModelWork::get_cluster_ranges(const int ibat, const uint32_t* pVisBits, xt_int2* pRanges) const {
+	if (!mpData) return 0;
+	int ncls = mpData->get_batch_clusters_num(ibat);
+	const sxModelData::Cluster* pCls = mpData->get_batch_clusters(ibat);
+	if (!pCls || ncls <= 0) return 0;
+	int nrng = 0;
+	int org = -1;
+	int end = -1;
+	for (int i = 0; i < ncls; ++i) {
+		if (pVisBits && !XD_BIT_ARY_CK(uint32_t, pVisBits, i)) continue;
+		if (pCls[i].mTriOrg != end) {
+			if (org >= 0) {
+				if (pRanges) {
+					pRanges[nrng].set(org, end - org);
+				}
+				++nrng;
+			}
+			org = pCls[i].mTriOrg;
+		}
+		end = pCls[i].mTriOrg + pCls[i].mTriNum;
+	}
+	if (org >= 0) {
+		if (pRanges) {
+			pRanges[nrng].set(org, end - org);
+		}
+		++nrng;
+	}
+	return nrng;
+}
+
+int cxModelWork::select_lod(const cxVec& viewPos, const float fovy, const float viewHeight, const float maxPixErr) const {
+	if (!mpData) return 0;
+	if (mpData->get_lods_num() < 2) return 0;
+	float dist = nxVec::dist(viewPos, mWorldBBox.get_center()) - mWorldBBox.get_size_vec().mag()*0.5f;
+	if (dist <= 0.0f) return 0;
+	float scl = 1.0f;
+	if (mpWorldXform && !mpData->has_skin()) {
+		cxMtx wm = nxMtx::mtx_from_xmtx(*mpWorldXform);
+		scl = nxCalc::max(wm.get_row_vec(0).mag(), wm.get_row_vec(1).mag(), wm.get_row_vec(2).mag());
+	}
+	float pixPerUnit = viewHeight / (2.0f * ::tanf(fovy * 0.5f) * dist);
+	return mpData->find_lod(maxPixErr / nxCalc::max(pixPerUnit * scl, 1e-12f));
+}
+
 cxModelWork* cxModelWork::create(sxModelData* pMdl, const size_t paramMemSize, const size_t extMemSize) {
 	if (!pMdl) return nullptr;
 	cxModelWork* pWk = nullptr;
@@ -13123,6 +13807,9 @@ cxModelWork* cxModelWork::create(sxModelData* pMdl, const size_t paramMemSize, c
 	size_t offsBatBBs = pMdl->is_static() ? 0 : size;
 	int nbat = pMdl->mBatNum;
 	size += nbat * sizeof(cxAABB);
+	size = XD_ALIGN(size, 0x20);
+	size_t offsBoxBlks = size;
+	size += sxAABB8::calc_blocks_num(nbat) * sizeof(sxAABB8);
 	size_t offsCull = size;
 	size += XD_ALIGN(XD_BIT_ARY_SIZE(uint8_t, nbat), 0x10);
 	int nmtl = pMdl->mMtlNum;
@@ -13165,6 +13852,8 @@ cxModelWork* cxModelWork::create(sxModelData* pMdl, const size_t paramMemSize, c
 			pWk->mpBatBBoxes = pMdl->mBatOffs ? reinterpret_cast<cxAABB*>(XD_INCR_PTR(pMdl, pMdl->mBatOffs)) : nullptr;
 			pWk->mBoundsValid = true;
 		}
+		pWk->mpBatBoxBlks = nbat > 0 ? (sxAABB8*)XD_INCR_PTR(pWk, offsBoxBlks) : nullptr;
+		pWk->update_batch_box_blocks();
 		pWk->mpCullBits = offsCull ? (uint32_t*)XD_INCR_PTR(pWk, offsCull) : nullptr;
 		pWk->mpHideBits = offsHide ? (uint32_t*)XD_INCR_PTR(pWk, offsHide) : nullptr;
 		pWk->mpParamMem = offsParam ? XD_INCR_PTR(pWk, offsParam) : nullptr;
@@ -13184,6 +13873,907 @@ void cxModelWork::destroy(cxModelWork* pWk) {
 	}
 }
 
+/* copy of pMdl (GPU work cleared) with a zeroed section of secSize bytes registered as kind in the ext list,
+   an existing section of the same kind is dropped from the list */
+static sxModelData* mdl_copy_with_ext(const sxModelData* pMdl, const uint32_t kind, const size_t secSize, void** ppSec) {
+	const sxData::ExtList* pOldExt = pMdl->get_ext_list();
+	int next = 1;
+	if (pOldExt) {
+		for (uint32_t i = 0; i < pOldExt->num; ++i) {
+			if (pOldExt->lst[i].kind != kind) ++next;
+		}
+	}
+	size_t secOffs = XD_ALIGN(pMdl->mFileSize, 0x10);
+	size_t extOffs = XD_ALIGN(secOffs + secSize, 0x10);
+	size_t fileSize = extOffs + sizeof(sxData::ExtList) + (next - 1) * sizeof(sxData::ExtExtry);
+	size_t pathLen = pMdl->mFilePathLen;
+	size_t memSize = fileSize + (pathLen ? pathLen + 1 : 0);
+	void* pMem = nxCore::mem_alloc(memSize, s_pXDataMemTag);
+	sxModelData* pNew = nullptr;
+	if (pMem) {
+		::memset(pMem, 0, memSize);
+		::memcpy(pMem, pMdl, pMdl->mFileSize);
+		pNew = (sxModelData*)pMem;
+		::memset(pNew->mGPUWk, 0, sizeof(pNew->mGPUWk));
+		pNew->clear_tex_wk();
+		sxData::ExtList* pExt = (sxData::ExtList*)XD_INCR_PTR(pNew, extOffs);
+		pExt->num = 0;
+		if (pOldExt) {
+			for (uint32_t i = 0; i < pOldExt->num; ++i) {
+				if (pOldExt->lst[i].kind != kind) {
+					pExt->lst[pExt->num++] = pOldExt->lst[i];
+				}
+			}
+		}
+		pExt->lst[pExt->num].kind = kind;
+		pExt->lst[pExt->num].offs = uint32_t(secOffs);
+		++pExt->num;
+		pNew->mOffsExt = uint32_t(extOffs);
+		pNew->mFileSize = uint32_t(fileSize);
+		if (pathLen) {
+			::memcpy(XD_INCR_PTR(pNew, fileSize), pMdl->get_file_path(), pathLen);
+		}
+		if (ppSec) {
+			*ppSec = XD_INCR_PTR(pNew, secOffs);
+		}
+	}
+	return pNew;
+}
+
+namespace nxCluster {
+
+static const float s_coneWeight = 0.5f;
+
+static void calc_bounds(sxModelData::Cluster* pCls, const uint32_t* pIdx, const cxVec* pPnts, const cxVec* pTriNrm) {
+	const uint32_t* pTriIdx = pIdx + pCls->mTriOrg*3;
+	int ntri = pCls->mTriNum;
+	cxAABB bbox;
+	bbox.init();
+	for (int i = 0; i < ntri*3; ++i) {
+		bbox.add_pnt(pPnts[pTriIdx[i]]);
+	}
+	cxVec c = bbox.get_center();
+	float r2 = 0.0f;
+	for (int i = 0; i < ntri*3; ++i) {
+		r2 = nxCalc::max(r2, (pPnts[pTriIdx[i]] - c).mag2());
+	}
+	pCls->mCenter.set(c.x, c.y, c.z);
+	pCls->mRadius = ::sqrtf(r2);
+	cxVec nsum(0.0f);
+	const cxVec* pNrm = pTriNrm + pCls->mTriOrg;
+	for (int i = 0; i < ntri; ++i) {
+		nsum += pNrm[i];
+	}
+	cxVec axis = nsum.get_normalized();
+	float cmin = axis.mag2() > 0.0f ? 1.0f : -1.0f;
+	for (int i = 0; i < ntri; ++i) {
+		if (pNrm[i].mag2() > 0.0f) {
+			cmin = nxCalc::min(cmin, pNrm[i].dot(axis));
+		}
+	}
+	pCls->mConeAxis.set(axis.x, axis.y, axis.z);
+	pCls->mConeCos = cmin;
+}
+
+// Greedy growth: a cluster takes the adjacent triangle adding the fewest new points,
+// ties broken by distance to the cluster centroid weighted by normal deviation.
+int build(sxModelData::Cluster* pCls, uint32_t* pIdx, const int ntri, const cxVec* pPnts, const int npnt, const int maxVtx, const int maxTri) {
+	if (!pCls || !pIdx || !pPnts || ntri <= 0 || npnt <= 0) return 0;
+	for (int i = 0; i < ntri*3; ++i) {
+		if (pIdx[i] >= uint32_t(npnt)) return 0;
+	}
+	int vlim = nxCalc::clamp(maxVtx, 3, 0xFFFF);
+	int tlim = nxCalc::clamp(maxTri, 1, 0xFFFF);
+	size_t memSize = XD_ALIGN((npnt + 1) * sizeof(int32_t), 0x10); /* adjacency origins */
+	memSize += XD_ALIGN(ntri * 3 * sizeof(int32_t), 0x10); /* adjacent triangles */
+	memSize += XD_ALIGN(npnt * sizeof(int32_t), 0x10); /* cluster stamps */
+	memSize += XD_ALIGN(npnt * sizeof(int32_t), 0x10); /* triangles left per point */
+	memSize += XD_ALIGN(vlim * sizeof(int32_t), 0x10); /* cluster points */
+	memSize += XD_ALIGN(ntri * 3 * sizeof(uint32_t), 0x10); /* output */
+	memSize += XD_ALIGN(ntri, 0x10); /* done flags */
+	memSize += ntri * sizeof(cxVec) * 4; /* centroids, normals (source and output order) */
+	void* pMem = nxCore::mem_alloc(memSize, "xClsWk");
+	if (!pMem) return 0;
+	uint8_t* pTop = (uint8_t*)pMem;
+	int32_t* pAdjOrg = (int32_t*)pTop;
+	pTop += XD_ALIGN((npnt + 1) * sizeof(int32_t), 0x10);
+	int32_t* pAdjTri = (int32_t*)pTop;
+	pTop += XD_ALIGN(ntri * 3 * sizeof(int32_t), 0x10);
+	int32_t* pStamp = (int32_t*)pTop;
+	pTop += XD_ALIGN(npnt * sizeof(int32_t), 0x10);
+	int32_t* pLive = (int32_t*)pTop;
+	pTop += XD_ALIGN(npnt * sizeof(int32_t), 0x10);
+	int32_t* pClsVtx = (int32_t*)pTop;
+	pTop += XD_ALIGN(vlim * sizeof(int32_t), 0x10);
+	uint32_t* pDst = (uint32_t*)pTop;
+	pTop += XD_ALIGN(ntri * 3 * sizeof(uint32_t), 0x10);
+	uint8_t* pDone = pTop;
+	pTop += XD_ALIGN(ntri, 0x10);
+	cxVec* pCtr = (cxVec*)pTop;
+	cxVec* pNrm = pCtr + ntri;
+	cxVec* pDstNrm = pNrm + ntri;
+
+	::memset(pAdjOrg, 0, (npnt + 1) * sizeof(int32_t));
+	for (int i = 0; i < ntri*3; ++i) {
+		++pAdjOrg[pIdx[i] + 1];
+	}
+	for (int i = 0; i < npnt; ++i) {
+		pAdjOrg[i + 1] += pAdjOrg[i];
+		pStamp[i] = pAdjOrg[i];
+	}
+	for (int i = 0; i < ntri; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			pAdjTri[pStamp[pIdx[i*3 + j]]++] = i;
+		}
+		cxVec v0 = pPnts[pIdx[i*3]];
+		cxVec v1 = pPnts[pIdx[i*3 + 1]];
+		cxVec v2 = pPnts[pIdx[i*3 + 2]];
+		pCtr[i] = (v0 + v1 + v2) / 3.0f;
+		pNrm[i] = nxGeom::tri_normal_cw(v0, v1, v2);
+	}
+	for (int i = 0; i < npnt; ++i) {
+		pStamp[i] = -1;
+		pLive[i] = pAdjOrg[i + 1] - pAdjOrg[i];
+	}
+	::memset(pDone, 0, ntri);
+
+	int ncls = 0;
+	int nout = 0;
+	int cursor = 0;
+	int seed = -1;
+	while (nout < ntri) {
+		if (seed < 0) {
+			while (pDone[cursor]) ++cursor;
+			seed = cursor;
+		}
+		sxModelData::Cluster* pDstCls = &pCls[ncls];
+		pDstCls->mTriOrg = nout;
+		int nvtx = 0;
+		int ntris = 0;
+		cxVec csum(0.0f);
+		cxVec nsum(0.0f);
+		cxVec cc(0.0f);
+		int itri = seed;
+		while (itri >= 0) {
+			pDone[itri] = 1;
+			for (int j = 0; j < 3; ++j) {
+				uint32_t vidx = pIdx[itri*3 + j];
+				pDst[nout*3 + j] = vidx;
+				--pLive[vidx];
+				if (pStamp[vidx] != ncls) {
+					pStamp[vidx] = ncls;
+					pClsVtx[nvtx++] = int32_t(vidx);
+				}
+			}
+			pDstNrm[nout] = pNrm[itri];
+			++nout;
+			++ntris;
+			csum += pCtr[itri];
+			nsum += pNrm[itri];
+			cc = csum / float(ntris);
+			if (ntris >= tlim) break;
+			cxVec cn = nsum.get_normalized();
+			itri = -1;
+			int bestNew = 4;
+			float bestScore = 0.0f;
+			for (int i = 0; i < nvtx; ++i) {
+				int vidx = pClsVtx[i];
+				if (pLive[vidx] <= 0) continue;
+				for (int j = pAdjOrg[vidx]; j < pAdjOrg[vidx + 1]; ++j) {
+					int t = pAdjTri[j];
+					if (pDone[t]) continue;
+					int nnew = 0;
+					for (int k = 0; k < 3; ++k) {
+						nnew += pStamp[pIdx[t*3 + k]] != ncls ? 1 : 0;
+					}
+					if (nvtx + nnew > vlim || nnew > bestNew) continue;
+					float score = (pCtr[t] - cc).mag2() * (1.0f + s_coneWeight*(1.0f - pNrm[t].dot(cn)));
+					if (nnew < bestNew || score < bestScore) {
+						itri = t;
+						bestNew = nnew;
+						bestScore = score;
+					}
+				}
+			}
+		}
+		pDstCls->mTriNum = uint16_t(ntris);
+		pDstCls->mVtxNum = uint16_t(nvtx);
+		/* continue next to the closed cluster */
+		seed = -1;
+		float seedDist = 0.0f;
+		for (int i = 0; i < nvtx; ++i) {
+			int vidx = pClsVtx[i];
+			if (pLive[vidx] <= 0) continue;
+			for (int j = pAdjOrg[vidx]; j < pAdjOrg[vidx + 1]; ++j) {
+				int t = pAdjTri[j];
+				if (pDone[t]) continue;
+				float d = (pCtr[t] - cc).mag2();
+				if (seed < 0 || d < seedDist) {
+					seed = t;
+					seedDist = d;
+				}
+			}
+		}
+		++ncls;
+	}
+	::memcpy(pIdx, pDst, ntri * 3 * sizeof(uint32_t));
+	for (int i = 0; i < ncls; ++i) {
+		calc_bounds(&pCls[i], pIdx, pPnts, pDstNrm);
+	}
+	nxCore::mem_free(pMem);
+	return ncls;
+}
+
+sxModelData* build_model(const sxModelData* pMdl, const int maxVtx, const int maxTri) {
+	if (!pMdl) return nullptr;
+	int nbat = int(pMdl->mBatNum);
+	if (nbat <= 0) return nullptr;
+	int ntriTotal = 0;
+	int maxBatPnt = 0;
+	for (int i = 0; i < nbat; ++i) {
+		const sxModelData::Batch* pBat = pMdl->get_batch_ptr(i);
+		ntriTotal += pBat->mTriNum;
+		maxBatPnt = nxCalc::max(maxBatPnt, pBat->mMaxIdx - pBat->mMinIdx + 1);
+	}
+	if (ntriTotal <= 0) return nullptr;
+	sxModelData::Cluster* pCls = (sxModelData::Cluster*)nxCore::mem_alloc(ntriTotal * sizeof(sxModelData::Cluster), "xClsWk:Cls");
+	uint32_t* pIdx = (uint32_t*)nxCore::mem_alloc(ntriTotal * 3 * sizeof(uint32_t), "xClsWk:Idx");
+	cxVec* pPnts = (cxVec*)nxCore::mem_alloc(maxBatPnt * sizeof(cxVec), "xClsWk:Pnts");
+	int32_t* pBatOrg = (int32_t*)nxCore::mem_alloc((nbat + 1) * sizeof(int32_t), "xClsWk:Org");
+	bool ok = pCls && pIdx && pPnts && pBatOrg;
+	int ncls = 0;
+	int triOrg = 0;
+	for (int i = 0; ok && i < nbat; ++i) {
+		const sxModelData::Batch* pBat = pMdl->get_batch_ptr(i);
+		pBatOrg[i] = ncls;
+		int ntri = pBat->mTriNum;
+		if (ntri <= 0) continue;
+		int npnt = pBat->mMaxIdx - pBat->mMinIdx + 1;
+		for (int j = 0; j < npnt; ++j) {
+			pPnts[j] = pMdl->get_pnt_pos(pBat->mMinIdx + j);
+		}
+		uint32_t* pBatIdx = pIdx + triOrg*3;
+		for (int j = 0; j < ntri; ++j) {
+			xt_int3 tri = pMdl->get_batch_tri_indices(i, j);
+			for (int k = 0; k < 3; ++k) {
+				pBatIdx[j*3 + k] = uint32_t(tri[k] - pBat->mMinIdx);
+			}
+		}
+		int n = build(pCls + ncls, pBatIdx, ntri, pPnts, npnt, maxVtx, maxTri);
+		ok = n > 0;
+		ncls += n;
+		triOrg += ntri;
+	}
+	sxModelData* pNew = nullptr;
+	if (ok) {
+		pBatOrg[nbat] = ncls;
+		size_t infoSize = XD_ALIGN(sizeof(sxModelData::ClusterInfo) + nbat * sizeof(int32_t), 0x10);
+		size_t clsSize = ncls * sizeof(sxModelData::Cluster);
+		void* pSec = nullptr;
+		pNew = mdl_copy_with_ext(pMdl, sxModelData::CLUSTERS_EXT, infoSize + clsSize, &pSec);
+		if (pNew) {
+			uint16_t* pIdx16 = pNew->mIdx16Offs ? (uint16_t*)XD_INCR_PTR(pNew, pNew->mIdx16Offs) : nullptr;
+			uint32_t* pIdx32 = pNew->mIdx32Offs ? (uint32_t*)XD_INCR_PTR(pNew, pNew->mIdx32Offs) : nullptr;
+			triOrg = 0;
+			for (int i = 0; i < nbat; ++i) {
+				const sxModelData::Batch* pBat = pNew->get_batch_ptr(i);
+				int nidx = pBat->mTriNum * 3;
+				const uint32_t* pBatIdx = pIdx + triOrg*3;
+				if (pBat->is_idx16()) {
+					for (int j = 0; j < nidx; ++j) {
+						pIdx16[pBat->mIdxOrg + j] = uint16_t(pBatIdx[j]);
+					}
+				} else {
+					::memcpy(pIdx32 + pBat->mIdxOrg, pBatIdx, nidx * sizeof(uint32_t));
+				}
+				triOrg += pBat->mTriNum;
+			}
+			sxModelData::ClusterInfo* pInfo = (sxModelData::ClusterInfo*)pSec;
+			pInfo->mClsNum = uint32_t(ncls);
+			pInfo->mMaxVtx = uint32_t(nxCalc::clamp(maxVtx, 3, 0xFFFF));
+			pInfo->mMaxTri = uint32_t(nxCalc::clamp(maxTri, 1, 0xFFFF));
+			pInfo->mClsOffs = uint32_t(infoSize);
+			::memcpy(pInfo->mBatOrg, pBatOrg, (nbat + 1) * sizeof(int32_t));
+			::memcpy(XD_INCR_PTR(pInfo, infoSize), pCls, clsSize);
+		}
+	}
+	nxCore::mem_free(pCls);
+	nxCore::mem_free(pIdx);
+	nxCore::mem_free(pPnts);
+	nxCore::mem_free(pBatOrg);
+	return pNew;
+}
+
+} // nxCluster
+
+namespace nxLOD {
+
+struct Quadric {
+	double m[10]; /* a00 a01 a02 a11 a12 a22 b0 b1 b2 c */
+	double w;
+
+	void zero() { ::memset(this, 0, sizeof(*this)); }
+
+	void add_plane(const cxVec& n, const double d, const double wgt) {
+		double nx = n.x;
+		double ny = n.y;
+		double nz = n.z;
+		m[0] += nx*nx*wgt;
+		m[1] += nx*ny*wgt;
+		m[2] += nx*nz*wgt;
+		m[3] += ny*ny*wgt;
+		m[4] += ny*nz*wgt;
+		m[5] += nz*nz*wgt;
+		m[6] += nx*d*wgt;
+		m[7] += ny*d*wgt;
+		m[8] += nz*d*wgt;
+		m[9] += d*d*wgt;
+		w += wgt;
+	}
+
+	void add(const Quadric& q) {
+		for (int i = 0; i < 10; ++i) {
+			m[i] += q.m[i];
+		}
+		w += q.w;
+	}
+
+	/* mean squared distance to the accumulated planes */
+	double eval(const cxVec& p) const {
+		if (w <= 0.0) return 0.0;
+		double x = p.x;
+		double y = p.y;
+		double z = p.z;
+		double e = m[0]*x*x + m[3]*y*y + m[5]*z*z + 2.0*(m[1]*x*y + m[2]*x*z + m[4]*y*z + m[6]*x + m[7]*y + m[8]*z) + m[9];
+		return nxCalc::max(e, 0.0) / w;
+	}
+};
+
+struct Collapse {
+	float cost;
+	int32_t u;
+	int32_t v;
+};
+
+static int collapse_cmp(const void* pA, const void* pB) {
+	float a = ((const Collapse*)pA)->cost;
+	float b = ((const Collapse*)pB)->cost;
+	return a < b ? -1 : a > b ? 1 : 0;
+}
+
+class cxSimplifier {
+public:
+	const float* mpAttrs;
+	const float* mpAttrWgt;
+	cxVec* mpPos; /* normalized to the unit box */
+	int32_t* mpWeld; /* coincident points share the lowest referenced id */
+	uint8_t* mpLock;
+	uint8_t* mpDirty;
+	Quadric* mpQdr;
+	uint32_t* mpCur;
+	uint32_t* mpRemap;
+	int32_t* mpAdjOrg;
+	int32_t* mpAdjTri;
+	int32_t* mpStamp;
+	Collapse* mpCol;
+	void* mpMem;
+	double mErr2;
+	float mScale;
+	int mPntNum;
+	int mTriNum;
+	int mAttrNum;
+	int32_t mStampVal;
+
+	cxSimplifier() : mpMem(nullptr) {}
+	~cxSimplifier() { nxCore::mem_free(mpMem); }
+
+	bool init(const uint32_t* pIdx, const int ntri, const cxVec* pPnts, const int npnt, const float* pAttrs, const int nattr, const float* pAttrWgt);
+	void build_adj();
+	int collapse_pass(const int maxCol, const double errLim2);
+	bool link_ok(const int ru, const int rv);
+	bool flips(const int ru, const int rv, const int v) const;
+
+	double attr_dist2(const int u, const int v) const {
+		double d2 = 0.0;
+		if (mpAttrs) {
+			const float* pAU = mpAttrs + size_t(u)*mAttrNum;
+			const float* pAV = mpAttrs + size_t(v)*mAttrNum;
+			for (int i = 0; i < mAttrNum; ++i) {
+				double d = double(pAU[i] - pAV[i]) * (mpAttrWgt ? mpAttrWgt[i] : 1.0f);
+				d2 += d*d;
+			}
+		}
+		return d2;
+	}
+};
+
+bool cxSimplifier::init(const uint32_t* pIdx, const int ntri, const cxVec* pPnts, const int npnt, const float* pAttrs, const int nattr, const float* pAttrWgt) {
+	int hashSize = 1;
+	while (hashSize < npnt*2) hashSize <<= 1;
+	size_t memSize = XD_ALIGN(npnt * sizeof(cxVec), 0x10);
+	memSize += XD_ALIGN(npnt * sizeof(Quadric), 0x10);
+	memSize += XD_ALIGN(npnt * sizeof(Collapse), 0x10);
+	memSize += XD_ALIGN(npnt * sizeof(int32_t), 0x10) * 3; /* weld, remap, stamp */
+	memSize += XD_ALIGN((npnt + 1) * sizeof(int32_t), 0x10); /* adjacency origins */
+	memSize += XD_ALIGN(ntri * 3 * sizeof(int32_t), 0x10) * 2; /* current triangles, adjacent triangles */
+	memSize += XD_ALIGN(npnt, 0x10) * 2; /* lock, dirty */
+	memSize += hashSize * sizeof(int32_t);
+	mpMem = nxCore::mem_alloc(memSize, "xLODWk");
+	if (!mpMem) return false;
+	uint8_t* pTop = (uint8_t*)mpMem;
+	mpPos = (cxVec*)pTop;
+	pTop += XD_ALIGN(npnt * sizeof(cxVec), 0x10);
+	mpQdr = (Quadric*)pTop;
+	pTop += XD_ALIGN(npnt * sizeof(Quadric), 0x10);
+	mpCol = (Collapse*)pTop;
+	pTop += XD_ALIGN(npnt * sizeof(Collapse), 0x10);
+	mpWeld = (int32_t*)pTop;
+	pTop += XD_ALIGN(npnt * sizeof(int32_t), 0x10);
+	mpRemap = (uint32_t*)pTop;
+	pTop += XD_ALIGN(npnt * sizeof(int32_t), 0x10);
+	mpStamp = (int32_t*)pTop;
+	pTop += XD_ALIGN(npnt * sizeof(int32_t), 0x10);
+	mpAdjOrg = (int32_t*)pTop;
+	pTop += XD_ALIGN((npnt + 1) * sizeof(int32_t), 0x10);
+	mpCur = (uint32_t*)pTop;
+	pTop += XD_ALIGN(ntri * 3 * sizeof(int32_t), 0x10);
+	mpAdjTri = (int32_t*)pTop;
+	pTop += XD_ALIGN(ntri * 3 * sizeof(int32_t), 0x10);
+	mpLock = pTop;
+	pTop += XD_ALIGN(npnt, 0x10);
+	mpDirty = pTop;
+	pTop += XD_ALIGN(npnt, 0x10);
+	int32_t* pHash = (int32_t*)pTop;
+
+	mpAttrs = nattr > 0 ? pAttrs : nullptr;
+	mpAttrWgt = pAttrWgt;
+	mAttrNum = nattr;
+	mPntNum = npnt;
+	mErr2 = 0.0;
+	mStampVal = 0;
+
+	/* weld referenced points with identical positions */
+	::memset(mpLock, 0, npnt);
+	for (int i = 0; i < ntri*3; ++i) {
+		mpLock[pIdx[i]] = 1;
+	}
+	for (int i = 0; i < hashSize; ++i) {
+		pHash[i] = -1;
+	}
+	cxAABB bbox;
+	bbox.init();
+	for (int i = 0; i < npnt; ++i) {
+		mpWeld[i] = i;
+		mpRemap[i] = uint32_t(i);
+		mpStamp[i] = 0;
+		if (!mpLock[i]) continue;
+		bbox.add_pnt(pPnts[i]);
+		uint32_t bits[3];
+		::memcpy(bits, &pPnts[i], sizeof(bits));
+		uint32_t h = (bits[0] * 73856093U) ^ (bits[1] * 19349663U) ^ (bits[2] * 83492791U);
+		for (uint32_t j = h & (hashSize - 1);; j = (j + 1) & (hashSize - 1)) {
+			if (pHash[j] < 0) {
+				pHash[j] = i;
+				break;
+			}
+			if (::memcmp(&pPnts[pHash[j]], &pPnts[i], sizeof(bits)) == 0) {
+				mpWeld[i] = pHash[j];
+				break;
+			}
+		}
+	}
+	mScale = 1.0f / nxCalc::max(bbox.get_size_vec().max_elem(), 1e-20f);
+	for (int i = 0; i < npnt; ++i) {
+		mpPos[i] = (pPnts[i] - bbox.get_min_pos()) * mScale;
+		mpQdr[i].zero();
+	}
+
+	/* coincident points with different attributes form seams */
+	for (int i = 0; i < npnt; ++i) {
+		if (mpLock[i]) {
+			++mpStamp[mpWeld[i]];
+		}
+	}
+	for (int i = 0; i < npnt; ++i) {
+		mpLock[i] = mpStamp[i] > 1 ? 1 : 0;
+		mpStamp[i] = 0;
+	}
+
+	mTriNum = 0;
+	for (int i = 0; i < ntri; ++i) {
+		const uint32_t* pTri = &pIdx[i*3];
+		int32_t a = mpWeld[pTri[0]];
+		int32_t b = mpWeld[pTri[1]];
+		int32_t c = mpWeld[pTri[2]];
+		if (a == b || b == c || c == a) continue;
+		::memcpy(&mpCur[mTriNum*3], pTri, sizeof(uint32_t) * 3);
+		++mTriNum;
+		cxVec n = nxVec::cross(mpPos[b] - mpPos[a], mpPos[c] - mpPos[a]);
+		float area = n.mag();
+		if (area > 0.0f) {
+			n.scl(1.0f / area);
+			double d = -n.dot(mpPos[a]);
+			mpQdr[a].add_plane(n, d, area);
+			mpQdr[b].add_plane(n, d, area);
+			mpQdr[c].add_plane(n, d, area);
+		}
+	}
+
+	/* borders and non-manifold edges: each directed edge must have exactly one twin */
+	build_adj();
+	for (int i = 0; i < mTriNum; ++i) {
+		for (int k = 0; k < 3; ++k) {
+			int32_t a = mpWeld[mpCur[i*3 + k]];
+			int32_t b = mpWeld[mpCur[i*3 + (k + 1) % 3]];
+			int nfwd = 0;
+			int nrev = 0;
+			for (int j = mpAdjOrg[a]; j < mpAdjOrg[a + 1]; ++j) {
+				const uint32_t* pTri = &mpCur[mpAdjTri[j]*3];
+				for (int l = 0; l < 3; ++l) {
+					int32_t e0 = mpWeld[pTri[l]];
+					int32_t e1 = mpWeld[pTri[(l + 1) % 3]];
+					if (e0 == a && e1 == b) ++nfwd;
+					if (e0 == b && e1 == a) ++nrev;
+				}
+			}
+			if (nfwd != 1 || nrev != 1) {
+				mpLock[a] = 1;
+				mpLock[b] = 1;
+			}
+		}
+	}
+	return true;
+}
+
+void cxSimplifier::build_adj() {
+	::memset(mpAdjOrg, 0, (mPntNum + 1) * sizeof(int32_t));
+	for (int i = 0; i < mTriNum*3; ++i) {
+		++mpAdjOrg[mpWeld[mpCur[i]] + 1];
+	}
+	for (int i = 0; i < mPntNum; ++i) {
+		mpAdjOrg[i + 1] += mpAdjOrg[i];
+	}
+	int32_t* pFill = (int32_t*)mpCol; /* scratch, rebuilt by the pass */
+	::memcpy(pFill, mpAdjOrg, mPntNum * sizeof(int32_t));
+	for (int i = 0; i < mTriNum; ++i) {
+		for (int k = 0; k < 3; ++k) {
+			mpAdjTri[pFill[mpWeld[mpCur[i*3 + k]]]++] = i;
+		}
+	}
+}
+
+/* the rings of u and v may only share the apexes of the triangles on edge uv */
+bool cxSimplifier::link_ok(const int ru, const int rv) {
+	int32_t s0 = ++mStampVal;
+	int32_t s1 = ++mStampVal;
+	for (int j = mpAdjOrg[ru]; j < mpAdjOrg[ru + 1]; ++j) {
+		const uint32_t* pTri = &mpCur[mpAdjTri[j]*3];
+		for (int k = 0; k < 3; ++k) {
+			int32_t w = mpWeld[pTri[k]];
+			if (w != ru) mpStamp[w] = s0;
+		}
+	}
+	int nshared = 0;
+	int nedge = 0;
+	for (int j = mpAdjOrg[rv]; j < mpAdjOrg[rv + 1]; ++j) {
+		const uint32_t* pTri = &mpCur[mpAdjTri[j]*3];
+		bool hasU = false;
+		for (int k = 0; k < 3; ++k) {
+			int32_t w = mpWeld[pTri[k]];
+			if (w == ru) {
+				hasU = true;
+			} else if (w != rv && mpStamp[w] == s0) {
+				mpStamp[w] = s1;
+				++nshared;
+			}
+		}
+		if (hasU) ++nedge;
+	}
+	return nedge == 2 && nshared == 2;
+}
+
+bool cxSimplifier::flips(const int ru, const int rv, const int v) const {
+	for (int j = mpAdjOrg[ru]; j < mpAdjOrg[ru + 1]; ++j) {
+		const uint32_t* pTri = &mpCur[mpAdjTri[j]*3];
+		cxVec p[3];
+		cxVec q[3];
+		bool hasV = false;
+		for (int k = 0; k < 3; ++k) {
+			int32_t w = mpWeld[pTri[k]];
+			if (w == rv) hasV = true;
+			p[k] = mpPos[pTri[k]];
+			q[k] = w == ru ? mpPos[v] : p[k];
+		}
+		if (hasV) continue;
+		cxVec n0 = nxVec::cross(p[1] - p[0], p[2] - p[0]);
+		cxVec n1 = nxVec::cross(q[1] - q[0], q[2] - q[0]);
+		if (n0.dot(n1) <= 0.0f) return true;
+	}
+	return false;
+}
+
+int cxSimplifier::collapse_pass(const int maxCol, const double errLim2) {
+	build_adj();
+	int nbest = 0;
+	for (int i = 0; i < mPntNum; ++i) {
+		mpStamp[i] = -1; /* best collapse slot */
+	}
+	mStampVal = 0;
+	for (int i = 0; i < mTriNum; ++i) {
+		for (int k = 0; k < 3; ++k) {
+			int32_t u = int32_t(mpCur[i*3 + k]);
+			if (mpLock[mpWeld[u]]) continue;
+			for (int l = 1; l < 3; ++l) {
+				int32_t v = int32_t(mpCur[i*3 + (k + l) % 3]);
+				float cost = float(mpQdr[u].eval(mpPos[v]) + attr_dist2(u, v));
+				int32_t slot = mpStamp[u];
+				if (slot < 0) {
+					slot = nbest++;
+					mpStamp[u] = slot;
+					mpCol[slot].cost = cost;
+					mpCol[slot].u = u;
+					mpCol[slot].v = v;
+				} else if (cost < mpCol[slot].cost) {
+					mpCol[slot].cost = cost;
+					mpCol[slot].v = v;
+				}
+			}
+		}
+	}
+	for (int i = 0; i < mPntNum; ++i) {
+		mpStamp[i] = 0;
+	}
+	::qsort(mpCol, nbest, sizeof(Collapse), collapse_cmp);
+	::memset(mpDirty, 0, mPntNum);
+	int ncol = 0;
+	for (int i = 0; i < nbest && ncol < maxCol; ++i) {
+		const Collapse& col = mpCol[i];
+		if (double(col.cost) > errLim2) break;
+		int32_t ru = col.u;
+		int32_t rv = mpWeld[col.v];
+		if (mpDirty[ru] || mpDirty[rv]) continue;
+		if (!link_ok(ru, rv)) continue;
+		if (flips(ru, rv, col.v)) continue;
+		mpRemap[ru] = uint32_t(col.v);
+		mpQdr[rv].add(mpQdr[ru]);
+		mErr2 = nxCalc::max(mErr2, double(col.cost));
+		for (int j = mpAdjOrg[ru]; j < mpAdjOrg[ru + 1]; ++j) {
+			const uint32_t* pTri = &mpCur[mpAdjTri[j]*3];
+			for (int k = 0; k < 3; ++k) {
+				mpDirty[mpWeld[pTri[k]]] = 1;
+			}
+		}
+		++ncol;
+	}
+	if (ncol > 0) {
+		int n = 0;
+		for (int i = 0; i < mTriNum; ++i) {
+			uint32_t tri[3];
+			for (int k = 0; k < 3; ++k) {
+				tri[k] = mpRemap[mpCur[i*3 + k]];
+			}
+			int32_t a = mpWeld[tri[0]];
+			int32_t b = mpWeld[tri[1]];
+			int32_t c = mpWeld[tri[2]];
+			if (a == b || b == c || c == a) continue;
+			::memcpy(&mpCur[n*3], tri, sizeof(tri));
+			++n;
+		}
+		mTriNum = n;
+		for (int i = 0; i < mPntNum; ++i) {
+			mpRemap[i] = uint32_t(i);
+		}
+	}
+	return ncol;
+}
+
+int simplify(uint32_t* pDst, int* pLvlTriNum, float* pLvlErr, const int nlvl, const int* pTargets, const float maxErr,
+             const uint32_t* pIdx, const int ntri, const cxVec* pPnts, const int npnt,
+             const float* pAttrs, const int nattr, const float* pAttrWgt) {
+	if (!pDst || !pTargets || nlvl <= 0 || !pIdx || ntri <= 0 || !pPnts || npnt <= 0) return 0;
+	for (int i = 0; i < ntri*3; ++i) {
+		if (pIdx[i] >= uint32_t(npnt)) return 0;
+	}
+	cxSimplifier smp;
+	if (!smp.init(pIdx, ntri, pPnts, npnt, pAttrs, nattr, pAttrWgt)) return 0;
+	double errLim2 = DBL_MAX;
+	if (maxErr < FLT_MAX) {
+		errLim2 = nxCalc::sq(double(maxErr) * smp.mScale);
+	}
+	int nout = 0;
+	for (int ilvl = 0; ilvl < nlvl; ++ilvl) {
+		int target = nxCalc::max(pTargets[ilvl], 0);
+		while (smp.mTriNum > target) {
+			int maxCol = nxCalc::max((smp.mTriNum - target) / 2, 1);
+			if (smp.collapse_pass(maxCol, errLim2) == 0) break;
+		}
+		::memcpy(pDst + nout*3, smp.mpCur, smp.mTriNum * 3 * sizeof(uint32_t));
+		nout += smp.mTriNum;
+		if (pLvlTriNum) {
+			pLvlTriNum[ilvl] = smp.mTriNum;
+		}
+		if (pLvlErr) {
+			pLvlErr[ilvl] = float(::sqrt(smp.mErr2) / smp.mScale);
+		}
+	}
+	return nout;
+}
+
+sxModelData* build_model(const sxModelData* pMdl, const int nlod, const float ratio, const float maxErr) {
+	if (!pMdl || nlod <= 0) return nullptr;
+	int nbat = int(pMdl->mBatNum);
+	if (nbat <= 0) return nullptr;
+	float r = nxCalc::clamp(ratio, 0.01f, 0.99f);
+	int ntriTotal = 0;
+	int maxBatPnt = 0;
+	int maxBatTri = 0;
+	int maxAttr = 0;
+	for (int i = 0; i < nbat; ++i) {
+		const sxModelData::Batch* pBat = pMdl->get_batch_ptr(i);
+		ntriTotal += pBat->mTriNum;
+		maxBatPnt = nxCalc::max(maxBatPnt, pBat->mMaxIdx - pBat->mMinIdx + 1);
+		maxBatTri = nxCalc::max(maxBatTri, pBat->mTriNum);
+		maxAttr = nxCalc::max(maxAttr, 8 + (pMdl->has_skin() ? pBat->mJntNum : 0));
+	}
+	if (ntriTotal <= 0) return nullptr;
+	uint32_t* pOut = (uint32_t*)nxCore::mem_alloc(size_t(ntriTotal) * nlod * 3 * sizeof(uint32_t), "xLODWk:Out");
+	uint32_t* pIdx = (uint32_t*)nxCore::mem_alloc(maxBatTri * 3 * sizeof(uint32_t), "xLODWk:Idx");
+	cxVec* pPnts = (cxVec*)nxCore::mem_alloc(maxBatPnt * sizeof(cxVec), "xLODWk:Pnts");
+	float* pAttrs = (float*)nxCore::mem_alloc(size_t(maxBatPnt) * maxAttr * sizeof(float), "xLODWk:Attrs");
+	float* pAttrWgt = (float*)nxCore::mem_alloc(maxAttr * sizeof(float), "xLODWk:AttrWgt");
+	int* pTargets = (int*)nxCore::mem_alloc(nlod * sizeof(int), "xLODWk:Targets");
+	int* pLvlTri = (int*)nxCore::mem_alloc(nbat * nlod * sizeof(int), "xLODWk:LvlTri");
+	float* pLvlErr = (float*)nxCore::mem_alloc(nbat * nlod * sizeof(float), "xLODWk:LvlErr");
+	int32_t* pLvlOrg = (int32_t*)nxCore::mem_alloc(nbat * sizeof(int32_t), "xLODWk:LvlOrg");
+	bool ok = pOut && pIdx && pPnts && pAttrs && pAttrWgt && pTargets && pLvlTri && pLvlErr && pLvlOrg;
+	int outOrg = 0;
+	for (int i = 0; ok && i < nbat; ++i) {
+		const sxModelData::Batch* pBat = pMdl->get_batch_ptr(i);
+		int ntri = pBat->mTriNum;
+		pLvlOrg[i] = outOrg;
+		if (ntri <= 0) {
+			for (int j = 0; j < nlod; ++j) {
+				pLvlTri[i*nlod + j] = 0;
+				pLvlErr[i*nlod + j] = 0.0f;
+			}
+			continue;
+		}
+		int npnt = pBat->mMaxIdx - pBat->mMinIdx + 1;
+		int njnt = pMdl->has_skin() ? pBat->mJntNum : 0;
+		int nattr = 8 + njnt;
+		for (int j = 0; j < nattr; ++j) {
+			pAttrWgt[j] = j < 3 ? 0.5f : j < 5 ? 1.0f : j < 8 ? 0.25f : 1.0f; /* normal, texcoord, color, skin weights */
+		}
+		for (int j = 0; j < npnt; ++j) {
+			int pid = pBat->mMinIdx + j;
+			pPnts[j] = pMdl->get_pnt_pos(pid);
+			float* pAttr = pAttrs + size_t(j)*nattr;
+			::memset(pAttr, 0, nattr * sizeof(float));
+			pMdl->get_pnt_nrm(pid).to_mem(pAttr);
+			xt_texcoord tex = pMdl->get_pnt_tex(pid);
+			pAttr[3] = tex.u;
+			pAttr[4] = tex.v;
+			cxColor clr = pMdl->get_pnt_clr(pid);
+			pAttr[5] = clr.r;
+			pAttr[6] = clr.g;
+			pAttr[7] = clr.b;
+			if (njnt > 0) {
+				sxModelData::PntSkin skn = pMdl->get_pnt_skin(pid);
+				for (int k = 0; k < skn.num; ++k) {
+					if (skn.idx[k] < njnt) {
+						pAttr[8 + skn.idx[k]] += skn.wgt[k];
+					}
+				}
+			}
+		}
+		for (int j = 0; j < ntri; ++j) {
+			xt_int3 tri = pMdl->get_batch_tri_indices(i, j);
+			for (int k = 0; k < 3; ++k) {
+				pIdx[j*3 + k] = uint32_t(tri[k] - pBat->mMinIdx);
+			}
+		}
+		float tgt = float(ntri);
+		for (int j = 0; j < nlod; ++j) {
+			tgt *= r;
+			pTargets[j] = int(tgt);
+		}
+		int n = simplify(pOut + size_t(outOrg)*3, &pLvlTri[i*nlod], &pLvlErr[i*nlod], nlod, pTargets, maxErr, pIdx, ntri, pPnts, npnt, pAttrs, nattr, pAttrWgt);
+		ok = n > 0;
+		outOrg += n;
+	}
+	sxModelData* pNew = nullptr;
+	if (ok) {
+		/* keep the levels that still reduce the model */
+		int nkeep = 0;
+		int ntriPrev = ntriTotal;
+		for (int j = 0; j < nlod; ++j) {
+			int n = 0;
+			for (int i = 0; i < nbat; ++i) {
+				n += pLvlTri[i*nlod + j];
+			}
+			if (n >= ntriPrev) break;
+			ntriPrev = n;
+			++nkeep;
+		}
+		int nidx16 = 0;
+		int nidx32 = 0;
+		for (int i = 0; i < nbat; ++i) {
+			bool idx16 = pMdl->get_batch_ptr(i)->is_idx16();
+			for (int j = 0; j < nkeep; ++j) {
+				if (idx16) {
+					nidx16 += pLvlTri[i*nlod + j] * 3;
+				} else {
+					nidx32 += pLvlTri[i*nlod + j] * 3;
+				}
+			}
+		}
+		if (nkeep > 0) {
+			size_t lodsOffs = XD_ALIGN(sizeof(sxModelData::LodInfo), 0x10);
+			size_t batsOffs = XD_ALIGN(lodsOffs + nkeep * sizeof(sxModelData::Lod), 0x10);
+			size_t idx16Offs = XD_ALIGN(batsOffs + nkeep * nbat * sizeof(sxModelData::LodBatch), 0x10);
+			size_t idx32Offs = XD_ALIGN(idx16Offs + nidx16 * sizeof(uint16_t), 0x10);
+			size_t secSize = idx32Offs + nidx32 * sizeof(uint32_t);
+			void* pSec = nullptr;
+			pNew = mdl_copy_with_ext(pMdl, sxModelData::LODS_EXT, secSize, &pSec);
+			if (pNew) {
+				sxModelData::LodInfo* pInfo = (sxModelData::LodInfo*)pSec;
+				pInfo->mLodNum = uint32_t(nkeep);
+				pInfo->mIdx16Num = uint32_t(nidx16);
+				pInfo->mIdx32Num = uint32_t(nidx32);
+				pInfo->mLodsOffs = uint32_t(lodsOffs);
+				pInfo->mBatsOffs = uint32_t(batsOffs);
+				pInfo->mIdx16Offs = uint32_t(idx16Offs);
+				pInfo->mIdx32Offs = uint32_t(idx32Offs);
+				sxModelData::Lod* pLods = (sxModelData::Lod*)XD_INCR_PTR(pInfo, lodsOffs);
+				sxModelData::LodBatch* pLodBats = (sxModelData::LodBatch*)XD_INCR_PTR(pInfo, batsOffs);
+				uint16_t* pIdx16 = (uint16_t*)XD_INCR_PTR(pInfo, idx16Offs);
+				uint32_t* pIdx32 = (uint32_t*)XD_INCR_PTR(pInfo, idx32Offs);
+				int org16 = 0;
+				int org32 = 0;
+				for (int j = 0; j < nkeep; ++j) {
+					sxModelData::Lod* pLod = &pLods[j];
+					for (int i = 0; i < nbat; ++i) {
+						const sxModelData::Batch* pBat = pMdl->get_batch_ptr(i);
+						int ntri = pLvlTri[i*nlod + j];
+						const uint32_t* pSrc = pOut + size_t(pLvlOrg[i])*3;
+						for (int k = 0; k < j; ++k) {
+							pSrc += pLvlTri[i*nlod + k] * 3;
+						}
+						sxModelData::LodBatch* pLodBat = &pLodBats[j*nbat + i];
+						pLodBat->mTriNum = ntri;
+						if (pBat->is_idx16()) {
+							pLodBat->mIdxOrg = org16;
+							for (int k = 0; k < ntri*3; ++k) {
+								pIdx16[org16 + k] = uint16_t(pSrc[k]);
+							}
+							org16 += ntri*3;
+						} else {
+							pLodBat->mIdxOrg = org32;
+							::memcpy(pIdx32 + org32, pSrc, ntri * 3 * sizeof(uint32_t));
+							org32 += ntri*3;
+						}
+						pLod->mTriNum += uint32_t(ntri);
+						pLod->mError = nxCalc::max(pLod->mError, pLvlErr[i*nlod + j]);
+					}
+					pLod->mRatio = float(pLod->mTriNum) / float(ntriTotal);
+				}
+			}
+		}
+	}
+	nxCore::mem_free(pOut);
+	nxCore::mem_free(pIdx);
+	nxCore::mem_free(pPnts);
+	nxCore::mem_free(pAttrs);
+	nxCore::mem_free(pAttrWgt);
+	nxCore::mem_free(pTargets);
+	nxCore::mem_free(pLvlTri);
+	nxCore::mem_free(pLvlErr);
+	nxCore::mem_free(pLvlOrg);
+	return pNew;
+}
+
+} // nxLOD
+
 
 #define XD_STRSTORE_ALLOC_SIZE size_t(4096)
 
@@ -3256,6 +3256,31 @@ public:
 	bool overlaps(const cxCapsule& cap) const;
 };
 
+/* 8 boxes as SoA center/half-size lanes for cxFrustum::cull_boxes, lanes are filled exactly as cxFrustum::cull(cxAABB) derives them */
+struct sxAABB8 {
+	float mCenterX[8];
+	float mCenterY[8];
+	float mCenterZ[8];
+	float mRadiusX[8];
+	float mRadiusY[8];
+	float mRadiusZ[8];
+
+	void set(const int lane, const cxAABB& box) {
+		cxVec c = box.get_center();
+		cxVec r = box.get_max_pos() - c;
+		mCenterX[lane] = c.x;
+		mCenterY[lane] = c.y;
+		mCenterZ[lane] = c.z;
+		mRadiusX[lane] = r.x;
+		mRadiusY[lane] = r.y;
+		mRadiusZ[lane] = r.z;
+	}
+
+	static int calc_blocks_num(const int nboxes) { return (nboxes + 7) >> 3; }
+	/* pBlks must have room for calc_blocks_num(nboxes) blocks, unused lanes of the last block are cleared */
+	static void pack(sxAABB8* pBlks, const cxAABB* pBoxes, const int nboxes);
+};
+
 class cxFrustum {
 protected:
 	cxVec mPnt[8];
@@ -3283,6 +3308,9 @@ public:
 	bool overlaps(const cxSphere& sph) const;
 	bool cull(const cxAABB& box) const;
 	bool overlaps(const cxAABB& box) const;
+	/* same test as cull(cxAABB) for 8 boxes at a time (AVX/SSE when available);
+	   sets bit i of pCullBits for every culled box i < nboxes, other bits are left as they are */
+	void cull_boxes(const sxAABB8* pBlks, const int nboxes, uint32_t* pCullBits) const;
 
 	void dump_geo(FILE* pOut) const;
 	void dump_geo(const char* pOutPath) const;
@@ -4964,6 +4992,54 @@ struct sxModelData : public sxData {
 		int32_t mBatItemsNum;
 	};
 
+	/* contiguous triangle range of a batch with model-space bounds, CW front faces */
+	struct Cluster {
+		xt_float3 mCenter;
+		float mRadius;
+		xt_float3 mConeAxis;
+		float mConeCos; /* min cos(normal, axis), <= 0 if the normals don't fit in a cone */
+		int32_t mTriOrg; /* relative to the batch */
+		uint16_t mTriNum;
+		uint16_t mVtxNum;
+
+		cxSphere get_sphere() const { return cxSphere(mCenter.x, mCenter.y, mCenter.z, mRadius); }
+		bool has_cone() const { return mConeCos > 0.0f; }
+		bool is_backfacing(const cxVec& viewPos) const;
+	};
+
+	/* CLUSTERS_EXT section: mBatNum + 1 cluster origins, then the Cluster list */
+	struct ClusterInfo {
+		uint32_t mClsNum;
+		uint32_t mMaxVtx;
+		uint32_t mMaxTri;
+		uint32_t mClsOffs; /* from ClusterInfo */
+		int32_t mBatOrg[1];
+	};
+
+	/* LODS_EXT section: simplified index lists sharing the model's points, LOD 0 is the model itself */
+	struct LodInfo {
+		uint32_t mLodNum; /* stored LODs, excluding LOD 0 */
+		uint32_t mIdx16Num;
+		uint32_t mIdx32Num;
+		uint32_t mLodsOffs; /* from LodInfo */
+		uint32_t mBatsOffs; /* from LodInfo, mLodNum * mBatNum */
+		uint32_t mIdx16Offs; /* from LodInfo */
+		uint32_t mIdx32Offs; /* from LodInfo */
+		uint32_t mReserved;
+	};
+
+	struct Lod {
+		float mError; /* model-space distance */
+		float mRatio;
+		uint32_t mTriNum;
+		uint32_t mReserved;
+	};
+
+	struct LodBatch {
+		int32_t mIdxOrg; /* in the section's idx16 or idx32 list, following Batch::is_idx16() */
+		int32_t mTriNum;
+	};
+
 	bool is_static() const { return (mFlags & 1) != 0; }
 	bool half_encoding() const { return (mFlags & 2) != 0; }
 	bool has_skin() const { return mSknNum > 0; }
@@ -5008,6 +5084,20 @@ struct sxModelData : public sxData {
 	const cxSphere* get_batch_spheres(const int ibat) const;
 	const Material* get_batch_material(const int ibat) const;
 	int count_alpha_batches() const;
+	const ClusterInfo* get_cluster_info() const;
+	bool has_clusters() const { return get_cluster_info() != nullptr; }
+	int get_batch_clusters_num(const int ibat) const;
+	const Cluster* get_batch_clusters(const int ibat) const;
+	const LodInfo* get_lod_info() const;
+	int get_lods_num() const;
+	bool ck_lod_id(const int ilod) const { return ilod >= 0 && ilod < get_lods_num(); }
+	const Lod* get_lod(const int ilod) const;
+	float get_lod_error(const int ilod) const;
+	int get_lod_tri_num(const int ilod) const;
+	const LodBatch* get_lod_batch_ptr(const int ilod, const int ibat) const;
+	int get_lod_batch_tri_num(const int ilod, const int ibat) const;
+	xt_int3 get_lod_batch_tri_indices(const int ilod, const int ibat, const int itri) const;
+	int find_lod(const float maxErr) const;
 	const TexInfo* get_tex_info(const int tid) const;
 	TexInfo* get_tex_info(const int tid);
 	void clear_tex_wk();
@@ -5042,6 +5132,8 @@ struct sxModelData : public sxData {
 	void dump_bat_spheres(const char* pOutPath) const;
 
 	static const uint32_t KIND;
+	static const uint32_t CLUSTERS_EXT;
+	static const uint32_t LODS_EXT;
 };
 
 struct sxTextureData : public sxData {
@@ -5176,6 +5268,8 @@ struct sxCollisionData : public sxData {
 		int count;
 	};
 
+	static const int PACKET_SIZE = 8;
+
 	typedef bool (*TriFunc)(const sxCollisionData& col, const Tri& tri, void* pWk);
 	typedef bool (*HitFunc)(const sxCollisionData& col, const Tri& tri, const cxVec& pos, const float dist, void* pWk);
 
@@ -5204,6 +5298,8 @@ struct sxCollisionData : public sxData {
 
 	int hit_check(const HitFunc func, const cxLineSeg& seg, void* pWk);
 	NearestHit nearest_hit(const cxLineSeg& seg);
+	/* nearest_hit() for many segments, sorted into packets by direction octant and origin; pWk: nseg*2 ints or null */
+	void nearest_hit_stream(const cxLineSeg* pSegs, NearestHit* pHits, const int nseg, int32_t* pWk = nullptr) const;
 
 	void dump_pol_geo(FILE* pOut) const;
 	void dump_pol_geo(const char* pOutPath) const;
@@ -5305,6 +5401,7 @@ public:
 	xt_xmtx* mpWorldXform;
 	xt_xmtx* mpSkinXforms;
 	cxAABB* mpBatBBoxes;
+	sxAABB8* mpBatBoxBlks; /* SoA copy of mpBatBBoxes for frustum_cull */
 	uint32_t* mpCullBits;
 	uint32_t* mpHideBits;
 	void* mpParamMem;
@@ -5338,13 +5435,43 @@ public:
 
 	void set_pose(const cxMotionWork* pMot);
 	void update_bounds();
+	void update_batch_box_blocks();
 	void frustum_cull(const cxFrustum* pFst, const bool precise = true);
 	bool calc_batch_visibility(const cxFrustum* pFst, const int ibat, const bool precise = true);
+	int cull_clusters(const int ibat, const cxFrustum* pFst, const cxVec* pViewPos, uint32_t* pVisBits) const;
+	int get_cluster_ranges(const int ibat, const uint32_t* pVisBits, xt_int2* pRanges) const;
+	int select_lod(const cxVec& viewPos, const float fovy, const float viewHeight, const float maxPixErr = 1.0f) const;
 
 	static cxModelWork* create(sxModelData* pMdl, const size_t paramMemSize = 0, const size_t extMemSize = 0);
 	static void destroy(cxModelWork* pWk);
 };
 
+namespace nxCluster {
+
+/* Reorders ntri triangles of pIdx (point ids < npnt) into clusters of at most maxVtx points and maxTri triangles,
+   pCls must have room for ntri entries; returns the number of clusters. */
+int build(sxModelData::Cluster* pCls, uint32_t* pIdx, const int ntri, const cxVec* pPnts, const int npnt, const int maxVtx = 64, const int maxTri = 124);
+/* copy of pMdl with reordered batch triangles and a CLUSTERS_EXT section, free with nxData::unload */
+sxModelData* build_model(const sxModelData* pMdl, const int maxVtx = 64, const int maxTri = 124);
+
+} // nxCluster
+
+namespace nxLOD {
+
+/* Quadric error edge collapse onto existing points, so every level shares the source points.
+   Points on borders, attribute seams (coincident points) and non-manifold edges are locked.
+   Levels are written back to back to pDst for decreasing pTargets (triangle counts), a level stops early when
+   the next collapse would exceed maxErr. pAttrs: nattr floats per point, compared with pAttrWgt (1 if null).
+   Returns the number of triangles written. */
+int simplify(uint32_t* pDst, int* pLvlTriNum, float* pLvlErr, const int nlvl, const int* pTargets, const float maxErr,
+             const uint32_t* pIdx, const int ntri, const cxVec* pPnts, const int npnt,
+             const float* pAttrs = nullptr, const int nattr = 0, const float* pAttrWgt = nullptr);
+/* copy of pMdl with a LODS_EXT chain of up to nlod levels, each batch reduced by ratio per level
+   (normals, texcoords, colors and skin weights weighted in); free with nxData::unload */
+sxModelData* build_model(const sxModelData* pMdl, const int nlod = 3, const float ratio = 0.5f, const float maxErr = FLT_MAX);
+
+} // nxLOD
+
 
 #define XD_PLEXLST_TAG "xPlexLst"
 
@@ -253,6 +253,8 @@ namespace Draw {
 		bool indexed;
 		bool dblSided;
 		bool alphaBlend;
+		bool screen; /* poly in clip space drawn over the screen like quads: no lighting, CC or fog, only gamma */
+		xt_float3 gamma;
 	};
 
 	struct Quad {
@@ -306,6 +308,13 @@ namespace Draw {
 		void (*end)();
 
 		void (*batch)(cxModelWork* pWk, const int ibat, const Mode mode, const Context* pCtx);
+		/* optional: batch of a rigid model drawn with ninst world transforms, everything else is taken from pWk */
+		void (*batch_inst)(cxModelWork* pWk, const int ibat, const Mode mode, const Context* pCtx, const xt_xmtx* pXforms, const int ninst);
+		/* optional split of batch() for recording on worker threads: batch_prep only reads the work and the context and writes
+		   up to get_batch_prep_size() bytes, batch_submit draws from that data on the rendering thread (pXforms as in batch_inst) */
+		size_t (*get_batch_prep_size)();
+		bool (*batch_prep)(void* pPrep, const cxModelWork* pWk, const int ibat, const Mode mode, const Context* pCtx);
+		void (*batch_submit)(const void* pPrep, cxModelWork* pWk, const int ibat, const Mode mode, const Context* pCtx, const xt_xmtx* pXforms, const int ninst);
 		void (*prim)(const Prim* pPrim, const Context* pCtx);
 		void (*quad)(const Quad* pQuad);
 		void (*symbol)(const Symbol* pSym);
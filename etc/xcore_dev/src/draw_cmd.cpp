@@ -0,0 +1,177 @@
+#include "crosscore.hpp"
+#include "draw_cmd.hpp"
+
+namespace DrawCmd {
+
+void List::init(const size_t recSize, const int chunkSize, const int maxJobs) {
+	reset();
+	mChunkSize = nxCalc::max(chunkSize, 1);
+	if (recSize > 0) {
+		size_t size = (recSize + 0xF) & ~size_t(0xF);
+		mpRecs = (uint8_t*)nxCore::mem_alloc(size * mChunkSize, "DrawCmd:Recs");
+		mpRecFlags = (uint8_t*)nxCore::mem_alloc(mChunkSize, "DrawCmd:RecFlags");
+		if (mpRecs && mpRecFlags) {
+			mRecSize = size;
+		} else {
+			nxCore::mem_free(mpRecs);
+			mpRecs = nullptr;
+			nxCore::mem_free(mpRecFlags);
+			mpRecFlags = nullptr;
+		}
+	}
+	if (maxJobs > 1 && mpRecs) {
+		mpQue = nxTask::queue_create(maxJobs);
+		mpJobs = (sxJob*)nxCore::mem_alloc(maxJobs * sizeof(sxJob), "DrawCmd:Jobs");
+		mpJobInfo = (JobInfo*)nxCore::mem_alloc(maxJobs * sizeof(JobInfo), "DrawCmd:JobInfo");
+		if (mpQue && mpJobs && mpJobInfo) {
+			::memset(mpJobs, 0, maxJobs * sizeof(sxJob));
+			mJobsMax = maxJobs;
+		} else {
+			if (mpQue) {
+				nxTask::queue_destroy(mpQue);
+				mpQue = nullptr;
+			}
+			nxCore::mem_free(mpJobs);
+			mpJobs = nullptr;
+			nxCore::mem_free(mpJobInfo);
+			mpJobInfo = nullptr;
+		}
+	}
+}
+
+void List::reset() {
+	nxCore::mem_free(mpCmds);
+	mpCmds = nullptr;
+	nxCore::mem_free(mpRecs);
+	mpRecs = nullptr;
+	nxCore::mem_free(mpRecFlags);
+	mpRecFlags = nullptr;
+	nxCore::mem_free(mpXforms);
+	mpXforms = nullptr;
+	if (mpQue) {
+		nxTask::queue_destroy(mpQue);
+		mpQue = nullptr;
+	}
+	nxCore::mem_free(mpJobs);
+	mpJobs = nullptr;
+	nxCore::mem_free(mpJobInfo);
+	mpJobInfo = nullptr;
+	mRecFunc = nullptr;
+	mpRecUsr = nullptr;
+	mRecSize = 0;
+	mChunkOrg = 0;
+	mChunkSize = 0;
+	mNum = 0;
+	mMax = 0;
+	mXformsNum = 0;
+	mXformsMax = 0;
+	mJobsMax = 0;
+	mListsNum = 0;
+}
+
+bool List::add(void* pObj, void* pWk, const void* pCtx, const int ibat, const int mode, const xt_xmtx* pXforms, const int ninst) {
+	if (mNum >= mMax) {
+		int nmax = nxCalc::max(mMax * 2, 256);
+		Cmd* pCmds = (Cmd*)nxCore::mem_alloc(nmax * sizeof(Cmd), "DrawCmd:Cmds");
+		if (!pCmds) return false;
+		if (mpCmds) {
+			::memcpy(pCmds, mpCmds, mNum * sizeof(Cmd));
+			nxCore::mem_free(mpCmds);
+		}
+		mpCmds = pCmds;
+		mMax = nmax;
+	}
+	int xorg = -1;
+	int nx = 0;
+	if (pXforms && ninst > 0) {
+		if (mXformsNum + ninst > mXformsMax) {
+			int nmax = nxCalc::max(mXformsNum + ninst, mXformsMax * 2);
+			xt_xmtx* pBuf = (xt_xmtx*)nxCore::mem_alloc(nmax * sizeof(xt_xmtx), "DrawCmd:Xforms");
+			if (!pBuf) return false;
+			if (mpXforms) {
+				::memcpy(pBuf, mpXforms, mXformsNum * sizeof(xt_xmtx));
+				nxCore::mem_free(mpXforms);
+			}
+			mpXforms = pBuf;
+			mXformsMax = nmax;
+		}
+		xorg = mXformsNum;
+		nx = ninst;
+		::memcpy(&mpXforms[xorg], pXforms, ninst * sizeof(xt_xmtx));
+		mXformsNum += ninst;
+	}
+	Cmd* pCmd = &mpCmds[mNum++];
+	pCmd->mpObj = pObj;
+	pCmd->mpWk = pWk;
+	pCmd->mpCtx = pCtx;
+	pCmd->mBatId = ibat;
+	pCmd->mMode = mode;
+	pCmd->mXformsOrg = xorg;
+	pCmd->mInstNum = nx;
+	return true;
+}
+
+void List::record_range(const int org, const int num) {
+	for (int i = org; i < org + num; ++i) {
+		mpRecFlags[i] = mRecFunc(&mpRecs[i * mRecSize], mpCmds[mChunkOrg + i], mpRecUsr) ? 1 : 0;
+	}
+}
+
+/*static*/ void List::record_job(const sxJobContext* pCtx) {
+	if (!pCtx || !pCtx->mpJob) return;
+	JobInfo* pInfo = (JobInfo*)pCtx->mpJob->mpData;
+	if (!pInfo || !pInfo->mpList) return;
+	pInfo->mpList->record_range(pInfo->mOrg, pInfo->mNum);
+}
+
+void List::record_chunk(const int org, const int num, const int minJobItems, cxBrigade* pBgd) {
+	mChunkOrg = org;
+	mListsNum = 1;
+	if (!pBgd || !mpQue || minJobItems <= 0 || num < minJobItems * 2) {
+		record_range(0, num);
+		return;
+	}
+	int njob = nxCalc::min(mJobsMax, num / minJobItems);
+	nxTask::queue_purge(mpQue);
+	for (int i = 0; i < njob; ++i) {
+		int jorg = int(int64_t(num) * i / njob);
+		int jend = int(int64_t(num) * (i + 1) / njob);
+		JobInfo* pInfo = &mpJobInfo[i];
+		pInfo->mpList = this;
+		pInfo->mOrg = jorg;
+		pInfo->mNum = jend - jorg;
+		sxJob* pJob = &mpJobs[i];
+		pJob->mFunc = record_job;
+		pJob->mpData = pInfo;
+		pJob->mId = i;
+		nxTask::queue_add(mpQue, pJob);
+	}
+	nxTask::queue_exec(mpQue, pBgd);
+	mListsNum = njob;
+}
+
+void List::flush(RecordFunc recFunc, ReplayFunc replayFunc, void* pUsr, cxBrigade* pBgd, const int minJobItems) {
+	bool recFlg = recFunc && mpRecs && mpRecFlags;
+	mRecFunc = recFunc;
+	mpRecUsr = pUsr;
+	mListsNum = 0;
+	for (int org = 0; org < mNum; org += mChunkSize) {
+		int n = nxCalc::min(mChunkSize, mNum - org);
+		if (recFlg) {
+			record_chunk(org, n, minJobItems, pBgd);
+		}
+		if (replayFunc) {
+			for (int i = 0; i < n; ++i) {
+				const Cmd& cmd = mpCmds[org + i];
+				const void* pRec = (recFlg && mpRecFlags[i]) ? &mpRecs[i * mRecSize] : nullptr;
+				const xt_xmtx* pXforms = cmd.mXformsOrg >= 0 ? &mpXforms[cmd.mXformsOrg] : nullptr;
+				replayFunc(pRec, cmd, pXforms, pUsr);
+			}
+		}
+	}
+	mRecFunc = nullptr;
+	mpRecUsr = nullptr;
+	clear();
+}
+
+} // DrawCmd
@@ -0,0 +1,82 @@
+namespace DrawCmd {
+
+struct Cmd {
+	void* mpObj;
+	void* mpWk;
+	const void* mpCtx;
+	int32_t mBatId;
+	int32_t mMode;
+	int32_t mXformsOrg; /* -1: single draw */
+	int32_t mInstNum;
+};
+
+/* CPU side of a command, called on any worker: writes at most the list's record size to pRec,
+   false if the command is to be replayed without recorded data */
+typedef bool (*RecordFunc)(void* pRec, const Cmd& cmd, void* pUsr);
+/* called on the flushing thread in command order, pRec is nullptr for commands that were not recorded */
+typedef void (*ReplayFunc)(const void* pRec, const Cmd& cmd, const xt_xmtx* pXforms, void* pUsr);
+
+/* Draw commands in submission order.
+   flush() works through the list in chunks: every chunk is split into contiguous per-worker lists that are recorded
+   in parallel on the brigade, each into its own slots, then the chunk is replayed in order on the calling thread.
+   The chunk size bounds the record memory; replay order is add order whatever the number of workers. */
+class List {
+protected:
+	struct JobInfo {
+		List* mpList;
+		int mOrg;
+		int mNum;
+	};
+
+	Cmd* mpCmds;
+	uint8_t* mpRecs;
+	uint8_t* mpRecFlags;
+	xt_xmtx* mpXforms;
+	sxJobQueue* mpQue;
+	sxJob* mpJobs;
+	JobInfo* mpJobInfo;
+	RecordFunc mRecFunc;
+	void* mpRecUsr;
+	size_t mRecSize;
+	int mChunkOrg;
+	int mChunkSize;
+	int mNum;
+	int mMax;
+	int mXformsNum;
+	int mXformsMax;
+	int mJobsMax;
+	int mListsNum;
+
+	void record_range(const int org, const int num);
+	void record_chunk(const int org, const int num, const int minJobItems, cxBrigade* pBgd);
+
+	static void record_job(const sxJobContext* pCtx);
+
+public:
+	List()
+	: mpCmds(nullptr), mpRecs(nullptr), mpRecFlags(nullptr), mpXforms(nullptr), mpQue(nullptr), mpJobs(nullptr), mpJobInfo(nullptr),
+	mRecFunc(nullptr), mpRecUsr(nullptr), mRecSize(0), mChunkOrg(0), mChunkSize(0), mNum(0), mMax(0),
+	mXformsNum(0), mXformsMax(0), mJobsMax(0), mListsNum(0) {}
+
+	~List() { reset(); }
+
+	void init(const size_t recSize, const int chunkSize = 1024, const int maxJobs = 0);
+	void reset();
+	void clear() {
+		mNum = 0;
+		mXformsNum = 0;
+	}
+
+	/* pXforms (ninst transforms) are copied; returns false if out of memory */
+	bool add(void* pObj, void* pWk, const void* pCtx, const int ibat, const int mode, const xt_xmtx* pXforms = nullptr, const int ninst = 0);
+	/* records and replays every command, then clears the list */
+	void flush(RecordFunc recFunc, ReplayFunc replayFunc, void* pUsr, cxBrigade* pBgd = nullptr, const int minJobItems = 16);
+
+	int get_num() const { return mNum; }
+	size_t get_rec_size() const { return mRecSize; }
+	int get_chunk_size() const { return mChunkSize; }
+	/* per-worker lists of the last recorded chunk */
+	int get_lists_num() const { return mListsNum; }
+};
+
+} // DrawCmd
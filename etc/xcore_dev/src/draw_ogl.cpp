@@ -4,6 +4,7 @@
 #include "crosscore.hpp"
 #include "oglsys.hpp"
 #include "draw.hpp"
+#include "draw_stats.hpp"
 
 #include "ogl/gpu_defs.h"
 
@@ -45,6 +46,9 @@ static uint32_t s_maxPrimIdx = 0;
 static GLuint s_quadVBO = 0;
 static GLuint s_quadIBO = 0;
 
+static GLuint s_instVBO = 0;
+static uint32_t s_maxInstXforms = 0;
+
 static Draw::Font* s_pFont = nullptr;
 static GLuint s_fontVBO = 0;
 static GLuint s_fontIBO = 0;
@@ -189,6 +193,9 @@ struct VtxLink {
 	GLint Jnt;
 	GLint Prm;
 	GLint Id;
+	GLint InstW0;
+	GLint InstW1;
+	GLint InstW2;
 
 	static int num_attrs() {
 		return int(sizeof(VtxLink) / sizeof(GLint));
@@ -416,6 +423,8 @@ struct GPUProg {
 	SmpLink mSmpLink;
 	VtxFmt mVtxFmt;
 	GLuint mVAO;
+	GPUProg* mpInst; /* instanced twin: same shading, world rows from per-instance attributes */
+	bool mInst;
 
 	template<typename T> struct CachedParam {
 		T mVal;
@@ -553,6 +562,9 @@ struct GPUProg {
 		VTX_LINK(Jnt);
 		VTX_LINK(Prm);
 		VTX_LINK(Id);
+		VTX_LINK(InstW0);
+		VTX_LINK(InstW1);
+		VTX_LINK(InstW2);
 
 		PARAM_LINK(PosBase);
 		PARAM_LINK(PosScale);
@@ -669,10 +681,12 @@ struct GPUProg {
 #if DRW_CACHE_PROGS
 		if (s_pNowProg != this) {
 			glUseProgram(mProgId);
+			DrawStats::count(DrawStats::PROG_CHANGES);
 			s_pNowProg = this;
 		}
 #else
 		glUseProgram(mProgId);
+		DrawStats::count(DrawStats::PROG_CHANGES);
 #endif
 	}
 
@@ -687,6 +701,27 @@ struct GPUProg {
 		mVtxLink.disable_all();
 	}
 
+	/* xt_xmtx rows at org in the bound array buffer, advanced once per instance */
+	void enable_inst_attrs(const size_t org) const {
+		const GLint attrs[] = { mVtxLink.InstW0, mVtxLink.InstW1, mVtxLink.InstW2 };
+		for (int i = 0; i < 3; ++i) {
+			if (attrs[i] >= 0) {
+				glEnableVertexAttribArray(attrs[i]);
+				glVertexAttribPointer(attrs[i], 4, GL_FLOAT, GL_FALSE, sizeof(xt_xmtx), (const void*)(org + i * sizeof(xt_float4)));
+				OGLSys::set_attr_divisor(attrs[i], 1);
+			}
+		}
+	}
+
+	void reset_inst_attrs() const {
+		const GLint attrs[] = { mVtxLink.InstW0, mVtxLink.InstW1, mVtxLink.InstW2 };
+		for (int i = 0; i < 3; ++i) {
+			if (attrs[i] >= 0) {
+				OGLSys::set_attr_divisor(attrs[i], 0);
+			}
+		}
+	}
+
 	void set_view_proj(const xt_mtx& m) {
 		mCache.mViewProj.set(mParamLink.ViewProj, m);
 	}
@@ -999,6 +1034,10 @@ void GPUProg::enable_attrs(const int minIdx, const size_t vtxSize) const {
 #include "ogl/progs.inc"
 #undef GPU_PROG
 
+#define GPU_PROG_INST(_vert, _frag) static GPUProg s_prg_##_vert##_inst_##_frag = {};
+#include "ogl/progs_inst.inc"
+#undef GPU_PROG_INST
+
 
 static void prepare_texture(sxTextureData* pTex) {
 	if (!pTex) return;
@@ -1065,6 +1104,8 @@ static void prepare_model(sxModelData* pMdl) {
 			if (*pBufVB) {
 				glBindBuffer(GL_ARRAY_BUFFER, *pBufVB);
 				glBufferData(GL_ARRAY_BUFFER, pMdl->mPntNum * vsize, pPntData, GL_STATIC_DRAW);
+				DrawStats::count(DrawStats::BUF_UPLOADS);
+				DrawStats::count(DrawStats::UPLOAD_BYTES, pMdl->mPntNum * vsize);
 				glBindBuffer(GL_ARRAY_BUFFER, 0);
 			}
 		}
@@ -1076,6 +1117,8 @@ static void prepare_model(sxModelData* pMdl) {
 			if (*pBufIB16) {
 				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *pBufIB16);
 				glBufferData(GL_ELEMENT_ARRAY_BUFFER, pMdl->mIdx16Num * sizeof(uint16_t), pIdxData, GL_STATIC_DRAW);
+				DrawStats::count(DrawStats::BUF_UPLOADS);
+				DrawStats::count(DrawStats::UPLOAD_BYTES, pMdl->mIdx16Num * sizeof(uint16_t));
 				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 			}
 		}
@@ -1087,6 +1130,8 @@ static void prepare_model(sxModelData* pMdl) {
 			if (*pBufIB32) {
 				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, *pBufIB32);
 				glBufferData(GL_ELEMENT_ARRAY_BUFFER, pMdl->mIdx32Num * sizeof(uint32_t), pIdxData, GL_STATIC_DRAW);
+				DrawStats::count(DrawStats::BUF_UPLOADS);
+				DrawStats::count(DrawStats::UPLOAD_BYTES, pMdl->mIdx32Num * sizeof(uint32_t));
 				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 			}
 		}
@@ -1123,7 +1168,7 @@ bool is_mdl_prepared(sxModelData* pMdl) {
 	return bufVB && (bufIB16 || bufIB32);
 }
 
-static void batch_draw_exec(const sxModelData* pMdl, int ibat, int baseVtx = 0) {
+static void batch_draw_exec(const sxModelData* pMdl, int ibat, int baseVtx = 0, int ninst = 1) {
 	if (!pMdl) return;
 	const sxModelData::Batch* pBat = pMdl->get_batch_ptr(ibat);
 	if (!pBat) return;
@@ -1145,11 +1190,15 @@ static void batch_draw_exec(const sxModelData* pMdl, int ibat, int baseVtx = 0)
 		org = pBat->mIdxOrg * sizeof(uint32_t);
 		typ = GL_UNSIGNED_INT;
 	}
-	if (baseVtx > 0) {
+	if (ninst > 1) {
+		OGLSys::draw_tris_inst(pBat->mTriNum, typ, org, ninst);
+	} else if (baseVtx > 0) {
 		OGLSys::draw_tris_base_vtx(pBat->mTriNum, typ, org, baseVtx);
 	} else {
 		glDrawElements(GL_TRIANGLES, pBat->mTriNum * 3, typ, (const void*)org);
 	}
+	DrawStats::count(DrawStats::DRAW_CALLS);
+	DrawStats::count(DrawStats::TRIS, pBat->mTriNum * nxCalc::max(ninst, 1));
 }
 
 static bool s_nowSemi = false;
@@ -1311,6 +1360,7 @@ static void init(int shadowSize, cxResourceManager* pRsrcMgr, Draw::Font* pFont)
 
 	int prgCnt = 0;
 	int prgOK = 0;
+	bool instFlg = OGLSys::ext_ck_instancing();
 	if (s_glslEcho) {
 		nxCore::dbg_msg("Initializing GPU progs");
 	}
@@ -1320,10 +1370,20 @@ static void init(int shadowSize, cxResourceManager* pRsrcMgr, Draw::Font* pFont)
 #		define GPU_PROG(_vert_name, _frag_name) s_prg_##_vert_name##_##_frag_name.init(VtxFmt_##_vert_name, s_sdr_##_vert_name##_vert, s_sdr_##_frag_name##_frag, #_vert_name, #_frag_name); ++prgCnt; if (s_prg_##_vert_name##_##_frag_name.is_valid()) {++prgOK; if (s_glslEcho) { nxCore::dbg_msg("."); } } else { nxCore::dbg_msg("GPUProg init error: %s + %s\n", #_vert_name, #_frag_name); }
 #		include "ogl/progs.inc"
 #		undef GPU_PROG
+		if (instFlg) {
+#			define GPU_PROG_INST(_vert_name, _frag_name) s_prg_##_vert_name##_inst_##_frag_name.init(VtxFmt_##_vert_name, s_sdr_##_vert_name##_inst_vert, s_sdr_##_frag_name##_frag, #_vert_name "_inst", #_frag_name); ++prgCnt; if (s_prg_##_vert_name##_inst_##_frag_name.is_valid()) {++prgOK; if (s_glslEcho) { nxCore::dbg_msg("."); } } else { nxCore::dbg_msg("GPUProg init error: %s + %s\n", #_vert_name "_inst", #_frag_name); }
+#			include "ogl/progs_inst.inc"
+#			undef GPU_PROG_INST
+		}
 	} else {
 #		define GPU_PROG(_vert_name, _frag_name) ++prgCnt;
 #		include "ogl/progs.inc"
 #		undef GPU_PROG
+		if (instFlg) {
+#			define GPU_PROG_INST(_vert_name, _frag_name) ++prgCnt;
+#			include "ogl/progs_inst.inc"
+#			undef GPU_PROG_INST
+		}
 		if (prgCnt > 0) {
 			GPUProg** ppProg = (GPUProg**)nxCore::mem_alloc(sizeof(GPUProg*)*prgCnt, "GPUProgsList");
 			if (ppProg) {
@@ -1331,6 +1391,11 @@ static void init(int shadowSize, cxResourceManager* pRsrcMgr, Draw::Font* pFont)
 #				define GPU_PROG(_vert_name, _frag_name) ppProg[iprg] = &s_prg_##_vert_name##_##_frag_name; ppProg[iprg]->mVtxFmt = VtxFmt_##_vert_name; ppProg[iprg]->mVertSID = s_sdr_##_vert_name##_vert; ppProg[iprg]->mFragSID = s_sdr_##_frag_name##_frag; ppProg[iprg]->mpVertName = #_vert_name; ppProg[iprg]->mpFragName = #_frag_name; ++iprg;
 #				include "ogl/progs.inc"
 #				undef GPU_PROG
+				if (instFlg) {
+#					define GPU_PROG_INST(_vert_name, _frag_name) ppProg[iprg] = &s_prg_##_vert_name##_inst_##_frag_name; ppProg[iprg]->mVtxFmt = VtxFmt_##_vert_name; ppProg[iprg]->mVertSID = s_sdr_##_vert_name##_inst_vert; ppProg[iprg]->mFragSID = s_sdr_##_frag_name##_frag; ppProg[iprg]->mpVertName = #_vert_name "_inst"; ppProg[iprg]->mpFragName = #_frag_name; ++iprg;
+#					include "ogl/progs_inst.inc"
+#					undef GPU_PROG_INST
+				}
 				for (iprg = 0; iprg < prgCnt; ++iprg) {
 					GPUProg* pProg = ppProg[iprg];
 					pProg->mProgId = glCreateProgram();
@@ -1371,6 +1436,10 @@ static void init(int shadowSize, cxResourceManager* pRsrcMgr, Draw::Font* pFont)
 	}
 	double prgDT = nxSys::time_micros() - prgT0;
 
+#define GPU_PROG_INST(_vert_name, _frag_name) s_prg_##_vert_name##_inst_##_frag_name.mInst = true; s_prg_##_vert_name##_##_frag_name.mpInst = s_prg_##_vert_name##_inst_##_frag_name.is_valid() ? &s_prg_##_vert_name##_inst_##_frag_name : nullptr;
+#include "ogl/progs_inst.inc"
+#undef GPU_PROG_INST
+
 	nxCore::dbg_msg("GPU progs: %d/%d\n", prgOK, prgCnt);
 	if (s_glslEcho) {
 		nxCore::dbg_msg("GPU progs init time: %.3f seconds\n", prgDT / 1.0e6);
@@ -1484,6 +1553,12 @@ static void reset() {
 		glDeleteBuffers(1, &s_quadIBO);
 		s_quadIBO = 0;
 	}
+
+	if (s_instVBO) {
+		glDeleteBuffers(1, &s_instVBO);
+		s_instVBO = 0;
+		s_maxInstXforms = 0;
+	}
 	if (s_quadVBO) {
 		glDeleteBuffers(1, &s_quadVBO);
 		s_quadVBO = 0;
@@ -1504,6 +1579,10 @@ static void reset() {
 #include "ogl/progs.inc"
 #undef GPU_PROG
 
+#define GPU_PROG_INST(_vert_name, _frag_name) s_prg_##_vert_name##_inst_##_frag_name.reset(); s_prg_##_vert_name##_##_frag_name.mpInst = nullptr;
+#include "ogl/progs_inst.inc"
+#undef GPU_PROG_INST
+
 #define GPU_SHADER(_name, _kind) glDeleteShader(s_sdr_##_name##_##_kind); s_sdr_##_name##_##_kind = 0;
 #include "ogl/shaders.inc"
 #undef GPU_SHADER
@@ -1891,17 +1970,28 @@ static GPUProg* prog_sel(const cxModelWork* pWk, const int ibat, const sxModelDa
 
 #define HAS_PARAM(_name) (pProg->mParamLink._name >= 0)
 
-static void batch(cxModelWork* pWk, const int ibat, const Draw::Mode mode, const Draw::Context* pCtx) {
-	float ftmp[NFLT_JMTX > NFLT_JMAP ? NFLT_JMTX : NFLT_JMAP];
-
-	if (!pCtx) return;
+/* per-batch constants that only depend on the work, the material and the context: packed on any thread, uploaded by batch_setup() */
+struct BatchPrep {
+	const sxModelData::Material* pMtl;
+	xt_xmtx world;
+	xt_float4 shadowCtrl;
+	xt_float3 baseClr;
+	xt_float3 alphaCtrl;
+	bool skinMtx;
+	int32_t nmap; /* SkinMap vectors, 0: none */
+	float skin[NFLT_JMTX];
+	float jmap[NFLT_JMAP];
+};
 
-	if (!pWk) return;
-	sxModelData* pMdl = pWk->mpData;
-	if (!pMdl) return;
-	if (!pMdl->ck_batch_id(ibat)) return;
+static bool batch_prep(BatchPrep* pPrep, const cxModelWork* pWk, const int ibat, const Draw::Mode mode, const Draw::Context* pCtx) {
+	if (!pPrep) return false;
+	if (!pCtx) return false;
+	if (!pWk) return false;
+	const sxModelData* pMdl = pWk->mpData;
+	if (!pMdl) return false;
+	if (!pMdl->ck_batch_id(ibat)) return false;
 
-	Draw::MdlParam* pParam = (Draw::MdlParam*)pWk->mpParamMem;
+	const Draw::MdlParam* pParam = (const Draw::MdlParam*)pWk->mpParamMem;
 
 	bool isShadowCast = (mode == Draw::DRWMODE_SHADOW_CAST);
 	bool isDiscard = (mode == Draw::DRWMODE_DISCARD);
@@ -1916,11 +2006,92 @@ static void batch(cxModelWork* pWk, const int ibat, const Draw::Mode mode, const
 			}
 		}
 	}
-	if (!pMtl) return;
+	if (!pMtl) return false;
+	pPrep->pMtl = pMtl;
+
+	if (pWk->mpWorldXform) {
+		pPrep->world = *pWk->mpWorldXform;
+	} else {
+		pPrep->world.identity();
+	}
+
+	pPrep->skinMtx = false;
+	pPrep->nmap = 0;
+	const int32_t* pJntLst = pMdl->get_batch_jnt_list(ibat);
+	if (pWk->mpSkinXforms) {
+		xt_xmtx* pSkin = (xt_xmtx*)pPrep->skin;
+		for (int i = 0; i < pBat->mJntNum; ++i) {
+			pSkin[i] = pWk->mpSkinXforms[pJntLst[i]];
+		}
+		pPrep->skinMtx = true;
+	}
+	if (pJntLst) {
+		float* pMap = pPrep->jmap;
+		::memset(pMap, 0, NFLT_JMAP * sizeof(float));
+		int njnt = pBat->mJntNum;
+		for (int i = 0; i < njnt; ++i) {
+			pMap[pJntLst[i]] = float(i);
+		}
+		for (int i = 0; i < NFLT_JMAP; ++i) {
+			pMap[i] *= 3.0f;
+		}
+#if DRW_LIMIT_JMAP
+		int njmax = pJntLst[njnt - 1] + 1;
+		pPrep->nmap = (njmax >> 2) + ((njmax & 3) != 0 ? 1 : 0);
+#else
+		pPrep->nmap = JMAP_SIZE;
+#endif
+	}
+
+	float swght = pMtl->mShadowWght;
+	if (pParam) {
+		swght += pParam->shadowWeightBias;
+	}
+	if (swght > 0.0f) {
+		swght = nxCalc::max(swght + pCtx->shadow.mWghtBias, 1.0f);
+	}
+	float soffs = pMtl->mShadowOffs + pCtx->shadow.mOffsBias;
+	if (pParam) {
+		soffs += pParam->shadowOffsBias;
+	}
+	float sdens = pMtl->mShadowDensity * pCtx->shadow.get_density();
+	if (pParam) {
+		sdens *= nxCalc::saturate(pParam->shadowDensScl);
+	}
+	pPrep->shadowCtrl.set(soffs, swght, sdens, 0.0f);
+
+	pPrep->baseClr = pMtl->mBaseColor;
+	if (pParam) {
+		for (int i = 0; i < 3; ++i) {
+			pPrep->baseClr[i] *= pParam->baseColorScl[i];
+		}
+	}
+
+	float alphaLim = isShadowCast ? pMtl->mShadowAlphaLim : pMtl->mAlphaLim;
+	if (isDiscard) {
+		if (alphaLim <= 0.0f) {
+			alphaLim = pMtl->mShadowAlphaLim;
+		}
+	}
+	pPrep->alphaCtrl.set(alphaLim, 0.0f, 0.0f);
+
+	return true;
+}
+
+/* inst: the instanced twin of the selected program is used when there is one */
+static GPUProg* batch_setup(cxModelWork* pWk, const int ibat, const Draw::Mode mode, const Draw::Context* pCtx, const BatchPrep& prep, const bool inst = false) {
+	sxModelData* pMdl = pWk->mpData;
+	const sxModelData::Material* pMtl = prep.pMtl;
+
+	bool isShadowCast = (mode == Draw::DRWMODE_SHADOW_CAST);
+	bool isDiscard = (mode == Draw::DRWMODE_DISCARD);
 
 	GPUProg* pProg = prog_sel(pWk, ibat, pMtl, mode, pCtx);
-	if (!pProg) return;
-	if (!pProg->is_valid()) return;
+	if (!pProg) return nullptr;
+	if (inst && pProg->mpInst) {
+		pProg = pProg->mpInst;
+	}
+	if (!pProg->is_valid()) return nullptr;
 
 	if (isShadowCast) {
 		set_shadow_framebuf();
@@ -1938,43 +2109,15 @@ static void batch(cxModelWork* pWk, const int ibat, const Draw::Mode mode, const
 	pProg->set_view_pos(pCtx->view.mPos);
 
 	if (HAS_PARAM(World)) {
-		xt_xmtx wm;
-		if (pWk->mpWorldXform) {
-			wm = *pWk->mpWorldXform;
-		} else {
-			wm.identity();
-		}
-		pProg->set_world(wm);
+		pProg->set_world(prep.world);
 	}
 
-	if (HAS_PARAM(SkinMtx) && pWk->mpSkinXforms) {
-		xt_xmtx* pSkin = (xt_xmtx*)ftmp;
-		const int32_t* pJntLst = pMdl->get_batch_jnt_list(ibat);
-		for (int i = 0; i < pBat->mJntNum; ++i) {
-			pSkin[i] = pWk->mpSkinXforms[pJntLst[i]];
-		}
-		glUniform4fv(pProg->mParamLink.SkinMtx, JMTX_SIZE, (const GLfloat*)pSkin);
+	if (HAS_PARAM(SkinMtx) && prep.skinMtx) {
+		glUniform4fv(pProg->mParamLink.SkinMtx, JMTX_SIZE, (const GLfloat*)prep.skin);
 	}
 
-	if (HAS_PARAM(SkinMap)) {
-		const int32_t* pJntLst = pMdl->get_batch_jnt_list(ibat);
-		if (pJntLst) {
-			::memset(ftmp, 0, NFLT_JMAP * sizeof(float));
-			int njnt = pBat->mJntNum;
-			for (int i = 0; i < njnt; ++i) {
-				ftmp[pJntLst[i]] = float(i);
-			}
-			for (int i = 0; i < NFLT_JMAP; ++i) {
-				ftmp[i] *= 3.0f;
-			}
-#if DRW_LIMIT_JMAP
-			int njmax = pJntLst[njnt - 1] + 1;
-			int nv = (njmax >> 2) + ((njmax & 3) != 0 ? 1 : 0);
-			glUniform4fv(pProg->mParamLink.SkinMap, nv, ftmp);
-#else
-			glUniform4fv(pProg->mParamLink.SkinMap, JMAP_SIZE, ftmp);
-#endif
-		}
+	if (HAS_PARAM(SkinMap) && prep.nmap > 0) {
+		glUniform4fv(pProg->mParamLink.SkinMap, prep.nmap, prep.jmap);
 	}
 
 	if (HAS_PARAM(PosBase)) {
@@ -2023,28 +2166,7 @@ static void batch(cxModelWork* pWk, const int ibat, const Draw::Mode mode, const
 	}
 
 	if (HAS_PARAM(ShadowCtrl)) {
-		xt_float4 shadowCtrl;
-
-		float swght = pMtl->mShadowWght;
-		if (pParam) {
-			swght += pParam->shadowWeightBias;
-		}
-		if (swght > 0.0f) {
-			swght = nxCalc::max(swght + pCtx->shadow.mWghtBias, 1.0f);
-		}
-
-		float soffs = pMtl->mShadowOffs + pCtx->shadow.mOffsBias;
-		if (pParam) {
-			soffs += pParam->shadowOffsBias;
-		}
-
-		float sdens = pMtl->mShadowDensity * pCtx->shadow.get_density();
-		if (pParam) {
-			sdens *= nxCalc::saturate(pParam->shadowDensScl);
-		}
-
-		shadowCtrl.set(soffs, swght, sdens, 0.0f);
-		pProg->set_shadow_ctrl(shadowCtrl);
+		pProg->set_shadow_ctrl(prep.shadowCtrl);
 	}
 
 	if (HAS_PARAM(ShadowFade)) {
@@ -2054,13 +2176,7 @@ static void batch(cxModelWork* pWk, const int ibat, const Draw::Mode mode, const
 	}
 
 	if (HAS_PARAM(BaseColor)) {
-		xt_float3 baseClr = pMtl->mBaseColor;
-		if (pParam) {
-			for (int i = 0; i < 3; ++i) {
-				baseClr[i] *= pParam->baseColorScl[i];
-			}
-		}
-		pProg->set_base_color(baseClr);
+		pProg->set_base_color(prep.baseClr);
 	}
 
 	pProg->set_spec_color(pMtl->mSpecColor);
@@ -2080,15 +2196,7 @@ static void batch(cxModelWork* pWk, const int ibat, const Draw::Mode mode, const
 	}
 
 	if (HAS_PARAM(AlphaCtrl)) {
-		float alphaLim = isShadowCast ? pMtl->mShadowAlphaLim : pMtl->mAlphaLim;
-		if (isDiscard) {
-			if (alphaLim <= 0.0f) {
-				alphaLim = pMtl->mShadowAlphaLim;
-			}
-		}
-		xt_float3 alphaCtrl;
-		alphaCtrl.set(alphaLim, 0.0f, 0.0f);
-		pProg->set_alpha_ctrl(alphaCtrl);
+		pProg->set_alpha_ctrl(prep.alphaCtrl);
 	}
 
 	pProg->set_fog_color(pCtx->fog.mColor);
@@ -2120,6 +2228,7 @@ static void batch(cxModelWork* pWk, const int ibat, const Draw::Mode mode, const
 		}
 		glActiveTexture(GL_TEXTURE0 + Draw::TEXUNIT_Base);
 		glBindTexture(GL_TEXTURE_2D, htex);
+		DrawStats::count(DrawStats::TEX_BINDS);
 	}
 
 	if (pProg->mSmpLink.Bump >= 0 && s_pRsrcMgr) {
@@ -2135,6 +2244,7 @@ static void batch(cxModelWork* pWk, const int ibat, const Draw::Mode mode, const
 			if (*pTexHandle) {
 				glActiveTexture(GL_TEXTURE0 + Draw::TEXUNIT_Bump);
 				glBindTexture(GL_TEXTURE_2D, *pTexHandle);
+				DrawStats::count(DrawStats::TEX_BINDS);
 			}
 		}
 	}
@@ -2142,6 +2252,7 @@ static void batch(cxModelWork* pWk, const int ibat, const Draw::Mode mode, const
 	if (pProg->mSmpLink.Shadow >= 0) {
 		glActiveTexture(GL_TEXTURE0 + Draw::TEXUNIT_Shadow);
 		glBindTexture(GL_TEXTURE_2D, s_shadowTex);
+		DrawStats::count(DrawStats::TEX_BINDS);
 	}
 
 	if (isShadowCast || (isDiscard && !pMtl->mFlags.forceBlend)) {
@@ -2160,29 +2271,107 @@ static void batch(cxModelWork* pWk, const int ibat, const Draw::Mode mode, const
 		set_face_cull();
 	}
 
-	GLuint* pBufIds = pMdl->get_gpu_wk<GLuint>();
+	return pProg;
+}
+
+/* the buffer is orphaned on every upload, draws still reading the previous transforms do not hold it up */
+static bool inst_xforms_upload(const xt_xmtx* pXforms, const int ninst) {
+	if (!pXforms || ninst <= 0) return false;
+	if (!s_instVBO) {
+		glGenBuffers(1, &s_instVBO);
+		if (!s_instVBO) return false;
+	}
+	if (uint32_t(ninst) > s_maxInstXforms) {
+		s_maxInstXforms = nxCalc::max(uint32_t(ninst), s_maxInstXforms * 2);
+	}
+	GLsizeiptr len = ninst * sizeof(xt_xmtx);
+	glBindBuffer(GL_ARRAY_BUFFER, s_instVBO);
+	glBufferData(GL_ARRAY_BUFFER, s_maxInstXforms * sizeof(xt_xmtx), nullptr, GL_DYNAMIC_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, len, pXforms);
+	DrawStats::count(DrawStats::BUF_UPLOADS);
+	DrawStats::count(DrawStats::UPLOAD_BYTES, len);
+	return true;
+}
+
+/* pXforms with an instanced program: one instanced draw, otherwise the batch is drawn with every transform in turn */
+static bool batch_exec(GPUProg* pProg, const sxModelData* pMdl, const int ibat, const xt_xmtx* pXforms, const int ninst) {
+	const sxModelData::Batch* pBat = pMdl->get_batch_ptr(ibat);
+	const GLuint* pBufIds = pMdl->get_gpu_wk<GLuint>();
 	GLuint bufVB = pBufIds[0];
-	if (!bufVB) return;
+	if (!bufVB) return false;
 	if (pProg->mVAO) {
 		OGLSys::bind_vao(pProg->mVAO);
-		glBindBuffer(GL_ARRAY_BUFFER, bufVB);
-		pProg->enable_attrs(pBat->mMinIdx, pMdl->get_vtx_size());
-		batch_draw_exec(pMdl, ibat);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, bufVB);
+	pProg->enable_attrs(pBat->mMinIdx, pMdl->get_vtx_size());
+	bool res = true;
+	if (pProg->mInst) {
+		res = inst_xforms_upload(pXforms, ninst);
+		if (res) {
+			pProg->enable_inst_attrs(0);
+			batch_draw_exec(pMdl, ibat, 0, ninst);
+		}
+	} else {
+		for (int i = 0; i < ninst; ++i) {
+			if (pXforms && HAS_PARAM(World)) {
+				pProg->set_world(pXforms[i]);
+			}
+			batch_draw_exec(pMdl, ibat);
+		}
+	}
+	if (pProg->mVAO) {
 		OGLSys::bind_vao(0);
 	} else {
-		glBindBuffer(GL_ARRAY_BUFFER, bufVB);
-		pProg->enable_attrs(pBat->mMinIdx, pMdl->get_vtx_size());
-		batch_draw_exec(pMdl, ibat);
 		pProg->disable_attrs();
+		if (pProg->mInst) {
+			pProg->reset_inst_attrs();
+		}
 	}
+	return res;
+}
 
-	++s_batDrwCnt;
-
-	if (isShadowCast) {
-		++s_shadowCastCnt;
+static void batch_submit_prep(const BatchPrep& prep, cxModelWork* pWk, const int ibat, const Draw::Mode mode, const Draw::Context* pCtx, const xt_xmtx* pXforms, const int ninst) {
+	int n = pXforms ? ninst : 1;
+	GPUProg* pProg = batch_setup(pWk, ibat, mode, pCtx, prep, n > 1);
+	if (!pProg) return;
+	if (!batch_exec(pProg, pWk->mpData, ibat, pXforms, n)) return;
+	s_batDrwCnt += n;
+	DrawStats::count(DrawStats::BATCHES, n);
+	if (mode == Draw::DRWMODE_SHADOW_CAST) {
+		s_shadowCastCnt += n;
 	}
 }
 
+static void batch(cxModelWork* pWk, const int ibat, const Draw::Mode mode, const Draw::Context* pCtx) {
+	BatchPrep prep;
+	if (!batch_prep(&prep, pWk, ibat, mode, pCtx)) return;
+	batch_submit_prep(prep, pWk, ibat, mode, pCtx, nullptr, 0);
+}
+
+/* rigid models: program, textures and the rest of the state are set up once from pWk, then the batch is drawn
+   with glDrawElementsInstanced through the instanced twin of the program (one draw per transform without instancing support) */
+static void batch_inst(cxModelWork* pWk, const int ibat, const Draw::Mode mode, const Draw::Context* pCtx, const xt_xmtx* pXforms, const int ninst) {
+	if (!pWk || !pXforms || ninst <= 0) return;
+	if (!pWk->mpData || pWk->mpData->has_skin()) return;
+	BatchPrep prep;
+	if (!batch_prep(&prep, pWk, ibat, mode, pCtx)) return;
+	batch_submit_prep(prep, pWk, ibat, mode, pCtx, pXforms, ninst);
+}
+
+static size_t get_batch_prep_size() {
+	return sizeof(BatchPrep);
+}
+
+static bool batch_prep_ifc(void* pPrep, const cxModelWork* pWk, const int ibat, const Draw::Mode mode, const Draw::Context* pCtx) {
+	return batch_prep((BatchPrep*)pPrep, pWk, ibat, mode, pCtx);
+}
+
+static void batch_submit(const void* pPrep, cxModelWork* pWk, const int ibat, const Draw::Mode mode, const Draw::Context* pCtx, const xt_xmtx* pXforms, const int ninst) {
+	if (!pPrep || !pWk || !pCtx) return;
+	if (pXforms && (ninst <= 0 || !pWk->mpData || pWk->mpData->has_skin())) return;
+	batch_submit_prep(*(const BatchPrep*)pPrep, pWk, ibat, mode, pCtx, pXforms, ninst);
+}
+
 void quad(const Draw::Quad* pQuad) {
 	if (!pQuad) return;
 	if (pQuad->color.a <= 0.0f) return;
@@ -2260,6 +2449,7 @@ void quad(const Draw::Quad* pQuad) {
 	}
 	glActiveTexture(GL_TEXTURE0 + Draw::TEXUNIT_Base);
 	glBindTexture(GL_TEXTURE_2D, htex);
+	DrawStats::count(DrawStats::TEX_BINDS);
 	if (pProg->mVAO) {
 		OGLSys::bind_vao(pProg->mVAO);
 	}
@@ -2267,6 +2457,8 @@ void quad(const Draw::Quad* pQuad) {
 	pProg->enable_attrs(0);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, s_quadIBO);
 	glDrawElements(GL_TRIANGLE_STRIP, 4, GL_UNSIGNED_SHORT, (const void*)0);
+	DrawStats::count(DrawStats::DRAW_CALLS);
+	DrawStats::count(DrawStats::TRIS, 2);
 	if (pProg->mVAO) {
 		OGLSys::bind_vao(0);
 	} else {
@@ -2320,6 +2512,8 @@ void symbol(const Draw::Symbol* pSym) {
 	pProg->enable_attrs(0);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, s_fontIBO);
 	glDrawElements(GL_TRIANGLES, pInfo->numTris * 3, GL_UNSIGNED_SHORT, (const void*)(pInfo->idxOrg * sizeof(uint16_t)));
+	DrawStats::count(DrawStats::DRAW_CALLS);
+	DrawStats::count(DrawStats::TRIS, pInfo->numTris);
 	if (pProg->mVAO) {
 		OGLSys::bind_vao(0);
 	} else {
@@ -2366,6 +2560,8 @@ static void prim_geom_vtx(const uint32_t org, const uint32_t num, const sxPrimVt
 	glBindBuffer(GL_ARRAY_BUFFER, s_primVBO);
 	GLintptr offs = org * sizeof(sxPrimVtx);
 	GLsizeiptr len = num * sizeof(sxPrimVtx);
+	DrawStats::count(DrawStats::BUF_UPLOADS);
+	DrawStats::count(DrawStats::UPLOAD_BYTES, len);
 #if 1
 	glBufferSubData(GL_ARRAY_BUFFER, offs, len, pSrc);
 #else
@@ -2386,6 +2582,8 @@ static void prim_geom_idx(const uint32_t org, const uint32_t num, const uint16_t
 	GLintptr offs = org * sizeof(uint16_t);
 	GLsizeiptr len = num * sizeof(uint16_t);
 	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offs, len, pSrc);
+	DrawStats::count(DrawStats::BUF_UPLOADS);
+	DrawStats::count(DrawStats::UPLOAD_BYTES, len);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
@@ -2419,7 +2617,12 @@ void prim(const Draw::Prim* pPrim, const Draw::Context* pCtx) {
 	if (!htex) {
 		htex = OGLSys::get_white_tex();
 	}
-	set_def_framebuf();
+	bool scrFlg = pPrim->screen && pPrim->type == Draw::PRIMTYPE_POLY;
+	if (scrFlg) {
+		set_screen_framebuf();
+	} else {
+		set_def_framebuf();
+	}
 	OGLSys::enable_msaa(true);
 	if (pPrim->alphaBlend) {
 		set_semi();
@@ -2433,12 +2636,36 @@ void prim(const Draw::Prim* pPrim, const Draw::Context* pCtx) {
 	}
 	pProg->use();
 
-	pProg->set_view_proj(pCtx->view.mViewProjMtx);
-	pProg->set_view_pos(pCtx->view.mPos);
+	if (scrFlg) {
+		/* identity transforms and neutral lighting/CC, so that the result is the quad shader's */
+		cxMtx im;
+		im.identity();
+		pProg->set_view_proj(im);
+		pProg->set_view_pos(cxVec(0.0f));
+	} else {
+		pProg->set_view_proj(pCtx->view.mViewProjMtx);
+		pProg->set_view_pos(pCtx->view.mPos);
+	}
 
 	xt_float4 ctrl;
 	ctrl.fill(0.0f);
-	if (pPrim->type == Draw::PRIMTYPE_SPRITE) {
+	if (scrFlg) {
+		if (HAS_PARAM(World)) {
+			cxMtx im;
+			im.identity();
+			pProg->set_world(nxMtx::xmtx_from_mtx(im));
+		}
+		xt_float3 one;
+		one.fill(1.0f);
+		pProg->set_vtx_hemi_upper(one);
+		pProg->set_vtx_hemi_lower(one);
+		pProg->set_vtx_hemi_up(pCtx->hemi.mUp);
+		if (HAS_PARAM(VtxHemiParam)) {
+			xt_float3 hparam;
+			hparam.set(1.0f, 1.0f, 0.0f);
+			pProg->set_vtx_hemi_param(hparam);
+		}
+	} else if (pPrim->type == Draw::PRIMTYPE_SPRITE) {
 		ctrl.x = 1.0f;
 		if (HAS_PARAM(InvView)) {
 			pProg->set_inv_view(pCtx->view.mInvViewMtx);
@@ -2466,18 +2693,37 @@ void prim(const Draw::Prim* pPrim, const Draw::Context* pCtx) {
 	}
 	pProg->set_prim_ctrl(ctrl);
 
-	pProg->set_fog_color(pCtx->fog.mColor);
-	pProg->set_fog_param(pCtx->fog.mParam);
+	if (scrFlg) {
+		xt_float4 fogZero;
+		fogZero.fill(0.0f);
+		pProg->set_fog_color(fogZero);
+		pProg->set_fog_param(fogZero);
+		xt_float3 one;
+		one.fill(1.0f);
+		xt_float3 zero;
+		zero.fill(0.0f);
+		pProg->set_inv_white(one);
+		pProg->set_lclr_gain(one);
+		pProg->set_lclr_bias(zero);
+		pProg->set_exposure(zero);
+		xt_float3 invGamma;
+		invGamma.set(nxCalc::rcp0(pPrim->gamma.x), nxCalc::rcp0(pPrim->gamma.y), nxCalc::rcp0(pPrim->gamma.z));
+		pProg->set_inv_gamma(invGamma);
+	} else {
+		pProg->set_fog_color(pCtx->fog.mColor);
+		pProg->set_fog_param(pCtx->fog.mParam);
 
-	pProg->set_inv_white(pCtx->cc.mToneMap.get_inv_white());
-	pProg->set_lclr_gain(pCtx->cc.mToneMap.mLinGain);
-	pProg->set_lclr_bias(pCtx->cc.mToneMap.mLinBias);
-	pProg->set_exposure(pCtx->cc.mExposure);
-	pProg->set_inv_gamma(pCtx->cc.get_inv_gamma());
+		pProg->set_inv_white(pCtx->cc.mToneMap.get_inv_white());
+		pProg->set_lclr_gain(pCtx->cc.mToneMap.mLinGain);
+		pProg->set_lclr_bias(pCtx->cc.mToneMap.mLinBias);
+		pProg->set_exposure(pCtx->cc.mExposure);
+		pProg->set_inv_gamma(pCtx->cc.get_inv_gamma());
+	}
 
 	if (pProg->mSmpLink.Base >= 0) {
 		glActiveTexture(GL_TEXTURE0 + Draw::TEXUNIT_Base);
 		glBindTexture(GL_TEXTURE_2D, htex);
+		DrawStats::count(DrawStats::TEX_BINDS);
 	}
 
 	if (pProg->mVAO) {
@@ -2488,9 +2734,12 @@ void prim(const Draw::Prim* pPrim, const Draw::Context* pCtx) {
 	if (inum > 0) {
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, s_primIBO);
 		glDrawElements(GL_TRIANGLES, inum, GL_UNSIGNED_SHORT, (const void*)(iorg * sizeof(uint16_t)));
+		DrawStats::count(DrawStats::TRIS, inum / 3);
 	} else {
 		glDrawArrays(GL_TRIANGLES, vorg, vnum);
+		DrawStats::count(DrawStats::TRIS, vnum / 3);
 	}
+	DrawStats::count(DrawStats::DRAW_CALLS);
 	if (pProg->mVAO) {
 		OGLSys::bind_vao(0);
 	} else {
@@ -2516,6 +2765,10 @@ struct DrwInit {
 		s_ifc.begin = begin;
 		s_ifc.end = end;
 		s_ifc.batch = batch;
+		s_ifc.batch_inst = batch_inst;
+		s_ifc.get_batch_prep_size = get_batch_prep_size;
+		s_ifc.batch_prep = batch_prep_ifc;
+		s_ifc.batch_submit = batch_submit;
 		s_ifc.prim = prim;
 		s_ifc.quad = quad;
 		s_ifc.symbol = symbol;
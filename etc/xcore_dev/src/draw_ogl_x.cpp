@@ -1,6 +1,7 @@
 #include "crosscore.hpp"
 #include "oglsys.hpp"
 #include "draw.hpp"
+#include "draw_stats.hpp"
 
 #include "ogl_x/_inc_def.glsl"
 
@@ -1073,6 +1074,9 @@ static void batch(cxModelWork* pWk, const int ibat, const Draw::Mode mode, const
 		typ = GL_UNSIGNED_INT;
 	}
 	glDrawElements(GL_TRIANGLES, pBat->mTriNum * 3, typ, (const void*)org);
+	DrawStats::count(DrawStats::DRAW_CALLS);
+	DrawStats::count(DrawStats::TRIS, pBat->mTriNum);
+	DrawStats::count(DrawStats::BATCHES);
 
 	if (s_locPos >= 0) {
 		glDisableVertexAttribArray(s_locPos);
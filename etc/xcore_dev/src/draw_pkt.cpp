@@ -0,0 +1,232 @@
+#include "crosscore.hpp"
+#include "draw_pkt.hpp"
+
+namespace DrawPkt {
+
+void List::init(const int maxJobs) {
+	reset();
+	int nruns = nxCalc::max(maxJobs, 1);
+	mpRuns = (int32_t*)nxCore::mem_alloc((nruns + 1) * sizeof(int32_t), "DrawPkt:Runs");
+	if (maxJobs > 1 && mpRuns) {
+		mpQue = nxTask::queue_create(maxJobs);
+		mpJobs = (sxJob*)nxCore::mem_alloc(maxJobs * sizeof(sxJob), "DrawPkt:Jobs");
+		mpJobInfo = (JobInfo*)nxCore::mem_alloc(maxJobs * sizeof(JobInfo), "DrawPkt:JobInfo");
+		if (mpQue && mpJobs && mpJobInfo) {
+			::memset(mpJobs, 0, maxJobs * sizeof(sxJob));
+			mJobsMax = maxJobs;
+		} else {
+			if (mpQue) {
+				nxTask::queue_destroy(mpQue);
+				mpQue = nullptr;
+			}
+			nxCore::mem_free(mpJobs);
+			mpJobs = nullptr;
+			nxCore::mem_free(mpJobInfo);
+			mpJobInfo = nullptr;
+		}
+	}
+}
+
+void List::reset() {
+	nxCore::mem_free(mpPkts);
+	mpPkts = nullptr;
+	nxCore::mem_free(mpTmp);
+	mpTmp = nullptr;
+	nxCore::mem_free(mpRuns);
+	mpRuns = nullptr;
+	if (mpQue) {
+		nxTask::queue_destroy(mpQue);
+		mpQue = nullptr;
+	}
+	nxCore::mem_free(mpJobs);
+	mpJobs = nullptr;
+	nxCore::mem_free(mpJobInfo);
+	mpJobInfo = nullptr;
+	mpSrc = nullptr;
+	mpDst = nullptr;
+	mRunsNum = 0;
+	mNum = 0;
+	mMax = 0;
+	mJobsMax = 0;
+}
+
+Packet* List::alloc(const int n) {
+	mNum = 0;
+	if (n <= 0) return mpPkts;
+	if (n > mMax) {
+		int nmax = nxCalc::max(n, mMax * 2);
+		nxCore::mem_free(mpPkts);
+		nxCore::mem_free(mpTmp);
+		mpPkts = (Packet*)nxCore::mem_alloc(nmax * sizeof(Packet), "DrawPkt:Pkts");
+		mpTmp = (Packet*)nxCore::mem_alloc(nmax * sizeof(Packet), "DrawPkt:Tmp");
+		if (!mpPkts || !mpTmp) {
+			nxCore::mem_free(mpPkts);
+			mpPkts = nullptr;
+			nxCore::mem_free(mpTmp);
+			mpTmp = nullptr;
+			mMax = 0;
+			return nullptr;
+		}
+		mMax = nmax;
+	}
+	return mpPkts;
+}
+
+/*static*/ void List::radix_sort(Packet* pSrc, Packet* pDst, const int n) {
+	if (n <= 0) return;
+	uint32_t cnt[8][256];
+	::memset(cnt, 0, sizeof(cnt));
+	for (int i = 0; i < n; ++i) {
+		uint64_t key = pSrc[i].mKey;
+		for (int d = 0; d < 8; ++d) {
+			++cnt[d][(key >> (d * 8)) & 0xFF];
+		}
+	}
+	Packet* pIn = pSrc;
+	Packet* pOut = pDst;
+	for (int d = 0; d < 8; ++d) {
+		uint32_t* pCnt = cnt[d];
+		if (pCnt[(pIn[0].mKey >> (d * 8)) & 0xFF] == uint32_t(n)) continue;
+		uint32_t offs = 0;
+		for (int i = 0; i < 256; ++i) {
+			uint32_t c = pCnt[i];
+			pCnt[i] = offs;
+			offs += c;
+		}
+		for (int i = 0; i < n; ++i) {
+			pOut[pCnt[(pIn[i].mKey >> (d * 8)) & 0xFF]++] = pIn[i];
+		}
+		Packet* pT = pIn;
+		pIn = pOut;
+		pOut = pT;
+	}
+	if (pIn != pDst) {
+		::memcpy(pDst, pIn, n * sizeof(Packet));
+	}
+}
+
+/*static*/ void List::merge(const Packet* pSrc, Packet* pDst, const int org, const int mid, const int end) {
+	int i = org;
+	int j = mid;
+	int k = org;
+	while (i < mid && j < end) {
+		if (pSrc[j].mKey < pSrc[i].mKey) {
+			pDst[k++] = pSrc[j++];
+		} else {
+			pDst[k++] = pSrc[i++];
+		}
+	}
+	if (i < mid) {
+		::memcpy(&pDst[k], &pSrc[i], (mid - i) * sizeof(Packet));
+	}
+	if (j < end) {
+		::memcpy(&pDst[k + (mid - i)], &pSrc[j], (end - j) * sizeof(Packet));
+	}
+}
+
+void List::exec_item(const int idx) {
+	if (mPhase == Phase::RADIX) {
+		int org = mpRuns[idx];
+		int end = mpRuns[idx + 1];
+		radix_sort(const_cast<Packet*>(mpSrc) + org, mpDst + org, end - org);
+	} else {
+		int org = mpRuns[idx * 2];
+		int mid = mpRuns[nxCalc::min(idx * 2 + 1, mRunsNum)];
+		int end = mpRuns[nxCalc::min(idx * 2 + 2, mRunsNum)];
+		merge(mpSrc, mpDst, org, mid, end);
+	}
+}
+
+/*static*/ void List::phase_job(const sxJobContext* pCtx) {
+	if (!pCtx || !pCtx->mpJob) return;
+	JobInfo* pInfo = (JobInfo*)pCtx->mpJob->mpData;
+	if (!pInfo || !pInfo->mpList) return;
+	pInfo->mpList->exec_item(pInfo->mIdx);
+}
+
+void List::exec_phase(const Phase phase, const int n, cxBrigade* pBgd) {
+	mPhase = phase;
+	if (n <= 0) return;
+	if (!pBgd || !mpQue || n < 2) {
+		for (int i = 0; i < n; ++i) {
+			exec_item(i);
+		}
+		return;
+	}
+	nxTask::queue_purge(mpQue);
+	for (int i = 0; i < n; ++i) {
+		JobInfo* pInfo = &mpJobInfo[i];
+		pInfo->mpList = this;
+		pInfo->mIdx = i;
+		sxJob* pJob = &mpJobs[i];
+		pJob->mFunc = phase_job;
+		pJob->mpData = pInfo;
+		pJob->mId = i;
+		nxTask::queue_add(mpQue, pJob);
+	}
+	nxTask::queue_exec(mpQue, pBgd);
+}
+
+void List::sort(cxBrigade* pBgd, const int minJobItems) {
+	int n = mNum;
+	if (n < 2 || !mpPkts || !mpTmp) return;
+	if (!mpRuns) {
+		Packet* pRes = mpTmp;
+		radix_sort(mpPkts, pRes, n);
+		mpTmp = mpPkts;
+		mpPkts = pRes;
+		return;
+	}
+	int njob = 1;
+	if (pBgd && mpQue && minJobItems > 0 && n >= minJobItems * 2) {
+		njob = nxCalc::min(mJobsMax, n / minJobItems);
+	}
+	mRunsNum = njob;
+	for (int i = 0; i <= njob; ++i) {
+		mpRuns[i] = int32_t(int64_t(n) * i / njob);
+	}
+	mpSrc = mpPkts;
+	mpDst = mpTmp;
+	exec_phase(Phase::RADIX, njob, pBgd);
+	while (mRunsNum > 1) {
+		Packet* pRes = mpDst;
+		mpDst = const_cast<Packet*>(mpSrc);
+		mpSrc = pRes;
+		int npair = (mRunsNum + 1) / 2;
+		exec_phase(Phase::MERGE, npair, pBgd);
+		for (int i = 0; i < npair; ++i) {
+			mpRuns[i] = mpRuns[i * 2];
+		}
+		mpRuns[npair] = n;
+		mRunsNum = npair;
+	}
+	if (mpDst != mpPkts) {
+		mpTmp = mpPkts;
+		mpPkts = mpDst;
+	}
+	mpSrc = nullptr;
+	mpDst = nullptr;
+}
+
+int List::find_pass(const int pass) const {
+	int lo = 0;
+	int hi = mNum;
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (get_key_pass(mpPkts[mid].mKey) < pass) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+bool List::ck_sorted() const {
+	for (int i = 1; i < mNum; ++i) {
+		if (mpPkts[i].mKey < mpPkts[i - 1].mKey) return false;
+	}
+	return true;
+}
+
+} // DrawPkt
@@ -0,0 +1,113 @@
+namespace DrawPkt {
+
+enum Pass {
+	PASS_SHADOW = 0,
+	PASS_OPAQ = 1,
+	PASS_SEMI = 2,  /* alpha materials that are not forced to blend */
+	PASS_BLEND = 3
+};
+
+struct Packet {
+	uint64_t mKey;
+	void* mpData;
+	int32_t mParam;
+	int32_t mReserved;
+};
+
+/* 24-bit ordered depth code: the upper bits of the float pattern, monotonic for d >= 0 */
+inline uint32_t depth_code(const float d) {
+	float x = d > 0.0f ? d : 0.0f;
+	uint32_t bits = 0;
+	::memcpy(&bits, &x, sizeof(bits));
+	return (bits >> 7) & 0xFFFFFF;
+}
+
+/* 64-bit keys, pass in the top 4 bits.
+   State passes (shadow, opaque) continue with shader (8 bits), material (12) and texture (16), depth (24) front-to-back last;
+   blended passes put the depth back-to-front right below the pass and the state after it. */
+inline uint64_t make_key(const int pass, const uint32_t shader, const uint32_t mtl, const uint32_t tex, const float depth) {
+	uint64_t key = uint64_t(pass & 0xF) << 60;
+	uint64_t sdr = shader & 0xFF;
+	uint64_t mid = mtl & 0xFFF;
+	uint64_t tid = tex & 0xFFFF;
+	uint64_t dc = depth_code(depth);
+	if (pass == PASS_SEMI || pass == PASS_BLEND) {
+		key |= ((~dc) & 0xFFFFFF) << 36;
+		key |= sdr << 28;
+		key |= mid << 16;
+		key |= tid;
+	} else {
+		key |= sdr << 52;
+		key |= mid << 40;
+		key |= tid << 24;
+		key |= dc;
+	}
+	return key;
+}
+
+inline int get_key_pass(const uint64_t key) { return int(key >> 60); }
+
+/* Packet list with a parallel stable sort on the keys:
+   ranges of packets are radix sorted by the brigade (8-bit digits, digits shared by the whole range are skipped),
+   then sorted runs are merged pairwise in rounds, one job per pair. Equal keys keep their input order,
+   so the result does not depend on the number of jobs. */
+class List {
+protected:
+	enum class Phase {
+		RADIX,
+		MERGE
+	};
+
+	struct JobInfo {
+		List* mpList;
+		int mIdx;
+	};
+
+	Packet* mpPkts;
+	Packet* mpTmp;
+	int32_t* mpRuns; /* run boundaries, mJobsMax + 1 */
+	sxJobQueue* mpQue;
+	sxJob* mpJobs;
+	JobInfo* mpJobInfo;
+	const Packet* mpSrc;
+	Packet* mpDst;
+	Phase mPhase;
+	int mRunsNum;
+	int mNum;
+	int mMax;
+	int mJobsMax;
+
+	void exec_item(const int idx);
+	void exec_phase(const Phase phase, const int n, cxBrigade* pBgd);
+
+	static void phase_job(const sxJobContext* pCtx);
+	/* sorts src[0, n) into dst[0, n) (both buffers are overwritten) */
+	static void radix_sort(Packet* pSrc, Packet* pDst, const int n);
+	static void merge(const Packet* pSrc, Packet* pDst, const int org, const int mid, const int end);
+
+public:
+	List()
+	: mpPkts(nullptr), mpTmp(nullptr), mpRuns(nullptr), mpQue(nullptr), mpJobs(nullptr), mpJobInfo(nullptr),
+	mpSrc(nullptr), mpDst(nullptr), mPhase(Phase::RADIX), mRunsNum(0), mNum(0), mMax(0), mJobsMax(0) {}
+
+	~List() { reset(); }
+
+	void init(const int maxJobs = 0);
+	void reset();
+
+	/* storage for n packets, the contents are not kept; returns nullptr if out of memory */
+	Packet* alloc(const int n);
+	void set_num(const int n) { mNum = nxCalc::clamp(n, 0, mMax); }
+	void clear() { mNum = 0; }
+	/* packets with fewer than minJobItems per job are sorted serially */
+	void sort(cxBrigade* pBgd = nullptr, const int minJobItems = 1024);
+
+	int get_num() const { return mNum; }
+	const Packet* get_packets() const { return mpPkts; }
+	const Packet* get_packet(const int idx) const { return (idx >= 0 && idx < mNum) ? &mpPkts[idx] : nullptr; }
+	/* first packet with a pass >= pass */
+	int find_pass(const int pass) const;
+	bool ck_sorted() const;
+};
+
+} // DrawPkt
@@ -0,0 +1,188 @@
+#include "crosscore.hpp"
+#include "draw_stats.hpp"
+
+namespace DrawStats {
+
+static const char* s_pBuiltinNames[BUILTIN_NUM] = {
+	"draw_calls",
+	"tris",
+	"batches",
+	"prog_changes",
+	"tex_binds",
+	"buf_uploads",
+	"upload_bytes"
+};
+
+static Counters s_counters;
+
+Counters* get_counters() {
+	return &s_counters;
+}
+
+void Counters::init(const int window) {
+	reset();
+	for (int i = 0; i < BUILTIN_NUM; ++i) {
+		add_counter(s_pBuiltinNames[i]);
+	}
+	if (window > 0) {
+		mpFrames = (uint64_t*)nxCore::mem_alloc(window * MAX_COUNTERS * PASS_NUM * sizeof(uint64_t), "DrawStats:Frames");
+		mpFrameIds = (uint64_t*)nxCore::mem_alloc(window * sizeof(uint64_t), "DrawStats:FrameIds");
+		if (mpFrames && mpFrameIds) {
+			mWindow = window;
+		} else {
+			nxCore::mem_free(mpFrames);
+			mpFrames = nullptr;
+			nxCore::mem_free(mpFrameIds);
+			mpFrameIds = nullptr;
+		}
+	}
+}
+
+void Counters::reset() {
+	nxCore::mem_free(mpFrames);
+	mpFrames = nullptr;
+	nxCore::mem_free(mpFrameIds);
+	mpFrameIds = nullptr;
+	::memset(mNames, 0, sizeof(mNames));
+	::memset(mCur, 0, sizeof(mCur));
+	mFrameCnt = 0;
+	mNum = 0;
+	mPass = PASS_OTHER;
+	mWindow = 0;
+	mFramesNum = 0;
+	mFrameTop = 0;
+}
+
+int Counters::add_counter(const char* pName) {
+	if (!pName || !pName[0]) return -1;
+	size_t len = ::strlen(pName);
+	if (len >= NAME_SIZE) return -1;
+	int id = find_counter(pName);
+	if (id >= 0) return id;
+	if (mNum >= MAX_COUNTERS) return -1;
+	id = mNum++;
+	::memcpy(mNames[id], pName, len + 1);
+	for (int i = 0; i < PASS_NUM; ++i) {
+		mCur[id][i] = 0;
+	}
+	return id;
+}
+
+int Counters::find_counter(const char* pName) const {
+	if (!pName) return -1;
+	for (int i = 0; i < mNum; ++i) {
+		if (nxCore::str_eq(mNames[i], pName)) return i;
+	}
+	return -1;
+}
+
+void Counters::frame_end() {
+	if (mpFrames && mWindow > 0) {
+		uint64_t* pSnap = &mpFrames[mFrameTop * MAX_COUNTERS * PASS_NUM];
+		::memcpy(pSnap, mCur, sizeof(mCur));
+		mpFrameIds[mFrameTop] = mFrameCnt;
+		mFrameTop = (mFrameTop + 1) % mWindow;
+		mFramesNum = nxCalc::min(mFramesNum + 1, mWindow);
+	}
+	++mFrameCnt;
+	::memset(mCur, 0, sizeof(mCur));
+	mPass = PASS_OTHER;
+}
+
+void Counters::clear_frames() {
+	mFramesNum = 0;
+	mFrameTop = 0;
+}
+
+const uint64_t* Counters::get_snapshot(const int age) const {
+	if (!mpFrames || age < 0 || age >= mFramesNum) return nullptr;
+	int idx = (mFrameTop - 1 - age + mWindow) % mWindow;
+	return &mpFrames[idx * MAX_COUNTERS * PASS_NUM];
+}
+
+/*static*/ uint64_t Counters::snapshot_val(const uint64_t* pSnap, const int id, const int pass) {
+	const uint64_t* pVals = &pSnap[id * PASS_NUM];
+	if (pass >= 0) return pass < PASS_NUM ? pVals[pass] : 0;
+	uint64_t sum = 0;
+	for (int i = 0; i < PASS_NUM; ++i) {
+		sum += pVals[i];
+	}
+	return sum;
+}
+
+uint64_t Counters::get_cur(const int id, const int pass) const {
+	if (id < 0 || id >= mNum) return 0;
+	return snapshot_val(&mCur[0][0], id, pass);
+}
+
+uint64_t Counters::get_frame_val(const int id, const int pass, const int age) const {
+	if (id < 0 || id >= mNum) return 0;
+	const uint64_t* pSnap = get_snapshot(age);
+	return pSnap ? snapshot_val(pSnap, id, pass) : 0;
+}
+
+uint64_t Counters::get_min(const int id, const int pass) const {
+	if (id < 0 || id >= mNum || mFramesNum <= 0) return 0;
+	uint64_t res = get_frame_val(id, pass, 0);
+	for (int i = 1; i < mFramesNum; ++i) {
+		res = nxCalc::min(res, get_frame_val(id, pass, i));
+	}
+	return res;
+}
+
+uint64_t Counters::get_max(const int id, const int pass) const {
+	if (id < 0 || id >= mNum || mFramesNum <= 0) return 0;
+	uint64_t res = get_frame_val(id, pass, 0);
+	for (int i = 1; i < mFramesNum; ++i) {
+		res = nxCalc::max(res, get_frame_val(id, pass, i));
+	}
+	return res;
+}
+
+double Counters::get_avg(const int id, const int pass) const {
+	if (id < 0 || id >= mNum || mFramesNum <= 0) return 0.0;
+	double sum = 0.0;
+	for (int i = 0; i < mFramesNum; ++i) {
+		sum += double(get_frame_val(id, pass, i));
+	}
+	return sum / double(mFramesNum);
+}
+
+/*static*/ const char* Counters::get_pass_name(const int pass) {
+	static const char* s_pPassNames[PASS_NUM] = { "other", "shadow", "opaque", "semi" };
+	return (pass >= 0 && pass < PASS_NUM) ? s_pPassNames[pass] : "all";
+}
+
+void Counters::write_csv(FILE* pOut) const {
+	if (!pOut) return;
+	::fprintf(pOut, "frame");
+	for (int i = 0; i < mNum; ++i) {
+		::fprintf(pOut, ",%s", mNames[i]);
+		for (int j = 0; j < PASS_NUM; ++j) {
+			::fprintf(pOut, ",%s.%s", mNames[i], get_pass_name(j));
+		}
+	}
+	::fprintf(pOut, "\n");
+	for (int age = mFramesNum; --age >= 0;) {
+		const uint64_t* pSnap = get_snapshot(age);
+		int idx = (mFrameTop - 1 - age + mWindow) % mWindow;
+		::fprintf(pOut, "%llu", (unsigned long long)mpFrameIds[idx]);
+		for (int i = 0; i < mNum; ++i) {
+			::fprintf(pOut, ",%llu", (unsigned long long)snapshot_val(pSnap, i, -1));
+			for (int j = 0; j < PASS_NUM; ++j) {
+				::fprintf(pOut, ",%llu", (unsigned long long)snapshot_val(pSnap, i, j));
+			}
+		}
+		::fprintf(pOut, "\n");
+	}
+}
+
+bool Counters::save_csv(const char* pPath) const {
+	FILE* pOut = nxSys::fopen_w_txt(pPath);
+	if (!pOut) return false;
+	write_csv(pOut);
+	::fclose(pOut);
+	return true;
+}
+
+} // DrawStats
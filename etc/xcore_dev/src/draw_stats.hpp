@@ -0,0 +1,101 @@
+namespace DrawStats {
+
+enum Pass {
+	PASS_OTHER = 0, /* 2D, prims and anything drawn outside of the scene passes */
+	PASS_SHADOW = 1,
+	PASS_OPAQ = 2,
+	PASS_SEMI = 3,
+	PASS_NUM = 4
+};
+
+/* counters registered by init(), in this order */
+enum Builtin {
+	DRAW_CALLS = 0,
+	TRIS,
+	BATCHES,      /* model batches, an instanced group counts every instance */
+	PROG_CHANGES,
+	TEX_BINDS,
+	BUF_UPLOADS,
+	UPLOAD_BYTES,
+	BUILTIN_NUM
+};
+
+/* Named per-pass counters.
+   Values are accumulated into the current frame, frame_end() stores them as a snapshot in a window of the last frames,
+   which is what the min/avg/max queries and the CSV dump look at. Counting is not synchronized:
+   the counters are meant to be bumped on the rendering thread only. */
+class Counters {
+public:
+	static const int MAX_COUNTERS = 32;
+	static const int NAME_SIZE = 32;
+
+protected:
+	char mNames[MAX_COUNTERS][NAME_SIZE];
+	uint64_t mCur[MAX_COUNTERS][PASS_NUM];
+	uint64_t* mpFrames;   /* window ring: [frame][counter][pass] */
+	uint64_t* mpFrameIds; /* frame number of every snapshot */
+	uint64_t mFrameCnt;
+	int mNum;
+	int mPass;
+	int mWindow;
+	int mFramesNum;
+	int mFrameTop; /* next snapshot slot */
+
+	const uint64_t* get_snapshot(const int age) const;
+	static uint64_t snapshot_val(const uint64_t* pSnap, const int id, const int pass);
+
+public:
+	Counters()
+	: mpFrames(nullptr), mpFrameIds(nullptr), mFrameCnt(0), mNum(0), mPass(PASS_OTHER), mWindow(0), mFramesNum(0), mFrameTop(0) {
+		::memset(mNames, 0, sizeof(mNames));
+		::memset(mCur, 0, sizeof(mCur));
+	}
+
+	~Counters() { reset(); }
+
+	void init(const int window = 120);
+	void reset();
+
+	/* returns the id of the counter with this name, registering it if needed; -1 if the table is full or the name too long */
+	int add_counter(const char* pName);
+	int find_counter(const char* pName) const;
+	const char* get_counter_name(const int id) const { return (id >= 0 && id < mNum) ? mNames[id] : nullptr; }
+	int get_counters_num() const { return mNum; }
+
+	void set_pass(const int pass) { mPass = (pass >= 0 && pass < PASS_NUM) ? pass : PASS_OTHER; }
+	int get_pass() const { return mPass; }
+	void add(const int id, const uint64_t val = 1) {
+		if (id >= 0 && id < mNum && id < MAX_COUNTERS) {
+			mCur[id][mPass] += val;
+		}
+	}
+
+	/* snapshots the current values, clears them and resets the pass */
+	void frame_end();
+	void clear_frames();
+
+	/* pass < 0: sum over the passes */
+	uint64_t get_cur(const int id, const int pass = -1) const;
+	/* age 0 is the last finished frame, 0 for frames that are not in the window */
+	uint64_t get_frame_val(const int id, const int pass = -1, const int age = 0) const;
+	uint64_t get_min(const int id, const int pass = -1) const;
+	uint64_t get_max(const int id, const int pass = -1) const;
+	double get_avg(const int id, const int pass = -1) const;
+	int get_window() const { return mWindow; }
+	int get_frames_num() const { return mFramesNum; }
+	uint64_t get_frame_cnt() const { return mFrameCnt; }
+
+	/* one line per frame in the window, oldest first: frame number, then every counter as total and per pass */
+	void write_csv(FILE* pOut) const;
+	bool save_csv(const char* pPath) const;
+
+	static const char* get_pass_name(const int pass);
+};
+
+/* the counters shared by the draw interfaces and the scene */
+Counters* get_counters();
+
+inline void count(const int id, const uint64_t val = 1) { get_counters()->add(id, val); }
+inline void set_pass(const int pass) { get_counters()->set_pass(pass); }
+
+} // DrawStats
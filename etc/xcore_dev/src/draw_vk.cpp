@@ -1,6 +1,7 @@
 #include "crosscore.hpp"
 #include "oglsys.hpp"
 #include "draw.hpp"
+#include "draw_stats.hpp"
 
 #if !DRW_NO_VULKAN
 
@@ -1551,6 +1552,9 @@ void VK_GLB::draw_batch(cxModelWork* pWk, const int ibat, const Draw::Mode mode,
 		vkCmdBindIndexBuffer(cmd, pGPUWk->i32Buf, pBat->mIdxOrg * sizeof(uint32_t), VK_INDEX_TYPE_UINT32);
 	}
 	vkCmdDrawIndexed(cmd, pBat->mTriNum * 3, 1, 0, 0, 0);
+	DrawStats::count(DrawStats::DRAW_CALLS);
+	DrawStats::count(DrawStats::TRIS, pBat->mTriNum);
+	DrawStats::count(DrawStats::BATCHES);
 	vkCmdEndRenderPass(mpSwapChainCmdBufs[mSwapChainIdx]);
 }
 
@@ -0,0 +1,720 @@
+#include "crosscore.hpp"
+#include "obj_bvh.hpp"
+
+namespace ObjBVH {
+
+/* frustum edges as vertex pairs and the two faces sharing them, faces in near, left, top, right, bottom, far order */
+static const struct {
+	uint8_t v0, v1;
+	uint8_t f0, f1;
+} s_fstEdges[12] = {
+	{ 0, 1, 0, 2 }, { 1, 2, 0, 3 }, { 2, 3, 0, 4 }, { 3, 0, 0, 1 },
+	{ 4, 5, 2, 5 }, { 5, 6, 3, 5 }, { 6, 7, 4, 5 }, { 7, 4, 1, 5 },
+	{ 0, 4, 1, 2 }, { 1, 5, 2, 3 }, { 2, 6, 3, 4 }, { 3, 7, 4, 1 }
+};
+
+void Tree::init(const int maxItems, const float margin, const int maxJobs) {
+	reset();
+	set_margin(margin);
+	if (maxItems > 0) {
+		reserve(maxItems * 2);
+	}
+	if (maxJobs > 1) {
+		mpQue = nxTask::queue_create(maxJobs);
+		mpJobs = (sxJob*)nxCore::mem_alloc(maxJobs * sizeof(sxJob), "ObjBVH:Jobs");
+		mpJobInfo = (JobInfo*)nxCore::mem_alloc(maxJobs * sizeof(JobInfo), "ObjBVH:JobInfo");
+		if (mpQue && mpJobs && mpJobInfo) {
+			::memset(mpJobs, 0, maxJobs * sizeof(sxJob));
+			mJobsMax = maxJobs;
+		} else {
+			if (mpQue) {
+				nxTask::queue_destroy(mpQue);
+				mpQue = nullptr;
+			}
+			nxCore::mem_free(mpJobs);
+			mpJobs = nullptr;
+			nxCore::mem_free(mpJobInfo);
+			mpJobInfo = nullptr;
+		}
+	}
+}
+
+void Tree::reset() {
+	nxCore::mem_free(mpNodes);
+	mpNodes = nullptr;
+	if (mpQue) {
+		nxTask::queue_destroy(mpQue);
+		mpQue = nullptr;
+	}
+	nxCore::mem_free(mpJobs);
+	mpJobs = nullptr;
+	nxCore::mem_free(mpJobInfo);
+	mpJobInfo = nullptr;
+	mJobsMax = 0;
+	nxCore::mem_free(mpMoved);
+	mpMoved = nullptr;
+	mMovedMax = 0;
+	mRoot = -1;
+	mFree = -1;
+	mNodesMax = 0;
+	mNodesNum = 0;
+	mLeavesNum = 0;
+}
+
+void Tree::clear() {
+	for (int i = 0; i < mNodesMax; ++i) {
+		mpNodes[i].mParent = i + 1 < mNodesMax ? i + 1 : -1;
+		mpNodes[i].mHeight = -1;
+	}
+	mFree = mNodesMax > 0 ? 0 : -1;
+	mRoot = -1;
+	mNodesNum = 0;
+	mLeavesNum = 0;
+}
+
+bool Tree::reserve(const int nodesMax) {
+	if (nodesMax <= mNodesMax) return true;
+	Node* pNodes = (Node*)nxCore::mem_alloc(nodesMax * sizeof(Node), "ObjBVH:Nodes");
+	if (!pNodes) return false;
+	if (mpNodes) {
+		::memcpy(pNodes, mpNodes, mNodesMax * sizeof(Node));
+		nxCore::mem_free(mpNodes);
+	}
+	mpNodes = pNodes;
+	/* new nodes go in front of the free list */
+	for (int i = mNodesMax; i < nodesMax; ++i) {
+		mpNodes[i].mParent = i + 1 < nodesMax ? i + 1 : mFree;
+		mpNodes[i].mHeight = -1;
+	}
+	mFree = mNodesMax;
+	mNodesMax = nodesMax;
+	return true;
+}
+
+int32_t Tree::alloc_node() {
+	if (mFree < 0) {
+		if (!reserve(nxCalc::max(mNodesMax * 2, 64))) return -1;
+	}
+	int32_t id = mFree;
+	Node* pNode = &mpNodes[id];
+	mFree = pNode->mParent;
+	pNode->mpData = nullptr;
+	pNode->mParent = -1;
+	pNode->mChild[0] = -1;
+	pNode->mChild[1] = -1;
+	pNode->mHeight = 0;
+	pNode->mRefit = 0;
+	++mNodesNum;
+	return id;
+}
+
+void Tree::free_node(const int32_t id) {
+	mpNodes[id].mParent = mFree;
+	mpNodes[id].mHeight = -1;
+	mFree = id;
+	--mNodesNum;
+}
+
+void Tree::fatten(const int32_t leaf) {
+	Node* pNode = &mpNodes[leaf];
+	cxVec m(mMargin);
+	pNode->mBox.set(pNode->mItem.get_min_pos() - m, pNode->mItem.get_max_pos() + m);
+}
+
+void Tree::insert_leaf(const int32_t leaf) {
+	if (mRoot < 0) {
+		mRoot = leaf;
+		mpNodes[leaf].mParent = -1;
+		return;
+	}
+	/* best sibling by surface area: the new parent's area plus the growth of every ancestor,
+	   subtrees are skipped once the leaf area plus the growth inherited so far cannot beat the best found */
+	cxAABB leafBox = mpNodes[leaf].mBox;
+	float leafArea = area(leafBox);
+	struct Candidate {
+		int32_t node;
+		float inherit;
+	} stk[STACK_SIZE];
+	int sp = 0;
+	stk[sp].node = mRoot;
+	stk[sp].inherit = 0.0f;
+	++sp;
+	/* greedy descent first, its cost bounds the search */
+	int32_t idx = mRoot;
+	float bestCost = FLT_MAX;
+	float inherit = 0.0f;
+	for (int32_t id = mRoot; id >= 0;) {
+		const Node& node = mpNodes[id];
+		float comb = area(merged(node.mBox, leafBox));
+		if (comb + inherit < bestCost) {
+			bestCost = comb + inherit;
+			idx = id;
+		}
+		if (node.is_leaf()) break;
+		inherit += comb - area(node.mBox);
+		int32_t c0 = node.mChild[0];
+		int32_t c1 = node.mChild[1];
+		float d0 = area(merged(mpNodes[c0].mBox, leafBox)) - area(mpNodes[c0].mBox);
+		float d1 = area(merged(mpNodes[c1].mBox, leafBox)) - area(mpNodes[c1].mBox);
+		id = d0 <= d1 ? c0 : c1;
+	}
+	while (sp > 0) {
+		Candidate cand = stk[--sp];
+		if (leafArea + cand.inherit >= bestCost) continue;
+		const Node& node = mpNodes[cand.node];
+		float comb = area(merged(node.mBox, leafBox));
+		float cost = comb + cand.inherit;
+		if (cost < bestCost) {
+			bestCost = cost;
+			idx = cand.node;
+		}
+		if (node.is_leaf()) continue;
+		float childInherit = cand.inherit + comb - area(node.mBox);
+		if (leafArea + childInherit >= bestCost || sp + 2 > STACK_SIZE) continue;
+		/* cheaper child on top */
+		int32_t c0 = node.mChild[0];
+		int32_t c1 = node.mChild[1];
+		if (area(merged(mpNodes[c0].mBox, leafBox)) < area(merged(mpNodes[c1].mBox, leafBox))) {
+			int32_t t = c0;
+			c0 = c1;
+			c1 = t;
+		}
+		stk[sp].node = c0;
+		stk[sp].inherit = childInherit;
+		++sp;
+		stk[sp].node = c1;
+		stk[sp].inherit = childInherit;
+		++sp;
+	}
+
+	int32_t sibling = idx;
+	int32_t parent = alloc_node();
+	if (parent < 0) return;
+	int32_t oldParent = mpNodes[sibling].mParent;
+	Node* pParent = &mpNodes[parent];
+	pParent->mParent = oldParent;
+	pParent->mBox = merged(leafBox, mpNodes[sibling].mBox);
+	pParent->mHeight = mpNodes[sibling].mHeight + 1;
+	pParent->mChild[0] = sibling;
+	pParent->mChild[1] = leaf;
+	mpNodes[sibling].mParent = parent;
+	mpNodes[leaf].mParent = parent;
+	if (oldParent >= 0) {
+		Node* pOld = &mpNodes[oldParent];
+		pOld->mChild[pOld->mChild[0] == sibling ? 0 : 1] = parent;
+	} else {
+		mRoot = parent;
+	}
+
+	idx = mpNodes[leaf].mParent;
+	while (idx >= 0) {
+		idx = balance(idx);
+		rotate(idx);
+		Node* pNode = &mpNodes[idx];
+		const Node& c0 = mpNodes[pNode->mChild[0]];
+		const Node& c1 = mpNodes[pNode->mChild[1]];
+		pNode->mHeight = 1 + nxCalc::max(c0.mHeight, c1.mHeight);
+		pNode->mBox = merged(c0.mBox, c1.mBox);
+		idx = pNode->mParent;
+	}
+}
+
+void Tree::remove_leaf(const int32_t leaf) {
+	if (leaf == mRoot) {
+		mRoot = -1;
+		return;
+	}
+	int32_t parent = mpNodes[leaf].mParent;
+	int32_t grand = mpNodes[parent].mParent;
+	int32_t sibling = mpNodes[parent].mChild[mpNodes[parent].mChild[0] == leaf ? 1 : 0];
+	free_node(parent);
+	mpNodes[leaf].mParent = -1;
+	if (grand < 0) {
+		mRoot = sibling;
+		mpNodes[sibling].mParent = -1;
+		return;
+	}
+	Node* pGrand = &mpNodes[grand];
+	pGrand->mChild[pGrand->mChild[0] == parent ? 0 : 1] = sibling;
+	mpNodes[sibling].mParent = grand;
+	int32_t idx = grand;
+	while (idx >= 0) {
+		idx = balance(idx);
+		rotate(idx);
+		Node* pNode = &mpNodes[idx];
+		const Node& c0 = mpNodes[pNode->mChild[0]];
+		const Node& c1 = mpNodes[pNode->mChild[1]];
+		pNode->mHeight = 1 + nxCalc::max(c0.mHeight, c1.mHeight);
+		pNode->mBox = merged(c0.mBox, c1.mBox);
+		idx = pNode->mParent;
+	}
+}
+
+/* rotates the taller grandchild subtree up when the children heights differ by more than one, returns the new subtree root */
+int32_t Tree::balance(const int32_t ia) {
+	Node* pA = &mpNodes[ia];
+	if (pA->is_leaf() || pA->mHeight < 2) return ia;
+	int32_t ib = pA->mChild[0];
+	int32_t ic = pA->mChild[1];
+	Node* pB = &mpNodes[ib];
+	Node* pC = &mpNodes[ic];
+	int bal = pC->mHeight - pB->mHeight;
+	if (bal > 1) {
+		int32_t iF = pC->mChild[0];
+		int32_t iG = pC->mChild[1];
+		Node* pF = &mpNodes[iF];
+		Node* pG = &mpNodes[iG];
+		pC->mChild[0] = ia;
+		pC->mParent = pA->mParent;
+		pA->mParent = ic;
+		if (pC->mParent >= 0) {
+			Node* pP = &mpNodes[pC->mParent];
+			pP->mChild[pP->mChild[0] == ia ? 0 : 1] = ic;
+		} else {
+			mRoot = ic;
+		}
+		if (pF->mHeight > pG->mHeight) {
+			pC->mChild[1] = iF;
+			pA->mChild[1] = iG;
+			pG->mParent = ia;
+			pA->mBox = merged(pB->mBox, pG->mBox);
+			pC->mBox = merged(pA->mBox, pF->mBox);
+			pA->mHeight = 1 + nxCalc::max(pB->mHeight, pG->mHeight);
+			pC->mHeight = 1 + nxCalc::max(pA->mHeight, pF->mHeight);
+		} else {
+			pC->mChild[1] = iG;
+			pA->mChild[1] = iF;
+			pF->mParent = ia;
+			pA->mBox = merged(pB->mBox, pF->mBox);
+			pC->mBox = merged(pA->mBox, pG->mBox);
+			pA->mHeight = 1 + nxCalc::max(pB->mHeight, pF->mHeight);
+			pC->mHeight = 1 + nxCalc::max(pA->mHeight, pG->mHeight);
+		}
+		return ic;
+	}
+	if (bal < -1) {
+		int32_t iD = pB->mChild[0];
+		int32_t iE = pB->mChild[1];
+		Node* pD = &mpNodes[iD];
+		Node* pE = &mpNodes[iE];
+		pB->mChild[0] = ia;
+		pB->mParent = pA->mParent;
+		pA->mParent = ib;
+		if (pB->mParent >= 0) {
+			Node* pP = &mpNodes[pB->mParent];
+			pP->mChild[pP->mChild[0] == ia ? 0 : 1] = ib;
+		} else {
+			mRoot = ib;
+		}
+		if (pD->mHeight > pE->mHeight) {
+			pB->mChild[1] = iD;
+			pA->mChild[0] = iE;
+			pE->mParent = ia;
+			pA->mBox = merged(pC->mBox, pE->mBox);
+			pB->mBox = merged(pA->mBox, pD->mBox);
+			pA->mHeight = 1 + nxCalc::max(pC->mHeight, pE->mHeight);
+			pB->mHeight = 1 + nxCalc::max(pA->mHeight, pD->mHeight);
+		} else {
+			pB->mChild[1] = iE;
+			pA->mChild[0] = iD;
+			pD->mParent = ia;
+			pA->mBox = merged(pC->mBox, pD->mBox);
+			pB->mBox = merged(pA->mBox, pE->mBox);
+			pA->mHeight = 1 + nxCalc::max(pC->mHeight, pD->mHeight);
+			pB->mHeight = 1 + nxCalc::max(pA->mHeight, pE->mHeight);
+		}
+		return ib;
+	}
+	return ia;
+}
+
+/* swaps a child of ia with a grandchild on the other side when that shrinks the node it moves into the most,
+   only swaps that leave both nodes balanced are taken */
+void Tree::rotate(const int32_t ia) {
+	Node* pA = &mpNodes[ia];
+	if (pA->is_leaf()) return;
+	int32_t ib = pA->mChild[0];
+	int32_t ic = pA->mChild[1];
+	const Node& b = mpNodes[ib];
+	const Node& c = mpNodes[ic];
+	if (b.is_leaf() && c.is_leaf()) return;
+	/* candidate: child 'from' of A swaps with grandchild 'gc' that sits under A's other child 'host' next to 'keep' */
+	float bestGain = 0.0f;
+	int32_t bestFrom = -1;
+	int32_t bestHost = -1;
+	int32_t bestGc = -1;
+	for (int side = 0; side < 2; ++side) {
+		int32_t from = side ? ic : ib;
+		int32_t host = side ? ib : ic;
+		const Node& hostNode = mpNodes[host];
+		if (hostNode.is_leaf()) continue;
+		float hostArea = area(hostNode.mBox);
+		for (int k = 0; k < 2; ++k) {
+			int32_t gc = hostNode.mChild[k];
+			int32_t keep = hostNode.mChild[k ^ 1];
+			int32_t hf = mpNodes[from].mHeight;
+			int32_t hk = mpNodes[keep].mHeight;
+			/* both nodes touched must stay balanced, the height bound is what keeps query stacks small */
+			if (::abs(hf - hk) > 1 || ::abs(mpNodes[gc].mHeight - (1 + nxCalc::max(hf, hk))) > 1) continue;
+			float gain = hostArea - area(merged(mpNodes[from].mBox, mpNodes[keep].mBox));
+			if (gain > bestGain) {
+				bestGain = gain;
+				bestFrom = from;
+				bestHost = host;
+				bestGc = gc;
+			}
+		}
+	}
+	if (bestFrom < 0) return;
+	Node* pHost = &mpNodes[bestHost];
+	int kgc = pHost->mChild[0] == bestGc ? 0 : 1;
+	pA->mChild[pA->mChild[0] == bestFrom ? 0 : 1] = bestGc;
+	mpNodes[bestGc].mParent = ia;
+	pHost->mChild[kgc] = bestFrom;
+	mpNodes[bestFrom].mParent = bestHost;
+	const Node& h0 = mpNodes[pHost->mChild[0]];
+	const Node& h1 = mpNodes[pHost->mChild[1]];
+	pHost->mBox = merged(h0.mBox, h1.mBox);
+	pHost->mHeight = 1 + nxCalc::max(h0.mHeight, h1.mHeight);
+}
+
+void Tree::refit_from(int32_t id) {
+	while (id >= 0) {
+		Node* pNode = &mpNodes[id];
+		pNode->mBox = merged(mpNodes[pNode->mChild[0]].mBox, mpNodes[pNode->mChild[1]].mBox);
+		id = pNode->mParent;
+	}
+}
+
+int Tree::add(const cxAABB& box, void* pData) {
+	int32_t id = alloc_node();
+	if (id < 0) return -1;
+	/* the parent is allocated on insertion, make sure it cannot fail halfway */
+	if (mFree < 0 && !reserve(mNodesMax * 2)) {
+		free_node(id);
+		return -1;
+	}
+	mpNodes[id].mItem = box;
+	mpNodes[id].mpData = pData;
+	fatten(id);
+	insert_leaf(id);
+	++mLeavesNum;
+	return id;
+}
+
+void Tree::remove(const int id) {
+	if (!ck_item_id(id)) return;
+	remove_leaf(id);
+	free_node(id);
+	--mLeavesNum;
+}
+
+static inline bool box_contains(const cxAABB& outer, const cxAABB& inner) {
+	cxVec omin = outer.get_min_pos();
+	cxVec omax = outer.get_max_pos();
+	cxVec imin = inner.get_min_pos();
+	cxVec imax = inner.get_max_pos();
+	return imin.x >= omin.x && imin.y >= omin.y && imin.z >= omin.z && imax.x <= omax.x && imax.y <= omax.y && imax.z <= omax.z;
+}
+
+bool Tree::update(const int id, const cxAABB& box) {
+	if (!ck_item_id(id)) return false;
+	mpNodes[id].mItem = box;
+	if (box_contains(mpNodes[id].mBox, box)) return false;
+	remove_leaf(id);
+	fatten(id);
+	insert_leaf(id);
+	return true;
+}
+
+void Tree::refit(const int id, const cxAABB& box) {
+	if (!ck_item_id(id)) return;
+	mpNodes[id].mItem = box;
+	if (box_contains(mpNodes[id].mBox, box)) return;
+	fatten(id);
+	refit_from(mpNodes[id].mParent);
+}
+
+/* leaves in [org, org + num) of the node array take their new boxes; a leaf that left its fat box is fattened again
+   and marks its ancestors up to the first one some other leaf has already marked, so the marked nodes always
+   form paths from the root; returns the number of leaves that marked */
+int Tree::refit_leaves(const int org, const int num) {
+	int cnt = 0;
+	for (int i = org; i < org + num; ++i) {
+		Node* pNode = &mpNodes[i];
+		if (pNode->mHeight != 0) continue;
+		cxAABB box;
+		if (!mItemFunc(pNode->mpData, &box)) {
+			mpMoved[mMovedMax - nxSys::atomic_inc(&mDropNum)] = i;
+			continue;
+		}
+		pNode->mItem = box;
+		if (box_contains(pNode->mBox, box)) continue;
+		if (!pNode->mBox.overlaps(box)) {
+			mpMoved[nxSys::atomic_inc(&mReinsNum) - 1] = i;
+			continue;
+		}
+		fatten(i);
+		for (int32_t id = pNode->mParent; id >= 0; id = mpNodes[id].mParent) {
+			if (nxSys::atomic_inc(&mpNodes[id].mRefit) > 1) break;
+		}
+		++cnt;
+	}
+	return cnt;
+}
+
+/* bottom-up refit of the marked nodes under id, marks are cleared on the way */
+void Tree::refit_marked(const int32_t id) {
+	Node* pNode = &mpNodes[id];
+	if (pNode->is_leaf() || !pNode->mRefit) return;
+	refit_marked(pNode->mChild[0]);
+	refit_marked(pNode->mChild[1]);
+	pNode->mBox = merged(mpNodes[pNode->mChild[0]].mBox, mpNodes[pNode->mChild[1]].mBox);
+	pNode->mRefit = 0;
+}
+
+void Tree::exec_range(const int org, const int num, JobInfo* pInfo) {
+	pInfo->mCnt = 0;
+	if (mPhase == Phase::LEAVES) {
+		pInfo->mCnt = refit_leaves(org, num);
+	} else {
+		for (int i = org; i < org + num; ++i) {
+			refit_marked(mRefitRoots[i]);
+		}
+	}
+}
+
+/*static*/ void Tree::phase_job(const sxJobContext* pCtx) {
+	if (!pCtx || !pCtx->mpJob) return;
+	JobInfo* pInfo = (JobInfo*)pCtx->mpJob->mpData;
+	if (!pInfo || !pInfo->mpTree) return;
+	pInfo->mpTree->exec_range(pInfo->mOrg, pInfo->mNum, pInfo);
+}
+
+/* returns the sum of the jobs' counts */
+int Tree::exec_phase(const Phase phase, const int n, const int minJobItems, cxBrigade* pBgd) {
+	mPhase = phase;
+	if (n <= 0) return 0;
+	JobInfo info;
+	if (!pBgd || !mpQue || n < minJobItems * 2) {
+		exec_range(0, n, &info);
+		return info.mCnt;
+	}
+	int njob = nxCalc::min(nxCalc::min(mJobsMax, n / minJobItems), pBgd->get_active_workers_num());
+	if (njob < 2) {
+		exec_range(0, n, &info);
+		return info.mCnt;
+	}
+	nxTask::queue_purge(mpQue);
+	for (int i = 0; i < njob; ++i) {
+		int org = int(int64_t(n) * i / njob);
+		int end = int(int64_t(n) * (i + 1) / njob);
+		JobInfo* pInfo = &mpJobInfo[i];
+		pInfo->mpTree = this;
+		pInfo->mOrg = org;
+		pInfo->mNum = end - org;
+		pInfo->mCnt = 0;
+		sxJob* pJob = &mpJobs[i];
+		pJob->mFunc = phase_job;
+		pJob->mpData = pInfo;
+		pJob->mId = i;
+		nxTask::queue_add(mpQue, pJob);
+	}
+	nxTask::queue_exec(mpQue, pBgd);
+	int cnt = 0;
+	for (int i = 0; i < njob; ++i) {
+		cnt += mpJobInfo[i].mCnt;
+	}
+	return cnt;
+}
+
+int Tree::refit_items(ItemBoxFunc func, cxBrigade* pBgd) {
+	if (!func || mRoot < 0) return 0;
+	if (mMovedMax < mLeavesNum) {
+		nxCore::mem_free(mpMoved);
+		mMovedMax = 0;
+		mpMoved = (int32_t*)nxCore::mem_alloc(mLeavesNum * sizeof(int32_t), "ObjBVH:Moved");
+		if (!mpMoved) return 0;
+		mMovedMax = mLeavesNum;
+	}
+	mItemFunc = func;
+	mReinsNum = 0;
+	mDropNum = 0;
+	int nmark = exec_phase(Phase::LEAVES, mNodesMax, MIN_JOB_NODES, pBgd);
+	mItemFunc = nullptr;
+	if (nmark > 0) {
+		/* marked subtrees a few levels down go to the jobs, the levels above them are refitted last */
+		int nroot = 0;
+		if (mpNodes[mRoot].mRefit) {
+			mRefitRoots[nroot++] = mRoot;
+		}
+		int rootsLim = nxCalc::min(nxCalc::max(mJobsMax, 1) * 4, int(MAX_REFIT_ROOTS));
+		while (nroot > 0 && nroot < rootsLim && nroot * 2 <= MAX_REFIT_ROOTS) {
+			int32_t next[MAX_REFIT_ROOTS];
+			int nnext = 0;
+			for (int i = 0; i < nroot; ++i) {
+				const Node& node = mpNodes[mRefitRoots[i]];
+				for (int j = 0; j < 2; ++j) {
+					const Node& child = mpNodes[node.mChild[j]];
+					if (!child.is_leaf() && child.mRefit) {
+						next[nnext++] = node.mChild[j];
+					}
+				}
+			}
+			if (nnext <= nroot) break;
+			for (int i = 0; i < nnext; ++i) {
+				mRefitRoots[i] = next[i];
+			}
+			nroot = nnext;
+		}
+		mRefitRootsNum = nroot;
+		exec_phase(Phase::REFIT, nroot, 1, nmark >= MIN_JOB_REFITS ? pBgd : nullptr);
+		refit_marked(mRoot);
+		mRefitRootsNum = 0;
+	}
+	for (int i = 0; i < mDropNum; ++i) {
+		remove(mpMoved[mMovedMax - 1 - i]);
+	}
+	int nreins = mReinsNum;
+	for (int i = 0; i < nreins; ++i) {
+		int32_t id = mpMoved[i];
+		remove_leaf(id);
+		fatten(id);
+		insert_leaf(id);
+	}
+	return nreins;
+}
+
+float Tree::get_area_ratio() const {
+	if (mRoot < 0) return 0.0f;
+	float rootArea = area(mpNodes[mRoot].mBox);
+	if (rootArea <= 0.0f) return 0.0f;
+	float sum = 0.0f;
+	for (int i = 0; i < mNodesMax; ++i) {
+		if (mpNodes[i].mHeight > 0) {
+			sum += area(mpNodes[i].mBox);
+		}
+	}
+	return sum / rootArea;
+}
+
+int Tree::check_node(const int32_t id, int* pNumLeaves) const {
+	const Node& node = mpNodes[id];
+	if (node.is_leaf()) {
+		++(*pNumLeaves);
+		return (node.mHeight == 0 && box_contains(node.mBox, node.mItem)) ? 0 : 1;
+	}
+	int nerr = 0;
+	int32_t c0 = node.mChild[0];
+	int32_t c1 = node.mChild[1];
+	if (c0 < 0 || c1 < 0 || c0 >= mNodesMax || c1 >= mNodesMax) return 1;
+	if (mpNodes[c0].mParent != id || mpNodes[c1].mParent != id) ++nerr;
+	if (node.mHeight != 1 + nxCalc::max(mpNodes[c0].mHeight, mpNodes[c1].mHeight)) ++nerr;
+	if (!box_contains(node.mBox, mpNodes[c0].mBox) || !box_contains(node.mBox, mpNodes[c1].mBox)) ++nerr;
+	nerr += check_node(c0, pNumLeaves);
+	nerr += check_node(c1, pNumLeaves);
+	return nerr;
+}
+
+int Tree::check() const {
+	int nerr = 0;
+	int nleaves = 0;
+	if (mRoot >= 0) {
+		if (mpNodes[mRoot].mParent != -1) ++nerr;
+		nerr += check_node(mRoot, &nleaves);
+	}
+	if (nleaves != mLeavesNum) ++nerr;
+	int nfree = 0;
+	for (int32_t i = mFree; i >= 0 && nfree <= mNodesMax; i = mpNodes[i].mParent) {
+		++nfree;
+	}
+	if (nfree + mNodesNum != mNodesMax) ++nerr;
+	if (mRoot >= 0 && mNodesNum != mLeavesNum * 2 - 1) ++nerr;
+	return nerr;
+}
+
+void Tree::calc_frustum_planes(const cxFrustum& fst, cxPlane* pPlanes) {
+	if (!pPlanes) return;
+	pPlanes[0] = fst.get_near_plane();
+	pPlanes[1] = fst.get_left_plane();
+	pPlanes[2] = fst.get_top_plane();
+	pPlanes[3] = fst.get_right_plane();
+	pPlanes[4] = fst.get_bottom_plane();
+	pPlanes[5] = fst.get_far_plane();
+}
+
+int Tree::calc_caster_planes(const cxFrustum& fst, const cxVec& lightDir, cxPlane* pPlanes) {
+	if (!pPlanes) return 0;
+	cxPlane fpln[6];
+	calc_frustum_planes(fst, fpln);
+	float len = lightDir.mag();
+	if (len <= 0.0f) {
+		for (int i = 0; i < 6; ++i) {
+			pPlanes[i] = fpln[i];
+		}
+		return 6;
+	}
+	cxVec dir = lightDir * (1.0f / len);
+	bool keep[6];
+	int n = 0;
+	for (int i = 0; i < 6; ++i) {
+		keep[i] = fpln[i].get_normal().dot(dir) >= 0.0f;
+		if (keep[i]) {
+			pPlanes[n++] = fpln[i];
+		}
+	}
+	cxVec c = fst.get_center();
+	for (int i = 0; i < 12; ++i) {
+		if (keep[s_fstEdges[i].f0] == keep[s_fstEdges[i].f1]) continue;
+		cxVec v0 = fst.get_vertex(s_fstEdges[i].v0);
+		cxVec v1 = fst.get_vertex(s_fstEdges[i].v1);
+		cxVec nrm = nxVec::cross(v1 - v0, dir);
+		float nlen = nrm.mag();
+		/* an edge along the light adds nothing the kept faces do not already bound */
+		if (nlen <= 1.0e-6f * (v1 - v0).mag()) continue;
+		nrm.scl(1.0f / nlen);
+		if (nrm.dot(c - v0) > 0.0f) {
+			nrm.neg();
+		}
+		pPlanes[n].calc(v0, nrm);
+		++n;
+	}
+	return n;
+}
+
+int Tree::calc_clip_planes(const cxMtx& viewProj, cxPlane* pPlanes, const float xyLim, const bool depth) {
+	if (!pPlanes) return 0;
+	/* inside where [p, 1] . coef <= 0 */
+	xt_float4 col[4];
+	for (int j = 0; j < 4; ++j) {
+		col[j].set(viewProj.m[0][j], viewProj.m[1][j], viewProj.m[2][j], viewProj.m[3][j]);
+	}
+	xt_float4 coef[6];
+	int ncoef = 0;
+	for (int j = 0; j < 2; ++j) {
+		for (int s = 0; s < 2; ++s) {
+			float sgn = s ? -1.0f : 1.0f;
+			xt_float4* pCoef = &coef[ncoef++];
+			pCoef->x = col[j].x*sgn - col[3].x*xyLim;
+			pCoef->y = col[j].y*sgn - col[3].y*xyLim;
+			pCoef->z = col[j].z*sgn - col[3].z*xyLim;
+			pCoef->w = col[j].w*sgn - col[3].w*xyLim;
+		}
+	}
+	if (depth) {
+		coef[ncoef++].set(-col[2].x, -col[2].y, -col[2].z, -col[2].w);
+		coef[ncoef++].set(col[2].x - col[3].x, col[2].y - col[3].y, col[2].z - col[3].z, col[2].w - col[3].w);
+	}
+	int n = 0;
+	for (int i = 0; i < ncoef; ++i) {
+		cxVec abc(coef[i].x, coef[i].y, coef[i].z);
+		float len = abc.mag();
+		if (len <= 0.0f) continue;
+		float s = 1.0f / len;
+		cxVec nrm = abc * s;
+		pPlanes[n++].calc(nrm * (-coef[i].w * s), nrm);
+	}
+	return n;
+}
+
+} // ObjBVH
@@ -0,0 +1,286 @@
+namespace ObjBVH {
+
+/* Dynamic AABB tree over movable items.
+   Leaves keep the item's box and a fattened copy that the tree is built from: moves that stay inside the fat box
+   only replace the leaf box, larger ones reinsert the leaf. Insertion picks the sibling by surface area cost and
+   the path to the root is rebalanced with tree rotations, which keeps the height near logarithmic under any order of updates.
+   Queries test the item boxes themselves, internal nodes only prune (or accept whole subtrees that lie inside).
+   refit_items() is the per-frame path for many moving items: leaves are updated in ranges split between the brigade
+   jobs, only the ancestors that no longer hold a moved leaf are marked, and only the marked nodes are refitted,
+   subtree by subtree; the few items that jumped off their fat boxes are reinserted serially. */
+class Tree {
+public:
+	static const int MAX_CASTER_PLANES = 6 + 12;
+	static const int MIN_JOB_NODES = 8192;
+	static const int MIN_JOB_REFITS = 1024;
+
+	/* refit_items() callback, called from the brigade jobs: false drops the item, its leaf is removed after the pass */
+	typedef bool (*ItemBoxFunc)(void* pData, cxAABB* pBox);
+
+protected:
+	struct Node {
+		cxAABB mBox;  /* fat box for leaves */
+		cxAABB mItem; /* leaves: item box */
+		void* mpData;
+		int32_t mParent; /* next free node for free nodes */
+		int32_t mChild[2]; /* -1 for leaves */
+		int32_t mHeight; /* 0 for leaves, -1 for free nodes */
+		int32_t mRefit; /* internal nodes: marked for refit_items(), atomic */
+
+		bool is_leaf() const { return mChild[0] < 0; }
+	};
+
+	enum class Phase {
+		LEAVES,
+		REFIT
+	};
+
+	struct JobInfo {
+		Tree* mpTree;
+		int mOrg;
+		int mNum;
+		int mCnt; /* LEAVES: leaves that marked their ancestors */
+	};
+
+	static const int MAX_REFIT_ROOTS = 256;
+
+	struct StackEntry {
+		int32_t mNode;
+		uint32_t mMask; /* planes still to test, 0: the whole subtree is inside */
+	};
+
+	static const int STACK_SIZE = 128;
+
+	Node* mpNodes;
+	int32_t mRoot;
+	int32_t mFree;
+	int mNodesMax;
+	int mNodesNum;
+	int mLeavesNum;
+	float mMargin;
+	sxJobQueue* mpQue;
+	sxJob* mpJobs;
+	JobInfo* mpJobInfo;
+	int mJobsMax;
+	/* refit_items() state: reinserts grow from the front of mpMoved, drops from the back */
+	int32_t* mpMoved;
+	int mMovedMax;
+	int32_t mReinsNum;
+	int32_t mDropNum;
+	ItemBoxFunc mItemFunc;
+	Phase mPhase;
+	int32_t mRefitRoots[MAX_REFIT_ROOTS];
+	int mRefitRootsNum;
+
+	bool reserve(const int nodesMax);
+	int32_t alloc_node();
+	void free_node(const int32_t id);
+	void insert_leaf(const int32_t leaf);
+	void remove_leaf(const int32_t leaf);
+	int32_t balance(const int32_t ia);
+	void rotate(const int32_t ia);
+	void refit_from(int32_t id);
+	void refit_marked(const int32_t id);
+	int refit_leaves(const int org, const int num);
+	void exec_range(const int org, const int num, JobInfo* pInfo);
+	int exec_phase(const Phase phase, const int n, const int minJobItems, cxBrigade* pBgd);
+	void fatten(const int32_t leaf);
+
+	static void phase_job(const sxJobContext* pCtx);
+	int check_node(const int32_t id, int* pNumLeaves) const;
+
+	static float area(const cxAABB& box) {
+		cxVec s = box.get_size_vec();
+		return 2.0f * (s.x*s.y + s.y*s.z + s.z*s.x);
+	}
+
+	static cxAABB merged(const cxAABB& a, const cxAABB& b) {
+		cxAABB box = a;
+		box.merge(b);
+		return box;
+	}
+
+	static bool box_sph_overlap(const cxAABB& box, const cxVec& c, const float rr) {
+		cxVec bmin = box.get_min_pos();
+		cxVec bmax = box.get_max_pos();
+		cxVec d(
+			c.x < bmin.x ? bmin.x - c.x : (c.x > bmax.x ? c.x - bmax.x : 0.0f),
+			c.y < bmin.y ? bmin.y - c.y : (c.y > bmax.y ? c.y - bmax.y : 0.0f),
+			c.z < bmin.z ? bmin.z - c.z : (c.z > bmax.z ? c.z - bmax.z : 0.0f)
+		);
+		return d.mag2() <= rr;
+	}
+
+	/* -1: outside plane i, 1: inside, 0: straddles */
+	static int classify(const cxAABB& box, const cxPlane& pln) {
+		cxVec c = box.get_center();
+		cxVec r = box.get_max_pos() - c;
+		cxVec n = pln.get_normal();
+		float d = pln.signed_dist(c);
+		float e = r.dot(n.abs_val());
+		float tol = (::fabsf(d) + e + 1.0f) * 1.0e-5f;
+		if (d - e > tol) return -1;
+		if (d + e < -tol) return 1;
+		return 0;
+	}
+
+public:
+	Tree()
+	: mpNodes(nullptr), mRoot(-1), mFree(-1), mNodesMax(0), mNodesNum(0), mLeavesNum(0), mMargin(0.1f),
+	mpQue(nullptr), mpJobs(nullptr), mpJobInfo(nullptr), mJobsMax(0), mpMoved(nullptr), mMovedMax(0),
+	mReinsNum(0), mDropNum(0), mItemFunc(nullptr), mPhase(Phase::LEAVES), mRefitRootsNum(0) {}
+	~Tree() { reset(); }
+
+	/* node storage for maxItems leaves is reserved upfront, the tree grows past it as needed;
+	   maxJobs > 1 lets refit_items() split its work between brigade jobs */
+	void init(const int maxItems = 0, const float margin = 0.1f, const int maxJobs = 0);
+	void reset();
+	void clear();
+
+	/* returns the item id, -1 if out of memory */
+	int add(const cxAABB& box, void* pData = nullptr);
+	void remove(const int id);
+	/* returns true if the leaf was reinserted, false if the box is still inside its fat box */
+	bool update(const int id, const cxAABB& box);
+	/* replaces the item box and refits the ancestors without changing the structure (cheaper, looser tree) */
+	void refit(const int id, const cxAABB& box);
+	/* refit() for every item at once with boxes from func, items whose new box does not even touch the old fat box
+	   are reinserted; returns the number of reinserted items */
+	int refit_items(ItemBoxFunc func, cxBrigade* pBgd = nullptr);
+
+	bool ck_item_id(const int id) const { return id >= 0 && id < mNodesMax && mpNodes[id].mHeight == 0; }
+	void* get_item_data(const int id) const { return ck_item_id(id) ? mpNodes[id].mpData : nullptr; }
+	cxAABB get_item_box(const int id) const { return ck_item_id(id) ? mpNodes[id].mItem : cxAABB(cxVec(0.0f), cxVec(0.0f)); }
+	cxAABB get_fat_box(const int id) const { return ck_item_id(id) ? mpNodes[id].mBox : cxAABB(cxVec(0.0f), cxVec(0.0f)); }
+	int get_items_num() const { return mLeavesNum; }
+	int get_nodes_num() const { return mNodesNum; }
+	int get_height() const { return mRoot >= 0 ? mpNodes[mRoot].mHeight : 0; }
+	float get_margin() const { return mMargin; }
+	void set_margin(const float margin) { mMargin = nxCalc::max(margin, 0.0f); }
+	/* sum of internal node areas over the root area, lower is better */
+	float get_area_ratio() const;
+	/* returns the number of structural errors found */
+	int check() const;
+
+	/* FUNC: void(int id, void* pData) */
+	template<typename FUNC> void query_box(const cxAABB& box, FUNC& func) const {
+		if (mRoot < 0) return;
+		int32_t stk[STACK_SIZE];
+		int sp = 0;
+		stk[sp++] = mRoot;
+		while (sp > 0) {
+			const Node& node = mpNodes[stk[--sp]];
+			if (node.is_leaf()) {
+				if (node.mItem.overlaps(box)) {
+					func(int(&node - mpNodes), node.mpData);
+				}
+			} else if (node.mBox.overlaps(box)) {
+				stk[sp++] = node.mChild[1];
+				stk[sp++] = node.mChild[0];
+			}
+		}
+	}
+
+	template<typename FUNC> void query_sphere(const cxSphere& sph, FUNC& func) const {
+		if (mRoot < 0) return;
+		cxVec c = sph.get_center();
+		float rr = nxCalc::sq(sph.get_radius());
+		int32_t stk[STACK_SIZE];
+		int sp = 0;
+		stk[sp++] = mRoot;
+		while (sp > 0) {
+			const Node& node = mpNodes[stk[--sp]];
+			if (node.is_leaf()) {
+				if (box_sph_overlap(node.mItem, c, rr)) {
+					func(int(&node - mpNodes), node.mpData);
+				}
+			} else if (box_sph_overlap(node.mBox, c, rr)) {
+				stk[sp++] = node.mChild[1];
+				stk[sp++] = node.mChild[0];
+			}
+		}
+	}
+
+	/* convex volume, plane normals point out; items outside any plane are skipped (nplanes <= 32) */
+	template<typename FUNC> void query_planes(const cxPlane* pPlanes, const int nplanes, FUNC& func) const {
+		if (mRoot < 0 || !pPlanes || nplanes <= 0 || nplanes > 32) return;
+		StackEntry stk[STACK_SIZE];
+		int sp = 0;
+		stk[sp].mNode = mRoot;
+		stk[sp].mMask = nplanes < 32 ? (1U << nplanes) - 1 : ~0U;
+		++sp;
+		while (sp > 0) {
+			StackEntry ent = stk[--sp];
+			const Node& node = mpNodes[ent.mNode];
+			const cxAABB& box = node.is_leaf() ? node.mItem : node.mBox;
+			uint32_t mask = ent.mMask;
+			bool outside = false;
+			for (int i = 0; mask >> i; ++i) {
+				if (mask & (1U << i)) {
+					int cls = classify(box, pPlanes[i]);
+					if (cls < 0) {
+						outside = true;
+						break;
+					}
+					if (cls > 0) {
+						mask &= ~(1U << i);
+					}
+				}
+			}
+			if (outside) continue;
+			if (node.is_leaf()) {
+				func(ent.mNode, node.mpData);
+			} else {
+				stk[sp].mNode = node.mChild[1];
+				stk[sp].mMask = mask;
+				++sp;
+				stk[sp].mNode = node.mChild[0];
+				stk[sp].mMask = mask;
+				++sp;
+			}
+		}
+	}
+
+	template<typename FUNC> void query_frustum(const cxFrustum& fst, FUNC& func) const {
+		cxPlane pln[6];
+		calc_frustum_planes(fst, pln);
+		query_planes(pln, 6, func);
+	}
+
+	/* items that can shadow anything inside the frustum under directional light */
+	template<typename FUNC> void query_casters(const cxFrustum& fst, const cxVec& lightDir, FUNC& func) const {
+		cxPlane pln[MAX_CASTER_PLANES];
+		int n = calc_caster_planes(fst, lightDir, pln);
+		query_planes(pln, n, func);
+	}
+
+	/* FUNC: void(int id, void* pData), every item in id order */
+	template<typename FUNC> void for_each(FUNC& func) const {
+		for (int i = 0; i < mNodesMax; ++i) {
+			if (mpNodes[i].mHeight == 0) {
+				func(i, mpNodes[i].mpData);
+			}
+		}
+	}
+
+	/* leaf test used by query_planes() */
+	static bool box_in_planes(const cxAABB& box, const cxPlane* pPlanes, const int nplanes) {
+		for (int i = 0; i < nplanes; ++i) {
+			if (classify(box, pPlanes[i]) < 0) return false;
+		}
+		return true;
+	}
+	static bool box_in_sphere_range(const cxAABB& box, const cxSphere& sph) {
+		return box_sph_overlap(box, sph.get_center(), nxCalc::sq(sph.get_radius()));
+	}
+
+	static void calc_frustum_planes(const cxFrustum& fst, cxPlane* pPlanes);
+	/* frustum swept against the light direction (the direction light travels): faces turned away from the light
+	   are kept and silhouette edges are extruded; returns the number of planes */
+	static int calc_caster_planes(const cxFrustum& fst, const cxVec& lightDir, cxPlane* pPlanes);
+	/* |x| <= xyLim * w, |y| <= xyLim * w and, with depth, 0 <= z <= w for row-vector clip = [p, 1] * viewProj;
+	   exact for affine (orthographic) matrices, returns the number of planes */
+	static int calc_clip_planes(const cxMtx& viewProj, cxPlane* pPlanes, const float xyLim = 1.0f, const bool depth = true);
+};
+
+} // ObjBVH
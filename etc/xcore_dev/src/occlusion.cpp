@@ -0,0 +1,706 @@
+#include "crosscore.hpp"
+#include "occlusion.hpp"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#	define OCC_SSE 1
+#	include <emmintrin.h>
+#else
+#	define OCC_SSE 0
+#endif
+
+/* slack for rounding in edge and depth setup, both only ever make the buffer less occluding */
+#define OCC_EDGE_PAD 0.5005f
+#define OCC_DEPTH_EPS 1.0e-6f
+#define OCC_RECT_EPS 0.01f
+#define OCC_FINE_SPAN 8
+
+namespace Occlusion {
+
+static inline xt_float4 occ_clip(const cxMtx& m, const cxVec& p) {
+	xt_float4 c;
+	c.x = p.x*m.m[0][0] + p.y*m.m[1][0] + p.z*m.m[2][0] + m.m[3][0];
+	c.y = p.x*m.m[0][1] + p.y*m.m[1][1] + p.z*m.m[2][1] + m.m[3][1];
+	c.z = p.x*m.m[0][2] + p.y*m.m[1][2] + p.z*m.m[2][2] + m.m[3][2];
+	c.w = p.x*m.m[0][3] + p.y*m.m[1][3] + p.z*m.m[2][3] + m.m[3][3];
+	return c;
+}
+
+bool Buffer::Plane::calc(const float* pX, const float* pY, const float* pZ) {
+	float dx1 = pX[1] - pX[0];
+	float dy1 = pY[1] - pY[0];
+	float dx2 = pX[2] - pX[0];
+	float dy2 = pY[2] - pY[0];
+	float dz1 = pZ[1] - pZ[0];
+	float dz2 = pZ[2] - pZ[0];
+	float det = dx1*dy2 - dx2*dy1;
+	if (!(::fabsf(det) > 0.0f)) return false;
+	float rdet = 1.0f / det;
+	x = pX[0];
+	y = pY[0];
+	z = pZ[0];
+	dzdx = (dz1*dy2 - dz2*dy1) * rdet;
+	dzdy = (dz2*dx1 - dz1*dx2) * rdet;
+	return true;
+}
+
+void Buffer::init(const int width, const int height, const int maxTris, const int maxJobs) {
+	reset();
+	if (width <= 0 || height <= 0 || maxTris <= 0) return;
+	int size = 0;
+	int w = width;
+	int h = height;
+	int nlvl = 0;
+	while (nlvl < MAX_LVL) {
+		mLvlOffs[nlvl] = size;
+		mLvlW[nlvl] = w;
+		mLvlH[nlvl] = h;
+		size += w * h;
+		++nlvl;
+		if (w == 1 && h == 1) break;
+		w = (w + 1) >> 1;
+		h = (h + 1) >> 1;
+	}
+	mpDepth = (float*)nxCore::mem_alloc(size * sizeof(float), "Occ:Depth");
+	mpTris = (Tri*)nxCore::mem_alloc(maxTris * sizeof(Tri), "Occ:Tris");
+	if (!mpDepth || !mpTris) {
+		reset();
+		return;
+	}
+	for (int i = 0; i < size; ++i) {
+		mpDepth[i] = 1.0f;
+	}
+	mLvlNum = nlvl;
+	mWidth = width;
+	mHeight = height;
+	mTriMax = maxTris;
+	if (maxJobs > 1) {
+		mpQue = nxTask::queue_create(maxJobs);
+		mpJobs = (sxJob*)nxCore::mem_alloc(maxJobs * sizeof(sxJob), "Occ:Jobs");
+		mpJobInfo = (JobInfo*)nxCore::mem_alloc(maxJobs * sizeof(JobInfo), "Occ:JobInfo");
+		if (mpQue && mpJobs && mpJobInfo) {
+			::memset(mpJobs, 0, maxJobs * sizeof(sxJob));
+			mJobsMax = maxJobs;
+		} else {
+			if (mpQue) {
+				nxTask::queue_destroy(mpQue);
+				mpQue = nullptr;
+			}
+			nxCore::mem_free(mpJobs);
+			mpJobs = nullptr;
+			nxCore::mem_free(mpJobInfo);
+			mpJobInfo = nullptr;
+		}
+	}
+}
+
+void Buffer::reset() {
+	nxCore::mem_free(mpDepth);
+	mpDepth = nullptr;
+	nxCore::mem_free(mpTris);
+	mpTris = nullptr;
+	nxCore::mem_free(mpMeshTris);
+	mpMeshTris = nullptr;
+	nxCore::mem_free(mpEdgeTbl);
+	mpEdgeTbl = nullptr;
+	nxCore::mem_free(mpMeshIdx);
+	mpMeshIdx = nullptr;
+	if (mpQue) {
+		nxTask::queue_destroy(mpQue);
+		mpQue = nullptr;
+	}
+	nxCore::mem_free(mpJobs);
+	mpJobs = nullptr;
+	nxCore::mem_free(mpJobInfo);
+	mpJobInfo = nullptr;
+	::memset(&mTest, 0, sizeof(mTest));
+	mLvlNum = 0;
+	mWidth = 0;
+	mHeight = 0;
+	mTriNum = 0;
+	mTriMax = 0;
+	mMeshTriMax = 0;
+	mEdgeTblSize = 0;
+	mJobsMax = 0;
+}
+
+void Buffer::begin(const cxMtx& viewProj) {
+	mViewProj = viewProj;
+	mTriNum = 0;
+	if (!mpDepth) return;
+	int n = mLvlOffs[mLvlNum - 1] + 1;
+	for (int i = 0; i < n; ++i) {
+		mpDepth[i] = 1.0f;
+	}
+}
+
+/* mesh scratch is kept between frames and only grows */
+bool Buffer::reserve_mesh(const int ntri) {
+	if (ntri <= mMeshTriMax) return true;
+	nxCore::mem_free(mpMeshTris);
+	nxCore::mem_free(mpEdgeTbl);
+	nxCore::mem_free(mpMeshIdx);
+	int tblSize = 1;
+	while (tblSize < ntri * 6) {
+		tblSize <<= 1;
+	}
+	mpMeshTris = (MeshTri*)nxCore::mem_alloc(ntri * sizeof(MeshTri), "Occ:MeshTris");
+	mpEdgeTbl = (EdgeSlot*)nxCore::mem_alloc(tblSize * sizeof(EdgeSlot), "Occ:EdgeTbl");
+	mpMeshIdx = (uint32_t*)nxCore::mem_alloc(ntri * 3 * sizeof(uint32_t), "Occ:MeshIdx");
+	if (!mpMeshTris || !mpEdgeTbl || !mpMeshIdx) {
+		nxCore::mem_free(mpMeshTris);
+		mpMeshTris = nullptr;
+		nxCore::mem_free(mpEdgeTbl);
+		mpEdgeTbl = nullptr;
+		nxCore::mem_free(mpMeshIdx);
+		mpMeshIdx = nullptr;
+		mMeshTriMax = 0;
+		mEdgeTblSize = 0;
+		return false;
+	}
+	mMeshTriMax = ntri;
+	mEdgeTblSize = tblSize;
+	return true;
+}
+
+/* pairs triangle edges by vertex ids, an edge used by more than two triangles is left open */
+void Buffer::link_edges(const int ntri) {
+	uint32_t mask = uint32_t(mEdgeTblSize - 1);
+	for (int i = 0; i < mEdgeTblSize; ++i) {
+		mpEdgeTbl[i].ref = -1;
+	}
+	for (int i = 0; i < ntri; ++i) {
+		MeshTri* pTri = &mpMeshTris[i];
+		for (int e = 0; e < 3; ++e) {
+			uint32_t a = pTri->vid[e];
+			uint32_t b = pTri->vid[e < 2 ? e + 1 : 0];
+			if (a == b) continue;
+			uint32_t v0 = nxCalc::min(a, b);
+			uint32_t v1 = nxCalc::max(a, b);
+			uint32_t islot = (v0 * 0x9E3779B1U ^ v1 * 0x85EBCA77U) & mask;
+			while (true) {
+				EdgeSlot* pSlot = &mpEdgeTbl[islot];
+				if (pSlot->ref == -1) {
+					pSlot->v0 = v0;
+					pSlot->v1 = v1;
+					pSlot->ref = i*3 + e;
+					break;
+				}
+				if (pSlot->v0 == v0 && pSlot->v1 == v1) {
+					int32_t ref = pSlot->ref;
+					if (ref >= 0 && ref / 3 != i) {
+						MeshTri* pFirst = &mpMeshTris[ref / 3];
+						int32_t nbr = pFirst->nbr[ref % 3];
+						if (nbr < 0) {
+							pFirst->nbr[ref % 3] = i*3 + e;
+							pTri->nbr[e] = ref;
+						} else {
+							mpMeshTris[nbr / 3].nbr[nbr % 3] = -1;
+							pFirst->nbr[ref % 3] = -1;
+							pSlot->ref = -2;
+						}
+					}
+					break;
+				}
+				islot = (islot + 1) & mask;
+			}
+		}
+	}
+}
+
+void Buffer::add_clipped_tri(const xt_float4* pClip) {
+	/* near plane is z >= 0 in clip space */
+	xt_float4 poly[4];
+	int n = 0;
+	for (int i = 0; i < 3; ++i) {
+		const xt_float4& a = pClip[i];
+		const xt_float4& b = pClip[i < 2 ? i + 1 : 0];
+		bool ina = a.z >= 0.0f;
+		bool inb = b.z >= 0.0f;
+		if (ina) {
+			poly[n++] = a;
+		}
+		if (ina != inb) {
+			float t = a.z / (a.z - b.z);
+			xt_float4 c;
+			c.x = a.x + (b.x - a.x)*t;
+			c.y = a.y + (b.y - a.y)*t;
+			c.z = 0.0f;
+			c.w = a.w + (b.w - a.w)*t;
+			poly[n++] = c;
+		}
+	}
+	if (n < 3) return;
+	float sx[4];
+	float sy[4];
+	float sz[4];
+	float w = float(mWidth);
+	float h = float(mHeight);
+	for (int i = 0; i < n; ++i) {
+		if (!(poly[i].w > 0.0f)) return;
+		float iw = 1.0f / poly[i].w;
+		sx[i] = (poly[i].x*iw*0.5f + 0.5f) * w;
+		sy[i] = (0.5f - poly[i].y*iw*0.5f) * h;
+		sz[i] = poly[i].z*iw;
+	}
+	for (int k = 1; k + 1 < n; ++k) {
+		if (mTriNum >= mTriMax) return;
+		int vi[3] = { 0, k, k + 1 };
+		float minX = nxCalc::min(sx[0], sx[k], sx[k + 1]);
+		float maxX = nxCalc::max(sx[0], sx[k], sx[k + 1]);
+		float minY = nxCalc::min(sy[0], sy[k], sy[k + 1]);
+		float maxY = nxCalc::max(sy[0], sy[k], sy[k + 1]);
+		float minZ = nxCalc::min(sz[0], sz[k], sz[k + 1]);
+		if (maxX < 0.0f || minX > w || maxY < 0.0f || minY > h || minZ >= 1.0f) continue;
+		float area = (sx[k] - sx[0])*(sy[k + 1] - sy[0]) - (sx[k + 1] - sx[0])*(sy[k] - sy[0]);
+		if (!(::fabsf(area) > 0.0f)) continue;
+		if (area < 0.0f) {
+			vi[1] = k + 1;
+			vi[2] = k;
+		}
+		Tri* pTri = &mpTris[mTriNum];
+		float tz[3];
+		for (int j = 0; j < 3; ++j) {
+			pTri->x[j] = sx[vi[j]];
+			pTri->y[j] = sy[vi[j]];
+			tz[j] = sz[vi[j]];
+		}
+		if (!pTri->plane.calc(pTri->x, pTri->y, tz)) continue;
+		::memset(pTri->nbr, 0, sizeof(pTri->nbr));
+		pTri->zmax = nxCalc::max(tz[0], tz[1], tz[2]);
+		pTri->inner = 0;
+		++mTriNum;
+	}
+}
+
+void Buffer::add_mesh_tri(const int itri) {
+	if (mTriNum >= mTriMax) return;
+	const MeshTri& mt = mpMeshTris[itri];
+	float w = float(mWidth);
+	float h = float(mHeight);
+	float minX = nxCalc::min(mt.sx[0], mt.sx[1], mt.sx[2]);
+	float maxX = nxCalc::max(mt.sx[0], mt.sx[1], mt.sx[2]);
+	float minY = nxCalc::min(mt.sy[0], mt.sy[1], mt.sy[2]);
+	float maxY = nxCalc::max(mt.sy[0], mt.sy[1], mt.sy[2]);
+	float minZ = nxCalc::min(mt.sz[0], mt.sz[1], mt.sz[2]);
+	if (maxX < 0.0f || minX > w || maxY < 0.0f || minY > h || minZ >= 1.0f) return;
+	float area = (mt.sx[1] - mt.sx[0])*(mt.sy[2] - mt.sy[0]) - (mt.sx[2] - mt.sx[0])*(mt.sy[1] - mt.sy[0]);
+	if (!(::fabsf(area) > 0.0f)) return;
+	int vi[3] = { 0, 1, 2 };
+	if (area < 0.0f) {
+		vi[1] = 2;
+		vi[2] = 1;
+	}
+	Tri* pTri = &mpTris[mTriNum];
+	float tz[3];
+	for (int j = 0; j < 3; ++j) {
+		pTri->x[j] = mt.sx[vi[j]];
+		pTri->y[j] = mt.sy[vi[j]];
+		tz[j] = mt.sz[vi[j]];
+	}
+	if (!pTri->plane.calc(pTri->x, pTri->y, tz)) return;
+	::memset(pTri->nbr, 0, sizeof(pTri->nbr));
+	float zmax = nxCalc::max(tz[0], tz[1], tz[2]);
+	uint32_t inner = 0;
+	for (int k = 0; k < 3; ++k) {
+		int a = vi[k];
+		int b = vi[k < 2 ? k + 1 : 0];
+		int e = (a < 2 ? a + 1 : 0) == b ? a : b;
+		int32_t ref = mt.nbr[e];
+		if (ref < 0) continue;
+		const MeshTri& nt = mpMeshTris[ref / 3];
+		if (!nt.onScreen) continue;
+		/* inner only when the neighbor lies on the other side of the edge, a fold is a silhouette */
+		int kn = k < 2 ? k + 1 : 0;
+		int iopp = (ref % 3 + 2) % 3;
+		float ea = pTri->y[k] - pTri->y[kn];
+		float eb = pTri->x[kn] - pTri->x[k];
+		float side = ea*(nt.sx[iopp] - pTri->x[k]) + eb*(nt.sy[iopp] - pTri->y[k]);
+		if (!(side < 0.0f)) continue;
+		if (!pTri->nbr[k].calc(nt.sx, nt.sy, nt.sz)) continue;
+		zmax = nxCalc::max(zmax, nt.sz[0], nt.sz[1]);
+		zmax = nxCalc::max(zmax, nt.sz[2]);
+		inner |= 1U << k;
+	}
+	pTri->zmax = zmax;
+	pTri->inner = inner;
+	++mTriNum;
+}
+
+int Buffer::add_mesh(const cxVec* pPnts, const uint32_t* pIdx, const int ntri, const cxMtx* pWorld, const sxModelData* pMdl) {
+	if (!mpTris || !pIdx || ntri <= 0 || !reserve_mesh(ntri)) return 0;
+	int org = mTriNum;
+	float w = float(mWidth);
+	float h = float(mHeight);
+	for (int i = 0; i < ntri; ++i) {
+		MeshTri* pTri = &mpMeshTris[i];
+		pTri->onScreen = true;
+		for (int j = 0; j < 3; ++j) {
+			uint32_t vid = pIdx[i*3 + j];
+			cxVec p = pMdl ? pMdl->get_pnt_pos(int(vid)) : pPnts[vid];
+			if (pWorld) {
+				p = pWorld->calc_pnt(p);
+			}
+			xt_float4 c = occ_clip(mViewProj, p);
+			pTri->clip[j] = c;
+			pTri->vid[j] = vid;
+			pTri->nbr[j] = -1;
+			if (c.z >= 0.0f && c.w > 0.0f) {
+				float iw = 1.0f / c.w;
+				pTri->sx[j] = (c.x*iw*0.5f + 0.5f) * w;
+				pTri->sy[j] = (0.5f - c.y*iw*0.5f) * h;
+				pTri->sz[j] = c.z*iw;
+			} else {
+				pTri->onScreen = false;
+			}
+		}
+	}
+	link_edges(ntri);
+	for (int i = 0; i < ntri; ++i) {
+		if (mpMeshTris[i].onScreen) {
+			add_mesh_tri(i);
+		} else {
+			add_clipped_tri(mpMeshTris[i].clip);
+		}
+	}
+	return mTriNum - org;
+}
+
+int Buffer::add_tris(const cxVec* pPnts, const uint32_t* pIdx, const int ntri, const cxMtx* pWorld) {
+	if (!pPnts) return 0;
+	return add_mesh(pPnts, pIdx, ntri, pWorld, nullptr);
+}
+
+int Buffer::add_model(const sxModelData* pMdl, const cxMtx* pWorld, const int ilod) {
+	if (!mpTris || !pMdl) return 0;
+	int lod = pMdl->ck_lod_id(ilod) ? ilod : 0;
+	int nbat = pMdl->mBatNum;
+	int ntri = 0;
+	for (int ibat = 0; ibat < nbat; ++ibat) {
+		ntri += pMdl->get_lod_batch_tri_num(lod, ibat);
+	}
+	if (ntri <= 0 || !reserve_mesh(ntri)) return 0;
+	uint32_t* pIdx = mpMeshIdx;
+	for (int ibat = 0; ibat < nbat; ++ibat) {
+		int nbtri = pMdl->get_lod_batch_tri_num(lod, ibat);
+		for (int i = 0; i < nbtri; ++i) {
+			xt_int3 tri = pMdl->get_lod_batch_tri_indices(lod, ibat, i);
+			for (int j = 0; j < 3; ++j) {
+				*pIdx++ = uint32_t(tri[j]);
+			}
+		}
+	}
+	return add_mesh(nullptr, mpMeshIdx, ntri, pWorld, pMdl);
+}
+
+int Buffer::add_model_work(const cxModelWork* pWk, const int ilod) {
+	if (!pWk || !pWk->mpData || pWk->mpData->has_skin()) return 0;
+	if (pWk->mpWorldXform) {
+		cxMtx wm = nxMtx::mtx_from_xmtx(*pWk->mpWorldXform);
+		return add_model(pWk->mpData, &wm, ilod);
+	}
+	return add_model(pWk->mpData, nullptr, ilod);
+}
+
+void Buffer::raster_tri(const Tri& tri, const int y0, const int y1) {
+	float minX = nxCalc::min(tri.x[0], tri.x[1], tri.x[2]);
+	float maxX = nxCalc::max(tri.x[0], tri.x[1], tri.x[2]);
+	float minY = nxCalc::min(tri.y[0], tri.y[1], tri.y[2]);
+	float maxY = nxCalc::max(tri.y[0], tri.y[1], tri.y[2]);
+	int ix0 = int(::floorf(nxCalc::max(minX, 0.0f)));
+	int ix1 = int(::floorf(nxCalc::min(maxX, float(mWidth) - 0.5f)));
+	int iy0 = nxCalc::max(int(::floorf(nxCalc::max(minY, 0.0f))), y0);
+	int iy1 = nxCalc::min(int(::floorf(nxCalc::min(maxY, float(mHeight) - 0.5f))), y1 - 1);
+	if (ix0 > ix1 || iy0 > iy1) return;
+	/* edge i: E(p) = a*(px - xi) + b*(py - yi), >= 0 inside;
+	   the pixel square is inside the edge when E at its center clears half the square's extent along the edge normal */
+	float ea[3];
+	float eb[3];
+	float eth[3];
+	float epad[3];
+	float npad[3];
+	for (int i = 0; i < 3; ++i) {
+		int j = i < 2 ? i + 1 : 0;
+		ea[i] = tri.y[i] - tri.y[j];
+		eb[i] = tri.x[j] - tri.x[i];
+		epad[i] = (::fabsf(ea[i]) + ::fabsf(eb[i])) * OCC_EDGE_PAD;
+		eth[i] = (tri.inner & (1U << i)) ? 0.0f : epad[i];
+		npad[i] = (::fabsf(tri.nbr[i].dzdx) + ::fabsf(tri.nbr[i].dzdy)) * 0.5f + OCC_DEPTH_EPS;
+	}
+	/* farthest depth over the pixel square, never beyond the farthest vertex */
+	const Plane& pl = tri.plane;
+	float zpad = (::fabsf(pl.dzdx) + ::fabsf(pl.dzdy)) * 0.5f + OCC_DEPTH_EPS;
+	float zmax = tri.zmax;
+#if OCC_SSE
+	__m128 vOffs = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+	__m128 vA[3];
+	__m128 vX[3];
+	__m128 vT[3];
+	__m128 vP[3];
+	for (int i = 0; i < 3; ++i) {
+		vA[i] = _mm_set1_ps(ea[i]);
+		vX[i] = _mm_set1_ps(tri.x[i]);
+		vT[i] = _mm_set1_ps(eth[i]);
+		vP[i] = _mm_set1_ps(epad[i]);
+	}
+	__m128 vDzdx = _mm_set1_ps(pl.dzdx);
+	__m128 vZx = _mm_set1_ps(pl.x);
+	__m128 vZmax = _mm_set1_ps(zmax);
+#endif
+	for (int iy = iy0; iy <= iy1; ++iy) {
+		float cy = float(iy) + 0.5f;
+		float ry[3];
+		float nzrow[3];
+		for (int i = 0; i < 3; ++i) {
+			ry[i] = eb[i] * (cy - tri.y[i]);
+			nzrow[i] = tri.nbr[i].z + tri.nbr[i].dzdy*(cy - tri.nbr[i].y) + npad[i];
+		}
+		float zrow = pl.z + pl.dzdy*(cy - pl.y) + zpad;
+		float* pRow = &mpDepth[iy * mWidth];
+		int ix = ix0;
+#if OCC_SSE
+		__m128 vR[3];
+		for (int i = 0; i < 3; ++i) {
+			vR[i] = _mm_set1_ps(ry[i]);
+		}
+		__m128 vZrow = _mm_set1_ps(zrow);
+		for (; ix + 4 <= ix1 + 1; ix += 4) {
+			__m128 cx = _mm_add_ps(_mm_set1_ps(float(ix) + 0.5f), vOffs);
+			__m128 e[3];
+			for (int i = 0; i < 3; ++i) {
+				e[i] = _mm_add_ps(_mm_mul_ps(vA[i], _mm_sub_ps(cx, vX[i])), vR[i]);
+			}
+			__m128 mask = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e[0], vT[0]), _mm_cmpge_ps(e[1], vT[1])), _mm_cmpge_ps(e[2], vT[2]));
+			if (_mm_movemask_ps(mask) == 0) continue;
+			__m128 z = _mm_add_ps(vZrow, _mm_mul_ps(vDzdx, _mm_sub_ps(cx, vZx)));
+			for (int i = 0; i < 3; ++i) {
+				if (!(tri.inner & (1U << i))) continue;
+				/* straddling an inner edge: the square also covers the neighbor */
+				__m128 nz = _mm_add_ps(_mm_set1_ps(nzrow[i]), _mm_mul_ps(_mm_set1_ps(tri.nbr[i].dzdx), _mm_sub_ps(cx, _mm_set1_ps(tri.nbr[i].x))));
+				__m128 straddle = _mm_cmplt_ps(e[i], vP[i]);
+				z = _mm_or_ps(_mm_and_ps(straddle, _mm_max_ps(z, nz)), _mm_andnot_ps(straddle, z));
+			}
+			z = _mm_min_ps(z, vZmax);
+			__m128 d = _mm_loadu_ps(&pRow[ix]);
+			__m128 dmin = _mm_min_ps(d, z);
+			_mm_storeu_ps(&pRow[ix], _mm_or_ps(_mm_and_ps(mask, dmin), _mm_andnot_ps(mask, d)));
+		}
+#endif
+		for (; ix <= ix1; ++ix) {
+			float cx = float(ix) + 0.5f;
+			float e[3];
+			for (int i = 0; i < 3; ++i) {
+				e[i] = ea[i]*(cx - tri.x[i]) + ry[i];
+			}
+			if (e[0] >= eth[0] && e[1] >= eth[1] && e[2] >= eth[2]) {
+				float z = zrow + pl.dzdx*(cx - pl.x);
+				for (int i = 0; i < 3; ++i) {
+					if ((tri.inner & (1U << i)) && e[i] < epad[i]) {
+						z = nxCalc::max(z, nzrow[i] + tri.nbr[i].dzdx*(cx - tri.nbr[i].x));
+					}
+				}
+				z = nxCalc::min(z, zmax);
+				pRow[ix] = nxCalc::min(pRow[ix], z);
+			}
+		}
+	}
+}
+
+void Buffer::build_hiz() {
+	for (int lvl = 1; lvl < mLvlNum; ++lvl) {
+		const float* pSrc = &mpDepth[mLvlOffs[lvl - 1]];
+		float* pDst = &mpDepth[mLvlOffs[lvl]];
+		int sw = mLvlW[lvl - 1];
+		int sh = mLvlH[lvl - 1];
+		int w = mLvlW[lvl];
+		int h = mLvlH[lvl];
+		for (int y = 0; y < h; ++y) {
+			int sy0 = y * 2;
+			int sy1 = nxCalc::min(sy0 + 1, sh - 1);
+			for (int x = 0; x < w; ++x) {
+				int sx0 = x * 2;
+				int sx1 = nxCalc::min(sx0 + 1, sw - 1);
+				float d0 = nxCalc::max(pSrc[sy0*sw + sx0], pSrc[sy0*sw + sx1]);
+				float d1 = nxCalc::max(pSrc[sy1*sw + sx0], pSrc[sy1*sw + sx1]);
+				pDst[y*w + x] = nxCalc::max(d0, d1);
+			}
+		}
+	}
+}
+
+void Buffer::exec_range(const int org, const int num) {
+	switch (mPhase) {
+		case Phase::RASTER:
+			for (int i = 0; i < mTriNum; ++i) {
+				raster_tri(mpTris[i], org, org + num);
+			}
+			break;
+		case Phase::TEST_BOXES:
+			for (int i = org; i < org + num; ++i) {
+				uint32_t bits = 0;
+				int ibox = i * 32;
+				int nbox = nxCalc::min(32, mTest.mNum - ibox);
+				for (int j = 0; j < nbox; ++j) {
+					if (is_hidden(mTest.mpBoxes[ibox + j])) {
+						bits |= 1U << j;
+					}
+				}
+				mTest.mpHiddenBits[i] = bits;
+			}
+			break;
+		case Phase::CULL_WORKS:
+			for (int i = org; i < org + num; ++i) {
+				cull(mTest.mppWks[i]);
+			}
+			break;
+	}
+}
+
+void Buffer::phase_job(const sxJobContext* pCtx) {
+	if (!pCtx) return;
+	sxJob* pJob = pCtx->mpJob;
+	if (!pJob) return;
+	JobInfo* pInfo = (JobInfo*)pJob->mpData;
+	if (!pInfo) return;
+	pInfo->mpBuf->exec_range(pInfo->mOrg, pInfo->mNum);
+}
+
+void Buffer::exec_phase(const Phase phase, const int n, const int minJobItems, cxBrigade* pBgd) {
+	mPhase = phase;
+	if (n <= 0) return;
+	if (!pBgd || !mpQue || n < minJobItems * 2) {
+		exec_range(0, n);
+		return;
+	}
+	int njob = nxCalc::min(mJobsMax, n / minJobItems);
+	nxTask::queue_purge(mpQue);
+	for (int i = 0; i < njob; ++i) {
+		int org = int(int64_t(n) * i / njob);
+		int end = int(int64_t(n) * (i + 1) / njob);
+		JobInfo* pInfo = &mpJobInfo[i];
+		pInfo->mpBuf = this;
+		pInfo->mOrg = org;
+		pInfo->mNum = end - org;
+		sxJob* pJob = &mpJobs[i];
+		pJob->mFunc = phase_job;
+		pJob->mpData = pInfo;
+		pJob->mId = i;
+		nxTask::queue_add(mpQue, pJob);
+	}
+	nxTask::queue_exec(mpQue, pBgd);
+}
+
+void Buffer::rasterize(cxBrigade* pBgd) {
+	if (!mpDepth) return;
+	if (mTriNum > 0) {
+		exec_phase(Phase::RASTER, mHeight, 8, pBgd);
+	}
+	build_hiz();
+}
+
+float Buffer::get_depth(const int x, const int y, const int lvl) const {
+	const float* pDepth = get_depth(lvl);
+	if (!pDepth) return 1.0f;
+	if (uint32_t(x) >= uint32_t(mLvlW[lvl]) || uint32_t(y) >= uint32_t(mLvlH[lvl])) return 1.0f;
+	return pDepth[y*mLvlW[lvl] + x];
+}
+
+static bool occ_rect_behind(const float* pDepth, const int lw, const int x0, const int y0, const int x1, const int y1, const float z) {
+	for (int y = y0; y <= y1; ++y) {
+		const float* pRow = &pDepth[y*lw];
+		for (int x = x0; x <= x1; ++x) {
+			if (!(z > pRow[x])) return false;
+		}
+	}
+	return true;
+}
+
+bool Buffer::is_hidden(const cxAABB& box) const {
+	if (!mpDepth || mTriNum <= 0) return false;
+	cxVec bb[2];
+	bb[0] = box.get_min_pos();
+	bb[1] = box.get_max_pos();
+	float w = float(mWidth);
+	float h = float(mHeight);
+	float minX = FLT_MAX;
+	float maxX = -FLT_MAX;
+	float minY = FLT_MAX;
+	float maxY = -FLT_MAX;
+	float minZ = FLT_MAX;
+	for (int i = 0; i < 8; ++i) {
+		cxVec p(bb[i & 1].x, bb[(i >> 1) & 1].y, bb[(i >> 2) & 1].z);
+		xt_float4 c = occ_clip(mViewProj, p);
+		/* crossing the near plane: nothing to compare against */
+		if (!(c.z >= 0.0f) || !(c.w > 0.0f)) return false;
+		float iw = 1.0f / c.w;
+		float sx = (c.x*iw*0.5f + 0.5f) * w;
+		float sy = (0.5f - c.y*iw*0.5f) * h;
+		minX = nxCalc::min(minX, sx);
+		maxX = nxCalc::max(maxX, sx);
+		minY = nxCalc::min(minY, sy);
+		maxY = nxCalc::max(maxY, sy);
+		minZ = nxCalc::min(minZ, c.z*iw);
+	}
+	/* off screen is left to frustum culling */
+	if (maxX < 0.0f || minX > w || maxY < 0.0f || minY > h) return false;
+	int ix0 = int(::floorf(nxCalc::max(minX - OCC_RECT_EPS, 0.0f)));
+	int ix1 = int(::floorf(nxCalc::min(maxX + OCC_RECT_EPS, w - 0.5f)));
+	int iy0 = int(::floorf(nxCalc::max(minY - OCC_RECT_EPS, 0.0f)));
+	int iy1 = int(::floorf(nxCalc::min(maxY + OCC_RECT_EPS, h - 0.5f)));
+	if (ix0 > ix1 || iy0 > iy1) return false;
+	/* coarsest level where the rectangle spans at most 2x2 texels, then a finer level of up to 8x8 texels when that fails */
+	int lvl = 0;
+	while (lvl < mLvlNum - 1 && ((ix1 >> lvl) - (ix0 >> lvl) > 1 || (iy1 >> lvl) - (iy0 >> lvl) > 1)) {
+		++lvl;
+	}
+	if (occ_rect_behind(&mpDepth[mLvlOffs[lvl]], mLvlW[lvl], ix0 >> lvl, iy0 >> lvl, ix1 >> lvl, iy1 >> lvl, minZ)) return true;
+	int fine = lvl;
+	while (fine > 0 && (ix1 >> (fine - 1)) - (ix0 >> (fine - 1)) < OCC_FINE_SPAN && (iy1 >> (fine - 1)) - (iy0 >> (fine - 1)) < OCC_FINE_SPAN) {
+		--fine;
+	}
+	if (fine == lvl) return false;
+	return occ_rect_behind(&mpDepth[mLvlOffs[fine]], mLvlW[fine], ix0 >> fine, iy0 >> fine, ix1 >> fine, iy1 >> fine, minZ);
+}
+
+void Buffer::test_boxes(const cxAABB* pBoxes, const int n, uint32_t* pHiddenBits, cxBrigade* pBgd) {
+	if (!pBoxes || !pHiddenBits || n <= 0) return;
+	mTest.mpBoxes = pBoxes;
+	mTest.mpHiddenBits = pHiddenBits;
+	mTest.mNum = n;
+	/* whole bit words per job */
+	exec_phase(Phase::TEST_BOXES, XD_BIT_ARY_SIZE(uint32_t, n), 8, pBgd);
+	::memset(&mTest, 0, sizeof(mTest));
+}
+
+int Buffer::cull(cxModelWork* pWk) const {
+	if (!pWk || !pWk->mpData || !pWk->mpCullBits || !pWk->mBoundsValid) return 0;
+	int nbat = pWk->get_batches_num();
+	int ncull = 0;
+	if (is_hidden(pWk->mWorldBBox)) {
+		for (int i = 0; i < nbat; ++i) {
+			if (!XD_BIT_ARY_CK(uint32_t, pWk->mpCullBits, i)) {
+				XD_BIT_ARY_ST(uint32_t, pWk->mpCullBits, i);
+				++ncull;
+			}
+		}
+		return ncull;
+	}
+	if (nbat > 1 && pWk->mpBatBBoxes) {
+		for (int i = 0; i < nbat; ++i) {
+			if (!XD_BIT_ARY_CK(uint32_t, pWk->mpCullBits, i) && is_hidden(pWk->mpBatBBoxes[i])) {
+				XD_BIT_ARY_ST(uint32_t, pWk->mpCullBits, i);
+				++ncull;
+			}
+		}
+	}
+	return ncull;
+}
+
+void Buffer::cull_works(cxModelWork** ppWks, const int n, cxBrigade* pBgd) {
+	if (!ppWks || n <= 0) return;
+	mTest.mppWks = ppWks;
+	mTest.mNum = n;
+	exec_phase(Phase::CULL_WORKS, n, 4, pBgd);
+	::memset(&mTest, 0, sizeof(mTest));
+}
+
+} // Occlusion
@@ -0,0 +1,143 @@
+namespace Occlusion {
+
+/* Low-resolution CPU depth buffer for occlusion culling.
+   A pixel is written only when the occluder is known to cover all of it, with the farthest occluder depth over the pixel:
+   silhouette and open edges must clear the whole pixel, edges shared by two triangles that tile across it on screen
+   are sampled at pixel centers and take the farther of both planes, so meshes leave no cracks along interior edges.
+   A max-depth hierarchy is built on top and bounds are reported hidden only when every pixel they may touch lies behind an occluder.
+   Depth is z/w in [0, 1] as produced by cxMtx::mk_proj, rows go top to bottom.
+   Rasterisation is split into row bands and tests into ranges of boxes or model works, results do not depend on the job count. */
+class Buffer {
+protected:
+	enum class Phase {
+		RASTER,
+		TEST_BOXES,
+		CULL_WORKS
+	};
+
+	/* screen-space depth plane through (x, y, z) */
+	struct Plane {
+		float x;
+		float y;
+		float z;
+		float dzdx;
+		float dzdy;
+
+		bool calc(const float* pX, const float* pY, const float* pZ);
+	};
+
+	struct Tri {
+		float x[3];
+		float y[3];
+		Plane plane;
+		Plane nbr[3]; /* across edge i (from vertex i to i+1), valid for inner edges */
+		float zmax;   /* farthest vertex of the triangle and its inner neighbors */
+		uint32_t inner;
+	};
+
+	struct MeshTri {
+		xt_float4 clip[3];
+		float sx[3];
+		float sy[3];
+		float sz[3];
+		uint32_t vid[3];
+		int32_t nbr[3]; /* neighbor tri * 3 + edge, -1 for open or non-manifold edges */
+		bool onScreen;
+	};
+
+	struct EdgeSlot {
+		uint32_t v0;
+		uint32_t v1;
+		int32_t ref; /* first tri * 3 + edge, -1 empty, -2 non-manifold */
+	};
+
+	struct JobInfo {
+		Buffer* mpBuf;
+		int mOrg;
+		int mNum;
+	};
+
+	struct TestParams {
+		const cxAABB* mpBoxes;
+		uint32_t* mpHiddenBits;
+		cxModelWork** mppWks;
+		int mNum;
+	};
+
+	static const int MAX_LVL = 16;
+
+	float* mpDepth; /* all levels, level 0 is width x height */
+	Tri* mpTris;
+	MeshTri* mpMeshTris;
+	EdgeSlot* mpEdgeTbl;
+	uint32_t* mpMeshIdx;
+	sxJobQueue* mpQue;
+	sxJob* mpJobs;
+	JobInfo* mpJobInfo;
+	TestParams mTest;
+	cxMtx mViewProj;
+	Phase mPhase;
+	int mLvlOffs[MAX_LVL];
+	int mLvlW[MAX_LVL];
+	int mLvlH[MAX_LVL];
+	int mLvlNum;
+	int mWidth;
+	int mHeight;
+	int mTriNum;
+	int mTriMax;
+	int mMeshTriMax;
+	int mEdgeTblSize;
+	int mJobsMax;
+
+	bool reserve_mesh(const int ntri);
+	void link_edges(const int ntri);
+	void add_clipped_tri(const xt_float4* pClip);
+	void add_mesh_tri(const int itri);
+	int add_mesh(const cxVec* pPnts, const uint32_t* pIdx, const int ntri, const cxMtx* pWorld, const sxModelData* pMdl);
+	void raster_tri(const Tri& tri, const int y0, const int y1);
+	void build_hiz();
+	void exec_range(const int org, const int num);
+	void exec_phase(const Phase phase, const int n, const int minJobItems, cxBrigade* pBgd);
+
+	static void phase_job(const sxJobContext* pCtx);
+
+public:
+	Buffer()
+	: mpDepth(nullptr), mpTris(nullptr), mpMeshTris(nullptr), mpEdgeTbl(nullptr), mpMeshIdx(nullptr),
+	mpQue(nullptr), mpJobs(nullptr), mpJobInfo(nullptr), mPhase(Phase::RASTER),
+	mLvlNum(0), mWidth(0), mHeight(0), mTriNum(0), mTriMax(0), mMeshTriMax(0), mEdgeTblSize(0), mJobsMax(0) {
+		::memset(&mTest, 0, sizeof(mTest));
+		mViewProj.identity();
+	}
+
+	~Buffer() { reset(); }
+
+	void init(const int width, const int height, const int maxTris, const int maxJobs = 0);
+	void reset();
+
+	/* clears the depth and the occluder list */
+	void begin(const cxMtx& viewProj);
+	/* both faces are drawn, triangles crossing the near plane are clipped (and lose their inner edges);
+	   return the number of triangles queued, occluders beyond init() maxTris are dropped (which only makes the buffer less occluding) */
+	int add_tris(const cxVec* pPnts, const uint32_t* pIdx, const int ntri, const cxMtx* pWorld = nullptr);
+	int add_model(const sxModelData* pMdl, const cxMtx* pWorld = nullptr, const int ilod = 0);
+	/* rigid or static works only, skinned models are skipped */
+	int add_model_work(const cxModelWork* pWk, const int ilod = 0);
+	void rasterize(cxBrigade* pBgd = nullptr);
+
+	bool is_hidden(const cxAABB& box) const;
+	/* bit i of pHiddenBits is set for hidden boxes and cleared otherwise */
+	void test_boxes(const cxAABB* pBoxes, const int n, uint32_t* pHiddenBits, cxBrigade* pBgd = nullptr);
+	/* adds hidden batches to mpCullBits, all of them when the world bounds are hidden; returns the number of batches culled here */
+	int cull(cxModelWork* pWk) const;
+	void cull_works(cxModelWork** ppWks, const int n, cxBrigade* pBgd = nullptr);
+
+	int get_width() const { return mWidth; }
+	int get_height() const { return mHeight; }
+	int get_levels_num() const { return mLvlNum; }
+	int get_tris_num() const { return mTriNum; }
+	const float* get_depth(const int lvl = 0) const { return (mpDepth && lvl >= 0 && lvl < mLvlNum) ? &mpDepth[mLvlOffs[lvl]] : nullptr; }
+	float get_depth(const int x, const int y, const int lvl = 0) const;
+};
+
+} // Occlusion
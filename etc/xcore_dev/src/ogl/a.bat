@@ -50,6 +50,10 @@ call :vert vtx_rigid0 rigid0.vert rigid0.vert
 call :vert vtx_skin1 skin1.vert f_skin.glsl+skin1.vert
 call :vert vtx_rigid1 rigid1.vert rigid1.vert
 
+rem instanced rigid: world rows from per-instance attributes
+call :vert vtx_rigid0_inst rigid0_inst.vert rigid0_inst.vert
+call :vert vtx_rigid1_inst rigid1_inst.vert rigid1_inst.vert
+
 
 rem vertex hemi lighting
 
@@ -59,6 +63,9 @@ call :vert vtx_rigid0 rigid0_vl.vert f_hemi.glsl+rigid0_vl.vert
 call :vert vtx_skin1 skin1_vl.vert f_skin.glsl+f_hemi.glsl+skin1_vl.vert
 call :vert vtx_rigid1 rigid1_vl.vert f_hemi.glsl+rigid1_vl.vert
 
+call :vert vtx_rigid0_inst rigid0_vl_inst.vert f_hemi.glsl+rigid0_vl_inst.vert
+call :vert vtx_rigid1_inst rigid1_vl_inst.vert f_hemi.glsl+rigid1_vl_inst.vert
+
 
 
 rem hemi light
@@ -0,0 +1,9 @@
+void main() {
+	HALF vec3 vnrm = octaDec(vtxOct);
+	FULL vec4 wm[3];
+	wm[0] = vtxInstW0;
+	wm[1] = vtxInstW1;
+	wm[2] = vtxInstW2;
+	calcVtxOut(wm, vtxPos, vnrm, vtxTex, vtxClr, 1.0, 1.0, pixPos, pixNrm, pixTex, pixClr);
+	calcGLPos(pixPos);
+}
@@ -1,4 +1,6 @@
 #include "oglsys.hpp"
+#include <string.h>
+#include <stdlib.h>
 
 #ifdef DUMMY_GL
 
@@ -12,6 +14,84 @@ GLuint s_iprg = 0;
 GLuint s_ifbo = 0;
 GLuint s_irbo = 0;
 
+GLuint s_curPrg = 0;
+GLuint s_curFBO = 0;
+GLuint s_curVB = 0;
+GLenum s_curTexUnit = 0;
+GLuint s_curTex[16] = {};
+
+/* world transform uniform (gpWorld) is kept per program so the instance data of every draw can be recorded */
+const GLint WORLD_LOC = 2;
+const GLuint WORLD_PROGS_MAX = 1024;
+GLfloat s_progWorld[WORLD_PROGS_MAX][12] = {};
+DrawRec* s_pRecs = nullptr;
+int s_recsMax = 0;
+int s_recsNum = 0;
+
+/* vertex buffer contents and per-instance attributes (vtxInstW0..2), for the world rows of instanced draws */
+const GLint INST_ATTR_LOC = 8;
+const GLuint BUF_DATA_MAX = 1024;
+const GLuint ATTRS_MAX = 16;
+
+struct BufData {
+	void* pMem;
+	size_t size;
+};
+
+struct AttrPtr {
+	GLuint buf;
+	GLsizei stride;
+	intptr_t offs;
+	GLuint divisor;
+};
+
+BufData s_bufData[BUF_DATA_MAX] = {};
+AttrPtr s_attrs[ATTRS_MAX] = {};
+
+void rec_start(DrawRec* pRecs, const int maxRecs) {
+	s_pRecs = pRecs;
+	s_recsMax = pRecs ? maxRecs : 0;
+	s_recsNum = 0;
+}
+
+int rec_stop() {
+	int n = s_recsNum;
+	s_pRecs = nullptr;
+	s_recsMax = 0;
+	s_recsNum = 0;
+	return n;
+}
+
+static void rec_draw(const GLsizei count, const GLint inst = -1, const GLfloat* pWorld = nullptr) {
+	if (s_pRecs && s_recsNum < s_recsMax) {
+		DrawRec* pRec = &s_pRecs[s_recsNum++];
+		pRec->fbo = s_curFBO;
+		pRec->prog = s_curPrg;
+		pRec->tex = s_curTex[0];
+		pRec->count = count;
+		pRec->inst = inst;
+		if (pWorld) {
+			::memcpy(pRec->world, pWorld, sizeof(pRec->world));
+		} else if (s_curPrg < WORLD_PROGS_MAX) {
+			::memcpy(pRec->world, s_progWorld[s_curPrg], sizeof(pRec->world));
+		} else {
+			::memset(pRec->world, 0, sizeof(pRec->world));
+		}
+	}
+}
+
+/* world row i of instance inst from the vtxInstW<i> attribute, false if it does not point into uploaded data */
+static bool inst_world_row(const int i, const GLsizei inst, GLfloat* pRow) {
+	const AttrPtr& attr = s_attrs[INST_ATTR_LOC + i];
+	if (attr.divisor == 0 || attr.buf >= BUF_DATA_MAX) return false;
+	const BufData& data = s_bufData[attr.buf];
+	size_t stride = attr.stride > 0 ? size_t(attr.stride) : sizeof(GLfloat) * 4;
+	size_t offs = size_t(attr.offs) + (inst / attr.divisor) * stride;
+	if (!data.pMem || offs + sizeof(GLfloat) * 4 > data.size) return false;
+	::memcpy(pRow, (const uint8_t*)data.pMem + offs, sizeof(GLfloat) * 4);
+	return true;
+}
+
 void APIENTRY Viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
 }
 
@@ -123,18 +203,44 @@ void APIENTRY GenBuffers(GLsizei n, GLuint* pBuffers) {
 }
 
 void APIENTRY BindBuffer(GLenum target, GLuint buffer) {
+	if (target == GL_ARRAY_BUFFER) {
+		s_curVB = buffer;
+	}
 }
 
 void APIENTRY BufferData(GLenum target, GLsizeiptr size, const void* pData, GLenum usage) {
+	if (target != GL_ARRAY_BUFFER || s_curVB >= BUF_DATA_MAX || size <= 0) return;
+	BufData& data = s_bufData[s_curVB];
+	void* pMem = ::realloc(data.pMem, size_t(size));
+	if (!pMem) return;
+	data.pMem = pMem;
+	data.size = size_t(size);
+	if (pData) {
+		::memcpy(pMem, pData, size_t(size));
+	}
 }
 
 void APIENTRY BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* pData) {
+	if (target != GL_ARRAY_BUFFER || s_curVB >= BUF_DATA_MAX || !pData) return;
+	BufData& data = s_bufData[s_curVB];
+	if (!data.pMem || offset < 0 || size <= 0 || size_t(offset + size) > data.size) return;
+	::memcpy((uint8_t*)data.pMem + offset, pData, size_t(size));
 }
 
 void APIENTRY BindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
 }
 
 void APIENTRY DeleteBuffers(GLsizei n, const GLuint* pBuffers) {
+	if (n > 0 && pBuffers) {
+		for (GLsizei i = 0; i < n; ++i) {
+			GLuint ibuf = pBuffers[i];
+			if (ibuf < BUF_DATA_MAX) {
+				::free(s_bufData[ibuf].pMem);
+				s_bufData[ibuf].pMem = nullptr;
+				s_bufData[ibuf].size = 0;
+			}
+		}
+	}
 }
 
 void APIENTRY GenSamplers(GLsizei n, GLuint* pSamplers) {
@@ -170,6 +276,9 @@ void APIENTRY DeleteTextures(GLsizei n, const GLuint* pTextures) {
 }
 
 void APIENTRY BindTexture(GLenum target, GLuint texture) {
+	if (target == GL_TEXTURE_2D && s_curTexUnit < 16) {
+		s_curTex[s_curTexUnit] = texture;
+	}
 }
 
 void APIENTRY TexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const void* pPixels) {
@@ -188,6 +297,7 @@ void APIENTRY TexParameteri(GLenum target, GLenum pname, GLint param) {
 }
 
 void APIENTRY ActiveTexture(GLenum texture) {
+	s_curTexUnit = texture - GL_TEXTURE0;
 }
 
 void APIENTRY GenerateMipmap(GLenum target) {
@@ -255,6 +365,7 @@ void APIENTRY DeleteProgram(GLuint program) {
 }
 
 void APIENTRY UseProgram(GLuint program) {
+	s_curPrg = program;
 }
 
 void APIENTRY GetProgramiv(GLuint program, GLenum pname, GLint* pParams) {
@@ -281,7 +392,7 @@ void APIENTRY GetProgramInfoLog(GLuint program, GLsizei bufSize, GLsizei* pLengt
 GLint APIENTRY GetUniformLocation(GLuint program, const GLchar* pName) {
 	GLint loc = 0;
 	if (program) {
-		loc = 1;
+		loc = (pName && ::strcmp(pName, "gpWorld") == 0) ? WORLD_LOC : 1;
 	}
 	return loc;
 }
@@ -302,13 +413,20 @@ void APIENTRY Uniform3fv(GLint location, GLsizei count, const GLfloat* pValue) {
 }
 
 void APIENTRY Uniform4fv(GLint location, GLsizei count, const GLfloat* pValue) {
+	if (location == WORLD_LOC && count >= 3 && pValue && s_curPrg < WORLD_PROGS_MAX) {
+		::memcpy(s_progWorld[s_curPrg], pValue, sizeof(s_progWorld[0]));
+	}
 }
 
 void APIENTRY UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* pValue) {
 }
 
 GLint APIENTRY GetAttribLocation(GLuint program, const GLchar* name) {
-	return 0;
+	GLint loc = 0;
+	if (name && ::strncmp(name, "vtxInstW", 8) == 0 && name[8] >= '0' && name[8] <= '2' && name[9] == 0) {
+		loc = INST_ATTR_LOC + (name[8] - '0');
+	}
+	return loc;
 }
 
 GLuint APIENTRY GetUniformBlockIndex(GLuint program, const GLchar* pUniformBlockName) {
@@ -323,6 +441,17 @@ void APIENTRY UniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLui
 }
 
 void APIENTRY VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer) {
+	if (index < ATTRS_MAX) {
+		s_attrs[index].buf = s_curVB;
+		s_attrs[index].stride = stride;
+		s_attrs[index].offs = (intptr_t)pointer;
+	}
+}
+
+void APIENTRY VertexAttribDivisor(GLuint index, GLuint divisor) {
+	if (index < ATTRS_MAX) {
+		s_attrs[index].divisor = divisor;
+	}
 }
 
 void APIENTRY EnableVertexAttribArray(GLuint index) {
@@ -341,9 +470,22 @@ void APIENTRY BindBufferBase(GLenum target, GLuint index, GLuint buffer) {
 }
 
 void APIENTRY DrawArrays(GLenum mode, GLint first, GLsizei count) {
+	rec_draw(count);
 }
 
 void APIENTRY DrawElements(GLenum mode, GLsizei count, GLenum type, const void* pIndices) {
+	rec_draw(count);
+}
+
+void APIENTRY DrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* pIndices, GLsizei ninst) {
+	for (GLsizei i = 0; i < ninst; ++i) {
+		GLfloat world[12];
+		bool worldOk = true;
+		for (int j = 0; j < 3; ++j) {
+			worldOk = worldOk && inst_world_row(j, i, &world[j * 4]);
+		}
+		rec_draw(count, i, worldOk ? world : nullptr);
+	}
 }
 
 void APIENTRY GenFramebuffers(GLsizei n, GLuint* pFramebuffers) {
@@ -360,6 +502,9 @@ void APIENTRY DeleteFramebuffers(GLsizei n, const GLuint* pFramebuffers) {
 }
 
 void APIENTRY BindFramebuffer(GLenum target, GLuint framebuffer) {
+	if (target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER) {
+		s_curFBO = framebuffer;
+	}
 }
 
 void APIENTRY FramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level) {
@@ -412,6 +557,8 @@ __attribute__((noinline))
 #endif
 void dummyglInit() {
 #		include "oglsys.inc"
+	glDrawElementsInstanced = dummygl::DrawElementsInstanced;
+	glVertexAttribDivisor = dummygl::VertexAttribDivisor;
 }
 
 #undef OGL_FN
@@ -171,6 +171,8 @@ typedef void* (GL_APIENTRYP OGLSYS_PFNGLMAPBUFFERRANGEPROC)(GLenum, GLintptr, GL
 typedef GLboolean (GL_APIENTRYP OGLSYS_PFNGLUNMAPBUFFERPROC)(GLenum);
 typedef void (GL_APIENTRYP OGLSYS_PFNGLUNIFORMBLOCKBINDINGPROC)(GLuint, GLuint, GLuint);
 typedef void (GL_APIENTRYP OGLSYS_PFNGLBINDBUFFERBASEPROC)(GLenum, GLuint, GLuint);
+typedef void (GL_APIENTRYP OGLSYS_PFNGLDRAWELEMENTSINSTANCEDPROC)(GLenum, GLsizei, GLenum, const void*, GLsizei);
+typedef void (GL_APIENTRYP OGLSYS_PFNGLVERTEXATTRIBDIVISORPROC)(GLuint, GLuint);
 #endif
 
 #if defined(OGLSYS_DRM_ES)
@@ -290,6 +292,8 @@ static struct OGLSysGlb {
 		OGLSYS_PFNGLUNMAPBUFFERPROC pfnUnmapBuffer;
 		OGLSYS_PFNGLUNIFORMBLOCKBINDINGPROC pfnUniformBlockBinding;
 		OGLSYS_PFNGLBINDBUFFERBASEPROC pfnBindBufferBase;
+		OGLSYS_PFNGLDRAWELEMENTSINSTANCEDPROC pfnDrawElementsInstanced;
+		OGLSYS_PFNGLVERTEXATTRIBDIVISORPROC pfnVertexAttribDivisor;
 #endif
 		bool bindlessTex;
 		bool ASTC_LDR;
@@ -1627,6 +1631,8 @@ void OGLSysGlb::init_ogl() {
 	mExts.pfnUnmapBuffer = (OGLSYS_PFNGLUNMAPBUFFERPROC)eglGetProcAddress("glUnmapBuffer");
 	mExts.pfnUniformBlockBinding = (OGLSYS_PFNGLUNIFORMBLOCKBINDINGPROC)eglGetProcAddress("glUniformBlockBinding");
 	mExts.pfnBindBufferBase = (OGLSYS_PFNGLBINDBUFFERBASEPROC)eglGetProcAddress("glBindBufferBase");
+	mExts.pfnDrawElementsInstanced = (OGLSYS_PFNGLDRAWELEMENTSINSTANCEDPROC)eglGetProcAddress("glDrawElementsInstanced");
+	mExts.pfnVertexAttribDivisor = (OGLSYS_PFNGLVERTEXATTRIBDIVISORPROC)eglGetProcAddress("glVertexAttribDivisor");
 #endif
 
 #if defined(OGLSYS_VIVANTE_FB)
@@ -3014,6 +3020,38 @@ namespace OGLSys {
 #endif
 	}
 
+	void draw_tris_inst(const int ntris, const GLenum idxType, const intptr_t ibOrg, const int ninst) {
+#if OGLSYS_ES
+		if (GLG.mExts.pfnDrawElementsInstanced != nullptr) {
+			GLG.mExts.pfnDrawElementsInstanced(GL_TRIANGLES, ntris * 3, idxType, (const void*)ibOrg, ninst);
+		}
+#elif defined(OGLSYS_APPLE)
+		/* no-op */
+#elif defined(OGLSYS_WEB)
+		/* no-op */
+#else
+		if (glDrawElementsInstanced != nullptr) {
+			glDrawElementsInstanced(GL_TRIANGLES, ntris * 3, idxType, (const void*)ibOrg, ninst);
+		}
+#endif
+	}
+
+	void set_attr_divisor(const GLuint idx, const GLuint divisor) {
+#if OGLSYS_ES
+		if (GLG.mExts.pfnVertexAttribDivisor != nullptr) {
+			GLG.mExts.pfnVertexAttribDivisor(idx, divisor);
+		}
+#elif defined(OGLSYS_APPLE)
+		/* no-op */
+#elif defined(OGLSYS_WEB)
+		/* no-op */
+#else
+		if (glVertexAttribDivisor != nullptr) {
+			glVertexAttribDivisor(idx, divisor);
+		}
+#endif
+	}
+
 
 	GLuint get_black_tex() {
 		if (s_initFlg && !GLG.mWithoutCtx && GLG.valid_ogl()) {
@@ -3176,6 +3214,22 @@ namespace OGLSys {
 		return res;
 	}
 
+	bool ext_ck_instancing() {
+		bool res = false;
+#if OGLSYS_ES
+		if (GLG.mExts.pfnDrawElementsInstanced != nullptr && GLG.mExts.pfnVertexAttribDivisor != nullptr) {
+			res = true;
+		}
+#elif defined(OGLSYS_APPLE)
+#elif defined(OGLSYS_WEB)
+#else
+		if (glDrawElementsInstanced != nullptr && glVertexAttribDivisor != nullptr) {
+			res = true;
+		}
+#endif
+		return res;
+	}
+
 	bool ext_ck_mdi() {
 		return GLG.mExts.mdi;
 	}
@@ -326,6 +326,8 @@ namespace OGLSys {
 	void del_vao(const GLuint vao);
 
 	void draw_tris_base_vtx(const int ntris, const GLenum idxType, const intptr_t ibOrg, const int baseVtx);
+	void draw_tris_inst(const int ntris, const GLenum idxType, const intptr_t ibOrg, const int ninst);
+	void set_attr_divisor(const GLuint idx, const GLuint divisor);
 
 	GLuint get_black_tex();
 	GLuint get_white_tex();
@@ -344,6 +346,7 @@ namespace OGLSys {
 	bool ext_ck_spv();
 	bool ext_ck_vao();
 	bool ext_ck_vtx_base();
+	bool ext_ck_instancing();
 	bool ext_ck_mdi();
 	bool ext_ck_nv_vbum();
 	bool ext_ck_nv_ubum();
@@ -452,3 +455,23 @@ namespace OGLSys {
 		bool event_ck_complete(Event evt);
 	} // CL
 }  // OGLSys
+
+#ifdef OGLSYS_DUMMY
+namespace dummygl {
+	/* draw calls seen by the dummy backend in submission order: bound framebuffer, program, unit 0 texture
+	   and the program's world transform (gpWorld, 3 rows); an instanced draw gives one record per instance,
+	   with the world rows read from the vtxInstW0..2 attribute buffer */
+	struct DrawRec {
+		GLuint fbo;
+		GLuint prog;
+		GLuint tex;
+		GLsizei count;
+		GLint inst; /* instance index, -1: not an instanced draw */
+		GLfloat world[12];
+	};
+
+	/* records up to maxRecs draw calls into pRecs until rec_stop(), which returns the number recorded */
+	void rec_start(DrawRec* pRecs, const int maxRecs);
+	int rec_stop();
+} // dummygl
+#endif
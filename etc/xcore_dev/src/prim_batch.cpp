@@ -0,0 +1,198 @@
+#include "crosscore.hpp"
+#include "prim_batch.hpp"
+
+namespace PrimBatch {
+
+static const int32_t MAX_IDX_VTX = 0x10000;
+
+bool Buffer::init(const int maxVtx, const int maxIdx, const int maxPrims) {
+	reset();
+	if (maxVtx < 3 || maxIdx < 3 || maxPrims < 1) return false;
+	int nvtx = nxCalc::min(maxVtx, MAX_IDX_VTX);
+	mpVtx = (sxPrimVtx*)nxCore::mem_alloc(nvtx * sizeof(sxPrimVtx), "PrimBatch:Vtx");
+	mpIdx = (uint16_t*)nxCore::mem_alloc(maxIdx * sizeof(uint16_t), "PrimBatch:Idx");
+	mpDrawIdx = (uint16_t*)nxCore::mem_alloc(maxIdx * sizeof(uint16_t), "PrimBatch:DrawIdx");
+	mpEntries = (Entry*)nxCore::mem_alloc(maxPrims * sizeof(Entry), "PrimBatch:Entries");
+	mpBatches = (Batch*)nxCore::mem_alloc(maxPrims * sizeof(Batch), "PrimBatch:Batches");
+	if (!mpVtx || !mpIdx || !mpDrawIdx || !mpEntries || !mpBatches) {
+		reset();
+		return false;
+	}
+	mVtxMax = nvtx;
+	mIdxMax = maxIdx;
+	mPrimsMax = maxPrims;
+	return true;
+}
+
+void Buffer::reset() {
+	nxCore::mem_free(mpVtx);
+	mpVtx = nullptr;
+	nxCore::mem_free(mpIdx);
+	mpIdx = nullptr;
+	nxCore::mem_free(mpDrawIdx);
+	mpDrawIdx = nullptr;
+	nxCore::mem_free(mpEntries);
+	mpEntries = nullptr;
+	nxCore::mem_free(mpBatches);
+	mpBatches = nullptr;
+	mVtxMax = 0;
+	mIdxMax = 0;
+	mPrimsMax = 0;
+	clear();
+	::memset(&mStats, 0, sizeof(mStats));
+}
+
+void Buffer::clear() {
+	mVtxNum = 0;
+	mIdxNum = 0;
+	mPrimsNum = 0;
+	mDroppedNum = 0;
+	mBatchesNum = 0;
+	mDrawIdxNum = 0;
+}
+
+bool Buffer::add(const Material& mtl, const sxPrimVtx* pVtx, const int nvtx, const uint16_t* pIdx, const int nidx, const cxMtx* pMtx) {
+	if (!mpEntries || !pVtx || nvtx <= 0) return false;
+	int nsrcIdx = pIdx ? nidx : nvtx;
+	nsrcIdx -= nsrcIdx % 3;
+	if (nsrcIdx <= 0 || nvtx > mVtxMax) return false;
+	if (pIdx) {
+		for (int i = 0; i < nsrcIdx; ++i) {
+			if (pIdx[i] >= nvtx) return false;
+		}
+	}
+	int seq = nxSys::atomic_inc(&mPrimsNum) - 1;
+	if (seq >= mPrimsMax) {
+		nxSys::atomic_inc(&mDroppedNum);
+		return false;
+	}
+	Entry* pEntry = &mpEntries[seq];
+	pEntry->mMtl = mtl;
+	pEntry->mSeq = seq;
+	pEntry->mVtxNum = 0;
+	pEntry->mIdxNum = 0;
+	int vend = nxSys::atomic_add(&mVtxNum, nvtx);
+	int iend = nxSys::atomic_add(&mIdxNum, nsrcIdx);
+	if (vend > mVtxMax || iend > mIdxMax) {
+		nxSys::atomic_inc(&mDroppedNum);
+		return false;
+	}
+	int vorg = vend - nvtx;
+	int iorg = iend - nsrcIdx;
+	sxPrimVtx* pDstVtx = &mpVtx[vorg];
+	::memcpy(pDstVtx, pVtx, nvtx * sizeof(sxPrimVtx));
+	if (pMtx && mtl.mType == TYPE_POLY) {
+		for (int i = 0; i < nvtx; ++i) {
+			cxVec pos(pDstVtx[i].pos.x, pDstVtx[i].pos.y, pDstVtx[i].pos.z);
+			pos = pMtx->calc_pnt(pos);
+			pDstVtx[i].pos.x = pos.x;
+			pDstVtx[i].pos.y = pos.y;
+			pDstVtx[i].pos.z = pos.z;
+			xt_float2 oct;
+			oct.set(pDstVtx[i].prm.x, pDstVtx[i].prm.y);
+			pDstVtx[i].encode_normal(pMtx->calc_vec(nxVec::decode_octa(oct)).get_normalized());
+		}
+	}
+	uint16_t* pDstIdx = &mpIdx[iorg];
+	if (pIdx) {
+		::memcpy(pDstIdx, pIdx, nsrcIdx * sizeof(uint16_t));
+	} else {
+		for (int i = 0; i < nsrcIdx; ++i) {
+			pDstIdx[i] = uint16_t(i);
+		}
+	}
+	pEntry->mVtxOrg = vorg;
+	pEntry->mIdxOrg = iorg;
+	pEntry->mIdxNum = nsrcIdx;
+	pEntry->mVtxNum = nvtx;
+	return true;
+}
+
+bool Buffer::add_sprite(const Material& mtl, const cxVec& pos, const float size, const float rot, const cxColor& clr, const xt_float4* pTexRect) {
+	static const float s_offs[4][2] = { { -0.5f, 0.5f }, { 0.5f, 0.5f }, { 0.5f, -0.5f }, { -0.5f, -0.5f } };
+	static const uint16_t s_idx[6] = { 0, 1, 2, 0, 2, 3 };
+	xt_float4 texRect;
+	if (pTexRect) {
+		texRect = *pTexRect;
+	} else {
+		texRect.set(0.0f, 0.0f, 1.0f, 1.0f);
+	}
+	sxPrimVtx vtx[4];
+	for (int i = 0; i < 4; ++i) {
+		vtx[i].pos.set(pos.x, pos.y, pos.z, size);
+		vtx[i].clr.set(clr.r, clr.g, clr.b, clr.a);
+		float u = s_offs[i][0] < 0.0f ? texRect.x : texRect.z;
+		float v = s_offs[i][1] > 0.0f ? texRect.y : texRect.w;
+		vtx[i].tex.set(u, v, 0.0f, 0.0f);
+		vtx[i].prm.set(s_offs[i][0], s_offs[i][1], 0.0f, rot);
+	}
+	return add(mtl, vtx, 4, s_idx, 6);
+}
+
+/*static*/ int Buffer::entry_cmp(const void* pA, const void* pB) {
+	const Entry* pEntryA = (const Entry*)pA;
+	const Entry* pEntryB = (const Entry*)pB;
+	const Material& mtlA = pEntryA->mMtl;
+	const Material& mtlB = pEntryB->mMtl;
+	if (mtlA.mScreen != mtlB.mScreen) return mtlA.mScreen ? 1 : -1;
+	if (!mtlA.mScreen) {
+		if (mtlA.mAlphaBlend != mtlB.mAlphaBlend) return mtlA.mAlphaBlend ? 1 : -1;
+		if (mtlA.mType != mtlB.mType) return mtlA.mType < mtlB.mType ? -1 : 1;
+		if (mtlA.mpTex != mtlB.mpTex) return uintptr_t(mtlA.mpTex) < uintptr_t(mtlB.mpTex) ? -1 : 1;
+		if (mtlA.mDblSided != mtlB.mDblSided) return mtlA.mDblSided ? 1 : -1;
+	}
+	return pEntryA->mSeq < pEntryB->mSeq ? -1 : (pEntryA->mSeq > pEntryB->mSeq ? 1 : 0);
+}
+
+int Buffer::build(const int baseVtx) {
+	mBatchesNum = 0;
+	mDrawIdxNum = 0;
+	int nprims = get_prims_num();
+	if (mpEntries && nprims > 0) {
+		::qsort(mpEntries, nprims, sizeof(Entry), entry_cmp);
+		for (int i = 0; i < nprims; ++i) {
+			const Entry& entry = mpEntries[i];
+			if (entry.mVtxNum <= 0 || entry.mIdxNum <= 0) continue;
+			int32_t vtxOrg = baseVtx + entry.mVtxOrg;
+			if (vtxOrg < 0 || vtxOrg + entry.mVtxNum > MAX_IDX_VTX) {
+				++mDroppedNum;
+				continue;
+			}
+			Batch* pBat = mBatchesNum > 0 ? &mpBatches[mBatchesNum - 1] : nullptr;
+			if (!pBat || !pBat->mMtl.same(entry.mMtl)) {
+				pBat = &mpBatches[mBatchesNum++];
+				pBat->mMtl = entry.mMtl;
+				pBat->mIdxOrg = mDrawIdxNum;
+				pBat->mIdxNum = 0;
+				pBat->mPrimsNum = 0;
+			}
+			const uint16_t* pSrc = &mpIdx[entry.mIdxOrg];
+			uint16_t* pDst = &mpDrawIdx[mDrawIdxNum];
+			for (int j = 0; j < entry.mIdxNum; ++j) {
+				pDst[j] = uint16_t(vtxOrg + pSrc[j]);
+			}
+			mDrawIdxNum += entry.mIdxNum;
+			pBat->mIdxNum += entry.mIdxNum;
+			++pBat->mPrimsNum;
+		}
+	}
+	mStats.mVtxNum = get_vtx_num();
+	mStats.mIdxNum = mDrawIdxNum;
+	mStats.mPrimsNum = nprims;
+	mStats.mBatchesNum = mBatchesNum;
+	mStats.mDroppedNum = mDroppedNum;
+	mStats.mPeakVtxNum = nxCalc::max(mStats.mPeakVtxNum, mStats.mVtxNum);
+	mStats.mPeakIdxNum = nxCalc::max(mStats.mPeakIdxNum, mStats.mIdxNum);
+	mStats.mPeakPrimsNum = nxCalc::max(mStats.mPeakPrimsNum, mStats.mPrimsNum);
+	mStats.mPeakDroppedNum = nxCalc::max(mStats.mPeakDroppedNum, mStats.mDroppedNum);
+	return mBatchesNum;
+}
+
+void Buffer::clear_peaks() {
+	mStats.mPeakVtxNum = 0;
+	mStats.mPeakIdxNum = 0;
+	mStats.mPeakPrimsNum = 0;
+	mStats.mPeakDroppedNum = 0;
+}
+
+} // PrimBatch
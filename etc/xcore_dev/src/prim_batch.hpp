@@ -0,0 +1,128 @@
+namespace PrimBatch {
+
+enum Type {
+	TYPE_POLY = 0,  /* same values as Draw::PrimType */
+	TYPE_SPRITE = 1
+};
+
+struct Material {
+	sxTextureData* mpTex;
+	int32_t mType;
+	bool mDblSided;
+	bool mAlphaBlend;
+	bool mScreen; /* clip-space poly, see Draw::Prim::screen */
+
+	void set(sxTextureData* pTex, const Type type = TYPE_POLY, const bool dblSided = false, const bool alphaBlend = true, const bool screen = false) {
+		mpTex = pTex;
+		mType = type;
+		mDblSided = dblSided;
+		mAlphaBlend = alphaBlend;
+		mScreen = screen;
+	}
+
+	bool same(const Material& mtl) const {
+		return mpTex == mtl.mpTex && mType == mtl.mType && mDblSided == mtl.mDblSided && mAlphaBlend == mtl.mAlphaBlend && mScreen == mtl.mScreen;
+	}
+};
+
+/* one draw: mIdxNum indices at mIdxOrg in the merged index data */
+struct Batch {
+	Material mMtl;
+	int32_t mIdxOrg;
+	int32_t mIdxNum;
+	int32_t mPrimsNum;
+};
+
+/* usage of the last build(), peaks are kept until clear_peaks() */
+struct Stats {
+	int32_t mVtxNum;
+	int32_t mIdxNum;
+	int32_t mPrimsNum;
+	int32_t mBatchesNum;
+	int32_t mDroppedNum; /* prims that did not fit */
+	int32_t mPeakVtxNum;
+	int32_t mPeakIdxNum;
+	int32_t mPeakPrimsNum;
+	int32_t mPeakDroppedNum;
+};
+
+/* Transient storage for dynamic primitives.
+   add() can be called from any number of threads: space is reserved with atomic counters and the data copied
+   into the reserved ranges, nothing else is shared. build() runs on one thread once the adds are done:
+   prims are grouped by material, keeping add order within a material, and the indices are rebased into
+   a single merged index array so that every material is drawn with one indexed call.
+   Screen prims come last and keep their add order across materials, as later overlays must cover earlier
+   ones: only runs of the same material are merged.
+   Indices are 16-bit and relative to the base vertex passed to build(), so the vertex capacity is capped
+   to fit in that range. */
+class Buffer {
+protected:
+	struct Entry {
+		Material mMtl;
+		int32_t mSeq;
+		int32_t mVtxOrg;
+		int32_t mVtxNum;
+		int32_t mIdxOrg;
+		int32_t mIdxNum;
+	};
+
+	sxPrimVtx* mpVtx;
+	uint16_t* mpIdx;     /* as added, local to each prim */
+	uint16_t* mpDrawIdx; /* merged, rebased */
+	Entry* mpEntries;
+	Batch* mpBatches;
+	int32_t mVtxNum;     /* reservation counters, may go past the capacity */
+	int32_t mIdxNum;
+	int32_t mPrimsNum;
+	int32_t mDroppedNum;
+	int32_t mVtxMax;
+	int32_t mIdxMax;
+	int32_t mPrimsMax;
+	int32_t mBatchesNum;
+	int32_t mDrawIdxNum;
+	Stats mStats;
+
+	static int entry_cmp(const void* pA, const void* pB);
+
+public:
+	Buffer()
+	: mpVtx(nullptr), mpIdx(nullptr), mpDrawIdx(nullptr), mpEntries(nullptr), mpBatches(nullptr),
+	mVtxNum(0), mIdxNum(0), mPrimsNum(0), mDroppedNum(0), mVtxMax(0), mIdxMax(0), mPrimsMax(0), mBatchesNum(0), mDrawIdxNum(0) {
+		::memset(&mStats, 0, sizeof(mStats));
+	}
+
+	~Buffer() { reset(); }
+
+	bool init(const int maxVtx, const int maxIdx, const int maxPrims);
+	void reset();
+
+	/* drops the accumulated prims, to be called once they are drawn */
+	void clear();
+
+	/* pIdx == nullptr: nvtx / 3 triangles in vertex order; pMtx transforms positions and normals of poly prims */
+	bool add(const Material& mtl, const sxPrimVtx* pVtx, const int nvtx, const uint16_t* pIdx = nullptr, const int nidx = 0, const cxMtx* pMtx = nullptr);
+	/* camera-facing quad: 4 vertices, 2 triangles */
+	bool add_sprite(const Material& mtl, const cxVec& pos, const float size, const float rot, const cxColor& clr, const xt_float4* pTexRect = nullptr);
+
+	/* groups the prims by material, returns the number of batches */
+	int build(const int baseVtx = 0);
+
+	int get_vtx_num() const { return nxCalc::min(mVtxNum, mVtxMax); }
+	int get_prims_num() const { return nxCalc::min(mPrimsNum, mPrimsMax); }
+	int get_dropped_num() const { return mDroppedNum; }
+	int get_vtx_max() const { return mVtxMax; }
+	int get_idx_max() const { return mIdxMax; }
+	int get_prims_max() const { return mPrimsMax; }
+	const sxPrimVtx* get_vtx_data() const { return mpVtx; }
+
+	/* valid after build() */
+	int get_draw_idx_num() const { return mDrawIdxNum; }
+	const uint16_t* get_draw_idx_data() const { return mpDrawIdx; }
+	int get_batches_num() const { return mBatchesNum; }
+	const Batch* get_batch(const int i) const { return (i >= 0 && i < mBatchesNum) ? &mpBatches[i] : nullptr; }
+
+	const Stats& get_stats() const { return mStats; }
+	void clear_peaks();
+};
+
+} // PrimBatch
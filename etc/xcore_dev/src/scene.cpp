@@ -4,6 +4,13 @@
 #include "crosscore.hpp"
 #include "draw.hpp"
 #include "scene.hpp"
+#include "occlusion.hpp"
+#include "obj_bvh.hpp"
+#include "shadow_csm.hpp"
+#include "draw_pkt.hpp"
+#include "draw_cmd.hpp"
+#include "draw_stats.hpp"
+#include "prim_batch.hpp"
 
 static Draw::Ifc* s_pDraw = nullptr;
 
@@ -56,6 +63,54 @@ static float s_smapViewDist = 50.0f;
 static float s_smapMargin = 30.0f;
 static bool s_useShadowCastCull = true;
 
+static Occlusion::Buffer* s_pOcc = nullptr;
+static cxModelWork** s_ppOccWks = nullptr;
+static int s_occWksMax = 0;
+
+static ObjBVH::Tree* s_pObjBVH = nullptr;
+static uint32_t s_bvhStamp = 0;
+
+struct CSMCaster {
+	ScnObj* mpObj;
+	int32_t mBatId;
+};
+
+static ShadowCSM::Cascades* s_pCSM = nullptr;
+static cxAABB* s_pCSMBoxes = nullptr;
+static CSMCaster* s_pCSMCasters = nullptr;
+static int s_csmCastersNum = 0;
+static int s_csmCastersMax = 0;
+static int s_shadowMapSize = 0;
+
+static DrawPkt::List* s_pDrawPkts = nullptr;
+static DrawPkt::Packet* s_pPktsBuf = nullptr;
+static bool s_drawInstFlg = false;
+static xt_xmtx* s_pInstXforms = nullptr;
+static uint8_t* s_pInstDone = nullptr;
+static int s_instMax = 0;
+static int s_instGroupsNum = 0;
+static int s_instDrawsNum = 0;
+static bool s_drawPktsValid = false;
+static cxVec s_pktViewPos(0.0f);
+static cxVec s_pktViewDir(0.0f, 0.0f, -1.0f);
+static DrawCmd::List* s_pDrawCmds = nullptr;
+static Draw::Context s_cmdCtxNoRecv;
+static int s_cmdListsNum = 0;
+static PrimBatch::Buffer* s_pPrimBat = nullptr;
+static uint32_t s_primBatVtxOrg = 0;
+static uint32_t s_primBatIdxOrg = 0;
+static int s_primBatSeg = 0;
+static uint32_t s_primVtxMax = 0;
+static uint32_t s_primIdxMax = 0;
+static sxPrimVtx* s_pPrimStgVtx = nullptr; /* prim_geom() data staged while batching, uploaded as one range */
+static uint16_t* s_pPrimStgIdx = nullptr;
+static uint32_t s_primStgVtxMax = 0;
+static uint32_t s_primStgIdxMax = 0;
+static uint32_t s_primStgVtxOrg = 0;
+static uint32_t s_primStgVtxNum = 0;
+static uint32_t s_primStgIdxOrg = 0;
+static uint32_t s_primStgIdxNum = 0;
+
 static float s_refScrW = -1.0f;
 static float s_refScrH = -1.0f;
 static xt_float3 s_quadGamma;
@@ -173,8 +228,17 @@ static void obj_dtor(ScnObj* pObj) {
 	pObj->mpMdlWk = nullptr;
 	nxCore::mem_free(pObj->mpBatJobs);
 	pObj->mpBatJobs = nullptr;
+	if (s_pObjBVH && pObj->mBVHId >= 0) {
+		s_pObjBVH->remove(pObj->mBVHId);
+	}
+	pObj->mBVHId = -1;
+	s_drawPktsValid = false;
 }
 
+static bool obj_bat_ck_draw(const ScnObj* pObj, const int ibat, const bool isShadowcast);
+static void obj_bat_submit(ScnObj* pObj, const int ibat, const Draw::Mode mode, const xt_xmtx* pXforms, const int ninst);
+static void obj_bat_draw(ScnObj* pObj, const int ibat, const Draw::Mode mode);
+
 namespace Scene {
 
 void create_global_locks() {
@@ -261,6 +325,7 @@ static void init_font(sxGeometryData* pFontGeo) {
 void init(const ScnCfg& cfg) {
 	if (s_scnInitFlg) return;
 
+	s_shadowMapSize = cfg.shadowMapSize;
 	s_refScrW = -1.0f;
 	s_refScrH = -1.0f;
 	set_font_size(32.0f, 32.0f);
@@ -301,6 +366,7 @@ void init(const ScnCfg& cfg) {
 			s_pBgd->set_static_scheduling();
 		}
 	}
+	alloc_wall_adj_ctxs();
 
 	glb_rng_reset();
 
@@ -333,6 +399,8 @@ void init(const ScnCfg& cfg) {
 
 	s_pScrCommonTex = load_tex("etc/scr_common_BASE.xtex");
 
+	DrawStats::get_counters()->init(nxApp::get_int_opt("draw_stats_window", 120));
+
 	if (s_pDraw) {
 		s_pDraw->init(cfg.shadowMapSize, s_pRsrcMgr, &s_font);
 	}
@@ -381,6 +449,18 @@ void reset() {
 		s_pFontGeo = nullptr;
 	}
 
+	disable_occlusion_culling();
+	disable_obj_bvh();
+	disable_shadow_cascades();
+	disable_draw_sort();
+	disable_prim_batch();
+
+	const char* pStatsPath = nxApp::get_opt("draw_stats_csv");
+	if (pStatsPath) {
+		save_draw_stats_csv(pStatsPath);
+	}
+	DrawStats::get_counters()->reset();
+
 	if (s_pBgd) {
 		cxBrigade::destroy(s_pBgd);
 		s_pBgd = nullptr;
@@ -403,6 +483,7 @@ void reset() {
 		s_pGlbMemLock = nullptr;
 	}
 
+	free_wall_adj_ctxs();
 	free_local_heaps();
 	free_global_heap();
 
@@ -651,12 +732,18 @@ void frame_begin(const cxColor& clearColor) {
 }
 
 void frame_end() {
+	prim_batch_flush();
 	if (s_pDraw) {
 		s_pDraw->end();
 	}
+	DrawStats::get_counters()->frame_end();
 	++s_frameCnt;
 }
 
+bool save_draw_stats_csv(const char* pPath) {
+	return DrawStats::get_counters()->save_csv(pPath);
+}
+
 uint64_t get_frame_count() {
 	return s_frameCnt;
 }
@@ -1093,6 +1180,213 @@ bool is_sphere_visible(const cxSphere& sph, const bool exact) {
 	return vis;
 }
 
+void enable_occlusion_culling(const int width, const int height, const int maxTris) {
+	disable_occlusion_culling();
+	void* pMem = nxCore::mem_alloc(sizeof(Occlusion::Buffer), "Scn:occ");
+	if (!pMem) return;
+	s_pOcc = ::new (pMem) Occlusion::Buffer();
+	int njob = s_pBgd ? s_pBgd->get_workers_num() * 2 : 0;
+	s_pOcc->init(width, height, maxTris, njob);
+	if (s_pOcc->get_width() <= 0) {
+		disable_occlusion_culling();
+	}
+}
+
+void disable_occlusion_culling() {
+	if (s_pOcc) {
+		s_pOcc->~Buffer();
+		nxCore::mem_free(s_pOcc);
+		s_pOcc = nullptr;
+	}
+	if (s_ppOccWks) {
+		nxCore::mem_free(s_ppOccWks);
+		s_ppOccWks = nullptr;
+	}
+	s_occWksMax = 0;
+}
+
+bool is_occlusion_culling_enabled() {
+	return s_pOcc != nullptr;
+}
+
+void enable_obj_bvh(const float margin) {
+	disable_obj_bvh();
+	void* pMem = nxCore::mem_alloc(sizeof(ObjBVH::Tree), "Scn:bvh");
+	if (!pMem) return;
+	s_pObjBVH = ::new (pMem) ObjBVH::Tree();
+	s_pObjBVH->init(get_num_objs(), margin, s_pBgd ? s_pBgd->get_workers_num() * 2 : 0);
+}
+
+void disable_obj_bvh() {
+	if (!s_pObjBVH) return;
+	s_pObjBVH->~Tree();
+	nxCore::mem_free(s_pObjBVH);
+	s_pObjBVH = nullptr;
+	if (s_pObjList) {
+		for (ObjList::Itr itr = s_pObjList->get_itr(); !itr.end(); itr.next()) {
+			ScnObj* pObj = itr.item();
+			if (pObj) {
+				pObj->mBVHId = -1;
+			}
+		}
+	}
+}
+
+bool is_obj_bvh_enabled() {
+	return s_pObjBVH != nullptr;
+}
+
+void enable_shadow_cascades(const int num, const float lambda) {
+	disable_shadow_cascades();
+	void* pMem = nxCore::mem_alloc(sizeof(ShadowCSM::Cascades), "Scn:csm");
+	if (!pMem) return;
+	s_pCSM = ::new (pMem) ShadowCSM::Cascades();
+	int njob = s_pBgd ? s_pBgd->get_workers_num() * 2 : 0;
+	s_pCSM->init(num, s_shadowMapSize > 0 ? s_shadowMapSize : 2048, lambda, s_smapMargin, njob);
+	if (s_pCSM->get_num() <= 0) {
+		disable_shadow_cascades();
+	}
+}
+
+void disable_shadow_cascades() {
+	if (s_pCSM) {
+		s_pCSM->~Cascades();
+		nxCore::mem_free(s_pCSM);
+		s_pCSM = nullptr;
+	}
+	nxCore::mem_free(s_pCSMBoxes);
+	s_pCSMBoxes = nullptr;
+	nxCore::mem_free(s_pCSMCasters);
+	s_pCSMCasters = nullptr;
+	s_csmCastersNum = 0;
+	s_csmCastersMax = 0;
+}
+
+int get_shadow_cascades_num() {
+	return s_pCSM ? s_pCSM->get_num() : 0;
+}
+
+cxMtx get_shadow_cascade_view_proj_mtx(const int icsc) {
+	const ShadowCSM::Cascade* pCsc = s_pCSM ? s_pCSM->get_cascade(icsc) : nullptr;
+	return pCsc ? pCsc->mViewProjMtx : nxMtx::identity();
+}
+
+float get_shadow_cascade_split(const int icsc) {
+	const ShadowCSM::Cascade* pCsc = s_pCSM ? s_pCSM->get_cascade(icsc) : nullptr;
+	return pCsc ? pCsc->mSplitFar : 0.0f;
+}
+
+int get_shadow_cascade_casters_num(const int icsc) {
+	return s_pCSM ? s_pCSM->get_casters_num(icsc) : 0;
+}
+
+ScnObj* get_shadow_cascade_caster(const int icsc, const int idx, int* pBatId) {
+	ScnObj* pObj = nullptr;
+	int batId = -1;
+	if (s_pCSM && idx >= 0 && idx < s_pCSM->get_casters_num(icsc)) {
+		const CSMCaster* pCaster = &s_pCSMCasters[s_pCSM->get_casters(icsc)[idx]];
+		pObj = pCaster->mpObj;
+		batId = pCaster->mBatId;
+	}
+	if (pBatId) {
+		*pBatId = batId;
+	}
+	return pObj;
+}
+
+void enable_draw_sort() {
+	if (s_pDrawPkts) return;
+	void* pMem = nxCore::mem_alloc(sizeof(DrawPkt::List), "Scn:pkts");
+	if (!pMem) return;
+	s_pDrawPkts = ::new (pMem) DrawPkt::List();
+	s_pDrawPkts->init(s_pBgd ? s_pBgd->get_workers_num() * 2 : 0);
+	s_drawPktsValid = false;
+}
+
+void disable_draw_sort() {
+	disable_draw_instancing();
+	disable_draw_mt_record();
+	if (!s_pDrawPkts) return;
+	s_pDrawPkts->~List();
+	nxCore::mem_free(s_pDrawPkts);
+	s_pDrawPkts = nullptr;
+	s_drawPktsValid = false;
+}
+
+void enable_draw_instancing() {
+	enable_draw_sort();
+	s_drawInstFlg = true;
+}
+
+void disable_draw_instancing() {
+	s_drawInstFlg = false;
+	nxCore::mem_free(s_pInstXforms);
+	s_pInstXforms = nullptr;
+	nxCore::mem_free(s_pInstDone);
+	s_pInstDone = nullptr;
+	s_instMax = 0;
+}
+
+bool is_draw_instancing_enabled() {
+	return s_drawInstFlg && s_pDrawPkts != nullptr;
+}
+
+int get_draw_inst_groups_num() {
+	return s_instGroupsNum;
+}
+
+int get_draw_inst_batches_num() {
+	return s_instDrawsNum;
+}
+
+void enable_draw_mt_record(const int chunkSize) {
+	if (s_pDrawCmds) return;
+	if (!s_pDraw || !s_pDraw->batch_prep || !s_pDraw->batch_submit || !s_pDraw->get_batch_prep_size) return;
+	enable_draw_sort();
+	void* pMem = nxCore::mem_alloc(sizeof(DrawCmd::List), "Scn:cmds");
+	if (!pMem) return;
+	s_pDrawCmds = ::new (pMem) DrawCmd::List();
+	s_pDrawCmds->init(s_pDraw->get_batch_prep_size(), chunkSize, s_pBgd ? s_pBgd->get_workers_num() : 0);
+	s_cmdListsNum = 0;
+}
+
+void disable_draw_mt_record() {
+	if (!s_pDrawCmds) return;
+	s_pDrawCmds->~List();
+	nxCore::mem_free(s_pDrawCmds);
+	s_pDrawCmds = nullptr;
+	s_cmdListsNum = 0;
+}
+
+bool is_draw_mt_record_enabled() {
+	return s_pDrawCmds != nullptr;
+}
+
+int get_draw_mt_record_lists_num() {
+	return s_cmdListsNum;
+}
+
+bool is_draw_sort_enabled() {
+	return s_pDrawPkts != nullptr;
+}
+
+int get_draw_packets_num() {
+	return (s_pDrawPkts && s_drawPktsValid) ? s_pDrawPkts->get_num() : 0;
+}
+
+uint64_t get_draw_packet_key(const int idx) {
+	const DrawPkt::Packet* pPkt = (s_pDrawPkts && s_drawPktsValid) ? s_pDrawPkts->get_packet(idx) : nullptr;
+	return pPkt ? pPkt->mKey : 0;
+}
+
+ScnObj* get_draw_packet(const int idx, int* pBatId) {
+	const DrawPkt::Packet* pPkt = (s_pDrawPkts && s_drawPktsValid) ? s_pDrawPkts->get_packet(idx) : nullptr;
+	if (pBatId) {
+		*pBatId = pPkt ? pPkt->mParam : -1;
+	}
+	return pPkt ? (ScnObj*)pPkt->mpData : nullptr;
+}
+
 bool is_shadow_uniform() {
 	return s_shadowUniform;
 }
@@ -1450,6 +1744,7 @@ ScnObj* add_obj(sxModelData* pMdl, const char* pName) {
 			pObj = s_pObjList->new_item();
 			if (pObj) {
 				::memset(pObj, 0, sizeof(ScnObj));
+				pObj->mBVHId = -1;
 				char name[32];
 				const char* pObjName = pName;
 				if (!pObjName) {
@@ -1638,23 +1933,12 @@ cxVec get_obj_center_pos(const char* pName) {
 void init_prims(const uint32_t maxVtx, const uint32_t maxIdx) {
 	if (s_pDraw && s_pDraw->init_prims) {
 		s_pDraw->init_prims(maxVtx, maxIdx);
+		s_primVtxMax = maxVtx;
+		s_primIdxMax = maxIdx;
 	}
 }
 
-void prim_verts(const uint32_t org, const uint32_t num, const sxPrimVtx* pSrc) {
-	if (s_pDraw && s_pDraw->prim_geom) {
-		Draw::PrimGeom geom;
-		geom.vtx.org = org;
-		geom.vtx.num = num;
-		geom.vtx.pSrc = pSrc;
-		geom.idx.org = 0;
-		geom.idx.num = 0;
-		geom.idx.pSrc = nullptr;
-		s_pDraw->prim_geom(&geom);
-	}
-}
-
-void prim_geom(const uint32_t vorg, const uint32_t vnum, const sxPrimVtx* pVtxSrc, const uint32_t iorg, const uint32_t inum, const uint16_t* pIdxSrc) {
+static void prim_geom_upload(const uint32_t vorg, const uint32_t vnum, const sxPrimVtx* pVtxSrc, const uint32_t iorg, const uint32_t inum, const uint16_t* pIdxSrc) {
 	if (s_pDraw && s_pDraw->prim_geom) {
 		Draw::PrimGeom geom;
 		geom.vtx.org = vorg;
@@ -1667,8 +1951,61 @@ void prim_geom(const uint32_t vorg, const uint32_t vnum, const sxPrimVtx* pVtxSr
 	}
 }
 
+static void prim_geom_stage_flush() {
+	if (s_primStgVtxNum == 0 && s_primStgIdxNum == 0) return;
+	const sxPrimVtx* pVtxSrc = s_primStgVtxNum > 0 ? s_pPrimStgVtx : nullptr;
+	const uint16_t* pIdxSrc = s_primStgIdxNum > 0 ? s_pPrimStgIdx : nullptr;
+	prim_geom_upload(s_primStgVtxOrg, s_primStgVtxNum, pVtxSrc, s_primStgIdxOrg, s_primStgIdxNum, pIdxSrc);
+	s_primStgVtxNum = 0;
+	s_primStgIdxNum = 0;
+}
+
+/* appends to the staged range when the new data continues it, otherwise uploads the staged data first */
+template<typename T> static void prim_geom_stage(T* pStg, const uint32_t stgMax, uint32_t* pStgOrg, uint32_t* pStgNum, const uint32_t org, const uint32_t num, const T* pSrc) {
+	if (*pStgNum > 0 && (org != *pStgOrg + *pStgNum || *pStgNum + num > stgMax)) {
+		prim_geom_stage_flush();
+	}
+	if (*pStgNum == 0) {
+		*pStgOrg = org;
+	}
+	::memcpy(&pStg[*pStgNum], pSrc, num * sizeof(T));
+	*pStgNum += num;
+}
+
+static bool prim_range_ok(const uint32_t org, const uint32_t num, const uint32_t max) {
+	return !(org >= max || org + num > max);
+}
+
+void prim_verts(const uint32_t org, const uint32_t num, const sxPrimVtx* pSrc) {
+	prim_geom(org, num, pSrc, 0, 0, nullptr);
+}
+
+void prim_geom(const uint32_t vorg, const uint32_t vnum, const sxPrimVtx* pVtxSrc, const uint32_t iorg, const uint32_t inum, const uint16_t* pIdxSrc) {
+	bool vtxFlg = pVtxSrc && vnum > 0;
+	bool idxFlg = pIdxSrc && inum > 0;
+	bool stgFlg = s_pPrimStgVtx && s_pPrimStgIdx;
+	if (stgFlg && vtxFlg) {
+		stgFlg = vnum <= s_primStgVtxMax && prim_range_ok(vorg, vnum, s_primVtxMax);
+	}
+	if (stgFlg && idxFlg) {
+		stgFlg = inum <= s_primStgIdxMax && prim_range_ok(iorg, inum, s_primIdxMax);
+	}
+	if (!stgFlg) {
+		prim_geom_stage_flush();
+		prim_geom_upload(vorg, vnum, pVtxSrc, iorg, inum, pIdxSrc);
+		return;
+	}
+	if (vtxFlg) {
+		prim_geom_stage(s_pPrimStgVtx, s_primStgVtxMax, &s_primStgVtxOrg, &s_primStgVtxNum, vorg, vnum, pVtxSrc);
+	}
+	if (idxFlg) {
+		prim_geom_stage(s_pPrimStgIdx, s_primStgIdxMax, &s_primStgIdxOrg, &s_primStgIdxNum, iorg, inum, pIdxSrc);
+	}
+}
+
 static void prim_draw(Draw::Prim* pPrim) {
 	if (!pPrim) return;
+	prim_geom_stage_flush();
 	if (s_pDraw && s_pDraw->prim) {
 		Draw::Context* pCtx = &s_drwCtx;
 		s_pDraw->prim(pPrim, pCtx);
@@ -1685,6 +2022,7 @@ void tris_semi_dsided(const uint32_t vtxOrg, const uint32_t triNum, cxMtx* pMtx,
 	prim.indexed = false;
 	prim.alphaBlend = true;
 	prim.dblSided = true;
+	prim.screen = false;
 	prim_draw(&prim);
 }
 
@@ -1698,6 +2036,7 @@ void tris_semi(const uint32_t vtxOrg, const uint32_t triNum, cxMtx* pMtx, sxText
 	prim.indexed = false;
 	prim.alphaBlend = true;
 	prim.dblSided = false;
+	prim.screen = false;
 	prim_draw(&prim);
 }
 
@@ -1711,6 +2050,7 @@ void idx_tris_semi_dsided(const uint32_t idxOrg, const uint32_t triNum, cxMtx* p
 	prim.indexed = true;
 	prim.alphaBlend = true;
 	prim.dblSided = true;
+	prim.screen = false;
 	prim_draw(&prim);
 }
 
@@ -1724,9 +2064,130 @@ void sprite_tris(const uint32_t vtxOrg, const uint32_t triNum, sxTextureData* pT
 	prim.indexed = false;
 	prim.alphaBlend = true;
 	prim.dblSided = false;
+	prim.screen = false;
 	prim_draw(&prim);
 }
 
+void enable_prim_batch(const uint32_t vorg, const uint32_t vnum, const uint32_t iorg, const uint32_t inum, const int maxPrims) {
+	if (s_pPrimBat) return;
+	if (!s_pDraw || !s_pDraw->prim_geom || !s_pDraw->prim) return;
+	/* two segments used in turn, so that a flush does not overwrite the data of the previous one */
+	int segVtx = int(vnum / 2);
+	int segIdx = int(inum / 2);
+	if (segVtx < 3 || segIdx < 3 || maxPrims < 1) return;
+	if (vorg + vnum > 0x10000) return;
+	void* pMem = nxCore::mem_alloc(sizeof(PrimBatch::Buffer), "Scn:primbat");
+	if (!pMem) return;
+	s_pPrimBat = ::new (pMem) PrimBatch::Buffer();
+	if (!s_pPrimBat->init(segVtx, segIdx, maxPrims)) {
+		disable_prim_batch();
+		return;
+	}
+	s_primBatVtxOrg = vorg;
+	s_primBatIdxOrg = iorg;
+	s_primBatSeg = 0;
+	if (s_primVtxMax > 0 && s_primIdxMax > 0) {
+		s_pPrimStgVtx = (sxPrimVtx*)nxCore::mem_alloc(segVtx * sizeof(sxPrimVtx), "Scn:primstg:vtx");
+		s_pPrimStgIdx = (uint16_t*)nxCore::mem_alloc(segIdx * sizeof(uint16_t), "Scn:primstg:idx");
+		s_primStgVtxMax = uint32_t(segVtx);
+		s_primStgIdxMax = uint32_t(segIdx);
+		s_primStgVtxNum = 0;
+		s_primStgIdxNum = 0;
+	}
+}
+
+void disable_prim_batch() {
+	if (!s_pPrimBat) return;
+	prim_geom_stage_flush();
+	nxCore::mem_free(s_pPrimStgVtx);
+	s_pPrimStgVtx = nullptr;
+	nxCore::mem_free(s_pPrimStgIdx);
+	s_pPrimStgIdx = nullptr;
+	s_primStgVtxMax = 0;
+	s_primStgIdxMax = 0;
+	s_pPrimBat->~Buffer();
+	nxCore::mem_free(s_pPrimBat);
+	s_pPrimBat = nullptr;
+}
+
+bool is_prim_batch_enabled() {
+	return s_pPrimBat != nullptr;
+}
+
+bool prim_batch_tris(const sxPrimVtx* pVtx, const int nvtx, const uint16_t* pIdx, const int nidx, sxTextureData* pTex, const cxMtx* pMtx, const bool dblSided, const bool alphaBlend) {
+	if (!s_pPrimBat) return false;
+	PrimBatch::Material mtl;
+	mtl.set(pTex, PrimBatch::TYPE_POLY, dblSided, alphaBlend);
+	return s_pPrimBat->add(mtl, pVtx, nvtx, pIdx, nidx, pMtx);
+}
+
+bool prim_batch_sprite(const cxVec& pos, const float size, const float rot, const cxColor& clr, sxTextureData* pTex, const xt_float4* pTexRect) {
+	if (!s_pPrimBat) return false;
+	PrimBatch::Material mtl;
+	mtl.set(pTex, PrimBatch::TYPE_SPRITE, true, true);
+	return s_pPrimBat->add_sprite(mtl, pos, size, rot, clr, pTexRect);
+}
+
+void prim_batch_flush() {
+	if (!s_pPrimBat) return;
+	PrimBatch::Buffer* pBuf = s_pPrimBat;
+	if (pBuf->get_prims_num() > 0) {
+		uint32_t vorg = s_primBatVtxOrg + uint32_t(s_primBatSeg * pBuf->get_vtx_max());
+		uint32_t iorg = s_primBatIdxOrg + uint32_t(s_primBatSeg * pBuf->get_idx_max());
+		int nbat = pBuf->build(int(vorg));
+		if (nbat > 0) {
+			prim_geom_stage_flush();
+			prim_geom_upload(vorg, uint32_t(pBuf->get_vtx_num()), pBuf->get_vtx_data(), iorg, uint32_t(pBuf->get_draw_idx_num()), pBuf->get_draw_idx_data());
+			for (int i = 0; i < nbat; ++i) {
+				const PrimBatch::Batch* pBat = pBuf->get_batch(i);
+				Draw::Prim prim;
+				prim.type = Draw::PrimType(pBat->mMtl.mType);
+				prim.pMtx = nullptr;
+				prim.pTex = pBat->mMtl.mpTex;
+				prim.org = iorg + uint32_t(pBat->mIdxOrg);
+				prim.num = uint32_t(pBat->mIdxNum);
+				prim.indexed = true;
+				prim.alphaBlend = pBat->mMtl.mAlphaBlend;
+				prim.dblSided = pBat->mMtl.mDblSided;
+				prim.screen = pBat->mMtl.mScreen;
+				prim.gamma = s_quadGamma;
+				prim_draw(&prim);
+			}
+			s_primBatSeg ^= 1;
+		}
+	}
+	pBuf->clear();
+	prim_geom_stage_flush();
+}
+
+int get_prim_batch_draws_num() {
+	return s_pPrimBat ? s_pPrimBat->get_stats().mBatchesNum : 0;
+}
+
+int get_prim_batch_prims_num() {
+	return s_pPrimBat ? s_pPrimBat->get_stats().mPrimsNum : 0;
+}
+
+int get_prim_batch_dropped_num() {
+	return s_pPrimBat ? s_pPrimBat->get_stats().mDroppedNum : 0;
+}
+
+int get_prim_batch_peak_vtx_num() {
+	return s_pPrimBat ? s_pPrimBat->get_stats().mPeakVtxNum : 0;
+}
+
+int get_prim_batch_peak_idx_num() {
+	return s_pPrimBat ? s_pPrimBat->get_stats().mPeakIdxNum : 0;
+}
+
+int get_prim_batch_capacity_vtx() {
+	return s_pPrimBat ? s_pPrimBat->get_vtx_max() : 0;
+}
+
+int get_prim_batch_capacity_idx() {
+	return s_pPrimBat ? s_pPrimBat->get_idx_max() : 0;
+}
+
 
 void set_ref_scr_size(const float w, const float h) {
 	s_refScrW = w;
@@ -1747,12 +2208,24 @@ float get_ref_scr_height() {
 	return float(get_screen_height());
 }
 
+static void set_quad_gamma_val(const xt_float3& gamma) {
+	if (s_pPrimBat && s_pPrimBat->get_prims_num() > 0 && ::memcmp(&gamma, &s_quadGamma, sizeof(xt_float3)) != 0) {
+		/* batched quads and symbols are drawn with the gamma they were added with */
+		prim_batch_flush();
+	}
+	s_quadGamma = gamma;
+}
+
 void set_quad_gamma(const float gval) {
-	s_quadGamma.fill(Draw::clip_gamma(gval));
+	xt_float3 gamma;
+	gamma.fill(Draw::clip_gamma(gval));
+	set_quad_gamma_val(gamma);
 }
 
 void set_quad_gamma_rgb(const float r, const float g, const float b) {
-	s_quadGamma.set(Draw::clip_gamma(r), Draw::clip_gamma(g), Draw::clip_gamma(b));
+	xt_float3 gamma;
+	gamma.set(Draw::clip_gamma(r), Draw::clip_gamma(g), Draw::clip_gamma(b));
+	set_quad_gamma_val(gamma);
 }
 
 void set_quad_defaults(Draw::Quad* pQuad) {
@@ -1782,6 +2255,34 @@ void set_quad_defaults(Draw::Quad* pQuad) {
 	}
 }
 
+/* two screen tris placed in clip space as the quad shader does */
+static bool prim_batch_quad(const Draw::Quad* pQuad) {
+	static const uint16_t s_idx[6] = { 0, 1, 3, 3, 1, 2 };
+	if (!s_pPrimBat) return false;
+	if (pQuad->color.a <= 0.0f) return true;
+	float sx = nxCalc::rcp0(pQuad->refWidth);
+	float sy = nxCalc::rcp0(pQuad->refHeight);
+	sxPrimVtx vtx[4];
+	for (int i = 0; i < 4; ++i) {
+		float x = (pQuad->pos[i].x + 0.5f) * sx * 2.0f - 1.0f;
+		float y = (1.0f - (pQuad->pos[i].y + 0.5f) * sy) * 2.0f - 1.0f;
+		vtx[i].pos.set(x*pQuad->rot[0].x + y*pQuad->rot[1].x, x*pQuad->rot[0].y + y*pQuad->rot[1].y, 0.0f, 1.0f);
+		cxColor clr = pQuad->color;
+		if (pQuad->pClrs) {
+			for (int j = 0; j < 4; ++j) {
+				clr.ch[j] *= pQuad->pClrs[i].ch[j];
+			}
+		}
+		vtx[i].clr.set(clr.r, clr.g, clr.b, clr.a);
+		vtx[i].tex.set(pQuad->tex[i].x, pQuad->tex[i].y, 0.0f, 0.0f);
+		vtx[i].prm.fill(0.0f);
+		vtx[i].encode_normal(cxVec(0.0f, 0.0f, 1.0f));
+	}
+	PrimBatch::Material mtl;
+	mtl.set(pQuad->pTex, PrimBatch::TYPE_POLY, false, true, true);
+	return s_pPrimBat->add(mtl, vtx, 4, s_idx, 6);
+}
+
 void quad(const xt_float2 pos[4], const xt_float2 tex[4], const cxColor clr, sxTextureData* pTex, cxColor* pClrs) {
 	if (!s_pDraw) return;
 	if (!s_pDraw->quad) return;
@@ -1794,6 +2295,7 @@ void quad(const xt_float2 pos[4], const xt_float2 tex[4], const cxColor clr, sxT
 	quad.color = clr;
 	quad.pTex = pTex;
 	quad.pClrs = pClrs;
+	if (prim_batch_quad(&quad)) return;
 	s_pDraw->quad(&quad);
 }
 
@@ -1835,6 +2337,55 @@ static void set_sym_rot(Draw::Symbol* pSym) {
 	}
 }
 
+/* Symbol tris placed in clip space as the font shader does. The font color is flat and not gamma corrected,
+   so it is raised to the quad gamma that the screen prims undo. */
+static bool prim_batch_symbol(const Draw::Symbol* pSym) {
+	static const int CHUNK = 96;
+	if (!s_pPrimBat) return false;
+	Draw::Font* pFont = &s_font;
+	if (pSym->clr.a <= 0.0f) return true;
+	if (!pFont->pPnts || !pFont->pTris || uint32_t(pSym->sym) >= uint32_t(pFont->numSyms)) return true;
+	const Draw::Font::SymInfo* pInfo = &pFont->pSyms[pSym->sym];
+	const uint16_t* pIdx = &pFont->pTris[pInfo->idxOrg];
+	int nidx = pInfo->numTris * 3;
+	float ox = pSym->ox*2.0f - 1.0f;
+	float oy = pSym->oy*2.0f - 1.0f;
+	float sx = pSym->sx * 2.0f;
+	float sy = pSym->sy * 2.0f;
+	xt_float4 clr;
+	clr.set(
+		::powf(nxCalc::max(pSym->clr.r, 0.0f), s_quadGamma.x),
+		::powf(nxCalc::max(pSym->clr.g, 0.0f), s_quadGamma.y),
+		::powf(nxCalc::max(pSym->clr.b, 0.0f), s_quadGamma.z),
+		pSym->clr.a);
+	PrimBatch::Material mtl;
+	mtl.set(nullptr, PrimBatch::TYPE_POLY, false, true, true);
+	sxPrimVtx vtx[CHUNK];
+	for (int i = 0; i < nidx; i += CHUNK) {
+		int n = nxCalc::min(CHUNK, nidx - i);
+		for (int j = 0; j < n; ++j) {
+			const xt_float2& pnt = pFont->pPnts[pIdx[i + j]];
+			float x = pnt.x*sx + ox;
+			float y = pnt.y*sy + oy;
+			vtx[j].pos.set(x*pSym->rot[0].x + y*pSym->rot[1].x, x*pSym->rot[0].y + y*pSym->rot[1].y, 0.0f, 1.0f);
+			vtx[j].clr = clr;
+			vtx[j].tex.fill(0.0f);
+			vtx[j].prm.fill(0.0f);
+			vtx[j].encode_normal(cxVec(0.0f, 0.0f, 1.0f));
+		}
+		if (!s_pPrimBat->add(mtl, vtx, n)) {
+			/* the rest of a partly added symbol is dropped rather than drawn twice */
+			return i > 0;
+		}
+	}
+	return true;
+}
+
+static void symbol_draw(const Draw::Symbol* pSym) {
+	if (prim_batch_symbol(pSym)) return;
+	s_pDraw->symbol(pSym);
+}
+
 void symbol(const int sym, const float ox, const float oy, const cxColor clr, const cxColor* pOutClr) {
 	if (!s_pDraw) return;
 	if (!s_pDraw->symbol) return;
@@ -1861,14 +2412,14 @@ void symbol(const int sym, const float ox, const float oy, const cxColor clr, co
 		drwSym.sx = nxCalc::div0((fontW + 2.0f)*scrSX, scrW);
 		drwSym.sy = nxCalc::div0((fontH + 2.0f)*scrSY, scrH);
 		drwSym.clr = *pOutClr;
-		s_pDraw->symbol(&drwSym);
+		symbol_draw(&drwSym);
 	}
 	drwSym.ox = drwOX;
 	drwSym.oy = drwOY;
 	drwSym.sx = drwSX;
 	drwSym.sy = drwSY;
 	drwSym.clr = clr;
-	s_pDraw->symbol(&drwSym);
+	symbol_draw(&drwSym);
 }
 
 void symbol_str(const char* pStr, const float ox, const float oy, const cxColor clr) {
@@ -1907,13 +2458,35 @@ void symbol_str(const char* pStr, const float ox, const float oy, const cxColor
 			Draw::Font::SymInfo* pInfo = &pFont->pSyms[sym];
 			drwSym.sym = sym;
 			drwSym.ox = drwOX;
-			s_pDraw->symbol(&drwSym);
+			symbol_draw(&drwSym);
 			drwOX += (pInfo->size.x + symSpc)*drwSX;
 		}
 	}
 }
 
 
+struct GroundCache {
+	static const int TILE_SHIFT = 3;
+	static const int TILE_SIZE = 1 << TILE_SHIFT;
+
+	sxCollisionData* mpCol;
+	float* mpHeights; /* TILE_SIZE x TILE_SIZE sample tiles */
+	uint32_t* mpCellMask;
+	float mOrgX;
+	float mOrgZ;
+	float mCellSize;
+	float mInvCellSize;
+	int mCellsX;
+	int mCellsZ;
+	int mTilesX;
+	int mCachedNum;
+
+	int calc_sample_idx(const int ix, const int iz) const {
+		int tile = (iz >> TILE_SHIFT) * mTilesX + (ix >> TILE_SHIFT);
+		return (tile << (TILE_SHIFT * 2)) + ((iz & (TILE_SIZE - 1)) << TILE_SHIFT) + (ix & (TILE_SIZE - 1));
+	}
+};
+
 float get_ground_height(sxCollisionData* pCol, const cxVec pos, const float offsTop, const float offsBtm) {
 	float h = pos.y;
 	if (pCol) {
@@ -1929,18 +2502,324 @@ float get_ground_height(sxCollisionData* pCol, const cxVec pos, const float offs
 	return h;
 }
 
+void get_ground_heights(sxCollisionData* pCol, const cxVec* pPos, float* pHeights, const int num, const float offsTop, const float offsBtm, const GroundCache* pCache) {
+	if (!pPos || !pHeights || num <= 0) return;
+	if (pCache && pCache->mpCol == pCol) {
+		for (int i = 0; i < num; ++i) {
+			pHeights[i] = get_ground_height(pCache, pPos[i], offsTop, offsBtm);
+		}
+	} else {
+		for (int i = 0; i < num; ++i) {
+			pHeights[i] = get_ground_height(pCol, pPos[i], offsTop, offsBtm);
+		}
+	}
+}
+
+struct GndColumnWk {
+	float pos;
+	float distMin;
+	float distMax;
+};
+
+static bool gnd_column_hit_func(const sxCollisionData& col, const sxCollisionData::Tri& tri, const cxVec& pos, const float dist, void* pWkMem) {
+	GndColumnWk* pWk = (GndColumnWk*)pWkMem;
+	if (dist < pWk->distMin) {
+		pWk->distMin = dist;
+		pWk->pos = pos.y;
+	}
+	pWk->distMax = nxCalc::max(pWk->distMax, dist);
+	return true;
+}
+
+/* true if the vertical line through (x, z) crosses a single surface;
+   a line through shared edges or vertices reports it once per adjacent triangle */
+static bool gnd_column_hit(sxCollisionData* pCol, const float x, const float z, float* pHeight) {
+	GndColumnWk wk;
+	wk.pos = 0.0f;
+	wk.distMin = FLT_MAX;
+	wk.distMax = -FLT_MAX;
+	float top = pCol->mBBox.get_max_pos().y + 1.0f;
+	float btm = pCol->mBBox.get_min_pos().y - 1.0f;
+	pCol->hit_check(gnd_column_hit_func, cxLineSeg(cxVec(x, top, z), cxVec(x, btm, z)), &wk);
+	bool res = wk.distMin <= wk.distMax && wk.distMax - wk.distMin <= 1e-4f;
+	if (res) {
+		*pHeight = wk.pos;
+	}
+	return res;
+}
+
+GroundCache* ground_cache_create(sxCollisionData* pCol, const float cellSize, const float tolerance) {
+	if (!pCol || cellSize <= 0.0f) return nullptr;
+	cxVec bmin = pCol->mBBox.get_min_pos();
+	cxVec bmax = pCol->mBBox.get_max_pos();
+	int nx = nxCalc::max(int(::ceilf((bmax.x - bmin.x) / cellSize)), 1);
+	int nz = nxCalc::max(int(::ceilf((bmax.z - bmin.z) / cellSize)), 1);
+	int tilesX = ((nx + 1) + GroundCache::TILE_SIZE - 1) >> GroundCache::TILE_SHIFT;
+	int tilesZ = ((nz + 1) + GroundCache::TILE_SIZE - 1) >> GroundCache::TILE_SHIFT;
+	int nsmp = (tilesX * tilesZ) << (GroundCache::TILE_SHIFT * 2);
+	int ncell = nx * nz;
+	size_t smpMaskSize = XD_BIT_ARY_SIZE(uint32_t, nsmp) * sizeof(uint32_t);
+	size_t cellMaskSize = XD_BIT_ARY_SIZE(uint32_t, ncell) * sizeof(uint32_t);
+	GroundCache* pCache = (GroundCache*)nxCore::mem_alloc(sizeof(GroundCache), "Scn:gnd_cache");
+	if (!pCache) return nullptr;
+	pCache->mpCol = pCol;
+	pCache->mpHeights = (float*)nxCore::mem_alloc(nsmp * sizeof(float), "Scn:gnd_cache_heights");
+	pCache->mpCellMask = (uint32_t*)nxCore::mem_alloc(cellMaskSize, "Scn:gnd_cache_cells");
+	uint32_t* pSmpMask = (uint32_t*)nxCore::mem_alloc(smpMaskSize, "Scn:gnd_cache_tmp");
+	if (!pCache->mpHeights || !pCache->mpCellMask || !pSmpMask) {
+		nxCore::mem_free(pSmpMask);
+		ground_cache_destroy(pCache);
+		return nullptr;
+	}
+	pCache->mOrgX = bmin.x;
+	pCache->mOrgZ = bmin.z;
+	pCache->mCellSize = cellSize;
+	pCache->mInvCellSize = 1.0f / cellSize;
+	pCache->mCellsX = nx;
+	pCache->mCellsZ = nz;
+	pCache->mTilesX = tilesX;
+	pCache->mCachedNum = 0;
+	::memset(pSmpMask, 0, smpMaskSize);
+	::memset(pCache->mpCellMask, 0, cellMaskSize);
+	float* pHeights = pCache->mpHeights;
+	for (int iz = 0; iz <= nz; ++iz) {
+		for (int ix = 0; ix <= nx; ++ix) {
+			int idx = pCache->calc_sample_idx(ix, iz);
+			float h = 0.0f;
+			if (gnd_column_hit(pCol, bmin.x + float(ix) * cellSize, bmin.z + float(iz) * cellSize, &h)) {
+				XD_BIT_ARY_ST(uint32_t, pSmpMask, idx);
+			}
+			pHeights[idx] = h;
+		}
+	}
+	static const float chkOffs[5][2] = {
+		{ 0.5f, 0.5f }, { 0.5f, 0.0f }, { 0.0f, 0.5f }, { 1.0f, 0.5f }, { 0.5f, 1.0f }
+	};
+	for (int iz = 0; iz < nz; ++iz) {
+		for (int ix = 0; ix < nx; ++ix) {
+			int i00 = pCache->calc_sample_idx(ix, iz);
+			int i10 = pCache->calc_sample_idx(ix + 1, iz);
+			int i01 = pCache->calc_sample_idx(ix, iz + 1);
+			int i11 = pCache->calc_sample_idx(ix + 1, iz + 1);
+			bool flg = XD_BIT_ARY_CK(uint32_t, pSmpMask, i00) && XD_BIT_ARY_CK(uint32_t, pSmpMask, i10)
+			        && XD_BIT_ARY_CK(uint32_t, pSmpMask, i01) && XD_BIT_ARY_CK(uint32_t, pSmpMask, i11);
+			for (int i = 0; flg && i < 5; ++i) {
+				float tx = chkOffs[i][0];
+				float tz = chkOffs[i][1];
+				float est = nxCalc::lerp(nxCalc::lerp(pHeights[i00], pHeights[i10], tx), nxCalc::lerp(pHeights[i01], pHeights[i11], tx), tz);
+				float h = 0.0f;
+				flg = gnd_column_hit(pCol, bmin.x + (float(ix) + tx) * cellSize, bmin.z + (float(iz) + tz) * cellSize, &h);
+				flg = flg && ::fabsf(est - h) <= tolerance;
+			}
+			if (flg) {
+				XD_BIT_ARY_ST(uint32_t, pCache->mpCellMask, iz * nx + ix);
+				++pCache->mCachedNum;
+			}
+		}
+	}
+	nxCore::mem_free(pSmpMask);
+	return pCache;
+}
+
+void ground_cache_destroy(GroundCache* pCache) {
+	if (pCache) {
+		nxCore::mem_free(pCache->mpHeights);
+		nxCore::mem_free(pCache->mpCellMask);
+		nxCore::mem_free(pCache);
+	}
+}
+
+float ground_cache_coverage(const GroundCache* pCache) {
+	float cov = 0.0f;
+	if (pCache) {
+		int ncell = pCache->mCellsX * pCache->mCellsZ;
+		if (ncell > 0) {
+			cov = float(pCache->mCachedNum) / float(ncell);
+		}
+	}
+	return cov;
+}
+
+float get_ground_height(const GroundCache* pCache, const cxVec pos, const float offsTop, const float offsBtm) {
+	if (!pCache) return pos.y;
+	float fx = (pos.x - pCache->mOrgX) * pCache->mInvCellSize;
+	float fz = (pos.z - pCache->mOrgZ) * pCache->mInvCellSize;
+	if (fx >= 0.0f && fz >= 0.0f && fx < float(pCache->mCellsX) && fz < float(pCache->mCellsZ)) {
+		int ix = int(fx);
+		int iz = int(fz);
+		if (XD_BIT_ARY_CK(uint32_t, pCache->mpCellMask, iz * pCache->mCellsX + ix)) {
+			const float* pHeights = pCache->mpHeights;
+			float tx = fx - float(ix);
+			float tz = fz - float(iz);
+			float h0 = nxCalc::lerp(pHeights[pCache->calc_sample_idx(ix, iz)], pHeights[pCache->calc_sample_idx(ix + 1, iz)], tx);
+			float h1 = nxCalc::lerp(pHeights[pCache->calc_sample_idx(ix, iz + 1)], pHeights[pCache->calc_sample_idx(ix + 1, iz + 1)], tx);
+			float h = nxCalc::lerp(h0, h1, tz);
+			return (h <= pos.y + offsTop && h >= pos.y - offsBtm) ? h : pos.y;
+		}
+	}
+	return get_ground_height(pCache->mpCol, pos, offsTop, offsBtm);
+}
+
 struct WallAdjTriInfo {
 	int32_t ipol;
 	int32_t itri;
 };
 
 struct WallAdjWk {
-	uint32_t* pStamps;
 	WallAdjTriInfo* pTris;
 	int triCount;
 	float slopeLim;
 };
 
+struct WallAdjCtx {
+	uint32_t* mpStamps; /* per candidate: == mStamp -> rejected in the current call */
+	WallAdjTriInfo* mpTris;
+	int mCapacity;
+	uint32_t mStamp;
+	int32_t mBusy; /* shared contexts: 1 while claimed by a thread */
+
+	void init() {
+		mpStamps = nullptr;
+		mpTris = nullptr;
+		mCapacity = 0;
+		mStamp = 0;
+		mBusy = 0;
+	}
+
+	/* counts attempts, so only the one that finds it idle owns it */
+	bool try_claim() {
+		if (nxSys::atomic_inc(&mBusy) == 1) return true;
+		nxSys::atomic_dec(&mBusy);
+		return false;
+	}
+
+	void release() { nxSys::atomic_dec(&mBusy); }
+
+	/* frees the buffers, a claim stays in place */
+	void reset() {
+		nxCore::mem_free(mpStamps);
+		mpStamps = nullptr;
+		nxCore::mem_free(mpTris);
+		mpTris = nullptr;
+		mCapacity = 0;
+		mStamp = 0;
+	}
+
+	bool reserve(const int ntri) {
+		if (ntri <= mCapacity) return true;
+		reset();
+		mpStamps = (uint32_t*)nxCore::mem_alloc(ntri * sizeof(uint32_t), "Scn:wall_adj_stamps");
+		mpTris = (WallAdjTriInfo*)nxCore::mem_alloc(ntri * sizeof(WallAdjTriInfo), "Scn:wall_adj_tris");
+		if (!mpStamps || !mpTris) {
+			reset();
+			return false;
+		}
+		::memset(mpStamps, 0, ntri * sizeof(uint32_t));
+		mCapacity = ntri;
+		return true;
+	}
+
+	void next_stamp() {
+		++mStamp;
+		if (mStamp == 0) {
+			::memset(mpStamps, 0, mCapacity * sizeof(uint32_t));
+			mStamp = 1;
+		}
+	}
+
+	void mark(const int i) { mpStamps[i] = mStamp; }
+	bool ck(const int i) const { return mpStamps[i] == mStamp; }
+};
+
+static WallAdjCtx* s_pWallAdjCtxs = nullptr;
+static int s_numWallAdjCtxs = 0;
+static int s_numWallAdjWrkCtxs = 0;
+
+void free_wall_adj_ctxs() {
+	if (s_pWallAdjCtxs) {
+		for (int i = 0; i < s_numWallAdjCtxs; ++i) {
+			s_pWallAdjCtxs[i].reset();
+		}
+		nxCore::mem_free(s_pWallAdjCtxs);
+		s_pWallAdjCtxs = nullptr;
+	}
+	s_numWallAdjCtxs = 0;
+	s_numWallAdjWrkCtxs = 0;
+}
+
+void alloc_wall_adj_ctxs() {
+	free_wall_adj_ctxs();
+	/* one per worker of the scene brigade + shared ones for everything else: jobs without a worker id
+	   (queue_exec() without a brigade, serial or on the OMP team), other brigades and other threads */
+	int nwrk = s_pBgd ? s_pBgd->get_workers_num() : 0;
+#ifdef XD_USE_OMP
+	int nfree = nxCalc::max(::omp_get_max_threads(), 4);
+#else
+	int nfree = 4;
+#endif
+	int n = nwrk + nfree;
+	s_pWallAdjCtxs = (WallAdjCtx*)nxCore::mem_alloc(n * sizeof(WallAdjCtx), "Scn:wall_adj_ctxs");
+	if (s_pWallAdjCtxs) {
+		for (int i = 0; i < n; ++i) {
+			s_pWallAdjCtxs[i].init();
+		}
+		s_numWallAdjCtxs = n;
+		s_numWallAdjWrkCtxs = nwrk;
+	}
+}
+
+WallAdjCtx* get_job_wall_adj_ctx(const sxJobContext* pJobCtx) {
+	WallAdjCtx* pCtx = nullptr;
+	if (s_pWallAdjCtxs) {
+		int nwrk = s_numWallAdjWrkCtxs;
+		if (pJobCtx && pJobCtx->mpBrigade == s_pBgd && unsigned(pJobCtx->mWrkId) < unsigned(nwrk)) {
+			/* a worker runs one job at a time */
+			pCtx = &s_pWallAdjCtxs[pJobCtx->mWrkId];
+		} else {
+			/* nothing tells this thread apart from others, it must claim a shared context */
+			int nfree = s_numWallAdjCtxs - nwrk;
+#ifdef XD_USE_OMP
+			int org = ::omp_get_thread_num();
+#else
+			int org = 0;
+#endif
+			for (int i = 0; i < nfree; ++i) {
+				WallAdjCtx* pFree = &s_pWallAdjCtxs[nwrk + (org + i) % nfree];
+				if (pFree->try_claim()) {
+					pCtx = pFree;
+					break;
+				}
+			}
+		}
+	}
+	return pCtx;
+}
+
+void release_job_wall_adj_ctx(WallAdjCtx* pCtx) {
+	if (pCtx && s_pWallAdjCtxs && pCtx >= &s_pWallAdjCtxs[s_numWallAdjWrkCtxs] && pCtx < &s_pWallAdjCtxs[s_numWallAdjCtxs]) {
+		pCtx->release();
+	}
+}
+
+WallAdjCtx* wall_adj_ctx_create() {
+	WallAdjCtx* pCtx = (WallAdjCtx*)nxCore::mem_alloc(sizeof(WallAdjCtx), "Scn:wall_adj_ctx");
+	if (pCtx) {
+		pCtx->init();
+	}
+	return pCtx;
+}
+
+void wall_adj_ctx_destroy(WallAdjCtx* pCtx) {
+	if (pCtx) {
+		pCtx->reset();
+		nxCore::mem_free(pCtx);
+	}
+}
+
+int wall_adj_ctx_capacity(const WallAdjCtx* pCtx) {
+	return pCtx ? pCtx->mCapacity : 0;
+}
+
 static bool wall_adj_tri_func(const sxCollisionData& col, const sxCollisionData::Tri& tri, void* pWkMem) {
 	if (!pWkMem) return false;
 	WallAdjWk* pWk = (WallAdjWk*)pWkMem;
@@ -1967,44 +2846,13 @@ static bool wall_adj_pnt_in_tri(const cxVec& pnt, const cxVec vtx[3], const cxVe
 	return true;
 }
 
-#define SCN_GLB_MEM_CMN_LOCK 0
-
-bool wall_adj_base(const sxJobContext* pJobCtx, sxCollisionData* pCol, const cxVec& newPos, const cxVec& oldPos, const float radius, cxVec* pAdjPos, const float wallSlopeLim) {
-	if (!pCol) return false;
+bool wall_adj_base(WallAdjCtx* pWallCtx, sxCollisionData* pCol, const cxVec& newPos, const cxVec& oldPos, const float radius, cxVec* pAdjPos, const float wallSlopeLim) {
+	if (!pWallCtx || !pCol) return false;
 	bool res = false;
-	int ntri = pCol->mTriNum;
-	size_t numStampBytes = XD_BIT_ARY_SIZE(uint32_t, ntri) * sizeof(uint32_t);
-	size_t numTriBytes = ntri * sizeof(WallAdjTriInfo);
-	uint32_t* pStamps = nullptr;
-	WallAdjTriInfo* pTris = nullptr;
-	const uint32_t stampsTag = XD_FOURCC('W', 'F', 'l', 'g');
-	const uint32_t trisTag = XD_FOURCC('W', 'T', 'r', 'i');
-	cxHeap* pHeap = get_job_local_heap(pJobCtx);
-	if (pHeap) {
-#ifdef XD_USE_OMP
-		glb_mem_lock_acq();
-#endif
-		pStamps = (uint32_t*)pHeap->alloc(numStampBytes, stampsTag);
-		pTris = (WallAdjTriInfo*)pHeap->alloc(numTriBytes, trisTag);
-#ifdef XD_USE_OMP
-		glb_mem_lock_rel();
-#endif
-	} else {
-#if SCN_GLB_MEM_CMN_LOCK
-		glb_mem_lock_acq();
-		pStamps = (uint32_t*)glb_mem_alloc_impl(numStampBytes, stampsTag);
-		pTris = (WallAdjTriInfo*)glb_mem_alloc_impl(numTriBytes, trisTag);
-		glb_mem_lock_rel();
-#else
-		pStamps = (uint32_t*)glb_mem_alloc(numStampBytes, stampsTag);
-		pTris = (WallAdjTriInfo*)glb_mem_alloc(numTriBytes, trisTag);
-#endif
-	}
-	if (pStamps && pTris) {
+	if (pWallCtx->reserve(pCol->mTriNum)) {
 		WallAdjWk wk;
-		::memset(pStamps, 0, numStampBytes);
-		wk.pStamps = pStamps;
-		wk.pTris = pTris;
+		pWallCtx->next_stamp();
+		wk.pTris = pWallCtx->mpTris;
 		wk.triCount = 0;
 		wk.slopeLim = wallSlopeLim;
 		int adjCount = 0;
@@ -2040,13 +2888,13 @@ bool wall_adj_base(const sxJobContext* pJobCtx, sxCollisionData* pCol, const cxV
 						triBBox.add_pnt(triVtx[2]);
 						bool calcFlg = true;
 						if (itrCnt > 0) {
-							calcFlg = !XD_BIT_ARY_CK(uint32_t, wk.pStamps, i);
+							calcFlg = !pWallCtx->ck(i);
 						} else {
 							float ymin = triBBox.get_min_pos().y;
 							float ymax = triBBox.get_max_pos().y;
 							float ny = newPos.y;
 							if (!(ny >= ymin && ny <= ymax)) {
-								XD_BIT_ARY_ST(uint32_t, wk.pStamps, i);
+								pWallCtx->mark(i);
 								calcFlg = false;
 							}
 						}
@@ -2058,7 +2906,7 @@ bool wall_adj_base(const sxJobContext* pJobCtx, sxCollisionData* pCol, const cxV
 							float adist = ::fabsf(sdist);
 							if (sdist > 0.0f && adist > radius) {
 								if (adist > maxRange) {
-									XD_BIT_ARY_ST(uint32_t, wk.pStamps, i);
+									pWallCtx->mark(i);
 									calcFlg = false;
 								}
 							}
@@ -2066,7 +2914,7 @@ bool wall_adj_base(const sxJobContext* pJobCtx, sxCollisionData* pCol, const cxV
 								cxVec isect;
 								if (adist > radius) {
 									if (adist > maxRange) {
-										XD_BIT_ARY_ST(uint32_t, wk.pStamps, i);
+										pWallCtx->mark(i);
 									}
 									if (!triPlane.seg_intersect(npos, opos, nullptr, &isect)) {
 										calcFlg = false;
@@ -2181,25 +3029,20 @@ bool wall_adj_base(const sxJobContext* pJobCtx, sxCollisionData* pCol, const cxV
 			}
 		}
 	}
-	if (pHeap) {
-#ifdef XD_USE_OMP
-		glb_mem_lock_acq();
-#endif
-		pHeap->free(pTris);
-		pHeap->free(pStamps);
-#ifdef XD_USE_OMP
-		glb_mem_lock_rel();
-#endif
+	return res;
+}
+
+bool wall_adj_base(const sxJobContext* pJobCtx, sxCollisionData* pCol, const cxVec& newPos, const cxVec& oldPos, const float radius, cxVec* pAdjPos, const float wallSlopeLim) {
+	bool res = false;
+	WallAdjCtx* pWallCtx = get_job_wall_adj_ctx(pJobCtx);
+	if (pWallCtx) {
+		res = wall_adj_base(pWallCtx, pCol, newPos, oldPos, radius, pAdjPos, wallSlopeLim);
+		release_job_wall_adj_ctx(pWallCtx);
 	} else {
-#if SCN_GLB_MEM_CMN_LOCK
-		glb_mem_lock_acq();
-		glb_mem_free_impl(pTris);
-		glb_mem_free_impl(pStamps);
-		glb_mem_lock_rel();
-#else
-		glb_mem_free(pTris);
-		glb_mem_free(pStamps);
-#endif
+		WallAdjCtx tmpCtx;
+		tmpCtx.init();
+		res = wall_adj_base(&tmpCtx, pCol, newPos, oldPos, radius, pAdjPos, wallSlopeLim);
+		tmpCtx.reset();
 	}
 	return res;
 }
@@ -2422,6 +3265,313 @@ void exec() {
 	}
 }
 
+/* after frustum culling: occluders go to the depth buffer, then every visible work is tested against it (camera cull bits only) */
+static void occlusion_cull(const int nobj) {
+	if (!s_pOcc || nobj < 1) return;
+	if (nobj > s_occWksMax) {
+		if (s_ppOccWks) {
+			nxCore::mem_free(s_ppOccWks);
+		}
+		s_ppOccWks = (cxModelWork**)nxCore::mem_alloc(nobj * sizeof(cxModelWork*), "Scn:occ_wks");
+		s_occWksMax = s_ppOccWks ? nobj : 0;
+		if (!s_ppOccWks) return;
+	}
+	s_pOcc->begin(get_view_proj_mtx());
+	int nwk = 0;
+	for (ObjList::Itr itr = s_pObjList->get_itr(); !itr.end(); itr.next()) {
+		ScnObj* pObj = itr.item();
+		if (pObj && pObj->mpMdlWk && !pObj->mDisableDraw) {
+			if (pObj->mOccluder) {
+				s_pOcc->add_model_work(pObj->mpMdlWk, pObj->mOccluderLOD);
+			}
+			s_ppOccWks[nwk++] = pObj->mpMdlWk;
+		}
+	}
+	if (s_pOcc->get_tris_num() <= 0) return;
+	s_pOcc->rasterize(s_pBgd);
+	s_pOcc->cull_works(s_ppOccWks, nwk, s_pBgd);
+}
+
+/* world box with the batch boxes merged in, skinned batches are not bound by the world box */
+static bool obj_bvh_box(const ScnObj* pObj, cxAABB* pBox) {
+	cxModelWork* pWk = pObj->mpMdlWk;
+	if (!pWk || !pWk->mBoundsValid || !pWk->mpBatBBoxes) return false;
+	cxAABB box = pWk->mWorldBBox;
+	int nbat = pWk->get_batches_num();
+	for (int i = 0; i < nbat; ++i) {
+		box.merge(pWk->mpBatBBoxes[i]);
+	}
+	*pBox = box;
+	return true;
+}
+
+struct ObjBVHMark {
+	void operator()(int id, void* pData) {
+		ScnObj* pObj = (ScnObj*)pData;
+		if (pObj) {
+			pObj->mBVHStamp = s_bvhStamp;
+		}
+	}
+};
+
+/* ObjBVH::Tree::ItemBoxFunc, runs on the brigade: an object that lost its bounds leaves the tree */
+static bool obj_bvh_item_box(void* pData, cxAABB* pBox) {
+	ScnObj* pObj = (ScnObj*)pData;
+	if (obj_bvh_box(pObj, pBox)) return true;
+	pObj->mBVHId = -1;
+	return false;
+}
+
+/* objects join the tree once they have bounds, the tree culls them from the next frame on */
+static void obj_bvh_add(ScnObj* pObj) {
+	cxAABB box;
+	if (obj_bvh_box(pObj, &box)) {
+		pObj->mBVHId = s_pObjBVH->add(box, pObj);
+	}
+}
+
+/* refits the tree to the objects' new bounds and stamps the ones that may be seen or may cast into the view */
+static void obj_bvh_mark() {
+	if (!s_pObjBVH) return;
+	s_pObjBVH->refit_items(obj_bvh_item_box, s_pBgd);
+	++s_bvhStamp;
+	ObjBVHMark mark;
+	const cxFrustum* pFst = get_view_frustum_ptr();
+	s_pObjBVH->query_frustum(*pFst, mark);
+	if (s_useShadowCastCull) {
+		if (s_shadowUniform) {
+			/* orthographic: the planes are exact, ck_bat_shadow_cast_vis() accepts |x|, |y| <= 2 */
+			cxPlane pln[ObjBVH::Tree::MAX_CASTER_PLANES];
+			int npln = ObjBVH::Tree::calc_clip_planes(get_shadow_view_proj_mtx(), pln, 2.0f, false);
+			s_pObjBVH->query_planes(pln, npln, mark);
+		} else {
+			s_pObjBVH->query_casters(*pFst, get_shadow_dir(), mark);
+		}
+	}
+}
+
+/* same bits update_visibility() leaves for an object outside the view that casts nothing into it */
+static void obj_hide(ScnObj* pObj) {
+	cxModelWork* pWk = pObj->mpMdlWk;
+	int nbat = pWk->get_batches_num();
+	size_t bitMemSize = XD_BIT_ARY_SIZE(uint8_t, nbat);
+	if (pWk->mpCullBits) {
+		::memset(pWk->mpCullBits, 0, bitMemSize);
+		for (int i = 0; i < nbat; ++i) {
+			XD_BIT_ARY_ST(uint32_t, pWk->mpCullBits, i);
+		}
+	}
+	if (pWk->mpExtMem) {
+		uint32_t* pCastBits = (uint32_t*)pWk->mpExtMem;
+		if (pObj->mDisableShadowCast) {
+			::memset(pCastBits, 0xFF, bitMemSize);
+		} else {
+			::memset(pCastBits, 0, bitMemSize);
+			if (s_useShadowCastCull) {
+				for (int i = 0; i < nbat; ++i) {
+					XD_BIT_ARY_ST(uint32_t, pCastBits, i);
+				}
+			}
+		}
+	}
+}
+
+/* every batch that draws into the shadow map is tested against all cascades */
+static void shadow_cascades_cull() {
+	if (!s_pCSM) return;
+	int ncast = 0;
+	for (ObjList::Itr itr = s_pObjList->get_itr(); !itr.end(); itr.next()) {
+		ScnObj* pObj = itr.item();
+		if (pObj && pObj->mpMdlWk && pObj->mpMdlWk->mBoundsValid && !pObj->mDisableShadowCast) {
+			ncast += pObj->mpMdlWk->get_batches_num();
+		}
+	}
+	if (ncast > s_csmCastersMax) {
+		nxCore::mem_free(s_pCSMBoxes);
+		nxCore::mem_free(s_pCSMCasters);
+		s_pCSMBoxes = (cxAABB*)nxCore::mem_alloc(ncast * sizeof(cxAABB), "Scn:csm_boxes");
+		s_pCSMCasters = (CSMCaster*)nxCore::mem_alloc(ncast * sizeof(CSMCaster), "Scn:csm_casters");
+		s_csmCastersMax = ncast;
+		if (!s_pCSMBoxes || !s_pCSMCasters) {
+			nxCore::mem_free(s_pCSMBoxes);
+			s_pCSMBoxes = nullptr;
+			nxCore::mem_free(s_pCSMCasters);
+			s_pCSMCasters = nullptr;
+			s_csmCastersMax = 0;
+			ncast = 0;
+		}
+	}
+	int n = 0;
+	for (ObjList::Itr itr = s_pObjList->get_itr(); !itr.end() && n < ncast; itr.next()) {
+		ScnObj* pObj = itr.item();
+		if (pObj && pObj->mpMdlWk && pObj->mpMdlWk->mBoundsValid && !pObj->mDisableShadowCast) {
+			cxModelWork* pWk = pObj->mpMdlWk;
+			int nbat = pWk->get_batches_num();
+			for (int i = 0; i < nbat; ++i) {
+				if (pWk->is_bat_mtl_hidden(i)) continue;
+				s_pCSMBoxes[n] = pWk->mpBatBBoxes[i];
+				s_pCSMCasters[n].mpObj = pObj;
+				s_pCSMCasters[n].mBatId = i;
+				++n;
+			}
+		}
+	}
+	s_csmCastersNum = n;
+	cxMtx proj = get_proj_mtx();
+	float zfar = nxCalc::min(get_view_far(), s_smapViewDist);
+	s_pCSM->set_caster_margin(s_smapMargin);
+	s_pCSM->update(get_inv_view_mtx(), nxCalc::rcp0(proj.m[0][0]), nxCalc::rcp0(proj.m[1][1]), get_view_near(), zfar, get_shadow_dir());
+	s_pCSM->cull(s_pCSMBoxes, n, s_pBgd);
+}
+
+static uint32_t pkt_hash_bits(const uint32_t h, const int nbits) {
+	uint32_t x = h;
+	x ^= x >> nbits;
+	x ^= x >> (nbits * 2);
+	return x & ((1U << nbits) - 1);
+}
+
+/* shader variation as selected by the draw interfaces, approximated from the model and material features */
+static uint32_t pkt_shader_id(const ScnObj* pObj, const sxModelData* pMdl, const sxModelData::Material* pMtl, const bool cast) {
+	uint32_t sdr = 0;
+	if (pMdl->half_encoding()) sdr |= 1;
+	if (pMdl->has_skin()) sdr |= 2;
+	if (pMtl->mFlags.alpha) sdr |= 4;
+	if (!cast) {
+		if (s_useBump && pMtl->mBumpScale > 0.0f && pMtl->mBumpTexId >= 0) sdr |= 8;
+		if (s_useSpec && pMtl->mFlags.baseMapSpecAlpha) sdr |= 0x10;
+		if (pMtl->mFlags.shadowRecv && !pObj->mDisableShadowRecv) sdr |= 0x20;
+		if (pMtl->mFlags.dblSided) sdr |= 0x40;
+	}
+	return sdr;
+}
+
+/* packets of one object go to [mPktOrg, mPktOrg + 2 * batches), at most one shadow and one draw packet per batch */
+static void obj_draw_packets(ScnObj* pObj, DrawPkt::Packet* pPkts) {
+	pObj->mPktNum = 0;
+	cxModelWork* pWk = pObj->mpMdlWk;
+	if (!pWk || !pPkts) return;
+	sxModelData* pMdl = pWk->mpData;
+	if (!pMdl) return;
+	DrawPkt::Packet* pPkt = &pPkts[pObj->mPktOrg];
+	uint32_t* pCastBits = (uint32_t*)pWk->mpExtMem;
+	bool opaqFunc = pObj->mPreOpaqFunc || pObj->mPostOpaqFunc;
+	uint32_t mdlHash = nxCore::str_hash32(pMdl->get_name());
+	int nbat = pWk->get_batches_num();
+	int n = 0;
+	for (int i = 0; i < nbat; ++i) {
+		if (pWk->is_bat_mtl_hidden(i)) continue;
+		const sxModelData::Material* pMtl = pMdl->get_batch_material(i);
+		if (!pMtl) continue;
+		uint32_t mtl = pkt_hash_bits(mdlHash ^ (nxCore::str_hash32(pMdl->get_str(pMtl->mNameId)) * 0x9E3779B1U), 12);
+		uint32_t tex = pMtl->mBaseTexId >= 0 ? pkt_hash_bits(nxCore::str_hash32(pMdl->get_tex_name(pMtl->mBaseTexId)), 16) : 0;
+		bool cast = !pObj->mDisableShadowCast && pMtl->mFlags.shadowCast;
+		if (cast && pCastBits) {
+			cast = !XD_BIT_ARY_CK(uint32_t, pCastBits, i);
+		}
+		if (cast) {
+			pPkt[n].mKey = DrawPkt::make_key(DrawPkt::PASS_SHADOW, pkt_shader_id(pObj, pMdl, pMtl, true), mtl, tex, 0.0f);
+			pPkt[n].mpData = pObj;
+			pPkt[n].mParam = i;
+			pPkt[n].mReserved = 0;
+			++n;
+		}
+		if (pObj->mDisableDraw || XD_BIT_ARY_CK(uint32_t, pWk->mpCullBits, i)) continue;
+		bool alpha = pMtl->is_alpha();
+		if (!alpha && opaqFunc) continue;
+		int pass = DrawPkt::PASS_OPAQ;
+		float depth = 0.0f;
+		if (pWk->mBoundsValid && pWk->mpBatBBoxes) {
+			const cxAABB& box = pWk->mpBatBBoxes[i];
+			cxVec c = box.get_center();
+			cxVec r = box.get_max_pos() - c;
+			float dc = (c - s_pktViewPos).dot(s_pktViewDir);
+			float de = r.dot(s_pktViewDir.abs_val());
+			if (alpha) {
+				switch (pMtl->get_sort_mode()) {
+					case sxModelData::Material::SORT_NEAR: depth = dc - de; break;
+					case sxModelData::Material::SORT_CENTER: depth = dc; break;
+					case sxModelData::Material::SORT_FAR: depth = dc + de; break;
+				}
+				depth += pMtl->get_sort_bias();
+			} else {
+				depth = dc - de;
+			}
+		}
+		if (alpha) {
+			pass = pMtl->mFlags.forceBlend ? DrawPkt::PASS_BLEND : DrawPkt::PASS_SEMI;
+		}
+		pPkt[n].mKey = DrawPkt::make_key(pass, pkt_shader_id(pObj, pMdl, pMtl, false), mtl, tex, depth);
+		pPkt[n].mpData = pObj;
+		pPkt[n].mParam = i;
+		pPkt[n].mReserved = 0;
+		++n;
+	}
+	pObj->mPktNum = n;
+}
+
+static void obj_packets_job(const sxJobContext* pCtx) {
+	if (!pCtx) return;
+	sxJob* pJob = pCtx->mpJob;
+	if (!pJob) return;
+	ScnObj* pObj = (ScnObj*)pJob->mpData;
+	if (!pObj) return;
+	pObj->mpJobCtx = pCtx;
+	obj_draw_packets(pObj, s_pPktsBuf);
+}
+
+/* after culling: every object writes its packets in parallel, then they are packed in object order and sorted */
+static void draw_packets_build() {
+	s_drawPktsValid = false;
+	if (!s_pDrawPkts) return;
+	int npkt = 0;
+	for (ObjList::Itr itr = s_pObjList->get_itr(); !itr.end(); itr.next()) {
+		ScnObj* pObj = itr.item();
+		if (pObj) {
+			pObj->mPktOrg = npkt;
+			pObj->mPktNum = 0;
+			npkt += pObj->get_batches_num() * 2;
+		}
+	}
+	DrawPkt::Packet* pPkts = s_pDrawPkts->alloc(npkt);
+	if (!pPkts) return;
+	s_pktViewPos = get_view_pos();
+	s_pktViewDir = get_view_dir();
+	s_pPktsBuf = pPkts;
+	if (s_pJobQue) {
+		nxTask::queue_purge(s_pJobQue);
+		for (ObjList::Itr itr = s_pObjList->get_itr(); !itr.end(); itr.next()) {
+			ScnObj* pObj = itr.item();
+			if (pObj && pObj->mpMdlWk) {
+				pObj->mJob.mFunc = obj_packets_job;
+				nxTask::queue_add(s_pJobQue, &pObj->mJob);
+			}
+		}
+		nxTask::queue_exec(s_pJobQue, s_pBgd);
+	} else {
+		for (ObjList::Itr itr = s_pObjList->get_itr(); !itr.end(); itr.next()) {
+			ScnObj* pObj = itr.item();
+			if (pObj) {
+				obj_draw_packets(pObj, pPkts);
+			}
+		}
+	}
+	s_pPktsBuf = nullptr;
+	int n = 0;
+	for (ObjList::Itr itr = s_pObjList->get_itr(); !itr.end(); itr.next()) {
+		ScnObj* pObj = itr.item();
+		if (pObj && pObj->mPktNum > 0) {
+			if (pObj->mPktOrg != n) {
+				::memmove(&pPkts[n], &pPkts[pObj->mPktOrg], pObj->mPktNum * sizeof(DrawPkt::Packet));
+			}
+			n += pObj->mPktNum;
+		}
+	}
+	s_pDrawPkts->set_num(n);
+	s_pDrawPkts->sort(s_pBgd);
+	s_drawPktsValid = true;
+}
+
 void visibility() {
 	if (!s_pObjList) return;
 	int nobj = get_num_objs();
@@ -2429,12 +3579,21 @@ void visibility() {
 	int njob = nobj;
 	update_view();
 	update_shadow();
+	obj_bvh_mark();
 	job_queue_alloc(njob);
 	if (s_pJobQue) {
 		nxTask::queue_purge(s_pJobQue);
 		for (ObjList::Itr itr = s_pObjList->get_itr(); !itr.end(); itr.next()) {
 			ScnObj* pObj = itr.item();
 			if (pObj) {
+				if (s_pObjBVH) {
+					if (pObj->mBVHId < 0) {
+						obj_bvh_add(pObj);
+					} else if (pObj->mBVHStamp != s_bvhStamp) {
+						obj_hide(pObj);
+						continue;
+					}
+				}
 				pObj->mJob.mFunc = obj_visibility_job;
 				nxTask::queue_add(s_pJobQue, &pObj->mJob);
 			}
@@ -2442,11 +3601,222 @@ void visibility() {
 		nxTask::queue_exec(s_pJobQue, s_pBgd);
 		save_job_cnts(get_visibility_job_lvl());
 	}
+	shadow_cascades_cull();
+	occlusion_cull(nobj);
+	draw_packets_build();
+}
+
+/* batches with draw callbacks are not recorded: the callbacks may change the work right before the draw */
+static bool cmd_record(void* pRec, const DrawCmd::Cmd& cmd, void* pUsr) {
+	const ScnObj* pObj = (const ScnObj*)cmd.mpObj;
+	if (cmd.mMode != Draw::DRWMODE_SHADOW_CAST && (pObj->mBatchPreDrawFunc || pObj->mBatchPostDrawFunc)) return false;
+	return s_pDraw->batch_prep(pRec, (const cxModelWork*)cmd.mpWk, cmd.mBatId, (Draw::Mode)cmd.mMode, (const Draw::Context*)cmd.mpCtx);
+}
+
+/* pUsr: stats pass of the non-shadow commands */
+static void cmd_replay(const void* pRec, const DrawCmd::Cmd& cmd, const xt_xmtx* pXforms, void* pUsr) {
+	DrawStats::set_pass(cmd.mMode == Draw::DRWMODE_SHADOW_CAST ? DrawStats::PASS_SHADOW : *(const int*)pUsr);
+	if (pRec) {
+		s_pDraw->batch_submit(pRec, (cxModelWork*)cmd.mpWk, cmd.mBatId, (Draw::Mode)cmd.mMode, (const Draw::Context*)cmd.mpCtx, pXforms, cmd.mInstNum);
+	} else {
+		obj_bat_submit((ScnObj*)cmd.mpObj, cmd.mBatId, (Draw::Mode)cmd.mMode, pXforms, cmd.mInstNum);
+	}
+}
+
+static void draw_cmds_flush(int statsPass) {
+	if (!s_pDrawCmds || s_pDrawCmds->get_num() <= 0) return;
+	Scene::update_view();
+	Scene::update_shadow();
+	s_drwCtx.view.mMode = (sxView::Mode)s_viewRot;
+	s_drwCtx.glb.useBump = s_useBump;
+	s_drwCtx.glb.useSpec = s_useSpec;
+	s_cmdCtxNoRecv = s_drwCtx;
+	s_cmdCtxNoRecv.shadow.mDens = 0.0f;
+	s_pDrawCmds->flush(cmd_record, cmd_replay, &statsPass, s_pBgd);
+	s_cmdListsNum = nxCalc::max(s_cmdListsNum, s_pDrawCmds->get_lists_num());
+}
+
+/* pass-through to obj_bat_submit() unless the batch can be recorded */
+static void obj_bat_emit(ScnObj* pObj, const int ibat, const Draw::Mode mode, const xt_xmtx* pXforms, const int ninst) {
+	if (s_pDrawCmds) {
+		const Draw::Context* pCtx = &s_drwCtx;
+		if (mode != Draw::DRWMODE_SHADOW_CAST && pObj->mDisableShadowRecv) {
+			pCtx = &s_cmdCtxNoRecv;
+		}
+		if (s_pDrawCmds->add(pObj, pObj->mpMdlWk, pCtx, ibat, mode, pXforms, ninst)) return;
+		draw_cmds_flush(DrawStats::get_counters()->get_pass());
+	}
+	obj_bat_submit(pObj, ibat, mode, pXforms, ninst);
+}
+
+static bool inst_reserve(const int n) {
+	if (n <= s_instMax) return true;
+	int nmax = nxCalc::max(n, s_instMax * 2);
+	nxCore::mem_free(s_pInstXforms);
+	nxCore::mem_free(s_pInstDone);
+	s_pInstXforms = (xt_xmtx*)nxCore::mem_alloc(nmax * sizeof(xt_xmtx), "Scn:inst_xforms");
+	s_pInstDone = (uint8_t*)nxCore::mem_alloc(nmax * sizeof(uint8_t), "Scn:inst_done");
+	if (!s_pInstXforms || !s_pInstDone) {
+		nxCore::mem_free(s_pInstXforms);
+		s_pInstXforms = nullptr;
+		nxCore::mem_free(s_pInstDone);
+		s_pInstDone = nullptr;
+		s_instMax = 0;
+		return false;
+	}
+	s_instMax = nmax;
+	return true;
+}
+
+static bool pkt_ck_draw(const ScnObj* pObj, const int ibat, const bool shadow) {
+	if (shadow ? pObj->mDisableShadowCast : pObj->mDisableDraw) return false;
+	return obj_bat_ck_draw(pObj, ibat, shadow);
+}
+
+/* rigid model and no per-batch callbacks: the batch can be drawn as one of several instances */
+static bool inst_ck_obj(const ScnObj* pObj, const bool shadow) {
+	const sxModelData* pMdl = pObj->get_model_data();
+	if (!pMdl || pMdl->has_skin()) return false;
+	if (!shadow && (pObj->mBatchPreDrawFunc || pObj->mBatchPostDrawFunc)) return false;
+	return true;
+}
+
+/* same model, material variation and draw parameters, so only the world transform differs */
+static bool inst_ck_pair(const ScnObj* pObjA, const ScnObj* pObjB, const int ibat, const bool shadow) {
+	const cxModelWork* pWkA = pObjA->mpMdlWk;
+	const cxModelWork* pWkB = pObjB->mpMdlWk;
+	if (pWkA->mpData != pWkB->mpData) return false;
+	if (pWkA->mVariation != pWkB->mVariation) return false;
+	if (!inst_ck_obj(pObjB, shadow)) return false;
+	const Draw::MdlParam* pParamA = (const Draw::MdlParam*)pWkA->mpParamMem;
+	const Draw::MdlParam* pParamB = (const Draw::MdlParam*)pWkB->mpParamMem;
+	if (pParamA && pParamB) {
+		if (::memcmp(pParamA, pParamB, sizeof(Draw::MdlParam)) != 0) return false;
+	} else if (pParamA || pParamB) {
+		return false;
+	}
+	if (!shadow) {
+		if (pObjA->mDisableShadowRecv != pObjB->mDisableShadowRecv) return false;
+		if (pWkA->mBoundsValid && pWkA->mpBatBBoxes && pWkB->mBoundsValid && pWkB->mpBatBBoxes) {
+			if (s_drwCtx.ck_bbox_shadow_receive(pWkA->mpBatBBoxes[ibat]) != s_drwCtx.ck_bbox_shadow_receive(pWkB->mpBatBBoxes[ibat])) return false;
+		}
+	}
+	return true;
+}
+
+static xt_xmtx inst_world_xform(const ScnObj* pObj) {
+	xt_xmtx wm;
+	if (pObj->mpMdlWk->mpWorldXform) {
+		wm = *pObj->mpMdlWk->mpWorldXform;
+	} else {
+		wm.identity();
+	}
+	return wm;
+}
+
+/* packets [org, org + n) share the state part of the key; identical batches among them are drawn at the position of the first one */
+static void draw_packets_inst(const int org, const int n, const bool shadow) {
+	Draw::Mode mode = shadow ? Draw::DRWMODE_SHADOW_CAST : Draw::DRWMODE_STD;
+	if (!inst_reserve(n)) {
+		for (int i = 0; i < n; ++i) {
+			const DrawPkt::Packet* pPkt = s_pDrawPkts->get_packet(org + i);
+			ScnObj* pObj = (ScnObj*)pPkt->mpData;
+			if (pkt_ck_draw(pObj, pPkt->mParam, shadow)) {
+				obj_bat_emit(pObj, pPkt->mParam, mode, nullptr, 0);
+			}
+		}
+		return;
+	}
+	update_shadow();
+	::memset(s_pInstDone, 0, n * sizeof(uint8_t));
+	for (int i = 0; i < n; ++i) {
+		if (s_pInstDone[i]) continue;
+		const DrawPkt::Packet* pPkt = s_pDrawPkts->get_packet(org + i);
+		ScnObj* pObj = (ScnObj*)pPkt->mpData;
+		int ibat = pPkt->mParam;
+		if (!pkt_ck_draw(pObj, ibat, shadow)) continue;
+		int ninst = 0;
+		if (inst_ck_obj(pObj, shadow)) {
+			s_pInstXforms[ninst++] = inst_world_xform(pObj);
+			for (int j = i + 1; j < n; ++j) {
+				if (s_pInstDone[j]) continue;
+				const DrawPkt::Packet* pPktB = s_pDrawPkts->get_packet(org + j);
+				ScnObj* pObjB = (ScnObj*)pPktB->mpData;
+				if (pPktB->mParam != ibat) continue;
+				if (!inst_ck_pair(pObj, pObjB, ibat, shadow)) continue;
+				s_pInstDone[j] = 1;
+				if (pkt_ck_draw(pObjB, ibat, shadow)) {
+					s_pInstXforms[ninst++] = inst_world_xform(pObjB);
+				}
+			}
+		}
+		if (ninst > 1) {
+			obj_bat_emit(pObj, ibat, mode, s_pInstXforms, ninst);
+			++s_instGroupsNum;
+			s_instDrawsNum += ninst;
+		} else {
+			obj_bat_emit(pObj, ibat, mode, nullptr, 0);
+		}
+	}
+}
+
+static void draw_packets(const int org, const int end, const bool discard) {
+	bool instFlg = s_drawInstFlg && s_pDraw && s_pDraw->batch_inst;
+	int i = org;
+	while (i < end) {
+		const DrawPkt::Packet* pPkt = s_pDrawPkts->get_packet(i);
+		ScnObj* pObj = (ScnObj*)pPkt->mpData;
+		int pass = DrawPkt::get_key_pass(pPkt->mKey);
+		int n = 1;
+		DrawStats::set_pass(pass == DrawPkt::PASS_SHADOW ? DrawStats::PASS_SHADOW : pass == DrawPkt::PASS_OPAQ ? DrawStats::PASS_OPAQ : DrawStats::PASS_SEMI);
+		if (instFlg && (pass == DrawPkt::PASS_SHADOW || pass == DrawPkt::PASS_OPAQ)) {
+			uint64_t state = pPkt->mKey >> 24;
+			while (i + n < end && (s_pDrawPkts->get_packet(i + n)->mKey >> 24) == state) {
+				++n;
+			}
+		}
+		if (n > 1) {
+			draw_packets_inst(i, n, pass == DrawPkt::PASS_SHADOW);
+		} else if (pass == DrawPkt::PASS_SHADOW) {
+			if (pkt_ck_draw(pObj, pPkt->mParam, true)) {
+				obj_bat_emit(pObj, pPkt->mParam, Draw::DRWMODE_SHADOW_CAST, nullptr, 0);
+			}
+		} else if (pkt_ck_draw(pObj, pPkt->mParam, false)) {
+			Draw::Mode mode = Draw::DRWMODE_STD;
+			if (pass != DrawPkt::PASS_OPAQ && discard) {
+				mode = Draw::DRWMODE_DISCARD;
+			}
+			obj_bat_emit(pObj, pPkt->mParam, mode, nullptr, 0);
+		}
+		i += n;
+	}
 }
 
 void draw(bool discard) {
 	if (!s_pObjList) return;
 
+	s_instGroupsNum = 0;
+	s_instDrawsNum = 0;
+	s_cmdListsNum = 0;
+	if (s_pDrawPkts && s_drawPktsValid) {
+		int isemi = s_pDrawPkts->find_pass(DrawPkt::PASS_SEMI);
+		draw_packets(0, isemi, discard);
+		draw_cmds_flush(DrawStats::PASS_OPAQ);
+		DrawStats::set_pass(DrawStats::PASS_OPAQ);
+		for (ObjList::Itr itr = s_pObjList->get_itr(); !itr.end(); itr.next()) {
+			ScnObj* pObj = itr.item();
+			if (pObj && (pObj->mPreOpaqFunc || pObj->mPostOpaqFunc)) {
+				pObj->draw_opaq();
+			}
+		}
+		draw_packets(isemi, s_pDrawPkts->get_num(), discard);
+		draw_cmds_flush(DrawStats::PASS_SEMI);
+		DrawStats::set_pass(DrawStats::PASS_OTHER);
+		prim_batch_flush();
+		return;
+	}
+
+	DrawStats::set_pass(DrawStats::PASS_SHADOW);
 	for (ObjList::Itr itr = s_pObjList->get_itr(); !itr.end(); itr.next()) {
 		ScnObj* pObj = itr.item();
 		if (pObj) {
@@ -2454,6 +3824,7 @@ void draw(bool discard) {
 		}
 	}
 
+	DrawStats::set_pass(DrawStats::PASS_OPAQ);
 	for (ObjList::Itr itr = s_pObjList->get_itr(); !itr.end(); itr.next()) {
 		ScnObj* pObj = itr.item();
 		if (pObj) {
@@ -2461,12 +3832,15 @@ void draw(bool discard) {
 		}
 	}
 
+	DrawStats::set_pass(DrawStats::PASS_SEMI);
 	for (ObjList::Itr itr = s_pObjList->get_itr(); !itr.end(); itr.next()) {
 		ScnObj* pObj = itr.item();
 		if (pObj) {
 			pObj->draw_semi(discard);
 		}
 	}
+	DrawStats::set_pass(DrawStats::PASS_OTHER);
+	prim_batch_flush();
 }
 
 void print(const float x, const float y, const cxColor& clr, const char* pStr) {
@@ -2510,12 +3884,11 @@ float speed() {
 } // Scene
 
 
-static void obj_bat_draw(ScnObj* pObj, const int ibat, const Draw::Mode mode) {
-	cxModelWork* pWk = pObj->mpMdlWk;
-	if (!pWk) return;
-	if (pWk->is_bat_mtl_hidden(ibat)) return;
+static bool obj_bat_ck_draw(const ScnObj* pObj, const int ibat, const bool isShadowcast) {
+	const cxModelWork* pWk = pObj->mpMdlWk;
+	if (!pWk) return false;
+	if (pWk->is_bat_mtl_hidden(ibat)) return false;
 	bool cullFlg = false;
-	bool isShadowcast = mode == Draw::DRWMODE_SHADOW_CAST;
 	if (isShadowcast) {
 		if (pWk->mpExtMem) {
 			uint32_t* pCastCullBits = (uint32_t*)pWk->mpExtMem;
@@ -2524,9 +3897,13 @@ static void obj_bat_draw(ScnObj* pObj, const int ibat, const Draw::Mode mode) {
 	} else {
 		cullFlg = XD_BIT_ARY_CK(uint32_t, pWk->mpCullBits, ibat);
 	}
-	if (cullFlg) {
-		return;
-	}
+	return !cullFlg;
+}
+
+/* pXforms: ninst world transforms for Draw::Ifc::batch_inst, nullptr for a single draw of pObj */
+static void obj_bat_submit(ScnObj* pObj, const int ibat, const Draw::Mode mode, const xt_xmtx* pXforms, const int ninst) {
+	cxModelWork* pWk = pObj->mpMdlWk;
+	bool isShadowcast = mode == Draw::DRWMODE_SHADOW_CAST;
 	if (!isShadowcast) {
 		if (pObj->mBatchPreDrawFunc) {
 			pObj->mBatchPreDrawFunc(pObj, ibat);
@@ -2543,7 +3920,11 @@ static void obj_bat_draw(ScnObj* pObj, const int ibat, const Draw::Mode mode) {
 		if (!isShadowcast && pObj->mDisableShadowRecv) {
 			pCtx->shadow.mDens = 0.0f;
 		}
-		s_pDraw->batch(pWk, ibat, mode, pCtx);
+		if (pXforms && s_pDraw->batch_inst) {
+			s_pDraw->batch_inst(pWk, ibat, mode, pCtx, pXforms, ninst);
+		} else {
+			s_pDraw->batch(pWk, ibat, mode, pCtx);
+		}
 		pCtx->shadow.mDens = sdens;
 	}
 	if (!isShadowcast) {
@@ -2553,6 +3934,11 @@ static void obj_bat_draw(ScnObj* pObj, const int ibat, const Draw::Mode mode) {
 	}
 }
 
+static void obj_bat_draw(ScnObj* pObj, const int ibat, const Draw::Mode mode) {
+	if (!obj_bat_ck_draw(pObj, ibat, mode == Draw::DRWMODE_SHADOW_CAST)) return;
+	obj_bat_submit(pObj, ibat, mode, nullptr, 0);
+}
+
 const char* ScnObj::get_batch_mtl_name(const int ibat) const {
 	const char* pName = nullptr;
 	const sxModelData* pMdl = get_model_data();
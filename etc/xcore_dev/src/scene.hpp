@@ -68,6 +68,12 @@ public:
 	bool mDisableDraw;
 	bool mDisableShadowCast;
 	bool mDisableShadowRecv;
+	bool mOccluder; /* drawn into the occlusion buffer, see Scene::enable_occlusion_culling() */
+	int32_t mOccluderLOD;
+	int32_t mBVHId; /* leaf in the object tree, see Scene::enable_obj_bvh() */
+	uint32_t mBVHStamp;
+	int32_t mPktOrg; /* draw packets range, see Scene::enable_draw_sort() */
+	int32_t mPktNum;
 	float mObjAdjYOffs;
 	float mObjAdjRadius;
 	int32_t mMotExecSync;
@@ -109,9 +115,9 @@ public:
 	void clear_int_wk();
 	void clear_flt_wk();
 	void clear_ptr_wk();
-	bool ck_int_wk_idx(const int idx) { return idx >= 0 && idx < XD_ARY_LEN(mIntWk); }
-	bool ck_flt_wk_idx(const int idx) { return idx >= 0 && idx < XD_ARY_LEN(mFltWk); }
-	bool ck_ptr_wk_idx(const int idx) { return idx >= 0 && idx < XD_ARY_LEN(mPtrWk); }
+	bool ck_int_wk_idx(const int idx) { return idx >= 0 && idx < int(XD_ARY_LEN(mIntWk)); }
+	bool ck_flt_wk_idx(const int idx) { return idx >= 0 && idx < int(XD_ARY_LEN(mFltWk)); }
+	bool ck_ptr_wk_idx(const int idx) { return idx >= 0 && idx < int(XD_ARY_LEN(mPtrWk)); }
 
 	void set_vptr_wk(const int idx, void* p) {
 		if (ck_ptr_wk_idx(idx)) {
@@ -253,6 +259,9 @@ sxExprLibData* load_expr_lib(const char* pRelPath);
 void frame_begin(const cxColor& clearColor = cxColor(0.0f, 0.0f, 0.0f, 1.0f));
 void frame_end();
 uint64_t get_frame_count();
+/* frame_end() snapshots the draw counters (DrawStats, passes set by draw()), the window is -draw_stats_window frames;
+   with -draw_stats_csv:<path> the window is saved on reset() */
+bool save_draw_stats_csv(const char* pPath);
 
 void push_ctx();
 void pop_ctx();
@@ -314,6 +323,55 @@ bool is_rot_view();
 
 bool is_sphere_visible(const cxSphere& sph, const bool exact = true);
 
+/* software depth buffer of ScnObj::mOccluder models (rigid ones only), hidden objects and batches are culled for the camera but still cast shadows */
+void enable_occlusion_culling(const int width = 256, const int height = 128, const int maxTris = 0x4000);
+void disable_occlusion_culling();
+bool is_occlusion_culling_enabled();
+
+/* dynamic bounding volume tree over the objects, refreshed after exec(): objects outside the view and (with shadow cast culling) the shadow
+   volume are culled in visibility() without running their per-object job */
+void enable_obj_bvh(const float margin = 0.1f);
+void disable_obj_bvh();
+bool is_obj_bvh_enabled();
+
+/* cascaded shadow setup computed in visibility() for the view range up to the shadow distance (set_shadow_proj_params()):
+   per-cascade matrices and the batches that cast into each cascade; the draw interfaces still render the single shadow map */
+void enable_shadow_cascades(const int num = 4, const float lambda = 0.75f);
+void disable_shadow_cascades();
+int get_shadow_cascades_num();
+cxMtx get_shadow_cascade_view_proj_mtx(const int icsc);
+/* view depth where the cascade ends */
+float get_shadow_cascade_split(const int icsc);
+int get_shadow_cascade_casters_num(const int icsc);
+ScnObj* get_shadow_cascade_caster(const int icsc, const int idx, int* pBatId = nullptr);
+
+/* visibility() turns the batches that passed culling into draw packets with 64-bit sort keys (pass, shader, material, texture, depth),
+   sorted by the brigade; draw() then submits them in key order (objects with opaque draw callbacks keep their own opaque pass) */
+void enable_draw_sort();
+void disable_draw_sort();
+bool is_draw_sort_enabled();
+int get_draw_packets_num();
+uint64_t get_draw_packet_key(const int idx);
+ScnObj* get_draw_packet(const int idx, int* pBatId = nullptr);
+
+/* sorted shadow and opaque packets of rigid models that differ only by the world transform are drawn as one
+   Draw::Ifc::batch_inst call (enables draw sorting, interfaces without batch_inst keep drawing them one by one);
+   the counts are for the last draw() */
+void enable_draw_instancing();
+void disable_draw_instancing();
+bool is_draw_instancing_enabled();
+int get_draw_inst_groups_num();
+int get_draw_inst_batches_num();
+
+/* sorted packets are turned into draw commands whose per-batch constants are packed by the brigade
+   (Draw::Ifc::batch_prep), chunkSize commands at a time, then submitted in packet order on the calling thread;
+   enables draw sorting, batches with draw callbacks and interfaces without batch_prep are drawn directly */
+void enable_draw_mt_record(const int chunkSize = 1024);
+void disable_draw_mt_record();
+bool is_draw_mt_record_enabled();
+/* most worker lists a chunk was recorded with in the last draw() */
+int get_draw_mt_record_lists_num();
+
 bool is_shadow_uniform();
 void set_shadow_uniform(const bool flg);
 void set_shadow_density(const float dens);
@@ -384,6 +442,29 @@ void tris_semi_dsided(const uint32_t vtxOrg, const uint32_t triNum, cxMtx* pMtx,
 void tris_semi(const uint32_t vtxOrg, const uint32_t triNum, cxMtx* pMtx, sxTextureData* pTex);
 void idx_tris_semi_dsided(const uint32_t idxOrg, const uint32_t triNum, cxMtx* pMtx, sxTextureData* pTex);
 void sprite_tris(const uint32_t vtxOrg, const uint32_t triNum, sxTextureData* pTex);
+/* dynamic prims added from any thread into a transient buffer and drawn with one indexed call per material
+   (texture, type, sidedness, blending): [vorg, vorg + vnum) and [iorg, iorg + inum) of the prim buffers (see init_prims())
+   are reserved for them and used as two halves in turn; prims added before draw() are drawn at its end,
+   later ones by prim_batch_flush() or at frame_end(); add order is kept within a material only.
+   While enabled, quad(), symbol() and symbol_str() go into the same buffer as screen prims, drawn over the others
+   in add order (a change of the quad gamma flushes them), and prim_geom()/prim_verts() uploads that continue
+   each other are staged and sent as one range before the next prim draw */
+void enable_prim_batch(const uint32_t vorg, const uint32_t vnum, const uint32_t iorg, const uint32_t inum, const int maxPrims = 4096);
+void disable_prim_batch();
+bool is_prim_batch_enabled();
+/* pIdx == nullptr: nvtx / 3 triangles in vertex order; pMtx is applied on the CPU */
+bool prim_batch_tris(const sxPrimVtx* pVtx, const int nvtx, const uint16_t* pIdx, const int nidx, sxTextureData* pTex, const cxMtx* pMtx = nullptr, const bool dblSided = false, const bool alphaBlend = true);
+bool prim_batch_sprite(const cxVec& pos, const float size, const float rot, const cxColor& clr, sxTextureData* pTex = nullptr, const xt_float4* pTexRect = nullptr);
+void prim_batch_flush();
+/* last flush: draw calls, prims and prims that did not fit */
+int get_prim_batch_draws_num();
+int get_prim_batch_prims_num();
+int get_prim_batch_dropped_num();
+/* per-flush capacity and its peak use since enabled */
+int get_prim_batch_peak_vtx_num();
+int get_prim_batch_peak_idx_num();
+int get_prim_batch_capacity_vtx();
+int get_prim_batch_capacity_idx();
 
 void set_ref_scr_size(const float w, const float h);
 float get_ref_scr_width();
@@ -401,6 +482,30 @@ void symbol(const int sym, const float ox, const float oy, const cxColor clr = c
 void symbol_str(const char* pStr, const float ox, const float oy, const cxColor clr = cxColor(1.0f));
 
 float get_ground_height(sxCollisionData* pCol, const cxVec pos, const float offsTop = 1.8f, const float offsBtm = 0.5f);
+/* Heightfield over static ground: a cell is answered by bilinear filtering when its corners see a single surface
+   and the estimate at its center and edge midpoints is within tolerance of the ray result; other cells
+   (overhangs, holes, sharp creases) fall back to get_ground_height(pCol, ...) */
+struct GroundCache;
+GroundCache* ground_cache_create(sxCollisionData* pCol, const float cellSize = 0.5f, const float tolerance = 0.01f);
+void ground_cache_destroy(GroundCache* pCache);
+float ground_cache_coverage(const GroundCache* pCache);
+float get_ground_height(const GroundCache* pCache, const cxVec pos, const float offsTop = 1.8f, const float offsBtm = 0.5f);
+/* pCache is used when it was built for pCol */
+void get_ground_heights(sxCollisionData* pCol, const cxVec* pPos, float* pHeights, const int num, const float offsTop = 1.8f, const float offsBtm = 0.5f, const GroundCache* pCache = nullptr);
+struct WallAdjCtx;
+
+/* per-worker contexts for jobs of the scene brigade + shared ones, allocated by init();
+   get_job_wall_adj_ctx() claims a shared context for any other caller and returns null when all of them are in use,
+   wall_adj_base() then uses a private context; every non-null result goes back through release_job_wall_adj_ctx() */
+void alloc_wall_adj_ctxs();
+void free_wall_adj_ctxs();
+WallAdjCtx* get_job_wall_adj_ctx(const sxJobContext* pJobCtx);
+void release_job_wall_adj_ctx(WallAdjCtx* pCtx);
+/* private context for callers outside of the scene brigade, capacity is retained until destroyed */
+WallAdjCtx* wall_adj_ctx_create();
+void wall_adj_ctx_destroy(WallAdjCtx* pCtx);
+int wall_adj_ctx_capacity(const WallAdjCtx* pCtx);
+bool wall_adj_base(WallAdjCtx* pWallCtx, sxCollisionData* pCol, const cxVec& newPos, const cxVec& oldPos, const float radius, cxVec* pAdjPos, const float wallSlopeLim = 0.7f);
 bool wall_adj_base(const sxJobContext* pJobCtx, sxCollisionData* pCol, const cxVec& newPos, const cxVec& oldPos, const float radius, cxVec* pAdjPos, const float wallSlopeLim = 0.7f);
 bool wall_adj(const sxJobContext* pJobCtx, sxCollisionData* pCol, const cxVec& newPos, const cxVec& oldPos, const float radius, cxVec* pAdjPos, const float wallSlopeLim = 0.7f, const float errParam = 0.5f);
 
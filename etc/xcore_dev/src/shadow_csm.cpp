@@ -0,0 +1,318 @@
+#include "crosscore.hpp"
+#include "shadow_csm.hpp"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#	define CSM_SSE 1
+#	include <emmintrin.h>
+#else
+#	define CSM_SSE 0
+#endif
+
+namespace ShadowCSM {
+
+void Cascades::init(const int num, const int mapSize, const float lambda, const float casterMargin, const int maxJobs) {
+	reset();
+	if (num <= 0 || mapSize <= 2) return;
+	mNum = nxCalc::min(num, int(MAX_CASCADES));
+	mMapSize = mapSize;
+	mLambda = nxCalc::saturate(lambda);
+	mCasterMargin = nxCalc::max(casterMargin, 0.0f);
+	if (maxJobs > 1) {
+		mpQue = nxTask::queue_create(maxJobs);
+		mpJobs = (sxJob*)nxCore::mem_alloc(maxJobs * sizeof(sxJob), "CSM:Jobs");
+		mpJobInfo = (JobInfo*)nxCore::mem_alloc(maxJobs * sizeof(JobInfo), "CSM:JobInfo");
+		if (mpQue && mpJobs && mpJobInfo) {
+			::memset(mpJobs, 0, maxJobs * sizeof(sxJob));
+			mJobsMax = maxJobs;
+		} else {
+			if (mpQue) {
+				nxTask::queue_destroy(mpQue);
+				mpQue = nullptr;
+			}
+			nxCore::mem_free(mpJobs);
+			mpJobs = nullptr;
+			nxCore::mem_free(mpJobInfo);
+			mpJobInfo = nullptr;
+		}
+	}
+}
+
+void Cascades::reset() {
+	for (int i = 0; i < MAX_CASCADES; ++i) {
+		nxCore::mem_free(mpLists[i]);
+		mpLists[i] = nullptr;
+		mListNum[i] = 0;
+	}
+	nxCore::mem_free(mpMasks);
+	mpMasks = nullptr;
+	if (mpQue) {
+		nxTask::queue_destroy(mpQue);
+		mpQue = nullptr;
+	}
+	nxCore::mem_free(mpJobs);
+	mpJobs = nullptr;
+	nxCore::mem_free(mpJobInfo);
+	mpJobInfo = nullptr;
+	mpBoxes = nullptr;
+	mNum = 0;
+	mMapSize = 0;
+	mItemsNum = 0;
+	mItemsMax = 0;
+	mJobsMax = 0;
+}
+
+bool Cascades::reserve(const int n) {
+	if (n <= mItemsMax) return true;
+	int nmax = nxCalc::max(n, mItemsMax * 2);
+	nxCore::mem_free(mpMasks);
+	mpMasks = (uint8_t*)nxCore::mem_alloc(nmax * sizeof(uint8_t), "CSM:Masks");
+	bool res = mpMasks != nullptr;
+	for (int i = 0; i < MAX_CASCADES; ++i) {
+		nxCore::mem_free(mpLists[i]);
+		mpLists[i] = nullptr;
+		if (res && i < mNum) {
+			mpLists[i] = (int32_t*)nxCore::mem_alloc(nmax * sizeof(int32_t), "CSM:List");
+			res = mpLists[i] != nullptr;
+		}
+	}
+	if (!res) {
+		nxCore::mem_free(mpMasks);
+		mpMasks = nullptr;
+		for (int i = 0; i < MAX_CASCADES; ++i) {
+			nxCore::mem_free(mpLists[i]);
+			mpLists[i] = nullptr;
+		}
+		mItemsMax = 0;
+		return false;
+	}
+	mItemsMax = nmax;
+	return true;
+}
+
+/*static*/ float Cascades::calc_split(const int i, const int num, const float znear, const float zfar, const float lambda) {
+	if (num <= 0 || i <= 0) return znear;
+	if (i >= num) return zfar;
+	float t = float(i) / float(num);
+	float dlog = znear * ::powf(nxCalc::div0(zfar, znear), t);
+	float dlin = nxCalc::lerp(znear, zfar, t);
+	return nxCalc::lerp(dlin, dlog, lambda);
+}
+
+void Cascades::update(const cxMtx& invView, const float tanX, const float tanY, const float znear, const float zfar, const cxVec& lightDir) {
+	if (mNum <= 0) return;
+	mViewPos = invView.get_translation();
+	mViewDir = invView.get_row_vec(2).neg_val().get_normalized();
+	cxVec dir = lightDir.get_normalized();
+	cxVec up(0.0f, 1.0f, 0.0f);
+	if (::fabsf(dir.y) > 0.99f) {
+		up.set(1.0f, 0.0f, 0.0f);
+	}
+	/* rotation only, so whole-texel steps of the light-space origin stay whole texels in the map */
+	mLightRot.mk_view(cxVec(0.0f), dir, up);
+	cxVec ax = mLightRot.get_col_vec(0);
+	cxVec ay = mLightRot.get_col_vec(1);
+	cxVec az = mLightRot.get_col_vec(2);
+	float kk = nxCalc::sq(tanX) + nxCalc::sq(tanY);
+	float n = nxCalc::max(znear, 1.0e-4f);
+	float f = nxCalc::max(zfar, n + 1.0e-4f);
+	for (int k = 0; k < 3; ++k) {
+		for (int i = 0; i < MAX_CASCADES; ++i) {
+			mLightMin[k][i] = FLT_MAX;
+			mLightMax[k][i] = -FLT_MAX;
+		}
+	}
+	for (int i = 0; i < mNum; ++i) {
+		Cascade* pCsc = &mCascades[i];
+		float dn = calc_split(i, mNum, n, f, mLambda);
+		float df = calc_split(i + 1, mNum, n, f, mLambda);
+		/* center on the view axis equidistant from the near and far slice corners */
+		float zc = nxCalc::clamp((dn + df) * (1.0f + kk) * 0.5f, dn, df);
+		float rn = ::sqrtf(nxCalc::sq(zc - dn) + nxCalc::sq(dn) * kk);
+		float rf = ::sqrtf(nxCalc::sq(df - zc) + nxCalc::sq(df) * kk);
+		float r = nxCalc::max(rn, rf);
+		/* snapping moves the map by up to half a texel, one texel of border keeps the slice covered */
+		r *= float(mMapSize) / float(mMapSize - 2);
+		float texel = (r * 2.0f) / float(mMapSize);
+		cxVec c = mViewPos + mViewDir*zc;
+		cxVec lc = mLightRot.calc_pnt(c);
+		float sx = ::floorf(lc.x / texel + 0.5f) * texel;
+		float sy = ::floorf(lc.y / texel + 0.5f) * texel;
+		float zn = lc.z + r + mCasterMargin;
+		float zf = lc.z - r;
+		float rr = nxCalc::rcp0(r);
+		float rz = nxCalc::rcp0(zn - zf);
+		cxMtx proj;
+		proj.identity();
+		proj.m[0][0] = rr;
+		proj.m[1][1] = rr;
+		proj.m[2][2] = -rz;
+		proj.m[3][0] = -sx * rr;
+		proj.m[3][1] = -sy * rr;
+		proj.m[3][2] = zn * rz;
+		pCsc->mViewMtx = mLightRot;
+		pCsc->mProjMtx = proj;
+		pCsc->mViewProjMtx = mLightRot * proj;
+		/* culling bounds get a little slack so that boxes touching the boundary are kept */
+		float eps = (::fabsf(sx) + ::fabsf(sy) + ::fabsf(zn) + ::fabsf(zf) + r + 1.0f) * 1.0e-5f;
+		pCsc->mPlanes[0].calc(ax * (sx + r + eps), ax);
+		pCsc->mPlanes[1].calc(ax * (sx - r - eps), ax.neg_val());
+		pCsc->mPlanes[2].calc(ay * (sy + r + eps), ay);
+		pCsc->mPlanes[3].calc(ay * (sy - r - eps), ay.neg_val());
+		pCsc->mPlanes[4].calc(az * (zn + eps), az);
+		pCsc->mPlanes[5].calc(az * (zf - eps), az.neg_val());
+		mLightMin[0][i] = sx - r - eps;
+		mLightMin[1][i] = sy - r - eps;
+		mLightMin[2][i] = zf - eps;
+		mLightMax[0][i] = sx + r + eps;
+		mLightMax[1][i] = sy + r + eps;
+		mLightMax[2][i] = zn + eps;
+		pCsc->mBounds = cxSphere(c, r);
+		pCsc->mSplitNear = dn;
+		pCsc->mSplitFar = df;
+		pCsc->mTexelSize = texel;
+	}
+}
+
+/*static*/ bool Cascades::box_in_cascade(const cxAABB& box, const Cascade& csc) {
+	cxVec c = box.get_center();
+	cxVec e = box.get_max_pos() - c;
+	for (int i = 0; i < 6; ++i) {
+		const cxPlane& pln = csc.mPlanes[i];
+		cxVec nrm = pln.get_normal();
+		float d = pln.signed_dist(c);
+		float r = e.dot(nrm.abs_val());
+		if (d - r > 0.0f) return false;
+	}
+	return true;
+}
+
+int Cascades::find_cascade(const cxVec& pos) const {
+	float depth = (pos - mViewPos).dot(mViewDir);
+	for (int i = 0; i < mNum; ++i) {
+		if (depth <= mCascades[i].mSplitFar) return i;
+	}
+	return -1;
+}
+
+void Cascades::exec_range(const int org, const int num) {
+	int end = org + num;
+	if (mPhase == Phase::CULL) {
+		/* all cascades share the light rotation: every box goes to light space once, then each cascade is a few compares */
+		const float (*m)[4] = mLightRot.m;
+		float am[3][3];
+		for (int k = 0; k < 3; ++k) {
+			for (int l = 0; l < 3; ++l) {
+				am[k][l] = ::fabsf(m[k][l]);
+			}
+		}
+		for (int i = org; i < end; ++i) {
+			/* plain floats, cxVec arithmetic goes through the LA helpers */
+			cxVec bmin = mpBoxes[i].get_min_pos();
+			cxVec bmax = mpBoxes[i].get_max_pos();
+			float cx = (bmin.x + bmax.x) * 0.5f;
+			float cy = (bmin.y + bmax.y) * 0.5f;
+			float cz = (bmin.z + bmax.z) * 0.5f;
+			float ex = bmax.x - cx;
+			float ey = bmax.y - cy;
+			float ez = bmax.z - cz;
+			float lc[3];
+			float le[3];
+			for (int k = 0; k < 3; ++k) {
+				lc[k] = cx*m[0][k] + cy*m[1][k] + cz*m[2][k];
+				le[k] = ex*am[0][k] + ey*am[1][k] + ez*am[2][k];
+			}
+			float lmin[3];
+			float lmax[3];
+			for (int k = 0; k < 3; ++k) {
+				lmin[k] = lc[k] - le[k];
+				lmax[k] = lc[k] + le[k];
+			}
+			/* no early outs: random boxes make those branches unpredictable */
+			uint32_t mask = 0;
+#if CSM_SSE
+			/* 4 cascades per lane group, empty cascades always test outside */
+			for (int j = 0; j < mNum; j += 4) {
+				__m128 out = _mm_setzero_ps();
+				for (int k = 0; k < 3; ++k) {
+					out = _mm_or_ps(out, _mm_cmpgt_ps(_mm_set1_ps(lmin[k]), _mm_loadu_ps(&mLightMax[k][j])));
+					out = _mm_or_ps(out, _mm_cmplt_ps(_mm_set1_ps(lmax[k]), _mm_loadu_ps(&mLightMin[k][j])));
+				}
+				mask |= uint32_t(_mm_movemask_ps(out) ^ 0xF) << j;
+			}
+			mask &= (1U << mNum) - 1;
+#else
+			for (int j = 0; j < mNum; ++j) {
+				uint32_t out = 0;
+				for (int k = 0; k < 3; ++k) {
+					out |= uint32_t(lmin[k] > mLightMax[k][j]) | uint32_t(lmax[k] < mLightMin[k][j]);
+				}
+				mask |= (out ^ 1U) << j;
+			}
+#endif
+			mpMasks[i] = uint8_t(mask);
+		}
+	} else {
+		for (int j = org; j < end; ++j) {
+			int32_t* pList = mpLists[j];
+			uint32_t bit = 1U << j;
+			int cnt = 0;
+			for (int i = 0; i < mItemsNum; ++i) {
+				pList[cnt] = i;
+				cnt += (mpMasks[i] & bit) ? 1 : 0;
+			}
+			mListNum[j] = cnt;
+		}
+	}
+}
+
+/*static*/ void Cascades::phase_job(const sxJobContext* pCtx) {
+	if (!pCtx || !pCtx->mpJob) return;
+	JobInfo* pInfo = (JobInfo*)pCtx->mpJob->mpData;
+	if (!pInfo || !pInfo->mpCSM) return;
+	pInfo->mpCSM->exec_range(pInfo->mOrg, pInfo->mNum);
+}
+
+void Cascades::exec_phase(const Phase phase, const int n, const int minJobItems, cxBrigade* pBgd) {
+	mPhase = phase;
+	if (n <= 0) return;
+	if (!pBgd || !mpQue || n < minJobItems * 2) {
+		exec_range(0, n);
+		return;
+	}
+	int njob = nxCalc::min(nxCalc::min(mJobsMax, n / minJobItems), pBgd->get_active_workers_num());
+	if (njob < 2) {
+		exec_range(0, n);
+		return;
+	}
+	nxTask::queue_purge(mpQue);
+	for (int i = 0; i < njob; ++i) {
+		int org = int(int64_t(n) * i / njob);
+		int end = int(int64_t(n) * (i + 1) / njob);
+		JobInfo* pInfo = &mpJobInfo[i];
+		pInfo->mpCSM = this;
+		pInfo->mOrg = org;
+		pInfo->mNum = end - org;
+		sxJob* pJob = &mpJobs[i];
+		pJob->mFunc = phase_job;
+		pJob->mpData = pInfo;
+		pJob->mId = i;
+		nxTask::queue_add(mpQue, pJob);
+	}
+	nxTask::queue_exec(mpQue, pBgd);
+}
+
+void Cascades::cull(const cxAABB* pBoxes, const int n, cxBrigade* pBgd) {
+	for (int i = 0; i < MAX_CASCADES; ++i) {
+		mListNum[i] = 0;
+	}
+	mItemsNum = 0;
+	if (mNum <= 0 || !pBoxes || n <= 0) return;
+	if (!reserve(n)) return;
+	mpBoxes = pBoxes;
+	mItemsNum = n;
+	exec_phase(Phase::CULL, n, MIN_JOB_BOXES, pBgd);
+	exec_phase(Phase::LISTS, mNum, 1, n < MIN_LIST_BOXES ? nullptr : pBgd);
+	mpBoxes = nullptr;
+}
+
+} // ShadowCSM
@@ -0,0 +1,126 @@
+namespace ShadowCSM {
+
+/* one light-space slice of the view: orthographic along the light, z/w in [0, 1] from the light side */
+struct Cascade {
+	cxMtx mViewMtx;
+	cxMtx mProjMtx;
+	cxMtx mViewProjMtx;
+	cxPlane mPlanes[6]; /* world-space box of the projection, normals point out */
+	cxSphere mBounds;   /* around the view slice, the size only depends on the split distances and the FOV */
+	float mSplitNear;
+	float mSplitFar;
+	float mTexelSize;
+
+	void reset() {
+		mViewMtx.identity();
+		mProjMtx.identity();
+		mViewProjMtx.identity();
+		for (int i = 0; i < 6; ++i) {
+			mPlanes[i].calc(cxVec(0.0f), cxVec(0.0f));
+		}
+		mBounds = cxSphere(0.0f, 0.0f, 0.0f, 0.0f);
+		mSplitNear = 0.0f;
+		mSplitFar = 0.0f;
+		mTexelSize = 0.0f;
+	}
+};
+
+/* Cascaded shadow map setup for a directional light.
+   Splits follow the practical scheme (lambda blends logarithmic and uniform distances), every cascade is fitted to the
+   bounding sphere of its view slice and its origin is snapped to whole shadow texels, so the maps do not shimmer
+   while the camera moves or turns. Casters are culled against every cascade in one pass over the boxes,
+   split into ranges of boxes for the brigade, and collected into per-cascade lists in box order.
+   A box is a few dozen compares, so the brigade is only used from MIN_JOB_BOXES boxes per job up, and the lists
+   (one pass over all masks per cascade) from MIN_LIST_BOXES boxes up; smaller scenes are culled serially. */
+class Cascades {
+public:
+	static const int MAX_CASCADES = 8;
+	static const int MIN_JOB_BOXES = 16384;
+	static const int MIN_LIST_BOXES = 65536;
+
+protected:
+	enum class Phase {
+		CULL,
+		LISTS
+	};
+
+	struct JobInfo {
+		Cascades* mpCSM;
+		int mOrg;
+		int mNum;
+	};
+
+	Cascade mCascades[MAX_CASCADES];
+	/* projection boxes in light view space as [axis][cascade], unused cascades are empty */
+	float mLightMin[3][MAX_CASCADES];
+	float mLightMax[3][MAX_CASCADES];
+	int32_t* mpLists[MAX_CASCADES];
+	int mListNum[MAX_CASCADES];
+	uint8_t* mpMasks;
+	const cxAABB* mpBoxes;
+	sxJobQueue* mpQue;
+	sxJob* mpJobs;
+	JobInfo* mpJobInfo;
+	cxMtx mLightRot;
+	cxVec mViewPos;
+	cxVec mViewDir;
+	Phase mPhase;
+	int mNum;
+	int mMapSize;
+	float mLambda;
+	float mCasterMargin;
+	int mItemsNum;
+	int mItemsMax;
+	int mJobsMax;
+
+	bool reserve(const int n);
+	void exec_range(const int org, const int num);
+	void exec_phase(const Phase phase, const int n, const int minJobItems, cxBrigade* pBgd);
+
+	static void phase_job(const sxJobContext* pCtx);
+
+public:
+	Cascades()
+	: mpMasks(nullptr), mpBoxes(nullptr), mpQue(nullptr), mpJobs(nullptr), mpJobInfo(nullptr), mPhase(Phase::CULL),
+	mNum(0), mMapSize(0), mLambda(0.75f), mCasterMargin(0.0f), mItemsNum(0), mItemsMax(0), mJobsMax(0) {
+		::memset(mLightMin, 0, sizeof(mLightMin));
+		::memset(mLightMax, 0, sizeof(mLightMax));
+		for (int i = 0; i < MAX_CASCADES; ++i) {
+			mCascades[i].reset();
+			mpLists[i] = nullptr;
+			mListNum[i] = 0;
+		}
+		mLightRot.identity();
+		mViewPos.zero();
+		mViewDir.set(0.0f, 0.0f, -1.0f);
+	}
+
+	~Cascades() { reset(); }
+
+	/* lambda: 0 uniform splits, 1 logarithmic; casterMargin extends every cascade toward the light */
+	void init(const int num, const int mapSize, const float lambda = 0.75f, const float casterMargin = 30.0f, const int maxJobs = 0);
+	void reset();
+
+	/* invView as produced by cxMtx::mk_view (the camera looks down -Z), tanX and tanY are the half-FOV tangents,
+	   cascades cover view depths [znear, zfar]; lightDir is the direction light travels */
+	void update(const cxMtx& invView, const float tanX, const float tanY, const float znear, const float zfar, const cxVec& lightDir);
+	/* fills the per-cascade lists with the indices of boxes that may cast into the cascade */
+	void cull(const cxAABB* pBoxes, const int n, cxBrigade* pBgd = nullptr);
+
+	void set_caster_margin(const float margin) { mCasterMargin = nxCalc::max(margin, 0.0f); }
+
+	int get_num() const { return mNum; }
+	int get_map_size() const { return mMapSize; }
+	const Cascade* get_cascade(const int i) const { return (i >= 0 && i < mNum) ? &mCascades[i] : nullptr; }
+	int get_casters_num(const int i) const { return (i >= 0 && i < mNum) ? mListNum[i] : 0; }
+	const int32_t* get_casters(const int i) const { return (i >= 0 && i < mNum) ? mpLists[i] : nullptr; }
+	/* bit i set: the box may cast into cascade i, valid after cull() */
+	uint32_t get_caster_mask(const int idx) const { return (mpMasks && idx >= 0 && idx < mItemsNum) ? mpMasks[idx] : 0; }
+	/* cascade that receives at pos (the first one whose slice holds its view depth), -1 past the last one */
+	int find_cascade(const cxVec& pos) const;
+
+	static float calc_split(const int i, const int num, const float znear, const float zfar, const float lambda);
+	static bool box_in_cascade(const cxAABB& box, const Cascade& csc);
+};
+
+} // ShadowCSM
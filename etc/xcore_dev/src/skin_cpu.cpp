@@ -0,0 +1,581 @@
+#include "crosscore.hpp"
+#include "skin_cpu.hpp"
+
+/* the AVX kernels are compiled for any x86 target and picked at run time, so builds without /arch:AVX or -mavx use them too */
+#ifndef SKIN_CPU_SIMD
+#	if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#		define SKIN_CPU_SIMD 1
+#	else
+#		define SKIN_CPU_SIMD 0
+#	endif
+#endif
+
+#if SKIN_CPU_SIMD
+#	include <immintrin.h>
+#	if defined(_MSC_VER)
+#		include <intrin.h>
+#		define SKIN_CPU_AVX_FN
+#	else
+#		define SKIN_CPU_AVX_FN __attribute__((target("avx")))
+#	endif
+#endif
+
+namespace SkinCPU {
+
+bool Input::alloc(const int nvtx, const int njnt, const bool withNormals) {
+	reset();
+	if (nvtx <= 0) return false;
+	mpPos = (float*)nxCore::mem_alloc(nvtx * 3 * sizeof(float), "SkinCPU:Pos");
+	if (withNormals) {
+		mpNrm = (float*)nxCore::mem_alloc(nvtx * 3 * sizeof(float), "SkinCPU:Nrm");
+	}
+	mpWgt = (float*)nxCore::mem_alloc(nvtx * 4 * sizeof(float), "SkinCPU:Wgt");
+	mpJnt = (int32_t*)nxCore::mem_alloc(nvtx * 4 * sizeof(int32_t), "SkinCPU:Jnt");
+	if (!mpPos || !mpWgt || !mpJnt || (withNormals && !mpNrm)) {
+		reset();
+		return false;
+	}
+	for (int i = 0; i < nvtx; ++i) {
+		float* pWgt = &mpWgt[i * 4];
+		int32_t* pJnt = &mpJnt[i * 4];
+		pWgt[0] = 1.0f;
+		pJnt[0] = 0;
+		for (int j = 1; j < 4; ++j) {
+			pWgt[j] = 0.0f;
+			pJnt[j] = 0;
+		}
+	}
+	mVtxNum = nvtx;
+	mJntNum = njnt;
+	return true;
+}
+
+void Input::reset() {
+	nxCore::mem_free(mpPos);
+	mpPos = nullptr;
+	nxCore::mem_free(mpNrm);
+	mpNrm = nullptr;
+	nxCore::mem_free(mpWgt);
+	mpWgt = nullptr;
+	nxCore::mem_free(mpJnt);
+	mpJnt = nullptr;
+	mVtxNum = 0;
+	mJntNum = 0;
+}
+
+static inline bool ck_idx_range(const int idx, const int n) { return uint32_t(idx) < uint32_t(n); }
+
+/* keeps the 4 largest influences sorted by weight */
+static void add_influence(float* pWgt, int32_t* pJnt, int& cnt, const float w, const int jnt) {
+	if (w <= 0.0f) return;
+	int pos = cnt;
+	while (pos > 0 && pWgt[pos - 1] < w) {
+		if (pos < 4) {
+			pWgt[pos] = pWgt[pos - 1];
+			pJnt[pos] = pJnt[pos - 1];
+		}
+		--pos;
+	}
+	if (pos < 4) {
+		pWgt[pos] = w;
+		pJnt[pos] = jnt;
+		if (cnt < 4) ++cnt;
+	}
+}
+
+static void finish_influences(float* pWgt, int32_t* pJnt, const int cnt) {
+	float sum = 0.0f;
+	for (int i = 0; i < cnt; ++i) {
+		sum += pWgt[i];
+	}
+	if (cnt > 0 && sum > 0.0f) {
+		float s = 1.0f / sum;
+		for (int i = 0; i < 4; ++i) {
+			if (i < cnt) {
+				pWgt[i] *= s;
+			} else {
+				pWgt[i] = 0.0f;
+				pJnt[i] = pJnt[0];
+			}
+		}
+	} else {
+		pWgt[0] = 1.0f;
+		pJnt[0] = 0;
+		for (int i = 1; i < 4; ++i) {
+			pWgt[i] = 0.0f;
+			pJnt[i] = 0;
+		}
+	}
+}
+
+bool Input::from_geometry(const sxGeometryData* pGeo, const bool withNormals) {
+	reset();
+	if (!pGeo || !pGeo->has_skin()) return false;
+	int npnt = pGeo->get_pnt_num();
+	int njnt = pGeo->get_skin_nodes_num();
+	bool nrmFlg = withNormals && pGeo->find_pnt_attr("N") >= 0;
+	if (!alloc(npnt, njnt, nrmFlg)) return false;
+	for (int i = 0; i < npnt; ++i) {
+		pGeo->get_pnt(i).to_mem(&mpPos[i * 3]);
+		if (mpNrm) {
+			pGeo->get_pnt_normal(i).to_mem(&mpNrm[i * 3]);
+		}
+		float* pWgt = &mpWgt[i * 4];
+		int32_t* pJnt = &mpJnt[i * 4];
+		int cnt = 0;
+		int nwgt = pGeo->get_pnt_wgt_num(i);
+		for (int j = 0; j < nwgt; ++j) {
+			int jnt = pGeo->get_pnt_skin_jnt(i, j);
+			if (ck_idx_range(jnt, njnt)) {
+				add_influence(pWgt, pJnt, cnt, pGeo->get_pnt_skin_wgt(i, j), jnt);
+			}
+		}
+		finish_influences(pWgt, pJnt, cnt);
+	}
+	return true;
+}
+
+bool Input::from_model(const sxModelData* pMdl, const bool withNormals) {
+	reset();
+	if (!pMdl || !pMdl->has_skin()) return false;
+	int npnt = pMdl->mPntNum;
+	int njnt = pMdl->mSknNum;
+	if (!alloc(npnt, njnt, withNormals)) return false;
+	for (int i = 0; i < npnt; ++i) {
+		pMdl->get_pnt_pos(i).to_mem(&mpPos[i * 3]);
+		if (mpNrm) {
+			pMdl->get_pnt_nrm(i).to_mem(&mpNrm[i * 3]);
+		}
+	}
+	/* vertex joint indices are local to the batch that owns the vertex */
+	int nbat = pMdl->mBatNum;
+	for (int ibat = 0; ibat < nbat; ++ibat) {
+		const sxModelData::Batch* pBat = pMdl->get_batch_ptr(ibat);
+		const int32_t* pLst = pMdl->get_batch_jnt_list(ibat);
+		if (!pBat || !pLst) continue;
+		for (int i = pBat->mMinIdx; i <= pBat->mMaxIdx; ++i) {
+			if (!pMdl->ck_pid(i)) continue;
+			sxModelData::PntSkin skn = pMdl->get_pnt_skin(i);
+			float* pWgt = &mpWgt[i * 4];
+			int32_t* pJnt = &mpJnt[i * 4];
+			int cnt = 0;
+			for (int j = 0; j < skn.num; ++j) {
+				if (ck_idx_range(skn.idx[j], pBat->mJntNum)) {
+					int iskn = pLst[skn.idx[j]];
+					if (pMdl->ck_skin_id(iskn)) {
+						add_influence(pWgt, pJnt, cnt, skn.wgt[j], iskn);
+					}
+				}
+			}
+			finish_influences(pWgt, pJnt, cnt);
+		}
+	}
+	return true;
+}
+
+
+bool Palette::alloc(const int n) {
+	if (n == mNum && mpXforms && mpDQs) return true;
+	reset();
+	if (n <= 0) return false;
+	mpXforms = (xt_xmtx*)nxCore::mem_alloc(n * sizeof(xt_xmtx), "SkinCPU:Xforms");
+	mpDQs = (cxDualQuat*)nxCore::mem_alloc(n * sizeof(cxDualQuat), "SkinCPU:DQs");
+	if (!mpXforms || !mpDQs) {
+		reset();
+		return false;
+	}
+	mNum = n;
+	for (int i = 0; i < n; ++i) {
+		mpXforms[i].identity();
+	}
+	calc_dual_quats();
+	return true;
+}
+
+void Palette::reset() {
+	nxCore::mem_free(mpXforms);
+	mpXforms = nullptr;
+	nxCore::mem_free(mpDQs);
+	mpDQs = nullptr;
+	mNum = 0;
+}
+
+void Palette::set(const xt_xmtx* pXforms, const int n) {
+	if (!pXforms || !alloc(n)) return;
+	::memcpy(mpXforms, pXforms, n * sizeof(xt_xmtx));
+	calc_dual_quats();
+}
+
+void Palette::set(const cxMtx* pMtx, const int n) {
+	if (!pMtx || !alloc(n)) return;
+	for (int i = 0; i < n; ++i) {
+		mpXforms[i] = nxMtx::xmtx_from_mtx(pMtx[i]);
+	}
+	calc_dual_quats();
+}
+
+void Palette::set(const cxModelWork* pWk) {
+	if (!pWk || !pWk->mpData || !pWk->mpSkinXforms) return;
+	set(pWk->mpSkinXforms, pWk->mpData->mSknNum);
+}
+
+void Palette::calc_dual_quats() {
+	if (!mpXforms || !mpDQs) return;
+	for (int i = 0; i < mNum; ++i) {
+		cxMtx m = nxMtx::mtx_from_xmtx(mpXforms[i]);
+		cxVec pos = m.get_translation();
+		/* strip scale before extracting the rotation */
+		cxMtx r;
+		r.set_rot_frame(m.get_row_vec(0).get_normalized(), m.get_row_vec(1).get_normalized(), m.get_row_vec(2).get_normalized());
+		cxQuat q;
+		q.from_mtx(r);
+		q.normalize();
+		mpDQs[i].set(q, pos);
+	}
+}
+
+
+static inline void store_nrm(float* pDst, float x, float y, float z) {
+	float s = nxCalc::rcp0(::sqrtf(x*x + y*y + z*z));
+	pDst[0] = x * s;
+	pDst[1] = y * s;
+	pDst[2] = z * s;
+}
+
+static void skin_linear(const Input& in, const Palette& pal, float* pDstPos, float* pDstNrm, const int org, const int num) {
+	const float* pXforms = pal.mpXforms[0];
+	for (int i = org; i < org + num; ++i) {
+		const float* pWgt = &in.mpWgt[i * 4];
+		const int32_t* pJnt = &in.mpJnt[i * 4];
+		const float* pPos = &in.mpPos[i * 3];
+		const float* pNrm = pDstNrm && in.mpNrm ? &in.mpNrm[i * 3] : nullptr;
+		float m[12];
+		const float* pX = &pXforms[pJnt[0] * 12];
+		float w = pWgt[0];
+		for (int k = 0; k < 12; ++k) {
+			m[k] = pX[k] * w;
+		}
+		for (int j = 1; j < 4; ++j) {
+			w = pWgt[j];
+			if (w != 0.0f) {
+				pX = &pXforms[pJnt[j] * 12];
+				for (int k = 0; k < 12; ++k) {
+					m[k] += pX[k] * w;
+				}
+			}
+		}
+		float x = pPos[0];
+		float y = pPos[1];
+		float z = pPos[2];
+		float* pDst = &pDstPos[i * 3];
+		pDst[0] = x*m[0] + y*m[1] + z*m[2] + m[3];
+		pDst[1] = x*m[4] + y*m[5] + z*m[6] + m[7];
+		pDst[2] = x*m[8] + y*m[9] + z*m[10] + m[11];
+		if (pNrm) {
+			x = pNrm[0];
+			y = pNrm[1];
+			z = pNrm[2];
+			store_nrm(&pDstNrm[i * 3], x*m[0] + y*m[1] + z*m[2], x*m[4] + y*m[5] + z*m[6], x*m[8] + y*m[9] + z*m[10]);
+		}
+	}
+}
+
+/* b: blended dual quaternion, normalized here */
+static inline void dq_xform(const float* b, const float* pPos, const float* pNrm, float* pDstPos, float* pDstNrm) {
+	float s = nxCalc::rcp0(::sqrtf(b[0]*b[0] + b[1]*b[1] + b[2]*b[2] + b[3]*b[3]));
+	float rx = b[0] * s;
+	float ry = b[1] * s;
+	float rz = b[2] * s;
+	float rw = b[3] * s;
+	float dx = b[4] * s;
+	float dy = b[5] * s;
+	float dz = b[6] * s;
+	float dw = b[7] * s;
+	/* t = 2 * vec(d * conj(r)) */
+	float tx = 2.0f * (rw*dx - dw*rx + ry*dz - rz*dy);
+	float ty = 2.0f * (rw*dy - dw*ry + rz*dx - rx*dz);
+	float tz = 2.0f * (rw*dz - dw*rz + rx*dy - ry*dx);
+	/* v' = v + 2 * r x (r x v + w*v) */
+	float x = pPos[0];
+	float y = pPos[1];
+	float z = pPos[2];
+	float cx = ry*z - rz*y + rw*x;
+	float cy = rz*x - rx*z + rw*y;
+	float cz = rx*y - ry*x + rw*z;
+	pDstPos[0] = x + 2.0f*(ry*cz - rz*cy) + tx;
+	pDstPos[1] = y + 2.0f*(rz*cx - rx*cz) + ty;
+	pDstPos[2] = z + 2.0f*(rx*cy - ry*cx) + tz;
+	if (pNrm) {
+		x = pNrm[0];
+		y = pNrm[1];
+		z = pNrm[2];
+		cx = ry*z - rz*y + rw*x;
+		cy = rz*x - rx*z + rw*y;
+		cz = rx*y - ry*x + rw*z;
+		store_nrm(pDstNrm, x + 2.0f*(ry*cz - rz*cy), y + 2.0f*(rz*cx - rx*cz), z + 2.0f*(rx*cy - ry*cx));
+	}
+}
+
+static void skin_dual_quat(const Input& in, const Palette& pal, float* pDstPos, float* pDstNrm, const int org, const int num) {
+	const float* pDQs = reinterpret_cast<const float*>(pal.mpDQs);
+	for (int i = org; i < org + num; ++i) {
+		const float* pWgt = &in.mpWgt[i * 4];
+		const int32_t* pJnt = &in.mpJnt[i * 4];
+		const float* pNrm = pDstNrm && in.mpNrm ? &in.mpNrm[i * 3] : nullptr;
+		const float* pDQ0 = &pDQs[pJnt[0] * 8];
+		float b[8];
+		float w = pWgt[0];
+		for (int k = 0; k < 8; ++k) {
+			b[k] = pDQ0[k] * w;
+		}
+		for (int j = 1; j < 4; ++j) {
+			w = pWgt[j];
+			if (w != 0.0f) {
+				const float* pDQ = &pDQs[pJnt[j] * 8];
+				if (pDQ0[0]*pDQ[0] + pDQ0[1]*pDQ[1] + pDQ0[2]*pDQ[2] + pDQ0[3]*pDQ[3] < 0.0f) {
+					w = -w;
+				}
+				for (int k = 0; k < 8; ++k) {
+					b[k] += pDQ[k] * w;
+				}
+			}
+		}
+		dq_xform(b, &in.mpPos[i * 3], pNrm, &pDstPos[i * 3], pNrm ? &pDstNrm[i * 3] : nullptr);
+	}
+}
+
+#if SKIN_CPU_SIMD
+SKIN_CPU_AVX_FN static void skin_linear_avx(const Input& in, const Palette& pal, float* pDstPos, float* pDstNrm, const int org, const int num) {
+	const float* pXforms = pal.mpXforms[0];
+	for (int i = org; i < org + num; ++i) {
+		const float* pWgt = &in.mpWgt[i * 4];
+		const int32_t* pJnt = &in.mpJnt[i * 4];
+		const float* pPos = &in.mpPos[i * 3];
+		const float* pNrm = pDstNrm && in.mpNrm ? &in.mpNrm[i * 3] : nullptr;
+		const float* pX = &pXforms[pJnt[0] * 12];
+		__m256 w = _mm256_set1_ps(pWgt[0]);
+		__m256 m01 = _mm256_mul_ps(w, _mm256_loadu_ps(pX));
+		__m128 m2 = _mm_mul_ps(_mm256_castps256_ps128(w), _mm_loadu_ps(pX + 8));
+		for (int j = 1; j < 4; ++j) {
+			if (pWgt[j] != 0.0f) {
+				pX = &pXforms[pJnt[j] * 12];
+				w = _mm256_set1_ps(pWgt[j]);
+				m01 = _mm256_add_ps(m01, _mm256_mul_ps(w, _mm256_loadu_ps(pX)));
+				m2 = _mm_add_ps(m2, _mm_mul_ps(_mm256_castps256_ps128(w), _mm_loadu_ps(pX + 8)));
+			}
+		}
+		__m128 v = _mm_set_ps(1.0f, pPos[2], pPos[1], pPos[0]);
+		__m256 v01 = _mm256_insertf128_ps(_mm256_castps128_ps256(v), v, 1);
+		__m256 t01 = _mm256_mul_ps(m01, v01);
+		__m128 t2 = _mm_mul_ps(m2, v);
+		__m128 s01 = _mm_hadd_ps(_mm256_castps256_ps128(t01), _mm256_extractf128_ps(t01, 1));
+		__m128 s = _mm_hadd_ps(s01, _mm_hadd_ps(t2, t2));
+		float res[4];
+		_mm_storeu_ps(res, s);
+		float* pDst = &pDstPos[i * 3];
+		pDst[0] = res[0];
+		pDst[1] = res[1];
+		pDst[2] = res[2];
+		if (pNrm) {
+			v = _mm_set_ps(0.0f, pNrm[2], pNrm[1], pNrm[0]);
+			v01 = _mm256_insertf128_ps(_mm256_castps128_ps256(v), v, 1);
+			t01 = _mm256_mul_ps(m01, v01);
+			t2 = _mm_mul_ps(m2, v);
+			s01 = _mm_hadd_ps(_mm256_castps256_ps128(t01), _mm256_extractf128_ps(t01, 1));
+			s = _mm_hadd_ps(s01, _mm_hadd_ps(t2, t2));
+			_mm_storeu_ps(res, s);
+			store_nrm(&pDstNrm[i * 3], res[0], res[1], res[2]);
+		}
+	}
+	_mm256_zeroupper();
+}
+
+SKIN_CPU_AVX_FN static void skin_dual_quat_avx(const Input& in, const Palette& pal, float* pDstPos, float* pDstNrm, const int org, const int num) {
+	const float* pDQs = reinterpret_cast<const float*>(pal.mpDQs);
+	for (int i = org; i < org + num; ++i) {
+		const float* pWgt = &in.mpWgt[i * 4];
+		const int32_t* pJnt = &in.mpJnt[i * 4];
+		const float* pNrm = pDstNrm && in.mpNrm ? &in.mpNrm[i * 3] : nullptr;
+		const float* pDQ0 = &pDQs[pJnt[0] * 8];
+		float b[8];
+		__m256 dq = _mm256_mul_ps(_mm256_set1_ps(pWgt[0]), _mm256_loadu_ps(pDQ0));
+		for (int j = 1; j < 4; ++j) {
+			float w = pWgt[j];
+			if (w != 0.0f) {
+				const float* pDQ = &pDQs[pJnt[j] * 8];
+				if (pDQ0[0]*pDQ[0] + pDQ0[1]*pDQ[1] + pDQ0[2]*pDQ[2] + pDQ0[3]*pDQ[3] < 0.0f) {
+					w = -w;
+				}
+				dq = _mm256_add_ps(dq, _mm256_mul_ps(_mm256_set1_ps(w), _mm256_loadu_ps(pDQ)));
+			}
+		}
+		_mm256_storeu_ps(b, dq);
+		dq_xform(b, &in.mpPos[i * 3], pNrm, &pDstPos[i * 3], pNrm ? &pDstNrm[i * 3] : nullptr);
+	}
+	_mm256_zeroupper();
+}
+
+/* CPUID reports AVX and the OS saves the YMM registers (OSXSAVE, XCR0 bits 1 and 2) */
+static bool ck_avx() {
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0) return false;
+	return (_xgetbv(0) & 6) == 6;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx") != 0;
+#endif
+}
+#endif
+
+bool avx_enabled() {
+#if SKIN_CPU_SIMD
+	static const bool s_avx = ck_avx();
+	return s_avx;
+#else
+	return false;
+#endif
+}
+
+void exec_range(const Input& in, const Palette& pal, const Mode mode, float* pDstPos, float* pDstNrm, const int org, const int num) {
+	if (!in.is_valid() || !pDstPos || num <= 0) return;
+	if (!pal.mpXforms || !pal.mpDQs || in.mJntNum > pal.mNum) return;
+	if (org < 0 || org + num > in.mVtxNum) return;
+#if SKIN_CPU_SIMD
+	if (avx_enabled()) {
+		if (mode == Mode::DUAL_QUAT) {
+			skin_dual_quat_avx(in, pal, pDstPos, pDstNrm, org, num);
+		} else {
+			skin_linear_avx(in, pal, pDstPos, pDstNrm, org, num);
+		}
+		return;
+	}
+#endif
+	if (mode == Mode::DUAL_QUAT) {
+		skin_dual_quat(in, pal, pDstPos, pDstNrm, org, num);
+	} else {
+		skin_linear(in, pal, pDstPos, pDstNrm, org, num);
+	}
+}
+
+void exec_range_ref(const Input& in, const Palette& pal, const Mode mode, float* pDstPos, float* pDstNrm, const int org, const int num) {
+	if (!in.is_valid() || !pDstPos || num <= 0) return;
+	if (!pal.mpXforms || !pal.mpDQs || in.mJntNum > pal.mNum) return;
+	if (org < 0 || org + num > in.mVtxNum) return;
+	for (int i = org; i < org + num; ++i) {
+		const float* pWgt = &in.mpWgt[i * 4];
+		const int32_t* pJnt = &in.mpJnt[i * 4];
+		cxVec pos;
+		pos.from_mem(&in.mpPos[i * 3]);
+		cxVec nrm(0.0f);
+		if (in.mpNrm) {
+			nrm.from_mem(&in.mpNrm[i * 3]);
+		}
+		cxVec spos(0.0f);
+		cxVec snrm(0.0f);
+		if (mode == Mode::DUAL_QUAT) {
+			cxQuat qr;
+			cxQuat qd;
+			qr.zero();
+			qd.zero();
+			cxQuat qr0 = pal.mpDQs[pJnt[0]].get_real_part();
+			for (int j = 0; j < 4; ++j) {
+				float w = pWgt[j];
+				if (w == 0.0f) continue;
+				cxQuat r = pal.mpDQs[pJnt[j]].get_real_part();
+				cxQuat d = pal.mpDQs[pJnt[j]].get_dual_part();
+				if (qr0.dot(r) < 0.0f) {
+					w = -w;
+				}
+				qr.add(r * w);
+				qd.add(d * w);
+			}
+			cxDualQuat dq = nxDualQuat::from_parts(qr, qd);
+			dq.normalize(true);
+			spos = dq.calc_pnt(pos);
+			snrm = dq.calc_vec(nrm);
+		} else {
+			for (int j = 0; j < 4; ++j) {
+				float w = pWgt[j];
+				if (w == 0.0f) continue;
+				spos += nxMtx::xmtx_calc_pnt(pal.mpXforms[pJnt[j]], pos) * w;
+				snrm += nxMtx::xmtx_calc_vec(pal.mpXforms[pJnt[j]], nrm) * w;
+			}
+		}
+		spos.to_mem(&pDstPos[i * 3]);
+		if (pDstNrm && in.mpNrm) {
+			snrm.normalize();
+			snrm.to_mem(&pDstNrm[i * 3]);
+		}
+	}
+}
+
+
+void Work::skin_job(const sxJobContext* pCtx) {
+	if (!pCtx) return;
+	sxJob* pJob = pCtx->mpJob;
+	if (!pJob) return;
+	JobInfo* pInfo = (JobInfo*)pJob->mpData;
+	if (!pInfo) return;
+	exec_range(*pInfo->mpIn, *pInfo->mpPal, pInfo->mMode, pInfo->mpDstPos, pInfo->mpDstNrm, pInfo->mOrg, pInfo->mNum);
+}
+
+void Work::init(const int maxJobs) {
+	reset();
+	if (maxJobs <= 0) return;
+	mpQue = nxTask::queue_create(maxJobs);
+	mpJobs = (sxJob*)nxCore::mem_alloc(maxJobs * sizeof(sxJob), "SkinCPU:Jobs");
+	mpJobInfo = (JobInfo*)nxCore::mem_alloc(maxJobs * sizeof(JobInfo), "SkinCPU:JobInfo");
+	if (!mpQue || !mpJobs || !mpJobInfo) {
+		reset();
+		return;
+	}
+	::memset(mpJobs, 0, maxJobs * sizeof(sxJob));
+	mJobsMax = maxJobs;
+}
+
+void Work::reset() {
+	if (mpQue) {
+		nxTask::queue_destroy(mpQue);
+		mpQue = nullptr;
+	}
+	nxCore::mem_free(mpJobs);
+	mpJobs = nullptr;
+	nxCore::mem_free(mpJobInfo);
+	mpJobInfo = nullptr;
+	mJobsMax = 0;
+}
+
+void Work::exec(const Input& in, const Palette& pal, const Mode mode, float* pDstPos, float* pDstNrm, cxBrigade* pBgd, const int chunkSize) {
+	int nvtx = in.mVtxNum;
+	if (nvtx <= 0) return;
+	int chunk = nxCalc::max(chunkSize, 1);
+	int njob = (nvtx + chunk - 1) / chunk;
+	if (!pBgd || !mpQue || njob < 2) {
+		exec_range(in, pal, mode, pDstPos, pDstNrm, 0, nvtx);
+		return;
+	}
+	if (njob > mJobsMax) {
+		chunk = (nvtx + mJobsMax - 1) / mJobsMax;
+		njob = (nvtx + chunk - 1) / chunk;
+	}
+	nxTask::queue_purge(mpQue);
+	for (int i = 0; i < njob; ++i) {
+		JobInfo* pInfo = &mpJobInfo[i];
+		pInfo->mpIn = &in;
+		pInfo->mpPal = &pal;
+		pInfo->mpDstPos = pDstPos;
+		pInfo->mpDstNrm = pDstNrm;
+		pInfo->mMode = mode;
+		pInfo->mOrg = i * chunk;
+		pInfo->mNum = nxCalc::min(chunk, nvtx - pInfo->mOrg);
+		sxJob* pJob = &mpJobs[i];
+		pJob->mFunc = skin_job;
+		pJob->mpData = pInfo;
+		nxTask::queue_add(mpQue, pJob);
+	}
+	nxTask::queue_exec(mpQue, pBgd);
+}
+
+} // SkinCPU
@@ -0,0 +1,83 @@
+namespace SkinCPU {
+
+enum class Mode {
+	LINEAR = 0,
+	DUAL_QUAT = 1
+};
+
+struct Input {
+	float* mpPos;   /* xyz per vertex */
+	float* mpNrm;   /* xyz per vertex, optional */
+	float* mpWgt;   /* 4 per vertex, normalized, unused slots are 0 */
+	int32_t* mpJnt; /* 4 per vertex, skin node ids */
+	int mVtxNum;
+	int mJntNum;
+
+	Input() : mpPos(nullptr), mpNrm(nullptr), mpWgt(nullptr), mpJnt(nullptr), mVtxNum(0), mJntNum(0) {}
+	~Input() { reset(); }
+
+	bool is_valid() const { return mpPos && mpWgt && mpJnt && mVtxNum > 0; }
+	bool has_normals() const { return mpNrm != nullptr; }
+
+	bool alloc(const int nvtx, const int njnt, const bool withNormals);
+	void reset();
+
+	bool from_geometry(const sxGeometryData* pGeo, const bool withNormals = true);
+	bool from_model(const sxModelData* pMdl, const bool withNormals = true);
+};
+
+struct Palette {
+	xt_xmtx* mpXforms;  /* skin space -> world */
+	cxDualQuat* mpDQs;  /* same transforms as rigid dual quaternions, scale is dropped */
+	int mNum;
+
+	Palette() : mpXforms(nullptr), mpDQs(nullptr), mNum(0) {}
+	~Palette() { reset(); }
+
+	bool ck_idx(const int idx) const { return uint32_t(idx) < uint32_t(mNum); }
+
+	bool alloc(const int n);
+	void reset();
+
+	void set(const xt_xmtx* pXforms, const int n);
+	void set(const cxMtx* pMtx, const int n);
+	void set(const cxModelWork* pWk);
+	void calc_dual_quats();
+};
+
+/* true when exec_range() runs the AVX kernels, checked once on the running CPU */
+bool avx_enabled();
+
+void exec_range(const Input& in, const Palette& pal, const Mode mode, float* pDstPos, float* pDstNrm, const int org, const int num);
+void exec_range_ref(const Input& in, const Palette& pal, const Mode mode, float* pDstPos, float* pDstNrm, const int org, const int num);
+
+class Work {
+protected:
+	struct JobInfo {
+		const Input* mpIn;
+		const Palette* mpPal;
+		float* mpDstPos;
+		float* mpDstNrm;
+		Mode mMode;
+		int mOrg;
+		int mNum;
+	};
+
+	sxJobQueue* mpQue;
+	sxJob* mpJobs;
+	JobInfo* mpJobInfo;
+	int mJobsMax;
+
+	static void skin_job(const sxJobContext* pCtx);
+
+public:
+	Work() : mpQue(nullptr), mpJobs(nullptr), mpJobInfo(nullptr), mJobsMax(0) {}
+	~Work() { reset(); }
+
+	void init(const int maxJobs);
+	void reset();
+
+	void exec(const Input& in, const Palette& pal, const Mode mode, float* pDstPos, float* pDstNrm = nullptr, cxBrigade* pBgd = nullptr, const int chunkSize = 1024);
+};
+
+} // SkinCPU
@@ -0,0 +1,265 @@
+#include "crosscore.hpp"
+#include "scene.hpp"
+#include "sph_grid.hpp"
+
+namespace SphGrid {
+
+void Grid::init(const int maxAgents, const int maxJobs) {
+	reset();
+	if (maxAgents <= 0) return;
+	mAgentsMax = maxAgents;
+	mTblSize = 1;
+	while (mTblSize < maxAgents * 2) {
+		mTblSize <<= 1;
+	}
+	mpSph = (cxSphere*)nxCore::mem_alloc(maxAgents * sizeof(cxSphere), "SphGrid:Sph");
+	mpCell = (int32_t*)nxCore::mem_alloc(maxAgents * 3 * sizeof(int32_t), "SphGrid:Cell");
+	mpBucketOrg = (int32_t*)nxCore::mem_alloc((mTblSize + 1) * sizeof(int32_t), "SphGrid:BucketOrg");
+	mpBucketLst = (int32_t*)nxCore::mem_alloc(maxAgents * sizeof(int32_t), "SphGrid:BucketLst");
+	mpNbrOrg = (int32_t*)nxCore::mem_alloc((maxAgents + 1) * sizeof(int32_t), "SphGrid:NbrOrg");
+	mpNbrNum = (int32_t*)nxCore::mem_alloc(maxAgents * sizeof(int32_t), "SphGrid:NbrNum");
+	if (!mpSph || !mpCell || !mpBucketOrg || !mpBucketLst || !mpNbrOrg || !mpNbrNum || !realloc_nbrs(maxAgents * 8)) {
+		reset();
+		return;
+	}
+	mpNbrOrg[0] = 0;
+	if (maxJobs > 1) {
+		mpQue = nxTask::queue_create(maxJobs);
+		mpJobs = (sxJob*)nxCore::mem_alloc(maxJobs * sizeof(sxJob), "SphGrid:Jobs");
+		mpJobInfo = (JobInfo*)nxCore::mem_alloc(maxJobs * sizeof(JobInfo), "SphGrid:JobInfo");
+		if (mpQue && mpJobs && mpJobInfo) {
+			::memset(mpJobs, 0, maxJobs * sizeof(sxJob));
+			mJobsMax = maxJobs;
+		} else {
+			if (mpQue) {
+				nxTask::queue_destroy(mpQue);
+				mpQue = nullptr;
+			}
+			nxCore::mem_free(mpJobs);
+			mpJobs = nullptr;
+			nxCore::mem_free(mpJobInfo);
+			mpJobInfo = nullptr;
+		}
+	}
+}
+
+void Grid::reset() {
+	nxCore::mem_free(mpSph);
+	mpSph = nullptr;
+	nxCore::mem_free(mpCell);
+	mpCell = nullptr;
+	nxCore::mem_free(mpBucketOrg);
+	mpBucketOrg = nullptr;
+	nxCore::mem_free(mpBucketLst);
+	mpBucketLst = nullptr;
+	nxCore::mem_free(mpNbrOrg);
+	mpNbrOrg = nullptr;
+	nxCore::mem_free(mpNbrNum);
+	mpNbrNum = nullptr;
+	nxCore::mem_free(mpNbrLst);
+	mpNbrLst = nullptr;
+	if (mpQue) {
+		nxTask::queue_destroy(mpQue);
+		mpQue = nullptr;
+	}
+	nxCore::mem_free(mpJobs);
+	mpJobs = nullptr;
+	nxCore::mem_free(mpJobInfo);
+	mpJobInfo = nullptr;
+	mAgentsNum = 0;
+	mAgentsMax = 0;
+	mTblSize = 0;
+	mNbrMax = 0;
+	mPairsNum = 0;
+	mJobsMax = 0;
+}
+
+bool Grid::realloc_nbrs(const int nnbr) {
+	if (nnbr <= mNbrMax) return true;
+	nxCore::mem_free(mpNbrLst);
+	mpNbrLst = (int32_t*)nxCore::mem_alloc(nnbr * sizeof(int32_t), "SphGrid:NbrLst");
+	mNbrMax = mpNbrLst ? nnbr : 0;
+	return mpNbrLst != nullptr;
+}
+
+template<typename FUNC> void Grid::scan_nbrs(const int idx, FUNC& func) const {
+	const int32_t* pCell = &mpCell[idx * 3];
+	cxVec c = mpSph[idx].get_center();
+	float r = mpSph[idx].get_radius() + mMargin;
+	for (int dz = -1; dz <= 1; ++dz) {
+		for (int dy = -1; dy <= 1; ++dy) {
+			for (int dx = -1; dx <= 1; ++dx) {
+				int32_t ix = pCell[0] + dx;
+				int32_t iy = pCell[1] + dy;
+				int32_t iz = pCell[2] + dz;
+				uint32_t bkt = calc_bucket(ix, iy, iz);
+				int end = mpBucketOrg[bkt + 1];
+				for (int k = mpBucketOrg[bkt]; k < end; ++k) {
+					int j = mpBucketLst[k];
+					if (j == idx) continue;
+					const int32_t* pNbrCell = &mpCell[j * 3];
+					if (pNbrCell[0] != ix || pNbrCell[1] != iy || pNbrCell[2] != iz) continue;
+					float rr = r + mpSph[j].get_radius();
+					if (nxVec::dist2(c, mpSph[j].get_center()) <= rr*rr) {
+						func(j);
+					}
+				}
+			}
+		}
+	}
+}
+
+struct NbrCounter {
+	int mCount;
+	void operator()(const int j) { ++mCount; }
+};
+
+struct NbrWriter {
+	int32_t* mpDst;
+	int mCount;
+	void operator()(const int j) {
+		int k = mCount++;
+		while (k > 0 && mpDst[k - 1] > j) {
+			mpDst[k] = mpDst[k - 1];
+			--k;
+		}
+		mpDst[k] = j;
+	}
+};
+
+void Grid::exec_range(const int org, const int num) {
+	const ResolveParams& prm = mResolve;
+	for (int i = org; i < org + num; ++i) {
+		switch (mPhase) {
+			case Phase::COUNT: {
+				NbrCounter cnt;
+				cnt.mCount = 0;
+				scan_nbrs(i, cnt);
+				mpNbrNum[i] = cnt.mCount;
+				break;
+			}
+			case Phase::FILL: {
+				NbrWriter wr;
+				wr.mpDst = &mpNbrLst[mpNbrOrg[i]];
+				wr.mCount = 0;
+				scan_nbrs(i, wr);
+				break;
+			}
+			case Phase::RESOLVE: {
+				cxVec pos = prm.mpNewPos[i];
+				const int32_t* pNbr = &mpNbrLst[mpNbrOrg[i]];
+				int n = mpNbrOrg[i + 1] - mpNbrOrg[i];
+				for (int k = 0; k < n; ++k) {
+					int j = pNbr[k];
+					cxVec adjPos;
+					if (Scene::sph_sph_adj(pos, prm.mpOldPos[i], prm.mpRadius[i], prm.mpNewPos[j], prm.mpRadius[j], &adjPos, prm.mReflectFactor, prm.mMargin)) {
+						pos = adjPos;
+					}
+				}
+				prm.mpAdjPos[i] = pos;
+				break;
+			}
+		}
+	}
+}
+
+void Grid::phase_job(const sxJobContext* pCtx) {
+	if (!pCtx) return;
+	sxJob* pJob = pCtx->mpJob;
+	if (!pJob) return;
+	JobInfo* pInfo = (JobInfo*)pJob->mpData;
+	if (!pInfo) return;
+	pInfo->mpGrid->exec_range(pInfo->mOrg, pInfo->mNum);
+}
+
+void Grid::exec_phase(const Phase phase, cxBrigade* pBgd) {
+	int n = mAgentsNum;
+	mPhase = phase;
+	if (!pBgd || !mpQue || n < mJobsMax * 16) {
+		exec_range(0, n);
+		return;
+	}
+	int chunk = (n + mJobsMax - 1) / mJobsMax;
+	nxTask::queue_purge(mpQue);
+	int njob = 0;
+	for (int org = 0; org < n; org += chunk) {
+		JobInfo* pInfo = &mpJobInfo[njob];
+		pInfo->mpGrid = this;
+		pInfo->mOrg = org;
+		pInfo->mNum = nxCalc::min(chunk, n - org);
+		sxJob* pJob = &mpJobs[njob];
+		pJob->mFunc = phase_job;
+		pJob->mpData = pInfo;
+		nxTask::queue_add(mpQue, pJob);
+		++njob;
+	}
+	nxTask::queue_exec(mpQue, pBgd);
+}
+
+void Grid::build(const cxSphere* pSph, const int num, const float margin, cxBrigade* pBgd, const float cellSize) {
+	mAgentsNum = 0;
+	mPairsNum = 0;
+	if (!pSph || num <= 0 || !mpSph) return;
+	int n = nxCalc::min(num, mAgentsMax);
+	mAgentsNum = n;
+	mMargin = nxCalc::max(margin, 0.0f);
+	float maxRad = 0.0f;
+	for (int i = 0; i < n; ++i) {
+		mpSph[i] = pSph[i];
+		maxRad = nxCalc::max(maxRad, pSph[i].get_radius());
+	}
+	float csize = nxCalc::max(cellSize, maxRad * 2.0f + mMargin, 1e-4f);
+	mInvCellSize = 1.0f / csize;
+
+	for (int i = 0; i <= mTblSize; ++i) {
+		mpBucketOrg[i] = 0;
+	}
+	for (int i = 0; i < n; ++i) {
+		cxVec c = mpSph[i].get_center() * mInvCellSize;
+		int32_t* pCell = &mpCell[i * 3];
+		pCell[0] = int32_t(::floorf(c.x));
+		pCell[1] = int32_t(::floorf(c.y));
+		pCell[2] = int32_t(::floorf(c.z));
+		++mpBucketOrg[calc_bucket(pCell[0], pCell[1], pCell[2])];
+	}
+	for (int i = 1; i < mTblSize; ++i) {
+		mpBucketOrg[i] += mpBucketOrg[i - 1];
+	}
+	mpBucketOrg[mTblSize] = n;
+	/* filled backwards, so bucket ends become bucket starts and every bucket lists agents in index order */
+	for (int i = n; --i >= 0;) {
+		const int32_t* pCell = &mpCell[i * 3];
+		mpBucketLst[--mpBucketOrg[calc_bucket(pCell[0], pCell[1], pCell[2])]] = i;
+	}
+
+	exec_phase(Phase::COUNT, pBgd);
+	mpNbrOrg[0] = 0;
+	for (int i = 0; i < n; ++i) {
+		mpNbrOrg[i + 1] = mpNbrOrg[i] + mpNbrNum[i];
+	}
+	int nnbr = mpNbrOrg[n];
+	if (!realloc_nbrs(nnbr)) {
+		mAgentsNum = 0;
+		return;
+	}
+	exec_phase(Phase::FILL, pBgd);
+	mPairsNum = nnbr / 2;
+}
+
+void Grid::resolve(const cxVec* pNewPos, const cxVec* pOldPos, const float* pRadius, const int num, cxVec* pAdjPos, cxBrigade* pBgd, const float reflectFactor, const float margin) {
+	if (!pNewPos || !pOldPos || !pRadius || !pAdjPos || !mpSph) return;
+	int n = nxCalc::min(num, mAgentsMax);
+	for (int i = 0; i < n; ++i) {
+		mpSph[i] = cxSphere(pNewPos[i], pRadius[i]);
+	}
+	build(mpSph, n, margin, pBgd);
+	mResolve.mpNewPos = pNewPos;
+	mResolve.mpOldPos = pOldPos;
+	mResolve.mpRadius = pRadius;
+	mResolve.mpAdjPos = pAdjPos;
+	mResolve.mReflectFactor = reflectFactor;
+	mResolve.mMargin = margin;
+	exec_phase(Phase::RESOLVE, pBgd);
+}
+
+} // SphGrid
@@ -0,0 +1,101 @@
+namespace SphGrid {
+
+/* Spatial hash broadphase for sphere agents: centers are binned into cells at least one diameter wide,
+   candidates come from the 27 surrounding cells; neighbor lists are in index order regardless of job count. */
+class Grid {
+protected:
+	enum class Phase {
+		COUNT,
+		FILL,
+		RESOLVE
+	};
+
+	struct JobInfo {
+		Grid* mpGrid;
+		int mOrg;
+		int mNum;
+	};
+
+	struct ResolveParams {
+		const cxVec* mpNewPos;
+		const cxVec* mpOldPos;
+		const float* mpRadius;
+		cxVec* mpAdjPos;
+		float mReflectFactor;
+		float mMargin;
+	};
+
+	cxSphere* mpSph;
+	int32_t* mpCell;
+	int32_t* mpBucketOrg;
+	int32_t* mpBucketLst;
+	int32_t* mpNbrOrg;
+	int32_t* mpNbrNum;
+	int32_t* mpNbrLst;
+	sxJobQueue* mpQue;
+	sxJob* mpJobs;
+	JobInfo* mpJobInfo;
+	ResolveParams mResolve;
+	Phase mPhase;
+	float mInvCellSize;
+	float mMargin;
+	int mAgentsNum;
+	int mAgentsMax;
+	int mTblSize;
+	int mNbrMax;
+	int mPairsNum;
+	int mJobsMax;
+
+	uint32_t calc_bucket(const int32_t ix, const int32_t iy, const int32_t iz) const {
+		uint32_t h = uint32_t(ix) * 73856093U ^ uint32_t(iy) * 19349663U ^ uint32_t(iz) * 83492791U;
+		return h & uint32_t(mTblSize - 1);
+	}
+
+	template<typename FUNC> void scan_nbrs(const int idx, FUNC& func) const;
+	void exec_range(const int org, const int num);
+	void exec_phase(const Phase phase, cxBrigade* pBgd);
+	bool realloc_nbrs(const int nnbr);
+
+	static void phase_job(const sxJobContext* pCtx);
+
+public:
+	Grid()
+	: mpSph(nullptr), mpCell(nullptr), mpBucketOrg(nullptr), mpBucketLst(nullptr),
+	mpNbrOrg(nullptr), mpNbrNum(nullptr), mpNbrLst(nullptr), mpQue(nullptr), mpJobs(nullptr), mpJobInfo(nullptr),
+	mPhase(Phase::COUNT), mInvCellSize(0.0f), mMargin(0.0f),
+	mAgentsNum(0), mAgentsMax(0), mTblSize(0), mNbrMax(0), mPairsNum(0), mJobsMax(0) {
+		::memset(&mResolve, 0, sizeof(mResolve));
+	}
+
+	~Grid() { reset(); }
+
+	void init(const int maxAgents, const int maxJobs = 0);
+	void reset();
+
+	/* cellSize <= 0: twice the largest radius plus margin */
+	void build(const cxSphere* pSph, const int num, const float margin = 0.0f, cxBrigade* pBgd = nullptr, const float cellSize = 0.0f);
+
+	int get_agents_num() const { return mAgentsNum; }
+	bool ck_agent_idx(const int idx) const { return uint32_t(idx) < uint32_t(mAgentsNum); }
+	int get_pairs_num() const { return mPairsNum; }
+	int get_nbrs_num(const int idx) const { return ck_agent_idx(idx) ? mpNbrOrg[idx + 1] - mpNbrOrg[idx] : 0; }
+	const int32_t* get_nbrs(const int idx) const { return ck_agent_idx(idx) ? &mpNbrLst[mpNbrOrg[idx]] : nullptr; }
+
+	/* FUNC: void(int i, int j), i < j, ascending (i, j) order */
+	template<typename FUNC> void for_each_pair(FUNC& func) const {
+		for (int i = 0; i < mAgentsNum; ++i) {
+			const int32_t* pNbr = &mpNbrLst[mpNbrOrg[i]];
+			int n = mpNbrOrg[i + 1] - mpNbrOrg[i];
+			for (int k = 0; k < n; ++k) {
+				if (pNbr[k] > i) {
+					func(i, pNbr[k]);
+				}
+			}
+		}
+	}
+
+	/* Scene::sph_sph_adj against each neighbor's new position, neighbors in index order, candidates from the new positions */
+	void resolve(const cxVec* pNewPos, const cxVec* pOldPos, const float* pRadius, const int num, cxVec* pAdjPos, cxBrigade* pBgd = nullptr, const float reflectFactor = 0.5f, const float margin = 0.0f);
+};
+
+} // SphGrid
@@ -0,0 +1,645 @@
+#include "crosscore.hpp"
+#include "vtx_quant.hpp"
+
+namespace VtxQuant {
+
+static const uint8_t s_posSize[] = { 4, 8, 12 };
+static const uint8_t s_nrmSize[] = { 0, 2, 4 };
+static const uint8_t s_texSize[] = { 0, 4, 8 };
+static const uint8_t s_clrSize[] = { 0, 0, 4, 8 };
+static const uint8_t s_wgtSize[] = { 0, 8, 12 };
+
+/* 4-byte attributes first, octahedral normals (2 or 4 bytes) last */
+void Format::calc_layout() {
+	uint32_t offs = s_posSize[mPos];
+	mTexOffs = uint8_t(offs);
+	offs += s_texSize[mTex];
+	mWgtOffs = uint8_t(offs);
+	offs += s_wgtSize[mWgt];
+	mClrOffs = uint8_t(offs);
+	offs += s_clrSize[mClr];
+	mNrmOffs = uint8_t(offs);
+	offs += s_nrmSize[mNrm];
+	mStride = uint8_t((offs + 3) & ~3U);
+}
+
+void Error::max(const Error& err) {
+	mPos = nxCalc::max(mPos, err.mPos);
+	mNrm = nxCalc::max(mNrm, err.mNrm);
+	mTex = nxCalc::max(mTex, err.mTex);
+	mClr = nxCalc::max(mClr, err.mClr);
+	mWgt = nxCalc::max(mWgt, err.mWgt);
+}
+
+
+bool Input::alloc(const int nvtx, const bool withNormals, const bool withTex, const bool withClr, const bool withSkin) {
+	reset();
+	if (nvtx <= 0) return false;
+	mpPos = (float*)nxCore::mem_alloc(nvtx * 3 * sizeof(float), "VtxQuant:Pos");
+	if (withNormals) {
+		mpNrm = (float*)nxCore::mem_alloc(nvtx * 3 * sizeof(float), "VtxQuant:Nrm");
+	}
+	if (withTex) {
+		mpTex = (float*)nxCore::mem_alloc(nvtx * 2 * sizeof(float), "VtxQuant:Tex");
+	}
+	if (withClr) {
+		mpClr = (float*)nxCore::mem_alloc(nvtx * 4 * sizeof(float), "VtxQuant:Clr");
+	}
+	if (withSkin) {
+		mpWgt = (float*)nxCore::mem_alloc(nvtx * 4 * sizeof(float), "VtxQuant:Wgt");
+		mpJnt = (int32_t*)nxCore::mem_alloc(nvtx * 4 * sizeof(int32_t), "VtxQuant:Jnt");
+	}
+	if (!mpPos || (withNormals && !mpNrm) || (withTex && !mpTex) || (withClr && !mpClr) || (withSkin && (!mpWgt || !mpJnt))) {
+		reset();
+		return false;
+	}
+	mVtxNum = nvtx;
+	return true;
+}
+
+void Input::reset() {
+	nxCore::mem_free(mpPos);
+	mpPos = nullptr;
+	nxCore::mem_free(mpNrm);
+	mpNrm = nullptr;
+	nxCore::mem_free(mpTex);
+	mpTex = nullptr;
+	nxCore::mem_free(mpClr);
+	mpClr = nullptr;
+	nxCore::mem_free(mpWgt);
+	mpWgt = nullptr;
+	nxCore::mem_free(mpJnt);
+	mpJnt = nullptr;
+	mVtxNum = 0;
+}
+
+bool Input::from_model(const sxModelData* pMdl) {
+	reset();
+	if (!pMdl || !pMdl->get_pnt_data_top()) return false;
+	int npnt = pMdl->mPntNum;
+	bool skinFlg = pMdl->has_skin();
+	if (!alloc(npnt, true, true, true, skinFlg)) return false;
+	for (int i = 0; i < npnt; ++i) {
+		pMdl->get_pnt_pos(i).to_mem(&mpPos[i * 3]);
+		pMdl->get_pnt_nrm(i).to_mem(&mpNrm[i * 3]);
+		xt_texcoord tex = pMdl->get_pnt_tex(i);
+		mpTex[i * 2] = tex.u;
+		mpTex[i * 2 + 1] = tex.v;
+		cxColor clr = pMdl->get_pnt_clr(i);
+		for (int j = 0; j < 4; ++j) {
+			mpClr[i * 4 + j] = clr.ch[j];
+		}
+		if (skinFlg) {
+			sxModelData::PntSkin skn = pMdl->get_pnt_skin(i);
+			for (int j = 0; j < 4; ++j) {
+				mpWgt[i * 4 + j] = j < skn.num ? skn.wgt[j] : 0.0f;
+				mpJnt[i * 4 + j] = j < skn.num ? skn.idx[j] : 0;
+			}
+			if (skn.num <= 0) {
+				mpWgt[i * 4] = 1.0f;
+			}
+		}
+	}
+	return true;
+}
+
+
+static inline int32_t quant(const float x, const float org, const float scl, const int32_t qmax) {
+	if (scl <= 0.0f) return 0;
+	return nxCalc::clamp(int32_t(::floorf((x - org) / scl + 0.5f)), 0, qmax);
+}
+
+static inline float clamp_snorm(const float x) { return nxCalc::clamp(x, -1.0f, 1.0f); }
+
+static void enc_pos(const Stream& str, const float* pPos, uint8_t* pDst) {
+	switch (str.mFmt.mPos) {
+		case POS_U10: {
+			uint32_t q = 0;
+			for (int i = 0; i < 3; ++i) {
+				q |= uint32_t(quant(pPos[i], str.mPosOrg[i], str.mPosScl[i], 0x3FF)) << (i * 10);
+			}
+			::memcpy(pDst, &q, sizeof(q));
+			break;
+		}
+		case POS_U16: {
+			uint16_t q[4];
+			for (int i = 0; i < 3; ++i) {
+				q[i] = uint16_t(quant(pPos[i], str.mPosOrg[i], str.mPosScl[i], 0xFFFF));
+			}
+			q[3] = 0;
+			::memcpy(pDst, q, sizeof(q));
+			break;
+		}
+		default:
+			::memcpy(pDst, pPos, 3 * sizeof(float));
+			break;
+	}
+}
+
+static cxVec dec_pos(const Stream& str, const uint8_t* pSrc) {
+	cxVec pos;
+	switch (str.mFmt.mPos) {
+		case POS_U10: {
+			uint32_t q;
+			::memcpy(&q, pSrc, sizeof(q));
+			for (int i = 0; i < 3; ++i) {
+				pos.set_at(i, str.mPosOrg[i] + float((q >> (i * 10)) & 0x3FF) * str.mPosScl[i]);
+			}
+			break;
+		}
+		case POS_U16: {
+			uint16_t q[4];
+			::memcpy(q, pSrc, sizeof(q));
+			for (int i = 0; i < 3; ++i) {
+				pos.set_at(i, str.mPosOrg[i] + float(q[i]) * str.mPosScl[i]);
+			}
+			break;
+		}
+		default:
+			pos.from_mem((const float*)pSrc);
+			break;
+	}
+	return pos;
+}
+
+static cxVec oct_dec(const int32_t* pQ, const float qmax) {
+	xt_float2 oct;
+	oct.set(clamp_snorm(float(pQ[0]) / qmax), clamp_snorm(float(pQ[1]) / qmax));
+	return nxVec::decode_octa(oct);
+}
+
+/* the rounded octahedral code is not always the closest one: the 4 neighbors around the exact value are tried */
+static void oct_enc(const float* pNrm, const int32_t qmax, int32_t* pQ) {
+	cxVec nrm;
+	nrm.from_mem(pNrm);
+	nrm.normalize();
+	xt_float2 oct = nrm.encode_octa();
+	int32_t base[2];
+	for (int i = 0; i < 2; ++i) {
+		base[i] = int32_t(::floorf(oct[i] * float(qmax)));
+	}
+	float bestDot = -2.0f;
+	pQ[0] = 0;
+	pQ[1] = 0;
+	for (int i = 0; i < 4; ++i) {
+		int32_t q[2];
+		q[0] = nxCalc::clamp(base[0] + (i & 1), -qmax, qmax);
+		q[1] = nxCalc::clamp(base[1] + (i >> 1), -qmax, qmax);
+		float d = nrm.dot(oct_dec(q, float(qmax)));
+		if (d > bestDot) {
+			bestDot = d;
+			pQ[0] = q[0];
+			pQ[1] = q[1];
+		}
+	}
+}
+
+static void enc_nrm(const Stream& str, const float* pNrm, uint8_t* pDst) {
+	int32_t q[2];
+	switch (str.mFmt.mNrm) {
+		case NRM_OCT8: {
+			oct_enc(pNrm, 0x7F, q);
+			int8_t o[2] = { int8_t(q[0]), int8_t(q[1]) };
+			::memcpy(pDst, o, sizeof(o));
+			break;
+		}
+		case NRM_OCT16: {
+			oct_enc(pNrm, 0x7FFF, q);
+			int16_t o[2] = { int16_t(q[0]), int16_t(q[1]) };
+			::memcpy(pDst, o, sizeof(o));
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+static cxVec dec_nrm(const Stream& str, const uint8_t* pSrc) {
+	int32_t q[2];
+	switch (str.mFmt.mNrm) {
+		case NRM_OCT8: {
+			int8_t o[2];
+			::memcpy(o, pSrc, sizeof(o));
+			q[0] = o[0];
+			q[1] = o[1];
+			return oct_dec(q, float(0x7F));
+		}
+		case NRM_OCT16: {
+			int16_t o[2];
+			::memcpy(o, pSrc, sizeof(o));
+			q[0] = o[0];
+			q[1] = o[1];
+			return oct_dec(q, float(0x7FFF));
+		}
+		default:
+			break;
+	}
+	return nxVec::get_axis(exAxis::PLUS_Z);
+}
+
+static void enc_tex(const Stream& str, const float* pTex, uint8_t* pDst) {
+	switch (str.mFmt.mTex) {
+		case TEX_U16: {
+			uint16_t q[2];
+			for (int i = 0; i < 2; ++i) {
+				q[i] = uint16_t(quant(pTex[i], str.mTexOrg[i], str.mTexScl[i], 0xFFFF));
+			}
+			::memcpy(pDst, q, sizeof(q));
+			break;
+		}
+		case TEX_F32:
+			::memcpy(pDst, pTex, 2 * sizeof(float));
+			break;
+		default:
+			break;
+	}
+}
+
+static xt_texcoord dec_tex(const Stream& str, const uint8_t* pSrc) {
+	xt_texcoord tex;
+	tex.fill(0.0f);
+	switch (str.mFmt.mTex) {
+		case TEX_U16: {
+			uint16_t q[2];
+			::memcpy(q, pSrc, sizeof(q));
+			tex.set(str.mTexOrg[0] + float(q[0]) * str.mTexScl[0], str.mTexOrg[1] + float(q[1]) * str.mTexScl[1]);
+			break;
+		}
+		case TEX_F32: {
+			float uv[2];
+			::memcpy(uv, pSrc, sizeof(uv));
+			tex.set(uv[0], uv[1]);
+			break;
+		}
+		default:
+			break;
+	}
+	return tex;
+}
+
+static void enc_clr(const Stream& str, const float* pClr, uint8_t* pDst) {
+	switch (str.mFmt.mClr) {
+		case CLR_U8: {
+			uint8_t q[4];
+			for (int i = 0; i < 4; ++i) {
+				q[i] = uint8_t(quant(pClr[i], 0.0f, 1.0f / 255.0f, 0xFF));
+			}
+			::memcpy(pDst, q, sizeof(q));
+			break;
+		}
+		case CLR_HALF: {
+			uint16_t h[4];
+			for (int i = 0; i < 4; ++i) {
+				h[i] = nxCore::float_to_half(pClr[i]);
+			}
+			::memcpy(pDst, h, sizeof(h));
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+static cxColor dec_clr(const Stream& str, const uint8_t* pSrc) {
+	cxColor clr(1.0f);
+	switch (str.mFmt.mClr) {
+		case CLR_CONST:
+			clr.set(str.mClr.x, str.mClr.y, str.mClr.z, str.mClr.w);
+			break;
+		case CLR_U8:
+			for (int i = 0; i < 4; ++i) {
+				clr.ch[i] = float(pSrc[i]) / 255.0f;
+			}
+			break;
+		case CLR_HALF: {
+			uint16_t h[4];
+			::memcpy(h, pSrc, sizeof(h));
+			for (int i = 0; i < 4; ++i) {
+				clr.ch[i] = nxCore::half_to_float(h[i]);
+			}
+			break;
+		}
+		default:
+			break;
+	}
+	return clr;
+}
+
+/* the rounding error goes to the largest weight, so the quantized weights always sum to qmax */
+static void quant_wgt(const float* pWgt, const int32_t qmax, int32_t* pQ) {
+	int32_t sum = 0;
+	int imax = 0;
+	for (int i = 0; i < 4; ++i) {
+		pQ[i] = int32_t(::floorf(nxCalc::saturate(pWgt[i]) * float(qmax) + 0.5f));
+		sum += pQ[i];
+		if (pWgt[i] > pWgt[imax]) imax = i;
+	}
+	pQ[imax] = nxCalc::max(pQ[imax] + qmax - sum, 0);
+}
+
+static void enc_wgt(const Stream& str, const float* pWgt, const int32_t* pJnt, uint8_t* pDst) {
+	if (str.mFmt.mWgt == WGT_NONE) return;
+	int32_t q[4];
+	uint8_t jnt[4];
+	for (int i = 0; i < 4; ++i) {
+		jnt[i] = uint8_t(nxCalc::clamp(pJnt[i], 0, 0xFF));
+	}
+	if (str.mFmt.mWgt == WGT_U8) {
+		quant_wgt(pWgt, 0xFF, q);
+		uint8_t w[4];
+		for (int i = 0; i < 4; ++i) {
+			w[i] = uint8_t(q[i]);
+		}
+		::memcpy(pDst, w, sizeof(w));
+		::memcpy(pDst + 4, jnt, sizeof(jnt));
+	} else {
+		quant_wgt(pWgt, 0xFFFF, q);
+		uint16_t w[4];
+		for (int i = 0; i < 4; ++i) {
+			w[i] = uint16_t(q[i]);
+		}
+		::memcpy(pDst, w, sizeof(w));
+		::memcpy(pDst + 8, jnt, sizeof(jnt));
+	}
+}
+
+static void dec_wgt(const Stream& str, const uint8_t* pSrc, float* pWgt, int32_t* pJnt) {
+	for (int i = 0; i < 4; ++i) {
+		pWgt[i] = i == 0 ? 1.0f : 0.0f;
+		pJnt[i] = 0;
+	}
+	if (str.mFmt.mWgt == WGT_U8) {
+		for (int i = 0; i < 4; ++i) {
+			pWgt[i] = float(pSrc[i]) / 255.0f;
+			pJnt[i] = pSrc[4 + i];
+		}
+	} else if (str.mFmt.mWgt == WGT_U16) {
+		uint16_t w[4];
+		::memcpy(w, pSrc, sizeof(w));
+		for (int i = 0; i < 4; ++i) {
+			pWgt[i] = float(w[i]) / float(0xFFFF);
+			pJnt[i] = pSrc[8 + i];
+		}
+	}
+}
+
+void encode_vtx(const Stream& str, const Input& in, const int idx, void* pDst) {
+	uint8_t* pVtx = (uint8_t*)pDst;
+	::memset(pVtx, 0, str.mFmt.mStride);
+	enc_pos(str, &in.mpPos[idx * 3], pVtx);
+	if (in.mpNrm) {
+		enc_nrm(str, &in.mpNrm[idx * 3], pVtx + str.mFmt.mNrmOffs);
+	}
+	if (in.mpTex) {
+		enc_tex(str, &in.mpTex[idx * 2], pVtx + str.mFmt.mTexOffs);
+	}
+	if (in.mpClr) {
+		enc_clr(str, &in.mpClr[idx * 4], pVtx + str.mFmt.mClrOffs);
+	}
+	if (in.mpWgt && in.mpJnt) {
+		enc_wgt(str, &in.mpWgt[idx * 4], &in.mpJnt[idx * 4], pVtx + str.mFmt.mWgtOffs);
+	}
+}
+
+void decode_vtx(const Stream& str, const void* pSrc, Vertex* pVtx) {
+	if (!pSrc || !pVtx) return;
+	const uint8_t* pData = (const uint8_t*)pSrc;
+	pVtx->pos = dec_pos(str, pData);
+	pVtx->nrm = dec_nrm(str, pData + str.mFmt.mNrmOffs);
+	pVtx->tex = dec_tex(str, pData + str.mFmt.mTexOffs);
+	pVtx->clr = dec_clr(str, pData + str.mFmt.mClrOffs);
+	dec_wgt(str, pData + str.mFmt.mWgtOffs, pVtx->wgt, pVtx->jnt);
+}
+
+
+static float angle_deg(const cxVec& a, const cxVec& b) {
+	float d = nxCalc::clamp(a.dot(b), -1.0f, 1.0f);
+	return XD_RAD2DEG(::acosf(d));
+}
+
+/* every candidate is measured by a round trip through the attribute encoder */
+void Encoder::select_format(Stream* pStr, const Input& in, const Tolerance& tol) const {
+	const int org = pStr->mVtxOrg;
+	const int num = pStr->mVtxNum;
+	uint8_t buf[16];
+	::memset(&pStr->mFmt, 0, sizeof(Format));
+	pStr->mErr.zero();
+
+	float pmin[3];
+	float pmax[3];
+	for (int j = 0; j < 3; ++j) {
+		pmin[j] = pmax[j] = in.mpPos[org * 3 + j];
+	}
+	for (int i = org; i < org + num; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			pmin[j] = nxCalc::min(pmin[j], in.mpPos[i * 3 + j]);
+			pmax[j] = nxCalc::max(pmax[j], in.mpPos[i * 3 + j]);
+		}
+	}
+	static const int32_t s_posQMax[] = { 0x3FF, 0xFFFF, 0 };
+	for (int fmt = POS_U10; fmt <= POS_F32; ++fmt) {
+		pStr->mFmt.mPos = uint8_t(fmt);
+		for (int j = 0; j < 3; ++j) {
+			pStr->mPosOrg[j] = fmt == POS_F32 ? 0.0f : pmin[j];
+			pStr->mPosScl[j] = fmt == POS_F32 ? 1.0f : (pmax[j] - pmin[j]) / float(s_posQMax[fmt]);
+		}
+		float err = 0.0f;
+		for (int i = org; i < org + num; ++i) {
+			enc_pos(*pStr, &in.mpPos[i * 3], buf);
+			cxVec src;
+			src.from_mem(&in.mpPos[i * 3]);
+			err = nxCalc::max(err, nxVec::dist(dec_pos(*pStr, buf), src));
+		}
+		pStr->mErr.mPos = err;
+		if (err <= tol.mPos) break;
+	}
+
+	if (in.mpNrm) {
+		for (int fmt = NRM_OCT8; fmt <= NRM_OCT16; ++fmt) {
+			pStr->mFmt.mNrm = uint8_t(fmt);
+			float err = 0.0f;
+			for (int i = org; i < org + num; ++i) {
+				cxVec src;
+				src.from_mem(&in.mpNrm[i * 3]);
+				if (src.mag2() <= 0.0f) continue;
+				src.normalize();
+				enc_nrm(*pStr, &in.mpNrm[i * 3], buf);
+				err = nxCalc::max(err, angle_deg(dec_nrm(*pStr, buf), src));
+			}
+			pStr->mErr.mNrm = err;
+			if (err <= tol.mNrm) break;
+		}
+	}
+
+	if (in.mpTex) {
+		float tmin[2];
+		float tmax[2];
+		for (int j = 0; j < 2; ++j) {
+			tmin[j] = tmax[j] = in.mpTex[org * 2 + j];
+		}
+		for (int i = org; i < org + num; ++i) {
+			for (int j = 0; j < 2; ++j) {
+				tmin[j] = nxCalc::min(tmin[j], in.mpTex[i * 2 + j]);
+				tmax[j] = nxCalc::max(tmax[j], in.mpTex[i * 2 + j]);
+			}
+		}
+		for (int fmt = TEX_U16; fmt <= TEX_F32; ++fmt) {
+			pStr->mFmt.mTex = uint8_t(fmt);
+			for (int j = 0; j < 2; ++j) {
+				pStr->mTexOrg[j] = fmt == TEX_F32 ? 0.0f : tmin[j];
+				pStr->mTexScl[j] = fmt == TEX_F32 ? 1.0f : (tmax[j] - tmin[j]) / float(0xFFFF);
+			}
+			float err = 0.0f;
+			for (int i = org; i < org + num; ++i) {
+				enc_tex(*pStr, &in.mpTex[i * 2], buf);
+				xt_texcoord tex = dec_tex(*pStr, buf);
+				err = nxCalc::max(err, nxCalc::max(::fabsf(tex.u - in.mpTex[i * 2]), ::fabsf(tex.v - in.mpTex[i * 2 + 1])));
+			}
+			pStr->mErr.mTex = err;
+			if (err <= tol.mTex) break;
+		}
+	}
+
+	if (in.mpClr) {
+		float cmin[4];
+		float cmax[4];
+		for (int j = 0; j < 4; ++j) {
+			cmin[j] = cmax[j] = in.mpClr[org * 4 + j];
+		}
+		for (int i = org; i < org + num; ++i) {
+			for (int j = 0; j < 4; ++j) {
+				cmin[j] = nxCalc::min(cmin[j], in.mpClr[i * 4 + j]);
+				cmax[j] = nxCalc::max(cmax[j], in.mpClr[i * 4 + j]);
+			}
+		}
+		bool unorm = true;
+		for (int j = 0; j < 4; ++j) {
+			unorm &= cmin[j] >= 0.0f && cmax[j] <= 1.0f;
+		}
+		pStr->mClr.set((cmin[0] + cmax[0]) * 0.5f, (cmin[1] + cmax[1]) * 0.5f, (cmin[2] + cmax[2]) * 0.5f, (cmin[3] + cmax[3]) * 0.5f);
+		for (int fmt = CLR_CONST; fmt <= CLR_HALF; ++fmt) {
+			if (fmt == CLR_U8 && !unorm) continue;
+			pStr->mFmt.mClr = uint8_t(fmt);
+			float err = 0.0f;
+			for (int i = org; i < org + num; ++i) {
+				enc_clr(*pStr, &in.mpClr[i * 4], buf);
+				cxColor clr = dec_clr(*pStr, buf);
+				for (int j = 0; j < 4; ++j) {
+					err = nxCalc::max(err, ::fabsf(clr.ch[j] - in.mpClr[i * 4 + j]));
+				}
+			}
+			pStr->mErr.mClr = err;
+			if (err <= tol.mClr) break;
+		}
+	}
+
+	if (in.mpWgt && in.mpJnt) {
+		for (int fmt = WGT_U8; fmt <= WGT_U16; ++fmt) {
+			pStr->mFmt.mWgt = uint8_t(fmt);
+			float err = 0.0f;
+			for (int i = org; i < org + num; ++i) {
+				float wgt[4];
+				int32_t jnt[4];
+				enc_wgt(*pStr, &in.mpWgt[i * 4], &in.mpJnt[i * 4], buf);
+				dec_wgt(*pStr, buf, wgt, jnt);
+				for (int j = 0; j < 4; ++j) {
+					err = nxCalc::max(err, ::fabsf(wgt[j] - in.mpWgt[i * 4 + j]));
+				}
+			}
+			pStr->mErr.mWgt = err;
+			if (err <= tol.mWgt) break;
+		}
+	}
+
+	pStr->mFmt.calc_layout();
+}
+
+void Encoder::reset() {
+	nxCore::mem_free(mpStreams);
+	mpStreams = nullptr;
+	nxCore::mem_free(mpData);
+	mpData = nullptr;
+	mDataSize = 0;
+	mSrcSize = 0;
+	mStreamsNum = 0;
+}
+
+bool Encoder::encode(const Input& in, const Range* pRanges, const int nranges, const Tolerance& tol, const size_t srcVtxSize) {
+	reset();
+	if (!in.is_valid() || !pRanges || nranges <= 0) return false;
+	mpStreams = (Stream*)nxCore::mem_alloc(nranges * sizeof(Stream), "VtxQuant:Streams");
+	if (!mpStreams) return false;
+	::memset(mpStreams, 0, nranges * sizeof(Stream));
+	size_t dataSize = 0;
+	for (int i = 0; i < nranges; ++i) {
+		Stream* pStr = &mpStreams[i];
+		int org = nxCalc::clamp(pRanges[i].mOrg, 0, in.mVtxNum);
+		int end = nxCalc::clamp(pRanges[i].mOrg + pRanges[i].mNum, org, in.mVtxNum);
+		pStr->mVtxOrg = org;
+		pStr->mVtxNum = end - org;
+		pStr->mSrcSize = uint32_t(pStr->mVtxNum * srcVtxSize);
+		if (pStr->mVtxNum > 0) {
+			select_format(pStr, in, tol);
+		} else {
+			pStr->mFmt.calc_layout();
+		}
+		pStr->mDataOffs = uint32_t(dataSize);
+		dataSize += (pStr->get_data_size() + 0xF) & ~size_t(0xF);
+		mSrcSize += pStr->mSrcSize;
+	}
+	mStreamsNum = nranges;
+	if (dataSize > 0) {
+		mpData = (uint8_t*)nxCore::mem_alloc(dataSize, "VtxQuant:Data");
+		if (!mpData) {
+			reset();
+			return false;
+		}
+	}
+	mDataSize = dataSize;
+	for (int i = 0; i < nranges; ++i) {
+		const Stream& str = mpStreams[i];
+		uint8_t* pDst = mpData + str.mDataOffs;
+		for (int j = 0; j < str.mVtxNum; ++j) {
+			encode_vtx(str, in, str.mVtxOrg + j, pDst);
+			pDst += str.mFmt.mStride;
+		}
+	}
+	return true;
+}
+
+bool Encoder::encode(const sxModelData* pMdl, const Tolerance& tol) {
+	reset();
+	if (!pMdl || pMdl->mBatNum <= 0) return false;
+	Input in;
+	if (!in.from_model(pMdl)) return false;
+	int nbat = pMdl->mBatNum;
+	Range* pRanges = (Range*)nxCore::mem_alloc(nbat * sizeof(Range), "VtxQuant:Ranges");
+	if (!pRanges) return false;
+	for (int i = 0; i < nbat; ++i) {
+		const sxModelData::Batch* pBat = pMdl->get_batch_ptr(i);
+		pRanges[i].mOrg = pBat ? pBat->mMinIdx : 0;
+		pRanges[i].mNum = pBat ? pBat->mMaxIdx - pBat->mMinIdx + 1 : 0;
+	}
+	bool res = encode(in, pRanges, nbat, tol, pMdl->get_vtx_size());
+	nxCore::mem_free(pRanges);
+	return res;
+}
+
+bool Encoder::decode(const int istr, const int ivtx, Vertex* pVtx) const {
+	const Stream* pStr = get_stream(istr);
+	if (!pStr || !pVtx || !mpData) return false;
+	if (ivtx < 0 || ivtx >= pStr->mVtxNum) return false;
+	decode_vtx(*pStr, mpData + pStr->mDataOffs + size_t(ivtx) * pStr->mFmt.mStride, pVtx);
+	return true;
+}
+
+Error Encoder::get_max_error() const {
+	Error err;
+	err.zero();
+	for (int i = 0; i < mStreamsNum; ++i) {
+		err.max(mpStreams[i].mErr);
+	}
+	return err;
+}
+
+} // VtxQuant
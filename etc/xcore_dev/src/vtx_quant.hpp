@@ -0,0 +1,168 @@
+namespace VtxQuant {
+
+enum PosFmt {
+	POS_U10 = 0, /* 10:10:10 in a 32-bit word, relative to the range bounds */
+	POS_U16 = 1, /* 3 x 16 bits relative to the range bounds, padded to 8 bytes */
+	POS_F32 = 2
+};
+
+enum NrmFmt {
+	NRM_NONE = 0,
+	NRM_OCT8 = 1,  /* octahedral, 2 x snorm8 */
+	NRM_OCT16 = 2  /* octahedral, 2 x snorm16 */
+};
+
+enum TexFmt {
+	TEX_NONE = 0,
+	TEX_U16 = 1, /* 2 x 16 bits relative to the range bounds */
+	TEX_F32 = 2
+};
+
+enum ClrFmt {
+	CLR_NONE = 0,
+	CLR_CONST = 1, /* no per-vertex data, the range color is used */
+	CLR_U8 = 2,    /* RGBA unorm8, colors in [0, 1] only */
+	CLR_HALF = 3
+};
+
+enum WgtFmt {
+	WGT_NONE = 0,
+	WGT_U8 = 1,  /* 4 weights summing to 255, 4 x 8-bit joints */
+	WGT_U16 = 2  /* 4 weights summing to 65535, 4 x 8-bit joints */
+};
+
+struct Format {
+	uint8_t mPos;
+	uint8_t mNrm;
+	uint8_t mTex;
+	uint8_t mClr;
+	uint8_t mWgt;
+	uint8_t mStride; /* multiple of 4 */
+	uint8_t mNrmOffs; /* position is at 0 */
+	uint8_t mTexOffs;
+	uint8_t mClrOffs;
+	uint8_t mWgtOffs;
+
+	void calc_layout();
+};
+
+/* largest accepted decoding errors: model units for positions, degrees for normals, absolute for the rest */
+struct Tolerance {
+	float mPos;
+	float mNrm;
+	float mTex;
+	float mClr;
+	float mWgt;
+
+	void set_defaults() {
+		mPos = 5e-4f;
+		mNrm = 1.0f;
+		mTex = 1.0f / 4096.0f;
+		mClr = 1.0f / 255.0f;
+		mWgt = 1.0f / 255.0f;
+	}
+};
+
+/* largest errors measured over a range after decoding, same units as Tolerance */
+struct Error {
+	float mPos;
+	float mNrm;
+	float mTex;
+	float mClr;
+	float mWgt;
+
+	void zero() { mPos = mNrm = mTex = mClr = mWgt = 0.0f; }
+	void max(const Error& err);
+};
+
+/* source vertices as float arrays, every attribute except positions is optional */
+struct Input {
+	float* mpPos;   /* xyz per vertex */
+	float* mpNrm;   /* xyz per vertex */
+	float* mpTex;   /* uv per vertex */
+	float* mpClr;   /* rgba per vertex */
+	float* mpWgt;   /* 4 per vertex, normalized, unused slots are 0 */
+	int32_t* mpJnt; /* 4 per vertex, 0..255 */
+	int mVtxNum;
+
+	Input() : mpPos(nullptr), mpNrm(nullptr), mpTex(nullptr), mpClr(nullptr), mpWgt(nullptr), mpJnt(nullptr), mVtxNum(0) {}
+	~Input() { reset(); }
+
+	bool is_valid() const { return mpPos && mVtxNum > 0; }
+
+	bool alloc(const int nvtx, const bool withNormals, const bool withTex, const bool withClr, const bool withSkin);
+	void reset();
+
+	/* joint indices are kept as stored, local to the batch that owns the vertex */
+	bool from_model(const sxModelData* pMdl);
+};
+
+struct Vertex {
+	cxVec pos;
+	cxVec nrm;
+	xt_texcoord tex;
+	cxColor clr;
+	float wgt[4];
+	int32_t jnt[4];
+};
+
+/* one encoded vertex range, interleaved with mFmt.mStride bytes per vertex */
+struct Stream {
+	Format mFmt;
+	xt_float3 mPosOrg;
+	xt_float3 mPosScl; /* per quantization step */
+	xt_float2 mTexOrg;
+	xt_float2 mTexScl;
+	xt_float4 mClr;    /* CLR_CONST */
+	Error mErr;
+	int32_t mVtxOrg;   /* first source vertex */
+	int32_t mVtxNum;
+	uint32_t mDataOffs;
+	uint32_t mSrcSize; /* bytes taken by the range in the source encoding */
+
+	size_t get_data_size() const { return size_t(mVtxNum) * mFmt.mStride; }
+};
+
+struct Range {
+	int32_t mOrg;
+	int32_t mNum;
+};
+
+void encode_vtx(const Stream& str, const Input& in, const int idx, void* pDst);
+void decode_vtx(const Stream& str, const void* pSrc, Vertex* pVtx);
+
+/* CPU vertex encoder.
+   Every range (a model batch) gets its own format: each attribute takes the smallest encoding whose error,
+   measured by decoding every vertex of the range, stays within the tolerance, the widest one is used otherwise.
+   Positions and texture coordinates are quantized relative to the bounds of the range. */
+class Encoder {
+protected:
+	Stream* mpStreams;
+	uint8_t* mpData;
+	size_t mDataSize;
+	size_t mSrcSize;
+	int mStreamsNum;
+
+	void select_format(Stream* pStr, const Input& in, const Tolerance& tol) const;
+
+public:
+	Encoder() : mpStreams(nullptr), mpData(nullptr), mDataSize(0), mSrcSize(0), mStreamsNum(0) {}
+	~Encoder() { reset(); }
+
+	void reset();
+
+	/* srcVtxSize: bytes per vertex of the source encoding, for the size report */
+	bool encode(const Input& in, const Range* pRanges, const int nranges, const Tolerance& tol, const size_t srcVtxSize);
+	/* one stream per batch, covering [mMinIdx, mMaxIdx] */
+	bool encode(const sxModelData* pMdl, const Tolerance& tol);
+
+	int get_streams_num() const { return mStreamsNum; }
+	const Stream* get_stream(const int i) const { return (i >= 0 && i < mStreamsNum) ? &mpStreams[i] : nullptr; }
+	const uint8_t* get_stream_data(const int i) const { return (i >= 0 && i < mStreamsNum && mpData) ? mpData + mpStreams[i].mDataOffs : nullptr; }
+	bool decode(const int istr, const int ivtx, Vertex* pVtx) const;
+	Error get_max_error() const;
+	size_t get_data_size() const { return mDataSize; }
+	size_t get_src_size() const { return mSrcSize; }
+};
+
+} // VtxQuant
@@ -0,0 +1,400 @@
+#include "crossdata.hpp"
+#include "task.hpp"
+#include "timer.hpp"
+#include "anim_crowd.hpp"
+
+void cAnimCrowd::init(const sxRigData& rig, int maxClips, int maxInsts, int maxWorkers) {
+	reset();
+	if (maxClips <= 0 || maxInsts <= 0) return;
+	mpRig = &rig;
+	mClipsMax = maxClips;
+	mInstsMax = maxInsts;
+	mWrkNum = nxCalc::max(maxWorkers, 1);
+	mpClips = (sAnimCrowdClip*)nxCore::mem_alloc(maxClips * sizeof(sAnimCrowdClip), XD_FOURCC('C', 'r', 'd', 'C'));
+	mpClipOrg = (int32_t*)nxCore::mem_alloc(maxClips * sizeof(int32_t), XD_FOURCC('C', 'r', 'd', 'O'));
+	mpClipCnt = (int32_t*)nxCore::mem_alloc(maxClips * sizeof(int32_t), XD_FOURCC('C', 'r', 'd', 'N'));
+	mpInsts = (sAnimCrowdInst*)nxCore::mem_alloc(maxInsts * sizeof(sAnimCrowdInst), XD_FOURCC('C', 'r', 'd', 'I'));
+	mpSort = (SortItem*)nxCore::mem_alloc(maxInsts * sizeof(SortItem), XD_FOURCC('C', 'r', 'd', 'S'));
+	mpFrames = (float*)nxCore::mem_alloc(maxInsts * sizeof(float), XD_FOURCC('C', 'r', 'd', 'F'));
+	mpWk = (float*)nxCore::mem_alloc(mWrkNum * maxInsts * 12 * sizeof(float), XD_FOURCC('C', 'r', 'd', 'W'));
+	if (!mpClips || !mpClipOrg || !mpClipCnt || !mpInsts || !mpSort || !mpFrames || !mpWk) {
+		reset();
+		return;
+	}
+	mClipsNum = 0;
+	mInstsNum = 0;
+}
+
+void cAnimCrowd::reset() {
+	if (mpClips) {
+		for (int i = 0; i < mClipsNum; ++i) {
+			if (mpClips[i].mOwnLink) {
+				nxCore::mem_free(mpClips[i].mpLink);
+			}
+		}
+	}
+	nxCore::mem_free(mpClips);
+	mpClips = nullptr;
+	nxCore::mem_free(mpClipOrg);
+	mpClipOrg = nullptr;
+	nxCore::mem_free(mpClipCnt);
+	mpClipCnt = nullptr;
+	nxCore::mem_free(mpInsts);
+	mpInsts = nullptr;
+	nxCore::mem_free(mpSort);
+	mpSort = nullptr;
+	nxCore::mem_free(mpFrames);
+	mpFrames = nullptr;
+	nxCore::mem_free(mpWk);
+	mpWk = nullptr;
+	tskQueueDestroy(mpQueue);
+	mpQueue = nullptr;
+	tskJobsFree(mpJobs);
+	mpJobs = nullptr;
+	nxCore::mem_free(mpJobInfo);
+	mpJobInfo = nullptr;
+	mpRig = nullptr;
+	mClipsNum = 0;
+	mClipsMax = 0;
+	mInstsNum = 0;
+	mInstsMax = 0;
+	mJobsMax = 0;
+	mWrkNum = 0;
+}
+
+void cAnimCrowd::realloc_jobs() {
+	int njobs = 0;
+	for (int i = 0; i < mClipsNum; ++i) {
+		njobs += mpClips[i].mpLink->mNodeNum;
+	}
+	if (njobs <= mJobsMax) return;
+	tskQueueDestroy(mpQueue);
+	tskJobsFree(mpJobs);
+	nxCore::mem_free(mpJobInfo);
+	mpQueue = tskQueueCreate(njobs);
+	mpJobs = tskJobsAlloc(njobs);
+	mpJobInfo = (JobInfo*)nxCore::mem_alloc(njobs * sizeof(JobInfo), XD_FOURCC('C', 'r', 'd', 'J'));
+	if (mpQueue && mpJobs && mpJobInfo) {
+		mJobsMax = njobs;
+		for (int i = 0; i < njobs; ++i) {
+			mpJobs[i].mFunc = node_job;
+			mpJobs[i].mpData = this;
+		}
+	} else {
+		tskQueueDestroy(mpQueue);
+		mpQueue = nullptr;
+		tskJobsFree(mpJobs);
+		mpJobs = nullptr;
+		nxCore::mem_free(mpJobInfo);
+		mpJobInfo = nullptr;
+		mJobsMax = 0;
+	}
+}
+
+int cAnimCrowd::add_clip(sxKeyframesData* pKfr, sxKeyframesData::RigLink* pLink) {
+	if (!pKfr || !mpRig || !mpClips) return -1;
+	if (mClipsNum >= mClipsMax) return -1;
+	bool ownLink = false;
+	if (!pLink) {
+		pLink = pKfr->make_rig_link(*mpRig);
+		if (!pLink) return -1;
+		ownLink = true;
+	}
+	int idx = mClipsNum++;
+	mpClips[idx].mpKfr = pKfr;
+	mpClips[idx].mpLink = pLink;
+	mpClips[idx].mOwnLink = ownLink;
+	realloc_jobs();
+	return idx;
+}
+
+bool cAnimCrowd::add_inst(int clipId, float frame, cxMtx* pMtxL) {
+	if (!ck_clip_idx(clipId) || !pMtxL) return false;
+	if (mInstsNum >= mInstsMax) return false;
+	sAnimCrowdInst* pInst = &mpInsts[mInstsNum++];
+	pInst->mpMtxL = pMtxL;
+	pInst->mFrame = frame;
+	pInst->mClipId = clipId;
+	return true;
+}
+
+/*static*/ int cAnimCrowd::sort_cmp(const void* pA, const void* pB) {
+	const SortItem* pItmA = (const SortItem*)pA;
+	const SortItem* pItmB = (const SortItem*)pB;
+	if (pItmA->mClipId != pItmB->mClipId) {
+		return pItmA->mClipId < pItmB->mClipId ? -1 : 1;
+	}
+	if (pItmA->mFrame != pItmB->mFrame) {
+		return pItmA->mFrame < pItmB->mFrame ? -1 : 1;
+	}
+	return pItmA->mInstIdx - pItmB->mInstIdx;
+}
+
+/* Evaluates one link node for all instances of a clip: each channel is sampled once
+   over the time-sorted frames, so key searches are shared by the whole group,
+   and instances at the same clip time get a copy of the first one's matrix. */
+void cAnimCrowd::eval_node(int clipId, int nodeIdx, float* pWk) const {
+	const int POS_MASK = 1 << 0;
+	const int ROT_MASK = 1 << 1;
+	const int SCL_MASK = 1 << 2;
+	const sAnimCrowdClip* pClip = &mpClips[clipId];
+	const sxKeyframesData* pKfr = pClip->mpKfr;
+	sxKeyframesData::RigLink::Node* pNode = &pClip->mpLink->mNodes[nodeIdx];
+	int org = mpClipOrg[clipId];
+	int n = mpClipCnt[clipId];
+	const float* pFrm = &mpFrames[org];
+	sxKeyframesData::RigLink::Val* pVals[3] = { pNode->get_pos_val(), pNode->get_rot_val(), pNode->get_scl_val() };
+	const int masks[3] = { POS_MASK, ROT_MASK, SCL_MASK };
+	int xformMask = 0;
+	for (int k = 0; k < 3; ++k) {
+		sxKeyframesData::RigLink::Val* pVal = pVals[k];
+		if (!pVal) continue;
+		for (int j = 0; j < 3; ++j) {
+			float* pDst = &pWk[k*3 + j];
+			int fcvId = pVal->fcvId[j];
+			if (pKfr->ck_fcv_idx(fcvId)) {
+				xformMask |= masks[k];
+				pKfr->get_fcv(fcvId).eval_sorted(pFrm, n, pDst, 12);
+			} else {
+				float c = pVal->f3[j];
+				for (int i = 0; i < n; ++i) {
+					pDst[i * 12] = c;
+				}
+			}
+		}
+	}
+	if (!xformMask) return;
+	bool slerpFlg = pNode->mUseSlerp && pVals[1] && (xformMask & ROT_MASK);
+	exRotOrd rord = pNode->mRotOrd;
+	exTransformOrd xord = pNode->mXformOrd;
+	int rigNodeId = pNode->mRigNodeId;
+	cxMtx sm;
+	cxMtx rm;
+	cxMtx tm;
+	if (!(xformMask & SCL_MASK)) {
+		sm.mk_scl(mpRig->get_lscl(rigNodeId));
+	}
+	if (!(xformMask & ROT_MASK)) {
+		rm.set_rot_degrees(mpRig->get_lrot(rigNodeId));
+	}
+	if (!(xformMask & POS_MASK)) {
+		tm.mk_translation(mpRig->get_lpos(rigNodeId));
+	}
+	const cxMtx* pPrevMtx = nullptr;
+	for (int i = 0; i < n; ++i) {
+		sAnimCrowdInst* pInst = &mpInsts[mpSort[org + i].mInstIdx];
+		cxMtx* pDstMtx = &pInst->mpMtxL[rigNodeId];
+		if (pPrevMtx && pFrm[i] == pFrm[i - 1]) {
+			/* same clip time as the previous instance */
+			*pDstMtx = *pPrevMtx;
+			continue;
+		}
+		float* pSmp = &pWk[i * 12];
+		if (xformMask & SCL_MASK) {
+			sm.mk_scl(cxVec(pSmp[6], pSmp[7], pSmp[8]));
+		}
+		if (xformMask & ROT_MASK) {
+			cxVec rv(pSmp[3], pSmp[4], pSmp[5]);
+			float frm = pFrm[i];
+			int ifrm = (int)frm;
+			if (slerpFlg && frm != (float)ifrm) {
+				cxVec rot0(0.0f);
+				cxVec rot1(0.0f);
+				for (int j = 0; j < 3; ++j) {
+					int fcvId = pVals[1]->fcvId[j];
+					if (pKfr->ck_fcv_idx(fcvId)) {
+						sxKeyframesData::FCurve fcv = pKfr->get_fcv(fcvId);
+						rot0.set_at(j, fcv.eval((float)ifrm));
+						rot1.set_at(j, fcv.eval((float)(ifrm + 1)));
+					}
+				}
+				cxQuat q0;
+				q0.set_rot_degrees(rot0, rord);
+				cxQuat q1;
+				q1.set_rot_degrees(rot1, rord);
+				cxQuat qr = nxQuat::slerp(q0, q1, frm - (float)ifrm);
+				rv = qr.get_rot_degrees(rord);
+			}
+			rm.set_rot_degrees(rv, rord);
+		}
+		if (xformMask & POS_MASK) {
+			tm.mk_translation(cxVec(pSmp[0], pSmp[1], pSmp[2]));
+		}
+		pDstMtx->calc_xform(tm, rm, sm, xord);
+		pPrevMtx = pDstMtx;
+	}
+}
+
+/*static*/ void cAnimCrowd::node_job(TSK_CONTEXT* pCtx) {
+	TSK_JOB* pJob = pCtx->mpJob;
+	cAnimCrowd* pSelf = (cAnimCrowd*)pJob->mpData;
+	JobInfo* pInfo = &pSelf->mpJobInfo[pJob->mId];
+	pSelf->eval_node(pInfo->mClipId, pInfo->mNodeIdx, pSelf->get_wk(pCtx->mWrkId));
+}
+
+void cAnimCrowd::exec(TSK_BRIGADE* pBgd) {
+	if (!mpRig || mInstsNum <= 0) return;
+	int n = mInstsNum;
+	for (int i = 0; i < n; ++i) {
+		mpSort[i].mClipId = mpInsts[i].mClipId;
+		mpSort[i].mFrame = mpInsts[i].mFrame;
+		mpSort[i].mInstIdx = i;
+	}
+	::qsort(mpSort, n, sizeof(SortItem), sort_cmp);
+	for (int i = 0; i < mClipsNum; ++i) {
+		mpClipOrg[i] = 0;
+		mpClipCnt[i] = 0;
+	}
+	for (int i = 0; i < n; ++i) {
+		mpFrames[i] = mpSort[i].mFrame;
+		int clipId = mpSort[i].mClipId;
+		if (mpClipCnt[clipId] == 0) {
+			mpClipOrg[clipId] = i;
+		}
+		++mpClipCnt[clipId];
+	}
+
+	bool tskFlg = pBgd && mpQueue && mpJobs && mpJobInfo;
+	if (tskFlg) {
+		tskQueuePurge(mpQueue);
+		int njobs = 0;
+		for (int i = 0; i < mClipsNum; ++i) {
+			if (mpClipCnt[i] <= 0) continue;
+			int nnodes = mpClips[i].mpLink->mNodeNum;
+			for (int j = 0; j < nnodes; ++j) {
+				mpJobInfo[njobs].mClipId = i;
+				mpJobInfo[njobs].mNodeIdx = j;
+				tskQueueAdd(mpQueue, &mpJobs[njobs]);
+				++njobs;
+			}
+		}
+		tskBrigadeSetActiveWorkers(pBgd, nxCalc::min(tskBrigadeGetNumWorkers(pBgd), mWrkNum));
+		tskQueueExec(mpQueue, pBgd);
+		tskBrigadeResetActiveWorkers(pBgd);
+	} else {
+		float* pWk = get_wk(0);
+		for (int i = 0; i < mClipsNum; ++i) {
+			if (mpClipCnt[i] <= 0) continue;
+			int nnodes = mpClips[i].mpLink->mNodeNum;
+			for (int j = 0; j < nnodes; ++j) {
+				eval_node(i, j, pWk);
+			}
+		}
+	}
+}
+
+
+static int anim_crowd_bench_cmp(const cxMtx* pRef, const cxMtx* pTst, int nnodes) {
+	int nbad = 0;
+	for (int i = 0; i < nnodes; ++i) {
+		const float* pRefVals = &pRef[i].m[0][0];
+		const float* pTstVals = &pTst[i].m[0][0];
+		for (int j = 0; j < 16; ++j) {
+			if (::fabsf(pRefVals[j] - pTstVals[j]) > 1.0e-5f * (1.0f + ::fabsf(pRefVals[j]))) {
+				++nbad;
+				break;
+			}
+		}
+	}
+	return nbad;
+}
+
+void anim_crowd_bench(const sxRigData& rig, sxKeyframesData** ppKfrs, sxKeyframesData::RigLink** ppLinks, int nclips, TSK_BRIGADE* pBgd, FILE* pOut) {
+	if (!pOut) {
+		pOut = stdout;
+	}
+	const int ninst = 10000;
+	const int nrep = 3;
+	int nnodes = rig.get_nodes_num();
+	if (nnodes <= 0 || !ppKfrs || !ppLinks || nclips <= 0) return;
+	int nwrk = pBgd ? tskBrigadeGetNumWorkers(pBgd) : 1;
+	cxMtx* pRef = (cxMtx*)nxCore::mem_alloc(ninst * nnodes * sizeof(cxMtx), XD_TMP_MEM_TAG);
+	cxMtx* pTst = (cxMtx*)nxCore::mem_alloc(ninst * nnodes * sizeof(cxMtx), XD_TMP_MEM_TAG);
+	int32_t* pClipIds = (int32_t*)nxCore::mem_alloc(ninst * sizeof(int32_t), XD_TMP_MEM_TAG);
+	float* pFrames = (float*)nxCore::mem_alloc(ninst * sizeof(float), XD_TMP_MEM_TAG);
+	int32_t* pValid = (int32_t*)nxCore::mem_alloc(nclips * sizeof(int32_t), XD_TMP_MEM_TAG);
+	cAnimCrowd crowd;
+	crowd.init(rig, nclips, ninst, nwrk);
+	if (pRef && pTst && pClipIds && pFrames && pValid) {
+		/* crowd clip ids are the indices in the list of valid clips */
+		int nvalid = 0;
+		for (int i = 0; i < nclips; ++i) {
+			if (ppKfrs[i] && ppLinks[i] && crowd.add_clip(ppKfrs[i], ppLinks[i]) >= 0) {
+				pValid[nvalid++] = i;
+			}
+		}
+		/* whole and fractional frames, with some instances sharing a frame */
+		sxRNG rng;
+		nxCore::rng_seed(&rng, 7);
+		for (int i = 0; nvalid > 0 && i < ninst; ++i) {
+			int crowdId = int(nxCore::rng_next(&rng) % uint64_t(nvalid));
+			int clipId = pValid[crowdId];
+			float maxFrame = float(nxCalc::max(ppKfrs[clipId]->get_max_fno(), 1));
+			float frame = nxCore::rng_f01(&rng) * maxFrame;
+			if ((i & 3) == 0) {
+				frame = ::floorf(frame);
+			} else if ((i & 3) == 1) {
+				frame = ::floorf(frame * 0.1f) * 10.0f;
+			}
+			pClipIds[i] = clipId;
+			pFrames[i] = nxCalc::min(frame, maxFrame - 1.0e-3f);
+			crowd.add_inst(crowdId, pFrames[i], &pTst[i * nnodes]);
+		}
+		double tr = 0.0;
+		double ts = 0.0;
+		double tp = 0.0;
+		int nbadSerial = 0;
+		int nbadBgd = 0;
+		for (int j = 0; nvalid > 0 && j < nrep; ++j) {
+			for (int i = 0; i < ninst * nnodes; ++i) {
+				pRef[i] = rig.get_lmtx(i % nnodes);
+			}
+			double t0 = time_micros();
+			for (int i = 0; i < ninst; ++i) {
+				sxKeyframesData* pKfr = ppKfrs[pClipIds[i]];
+				sxKeyframesData::RigLink* pLink = ppLinks[pClipIds[i]];
+				for (int k = 0; k < pLink->mNodeNum; ++k) {
+					pKfr->eval_rig_link_node(pLink, k, pFrames[i], &rig, &pRef[i * nnodes]);
+				}
+			}
+			double t = time_micros() - t0;
+			tr = j ? nxCalc::min(tr, t) : t;
+
+			for (int i = 0; i < ninst * nnodes; ++i) {
+				pTst[i] = rig.get_lmtx(i % nnodes);
+			}
+			t0 = time_micros();
+			crowd.exec();
+			t = time_micros() - t0;
+			ts = j ? nxCalc::min(ts, t) : t;
+			for (int i = 0; i < ninst; ++i) {
+				nbadSerial += anim_crowd_bench_cmp(&pRef[i * nnodes], &pTst[i * nnodes], nnodes) != 0;
+			}
+
+			for (int i = 0; i < ninst * nnodes; ++i) {
+				pTst[i] = rig.get_lmtx(i % nnodes);
+			}
+			t0 = time_micros();
+			crowd.exec(pBgd);
+			t = time_micros() - t0;
+			tp = j ? nxCalc::min(tp, t) : t;
+			for (int i = 0; i < ninst; ++i) {
+				nbadBgd += anim_crowd_bench_cmp(&pRef[i * nnodes], &pTst[i * nnodes], nnodes) != 0;
+			}
+		}
+		if (nvalid > 0) {
+			::fprintf(pOut, "anim crowd: %d instances of %d clips, %d nodes, %d workers (min of %d runs):\n", ninst, nvalid, nnodes, nwrk, nrep);
+			::fprintf(pOut, " per instance %8.3f ms, %10.0f poses/s\n", tr / 1000.0, ninst * 1.0e6 / nxCalc::max(tr, 1.0));
+			::fprintf(pOut, " crowd        %8.3f ms, %10.0f poses/s, %d mismatches\n", ts / 1000.0, ninst * 1.0e6 / nxCalc::max(ts, 1.0), nbadSerial);
+			::fprintf(pOut, " crowd, tasks %8.3f ms, %10.0f poses/s, %d mismatches\n", tp / 1000.0, ninst * 1.0e6 / nxCalc::max(tp, 1.0), nbadBgd);
+		} else {
+			::fprintf(pOut, "anim crowd: no clips\n");
+		}
+	}
+	crowd.reset();
+	nxCore::mem_free(pRef);
+	nxCore::mem_free(pTst);
+	nxCore::mem_free(pClipIds);
+	nxCore::mem_free(pFrames);
+	nxCore::mem_free(pValid);
+}
@@ -0,0 +1,80 @@
+struct TSK_BRIGADE;
+struct TSK_QUEUE;
+struct TSK_JOB;
+struct TSK_CONTEXT;
+
+struct sAnimCrowdClip {
+	sxKeyframesData* mpKfr;
+	sxKeyframesData::RigLink* mpLink;
+	bool mOwnLink;
+};
+
+struct sAnimCrowdInst {
+	cxMtx* mpMtxL;
+	float mFrame;
+	int32_t mClipId;
+};
+
+class cAnimCrowd {
+protected:
+	struct SortItem {
+		int32_t mClipId;
+		float mFrame;
+		int32_t mInstIdx;
+	};
+
+	struct JobInfo {
+		int32_t mClipId;
+		int32_t mNodeIdx;
+	};
+
+	const sxRigData* mpRig;
+	sAnimCrowdClip* mpClips;
+	sAnimCrowdInst* mpInsts;
+	SortItem* mpSort;
+	float* mpFrames;
+	int32_t* mpClipOrg;
+	int32_t* mpClipCnt;
+	float* mpWk;
+	TSK_JOB* mpJobs;
+	JobInfo* mpJobInfo;
+	TSK_QUEUE* mpQueue;
+	int mClipsNum;
+	int mClipsMax;
+	int mInstsNum;
+	int mInstsMax;
+	int mJobsMax;
+	int mWrkNum;
+
+	float* get_wk(int wrkId) const { return &mpWk[(wrkId < 0 ? 0 : wrkId) * mInstsMax * 12]; }
+	void realloc_jobs();
+	void eval_node(int clipId, int nodeIdx, float* pWk) const;
+
+	static int sort_cmp(const void* pA, const void* pB);
+	static void node_job(TSK_CONTEXT* pCtx);
+
+public:
+	cAnimCrowd()
+	: mpRig(nullptr), mpClips(nullptr), mpInsts(nullptr), mpSort(nullptr), mpFrames(nullptr),
+	mpClipOrg(nullptr), mpClipCnt(nullptr), mpWk(nullptr),
+	mpJobs(nullptr), mpJobInfo(nullptr), mpQueue(nullptr),
+	mClipsNum(0), mClipsMax(0), mInstsNum(0), mInstsMax(0), mJobsMax(0), mWrkNum(0) {}
+
+	~cAnimCrowd() { reset(); }
+
+	void init(const sxRigData& rig, int maxClips, int maxInsts, int maxWorkers = 1);
+	void reset();
+
+	int add_clip(sxKeyframesData* pKfr, sxKeyframesData::RigLink* pLink = nullptr);
+	int get_clips_num() const { return mClipsNum; }
+	bool ck_clip_idx(int idx) const { return (uint32_t)idx < (uint32_t)mClipsNum; }
+
+	void clear_insts() { mInstsNum = 0; }
+	bool add_inst(int clipId, float frame, cxMtx* pMtxL);
+	int get_insts_num() const { return mInstsNum; }
+
+	void exec(TSK_BRIGADE* pBgd = nullptr);
+};
+
+/* 10k instances over the given clips: crowd results against per-instance eval_rig_link_node, poses/s of both */
+void anim_crowd_bench(const sxRigData& rig, sxKeyframesData** ppKfrs, sxKeyframesData::RigLink** ppLinks, int nclips, TSK_BRIGADE* pBgd = nullptr, FILE* pOut = nullptr);
@@ -0,0 +1,552 @@
+#include "crossdata.hpp"
+#include "anim_lod.hpp"
+
+void sAnimLODParams::set_defaults() {
+	static const float dist[ANIM_LOD_LVL_NUM] = { 0.0f, 8.0f, 20.0f, 50.0f };
+	static const int32_t interval[ANIM_LOD_LVL_NUM] = { 1, 2, 4, 8 };
+	static const int32_t skipHgt[ANIM_LOD_LVL_NUM] = { 0, 1, 2, 3 };
+	for (int i = 0; i < ANIM_LOD_LVL_NUM; ++i) {
+		mDist[i] = dist[i];
+		mInterval[i] = interval[i];
+		mSkipHgt[i] = skipHgt[i];
+	}
+}
+
+int sAnimLODParams::calc_lvl(float dist, float importance) const {
+	float d = dist * nxCalc::rcp0(nxCalc::max(importance, 1.0e-3f));
+	int lvl = 0;
+	for (int i = 1; i < ANIM_LOD_LVL_NUM; ++i) {
+		if (d >= mDist[i]) {
+			lvl = i;
+		}
+	}
+	return lvl;
+}
+
+
+void sAnimLODRig::init(const sxRigData& rig) {
+	free();
+	int n = rig.get_nodes_num();
+	if (n <= 0) return;
+	mpHgt = (uint8_t*)nxCore::mem_alloc(n, XD_FOURCC('L', 'O', 'D', 'h'));
+	mpLock = (uint8_t*)nxCore::mem_alloc(n, XD_FOURCC('L', 'O', 'D', 'l'));
+	if (!mpHgt || !mpLock) {
+		free();
+		return;
+	}
+	mpRig = &rig;
+	mNodesNum = n;
+	::memset(mpHgt, 0, n);
+	::memset(mpLock, 0, n);
+	for (int i = 0; i < n; ++i) {
+		int hgt = 1;
+		int idx = rig.get_parent_idx(i);
+		while (rig.ck_node_idx(idx)) {
+			if (mpHgt[idx] >= hgt) break;
+			mpHgt[idx] = (uint8_t)nxCalc::min(hgt, 0xFF);
+			idx = rig.get_parent_idx(idx);
+			++hgt;
+		}
+	}
+	mMaxHgt = 0;
+	for (int i = 0; i < n; ++i) {
+		mMaxHgt = nxCalc::max(mMaxHgt, (int)mpHgt[i]);
+		if (rig.get_node_ptr(i)->is_hrc_top()) {
+			mpLock[i] = 1;
+		}
+	}
+}
+
+void sAnimLODRig::free() {
+	if (mpHgt) {
+		nxCore::mem_free(mpHgt);
+		mpHgt = nullptr;
+	}
+	if (mpLock) {
+		nxCore::mem_free(mpLock);
+		mpLock = nullptr;
+	}
+	mpRig = nullptr;
+	mNodesNum = 0;
+	mMaxHgt = 0;
+}
+
+void sAnimLODRig::lock_node(int idx, bool withParents) {
+	if (!mpRig || !mpLock) return;
+	while (ck_node_idx(idx)) {
+		mpLock[idx] = 1;
+		if (!withParents) break;
+		idx = mpRig->get_parent_idx(idx);
+	}
+}
+
+int sAnimLODRig::make_link_list(const sxKeyframesData::RigLink& link, int skipHgt, int16_t* pLst) const {
+	int n = 0;
+	if (!pLst) return 0;
+	for (int i = 0; i < link.mNodeNum; ++i) {
+		if (!mpRig || is_active(link.mNodes[i].mRigNodeId, skipHgt)) {
+			pLst[n++] = (int16_t)i;
+		}
+	}
+	return n;
+}
+
+
+void sAnimLODInst::alloc(int nnodes) {
+	free();
+	if (nnodes <= 0) return;
+	for (int i = 0; i < 2; ++i) {
+		mpKeyQuat[i] = (cxQuat*)nxCore::mem_alloc(nnodes * sizeof(cxQuat), XD_FOURCC('L', 'O', 'D', 'q'));
+		mpKeyPos[i] = (cxVec*)nxCore::mem_alloc(nnodes * sizeof(cxVec), XD_FOURCC('L', 'O', 'D', 'p'));
+		mpKeyScl[i] = (cxVec*)nxCore::mem_alloc(nnodes * sizeof(cxVec), XD_FOURCC('L', 'O', 'D', 'c'));
+		if (!mpKeyQuat[i] || !mpKeyPos[i] || !mpKeyScl[i]) {
+			free();
+			return;
+		}
+	}
+	mNodesNum = nnodes;
+	mCost = nnodes;
+	mCount = 0;
+	mInterval = 1;
+	mNextInterval = 1;
+	mWait = 0;
+	invalidate();
+}
+
+void sAnimLODInst::free() {
+	for (int i = 0; i < 2; ++i) {
+		if (mpKeyQuat[i]) {
+			nxCore::mem_free(mpKeyQuat[i]);
+			mpKeyQuat[i] = nullptr;
+		}
+		if (mpKeyPos[i]) {
+			nxCore::mem_free(mpKeyPos[i]);
+			mpKeyPos[i] = nullptr;
+		}
+		if (mpKeyScl[i]) {
+			nxCore::mem_free(mpKeyScl[i]);
+			mpKeyScl[i] = nullptr;
+		}
+	}
+	mNodesNum = 0;
+	mKeyFlg = false;
+}
+
+void sAnimLODInst::plan(const sAnimLODParams& params) {
+	mLvl = params.calc_lvl(mDist, mImportance);
+	mNextInterval = nxCalc::max(params.mInterval[mLvl], 1);
+	mSkipHgt = params.mSkipHgt[mLvl];
+	mUpdateFlg = is_due();
+}
+
+void sAnimLODInst::store_key(const cxMtx* pMtxL) {
+	if (!pMtxL || mNodesNum <= 0) return;
+	int n = mNodesNum;
+	if (mKeyFlg) {
+		::memcpy(mpKeyQuat[0], mpKeyQuat[1], n * sizeof(cxQuat));
+		::memcpy(mpKeyPos[0], mpKeyPos[1], n * sizeof(cxVec));
+		::memcpy(mpKeyScl[0], mpKeyScl[1], n * sizeof(cxVec));
+	}
+	for (int i = 0; i < n; ++i) {
+		/* local matrices are scale * rotation * translation, the rotation is taken with the scale removed */
+		cxMtx rt;
+		mpKeyScl[1][i] = pMtxL[i].get_scl(&rt);
+		mpKeyQuat[1][i].from_mtx(rt);
+		mpKeyPos[1][i] = pMtxL[i].get_translation();
+	}
+	if (!mKeyFlg) {
+		::memcpy(mpKeyQuat[0], mpKeyQuat[1], n * sizeof(cxQuat));
+		::memcpy(mpKeyPos[0], mpKeyPos[1], n * sizeof(cxVec));
+		::memcpy(mpKeyScl[0], mpKeyScl[1], n * sizeof(cxVec));
+		mKeyFlg = true;
+	}
+	mInterval = mNextInterval;
+	mCount = 0;
+	mWait = 0;
+}
+
+/* the next scheduled update, wrapped around for looping clips and held at the last frame of one-shot ones */
+float sAnimLODInst::calc_key_frame(float frame, float frameStep, float maxFrame, bool loop) const {
+	float keyFrame = frame + frameStep*float(get_interval());
+	if (keyFrame >= maxFrame) {
+		keyFrame = loop ? nxCalc::max(keyFrame - maxFrame, 0.0f) : maxFrame;
+	}
+	return keyFrame;
+}
+
+void sAnimLODInst::update(float frame, float frameStep, float maxFrame, bool loop, EvalFunc func, void* pData, cxMtx* pMtxL) {
+	if (!func || !pMtxL) return;
+	if (!mUpdateFlg && mKeyFlg) return;
+	if (!mKeyFlg) {
+		func(pData, frame, 0);
+		store_key(pMtxL);
+	}
+	/* evaluate ahead to the next scheduled update and interpolate towards it */
+	mCost = func(pData, calc_key_frame(frame, frameStep, maxFrame, loop), mSkipHgt);
+	store_key(pMtxL);
+}
+
+void sAnimLODInst::interpolate(cxMtx* pMtxL) const {
+	if (!pMtxL || !mKeyFlg) return;
+	int n = mNodesNum;
+	float t = get_interp_t();
+	int key = t >= 1.0f ? 1 : 0;
+	for (int i = 0; i < n; ++i) {
+		cxQuat q = mpKeyQuat[key][i];
+		cxVec p = mpKeyPos[key][i];
+		cxVec s = mpKeyScl[key][i];
+		if (t > 0.0f && t < 1.0f) {
+			q = nxQuat::slerp(mpKeyQuat[0][i], mpKeyQuat[1][i], t);
+			p = nxVec::lerp(mpKeyPos[0][i], mpKeyPos[1][i], t);
+			s = nxVec::lerp(mpKeyScl[0][i], mpKeyScl[1][i], t);
+		}
+		cxMtx rt;
+		rt.from_quat_and_pos(q, p);
+		pMtxL[i].mk_scl(s);
+		pMtxL[i].mul(rt);
+	}
+}
+
+
+struct sAnimLODOrder {
+	int32_t mPrio;
+	int32_t mIdx;
+};
+
+static int anim_lod_order_cmp(const void* pA, const void* pB) {
+	const sAnimLODOrder* pOrdA = (const sAnimLODOrder*)pA;
+	const sAnimLODOrder* pOrdB = (const sAnimLODOrder*)pB;
+	if (pOrdA->mPrio != pOrdB->mPrio) {
+		return pOrdA->mPrio > pOrdB->mPrio ? -1 : 1;
+	}
+	return pOrdA->mIdx - pOrdB->mIdx;
+}
+
+void cAnimLODScheduler::init(int maxInsts, int budget) {
+	reset();
+	if (maxInsts <= 0) return;
+	mppInsts = (sAnimLODInst**)nxCore::mem_alloc(maxInsts * sizeof(sAnimLODInst*), XD_FOURCC('L', 'O', 'D', 's'));
+	mpOrder = (sAnimLODOrder*)nxCore::mem_alloc(maxInsts * sizeof(sAnimLODOrder), XD_FOURCC('L', 'O', 'D', 'o'));
+	if (!mppInsts || !mpOrder) {
+		reset();
+		return;
+	}
+	mInstsMax = maxInsts;
+	mInstsNum = 0;
+	mBudget = budget;
+	mSpent = 0;
+}
+
+void cAnimLODScheduler::reset() {
+	if (mppInsts) {
+		nxCore::mem_free(mppInsts);
+		mppInsts = nullptr;
+	}
+	if (mpOrder) {
+		nxCore::mem_free(mpOrder);
+		mpOrder = nullptr;
+	}
+	mInstsNum = 0;
+	mInstsMax = 0;
+	mSpent = 0;
+}
+
+bool cAnimLODScheduler::add(sAnimLODInst* pInst) {
+	if (!pInst || !mppInsts) return false;
+	if (mInstsNum >= mInstsMax) return false;
+	mppInsts[mInstsNum++] = pInst;
+	return true;
+}
+
+void cAnimLODScheduler::remove(sAnimLODInst* pInst) {
+	if (!pInst || !mppInsts) return;
+	for (int i = 0; i < mInstsNum; ++i) {
+		if (mppInsts[i] == pInst) {
+			for (int j = i + 1; j < mInstsNum; ++j) {
+				mppInsts[j - 1] = mppInsts[j];
+			}
+			--mInstsNum;
+			break;
+		}
+	}
+}
+
+void cAnimLODScheduler::exec() {
+	mSpent = 0;
+	if (!mppInsts) return;
+	sAnimLODOrder* pOrd = mpOrder;
+	int ndue = 0;
+	for (int i = 0; i < mInstsNum; ++i) {
+		sAnimLODInst* pInst = mppInsts[i];
+		pInst->plan(mParams);
+		if (pInst->mUpdateFlg) {
+			int32_t prio = 0x7FFFFFFF;
+			if (pInst->mKeyFlg) {
+				float late = float(pInst->mCount - pInst->mInterval + 1) / float(pInst->mInterval);
+				prio = (int32_t)nxCalc::min(late * pInst->mImportance * 256.0f, float(0x7FFFFFFE));
+			}
+			pOrd[ndue].mPrio = prio;
+			pOrd[ndue].mIdx = i;
+			++ndue;
+		}
+	}
+	if (ndue <= 0) return;
+	if (mBudget > 0 && ndue > 1) {
+		::qsort(pOrd, ndue, sizeof(sAnimLODOrder), anim_lod_order_cmp);
+	}
+	for (int i = 0; i < ndue; ++i) {
+		sAnimLODInst* pInst = mppInsts[pOrd[i].mIdx];
+		int cost = nxCalc::max(pInst->mCost, 1);
+		bool admit = mBudget <= 0 || !pInst->mKeyFlg || i == 0 || mSpent + cost <= mBudget;
+		if (admit) {
+			mSpent += cost;
+		} else {
+			pInst->mUpdateFlg = false;
+			++pInst->mWait;
+		}
+	}
+}
+
+
+/* rotation angle between two orientations, robust for small angles */
+static float anim_lod_test_ang(const cxQuat& q0, const cxQuat& q1) {
+	float s = q0.dot(q1) < 0.0f ? -1.0f : 1.0f;
+	float u = nxCalc::sq(q0.x - q1.x*s) + nxCalc::sq(q0.y - q1.y*s) + nxCalc::sq(q0.z - q1.z*s) + nxCalc::sq(q0.w - q1.w*s);
+	float v = nxCalc::sq(q0.x + q1.x*s) + nxCalc::sq(q0.y + q1.y*s) + nxCalc::sq(q0.z + q1.z*s) + nxCalc::sq(q0.w + q1.w*s);
+	return 4.0f * ::atan2f(::sqrtf(u), ::sqrtf(v));
+}
+
+static cxQuat anim_lod_test_quat(const cxMtx& m, cxVec* pScl = nullptr) {
+	cxMtx rt;
+	cxVec scl = m.get_scl(&rt);
+	if (pScl) {
+		*pScl = scl;
+	}
+	cxQuat q;
+	q.from_mtx(rt);
+	return q;
+}
+
+struct sAnimLODTestEval {
+	const sxRigData* mpRig;
+	const sAnimLODRig* mpLODRig;
+	sxKeyframesData* mpKfr;
+	sxKeyframesData::RigLink* mpLink;
+	int16_t* mpLst;
+	cxMtx* mpMtxL;
+};
+
+static int anim_lod_test_eval(void* pData, float frame, int skipHgt) {
+	sAnimLODTestEval* pEval = (sAnimLODTestEval*)pData;
+	int n = pEval->mpLODRig->make_link_list(*pEval->mpLink, skipHgt, pEval->mpLst);
+	for (int i = 0; i < n; ++i) {
+		pEval->mpKfr->eval_rig_link_node(pEval->mpLink, pEval->mpLst[i], frame, pEval->mpRig, pEval->mpMtxL);
+	}
+	return n;
+}
+
+#define ANIM_LOD_TEST_INSTS (ANIM_LOD_LVL_NUM + 8)
+
+void anim_lod_test(const sxRigData& rig, sxKeyframesData** ppKfrs, sxKeyframesData::RigLink** ppLinks, int nclips, FILE* pOut) {
+	if (!pOut) {
+		pOut = stdout;
+	}
+	const float posEps = 1.0e-4f;
+	const float angEps = 1.0e-4f;
+	int nnodes = rig.get_nodes_num();
+	if (nnodes <= 0 || !ppKfrs || !ppLinks) return;
+	sAnimLODRig lodRig;
+	lodRig.init(rig);
+	sAnimLODInst insts[ANIM_LOD_TEST_INSTS];
+	cxMtx* pMtxL = (cxMtx*)nxCore::mem_alloc(ANIM_LOD_TEST_INSTS * nnodes * sizeof(cxMtx), XD_TMP_MEM_TAG);
+	cxQuat* pPrevQuat = (cxQuat*)nxCore::mem_alloc(ANIM_LOD_TEST_INSTS * nnodes * sizeof(cxQuat), XD_TMP_MEM_TAG);
+	cxVec* pPrevPos = (cxVec*)nxCore::mem_alloc(ANIM_LOD_TEST_INSTS * nnodes * sizeof(cxVec), XD_TMP_MEM_TAG);
+	float* pMaxAng = (float*)nxCore::mem_alloc(nnodes * sizeof(float), XD_TMP_MEM_TAG);
+	float* pMaxMove = (float*)nxCore::mem_alloc(nnodes * sizeof(float), XD_TMP_MEM_TAG);
+	cxMtx* pFullMtx = (cxMtx*)nxCore::mem_alloc(nnodes * sizeof(cxMtx), XD_TMP_MEM_TAG);
+	int16_t* pLst = (int16_t*)nxCore::mem_alloc(nnodes * sizeof(int16_t), XD_TMP_MEM_TAG);
+	bool memFlg = pMtxL && pPrevQuat && pPrevPos && pMaxAng && pMaxMove && pFullMtx && pLst;
+	for (int i = 0; i < ANIM_LOD_TEST_INSTS; ++i) {
+		insts[i].alloc(nnodes);
+		memFlg &= insts[i].mNodesNum == nnodes;
+	}
+	cAnimLODScheduler lvlSched;
+	cAnimLODScheduler bgtSched;
+	const sAnimLODParams* pParams = lvlSched.get_params();
+	float maxPosErr[ANIM_LOD_LVL_NUM];
+	float maxAngErr[ANIM_LOD_LVL_NUM];
+	float maxSclErr[ANIM_LOD_LVL_NUM];
+	for (int i = 0; i < ANIM_LOD_LVL_NUM; ++i) {
+		maxPosErr[i] = 0.0f;
+		maxAngErr[i] = 0.0f;
+		maxSclErr[i] = 0.0f;
+	}
+	float maxJumpRatio = 0.0f;
+	int nerr = 0;
+	int nerrOnce = 0;
+	int nupd = 0;
+	int nwait = 0;
+	int nfrmTotal = 0;
+	for (int iclip = 0; memFlg && iclip < nclips; ++iclip) {
+		sxKeyframesData* pKfr = ppKfrs[iclip];
+		sxKeyframesData::RigLink* pLink = ppLinks[iclip];
+		if (!pKfr || !pLink) continue;
+		int maxFno = pKfr->get_max_fno();
+		if (maxFno < 2) continue;
+		/* looped twice over, then played once through as a one-shot clip that must not blend back towards its start */
+		for (int ipass = 0; ipass < 2; ++ipass) {
+			bool loop = ipass == 0;
+			/* largest per-frame change of every node over the clip, wrap included when looping */
+			cxMtx* pRefMtx = pMtxL;
+			for (int i = 0; i < nnodes; ++i) {
+				pRefMtx[i] = rig.get_lmtx(i);
+				pMaxAng[i] = 0.0f;
+				pMaxMove[i] = 0.0f;
+			}
+			int nref = loop ? maxFno : maxFno - 1;
+			for (int ifrm = 0; ifrm <= nref; ++ifrm) {
+				pKfr->eval_rig_link(pLink, float(ifrm % maxFno), &rig, pRefMtx);
+				for (int i = 0; i < nnodes; ++i) {
+					cxQuat q = anim_lod_test_quat(pRefMtx[i]);
+					cxVec pos = pRefMtx[i].get_translation();
+					if (ifrm > 0) {
+						pMaxAng[i] = nxCalc::max(pMaxAng[i], anim_lod_test_ang(q, pPrevQuat[i]));
+						pMaxMove[i] = nxCalc::max(pMaxMove[i], nxVec::dist(pos, pPrevPos[i]));
+					}
+					pPrevQuat[i] = q;
+					pPrevPos[i] = pos;
+				}
+			}
+
+			/* one instance per level, then a group competing for a budget that can't update them all */
+			sxRNG rng;
+			nxCore::rng_seed(&rng, iclip + 1);
+			for (int i = 0; i < ANIM_LOD_TEST_INSTS; ++i) {
+				sAnimLODInst* pInst = &insts[i];
+				pInst->invalidate();
+				pInst->mImportance = 1.0f;
+				if (i < ANIM_LOD_LVL_NUM) {
+					pInst->mDist = pParams->mDist[i];
+				} else {
+					pInst->mDist = nxCore::rng_f01(&rng) * pParams->mDist[ANIM_LOD_LVL_NUM - 1] * 1.5f;
+				}
+				cxMtx* pInstMtxL = &pMtxL[i * nnodes];
+				for (int j = 0; j < nnodes; ++j) {
+					pInstMtxL[j] = rig.get_lmtx(j);
+				}
+			}
+			lvlSched.init(ANIM_LOD_LVL_NUM);
+			bgtSched.init(ANIM_LOD_TEST_INSTS - ANIM_LOD_LVL_NUM, pLink->mNodeNum * 3);
+			for (int i = 0; i < ANIM_LOD_TEST_INSTS; ++i) {
+				if (i < ANIM_LOD_LVL_NUM) {
+					lvlSched.add(&insts[i]);
+				} else {
+					bgtSched.add(&insts[i]);
+				}
+			}
+			float jumpRatio[ANIM_LOD_TEST_INSTS];
+			for (int i = 0; i < ANIM_LOD_TEST_INSTS; ++i) {
+				jumpRatio[i] = 1.0f;
+			}
+			for (int i = 0; i < nnodes; ++i) {
+				pFullMtx[i] = rig.get_lmtx(i);
+			}
+			sAnimLODTestEval eval;
+			eval.mpRig = &rig;
+			eval.mpLODRig = &lodRig;
+			eval.mpKfr = pKfr;
+			eval.mpLink = pLink;
+			eval.mpLst = pLst;
+			int nfrm = loop ? (maxFno * 2) + 3 : maxFno;
+			float frame = 0.0f;
+			for (int ifrm = 0; ifrm < nfrm; ++ifrm) {
+				lvlSched.exec();
+				bgtSched.exec();
+				pKfr->eval_rig_link(pLink, frame, &rig, pFullMtx);
+				for (int i = 0; i < ANIM_LOD_TEST_INSTS; ++i) {
+					sAnimLODInst* pInst = &insts[i];
+					cxMtx* pInstMtxL = &pMtxL[i * nnodes];
+					if (pInst->mUpdateFlg || !pInst->mKeyFlg) {
+						int wait = pInst->mWait;
+						int interval = pInst->get_interval();
+						eval.mpMtxL = pInstMtxL;
+						pInst->update(frame, 1.0f, float(maxFno), loop, anim_lod_test_eval, &eval, pInstMtxL);
+						jumpRatio[i] = nxCalc::max(jumpRatio[i], float(interval + wait) / float(interval));
+						++nupd;
+						nwait += wait;
+					}
+					pInst->interpolate(pInstMtxL);
+					pInst->advance();
+					cxQuat* pInstPrevQuat = &pPrevQuat[i * nnodes];
+					cxVec* pInstPrevPos = &pPrevPos[i * nnodes];
+					for (int j = 0; j < nnodes; ++j) {
+						cxVec scl;
+						cxQuat q = anim_lod_test_quat(pInstMtxL[j], &scl);
+						cxVec pos = pInstMtxL[j].get_translation();
+						if (i < ANIM_LOD_LVL_NUM) {
+							cxVec sclRef;
+							cxQuat qref = anim_lod_test_quat(pFullMtx[j], &sclRef);
+							cxVec posRef = pFullMtx[j].get_translation();
+							float posErr = nxVec::dist(pos, posRef);
+							float angErr = anim_lod_test_ang(q, qref);
+							float sclErr = nxVec::dist(scl, sclRef);
+							maxPosErr[i] = nxCalc::max(maxPosErr[i], posErr);
+							maxAngErr[i] = nxCalc::max(maxAngErr[i], angErr);
+							maxSclErr[i] = nxCalc::max(maxSclErr[i], sclErr);
+							/* every frame evaluated in full: interpolation must not change the pose */
+							if (pParams->mInterval[i] <= 1 && pParams->mSkipHgt[i] <= 0) {
+								if (posErr > posEps * (1.0f + posRef.mag()) || angErr > angEps || sclErr > posEps * (1.0f + sclRef.mag())) {
+									++nerr;
+									nerrOnce += loop ? 0 : 1;
+								}
+							}
+						}
+						if (ifrm > 0) {
+							/* stepping between keys is never faster than the clip itself, given the frames a late update skipped */
+							float angLim = pMaxAng[j] * jumpRatio[i] + angEps;
+							float moveLim = pMaxMove[j] * jumpRatio[i] + posEps * (1.0f + pos.mag());
+							float ang = anim_lod_test_ang(q, pInstPrevQuat[j]);
+							float move = nxVec::dist(pos, pInstPrevPos[j]);
+							if (ang > angLim || move > moveLim) {
+								++nerr;
+								nerrOnce += loop ? 0 : 1;
+							}
+							if (pMaxAng[j] > 1.0e-3f) {
+								maxJumpRatio = nxCalc::max(maxJumpRatio, ang / pMaxAng[j]);
+							}
+							if (pMaxMove[j] > 1.0e-3f) {
+								maxJumpRatio = nxCalc::max(maxJumpRatio, move / pMaxMove[j]);
+							}
+						}
+						pInstPrevQuat[j] = q;
+						pInstPrevPos[j] = pos;
+					}
+				}
+				frame += 1.0f;
+				if (frame >= float(maxFno)) {
+					frame = 0.0f;
+				}
+			}
+			nfrmTotal += nfrm;
+		}
+	}
+	if (memFlg) {
+		for (int i = 0; i < ANIM_LOD_LVL_NUM; ++i) {
+			::fprintf(pOut, "anim LOD %d: interval %d, skip height %d: max err pos %g, rot %g deg, scale %g\n", i, pParams->mInterval[i], pParams->mSkipHgt[i], maxPosErr[i], XD_RAD2DEG(maxAngErr[i]), maxSclErr[i]);
+		}
+		::fprintf(pOut, "anim LOD: %d clips, %d frames, %d updates, %d frames waited, max step %.2f x clip step, %d errors (%d one-shot)\n", nclips, nfrmTotal, nupd, nwait, maxJumpRatio, nerr, nerrOnce);
+	} else {
+		::fprintf(pOut, "anim LOD: can't allocate test data\n");
+	}
+	for (int i = 0; i < ANIM_LOD_TEST_INSTS; ++i) {
+		insts[i].free();
+	}
+	lodRig.free();
+	nxCore::mem_free(pMtxL);
+	nxCore::mem_free(pPrevQuat);
+	nxCore::mem_free(pPrevPos);
+	nxCore::mem_free(pMaxAng);
+	nxCore::mem_free(pMaxMove);
+	nxCore::mem_free(pFullMtx);
+	nxCore::mem_free(pLst);
+}
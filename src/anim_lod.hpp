@@ -0,0 +1,118 @@
+#define ANIM_LOD_LVL_NUM 4
+
+struct sAnimLODParams {
+	float mDist[ANIM_LOD_LVL_NUM];       /* view distance at which the level starts */
+	int32_t mInterval[ANIM_LOD_LVL_NUM]; /* frames between evaluations */
+	int32_t mSkipHgt[ANIM_LOD_LVL_NUM];  /* nodes with subtree height below this are not evaluated */
+
+	void set_defaults();
+	int calc_lvl(float dist, float importance = 1.0f) const;
+};
+
+struct sAnimLODRig {
+	const sxRigData* mpRig;
+	uint8_t* mpHgt;
+	uint8_t* mpLock;
+	int mNodesNum;
+	int mMaxHgt;
+
+	sAnimLODRig() : mpRig(nullptr), mpHgt(nullptr), mpLock(nullptr), mNodesNum(0), mMaxHgt(0) {}
+
+	void init(const sxRigData& rig);
+	void free();
+
+	bool ck_node_idx(int idx) const { return (uint32_t)idx < (uint32_t)mNodesNum; }
+	int get_hgt(int idx) const { return ck_node_idx(idx) && mpHgt ? mpHgt[idx] : 0; }
+	bool is_locked(int idx) const { return ck_node_idx(idx) && mpLock ? !!mpLock[idx] : false; }
+	bool is_active(int idx, int skipHgt) const { return is_locked(idx) || get_hgt(idx) >= skipHgt; }
+
+	void lock_node(int idx, bool withParents = true);
+	void lock_node(const char* pName, bool withParents = true) { lock_node(mpRig ? mpRig->find_node(pName) : -1, withParents); }
+
+	int make_link_list(const sxKeyframesData::RigLink& link, int skipHgt, int16_t* pLst) const;
+};
+
+struct sAnimLODInst {
+	/* evaluates the nodes of the clip not skipped at skipHgt into the local matrices, returns the number of nodes evaluated */
+	typedef int (*EvalFunc)(void* pData, float frame, int skipHgt);
+
+	cxQuat* mpKeyQuat[2];
+	cxVec* mpKeyPos[2];
+	cxVec* mpKeyScl[2];
+	int mNodesNum;
+	float mDist;
+	float mImportance;
+	int mLvl;
+	int mSkipHgt;
+	int mCost;
+	int mCount;
+	int mInterval;
+	int mNextInterval;
+	int mWait;
+	bool mKeyFlg;
+	bool mUpdateFlg;
+
+	sAnimLODInst() : mNodesNum(0), mDist(0.0f), mImportance(1.0f), mLvl(0), mSkipHgt(0), mCost(0),
+	mCount(0), mInterval(1), mNextInterval(1), mWait(0), mKeyFlg(false), mUpdateFlg(true) {
+		for (int i = 0; i < 2; ++i) {
+			mpKeyQuat[i] = nullptr;
+			mpKeyPos[i] = nullptr;
+			mpKeyScl[i] = nullptr;
+		}
+	}
+
+	void alloc(int nnodes);
+	void free();
+
+	void invalidate() {
+		mKeyFlg = false;
+		mUpdateFlg = true;
+	}
+
+	bool is_due() const { return !mKeyFlg || mCount >= mInterval; }
+	void plan(const sAnimLODParams& params);
+	int get_interval() const { return mNextInterval; }
+
+	void store_key(const cxMtx* pMtxL);
+	float calc_key_frame(float frame, float frameStep, float maxFrame, bool loop) const;
+	void update(float frame, float frameStep, float maxFrame, bool loop, EvalFunc func, void* pData, cxMtx* pMtxL);
+	float get_interp_t() const { return mInterval > 0 ? nxCalc::saturate(float(mCount) / float(mInterval)) : 1.0f; }
+	void interpolate(cxMtx* pMtxL) const;
+	void advance() { ++mCount; }
+};
+
+struct sAnimLODOrder;
+
+class cAnimLODScheduler {
+protected:
+	sAnimLODParams mParams;
+	sAnimLODInst** mppInsts;
+	sAnimLODOrder* mpOrder;
+	int mInstsNum;
+	int mInstsMax;
+	int mBudget;
+	int mSpent;
+
+public:
+	cAnimLODScheduler() : mppInsts(nullptr), mpOrder(nullptr), mInstsNum(0), mInstsMax(0), mBudget(0), mSpent(0) {
+		mParams.set_defaults();
+	}
+	~cAnimLODScheduler() { reset(); }
+
+	void init(int maxInsts, int budget = 0);
+	void reset();
+
+	sAnimLODParams* get_params() { return &mParams; }
+	void set_budget(int budget) { mBudget = budget; }
+	int get_budget() const { return mBudget; }
+	int get_spent() const { return mSpent; }
+
+	bool add(sAnimLODInst* pInst);
+	void remove(sAnimLODInst* pInst);
+
+	void exec();
+};
+
+/* checks interpolated poses of every level against full evaluation, running each clip looped and then once through:
+   level 0 must match, and no level may step further per frame than the clip does (scaled by the frames a late update skipped) */
+void anim_lod_test(const sxRigData& rig, sxKeyframesData** ppKfrs, sxKeyframesData::RigLink** ppLinks, int nclips, FILE* pOut = nullptr);
@@ -4,6 +4,8 @@
 
 #include "crossdata.hpp"
 
+#include <new>
+
 namespace nxSys {
 
 FILE* x_fopen(const char* fpath, const char* mode) {
@@ -5915,6 +5917,429 @@ void sxGeometryData::range_query(const cxAABB& box, RangeFunc& fun) const {
 	}
 }
 
+void sxGeometryData::FlatBVH::create(const sxGeometryData& geo) {
+	destroy();
+	mpGeo = &geo;
+	BVH* pBVH = geo.get_BVH();
+	if (!pBVH || pBVH->mNodesNum == 0) return;
+	int n = (int)pBVH->mNodesNum;
+	mpNodes = (Node*)nxCore::mem_alloc(n * sizeof(Node), XD_FOURCC('F', 'B', 'V', 'H'));
+	int* pStk = (int*)nxCore::mem_alloc(n * 2 * sizeof(int), XD_TMP_MEM_TAG);
+	if (!mpNodes || !pStk) {
+		nxCore::mem_free(pStk);
+		destroy();
+		mpGeo = &geo;
+		return;
+	}
+	/* pre-order walk; a node's skip link is patched when its subtree is done */
+	int cnt = 0;
+	int sp = 0;
+	pStk[sp++] = 0;
+	while (sp > 0) {
+		int nodeId = pStk[--sp];
+		if (nodeId < 0) {
+			mpNodes[-nodeId - 1].mSkip = cnt;
+			continue;
+		}
+		BVH::Node* pSrc = geo.get_BVH_node(nodeId);
+		if (!pSrc || cnt >= n || sp + 3 > n * 2) {
+			cnt = 0;
+			break;
+		}
+		int dstIdx = cnt++;
+		Node* pDst = &mpNodes[dstIdx];
+		pDst->mBBox = pSrc->mBBox;
+		if (pSrc->is_leaf()) {
+			pDst->mPolId = pSrc->get_pol_id();
+			pDst->mSkip = cnt;
+		} else {
+			pDst->mPolId = -1;
+			pStk[sp++] = -dstIdx - 1;
+			pStk[sp++] = pSrc->mRight;
+			pStk[sp++] = pSrc->mLeft;
+		}
+	}
+	nxCore::mem_free(pStk);
+	if (cnt > 0) {
+		mNodesNum = cnt;
+	} else {
+		destroy();
+		mpGeo = &geo;
+	}
+}
+
+void sxGeometryData::FlatBVH::destroy() {
+	if (mpNodes) {
+		nxCore::mem_free(mpNodes);
+	}
+	mpNodes = nullptr;
+	mNodesNum = 0;
+	mpGeo = nullptr;
+}
+
+#define XD_RAY_PKT_SIZE sxGeometryData::FlatBVH::PACKET_SIZE
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#	define XD_RAY_PKT_SSE 1
+#	include <emmintrin.h>
+#else
+#	define XD_RAY_PKT_SSE 0
+#endif
+
+#define XD_RAY_PKT_TOL 1.0e-5f
+
+/* SoA segments; tests are conservative, exact per-ray tests confirm the candidates */
+struct sxRayPacket {
+	float mOrg[3][XD_RAY_PKT_SIZE];
+	float mDir[3][XD_RAY_PKT_SIZE];
+	float mInv[3][XD_RAY_PKT_SIZE];
+	float mOrgInv[3][XD_RAY_PKT_SIZE];
+	float mDirL1[XD_RAY_PKT_SIZE];
+	float mTMax[XD_RAY_PKT_SIZE];
+	float mPktMin[3];
+	float mPktMax[3];
+	float mTol;
+	uint32_t mMask;
+
+	void init(const cxLineSeg* pSegs, int n, const cxAABB& bbox) {
+		mMask = n > 0 ? (1U << n) - 1 : 0;
+		/* a lone segment is traced with its own SegQuery */
+		if (n < 2) return;
+		cxAABB pktBBox;
+		pktBBox.init();
+		/* lanes past n only fill out the last group of 4 */
+		int nfill = nxCalc::min((n + 3) & ~3, XD_RAY_PKT_SIZE);
+		for (int i = 0; i < nfill; ++i) {
+			cxVec p0(0.0f);
+			cxVec dir(0.0f);
+			if (i < n) {
+				p0 = pSegs[i].get_pos0();
+				dir = pSegs[i].get_dir();
+				pktBBox.add_pnt(p0);
+				pktBBox.add_pnt(pSegs[i].get_pos1());
+			}
+			float o[3] = { p0.x, p0.y, p0.z };
+			float d[3] = { dir.x, dir.y, dir.z };
+			for (int j = 0; j < 3; ++j) {
+				mOrg[j][i] = o[j];
+				mDir[j][i] = d[j];
+				mInv[j][i] = d[j] != 0.0f ? 1.0f / d[j] : 1.0e30f;
+				mOrgInv[j][i] = o[j] * mInv[j][i];
+			}
+			mDirL1[i] = ::fabsf(d[0]) + ::fabsf(d[1]) + ::fabsf(d[2]);
+			mTMax[i] = i < n ? 1.0f : -1.0f;
+		}
+		pktBBox.get_min_pos().to_mem(mPktMin);
+		pktBBox.get_max_pos().to_mem(mPktMax);
+		/* scaled to the largest coordinate involved, absorbs rounding differences from the exact tests */
+		float absMax = nxCalc::max(bbox.get_min_pos().max_abs_elem(), bbox.get_max_pos().max_abs_elem());
+		for (int j = 0; j < 3; ++j) {
+			absMax = nxCalc::max(absMax, nxCalc::max(::fabsf(mPktMin[j]), ::fabsf(mPktMax[j])));
+		}
+		mTol = XD_RAY_PKT_TOL * (1.0f + absMax);
+		for (int j = 0; j < 3; ++j) {
+			mPktMin[j] -= mTol;
+			mPktMax[j] += mTol;
+		}
+	}
+
+	void clip(int lane, float t) {
+		mTMax[lane] = nxCalc::min(mTMax[lane], t * (1.0f + XD_RAY_PKT_TOL) + XD_RAY_PKT_TOL);
+	}
+
+	uint32_t box_mask(const cxAABB& box) const {
+		cxVec bmin = box.get_min_pos();
+		cxVec bmax = box.get_max_pos();
+		float lo[3] = { bmin.x - mTol, bmin.y - mTol, bmin.z - mTol };
+		float hi[3] = { bmax.x + mTol, bmax.y + mTol, bmax.z + mTol };
+		for (int j = 0; j < 3; ++j) {
+			if (mPktMin[j] > hi[j] || mPktMax[j] < lo[j]) return 0;
+		}
+		uint32_t mask = 0;
+#if XD_RAY_PKT_SSE
+		for (int c = 0; c < XD_RAY_PKT_SIZE; c += 4) {
+			if (!((mMask >> c) & 0xF)) break;
+			__m128 tmin = _mm_setzero_ps();
+			__m128 tmax = _mm_loadu_ps(&mTMax[c]);
+			for (int j = 0; j < 3; ++j) {
+				__m128 inv = _mm_loadu_ps(&mInv[j][c]);
+				__m128 ofs = _mm_loadu_ps(&mOrgInv[j][c]);
+				__m128 t1 = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(lo[j]), inv), ofs);
+				__m128 t2 = _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(hi[j]), inv), ofs);
+				tmin = _mm_max_ps(tmin, _mm_min_ps(t1, t2));
+				tmax = _mm_min_ps(tmax, _mm_max_ps(t1, t2));
+			}
+			mask |= uint32_t(_mm_movemask_ps(_mm_cmple_ps(tmin, tmax))) << c;
+		}
+#else
+		for (int i = 0; i < XD_RAY_PKT_SIZE; ++i) {
+			float tmin = 0.0f;
+			float tmax = mTMax[i];
+			for (int j = 0; j < 3; ++j) {
+				float t1 = lo[j] * mInv[j][i] - mOrgInv[j][i];
+				float t2 = hi[j] * mInv[j][i] - mOrgInv[j][i];
+				tmin = nxCalc::max(tmin, nxCalc::min(t1, t2));
+				tmax = nxCalc::min(tmax, nxCalc::max(t1, t2));
+			}
+			if (tmin <= tmax) {
+				mask |= 1U << i;
+			}
+		}
+#endif
+		return mask & mMask;
+	}
+
+	/* passes segments that may cross the triangle from either side */
+	uint32_t tri_mask(const cxVec& v0, const cxVec& v1, const cxVec& v2, uint32_t mask) const {
+		if (!mask) return 0;
+		cxVec vtx[3] = { v0, v1, v2 };
+		cxVec edge[3] = { v1 - v0, v2 - v1, v0 - v2 };
+		cxVec n = nxVec::cross(edge[0], v2 - v0);
+		float nL1 = ::fabsf(n.x) + ::fabsf(n.y) + ::fabsf(n.z);
+		float eL1[3];
+		for (int k = 0; k < 3; ++k) {
+			eL1[k] = ::fabsf(edge[k].x) + ::fabsf(edge[k].y) + ::fabsf(edge[k].z);
+		}
+		uint32_t res = 0;
+#if XD_RAY_PKT_SSE
+		const __m128 absMsk = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+		const __m128 tol = _mm_set1_ps(XD_RAY_PKT_TOL);
+		const __m128 zero = _mm_setzero_ps();
+		for (int c = 0; c < XD_RAY_PKT_SIZE; c += 4) {
+			if (!((mask >> c) & 0xF)) continue;
+			__m128 dx = _mm_loadu_ps(&mDir[0][c]);
+			__m128 dy = _mm_loadu_ps(&mDir[1][c]);
+			__m128 dz = _mm_loadu_ps(&mDir[2][c]);
+			__m128 dL1 = _mm_loadu_ps(&mDirL1[c]);
+			__m128 ox = _mm_loadu_ps(&mOrg[0][c]);
+			__m128 oy = _mm_loadu_ps(&mOrg[1][c]);
+			__m128 oz = _mm_loadu_ps(&mOrg[2][c]);
+			__m128 pos = _mm_cmpge_ps(dL1, zero);
+			__m128 neg = pos;
+			__m128 plane = zero;
+			for (int k = 0; k < 3; ++k) {
+				__m128 vx = _mm_sub_ps(ox, _mm_set1_ps(vtx[k].x));
+				__m128 vy = _mm_sub_ps(oy, _mm_set1_ps(vtx[k].y));
+				__m128 vz = _mm_sub_ps(oz, _mm_set1_ps(vtx[k].z));
+				__m128 vL1 = _mm_add_ps(_mm_add_ps(_mm_and_ps(vx, absMsk), _mm_and_ps(vy, absMsk)), _mm_and_ps(vz, absMsk));
+				if (k == 0) {
+					__m128 d0 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, _mm_set1_ps(n.x)), _mm_mul_ps(vy, _mm_set1_ps(n.y))), _mm_mul_ps(vz, _mm_set1_ps(n.z)));
+					__m128 dn = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, _mm_set1_ps(n.x)), _mm_mul_ps(dy, _mm_set1_ps(n.y))), _mm_mul_ps(dz, _mm_set1_ps(n.z)));
+					__m128 d1 = _mm_add_ps(d0, dn);
+					__m128 tolP = _mm_mul_ps(_mm_mul_ps(_mm_add_ps(vL1, dL1), _mm_set1_ps(nL1)), tol);
+					plane = _mm_cmple_ps(_mm_mul_ps(d0, d1), zero);
+					plane = _mm_or_ps(plane, _mm_cmple_ps(_mm_and_ps(d0, absMsk), tolP));
+					plane = _mm_or_ps(plane, _mm_cmple_ps(_mm_and_ps(d1, absMsk), tolP));
+				}
+				__m128 cx = _mm_sub_ps(_mm_mul_ps(dy, vz), _mm_mul_ps(dz, vy));
+				__m128 cy = _mm_sub_ps(_mm_mul_ps(dz, vx), _mm_mul_ps(dx, vz));
+				__m128 cz = _mm_sub_ps(_mm_mul_ps(dx, vy), _mm_mul_ps(dy, vx));
+				__m128 t = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(edge[k].x)), _mm_mul_ps(cy, _mm_set1_ps(edge[k].y))), _mm_mul_ps(cz, _mm_set1_ps(edge[k].z)));
+				__m128 tolT = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(vL1, dL1), _mm_set1_ps(eL1[k])), tol);
+				pos = _mm_and_ps(pos, _mm_cmpge_ps(t, _mm_sub_ps(zero, tolT)));
+				neg = _mm_and_ps(neg, _mm_cmple_ps(t, tolT));
+			}
+			__m128 ok = _mm_and_ps(plane, _mm_or_ps(pos, neg));
+			res |= uint32_t(_mm_movemask_ps(ok)) << c;
+		}
+#else
+		for (int i = 0; i < XD_RAY_PKT_SIZE; ++i) {
+			if (!(mask & (1U << i))) continue;
+			cxVec dir(mDir[0][i], mDir[1][i], mDir[2][i]);
+			cxVec org(mOrg[0][i], mOrg[1][i], mOrg[2][i]);
+			bool pos = true;
+			bool neg = true;
+			bool plane = false;
+			for (int k = 0; k < 3; ++k) {
+				cxVec v = org - vtx[k];
+				float vL1 = ::fabsf(v.x) + ::fabsf(v.y) + ::fabsf(v.z);
+				if (k == 0) {
+					float d0 = v.dot(n);
+					float d1 = d0 + dir.dot(n);
+					float tolP = (vL1 + mDirL1[i]) * nL1 * XD_RAY_PKT_TOL;
+					plane = d0*d1 <= 0.0f || ::fabsf(d0) <= tolP || ::fabsf(d1) <= tolP;
+				}
+				float t = nxVec::cross(dir, v).dot(edge[k]);
+				float tolT = vL1 * mDirL1[i] * eL1[k] * XD_RAY_PKT_TOL;
+				pos = pos && t >= -tolT;
+				neg = neg && t <= tolT;
+			}
+			if (plane && (pos || neg)) {
+				res |= 1U << i;
+			}
+		}
+#endif
+		return res & mask;
+	}
+};
+
+static int ray_pkt_stream_cmp(const void* pA, const void* pB) {
+	const uint32_t* pItemA = (const uint32_t*)pA;
+	const uint32_t* pItemB = (const uint32_t*)pB;
+	if (pItemA[0] != pItemB[0]) {
+		return pItemA[0] < pItemB[0] ? -1 : 1;
+	}
+	return int(pItemA[1]) - int(pItemB[1]);
+}
+
+static uint32_t ray_pkt_morton_spread(uint32_t x) {
+	x &= 0x3FF;
+	x = (x | (x << 16)) & 0x030000FF;
+	x = (x | (x << 8)) & 0x0300F00F;
+	x = (x | (x << 4)) & 0x030C30C3;
+	x = (x | (x << 2)) & 0x09249249;
+	return x;
+}
+
+/* pSort: nseg (key, segment index) pairs ordered by direction octant, then by Morton code of the origin in bbox */
+static void ray_pkt_stream_sort(const cxLineSeg* pSegs, const int nseg, const cxAABB& bbox, int32_t* pSort) {
+	cxVec bbMin = bbox.get_min_pos();
+	cxVec bbSize = bbox.get_size_vec();
+	float sx = nxCalc::rcp0(bbSize.x) * 1023.0f;
+	float sy = nxCalc::rcp0(bbSize.y) * 1023.0f;
+	float sz = nxCalc::rcp0(bbSize.z) * 1023.0f;
+	for (int i = 0; i < nseg; ++i) {
+		cxVec org = pSegs[i].get_pos0();
+		cxVec dir = pSegs[i].get_dir();
+		uint32_t oct = (dir.x < 0.0f ? 1 : 0) | (dir.y < 0.0f ? 2 : 0) | (dir.z < 0.0f ? 4 : 0);
+		uint32_t ix = (uint32_t)nxCalc::clamp((org.x - bbMin.x) * sx, 0.0f, 1023.0f);
+		uint32_t iy = (uint32_t)nxCalc::clamp((org.y - bbMin.y) * sy, 0.0f, 1023.0f);
+		uint32_t iz = (uint32_t)nxCalc::clamp((org.z - bbMin.z) * sz, 0.0f, 1023.0f);
+		uint32_t code = ray_pkt_morton_spread(ix) | (ray_pkt_morton_spread(iy) << 1) | (ray_pkt_morton_spread(iz) << 2);
+		pSort[i * 2] = (int32_t)((oct << 29) | (code >> 1));
+		pSort[i * 2 + 1] = i;
+	}
+	::qsort(pSort, nseg, sizeof(int32_t) * 2, ray_pkt_stream_cmp);
+}
+
+static void flat_bvh_nearest_hit_upd(sxGeometryData::FlatBVH::NearestHit* pHit, const cxVec& pos, const cxVec& nrm, float dist, int polId) {
+	if (pHit->mPolId < 0 || dist < pHit->mDist) {
+		pHit->mPos = pos;
+		pHit->mNrm = nrm;
+		pHit->mDist = dist;
+		pHit->mPolId = polId;
+	}
+}
+
+struct sxFlatBVHNearestFunc {
+	sxGeometryData::FlatBVH::NearestHit* mpHit;
+
+	bool operator()(const sxGeometryData::Polygon& pol, const cxVec& hitPos, const cxVec& hitNrm, float hitDist) {
+		flat_bvh_nearest_hit_upd(mpHit, hitPos, hitNrm, hitDist, pol.get_id());
+		return true;
+	}
+};
+
+static void flat_bvh_nearest_hit_init(sxGeometryData::FlatBVH::NearestHit* pHit, const cxLineSeg& seg) {
+	pHit->mPos = seg.get_pos0();
+	pHit->mNrm.zero();
+	pHit->mDist = 0.0f;
+	pHit->mPolId = -1;
+}
+
+sxGeometryData::FlatBVH::NearestHit sxGeometryData::FlatBVH::nearest_hit(const cxLineSeg& seg) const {
+	NearestHit hit;
+	nearest_hits(&seg, &hit, 1);
+	return hit;
+}
+
+/* number of sorted segments from org on that make up the next packet, which never mixes direction octants */
+static int ray_pkt_stream_next(const int32_t* pSort, const int org, const int nseg, const int nmax) {
+	uint32_t oct = uint32_t(pSort[org * 2]) >> 29;
+	int nlim = nxCalc::min(nseg - org, nmax);
+	int n = 1;
+	while (n < nlim && (uint32_t(pSort[(org + n) * 2]) >> 29) == oct) {
+		++n;
+	}
+	return n;
+}
+
+void sxGeometryData::FlatBVH::nearest_hit_stream(const cxLineSeg* pSegs, NearestHit* pHits, int nseg, int32_t* pWk) const {
+	if (!pSegs || !pHits || nseg <= 0) return;
+	int32_t* pSort = mpGeo ? (pWk ? pWk : (int32_t*)nxCore::mem_alloc(nseg * 2 * sizeof(int32_t), XD_TMP_MEM_TAG)) : nullptr;
+	if (!pSort) {
+		for (int i = 0; i < nseg; i += PACKET_SIZE) {
+			nearest_hits(&pSegs[i], &pHits[i], nxCalc::min(nseg - i, PACKET_SIZE));
+		}
+		return;
+	}
+	ray_pkt_stream_sort(pSegs, nseg, mpGeo->mBBox, pSort);
+	cxLineSeg segs[PACKET_SIZE];
+	NearestHit hits[PACKET_SIZE];
+	int i = 0;
+	while (i < nseg) {
+		int n = ray_pkt_stream_next(pSort, i, nseg, PACKET_SIZE);
+		for (int j = 0; j < n; ++j) {
+			segs[j] = pSegs[pSort[(i + j) * 2 + 1]];
+		}
+		nearest_hits(segs, hits, n);
+		for (int j = 0; j < n; ++j) {
+			pHits[pSort[(i + j) * 2 + 1]] = hits[j];
+		}
+		i += n;
+	}
+	if (pSort != pWk) {
+		nxCore::mem_free(pSort);
+	}
+}
+
+/* the one traversal behind nearest_hit() and nearest_hit_stream(): packet slab and triangle tests only cull,
+   each segment keeps its own SegQuery gate and exact test, so it finds what it would find traced alone */
+void sxGeometryData::FlatBVH::nearest_hits(const cxLineSeg* pSegs, NearestHit* pHits, int nseg) const {
+	nseg = nxCalc::min(nseg, PACKET_SIZE);
+	for (int i = 0; i < nseg; ++i) {
+		flat_bvh_nearest_hit_init(&pHits[i], pSegs[i]);
+	}
+	if (!mpGeo) return;
+	if (!mpNodes) {
+		for (int i = 0; i < nseg; ++i) {
+			sxFlatBVHNearestFunc fn;
+			fn.mpHit = &pHits[i];
+			hit_query(pSegs[i], fn);
+		}
+		return;
+	}
+	sxRayPacket pkt;
+	pkt.init(pSegs, nseg, mpGeo->mBBox);
+	SegQuery qry[PACKET_SIZE];
+	float segLen[PACKET_SIZE];
+	for (int i = 0; i < nseg; ++i) {
+		qry[i].init(pSegs[i]);
+		segLen[i] = pSegs[i].get_dir().mag();
+	}
+	const Node* pNodes = mpNodes;
+	int n = mNodesNum;
+	int idx = 0;
+	while (idx < n) {
+		const Node* pNode = &pNodes[idx];
+		uint32_t mask = nseg > 1 ? pkt.box_mask(pNode->mBBox) : (qry[0].ck(pNode->mBBox) ? 1U : 0U);
+		if (mask) {
+			if (pNode->is_leaf()) {
+				Polygon pol = mpGeo->get_pol(pNode->mPolId);
+				if ((mask & (mask - 1)) && pol.get_vtx_num() == 3) {
+					mask = pkt.tri_mask(pol.get_vtx_pos(0), pol.get_vtx_pos(1), pol.get_vtx_pos(2), mask);
+				}
+				for (int i = 0; i < nseg; ++i) {
+					if (!(mask & (1U << i))) continue;
+					/* same gate as the single-segment path, a lone segment has just passed it */
+					if (nseg > 1 && !qry[i].ck(pNode->mBBox)) continue;
+					const cxLineSeg& seg = pSegs[i];
+					cxVec hitPos;
+					cxVec hitNrm;
+					if (pol.intersect(seg, &hitPos, &hitNrm)) {
+						float hitDist = nxVec::dist(seg.get_pos0(), hitPos);
+						flat_bvh_nearest_hit_upd(&pHits[i], hitPos, hitNrm, hitDist, pNode->mPolId);
+						pkt.clip(i, nxCalc::div0(hitDist, segLen[i]));
+					}
+				}
+			}
+			++idx;
+		} else {
+			idx = pNode->mSkip;
+		}
+	}
+}
+
 cxAABB sxGeometryData::calc_world_bbox(cxMtx* pMtxW, int* pIdxMap) const {
 	cxAABB bbox = mBBox;
 	if (pMtxW) {
@@ -5945,6 +6370,66 @@ cxAABB sxGeometryData::calc_world_bbox(cxMtx* pMtxW, int* pIdxMap) const {
 	return bbox;
 }
 
+cxAABB sxGeometryData::calc_pnt_bbox(const cxMtx* pMtx) const {
+	cxAABB bbox;
+	bbox.init();
+	int npnt = get_pnt_num();
+	if (pMtx) {
+		for (int i = 0; i < npnt; ++i) {
+			bbox.add_pnt(pMtx->calc_pnt(get_pnt(i)));
+		}
+	} else {
+		for (int i = 0; i < npnt; ++i) {
+			bbox.add_pnt(get_pnt(i));
+		}
+	}
+	return bbox;
+}
+
+cxVec sxGeometryData::calc_tri_tangent(int triIdx, int texAttrIdx) const {
+	cxVec triPts[3];
+	xt_texcoord triUVs[3];
+	Polygon tri = get_pol(triIdx);
+	for (int j = 0; j < 3; ++j) {
+		int pid = tri.get_vtx_pnt_id(j);
+		triPts[j] = get_pnt(pid);
+		float* pUVData = get_attr_data_f(texAttrIdx, eAttrClass::POINT, pid, 2);
+		if (pUVData) {
+			triUVs[j].set(pUVData[0], pUVData[1]);
+		} else {
+			triUVs[j].set(0.0f, 0.0f);
+		}
+	}
+	cxVec dp1 = triPts[1] - triPts[0];
+	cxVec dp2 = triPts[2] - triPts[0];
+	xt_texcoord dt1;
+	dt1.set(triUVs[1].u - triUVs[0].u, triUVs[1].v - triUVs[0].v);
+	xt_texcoord dt2;
+	dt2.set(triUVs[2].u - triUVs[0].u, triUVs[2].v - triUVs[0].v);
+	float d = nxCalc::rcp0(dt1.u*dt2.v - dt1.v*dt2.u);
+	return (dp1*dt2.v - dp2*dt1.v) * d;
+}
+
+cxVec sxGeometryData::calc_pnt_tangent(int pntIdx, int nrmAttrIdx, const cxVec& tngSum, bool flip) const {
+	cxVec nrm;
+	float* pData = get_attr_data_f(nrmAttrIdx, eAttrClass::POINT, pntIdx, 3);
+	if (pData) {
+		nrm.from_mem(pData);
+	} else {
+		nrm.zero();
+	}
+	float d = nrm.dot(tngSum);
+	nrm.scl(d);
+	cxVec tng;
+	if (flip) {
+		tng = nrm - tngSum;
+	} else {
+		tng = tngSum - nrm;
+	}
+	tng.normalize();
+	return tng;
+}
+
 void sxGeometryData::calc_tangents(cxVec* pTng, bool flip, const char* pAttrName) const {
 	if (!pTng) return;
 	int npnt = get_pnt_num();
@@ -5955,46 +6440,16 @@ void sxGeometryData::calc_tangents(cxVec* pTng, bool flip, const char* pAttrName
 	int texAttrIdx = find_pnt_attr(pAttrName ? pAttrName : "uv");
 	if (texAttrIdx < 0) return;
 	int ntri = get_pol_num();
-	cxVec triPts[3];
-	xt_texcoord triUVs[3];
+	/* summed in polygon order, parallel versions must keep this order to match bit for bit */
 	for (int i = 0; i < ntri; ++i) {
+		cxVec tu = calc_tri_tangent(i, texAttrIdx);
 		Polygon tri = get_pol(i);
 		for (int j = 0; j < 3; ++j) {
-			int pid = tri.get_vtx_pnt_id(j);
-			triPts[j] = get_pnt(pid);
-			float* pUVData = get_attr_data_f(texAttrIdx, eAttrClass::POINT, pid, 2);
-			if (pUVData) {
-				triUVs[j].set(pUVData[0], pUVData[1]);
-			} else {
-				triUVs[j].set(0.0f, 0.0f);
-			}
-			cxVec dp1 = triPts[1] - triPts[0];
-			cxVec dp2 = triPts[2] - triPts[0];
-			xt_texcoord dt1;
-			dt1.set(triUVs[1].u - triUVs[0].u, triUVs[1].v - triUVs[0].v);
-			xt_texcoord dt2;
-			dt2.set(triUVs[2].u - triUVs[0].u, triUVs[2].v - triUVs[0].v);
-			float d = nxCalc::rcp0(dt1.u*dt2.v - dt1.v*dt2.u);
-			cxVec tu = (dp1*dt2.v - dp2*dt1.v) * d;
-			pTng[pid] = tu;
+			pTng[tri.get_vtx_pnt_id(j)].add(tu);
 		}
 	}
 	for (int i = 0; i < npnt; ++i) {
-		cxVec nrm;
-		float* pData = get_attr_data_f(nrmAttrIdx, eAttrClass::POINT, i, 3);
-		if (pData) {
-			nrm.from_mem(pData);
-		} else {
-			nrm.zero();
-		}
-		float d = nrm.dot(pTng[i]);
-		nrm.scl(d);
-		if (flip) {
-			pTng[i] = nrm - pTng[i];
-		} else {
-			pTng[i].sub(nrm);
-		}
-		pTng[i].normalize();
+		pTng[i] = calc_pnt_tangent(i, nrmAttrIdx, pTng[i], flip);
 	}
 }
 
@@ -6014,6 +6469,26 @@ void* sxGeometryData::alloc_triangulation_wk() const {
 	return pWk;
 }
 
+sxGeometryData::DisplayList* sxGeometryData::create_display_list(const char* pBatGrpPrefix, bool triangulate, uint32_t optFlags) const {
+	DisplayList* pLst = (DisplayList*)nxCore::mem_alloc(sizeof(DisplayList), XD_FOURCC('G', 'D', 'L', 'S'));
+	if (pLst) {
+		::new ((void*)pLst) DisplayList();
+		pLst->create(*this, pBatGrpPrefix, triangulate, optFlags);
+		if (!pLst->is_valid()) {
+			release_display_list(pLst);
+			pLst = nullptr;
+		}
+	}
+	return pLst;
+}
+
+void sxGeometryData::release_display_list(DisplayList* pLst) {
+	if (pLst) {
+		pLst->~DisplayList();
+		nxCore::mem_free(pLst);
+	}
+}
+
 uint8_t* sxGeometryData::Polygon::get_vtx_lst() const {
 	uint8_t* pLst = nullptr;
 	if (is_valid()) {
@@ -6394,7 +6869,257 @@ uint16_t* sxGeometryData::Group::get_skin_ids() const {
 	return pLst;
 }
 
-void sxGeometryData::DisplayList::create(const sxGeometryData& geo, const char* pBatGrpPrefix, bool triangulate) {
+namespace nxVtxCache {
+
+template<typename T> static void calc_stats_sub(sxVtxCacheStats* pStats, const T* pIdx, int ntri, int nvtx, int cacheSize) {
+	if (!pStats) return;
+	pStats->reset();
+	if (!pIdx || ntri <= 0 || nvtx <= 0) return;
+	uint32_t* pStamps = (uint32_t*)nxCore::mem_alloc(nvtx * sizeof(uint32_t), XD_TMP_MEM_TAG);
+	if (!pStamps) return;
+	::memset(pStamps, 0, nvtx * sizeof(uint32_t));
+	/* FIFO: a vertex is cached while fewer than cacheSize misses happened after its own */
+	uint32_t csize = uint32_t(nxCalc::max(cacheSize, 1));
+	uint32_t stamp = csize + 1;
+	int nidx = ntri * 3;
+	for (int i = 0; i < nidx; ++i) {
+		uint32_t vtx = pIdx[i];
+		if (vtx >= uint32_t(nvtx)) continue;
+		if (pStamps[vtx] == 0) {
+			++pStats->mVtxNum;
+		}
+		if (stamp - pStamps[vtx] > csize) {
+			pStamps[vtx] = stamp;
+			++stamp;
+			++pStats->mMissNum;
+		}
+	}
+	pStats->mTriNum = ntri;
+	nxCore::mem_free(pStamps);
+}
+
+void calc_stats(sxVtxCacheStats* pStats, const uint32_t* pIdx, int ntri, int nvtx, int cacheSize) {
+	calc_stats_sub(pStats, pIdx, ntri, nvtx, cacheSize);
+}
+
+void calc_stats(sxVtxCacheStats* pStats, const uint16_t* pIdx, int ntri, int nvtx, int cacheSize) {
+	calc_stats_sub(pStats, pIdx, ntri, nvtx, cacheSize);
+}
+
+int optimize(uint32_t* pIdx, int ntri, int nvtx, int cacheSize, int32_t* pClusterOrgs) {
+	if (!pIdx || ntri <= 0 || nvtx <= 0) return 0;
+	int nidx = ntri * 3;
+	for (int i = 0; i < nidx; ++i) {
+		if (pIdx[i] >= uint32_t(nvtx)) return 0;
+	}
+	uint32_t csize = uint32_t(nxCalc::max(cacheSize, 3));
+	size_t memSize = (nvtx + 1) * sizeof(int32_t); /* adjacency orgs */
+	memSize += nidx * sizeof(int32_t); /* adjacency */
+	memSize += nvtx * sizeof(int32_t); /* live triangles per vertex */
+	memSize += nvtx * sizeof(uint32_t); /* cache stamps */
+	memSize += nidx * sizeof(int32_t); /* dead-end stack */
+	memSize += nidx * sizeof(uint32_t); /* output */
+	memSize += ntri * sizeof(int32_t); /* hard boundaries */
+	memSize += ntri; /* emitted flags */
+	uint8_t* pMem = (uint8_t*)nxCore::mem_alloc(memSize, XD_TMP_MEM_TAG);
+	if (!pMem) return 0;
+	int32_t* pAdjOrg = (int32_t*)pMem;
+	int32_t* pAdj = pAdjOrg + nvtx + 1;
+	int32_t* pLive = pAdj + nidx;
+	uint32_t* pStamps = (uint32_t*)(pLive + nvtx);
+	int32_t* pDead = (int32_t*)(pStamps + nvtx);
+	uint32_t* pOut = (uint32_t*)(pDead + nidx);
+	int32_t* pHard = (int32_t*)(pOut + nidx);
+	uint8_t* pEmitted = (uint8_t*)(pHard + ntri);
+
+	::memset(pLive, 0, nvtx * sizeof(int32_t));
+	for (int i = 0; i < nidx; ++i) {
+		++pLive[pIdx[i]];
+	}
+	pAdjOrg[0] = 0;
+	for (int i = 0; i < nvtx; ++i) {
+		pAdjOrg[i + 1] = pAdjOrg[i] + pLive[i];
+		pStamps[i] = pAdjOrg[i];
+	}
+	for (int i = 0; i < nidx; ++i) {
+		pAdj[pStamps[pIdx[i]]++] = i / 3;
+	}
+	::memset(pStamps, 0, nvtx * sizeof(uint32_t));
+	::memset(pEmitted, 0, ntri);
+
+	uint32_t stamp = csize + 1;
+	int scan = 0;
+	int ndead = 0;
+	int nout = 0;
+	int nhard = 0;
+	bool restart = true;
+	while (scan < nvtx && pLive[scan] == 0) {
+		++scan;
+	}
+	int fan = scan < nvtx ? scan : -1;
+	while (fan >= 0) {
+		if (restart) {
+			pHard[nhard++] = nout / 3;
+			restart = false;
+		}
+		int candOrg = nout;
+		for (int i = pAdjOrg[fan]; i < pAdjOrg[fan + 1]; ++i) {
+			int tri = pAdj[i];
+			if (pEmitted[tri]) continue;
+			for (int j = 0; j < 3; ++j) {
+				uint32_t vtx = pIdx[tri * 3 + j];
+				pOut[nout++] = vtx;
+				pDead[ndead++] = int32_t(vtx);
+				--pLive[vtx];
+				if (stamp - pStamps[vtx] > csize) {
+					pStamps[vtx] = stamp++;
+				}
+			}
+			pEmitted[tri] = 1;
+		}
+		/* next fan: the candidate that stays cached longest without being evicted by its own remaining triangles */
+		int next = -1;
+		int bestPrio = -1;
+		for (int i = candOrg; i < nout; ++i) {
+			uint32_t vtx = pOut[i];
+			if (pLive[vtx] > 0) {
+				int prio = 0;
+				int age = int(stamp - pStamps[vtx]);
+				if (age + 2 * pLive[vtx] <= int(csize)) {
+					prio = age;
+				}
+				if (prio > bestPrio) {
+					bestPrio = prio;
+					next = int(vtx);
+				}
+			}
+		}
+		if (next < 0) {
+			while (ndead > 0) {
+				int vtx = pDead[--ndead];
+				if (pLive[vtx] > 0) {
+					next = vtx;
+					break;
+				}
+			}
+			if (next >= 0) {
+				restart = stamp - pStamps[next] > csize;
+			} else {
+				while (scan < nvtx && pLive[scan] == 0) {
+					++scan;
+				}
+				next = scan < nvtx ? scan : -1;
+				restart = true;
+			}
+		}
+		fan = next;
+	}
+	::memcpy(pIdx, pOut, nidx * sizeof(uint32_t));
+
+	int ncls = 0;
+	if (pClusterOrgs) {
+		sxVtxCacheStats stats;
+		calc_stats(&stats, pIdx, ntri, nvtx, cacheSize);
+		float lim = stats.get_ACMR() * 1.05f;
+		::memset(pStamps, 0, nvtx * sizeof(uint32_t));
+		stamp = csize + 1;
+		for (int i = 0; i < nhard; ++i) {
+			int org = pHard[i];
+			int end = i + 1 < nhard ? pHard[i + 1] : ntri;
+			int clsOrg = org;
+			int nmiss = 0;
+			stamp += csize + 1;
+			pClusterOrgs[ncls++] = org;
+			for (int tri = org; tri < end; ++tri) {
+				for (int j = 0; j < 3; ++j) {
+					uint32_t vtx = pIdx[tri * 3 + j];
+					if (stamp - pStamps[vtx] > csize) {
+						pStamps[vtx] = stamp++;
+						++nmiss;
+					}
+				}
+				if (tri + 1 < end && float(nmiss) <= lim * float(tri + 1 - clsOrg)) {
+					clsOrg = tri + 1;
+					nmiss = 0;
+					stamp += csize + 1;
+					pClusterOrgs[ncls++] = clsOrg;
+				}
+			}
+		}
+	}
+	nxCore::mem_free(pMem);
+	return ncls;
+}
+
+struct sVtxCacheClsKey {
+	float mKey;
+	int32_t mIdx;
+};
+
+static int vtx_cache_cls_cmp(const void* pA, const void* pB) {
+	const sVtxCacheClsKey* pKeyA = (const sVtxCacheClsKey*)pA;
+	const sVtxCacheClsKey* pKeyB = (const sVtxCacheClsKey*)pB;
+	if (pKeyA->mKey > pKeyB->mKey) return -1;
+	if (pKeyA->mKey < pKeyB->mKey) return 1;
+	return pKeyA->mIdx - pKeyB->mIdx;
+}
+
+void sort_clusters(uint32_t* pIdx, int ntri, const int32_t* pClusterOrgs, int nclusters, const cxVec* pPos) {
+	if (!pIdx || ntri <= 0 || !pClusterOrgs || nclusters <= 1 || !pPos) return;
+	size_t memSize = nclusters * (sizeof(sVtxCacheClsKey) + sizeof(cxVec) * 2) + ntri * 3 * sizeof(uint32_t);
+	uint8_t* pMem = (uint8_t*)nxCore::mem_alloc(memSize, XD_TMP_MEM_TAG);
+	if (!pMem) return;
+	sVtxCacheClsKey* pKeys = (sVtxCacheClsKey*)pMem;
+	cxVec* pCenters = (cxVec*)(pKeys + nclusters);
+	cxVec* pNrms = pCenters + nclusters;
+	uint32_t* pTmp = (uint32_t*)(pNrms + nclusters);
+	cxVec meshCenter(0.0f);
+	float meshArea = 0.0f;
+	for (int i = 0; i < nclusters; ++i) {
+		int org = pClusterOrgs[i];
+		int end = i + 1 < nclusters ? pClusterOrgs[i + 1] : ntri;
+		cxVec center(0.0f);
+		cxVec nrm(0.0f);
+		float area = 0.0f;
+		for (int tri = org; tri < end; ++tri) {
+			cxVec v0 = pPos[pIdx[tri * 3]];
+			cxVec v1 = pPos[pIdx[tri * 3 + 1]];
+			cxVec v2 = pPos[pIdx[tri * 3 + 2]];
+			cxVec triNrm = nxVec::cross(v0 - v1, v2 - v1);
+			float triArea = triNrm.mag();
+			center += (v0 + v1 + v2) * (triArea / 3.0f);
+			nrm += triNrm;
+			area += triArea;
+		}
+		meshCenter += center;
+		meshArea += area;
+		pCenters[i] = area > 0.0f ? center / area : center;
+		pNrms[i] = nrm.get_normalized();
+	}
+	if (meshArea > 0.0f) {
+		meshCenter /= meshArea;
+	}
+	for (int i = 0; i < nclusters; ++i) {
+		pKeys[i].mKey = (pCenters[i] - meshCenter).dot(pNrms[i]);
+		pKeys[i].mIdx = i;
+	}
+	::qsort(pKeys, nclusters, sizeof(sVtxCacheClsKey), vtx_cache_cls_cmp);
+	int nidx = 0;
+	for (int i = 0; i < nclusters; ++i) {
+		int cls = pKeys[i].mIdx;
+		int org = pClusterOrgs[cls];
+		int end = cls + 1 < nclusters ? pClusterOrgs[cls + 1] : ntri;
+		int n = (end - org) * 3;
+		::memcpy(pTmp + nidx, pIdx + org * 3, n * sizeof(uint32_t));
+		nidx += n;
+	}
+	::memcpy(pIdx, pTmp, ntri * 3 * sizeof(uint32_t));
+	nxCore::mem_free(pMem);
+}
+
+} // nxVtxCache
+
+void sxGeometryData::DisplayList::create(const sxGeometryData& geo, const char* pBatGrpPrefix, bool triangulate, uint32_t optFlags) {
 	int nmtl = geo.get_mtl_num();
 	int nbat = nmtl > 0 ? nmtl : 1;
 	int batGrpCount = 0;
@@ -6495,6 +7220,11 @@ void sxGeometryData::DisplayList::create(const sxGeometryData& geo, const char*
 	size += XD_ALIGN(nidx32 * sizeof(uint32_t), 0x10);
 	uint32_t offsIdx16 = nidx16 > 0 ? (uint32_t)size : 0;
 	size += XD_ALIGN(nidx16 * sizeof(uint16_t), 0x10);
+	int npnt = geo.get_pnt_num();
+	uint32_t offsPntMap = (optFlags & OPT_VTX_FETCH) && npnt > 0 ? (uint32_t)size : 0;
+	if (offsPntMap) {
+		size += XD_ALIGN(npnt * sizeof(int32_t), 0x10);
+	}
 	Data* pData = (Data*)nxCore::mem_alloc(size, XD_FOURCC('G', 'D', 'L', 'D'));
 	if (!pData) {
 		return;
@@ -6508,6 +7238,8 @@ void sxGeometryData::DisplayList::create(const sxGeometryData& geo, const char*
 	pData->mMtlNum = nmtl;
 	pData->mBatNum = nbat;
 	pData->mTriNum = ntri;
+	pData->mOffsPntMap = offsPntMap;
+	pData->mPntNum = npnt;
 	mpGeo = &geo;
 	mpData = pData;
 	nidx16 = 0;
@@ -6657,6 +7389,13 @@ void sxGeometryData::DisplayList::create(const sxGeometryData& geo, const char*
 		}
 	}
 
+	if (optFlags & (OPT_VTX_CACHE | OPT_OVERDRAW)) {
+		optimize_tris(optFlags);
+	}
+	if (optFlags & OPT_VTX_FETCH) {
+		optimize_fetch();
+	}
+
 	if (pBatGrpIdx) {
 		nxCore::mem_free(pBatGrpIdx);
 		pBatGrpIdx = nullptr;
@@ -6671,6 +7410,153 @@ void sxGeometryData::DisplayList::create(const sxGeometryData& geo, const char*
 	}
 }
 
+void sxGeometryData::DisplayList::optimize_tris(uint32_t optFlags) {
+	if (!is_valid()) return;
+	const int cacheSize = 16;
+	bool overdraw = !!(optFlags & OPT_OVERDRAW);
+	int nbat = get_bat_num();
+	for (int i = 0; i < nbat; ++i) {
+		Batch* pBat = get_bat(i);
+		int ntri = pBat->mTriNum;
+		if (ntri <= 1) continue;
+		int nidx = ntri * 3;
+		int nvtx = pBat->mMaxIdx - pBat->mMinIdx + 1;
+		size_t memSize = nidx * sizeof(uint32_t);
+		if (overdraw) {
+			memSize += ntri * sizeof(int32_t) + nvtx * sizeof(cxVec);
+		}
+		uint8_t* pMem = (uint8_t*)nxCore::mem_alloc(memSize, XD_TMP_MEM_TAG);
+		if (!pMem) continue;
+		uint32_t* pIdx = (uint32_t*)pMem;
+		int32_t* pClsOrgs = overdraw ? (int32_t*)(pIdx + nidx) : nullptr;
+		cxVec* pPos = overdraw ? (cxVec*)(pClsOrgs + ntri) : nullptr;
+		uint16_t* pIdx16 = pBat->is_idx16() ? mpData->get_idx16() + pBat->mIdxOrg : nullptr;
+		uint32_t* pIdx32 = pBat->is_idx16() ? nullptr : mpData->get_idx32() + pBat->mIdxOrg;
+		for (int j = 0; j < nidx; ++j) {
+			pIdx[j] = pIdx16 ? pIdx16[j] : pIdx32[j];
+		}
+		int ncls = nxVtxCache::optimize(pIdx, ntri, nvtx, cacheSize, pClsOrgs);
+		if (overdraw && ncls > 1) {
+			for (int j = 0; j < nvtx; ++j) {
+				pPos[j] = mpGeo->get_pnt(pBat->mMinIdx + j);
+			}
+			nxVtxCache::sort_clusters(pIdx, ntri, pClsOrgs, ncls, pPos);
+		}
+		for (int j = 0; j < nidx; ++j) {
+			if (pIdx16) {
+				pIdx16[j] = (uint16_t)pIdx[j];
+			} else {
+				pIdx32[j] = pIdx[j];
+			}
+		}
+		nxCore::mem_free(pMem);
+	}
+}
+
+void sxGeometryData::DisplayList::optimize_fetch() {
+	if (!is_valid()) return;
+	int32_t* pMap = mpData->get_pnt_map();
+	int npnt = mpData->mPntNum;
+	if (!pMap || npnt <= 0) return;
+	int nbat = get_bat_num();
+	int32_t* pNewIds = (int32_t*)nxCore::mem_alloc(npnt * sizeof(int32_t) + nbat * sizeof(int32_t) * 2, XD_TMP_MEM_TAG);
+	if (!pNewIds) {
+		mpData->mOffsPntMap = 0;
+		return;
+	}
+	int32_t* pBatMinMax = pNewIds + npnt;
+	for (int i = 0; i < npnt; ++i) {
+		pNewIds[i] = -1;
+	}
+	int nnew = 0;
+	bool ok = true;
+	for (int i = 0; i < nbat; ++i) {
+		Batch* pBat = get_bat(i);
+		int nidx = pBat->mTriNum * 3;
+		uint16_t* pIdx16 = pBat->is_idx16() ? mpData->get_idx16() + pBat->mIdxOrg : nullptr;
+		uint32_t* pIdx32 = pBat->is_idx16() ? nullptr : mpData->get_idx32() + pBat->mIdxOrg;
+		int32_t newMin = INT32_MAX;
+		int32_t newMax = -1;
+		for (int j = 0; j < nidx; ++j) {
+			int32_t pntId = pBat->mMinIdx + int32_t(pIdx16 ? pIdx16[j] : pIdx32[j]);
+			if (pNewIds[pntId] < 0) {
+				pNewIds[pntId] = nnew;
+				pMap[nnew] = pntId;
+				++nnew;
+			}
+			newMin = nxCalc::min(newMin, pNewIds[pntId]);
+			newMax = nxCalc::max(newMax, pNewIds[pntId]);
+		}
+		if (nidx > 0) {
+			bool idx16 = (newMax - newMin) < (1 << 16);
+			if (idx16 != pBat->is_idx16()) {
+				/* buffers are already sized, keep the source numbering */
+				ok = false;
+				break;
+			}
+		} else {
+			newMin = pBat->mMinIdx;
+			newMax = pBat->mMaxIdx;
+		}
+		pBatMinMax[i * 2] = newMin;
+		pBatMinMax[i * 2 + 1] = newMax;
+	}
+	if (ok) {
+		for (int i = 0; i < npnt; ++i) {
+			if (pNewIds[i] < 0) {
+				pNewIds[i] = nnew;
+				pMap[nnew] = i;
+				++nnew;
+			}
+		}
+		for (int i = 0; i < nbat; ++i) {
+			Batch* pBat = get_bat(i);
+			int nidx = pBat->mTriNum * 3;
+			uint16_t* pIdx16 = pBat->is_idx16() ? mpData->get_idx16() + pBat->mIdxOrg : nullptr;
+			uint32_t* pIdx32 = pBat->is_idx16() ? nullptr : mpData->get_idx32() + pBat->mIdxOrg;
+			int32_t newMin = pBatMinMax[i * 2];
+			for (int j = 0; j < nidx; ++j) {
+				if (pIdx16) {
+					pIdx16[j] = (uint16_t)(pNewIds[pBat->mMinIdx + pIdx16[j]] - newMin);
+				} else {
+					pIdx32[j] = (uint32_t)(pNewIds[pBat->mMinIdx + pIdx32[j]] - newMin);
+				}
+			}
+			pBat->mMinIdx = newMin;
+			pBat->mMaxIdx = pBatMinMax[i * 2 + 1];
+		}
+	} else {
+		mpData->mOffsPntMap = 0;
+	}
+	nxCore::mem_free(pNewIds);
+}
+
+int sxGeometryData::DisplayList::get_pnt_id(int vtxIdx) const {
+	const int32_t* pMap = get_pnt_map();
+	if (pMap) {
+		return (uint32_t)vtxIdx < mpData->mPntNum ? pMap[vtxIdx] : -1;
+	}
+	return vtxIdx;
+}
+
+void sxGeometryData::DisplayList::calc_cache_stats(sxVtxCacheStats* pStats, int cacheSize) const {
+	if (!pStats) return;
+	pStats->reset();
+	if (!is_valid()) return;
+	int nbat = get_bat_num();
+	for (int i = 0; i < nbat; ++i) {
+		Batch* pBat = get_bat(i);
+		int nvtx = pBat->mMaxIdx - pBat->mMinIdx + 1;
+		sxVtxCacheStats batStats;
+		if (pBat->is_idx16()) {
+			nxVtxCache::calc_stats(&batStats, mpData->get_idx16() + pBat->mIdxOrg, pBat->mTriNum, nvtx, cacheSize);
+		} else {
+			nxVtxCache::calc_stats(&batStats, mpData->get_idx32() + pBat->mIdxOrg, pBat->mTriNum, nvtx, cacheSize);
+		}
+		pStats->add(batStats);
+	}
+}
+
 void sxGeometryData::DisplayList::destroy() {
 	if (mpData) {
 		nxCore::mem_free(mpData);
@@ -7821,6 +8707,50 @@ int sxKeyframesData::FCurve::get_fno(int idx) const {
 	return fno;
 }
 
+float sxKeyframesData::FCurve::eval_key(int i0, float frm) const {
+	float val = 0.0f;
+	FCurveInfo* pInfo = get_info();
+	float* pVals = reinterpret_cast<float*>(XD_INCR_PTR(mpKfr, pInfo->mValOffs));
+	int i1 = i0 + 1;
+	float f0 = (float)get_fno(i0);
+	float f1 = (float)get_fno(i1);
+	if (frm != f0) {
+		eFunc func = pInfo->get_common_func();
+		if (pInfo->mFuncOffs) {
+			func = (eFunc)reinterpret_cast<uint8_t*>(XD_INCR_PTR(mpKfr, pInfo->mFuncOffs))[i0];
+		}
+		if (func == eFunc::CONSTANT) {
+			val = pVals[i0];
+		} else {
+			float t = (frm - f0) / (f1 - f0);
+			float v0 = pVals[i0];
+			float v1 = pVals[i1];
+			if (func == eFunc::LINEAR) {
+				val = nxCalc::lerp(v0, v1, t);
+			} else if (func == eFunc::CUBIC) {
+				float* pSlopeL = pInfo->mLSlopeOffs ? reinterpret_cast<float*>(XD_INCR_PTR(mpKfr, pInfo->mLSlopeOffs)) : nullptr;
+				float* pSlopeR = pInfo->mRSlopeOffs ? reinterpret_cast<float*>(XD_INCR_PTR(mpKfr, pInfo->mRSlopeOffs)) : nullptr;
+				float outgoing = 0.0f;
+				float incoming = 0.0f;
+				if (pSlopeR) {
+					outgoing = pSlopeR[i0];
+				}
+				if (pSlopeL) {
+					incoming = pSlopeL[i1];
+				}
+				float fscl = nxCalc::rcp0(mpKfr->mFPS);
+				float seg = (f1 - f0) * fscl;
+				outgoing *= seg;
+				incoming *= seg;
+				val = nxCalc::hermite(v0, outgoing, v1, incoming, t);
+			}
+		}
+	} else {
+		val = pVals[i0];
+	}
+	return val;
+}
+
 float sxKeyframesData::FCurve::eval(float frm, bool extrapolate) const {
 	float val = 0.0f;
 	int fno = (int)frm;
@@ -7854,51 +8784,57 @@ float sxKeyframesData::FCurve::eval(float frm, bool extrapolate) const {
 					}
 				}
 			} else if (mpKfr->ck_fno(fno)) {
-				float* pVals = reinterpret_cast<float*>(XD_INCR_PTR(mpKfr, pInfo->mValOffs));
-				int i0 = find_key_idx(fno);
-				int i1 = i0 + 1;
-				float f0 = (float)get_fno(i0);
-				float f1 = (float)get_fno(i1);
-				if (frm != f0) {
-					eFunc func = pInfo->get_common_func();
-					if (pInfo->mFuncOffs) {
-						func = (eFunc)reinterpret_cast<uint8_t*>(XD_INCR_PTR(mpKfr, pInfo->mFuncOffs))[i0];
-					}
-					if (func == eFunc::CONSTANT) {
-						val = pVals[i0];
-					} else {
-						float t = (frm - f0) / (f1 - f0);
-						float v0 = pVals[i0];
-						float v1 = pVals[i1];
-						if (func == eFunc::LINEAR) {
-							val = nxCalc::lerp(v0, v1, t);
-						} else if (func == eFunc::CUBIC) {
-							float* pSlopeL = pInfo->mLSlopeOffs ? reinterpret_cast<float*>(XD_INCR_PTR(mpKfr, pInfo->mLSlopeOffs)) : nullptr;
-							float* pSlopeR = pInfo->mRSlopeOffs ? reinterpret_cast<float*>(XD_INCR_PTR(mpKfr, pInfo->mRSlopeOffs)) : nullptr;
-							float outgoing = 0.0f;
-							float incoming = 0.0f;
-							if (pSlopeR) {
-								outgoing = pSlopeR[i0];
-							}
-							if (pSlopeL) {
-								incoming = pSlopeL[i1];
-							}
-							float fscl = nxCalc::rcp0(mpKfr->mFPS);
-							float seg = (f1 - f0) * fscl;
-							outgoing *= seg;
-							incoming *= seg;
-							val = nxCalc::hermite(v0, outgoing, v1, incoming, t);
-						}
-					}
-				} else {
-					val = pVals[i0];
-				}
+				val = eval_key(find_key_idx(fno), frm);
 			}
 		}
 	}
 	return val;
 }
 
+void sxKeyframesData::FCurve::eval_sorted(const float* pFrm, int n, float* pVal, int valStride) const {
+	if (!pFrm || !pVal || n <= 0) return;
+	if (!is_valid()) {
+		for (int i = 0; i < n; ++i) {
+			pVal[i * valStride] = 0.0f;
+		}
+		return;
+	}
+	FCurveInfo* pInfo = get_info();
+	if (pInfo->is_const()) {
+		for (int i = 0; i < n; ++i) {
+			pVal[i * valStride] = pInfo->mMinVal;
+		}
+		return;
+	}
+	int nkey = pInfo->mKeyNum;
+	float lastFno = pInfo->has_fno_lst() ? (float)get_fno(nkey - 1) : -1.0f;
+	int i0 = 0;
+	int fnoNext = nkey > 1 ? get_fno(1) : 0;
+	for (int i = 0; i < n; ++i) {
+		float frm = pFrm[i];
+		if (i > 0 && frm == pFrm[i - 1]) {
+			pVal[i * valStride] = pVal[(i - 1) * valStride];
+			continue;
+		}
+		int fno = (int)frm;
+		float val = 0.0f;
+		if (pInfo->has_fno_lst() && frm > lastFno && frm < lastFno + 1.0f) {
+			val = eval(frm);
+		} else if (mpKfr->ck_fno(fno)) {
+			if (pInfo->has_fno_lst()) {
+				while (i0 + 1 < nkey && fnoNext <= fno) {
+					++i0;
+					fnoNext = i0 + 1 < nkey ? get_fno(i0 + 1) : 0;
+				}
+				val = eval_key(i0, frm);
+			} else {
+				val = eval_key(fno, frm);
+			}
+		}
+		pVal[i * valStride] = val;
+	}
+}
+
 const char* sxKeyframesData::get_node_name(int idx) const {
 	const char* pName = nullptr;
 	NodeInfo* pInfo = get_node_info_ptr(idx);
@@ -3340,6 +3340,29 @@ struct sxRigData : public sxData {
 	static const uint32_t KIND = XD_FOURCC('X', 'R', 'I', 'G');
 };
 
+struct sxVtxCacheStats {
+	int mTriNum;
+	int mVtxNum; /* referenced vertices */
+	int mMissNum; /* transformed vertices */
+
+	void reset() { mTriNum = 0; mVtxNum = 0; mMissNum = 0; }
+	void add(const sxVtxCacheStats& st) { mTriNum += st.mTriNum; mVtxNum += st.mVtxNum; mMissNum += st.mMissNum; }
+	float get_ACMR() const { return mTriNum > 0 ? float(mMissNum) / float(mTriNum) : 0.0f; } /* 0.5 ideal for large grids, 3 worst */
+	float get_ATVR() const { return mVtxNum > 0 ? float(mMissNum) / float(mVtxNum) : 0.0f; } /* 1 ideal */
+};
+
+namespace nxVtxCache {
+
+void calc_stats(sxVtxCacheStats* pStats, const uint32_t* pIdx, int ntri, int nvtx, int cacheSize = 16);
+void calc_stats(sxVtxCacheStats* pStats, const uint16_t* pIdx, int ntri, int nvtx, int cacheSize = 16);
+/* Tipsify: triangles fanned around cached vertices; pClusterOrgs (ntri entries) receives the first triangle
+   of each cluster, cut where the cache goes cold and the cluster ACMR stays near the overall one */
+int optimize(uint32_t* pIdx, int ntri, int nvtx, int cacheSize = 16, int32_t* pClusterOrgs = nullptr);
+/* clusters reordered so that ones facing away from the mesh center (likely occluders) are drawn first; CW triangles */
+void sort_clusters(uint32_t* pIdx, int ntri, const int32_t* pClusterOrgs, int nclusters, const cxVec* pPos);
+
+} // nxVtxCache
+
 struct sxGeometryData : public sxData {
 	cxAABB mBBox;
 	uint32_t mPntNum;
@@ -3501,6 +3524,156 @@ struct sxGeometryData : public sxData {
 		uint32_t mReserved2;
 	};
 
+	/* BVH copied to depth-first order: a subtree occupies [idx, mSkip), so queries walk the array without a stack */
+	class FlatBVH {
+	public:
+		struct Node {
+			cxAABB mBBox;
+			int32_t mSkip;
+			int32_t mPolId; /* -1 for inner nodes */
+
+			bool is_leaf() const { return mPolId >= 0; }
+		};
+
+	protected:
+		struct SegQuery {
+			cxAABB mBBox;
+			float mOrg[3];
+			float mInvDir[3];
+			bool mAxisFlg[3];
+
+			void init(const cxLineSeg& seg) {
+				mBBox.from_seg(seg);
+				seg.get_pos0().to_mem(mOrg);
+				float dir[3];
+				seg.get_dir().to_mem(dir);
+				for (int i = 0; i < 3; ++i) {
+					mAxisFlg[i] = dir[i] != 0.0f;
+					mInvDir[i] = mAxisFlg[i] ? 1.0f / dir[i] : 0.0f;
+				}
+			}
+
+			bool ck(const cxAABB& box) const {
+				if (!box.overlaps(mBBox)) return false;
+				cxVec bmin = box.get_min_pos();
+				cxVec bmax = box.get_max_pos();
+				float tmin = 0.0f;
+				float tmax = 1.0f;
+				return slab_ck(bmin.x, bmax.x, 0, tmin, tmax) && slab_ck(bmin.y, bmax.y, 1, tmin, tmax) && slab_ck(bmin.z, bmax.z, 2, tmin, tmax);
+			}
+
+			bool slab_ck(float vmin, float vmax, int i, float& tmin, float& tmax) const {
+				if (mAxisFlg[i]) {
+					float t1 = (vmin - mOrg[i]) * mInvDir[i];
+					float t2 = (vmax - mOrg[i]) * mInvDir[i];
+					tmin = nxCalc::max(tmin, nxCalc::min(t1, t2));
+					tmax = nxCalc::min(tmax, nxCalc::max(t1, t2));
+				}
+				return tmin <= tmax;
+			}
+		};
+
+		const sxGeometryData* mpGeo;
+		Node* mpNodes;
+		int mNodesNum;
+
+	public:
+		struct NearestHit {
+			cxVec mPos;
+			cxVec mNrm;
+			float mDist;
+			int32_t mPolId; /* -1 if nothing was hit */
+
+			bool is_hit() const { return mPolId >= 0; }
+		};
+
+		static const int PACKET_SIZE = 8;
+
+		FlatBVH() : mpGeo(nullptr), mpNodes(nullptr), mNodesNum(0) {}
+		~FlatBVH() { destroy(); }
+
+		void create(const sxGeometryData& geo);
+		void destroy();
+
+		bool is_valid() const { return mpGeo != nullptr && mpNodes != nullptr; }
+		int get_nodes_num() const { return mNodesNum; }
+		const Node* get_node(int idx) const { return (uint32_t)idx < (uint32_t)mNodesNum ? &mpNodes[idx] : nullptr; }
+
+		/* FUNC: bool(const Polygon& pol, const cxVec& hitPos, const cxVec& hitNrm, float hitDist), false stops the query */
+		template<typename FUNC> void hit_query(const cxLineSeg& seg, FUNC& fun) const {
+			if (!mpGeo) return;
+			if (!mpNodes) {
+				int npol = mpGeo->get_pol_num();
+				for (int i = 0; i < npol; ++i) {
+					if (!hit_pol(mpGeo->get_pol(i), seg, fun)) break;
+				}
+				return;
+			}
+			SegQuery qry;
+			qry.init(seg);
+			const Node* pNodes = mpNodes;
+			int n = mNodesNum;
+			int idx = 0;
+			while (idx < n) {
+				const Node* pNode = &pNodes[idx];
+				if (qry.ck(pNode->mBBox)) {
+					if (pNode->is_leaf()) {
+						if (!hit_pol(mpGeo->get_pol(pNode->mPolId), seg, fun)) break;
+					}
+					++idx;
+				} else {
+					idx = pNode->mSkip;
+				}
+			}
+		}
+
+		/* FUNC: bool(const Polygon& pol), false stops the query */
+		template<typename FUNC> void range_query(const cxAABB& box, FUNC& fun) const {
+			if (!mpGeo) return;
+			if (!mpNodes) {
+				int npol = mpGeo->get_pol_num();
+				for (int i = 0; i < npol; ++i) {
+					Polygon pol = mpGeo->get_pol(i);
+					if (pol.calc_bbox().overlaps(box)) {
+						if (!fun(pol)) break;
+					}
+				}
+				return;
+			}
+			const Node* pNodes = mpNodes;
+			int n = mNodesNum;
+			int idx = 0;
+			while (idx < n) {
+				const Node* pNode = &pNodes[idx];
+				if (box.overlaps(pNode->mBBox)) {
+					if (pNode->is_leaf()) {
+						if (!fun(mpGeo->get_pol(pNode->mPolId))) break;
+					}
+					++idx;
+				} else {
+					idx = pNode->mSkip;
+				}
+			}
+		}
+
+		NearestHit nearest_hit(const cxLineSeg& seg) const;
+		/* nearest_hit() for many segments, sorted into packets by direction octant and origin; pWk: nseg*2 ints or null */
+		void nearest_hit_stream(const cxLineSeg* pSegs, NearestHit* pHits, int nseg, int32_t* pWk = nullptr) const;
+
+	protected:
+		void nearest_hits(const cxLineSeg* pSegs, NearestHit* pHits, int nseg) const;
+
+		template<typename FUNC> static bool hit_pol(const Polygon& pol, const cxLineSeg& seg, FUNC& fun) {
+			cxVec hitPos;
+			cxVec hitNrm;
+			if (pol.intersect(seg, &hitPos, &hitNrm)) {
+				float hitDist = nxVec::dist(seg.get_pos0(), hitPos);
+				return fun(pol, hitPos, hitNrm, hitDist);
+			}
+			return true;
+		}
+	};
+
 	class DisplayList {
 	public:
 		struct Batch {
@@ -3516,6 +3689,12 @@ struct sxGeometryData : public sxData {
 			bool is_idx16() const { return (mMaxIdx - mMinIdx) < (1 << 16); }
 		};
 
+		enum {
+			OPT_VTX_CACHE = 1 << 0, /* per-batch triangle order for the post-transform cache */
+			OPT_OVERDRAW = 1 << 1, /* cache-friendly clusters sorted outward-facing first, implies OPT_VTX_CACHE */
+			OPT_VTX_FETCH = 1 << 2 /* vertices renumbered in order of first use, see get_pnt_map */
+		};
+
 	private:
 		struct Data {
 			uint32_t mOffsBat;
@@ -3526,10 +3705,13 @@ struct sxGeometryData : public sxData {
 			uint32_t mTriNum;
 			uint32_t mIdx16Num;
 			uint32_t mIdx32Num;
+			uint32_t mOffsPntMap;
+			uint32_t mPntNum;
 
 			Batch* get_bat_top() { return mOffsBat ? reinterpret_cast<Batch*>(XD_INCR_PTR(this, mOffsBat)) : nullptr; }
 			uint16_t* get_idx16() { return mOffsIdx16 ? reinterpret_cast<uint16_t*>(XD_INCR_PTR(this, mOffsIdx16)) : nullptr; }
 			uint32_t* get_idx32() { return mOffsIdx32 ? reinterpret_cast<uint32_t*>(XD_INCR_PTR(this, mOffsIdx32)) : nullptr; }
+			int32_t* get_pnt_map() { return mOffsPntMap ? reinterpret_cast<int32_t*>(XD_INCR_PTR(this, mOffsPntMap)) : nullptr; }
 		};
 
 		const sxGeometryData* mpGeo;
@@ -3537,7 +3719,9 @@ struct sxGeometryData : public sxData {
 
 		DisplayList() : mpGeo(nullptr), mpData(nullptr) {}
 
-		void create(const sxGeometryData& geo, const char* pBatGrpPrefix = nullptr, bool triangulate = true);
+		void create(const sxGeometryData& geo, const char* pBatGrpPrefix = nullptr, bool triangulate = true, uint32_t optFlags = 0);
+		void optimize_tris(uint32_t optFlags);
+		void optimize_fetch();
 
 		friend struct sxGeometryData;
 
@@ -3560,6 +3744,13 @@ struct sxGeometryData : public sxData {
 		bool bat_idx_ck(int idx) const { return mpData ? (uint32_t)idx < mpData->mBatNum : false; }
 		Batch* get_bat(int idx) const { return bat_idx_ck(idx) ? mpData->get_bat_top() + idx : nullptr; }
 		const char* get_bat_mtl_name(int batIdx) const;
+
+		/* with OPT_VTX_FETCH: vertex i of the display list is geometry point get_pnt_map()[i], nullptr if points are used as is */
+		const int32_t* get_pnt_map() const { return mpData ? mpData->get_pnt_map() : nullptr; }
+		int get_pnt_num() const { return mpData ? mpData->mPntNum : 0; }
+		int get_pnt_id(int vtxIdx) const;
+		/* FIFO post-transform cache simulation over all batches */
+		void calc_cache_stats(sxVtxCacheStats* pStats, int cacheSize = 16) const;
 	};
 
 	int get_pnt_num() const { return mPntNum; }
@@ -3639,9 +3830,17 @@ struct sxGeometryData : public sxData {
 	BVH* get_BVH() const { return has_BVH() ? reinterpret_cast<BVH*>(XD_INCR_PTR(this, mBVHOffs)) : nullptr; }
 	BVH::Node* get_BVH_node(int nodeId) const { return ck_BVH_node_idx(nodeId) ? &reinterpret_cast<BVH::Node*>(get_BVH() + 1)[nodeId] : nullptr; }
 	cxAABB calc_world_bbox(cxMtx* pMtxW, int* pIdxMap = nullptr) const;
+	/* exact bounds of the (optionally transformed) points, tighter than transforming mBBox */
+	cxAABB calc_pnt_bbox(const cxMtx* pMtx = nullptr) const;
+	/* per-triangle UV tangent, summed per point in polygon order by calc_tangents */
+	cxVec calc_tri_tangent(int triIdx, int texAttrIdx) const;
+	/* summed tangent made orthogonal to the point normal and normalized */
+	cxVec calc_pnt_tangent(int pntIdx, int nrmAttrIdx, const cxVec& tngSum, bool flip) const;
 	void calc_tangents(cxVec* pTng, bool flip = false, const char* pAttrName = nullptr) const;
 	cxVec* calc_tangents(bool flip = false, const char* pAttrName = nullptr) const;
 	void* alloc_triangulation_wk() const;
+	DisplayList* create_display_list(const char* pBatGrpPrefix = nullptr, bool triangulate = true, uint32_t optFlags = 0) const;
+	static void release_display_list(DisplayList* pLst);
 
 	static const uint32_t KIND = XD_FOURCC('X', 'G', 'E', 'O');
 };
@@ -3862,6 +4061,8 @@ struct sxKeyframesData : public sxData {
 
 		FCurve() {}
 
+		float eval_key(int i0, float frm) const;
+
 		friend struct sxKeyframesData;
 
 	public:
@@ -3876,6 +4077,7 @@ struct sxKeyframesData : public sxData {
 		int find_key_idx(int fno) const;
 		int get_fno(int idx) const;
 		float eval(float frm, bool extrapolate = false) const;
+		void eval_sorted(const float* pFrm, int n, float* pVal, int valStride = 1) const;
 	};
 
 	struct RigLink {
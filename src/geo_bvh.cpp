@@ -0,0 +1,518 @@
+#include "crossdata.hpp"
+#include "task.hpp"
+#include "timer.hpp"
+#include "geo_bvh.hpp"
+
+#define GEO_BVH_TASKS_PER_WRK 4
+#define GEO_BVH_MIN_TASK_POLS 1024
+
+void cGeoBVHBuilder::init(int maxPols, int maxWorkers) {
+	reset();
+	if (maxPols <= 0) return;
+	mWrkNum = nxCalc::max(maxWorkers, 1);
+	mPolMax = maxPols;
+	mTasksMax = mWrkNum * GEO_BVH_TASKS_PER_WRK;
+	mpPolBBox = (cxAABB*)nxCore::mem_alloc(maxPols * sizeof(cxAABB), XD_FOURCC('B', 'v', 'h', 'B'));
+	mpCenter = (float*)nxCore::mem_alloc(maxPols * 3 * sizeof(float), XD_FOURCC('B', 'v', 'h', 'C'));
+	mpIdx = (int32_t*)nxCore::mem_alloc(maxPols * sizeof(int32_t), XD_FOURCC('B', 'v', 'h', 'I'));
+	mpTasks = (Task*)nxCore::mem_alloc(mTasksMax * sizeof(Task), XD_FOURCC('B', 'v', 'h', 'T'));
+	if (!mpPolBBox || !mpCenter || !mpIdx || !mpTasks) {
+		reset();
+		return;
+	}
+	if (mWrkNum > 1) {
+		mpQueue = tskQueueCreate(mTasksMax);
+		mpJobs = tskJobsAlloc(mTasksMax);
+		if (mpQueue && mpJobs) {
+			for (int i = 0; i < mTasksMax; ++i) {
+				mpJobs[i].mFunc = task_job;
+				mpJobs[i].mpData = this;
+			}
+		} else {
+			tskQueueDestroy(mpQueue);
+			mpQueue = nullptr;
+			tskJobsFree(mpJobs);
+			mpJobs = nullptr;
+		}
+	}
+}
+
+void cGeoBVHBuilder::reset() {
+	nxCore::mem_free(mpPolBBox);
+	mpPolBBox = nullptr;
+	nxCore::mem_free(mpCenter);
+	mpCenter = nullptr;
+	nxCore::mem_free(mpIdx);
+	mpIdx = nullptr;
+	nxCore::mem_free(mpTasks);
+	mpTasks = nullptr;
+	tskQueueDestroy(mpQueue);
+	mpQueue = nullptr;
+	tskJobsFree(mpJobs);
+	mpJobs = nullptr;
+	mpDstNodes = nullptr;
+	mPolMax = 0;
+	mTasksNum = 0;
+	mTasksMax = 0;
+	mWrkNum = 0;
+}
+
+void cGeoBVHBuilder::prepare(const sxGeometryData& geo) {
+	int npol = geo.get_pol_num();
+	for (int i = 0; i < npol; ++i) {
+		cxAABB bbox = geo.get_pol(i).calc_bbox();
+		mpPolBBox[i] = bbox;
+		bbox.get_center().to_mem(&mpCenter[i * 3]);
+		mpIdx[i] = i;
+	}
+}
+
+static float geo_bvh_half_area(const cxAABB& bbox) {
+	cxVec s = bbox.get_size_vec();
+	return s.x*s.y + s.y*s.z + s.z*s.x;
+}
+
+/* partitions mpIdx[org, org+num) and returns the size of the left part */
+int cGeoBVHBuilder::split(int org, int num, cxAABB* pBBox) {
+	int32_t* pIdx = &mpIdx[org];
+	cxAABB bbox;
+	bbox.init();
+	float cmin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float cmax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (int i = 0; i < num; ++i) {
+		int ipol = pIdx[i];
+		bbox.merge(mpPolBBox[ipol]);
+		const float* pCtr = &mpCenter[ipol * 3];
+		for (int j = 0; j < 3; ++j) {
+			cmin[j] = nxCalc::min(cmin[j], pCtr[j]);
+			cmax[j] = nxCalc::max(cmax[j], pCtr[j]);
+		}
+	}
+	*pBBox = bbox;
+	if (num < 2) return num;
+
+	const int nbins = GEO_BVH_BINS_NUM;
+	Bin bins[GEO_BVH_BINS_NUM];
+	float rarea[GEO_BVH_BINS_NUM];
+	int32_t rcnt[GEO_BVH_BINS_NUM];
+	float bestCost = FLT_MAX;
+	int bestAxis = -1;
+	int bestBin = 0;
+	for (int axis = 0; axis < 3; ++axis) {
+		float ext = cmax[axis] - cmin[axis];
+		if (ext <= 0.0f) continue;
+		float scl = float(nbins) / ext;
+		for (int b = 0; b < nbins; ++b) {
+			bins[b].mBBox.init();
+			bins[b].mCount = 0;
+		}
+		for (int i = 0; i < num; ++i) {
+			int ipol = pIdx[i];
+			int b = nxCalc::min(int((mpCenter[ipol * 3 + axis] - cmin[axis]) * scl), nbins - 1);
+			bins[b].mBBox.merge(mpPolBBox[ipol]);
+			++bins[b].mCount;
+		}
+		cxAABB acc;
+		acc.init();
+		int cnt = 0;
+		for (int b = nbins - 1; b > 0; --b) {
+			acc.merge(bins[b].mBBox);
+			cnt += bins[b].mCount;
+			rarea[b] = cnt ? geo_bvh_half_area(acc) : 0.0f;
+			rcnt[b] = cnt;
+		}
+		acc.init();
+		cnt = 0;
+		for (int b = 0; b < nbins - 1; ++b) {
+			acc.merge(bins[b].mBBox);
+			cnt += bins[b].mCount;
+			if (cnt == 0 || rcnt[b + 1] == 0) continue;
+			float cost = geo_bvh_half_area(acc) * float(cnt) + rarea[b + 1] * float(rcnt[b + 1]);
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = b;
+			}
+		}
+	}
+	if (bestAxis < 0) {
+		/* all centroids coincide */
+		return num / 2;
+	}
+	float scl = float(nbins) / (cmax[bestAxis] - cmin[bestAxis]);
+	int i = 0;
+	int j = num - 1;
+	while (i <= j) {
+		int b = nxCalc::min(int((mpCenter[pIdx[i] * 3 + bestAxis] - cmin[bestAxis]) * scl), nbins - 1);
+		if (b <= bestBin) {
+			++i;
+		} else {
+			int t = pIdx[i];
+			pIdx[i] = pIdx[j];
+			pIdx[j] = t;
+			--j;
+		}
+	}
+	return i;
+}
+
+void cGeoBVHBuilder::write_node(const Task& task, int mid, const cxAABB& bbox, Task* pLeft, Task* pRight) {
+	sxGeometryData::BVH::Node* pNode = &mpDstNodes[task.mNodeIdx];
+	pNode->mBBox = bbox;
+	if (task.mNum == 1) {
+		pNode->mLeft = mpIdx[task.mOrg];
+		pNode->mRight = -1;
+		return;
+	}
+	pLeft->mOrg = task.mOrg;
+	pLeft->mNum = mid;
+	pLeft->mNodeIdx = task.mNodeIdx + 1;
+	pRight->mOrg = task.mOrg + mid;
+	pRight->mNum = task.mNum - mid;
+	pRight->mNodeIdx = task.mNodeIdx + mid * 2;
+	pNode->mLeft = pLeft->mNodeIdx;
+	pNode->mRight = pRight->mNodeIdx;
+}
+
+void cGeoBVHBuilder::build_task(const Task& task) {
+	/* the larger half is deferred, so the stack never exceeds log2(num) entries */
+	Task stk[64];
+	int sp = 0;
+	Task cur = task;
+	while (true) {
+		cxAABB bbox;
+		int mid = split(cur.mOrg, cur.mNum, &bbox);
+		Task left;
+		Task right;
+		write_node(cur, mid, bbox, &left, &right);
+		if (cur.mNum > 1) {
+			if (left.mNum >= right.mNum) {
+				stk[sp++] = left;
+				cur = right;
+			} else {
+				stk[sp++] = right;
+				cur = left;
+			}
+		} else {
+			if (sp == 0) break;
+			cur = stk[--sp];
+		}
+	}
+}
+
+/*static*/ void cGeoBVHBuilder::task_job(TSK_CONTEXT* pCtx) {
+	TSK_JOB* pJob = pCtx->mpJob;
+	cGeoBVHBuilder* pSelf = (cGeoBVHBuilder*)pJob->mpData;
+	pSelf->build_task(pSelf->mpTasks[pJob->mId]);
+}
+
+void cGeoBVHBuilder::build_nodes(sxGeometryData::BVH::Node* pNodes, int npol, TSK_BRIGADE* pBgd) {
+	mpDstNodes = pNodes;
+	Task root;
+	root.mOrg = 0;
+	root.mNum = npol;
+	root.mNodeIdx = 0;
+	bool tskFlg = pBgd && mpQueue && mpJobs && npol >= GEO_BVH_MIN_TASK_POLS * 2;
+	if (!tskFlg) {
+		build_task(root);
+		mpDstNodes = nullptr;
+		return;
+	}
+	/* the top of the tree is split serially until there are enough subtrees to go around,
+	   subtree node ranges follow from polygon counts, so the result does not depend on scheduling */
+	mTasksNum = 0;
+	mpTasks[mTasksNum++] = root;
+	while (mTasksNum < mTasksMax) {
+		int imax = 0;
+		for (int i = 1; i < mTasksNum; ++i) {
+			if (mpTasks[i].mNum > mpTasks[imax].mNum) {
+				imax = i;
+			}
+		}
+		Task cur = mpTasks[imax];
+		if (cur.mNum < GEO_BVH_MIN_TASK_POLS * 2) break;
+		cxAABB bbox;
+		int mid = split(cur.mOrg, cur.mNum, &bbox);
+		write_node(cur, mid, bbox, &mpTasks[imax], &mpTasks[mTasksNum]);
+		++mTasksNum;
+	}
+	tskQueuePurge(mpQueue);
+	for (int i = 0; i < mTasksNum; ++i) {
+		tskQueueAdd(mpQueue, &mpJobs[i]);
+	}
+	tskBrigadeSetActiveWorkers(pBgd, nxCalc::min(tskBrigadeGetNumWorkers(pBgd), mWrkNum));
+	tskQueueExec(mpQueue, pBgd);
+	tskBrigadeResetActiveWorkers(pBgd);
+	mpDstNodes = nullptr;
+}
+
+sxGeometryData* cGeoBVHBuilder::build(const sxGeometryData& geo, TSK_BRIGADE* pBgd) {
+	int npol = geo.get_pol_num();
+	if (npol <= 0 || npol > mPolMax) return nullptr;
+	int nnodes = calc_nodes_num(npol);
+	uint32_t bvhOffs = (uint32_t)XD_ALIGN(geo.mFileSize, 0x10);
+	uint32_t fileSize = bvhOffs + (uint32_t)sizeof(sxGeometryData::BVH) + nnodes * (uint32_t)sizeof(sxGeometryData::BVH::Node);
+	uint32_t pathSize = geo.has_file_path() ? geo.mFilePathLen + 1 : 0;
+	sxGeometryData* pGeo = (sxGeometryData*)nxCore::mem_alloc(fileSize + pathSize, XD_DAT_MEM_TAG);
+	if (!pGeo) return nullptr;
+	::memcpy(pGeo, &geo, geo.mFileSize);
+	::memset(XD_INCR_PTR(pGeo, geo.mFileSize), 0, bvhOffs - geo.mFileSize);
+	if (pathSize) {
+		::memcpy(XD_INCR_PTR(pGeo, fileSize), geo.get_file_path(), pathSize);
+	}
+	pGeo->mFileSize = fileSize;
+	pGeo->mBVHOffs = bvhOffs;
+	sxGeometryData::BVH* pBVH = pGeo->get_BVH();
+	pBVH->mNodesNum = nnodes;
+	pBVH->mReserved0 = 0;
+	pBVH->mReserved1 = 0;
+	pBVH->mReserved2 = 0;
+	prepare(*pGeo);
+	build_nodes((sxGeometryData::BVH::Node*)(pBVH + 1), npol, pBgd);
+	return pGeo;
+}
+
+bool cGeoBVHBuilder::rebuild(sxGeometryData* pGeo, TSK_BRIGADE* pBgd) {
+	if (!pGeo || !pGeo->has_BVH()) return false;
+	int npol = pGeo->get_pol_num();
+	if (npol <= 0 || npol > mPolMax) return false;
+	sxGeometryData::BVH* pBVH = pGeo->get_BVH();
+	int nnodes = calc_nodes_num(npol);
+	if ((int)pBVH->mNodesNum < nnodes) return false;
+	pBVH->mNodesNum = nnodes;
+	prepare(*pGeo);
+	build_nodes((sxGeometryData::BVH::Node*)(pBVH + 1), npol, pBgd);
+	return true;
+}
+
+/*static*/ void cGeoBVHBuilder::refit(sxGeometryData* pGeo) {
+	if (!pGeo) return;
+	int npnt = pGeo->get_pnt_num();
+	cxAABB geoBBox;
+	geoBBox.init();
+	for (int i = 0; i < npnt; ++i) {
+		geoBBox.add_pnt(pGeo->get_pnt(i));
+	}
+	pGeo->mBBox = geoBBox;
+	sxGeometryData::BVH* pBVH = pGeo->get_BVH();
+	if (!pBVH) return;
+	int nnodes = (int)pBVH->mNodesNum;
+	sxGeometryData::BVH::Node* pNodes = (sxGeometryData::BVH::Node*)(pBVH + 1);
+	bool childrenAfter = true;
+	for (int i = 0; i < nnodes; ++i) {
+		if (!pNodes[i].is_leaf() && (pNodes[i].mLeft <= i || pNodes[i].mRight <= i)) {
+			childrenAfter = false;
+			break;
+		}
+	}
+	if (childrenAfter) {
+		for (int i = nnodes; --i >= 0;) {
+			sxGeometryData::BVH::Node* pNode = &pNodes[i];
+			if (pNode->is_leaf()) {
+				pNode->mBBox = pGeo->get_pol(pNode->get_pol_id()).calc_bbox();
+			} else {
+				pNode->mBBox = pNodes[pNode->mLeft].mBBox;
+				pNode->mBBox.merge(pNodes[pNode->mRight].mBBox);
+			}
+		}
+		return;
+	}
+	/* arbitrary node order: post-order walk, ~idx entries mark nodes whose children are done */
+	int32_t* pStk = (int32_t*)nxCore::mem_alloc(nnodes * 2 * sizeof(int32_t), XD_TMP_MEM_TAG);
+	if (!pStk) return;
+	int sp = 0;
+	pStk[sp++] = 0;
+	while (sp > 0) {
+		int32_t ent = pStk[--sp];
+		if (ent >= 0) {
+			sxGeometryData::BVH::Node* pNode = &pNodes[ent];
+			if (pNode->is_leaf()) {
+				pNode->mBBox = pGeo->get_pol(pNode->get_pol_id()).calc_bbox();
+			} else {
+				pStk[sp++] = ~ent;
+				pStk[sp++] = pNode->mRight;
+				pStk[sp++] = pNode->mLeft;
+			}
+		} else {
+			sxGeometryData::BVH::Node* pNode = &pNodes[~ent];
+			pNode->mBBox = pNodes[pNode->mLeft].mBBox;
+			pNode->mBBox.merge(pNodes[pNode->mRight].mBBox);
+		}
+	}
+	nxCore::mem_free(pStk);
+}
+
+
+/* n x n grid of unit quads split in two triangles, jittered heights, no BVH; free with nxCore::mem_free */
+static sxGeometryData* geo_bvh_bench_grid(int n, uint64_t seed) {
+	int npnt = (n + 1) * (n + 1);
+	int ntri = n * n * 2;
+	uint32_t headSize = (uint32_t)XD_ALIGN(sizeof(sxGeometryData), 0x10);
+	uint32_t pntOffs = headSize;
+	uint32_t polOffs = pntOffs + npnt * (uint32_t)sizeof(cxVec);
+	int idxSize = npnt <= (1 << 8) ? 1 : (npnt <= (1 << 16) ? 2 : 3);
+	uint32_t fileSize = (uint32_t)XD_ALIGN(polOffs + ntri * 3 * idxSize, 0x10);
+	void* pMem = nxCore::mem_alloc(fileSize, XD_TMP_MEM_TAG);
+	if (!pMem) return nullptr;
+	::memset(pMem, 0, fileSize);
+	sxGeometryData* pGeo = (sxGeometryData*)pMem;
+	pGeo->mKind = sxGeometryData::KIND;
+	pGeo->mFlags = 1 | 2; /* same polygon size, same material */
+	pGeo->mFileSize = fileSize;
+	pGeo->mHeadSize = headSize;
+	pGeo->mNameId = -1;
+	pGeo->mPathId = -1;
+	pGeo->mPntNum = npnt;
+	pGeo->mPolNum = ntri;
+	pGeo->mMaxVtxPerPol = 3;
+	pGeo->mPntOffs = pntOffs;
+	pGeo->mPolOffs = polOffs;
+	sxRNG rng;
+	nxCore::rng_seed(&rng, seed);
+	cxVec* pPnt = (cxVec*)XD_INCR_PTR(pGeo, pntOffs);
+	cxAABB bbox;
+	bbox.init();
+	for (int z = 0; z <= n; ++z) {
+		for (int x = 0; x <= n; ++x) {
+			cxVec pos((float)x, nxCore::rng_f01(&rng) * 2.0f, (float)z);
+			pPnt[z * (n + 1) + x] = pos;
+			bbox.add_pnt(pos);
+		}
+	}
+	pGeo->mBBox = bbox;
+	uint8_t* pIdx = (uint8_t*)XD_INCR_PTR(pGeo, polOffs);
+	for (int z = 0; z < n; ++z) {
+		for (int x = 0; x < n; ++x) {
+			int i00 = z * (n + 1) + x;
+			int i10 = i00 + 1;
+			int i01 = i00 + n + 1;
+			int i11 = i01 + 1;
+			int quad[6] = { i00, i01, i10, i10, i01, i11 };
+			for (int i = 0; i < 6; ++i) {
+				for (int b = 0; b < idxSize; ++b) {
+					*pIdx++ = (uint8_t)(quad[i] >> (b * 8));
+				}
+			}
+		}
+	}
+	return pGeo;
+}
+
+struct sGeoBVHBenchIds : public sxGeometryData::HitFunc, public sxGeometryData::RangeFunc {
+	int32_t* mpIds;
+	int mNum;
+	int mMax;
+
+	void add(int id) {
+		if (mNum < mMax) {
+			mpIds[mNum] = id;
+		}
+		++mNum;
+	}
+
+	virtual bool operator()(const sxGeometryData::Polygon& pol, const cxVec& hitPos, const cxVec& hitNrm, float hitDist) {
+		add(pol.get_id());
+		return true;
+	}
+
+	virtual bool operator()(const sxGeometryData::Polygon& pol) {
+		add(pol.get_id());
+		return true;
+	}
+};
+
+static int geo_bvh_bench_id_cmp(const void* pA, const void* pB) {
+	int32_t a = *(const int32_t*)pA;
+	int32_t b = *(const int32_t*)pB;
+	return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+static bool geo_bvh_bench_same(sGeoBVHBenchIds& ref, sGeoBVHBenchIds& ids) {
+	if (ref.mNum != ids.mNum) return false;
+	int n = nxCalc::min(ref.mNum, ref.mMax);
+	::qsort(ref.mpIds, n, sizeof(int32_t), geo_bvh_bench_id_cmp);
+	::qsort(ids.mpIds, n, sizeof(int32_t), geo_bvh_bench_id_cmp);
+	return ::memcmp(ref.mpIds, ids.mpIds, n * sizeof(int32_t)) == 0;
+}
+
+/* hit and range queries through the BVH against brute force, returns the number of differing queries */
+static int geo_bvh_bench_check(const sxGeometryData& geo, int nqry, uint64_t seed, int32_t* pIdMem) {
+	int npol = geo.get_pol_num();
+	sGeoBVHBenchIds ref;
+	ref.mpIds = pIdMem;
+	ref.mMax = npol;
+	sGeoBVHBenchIds ids;
+	ids.mpIds = pIdMem + npol;
+	ids.mMax = npol;
+	sxRNG rng;
+	nxCore::rng_seed(&rng, seed);
+	cxVec bmin = geo.mBBox.get_min_pos();
+	cxVec size = geo.mBBox.get_size_vec();
+	int nbad = 0;
+	for (int i = 0; i < nqry; ++i) {
+		cxVec pos = bmin + size * cxVec(nxCore::rng_f01(&rng), 0.5f, nxCore::rng_f01(&rng));
+		cxVec dir((nxCore::rng_f01(&rng) - 0.5f) * 8.0f, -size.y - 2.0f, (nxCore::rng_f01(&rng) - 0.5f) * 8.0f);
+		cxLineSeg seg(pos - dir * 0.5f, pos + dir * 0.5f);
+		ref.mNum = 0;
+		geo.hit_query_nobvh(seg, ref);
+		ids.mNum = 0;
+		geo.hit_query(seg, ids);
+		nbad += geo_bvh_bench_same(ref, ids) ? 0 : 1;
+		cxVec r(0.1f + nxCore::rng_f01(&rng) * 3.0f);
+		cxAABB box(pos - r, pos + r);
+		ref.mNum = 0;
+		geo.range_query_nobvh(box, ref);
+		ids.mNum = 0;
+		geo.range_query(box, ids);
+		nbad += geo_bvh_bench_same(ref, ids) ? 0 : 1;
+	}
+	return nbad;
+}
+
+void geo_bvh_bench(TSK_BRIGADE* pBgd, FILE* pOut) {
+	static const int s_gridSizes[] = { 71, 224, 708 }; /* 10k, 100k, 1M triangles */
+	if (!pOut) {
+		pOut = stdout;
+	}
+	const int nqry = 100;
+	int nwrk = pBgd ? tskBrigadeGetNumWorkers(pBgd) : 1;
+	for (int isize = 0; isize < (int)XD_ARY_LEN(s_gridSizes); ++isize) {
+		sxGeometryData* pSrc = geo_bvh_bench_grid(s_gridSizes[isize], 1);
+		if (!pSrc) continue;
+		int npol = pSrc->get_pol_num();
+		int32_t* pIdMem = (int32_t*)nxCore::mem_alloc(npol * 2 * sizeof(int32_t), XD_TMP_MEM_TAG);
+		cGeoBVHBuilder bld;
+		bld.init(npol, nwrk);
+		double t0 = time_micros();
+		sxGeometryData* pGeo = bld.build(*pSrc);
+		double tser = time_micros() - t0;
+		t0 = time_micros();
+		sxGeometryData* pGeoMT = bld.build(*pSrc, pBgd);
+		double tpar = time_micros() - t0;
+		if (pGeo && pGeoMT && pIdMem) {
+			size_t bvhSize = sizeof(sxGeometryData::BVH) + cGeoBVHBuilder::calc_nodes_num(npol) * sizeof(sxGeometryData::BVH::Node);
+			bool same = ::memcmp(pGeo->get_BVH(), pGeoMT->get_BVH(), bvhSize) == 0;
+			int nbad = geo_bvh_bench_check(*pGeo, nqry, 3, pIdMem);
+			/* deformed points: refit keeps the topology, rebuild starts over */
+			cxVec* pPnt = (cxVec*)pGeo->get_pnt_top();
+			for (int i = 0; i < pGeo->get_pnt_num(); ++i) {
+				pPnt[i].y += ::sinf(pPnt[i].x * 0.3f) * 1.5f;
+			}
+			t0 = time_micros();
+			cGeoBVHBuilder::refit(pGeo);
+			double trefit = time_micros() - t0;
+			int nbadRefit = geo_bvh_bench_check(*pGeo, nqry, 4, pIdMem);
+			t0 = time_micros();
+			bool rebuilt = bld.rebuild(pGeo, pBgd);
+			double trebuild = time_micros() - t0;
+			int nbadRebuild = rebuilt ? geo_bvh_bench_check(*pGeo, nqry, 5, pIdMem) : nqry * 2;
+			::fprintf(pOut, "BVH %7d tris: build %.1f ms, %.1f ms on %d workers%s, refit %.1f ms, rebuild %.1f ms; %d/%d/%d of %d queries off brute force\n",
+			          npol, tser / 1e3, tpar / 1e3, nwrk, same ? "" : " (DIFFERENT NODES)", trefit / 1e3, trebuild / 1e3,
+			          nbad, nbadRefit, nbadRebuild, nqry * 2);
+		}
+		nxData::unload(pGeo);
+		nxData::unload(pGeoMT);
+		nxCore::mem_free(pIdMem);
+		nxCore::mem_free(pSrc);
+	}
+}
@@ -0,0 +1,65 @@
+struct TSK_BRIGADE;
+struct TSK_QUEUE;
+struct TSK_JOB;
+struct TSK_CONTEXT;
+
+#define GEO_BVH_BINS_NUM 16
+
+/* Binned SAH builder writing the sxGeometryData BVH layout (one polygon per leaf, 2*npol-1 nodes).
+   Nodes are emitted depth-first: a node's left child follows it, the right child follows the left subtree. */
+class cGeoBVHBuilder {
+protected:
+	struct Task {
+		int32_t mOrg;
+		int32_t mNum;
+		int32_t mNodeIdx;
+	};
+
+	struct Bin {
+		cxAABB mBBox;
+		int32_t mCount;
+	};
+
+	cxAABB* mpPolBBox;
+	float* mpCenter; /* xyz per polygon */
+	int32_t* mpIdx;
+	Task* mpTasks;
+	TSK_JOB* mpJobs;
+	TSK_QUEUE* mpQueue;
+	sxGeometryData::BVH::Node* mpDstNodes;
+	int mPolMax;
+	int mTasksNum;
+	int mTasksMax;
+	int mWrkNum;
+
+	void prepare(const sxGeometryData& geo);
+	int split(int org, int num, cxAABB* pBBox);
+	void write_node(const Task& task, int mid, const cxAABB& bbox, Task* pLeft, Task* pRight);
+	void build_task(const Task& task);
+	void build_nodes(sxGeometryData::BVH::Node* pNodes, int npol, TSK_BRIGADE* pBgd);
+
+	static void task_job(TSK_CONTEXT* pCtx);
+
+public:
+	cGeoBVHBuilder()
+	: mpPolBBox(nullptr), mpCenter(nullptr), mpIdx(nullptr), mpTasks(nullptr), mpJobs(nullptr), mpQueue(nullptr),
+	mpDstNodes(nullptr), mPolMax(0), mTasksNum(0), mTasksMax(0), mWrkNum(0) {}
+
+	~cGeoBVHBuilder() { reset(); }
+
+	void init(int maxPols, int maxWorkers = 1);
+	void reset();
+
+	/* new geometry blob with a BVH section appended (any existing BVH is left unused), free with nxData::unload */
+	sxGeometryData* build(const sxGeometryData& geo, TSK_BRIGADE* pBgd = nullptr);
+	/* overwrites the existing BVH section, which must have room for 2*npol-1 nodes */
+	bool rebuild(sxGeometryData* pGeo, TSK_BRIGADE* pBgd = nullptr);
+
+	/* node boxes (and mBBox) recomputed from the current point positions, topology is kept; FlatBVH copies must be re-created */
+	static void refit(sxGeometryData* pGeo);
+	static int calc_nodes_num(int npol) { return npol > 0 ? npol * 2 - 1 : 0; }
+};
+
+/* builds on 10k..1M triangle grids, serial and on pBgd (nodes must match), queries through the built, refit
+   and rebuilt BVHs checked against brute force */
+void geo_bvh_bench(TSK_BRIGADE* pBgd = nullptr, FILE* pOut = nullptr);
@@ -0,0 +1,312 @@
+#include "crossdata.hpp"
+#include "task.hpp"
+#include "timer.hpp"
+#include "geo_calc.hpp"
+
+#define GEO_CALC_JOBS_PER_WRK 4
+#define GEO_CALC_MIN_JOB_ITEMS 2048
+
+void cGeoCalc::init(int maxPnts, int maxTris, int maxWorkers) {
+	reset();
+	if (maxPnts <= 0 || maxTris < 0) return;
+	mWrkNum = nxCalc::max(maxWorkers, 1);
+	mPntMax = maxPnts;
+	mTriMax = maxTris;
+	mJobsMax = mWrkNum * GEO_CALC_JOBS_PER_WRK;
+	mpPntTriOrg = (int32_t*)nxCore::mem_alloc((maxPnts + 1) * sizeof(int32_t), XD_FOURCC('G', 'c', 'P', 'O'));
+	mpJobBBox = (cxAABB*)nxCore::mem_alloc(mJobsMax * sizeof(cxAABB), XD_FOURCC('G', 'c', 'B', 'B'));
+	if (maxTris > 0) {
+		mpTriTng = (cxVec*)nxCore::mem_alloc(maxTris * sizeof(cxVec), XD_FOURCC('G', 'c', 'T', 'T'));
+		mpPntTriIdx = (int32_t*)nxCore::mem_alloc(maxTris * 3 * sizeof(int32_t), XD_FOURCC('G', 'c', 'P', 'T'));
+		if (!mpTriTng || !mpPntTriIdx) {
+			nxCore::mem_free(mpTriTng);
+			mpTriTng = nullptr;
+			nxCore::mem_free(mpPntTriIdx);
+			mpPntTriIdx = nullptr;
+			mTriMax = 0;
+		}
+	}
+	if (!mpPntTriOrg || !mpJobBBox) {
+		reset();
+		return;
+	}
+	if (mWrkNum > 1) {
+		mpQueue = tskQueueCreate(mJobsMax);
+		mpJobs = tskJobsAlloc(mJobsMax);
+		if (mpQueue && mpJobs) {
+			for (int i = 0; i < mJobsMax; ++i) {
+				mpJobs[i].mFunc = task_job;
+				mpJobs[i].mpData = this;
+			}
+		} else {
+			tskQueueDestroy(mpQueue);
+			mpQueue = nullptr;
+			tskJobsFree(mpJobs);
+			mpJobs = nullptr;
+		}
+	}
+}
+
+void cGeoCalc::reset() {
+	nxCore::mem_free(mpTriTng);
+	mpTriTng = nullptr;
+	nxCore::mem_free(mpPntTriOrg);
+	mpPntTriOrg = nullptr;
+	nxCore::mem_free(mpPntTriIdx);
+	mpPntTriIdx = nullptr;
+	nxCore::mem_free(mpJobBBox);
+	mpJobBBox = nullptr;
+	tskQueueDestroy(mpQueue);
+	mpQueue = nullptr;
+	tskJobsFree(mpJobs);
+	mpJobs = nullptr;
+	mpGeo = nullptr;
+	mpMtx = nullptr;
+	mpDstTng = nullptr;
+	mItemsNum = 0;
+	mJobsNum = 0;
+	mPntMax = 0;
+	mTriMax = 0;
+	mJobsMax = 0;
+	mWrkNum = 0;
+}
+
+/* counting sort by point, filled back to front so every point lists its triangles in ascending order */
+void cGeoCalc::build_pnt_tris(int npnt, int ntri) {
+	int32_t* pOrg = mpPntTriOrg;
+	::memset(pOrg, 0, (npnt + 1) * sizeof(int32_t));
+	for (int i = 0; i < ntri; ++i) {
+		sxGeometryData::Polygon tri = mpGeo->get_pol(i);
+		for (int j = 0; j < 3; ++j) {
+			++pOrg[tri.get_vtx_pnt_id(j)];
+		}
+	}
+	int32_t sum = 0;
+	for (int i = 0; i < npnt; ++i) {
+		sum += pOrg[i];
+		pOrg[i] = sum;
+	}
+	pOrg[npnt] = sum;
+	for (int i = ntri; --i >= 0;) {
+		sxGeometryData::Polygon tri = mpGeo->get_pol(i);
+		for (int j = 3; --j >= 0;) {
+			mpPntTriIdx[--pOrg[tri.get_vtx_pnt_id(j)]] = i;
+		}
+	}
+}
+
+void cGeoCalc::exec_range(int org, int num, int jobId) {
+	int end = org + num;
+	switch (mPhase) {
+		case ePhase::TRI_TNG:
+			for (int i = org; i < end; ++i) {
+				mpTriTng[i] = mpGeo->calc_tri_tangent(i, mTexAttrIdx);
+			}
+			break;
+		case ePhase::PNT_TNG:
+			for (int i = org; i < end; ++i) {
+				cxVec sum;
+				sum.zero();
+				for (int k = mpPntTriOrg[i]; k < mpPntTriOrg[i + 1]; ++k) {
+					sum.add(mpTriTng[mpPntTriIdx[k]]);
+				}
+				mpDstTng[i] = mpGeo->calc_pnt_tangent(i, mNrmAttrIdx, sum, mFlip);
+			}
+			break;
+		case ePhase::PNT_BBOX:
+			{
+				cxAABB bbox;
+				bbox.init();
+				if (mpMtx) {
+					for (int i = org; i < end; ++i) {
+						bbox.add_pnt(mpMtx->calc_pnt(mpGeo->get_pnt(i)));
+					}
+				} else {
+					for (int i = org; i < end; ++i) {
+						bbox.add_pnt(mpGeo->get_pnt(i));
+					}
+				}
+				mpJobBBox[jobId] = bbox;
+			}
+			break;
+	}
+}
+
+/*static*/ void cGeoCalc::task_job(TSK_CONTEXT* pCtx) {
+	TSK_JOB* pJob = pCtx->mpJob;
+	cGeoCalc* pSelf = (cGeoCalc*)pJob->mpData;
+	int id = pJob->mId;
+	int org = int((int64_t)pSelf->mItemsNum * id / pSelf->mJobsNum);
+	int end = int((int64_t)pSelf->mItemsNum * (id + 1) / pSelf->mJobsNum);
+	pSelf->exec_range(org, end - org, id);
+}
+
+bool cGeoCalc::ck_tasks(int nitems, TSK_BRIGADE* pBgd) const {
+	return pBgd && mpQueue && mpJobs && nitems >= GEO_CALC_MIN_JOB_ITEMS * 2;
+}
+
+void cGeoCalc::exec_phase(ePhase phase, int nitems, TSK_BRIGADE* pBgd) {
+	mPhase = phase;
+	mItemsNum = nitems;
+	if (!ck_tasks(nitems, pBgd)) {
+		mJobsNum = 1;
+		exec_range(0, nitems, 0);
+		return;
+	}
+	/* fixed item ranges per job id, so partial results do not depend on scheduling */
+	mJobsNum = nxCalc::min(mJobsMax, nitems / GEO_CALC_MIN_JOB_ITEMS);
+	tskQueuePurge(mpQueue);
+	for (int i = 0; i < mJobsNum; ++i) {
+		tskQueueAdd(mpQueue, &mpJobs[i]);
+	}
+	tskBrigadeSetActiveWorkers(pBgd, nxCalc::min(tskBrigadeGetNumWorkers(pBgd), mWrkNum));
+	tskQueueExec(mpQueue, pBgd);
+	tskBrigadeResetActiveWorkers(pBgd);
+}
+
+void cGeoCalc::calc_tangents(const sxGeometryData& geo, cxVec* pTng, bool flip, const char* pAttrName, TSK_BRIGADE* pBgd) {
+	if (!pTng) return;
+	int npnt = geo.get_pnt_num();
+	int ntri = geo.get_pol_num();
+	int nrmAttrIdx = geo.find_pnt_attr("N");
+	int texAttrIdx = geo.find_pnt_attr(pAttrName ? pAttrName : "uv");
+	bool ok = mpPntTriOrg && mpTriTng && npnt <= mPntMax && ntri <= mTriMax;
+	ok = ok && geo.is_all_tris() && nrmAttrIdx >= 0 && texAttrIdx >= 0;
+	/* the point->triangle table only pays off when the work is actually split */
+	ok = ok && ck_tasks(ntri, pBgd);
+	if (!ok) {
+		geo.calc_tangents(pTng, flip, pAttrName);
+		return;
+	}
+	mpGeo = &geo;
+	mpDstTng = pTng;
+	mNrmAttrIdx = nrmAttrIdx;
+	mTexAttrIdx = texAttrIdx;
+	mFlip = flip;
+	build_pnt_tris(npnt, ntri);
+	exec_phase(ePhase::TRI_TNG, ntri, pBgd);
+	exec_phase(ePhase::PNT_TNG, npnt, pBgd);
+	mpGeo = nullptr;
+	mpDstTng = nullptr;
+}
+
+cxAABB cGeoCalc::calc_pnt_bbox(const sxGeometryData& geo, const cxMtx* pMtx, TSK_BRIGADE* pBgd) {
+	int npnt = geo.get_pnt_num();
+	if (!mpJobBBox || npnt > mPntMax || !ck_tasks(npnt, pBgd)) {
+		return geo.calc_pnt_bbox(pMtx);
+	}
+	mpGeo = &geo;
+	mpMtx = pMtx;
+	exec_phase(ePhase::PNT_BBOX, npnt, pBgd);
+	cxAABB bbox = mpJobBBox[0];
+	for (int i = 1; i < mJobsNum; ++i) {
+		bbox.merge(mpJobBBox[i]);
+	}
+	mpGeo = nullptr;
+	mpMtx = nullptr;
+	return bbox;
+}
+
+
+/* per-point sum of the adjacent triangles' UV tangents (all of them, not the last one seen), then orthogonalized against N */
+static void geo_calc_ref_tangents(const sxGeometryData& geo, cxVec* pTng, bool flip) {
+	int npnt = geo.get_pnt_num();
+	int ntri = geo.get_pol_num();
+	int nrmAttrIdx = geo.find_pnt_attr("N");
+	int texAttrIdx = geo.find_pnt_attr("uv");
+	double* pSum = (double*)nxCore::mem_alloc(npnt * 3 * sizeof(double), XD_TMP_MEM_TAG);
+	if (!pSum) return;
+	::memset(pSum, 0, npnt * 3 * sizeof(double));
+	for (int i = 0; i < ntri; ++i) {
+		sxGeometryData::Polygon tri = geo.get_pol(i);
+		double pos[3][3];
+		double uv[3][2];
+		for (int j = 0; j < 3; ++j) {
+			int pid = tri.get_vtx_pnt_id(j);
+			cxVec pnt = geo.get_pnt(pid);
+			float* pUV = geo.get_pnt_attr_data_f(texAttrIdx, pid, 2);
+			pos[j][0] = pnt.x;
+			pos[j][1] = pnt.y;
+			pos[j][2] = pnt.z;
+			uv[j][0] = pUV ? pUV[0] : 0.0;
+			uv[j][1] = pUV ? pUV[1] : 0.0;
+		}
+		double du1 = uv[1][0] - uv[0][0];
+		double dv1 = uv[1][1] - uv[0][1];
+		double du2 = uv[2][0] - uv[0][0];
+		double dv2 = uv[2][1] - uv[0][1];
+		double det = du1*dv2 - dv1*du2;
+		double d = det != 0.0 ? 1.0 / det : 0.0;
+		for (int j = 0; j < 3; ++j) {
+			double t = ((pos[1][j] - pos[0][j])*dv2 - (pos[2][j] - pos[0][j])*dv1) * d;
+			for (int k = 0; k < 3; ++k) {
+				pSum[tri.get_vtx_pnt_id(k)*3 + j] += t;
+			}
+		}
+	}
+	for (int i = 0; i < npnt; ++i) {
+		cxVec sum(float(pSum[i*3]), float(pSum[i*3 + 1]), float(pSum[i*3 + 2]));
+		float* pNrm = geo.get_pnt_attr_data_f(nrmAttrIdx, i, 3);
+		cxVec nrm = pNrm ? cxVec(pNrm[0], pNrm[1], pNrm[2]) : cxVec(0.0f);
+		cxVec tng = sum - nrm*nrm.dot(sum);
+		pTng[i] = (flip ? tng.neg_val() : tng).get_normalized();
+	}
+	nxCore::mem_free(pSum);
+}
+
+void geo_calc_bench(const sxGeometryData& geo, FILE* pOut) {
+	static const int s_wrkNums[] = { 1, 2, 4 };
+	if (!pOut) {
+		pOut = stdout;
+	}
+	int npnt = geo.get_pnt_num();
+	int ntri = geo.get_pol_num();
+	bool tngFlg = geo.is_all_tris() && geo.find_pnt_attr("N") >= 0 && geo.find_pnt_attr("uv") >= 0;
+	cxVec* pRef = (cxVec*)nxCore::mem_alloc(npnt * sizeof(cxVec), XD_TMP_MEM_TAG);
+	cxVec* pTng = (cxVec*)nxCore::mem_alloc(npnt * sizeof(cxVec), XD_TMP_MEM_TAG);
+	if (!pRef || !pTng) {
+		nxCore::mem_free(pRef);
+		nxCore::mem_free(pTng);
+		return;
+	}
+	::fprintf(pOut, "%d points, %d polygons%s\n", npnt, ntri, tngFlg ? "" : ", no tangents (not all tris or no N/uv)");
+	cxMtx mtx;
+	mtx.set_rot_degrees(cxVec(10.0f, 33.0f, -5.0f));
+	mtx.set_translation(cxVec(1.0f, -2.0f, 3.0f));
+	for (int flip = 0; flip < 2; ++flip) {
+		double t0 = time_micros();
+		geo.calc_tangents(pRef, !!flip);
+		double tser = time_micros() - t0;
+		/* regression check of the serial output: every adjacent triangle contributes */
+		int nreg = 0;
+		if (tngFlg) {
+			geo_calc_ref_tangents(geo, pTng, !!flip);
+			for (int i = 0; i < npnt; ++i) {
+				if (pTng[i].mag2() > 0.5f && pRef[i].dot(pTng[i]) < 0.999f) ++nreg;
+			}
+		}
+		for (int iwrk = 0; iwrk < (int)XD_ARY_LEN(s_wrkNums); ++iwrk) {
+			int nwrk = s_wrkNums[iwrk];
+			TSK_BRIGADE* pBgd = nwrk > 1 ? tskBrigadeCreate(nwrk) : nullptr;
+			cGeoCalc calc;
+			calc.init(npnt, ntri, nwrk);
+			::memset(pTng, 0xCD, npnt * sizeof(cxVec));
+			t0 = time_micros();
+			calc.calc_tangents(geo, pTng, !!flip, nullptr, pBgd);
+			double tpar = time_micros() - t0;
+			int nerr = ::memcmp(pRef, pTng, npnt * sizeof(cxVec)) != 0 ? 1 : 0;
+			cxAABB bboxRef = geo.calc_pnt_bbox(&mtx);
+			cxAABB bbox = calc.calc_pnt_bbox(geo, &mtx, pBgd);
+			nerr += ::memcmp(&bboxRef, &bbox, sizeof(cxAABB)) != 0 ? 1 : 0;
+			bboxRef = geo.calc_pnt_bbox();
+			bbox = calc.calc_pnt_bbox(geo, nullptr, pBgd);
+			nerr += ::memcmp(&bboxRef, &bbox, sizeof(cxAABB)) != 0 ? 1 : 0;
+			::fprintf(pOut, " flip %d, %d workers: tangents serial %.2f ms, cGeoCalc %.2f ms, %d off the reference, %d mismatches\n",
+			          flip, nwrk, tser / 1e3, tpar / 1e3, nreg, nerr);
+			calc.reset();
+			tskBrigadeDestroy(pBgd);
+		}
+	}
+	nxCore::mem_free(pRef);
+	nxCore::mem_free(pTng);
+}
@@ -0,0 +1,62 @@
+struct TSK_BRIGADE;
+struct TSK_QUEUE;
+struct TSK_JOB;
+struct TSK_CONTEXT;
+
+/* Parallel versions of the sxGeometryData per-point computations.
+   Results are bit-identical to the serial sxGeometryData::calc_tangents / calc_pnt_bbox for any number of workers:
+   tangents are summed per point in polygon order via a point->triangle table, bounds are min/max reductions. */
+class cGeoCalc {
+protected:
+	enum class ePhase {
+		TRI_TNG,
+		PNT_TNG,
+		PNT_BBOX
+	};
+
+	cxVec* mpTriTng;
+	int32_t* mpPntTriOrg; /* npnt+1 */
+	int32_t* mpPntTriIdx; /* ntri*3 */
+	cxAABB* mpJobBBox;
+	TSK_JOB* mpJobs;
+	TSK_QUEUE* mpQueue;
+	const sxGeometryData* mpGeo;
+	const cxMtx* mpMtx;
+	cxVec* mpDstTng;
+	ePhase mPhase;
+	int mItemsNum;
+	int mJobsNum;
+	int mNrmAttrIdx;
+	int mTexAttrIdx;
+	bool mFlip;
+	int mPntMax;
+	int mTriMax;
+	int mJobsMax;
+	int mWrkNum;
+
+	bool ck_tasks(int nitems, TSK_BRIGADE* pBgd) const;
+	void build_pnt_tris(int npnt, int ntri);
+	void exec_range(int org, int num, int jobId);
+	void exec_phase(ePhase phase, int nitems, TSK_BRIGADE* pBgd);
+
+	static void task_job(TSK_CONTEXT* pCtx);
+
+public:
+	cGeoCalc()
+	: mpTriTng(nullptr), mpPntTriOrg(nullptr), mpPntTriIdx(nullptr), mpJobBBox(nullptr), mpJobs(nullptr), mpQueue(nullptr),
+	mpGeo(nullptr), mpMtx(nullptr), mpDstTng(nullptr), mPhase(ePhase::TRI_TNG), mItemsNum(0), mJobsNum(0),
+	mNrmAttrIdx(-1), mTexAttrIdx(-1), mFlip(false), mPntMax(0), mTriMax(0), mJobsMax(0), mWrkNum(0) {}
+
+	~cGeoCalc() { reset(); }
+
+	void init(int maxPnts, int maxTris, int maxWorkers = 1);
+	void reset();
+
+	/* same contract as sxGeometryData::calc_tangents, falls back to it without workers or beyond init() limits */
+	void calc_tangents(const sxGeometryData& geo, cxVec* pTng, bool flip = false, const char* pAttrName = nullptr, TSK_BRIGADE* pBgd = nullptr);
+	cxAABB calc_pnt_bbox(const sxGeometryData& geo, const cxMtx* pMtx = nullptr, TSK_BRIGADE* pBgd = nullptr);
+};
+
+/* cGeoCalc with 1, 2 and 4 workers against the serial functions (must match bit for bit),
+   serial tangents against a per-point sum over all adjacent triangles */
+void geo_calc_bench(const sxGeometryData& geo, FILE* pOut = nullptr);
@@ -12,6 +12,8 @@
 
 #include "crossdata.hpp"
 #include "gex.hpp"
+#include "key_sort.hpp"
+#include "prim_sort.hpp"
 
 #include "gpu/context.h"
 #include "gpu/code/vs_obj.h"
@@ -405,6 +407,8 @@ static struct GEX_GWK {
 	int mCamCount;
 	int mLitCount;
 	GEX_DISP_ENTRY* mpDispList;
+	GEX_DISP_ENTRY* mpDispListWk;
+	sSortKey* mpDispSortKeys; /* keys + radix sort work */
 	int mDispListSize;
 	int mDispListPtr;
 	GEX_CAM* mpScnCam;
@@ -419,6 +423,11 @@ static struct GEX_GWK {
 	int mObjCullCnt;
 	int mBatCullCnt;
 	int mPolCullCnt;
+	int mPolDrawCnt;
+	ID3D11Buffer* mpPolRingVB; /* vertices of the polygons displayed in the scene, rewritten by gexEndScene */
+	int mPolRingSize;
+	int mPolRunVtxNum; /* vertices drawn by the current polygon entry, including the entries merged into it */
+	uint32_t mPolRingStamp;
 	int mShadowCastCnt;
 	int mShadowRecvCnt;
 	float mShadowFadeStart;
@@ -842,6 +851,8 @@ void gexInit(const GEX_CONFIG& cfg) {
 
 	GWK.mDispListSize = 32768*2;
 	GWK.mpDispList = gexTypeAlloc<GEX_DISP_ENTRY>(XD_FOURCC('D', 'I', 'S', 'P'), GWK.mDispListSize);
+	GWK.mpDispListWk = gexTypeAlloc<GEX_DISP_ENTRY>(XD_FOURCC('D', 'I', 'S', 'W'), GWK.mDispListSize);
+	GWK.mpDispSortKeys = gexTypeAlloc<sSortKey>(XD_FOURCC('D', 'I', 'S', 'K'), GWK.mDispListSize * 2);
 	GWK.mDispListPtr = 0;
 
 	GWK.mpDefCam = gexCamCreate(D_GEX_SYS_CAM_NAME);
@@ -943,6 +954,14 @@ void gexReset() {
 	}
 
 	nxCore::mem_free(GWK.mpDispList);
+	nxCore::mem_free(GWK.mpDispListWk);
+	nxCore::mem_free(GWK.mpDispSortKeys);
+
+	if (GWK.mpPolRingVB) {
+		GWK.mpPolRingVB->Release();
+		GWK.mpPolRingVB = nullptr;
+	}
+	GWK.mPolRingSize = 0;
 
 	GWK.mSdwBuf.release();
 	if (GWK.mpSMRrsrcView) {
@@ -1281,21 +1300,32 @@ void gexBeginScene(GEX_CAM* pCam) {
 	GWK.mObjCullCnt = 0;
 	GWK.mBatCullCnt = 0;
 	GWK.mPolCullCnt = 0;
+	GWK.mPolDrawCnt = 0;
 	GWK.mShadowCastCnt = 0;
 	GWK.mShadowRecvCnt = 0;
 }
 
-static int dlcmp(const void* pA, const void* pB) {
-	GEX_DISP_ENTRY* pDisp1 = (GEX_DISP_ENTRY*)pA;
-	GEX_DISP_ENTRY* pDisp2 = (GEX_DISP_ENTRY*)pB;
-	uint32_t k1 = pDisp1->mSortKey;
-	uint32_t k2 = pDisp2->mSortKey;
-	if (k1 > k2) return 1;
-	if (k1 < k2) return -1;
-	return 0;
+/* ascending mSortKey, entries with equal keys stay in submission order */
+static void gexSortDispList(int n) {
+	GEX_DISP_ENTRY* pSrc = GWK.mpDispList;
+	GEX_DISP_ENTRY* pDst = GWK.mpDispListWk;
+	sSortKey* pKeys = GWK.mpDispSortKeys;
+	if (!pDst || !pKeys) return;
+	for (int i = 0; i < n; ++i) {
+		pKeys[i].mKey = pSrc[i].mSortKey;
+		pKeys[i].mIdx = i;
+	}
+	key_sort(pKeys, pKeys + n, n);
+	for (int i = 0; i < n; ++i) {
+		pDst[i] = pSrc[pKeys[i].mIdx];
+	}
+	GWK.mpDispList = pDst;
+	GWK.mpDispListWk = pSrc;
 }
 
 static void gexBgDraw();
+static void gexPolRingUpload(int n);
+static int gexPolRun(int i, int n);
 
 void gexEndScene() {
 	// NOTE: if checking for no receivers here, then the same check must be done in gexBatDLFuncCast;
@@ -1312,15 +1342,18 @@ void gexEndScene() {
 	int n = GWK.mDispListPtr;
 	if (GWK.mpDispList && n) {
 		if (n > 1) {
-			::qsort(GWK.mpDispList, n, sizeof(GEX_DISP_ENTRY), dlcmp);
+			gexSortDispList(n);
 		}
 	}
+	gexPolRingUpload(n);
 	gexBgDraw();
-	for (int i = 0; i < n; ++i) {
+	for (int i = 0; i < n;) {
 		GEX_DISP_ENTRY* pEnt = &GWK.mpDispList[i];
+		int nrun = gexPolRun(i, n);
 		if (pEnt->mpFunc) {
 			pEnt->mpFunc(*pEnt);
 		}
+		i += nrun;
 	}
 	GWK.mpScnCam = nullptr;
 
@@ -2006,55 +2039,11 @@ struct GEX_MTL {
 		return pos;
 	}
 
-	cxVec calc_sort_pos(const GEX_CAM& cam, const cxVec vtx[3]) const {
-		cxVec pos;
-		float dist[3];
-		switch (mSortMode) {
-			case GEX_SORT_MODE::NEAR_POS:
-			default:
-				for (int i = 0; i < 3; ++i) {
-					dist[i] = gexCalcViewDist(&cam, vtx[0]);
-				}
-				if (dist[0] < dist[1] && dist[0] < dist[2]) {
-					pos = dist[0];
-				} else if (dist[1] < dist[0] && dist[1] < dist[2]) {
-					pos = dist[1];
-				} else {
-					pos = dist[2];
-				}
-				break;
-			case GEX_SORT_MODE::CENTER:
-				pos = vtx[0];
-				pos.add(vtx[1]);
-				pos.add(vtx[2]);
-				pos.scl(1.0f / 3.0f);
-				break;
-			case GEX_SORT_MODE::FAR_POS:
-				for (int i = 0; i < 3; ++i) {
-					dist[i] = gexCalcViewDist(&cam, vtx[0]);
-				}
-				if (dist[0] > dist[1] && dist[0] > dist[2]) {
-					pos = dist[0];
-				} else if (dist[1] > dist[0] && dist[1] > dist[2]) {
-					pos = dist[1];
-				} else{
-					pos = dist[2];
-				}
-				break;
-		}
-		return pos;
-	}
-
 	float calc_sort_bias(cxAABB& bbox) const {
 		return bbox.get_bounding_radius()*mSortBiasRel + mSortBiasAbs;
 	}
 };
 
-struct GEX_SORT_PRIM {
-	float key;
-	int idx;
-};
-
 struct GEX_BAT {
 	const char* mpName;
 	GEX_OBJ* mpObj;
@@ -2066,7 +2055,7 @@ struct GEX_BAT {
 	ID3D11Buffer* mpDynIB32;
 	uint16_t* mpIdx16;
 	uint32_t* mpIdx32;
-	GEX_SORT_PRIM* mpSortWk;
+	cPrimSorter mPrimSorter;
 	int mMtlId;
 	int mMaxWghtNum;
 	int mMinIdx;
@@ -2120,10 +2109,7 @@ struct GEX_BAT {
 			nxCore::mem_free(mpIdx32);
 			mpIdx32 = nullptr;
 		}
-		if (mpSortWk) {
-			nxCore::mem_free(mpSortWk);
-			mpSortWk = nullptr;
-		}
+		mPrimSorter.reset();
 		if (mpDynIB16) {
 			mpDynIB16->Release();
 			mpDynIB16 = nullptr;
@@ -2199,75 +2185,57 @@ struct GEX_OBJ {
 	}
 };
 
-static int primcmp(const void* pA, const void* pB) {
-	GEX_SORT_PRIM* pPrim1 = (GEX_SORT_PRIM*)pA;
-	GEX_SORT_PRIM* pPrim2 = (GEX_SORT_PRIM*)pB;
-	float k1 = pPrim1->key;
-	float k2 = pPrim2->key;
-	if (k1 > k2) return 1;
-	if (k1 < k2) return -1;
-	return 0;
-}
-
 void GEX_BAT::sort(const GEX_CAM& cam) {
-	if (!mpSortWk) return;
 	if (!(mpIdx16 || mpIdx32)) return;
 	GEX_MTL* pMtl = get_mtl();
 	if (!pMtl) return;
-	int ntri = get_tri_num();
-	for (int i = 0; i < ntri; ++i) {
-		mpSortWk[i].idx = i;
-	}
-	int ipnt[3];
-	cxVec vtx[3];
 	xt_wmtx wm;
+	const xt_wmtx* pMtx = nullptr;
 	if (mSkinNodesNum <= 1) {
 		wm = mpSkinIds ? *((&mpObj->mpXform->mtx) + mpSkinIds[0]) : mpObj->mpXform->mtx;
+		pMtx = &wm;
 	}
-	for (int i = 0; i < ntri; ++i) {
-		if (mpIdx16) {
-			for (int j = 0; j < 3; ++j) {
-				ipnt[j] = mpIdx16[(i * 3) + j];
-			}
-		} else {
-			for (int j = 0; j < 3; ++j) {
-				ipnt[j] = mpIdx32[(i * 3) + j];
-			}
-		}
-		for (int j = 0; j < 3; ++j) {
-			vtx[j] = mpObj->mpGeoPts[ipnt[j] + mMinIdx];
-		}
-		if (mSkinNodesNum <= 1) {
-			for (int j = 0; j < 3; ++j) {
-				vtx[j] = gexWMtxCalcPnt(wm, vtx[j]);
-			}
-		}
-		cxVec spos = pMtl->calc_sort_pos(cam, vtx);
-		mpSortWk[i].key = gexCalcViewDist(&cam, spos);
+	cPrimSorter::eDepth depth = cPrimSorter::eDepth::NEAR_PNT;
+	switch (pMtl->mSortMode) {
+		case GEX_SORT_MODE::NEAR_POS:
+		default:
+			break;
+		case GEX_SORT_MODE::CENTER:
+			depth = cPrimSorter::eDepth::CENTER;
+			break;
+		case GEX_SORT_MODE::FAR_POS:
+			depth = cPrimSorter::eDepth::FAR_PNT;
+			break;
 	}
-
-	::qsort(mpSortWk, ntri, sizeof(GEX_SORT_PRIM), primcmp);
-
+	bool backToFront = !!pMtl->mCtxWk.enableAlpha;
+	cPrimSorter::eResult res = mPrimSorter.sort(mpObj->mpGeoPts + mMinIdx, mpIdx16, mpIdx32, pMtx, cam.mPos, cam.mDir, depth, backToFront);
+	if (res == cPrimSorter::eResult::NONE || res == cPrimSorter::eResult::KEPT) return;
+	const uint32_t* pOrder = mPrimSorter.get_order();
+	int ntri = get_tri_num();
 	D3D11_MAPPED_SUBRESOURCE map;
 	if (mpDynIB16) {
 		HRESULT hres = GWK.mpCtx->Map(mpDynIB16, 0, D3D11_MAP_WRITE_DISCARD, 0, &map);
 		if (SUCCEEDED(hres)) {
 			uint16_t* pDst = (uint16_t*)map.pData;
 			for (int i = 0; i < ntri; ++i) {
-				int itri = mpSortWk[i].idx;
-				::memcpy(pDst + (itri * 3), mpIdx16 + (itri * 3), sizeof(uint16_t) * 3);
+				int itri = pOrder[i];
+				::memcpy(pDst + (i * 3), mpIdx16 + (itri * 3), sizeof(uint16_t) * 3);
 			}
 			GWK.mpCtx->Unmap(mpDynIB16, 0);
+		} else {
+			mPrimSorter.invalidate();
 		}
 	} else if (mpDynIB32) {
 		HRESULT hres = GWK.mpCtx->Map(mpDynIB32, 0, D3D11_MAP_WRITE_DISCARD, 0, &map);
 		if (SUCCEEDED(hres)) {
-			uint16_t* pDst = (uint16_t*)map.pData;
+			uint32_t* pDst = (uint32_t*)map.pData;
 			for (int i = 0; i < ntri; ++i) {
-				int itri = mpSortWk[i].idx;
-				::memcpy(pDst + (itri * 3), mpIdx32 + (itri * 3), sizeof(uint32_t) * 3);
+				int itri = pOrder[i];
+				::memcpy(pDst + (i * 3), mpIdx32 + (itri * 3), sizeof(uint32_t) * 3);
 			}
 			GWK.mpCtx->Unmap(mpDynIB32, 0);
+		} else {
+			mPrimSorter.invalidate();
 		}
 	}
 }
@@ -2640,7 +2608,7 @@ GEX_OBJ* gexObjCreate(const sxGeometryData& geo, const char* pBatGrpPrefix, cons
 			}
 		}
 		if (pBat->get_mtl()->mSortPrims) {
-			pBat->mpSortWk = gexTypeAlloc<GEX_SORT_PRIM>(XD_FOURCC('s', 'o', 'r', 't'), npol);
+			pBat->mPrimSorter.init(npol, pBat->mMaxIdx - pBat->mMinIdx + 1);
 			if (pBat->is_idx16()) {
 				pBat->mpIdx16 = gexTypeAlloc<uint16_t>(XD_FOURCC('i', 'x', '1', '6'), npol * 3);
 			} else {
@@ -3152,11 +3120,13 @@ struct GEX_POL {
 	cxMtx mWorldMtx;
 	StructuredBuffer<OBJ_CTX> mObjCtx;
 	StructuredBuffer<XFORM_CTX> mXformCtx;
-	ID3D11Buffer* mpVB;
-	GEX_VTX* mpMappedVB;
+	GEX_VTX* mpVtx;
 	GEX_MTL* mpMtl;
 	int mVtxAllocNum;
 	int mVtxUseNum;
+	int mRingOrg;
+	uint32_t mRingStamp;
+	bool mEditFlg;
 	GEX_POL_TYPE mType;
 	uint32_t mNameHash;
 	char mNameBuf[32];
@@ -3188,14 +3158,8 @@ GEX_POL* gexPolCreate(int maxVtxNum, const char* pName) {
 			pPol->mpMtl->update();
 		}
 
-		D3D11_BUFFER_DESC dsc;
-		::ZeroMemory(&dsc, sizeof(dsc));
-		dsc.ByteWidth = maxVtxNum * sizeof(GEX_VTX);
-		dsc.Usage = D3D11_USAGE_DYNAMIC;
-		dsc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-		dsc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-		HRESULT hres = GWK.mpDev->CreateBuffer(&dsc, nullptr, &pPol->mpVB);
-		if (SUCCEEDED(hres)) {
+		pPol->mpVtx = gexTypeAlloc<GEX_VTX>(D_GEX_POL_TAG, maxVtxNum, false);
+		if (pPol->mpVtx) {
 			pPol->mVtxAllocNum = maxVtxNum;
 		}
 
@@ -3231,9 +3195,7 @@ void gexPolDestroy(GEX_POL* pPol) {
 	}
 	pPol->mXformCtx.release();
 	pPol->mObjCtx.release();
-	if (pPol->mpVB) {
-		pPol->mpVB->Release();
-	}
+	nxCore::mem_free(pPol->mpVtx);
 	gexLstUnlink(pPol, &GWK.mpPolLstHead, &GWK.mpPolLstTail);
 	--GWK.mPolCount;
 	nxCore::mem_free(pPol);
@@ -3241,28 +3203,20 @@ void gexPolDestroy(GEX_POL* pPol) {
 
 void gexPolEditBegin(GEX_POL* pPol) {
 	if (!pPol) return;
-	pPol->mpMappedVB = nullptr;
 	pPol->mVtxUseNum = 0;
-	if (pPol->mpVB) {
-		D3D11_MAPPED_SUBRESOURCE map;
-		HRESULT hres = GWK.mpCtx->Map(pPol->mpVB, 0, D3D11_MAP_WRITE_DISCARD, 0, &map);
-		if (SUCCEEDED(hres)) {
-			pPol->mpMappedVB = (GEX_VTX*)map.pData;
-		}
-	}
+	pPol->mEditFlg = !!pPol->mpVtx;
 }
 
 void gexPolEditEnd(GEX_POL* pPol) {
 	if (!pPol) return;
-	if (!pPol->mpMappedVB) return;
-	GWK.mpCtx->Unmap(pPol->mpVB, 0);
-	pPol->mpMappedVB = nullptr;
+	if (!pPol->mEditFlg) return;
+	pPol->mEditFlg = false;
 	pPol->mWorldBBox = pPol->mGeoBBox;
 }
 
 void gexPolAddVertex(GEX_POL* pPol, const cxVec& pos, const cxVec& nrm, const cxVec& tng, const cxColor& clr, const xt_texcoord& uv, const xt_texcoord& uv2) {
 	if (!pPol) return;
-	if (!pPol->mpMappedVB) return;
+	if (!pPol->mEditFlg) return;
 	if (pPol->mVtxUseNum < pPol->mVtxAllocNum) {
 		GEX_VTX v;
 		if (0 == pPol->mVtxUseNum) {
@@ -3275,7 +3229,7 @@ void gexPolAddVertex(GEX_POL* pPol, const cxVec& pos, const cxVec& nrm, const cx
 		v.set_nrm_tng(nrm, tng);
 		v.set_clr(clr);
 		v.set_tex(uv, uv2);
-		GEX_VTX* pDst = &pPol->mpMappedVB[pPol->mVtxUseNum];
+		GEX_VTX* pDst = &pPol->mpVtx[pPol->mVtxUseNum];
 		::memcpy(pDst, &v, sizeof(GEX_VTX));
 		++pPol->mVtxUseNum;
 	}
@@ -3309,6 +3263,127 @@ D3D11_PRIMITIVE_TOPOLOGY gexPolTopology(const GEX_POL* pPol) {
 	return topo;
 }
 
+void gexPolDLFuncCast(GEX_DISP_ENTRY& ent);
+void gexPolDLFuncOpaq(GEX_DISP_ENTRY& ent);
+void gexPolDLFuncSemi(GEX_DISP_ENTRY& ent);
+
+static bool gexPolSameState(const GEX_POL* pPolA, const GEX_POL* pPolB) {
+	if (pPolA->mType != pPolB->mType) return false;
+	if (pPolA->mType != GEX_POL_TYPE::TRILIST && pPolA->mType != GEX_POL_TYPE::SEGLIST) return false;
+	if (::memcmp(&pPolA->mWorldMtx, &pPolB->mWorldMtx, sizeof(cxMtx)) != 0) return false;
+	const GEX_MTL* pMtlA = pPolA->mpMtl;
+	const GEX_MTL* pMtlB = pPolB->mpMtl;
+	if (!pMtlA || !pMtlB) return false;
+	if (pMtlA->mpBaseTex != pMtlB->mpBaseTex || pMtlA->mpSpecTex != pMtlB->mpSpecTex) return false;
+	if (pMtlA->mpBumpTex != pMtlB->mpBumpTex || pMtlA->mpReflTex != pMtlB->mpReflTex) return false;
+	if (pMtlA->mDblSided != pMtlB->mDblSided || pMtlA->mUVMode != pMtlB->mUVMode || pMtlA->mTessMode != pMtlB->mTessMode) return false;
+	if (pMtlA->mAlphaToCoverage != pMtlB->mAlphaToCoverage || pMtlA->mBlend != pMtlB->mBlend) return false;
+	return ::memcmp(&pMtlA->mCtxWk, &pMtlB->mCtxWk, sizeof(MTL_CTX)) == 0;
+}
+
+static bool gexPolEntry(const GEX_DISP_ENTRY& ent) {
+	return ent.mpFunc == gexPolDLFuncCast || ent.mpFunc == gexPolDLFuncOpaq || ent.mpFunc == gexPolDLFuncSemi;
+}
+
+static bool gexPolRingReserve(int nvtx) {
+	if (GWK.mpPolRingVB && nvtx <= GWK.mPolRingSize) return true;
+	int size = nxCalc::max(GWK.mPolRingSize, 1024);
+	while (size < nvtx) {
+		size <<= 1;
+	}
+	if (GWK.mpPolRingVB) {
+		GWK.mpPolRingVB->Release();
+		GWK.mpPolRingVB = nullptr;
+	}
+	GWK.mPolRingSize = 0;
+	D3D11_BUFFER_DESC dsc;
+	::ZeroMemory(&dsc, sizeof(dsc));
+	dsc.ByteWidth = size * sizeof(GEX_VTX);
+	dsc.Usage = D3D11_USAGE_DYNAMIC;
+	dsc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	dsc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	HRESULT hres = GWK.mpDev->CreateBuffer(&dsc, nullptr, &GWK.mpPolRingVB);
+	if (FAILED(hres)) {
+		GWK.mpPolRingVB = nullptr;
+		return false;
+	}
+	GWK.mPolRingSize = size;
+	return true;
+}
+
+/* Copies the vertices of every polygon in the display list into the shared ring buffer with a single map.
+   Main pass entries are placed first and in drawing order, so that polygons drawn one after another
+   are also adjacent in the buffer and can be merged by gexPolRun. */
+static void gexPolRingUpload(int n) {
+	uint32_t stamp = ++GWK.mPolRingStamp;
+	GEX_DISP_ENTRY* pList = GWK.mpDispList;
+	int nvtx = 0;
+	for (int pass = 0; pass < 2; ++pass) {
+		for (int i = 0; i < n; ++i) {
+			if (!gexPolEntry(pList[i])) continue;
+			if ((pList[i].mpFunc == gexPolDLFuncCast) != (pass == 1)) continue;
+			GEX_POL* pPol = (GEX_POL*)pList[i].mpData;
+			if (!pPol || pPol->mRingStamp == stamp || pPol->mVtxUseNum <= 0) continue;
+			pPol->mRingStamp = stamp;
+			pPol->mRingOrg = nvtx;
+			nvtx += pPol->mVtxUseNum;
+		}
+	}
+	if (nvtx <= 0) return;
+	D3D11_MAPPED_SUBRESOURCE map;
+	map.pData = nullptr;
+	if (gexPolRingReserve(nvtx)) {
+		if (FAILED(GWK.mpCtx->Map(GWK.mpPolRingVB, 0, D3D11_MAP_WRITE_DISCARD, 0, &map))) {
+			map.pData = nullptr;
+		}
+	}
+	if (!map.pData) {
+		++GWK.mPolRingStamp; /* nothing is drawn */
+		return;
+	}
+	GEX_VTX* pDst = (GEX_VTX*)map.pData;
+	int ptr = 0;
+	for (int pass = 0; pass < 2; ++pass) {
+		for (int i = 0; i < n; ++i) {
+			if (!gexPolEntry(pList[i])) continue;
+			if ((pList[i].mpFunc == gexPolDLFuncCast) != (pass == 1)) continue;
+			GEX_POL* pPol = (GEX_POL*)pList[i].mpData;
+			if (!pPol || pPol->mRingStamp != stamp || pPol->mRingOrg != ptr) continue;
+			::memcpy(&pDst[ptr], pPol->mpVtx, pPol->mVtxUseNum * sizeof(GEX_VTX));
+			ptr += pPol->mVtxUseNum;
+		}
+	}
+	GWK.mpCtx->Unmap(GWK.mpPolRingVB, 0);
+}
+
+/* Returns the number of display list entries starting at i that are drawn with one call:
+   list-type polygons with the same state whose vertices follow each other in the ring buffer. */
+static int gexPolRun(int i, int n) {
+	GWK.mPolRunVtxNum = 0;
+	const GEX_DISP_ENTRY& ent = GWK.mpDispList[i];
+	if (!gexPolEntry(ent)) return 1;
+	const GEX_POL* pPol = (const GEX_POL*)ent.mpData;
+	if (!pPol || pPol->mRingStamp != GWK.mPolRingStamp) return 1;
+	int nvtx = pPol->mVtxUseNum;
+	int nrun = 1;
+	while (i + nrun < n) {
+		const GEX_DISP_ENTRY& next = GWK.mpDispList[i + nrun];
+		if (next.mpFunc != ent.mpFunc || next.mpLit != ent.mpLit) break;
+		const GEX_POL* pNext = (const GEX_POL*)next.mpData;
+		if (!pNext || pNext->mRingStamp != GWK.mPolRingStamp || pNext->mRingOrg != pPol->mRingOrg + nvtx) break;
+		if (!gexPolSameState(pPol, pNext)) break;
+		nvtx += pNext->mVtxUseNum;
+		++nrun;
+	}
+	GWK.mPolRunVtxNum = nvtx;
+	return nrun;
+}
+
+static int gexPolDrawVtxNum(const GEX_POL* pPol) {
+	if (!GWK.mpPolRingVB || pPol->mRingStamp != GWK.mPolRingStamp) return 0;
+	return GWK.mPolRunVtxNum;
+}
+
 void gexPolDLFuncCast(GEX_DISP_ENTRY& ent) {
 	ID3D11DeviceContext* pCtx = GWK.mpCtx;
 	if (!pCtx) return;
@@ -3317,7 +3392,7 @@ void gexPolDLFuncCast(GEX_DISP_ENTRY& ent) {
 	GEX_MTL* pMtl = gexPolMaterial(pPol);
 	if (!pMtl) return;
 
-	int nvtx = pPol->mVtxUseNum;
+	int nvtx = gexPolDrawVtxNum(pPol);
 	if (nvtx <= 0) return;
 
 	pCtx->OMSetBlendState(GWK.mpBlendOpaq, nullptr, 0xFFFFFFFF);
@@ -3350,10 +3425,11 @@ void gexPolDLFuncCast(GEX_DISP_ENTRY& ent) {
 	pCtx->IASetInputLayout(GWK.mpObjVtxLayout);
 	UINT stride = sizeof(GEX_VTX);
 	UINT offs = 0;
-	pCtx->IASetVertexBuffers(0, 1, &pPol->mpVB, &stride, &offs);
+	pCtx->IASetVertexBuffers(0, 1, &GWK.mpPolRingVB, &stride, &offs);
 	pCtx->IASetIndexBuffer(nullptr, DXGI_FORMAT_R32_UINT, 0);
 	pCtx->IASetPrimitiveTopology(gexPolTopology(pPol));
-	pCtx->Draw(nvtx, 0);
+	pCtx->Draw(nvtx, pPol->mRingOrg);
+	++GWK.mPolDrawCnt;
 }
 
 void gexPolDraw(GEX_POL* pPol, GEX_LIT* pLit) {
@@ -3366,7 +3442,7 @@ void gexPolDraw(GEX_POL* pPol, GEX_LIT* pLit) {
 	if (!pMtl) return;
 	if (!pLit) pLit = GWK.mpDefLit;
 
-	int nvtx = pPol->mVtxUseNum;
+	int nvtx = gexPolDrawVtxNum(pPol);
 	if (nvtx <= 0) return;
 
 	if (pMtl->mDblSided) {
@@ -3429,14 +3505,15 @@ void gexPolDraw(GEX_POL* pPol, GEX_LIT* pLit) {
 	pCtx->IASetInputLayout(GWK.mpObjVtxLayout);
 	UINT stride = sizeof(GEX_VTX);
 	UINT offs = 0;
-	pCtx->IASetVertexBuffers(0, 1, &pPol->mpVB, &stride, &offs);
+	pCtx->IASetVertexBuffers(0, 1, &GWK.mpPolRingVB, &stride, &offs);
 	pCtx->IASetIndexBuffer(nullptr, DXGI_FORMAT_R32_UINT, 0);
 	if (tessFlg) {
 		pCtx->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_3_CONTROL_POINT_PATCHLIST);
 	} else {
 		pCtx->IASetPrimitiveTopology(gexPolTopology(pPol));
 	}
-	pCtx->Draw(nvtx, 0);
+	pCtx->Draw(nvtx, pPol->mRingOrg);
+	++GWK.mPolDrawCnt;
 }
 
 void gexPolDLFuncOpaq(GEX_DISP_ENTRY& ent) {
@@ -3454,7 +3531,7 @@ void gexPolDLFuncSemi(GEX_DISP_ENTRY& ent) {
 
 void gexPolDisp(GEX_POL* pPol, GEX_POL_TYPE type, GEX_LIT* pLit) {
 	if (!pPol) return;
-	if (!pPol->mpVB) return;
+	if (!pPol->mpVtx) return;
 	if (!pLit) pLit = GWK.mpDefLit;
 	GEX_CAM* pCam = GWK.mpScnCam;
 	if (!pCam) return;
@@ -0,0 +1,255 @@
+#include "crossdata.hpp"
+#include "task.hpp"
+#include "timer.hpp"
+#include "key_sort.hpp"
+
+#define KEY_SORT_PASSES_NUM (32 / KEY_SORT_RADIX_BITS)
+#define KEY_SORT_RADIX_MASK (KEY_SORT_RADIX_SIZE - 1)
+#define KEY_SORT_JOBS_PER_WRK 2
+#define KEY_SORT_MIN_JOB_ITEMS 16384
+
+static inline uint32_t key_sort_digit(const sSortKey& key, uint32_t shift) {
+	return (key.mKey >> shift) & KEY_SORT_RADIX_MASK;
+}
+
+void key_sort(sSortKey* pKeys, sSortKey* pWk, int n) {
+	if (!pKeys || !pWk || n < 2) return;
+	uint32_t hist[KEY_SORT_PASSES_NUM][KEY_SORT_RADIX_SIZE];
+	::memset(hist, 0, sizeof(hist));
+	for (int i = 0; i < n; ++i) {
+		uint32_t key = pKeys[i].mKey;
+		for (int j = 0; j < KEY_SORT_PASSES_NUM; ++j) {
+			++hist[j][(key >> (j * KEY_SORT_RADIX_BITS)) & KEY_SORT_RADIX_MASK];
+		}
+	}
+	sSortKey* pSrc = pKeys;
+	sSortKey* pDst = pWk;
+	for (int j = 0; j < KEY_SORT_PASSES_NUM; ++j) {
+		uint32_t shift = j * KEY_SORT_RADIX_BITS;
+		uint32_t* pOffs = hist[j];
+		if (pOffs[key_sort_digit(pSrc[0], shift)] == (uint32_t)n) continue;
+		uint32_t sum = 0;
+		for (int b = 0; b < KEY_SORT_RADIX_SIZE; ++b) {
+			uint32_t cnt = pOffs[b];
+			pOffs[b] = sum;
+			sum += cnt;
+		}
+		for (int i = 0; i < n; ++i) {
+			pDst[pOffs[key_sort_digit(pSrc[i], shift)]++] = pSrc[i];
+		}
+		sSortKey* pTmp = pSrc;
+		pSrc = pDst;
+		pDst = pTmp;
+	}
+	if (pSrc != pKeys) {
+		::memcpy(pKeys, pSrc, n * sizeof(sSortKey));
+	}
+}
+
+
+void cKeySorter::init(int maxItems, int maxWorkers) {
+	reset();
+	if (maxItems <= 0) return;
+	mWrkNum = nxCalc::max(maxWorkers, 1);
+	mItemsMax = maxItems;
+	mJobsMax = mWrkNum * KEY_SORT_JOBS_PER_WRK;
+	mpWk = (sSortKey*)nxCore::mem_alloc(maxItems * sizeof(sSortKey), XD_FOURCC('K', 's', 'W', 'k'));
+	mpHist = (uint32_t*)nxCore::mem_alloc(mJobsMax * KEY_SORT_RADIX_SIZE * sizeof(uint32_t), XD_FOURCC('K', 's', 'H', 's'));
+	if (!mpWk || !mpHist) {
+		reset();
+		return;
+	}
+	if (mWrkNum > 1) {
+		mpQueue = tskQueueCreate(mJobsMax);
+		mpJobs = tskJobsAlloc(mJobsMax);
+		if (mpQueue && mpJobs) {
+			for (int i = 0; i < mJobsMax; ++i) {
+				mpJobs[i].mFunc = task_job;
+				mpJobs[i].mpData = this;
+			}
+		} else {
+			tskQueueDestroy(mpQueue);
+			mpQueue = nullptr;
+			tskJobsFree(mpJobs);
+			mpJobs = nullptr;
+		}
+	}
+}
+
+void cKeySorter::reset() {
+	nxCore::mem_free(mpWk);
+	mpWk = nullptr;
+	nxCore::mem_free(mpHist);
+	mpHist = nullptr;
+	tskQueueDestroy(mpQueue);
+	mpQueue = nullptr;
+	tskJobsFree(mpJobs);
+	mpJobs = nullptr;
+	mpSrc = nullptr;
+	mpDst = nullptr;
+	mItemsNum = 0;
+	mJobsNum = 0;
+	mItemsMax = 0;
+	mJobsMax = 0;
+	mWrkNum = 0;
+}
+
+void cKeySorter::exec_range(int org, int num, int jobId) {
+	uint32_t* pHist = &mpHist[jobId * KEY_SORT_RADIX_SIZE];
+	const sSortKey* pSrc = &mpSrc[org];
+	uint32_t shift = mShift;
+	switch (mPhase) {
+		case ePhase::COUNT:
+			::memset(pHist, 0, KEY_SORT_RADIX_SIZE * sizeof(uint32_t));
+			for (int i = 0; i < num; ++i) {
+				++pHist[key_sort_digit(pSrc[i], shift)];
+			}
+			break;
+		case ePhase::SCATTER:
+			for (int i = 0; i < num; ++i) {
+				mpDst[pHist[key_sort_digit(pSrc[i], shift)]++] = pSrc[i];
+			}
+			break;
+	}
+}
+
+/*static*/ void cKeySorter::task_job(TSK_CONTEXT* pCtx) {
+	TSK_JOB* pJob = pCtx->mpJob;
+	cKeySorter* pSelf = (cKeySorter*)pJob->mpData;
+	int id = pJob->mId;
+	int org = int((int64_t)pSelf->mItemsNum * id / pSelf->mJobsNum);
+	int end = int((int64_t)pSelf->mItemsNum * (id + 1) / pSelf->mJobsNum);
+	pSelf->exec_range(org, end - org, id);
+}
+
+void cKeySorter::exec_phase(ePhase phase, TSK_BRIGADE* pBgd) {
+	mPhase = phase;
+	tskQueuePurge(mpQueue);
+	for (int i = 0; i < mJobsNum; ++i) {
+		tskQueueAdd(mpQueue, &mpJobs[i]);
+	}
+	tskBrigadeSetActiveWorkers(pBgd, nxCalc::min(tskBrigadeGetNumWorkers(pBgd), mWrkNum));
+	tskQueueExec(mpQueue, pBgd);
+	tskBrigadeResetActiveWorkers(pBgd);
+}
+
+void cKeySorter::sort(sSortKey* pKeys, int n, TSK_BRIGADE* pBgd) {
+	if (!pKeys || n < 2 || !mpWk || n > mItemsMax) return;
+	bool tskFlg = pBgd && mpQueue && mpJobs && n >= KEY_SORT_MIN_JOB_ITEMS * 2;
+	if (!tskFlg) {
+		key_sort(pKeys, mpWk, n);
+		return;
+	}
+	mItemsNum = n;
+	mJobsNum = nxCalc::min(mJobsMax, n / KEY_SORT_MIN_JOB_ITEMS);
+	sSortKey* pSrc = pKeys;
+	sSortKey* pDst = mpWk;
+	for (int j = 0; j < KEY_SORT_PASSES_NUM; ++j) {
+		mpSrc = pSrc;
+		mpDst = pDst;
+		mShift = j * KEY_SORT_RADIX_BITS;
+		exec_phase(ePhase::COUNT, pBgd);
+		uint32_t d0 = key_sort_digit(pSrc[0], mShift);
+		uint32_t cnt0 = 0;
+		for (int i = 0; i < mJobsNum; ++i) {
+			cnt0 += mpHist[i * KEY_SORT_RADIX_SIZE + d0];
+		}
+		if (cnt0 == (uint32_t)n) continue;
+		/* bucket-major, job-minor offsets keep equal digits in input order across jobs */
+		uint32_t sum = 0;
+		for (int b = 0; b < KEY_SORT_RADIX_SIZE; ++b) {
+			for (int i = 0; i < mJobsNum; ++i) {
+				uint32_t* pCnt = &mpHist[i * KEY_SORT_RADIX_SIZE + b];
+				uint32_t cnt = *pCnt;
+				*pCnt = sum;
+				sum += cnt;
+			}
+		}
+		exec_phase(ePhase::SCATTER, pBgd);
+		sSortKey* pTmp = pSrc;
+		pSrc = pDst;
+		pDst = pTmp;
+	}
+	if (pSrc != pKeys) {
+		::memcpy(pKeys, pSrc, n * sizeof(sSortKey));
+	}
+	mpSrc = nullptr;
+	mpDst = nullptr;
+}
+
+
+static int key_sort_bench_cmp(const void* pA, const void* pB) {
+	const sSortKey* pKey1 = (const sSortKey*)pA;
+	const sSortKey* pKey2 = (const sSortKey*)pB;
+	if (pKey1->mKey > pKey2->mKey) return 1;
+	if (pKey1->mKey < pKey2->mKey) return -1;
+	/* index tie-break makes the qsort reference stable */
+	if (pKey1->mIdx > pKey2->mIdx) return 1;
+	if (pKey1->mIdx < pKey2->mIdx) return -1;
+	return 0;
+}
+
+static void key_sort_bench_fill(sSortKey* pKeys, int n, uint32_t seed) {
+	uint32_t s = seed;
+	for (int i = 0; i < n; ++i) {
+		s = s * 1664525 + 1013904223;
+		/* layer in the top byte, quantized depth below, many duplicates like a real frame */
+		uint32_t layer = (s >> 29) % 5;
+		uint32_t zkey = (s >> 4) & 0xFFF;
+		pKeys[i].mKey = (layer << 24) | (zkey << 4);
+		pKeys[i].mIdx = i;
+	}
+}
+
+void key_sort_bench(TSK_BRIGADE* pBgd, FILE* pOut) {
+	if (!pOut) {
+		pOut = stdout;
+	}
+	static const int s_sizes[] = { 1000, 10000, 100000, 1000000 };
+	const int nsizes = int(XD_ARY_LEN(s_sizes));
+	const int nmax = s_sizes[nsizes - 1];
+	const int nrep = 5;
+	sSortKey* pSrc = (sSortKey*)nxCore::mem_alloc(nmax * sizeof(sSortKey), XD_TMP_MEM_TAG);
+	sSortKey* pRef = (sSortKey*)nxCore::mem_alloc(nmax * sizeof(sSortKey), XD_TMP_MEM_TAG);
+	sSortKey* pTst = (sSortKey*)nxCore::mem_alloc(nmax * sizeof(sSortKey) * 2, XD_TMP_MEM_TAG);
+	int nwrk = pBgd ? tskBrigadeGetNumWorkers(pBgd) : 1;
+	cKeySorter sorter;
+	sorter.init(nmax, nwrk);
+	if (pSrc && pRef && pTst) {
+		::fprintf(pOut, "key sort, %d workers (min of %d runs, ms):\n", nwrk, nrep);
+		for (int i = 0; i < nsizes; ++i) {
+			int n = s_sizes[i];
+			key_sort_bench_fill(pSrc, n, 1 + i);
+			double tq = 0.0;
+			double ts = 0.0;
+			double tp = 0.0;
+			int nbad = 0;
+			for (int j = 0; j < nrep; ++j) {
+				::memcpy(pRef, pSrc, n * sizeof(sSortKey));
+				double t0 = time_micros();
+				::qsort(pRef, n, sizeof(sSortKey), key_sort_bench_cmp);
+				double t = time_micros() - t0;
+				tq = j ? nxCalc::min(tq, t) : t;
+
+				::memcpy(pTst, pSrc, n * sizeof(sSortKey));
+				t0 = time_micros();
+				key_sort(pTst, pTst + n, n);
+				t = time_micros() - t0;
+				ts = j ? nxCalc::min(ts, t) : t;
+				nbad += ::memcmp(pTst, pRef, n * sizeof(sSortKey)) != 0;
+
+				::memcpy(pTst, pSrc, n * sizeof(sSortKey));
+				t0 = time_micros();
+				sorter.sort(pTst, n, pBgd);
+				t = time_micros() - t0;
+				tp = j ? nxCalc::min(tp, t) : t;
+				nbad += ::memcmp(pTst, pRef, n * sizeof(sSortKey)) != 0;
+			}
+			::fprintf(pOut, " %8d: qsort %8.3f, radix %8.3f, parallel %8.3f%s\n", n, tq / 1000.0, ts / 1000.0, tp / 1000.0, nbad ? " MISMATCH" : "");
+		}
+	}
+	sorter.reset();
+	nxCore::mem_free(pSrc);
+	nxCore::mem_free(pRef);
+	nxCore::mem_free(pTst);
+}
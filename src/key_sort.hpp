@@ -0,0 +1,62 @@
+struct TSK_BRIGADE;
+struct TSK_QUEUE;
+struct TSK_JOB;
+struct TSK_CONTEXT;
+
+#define KEY_SORT_RADIX_BITS 8
+#define KEY_SORT_RADIX_SIZE (1 << KEY_SORT_RADIX_BITS)
+
+struct sSortKey {
+	uint32_t mKey;
+	uint32_t mIdx;
+};
+
+/* Stable LSD radix sort by mKey (ascending, equal keys keep their input order).
+   pWk must have room for n entries, the sorted keys are always returned in pKeys.
+   Digits that are the same for every key are skipped. */
+void key_sort(sSortKey* pKeys, sSortKey* pWk, int n);
+
+/* Parallel version of key_sort with the same output for any number of workers:
+   every pass counts digits per fixed job range, then each job scatters its range to precomputed offsets. */
+class cKeySorter {
+protected:
+	enum class ePhase {
+		COUNT,
+		SCATTER
+	};
+
+	sSortKey* mpWk;
+	uint32_t* mpHist; /* KEY_SORT_RADIX_SIZE per job */
+	TSK_JOB* mpJobs;
+	TSK_QUEUE* mpQueue;
+	const sSortKey* mpSrc;
+	sSortKey* mpDst;
+	ePhase mPhase;
+	uint32_t mShift;
+	int mItemsNum;
+	int mJobsNum;
+	int mItemsMax;
+	int mJobsMax;
+	int mWrkNum;
+
+	void exec_range(int org, int num, int jobId);
+	void exec_phase(ePhase phase, TSK_BRIGADE* pBgd);
+
+	static void task_job(TSK_CONTEXT* pCtx);
+
+public:
+	cKeySorter()
+	: mpWk(nullptr), mpHist(nullptr), mpJobs(nullptr), mpQueue(nullptr), mpSrc(nullptr), mpDst(nullptr),
+	mPhase(ePhase::COUNT), mShift(0), mItemsNum(0), mJobsNum(0), mItemsMax(0), mJobsMax(0), mWrkNum(0) {}
+
+	~cKeySorter() { reset(); }
+
+	void init(int maxItems, int maxWorkers = 1);
+	void reset();
+
+	/* runs serially without a brigade or for short lists, n must not exceed init() limit */
+	void sort(sSortKey* pKeys, int n, TSK_BRIGADE* pBgd = nullptr);
+};
+
+/* times qsort, key_sort and cKeySorter on display-list-like keys (1k..1M entries) and checks the order against a stable reference */
+void key_sort_bench(TSK_BRIGADE* pBgd = nullptr, FILE* pOut = nullptr);
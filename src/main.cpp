@@ -11,6 +11,13 @@
 
 #include "util.hpp"
 #include "task.hpp"
+#include "key_sort.hpp"
+#include "prim_sort.hpp"
+#include "obstacle.hpp"
+#include "geo_calc.hpp"
+#include "geo_bvh.hpp"
+#include "anim_lod.hpp"
+#include "anim_crowd.hpp"
 #include "test.hpp"
 
 #define TEST_IFC(_tname) static TEST_IFC ifc_##_tname = {_tname##_init, _tname##_loop, _tname##_end }
@@ -67,12 +74,24 @@ struct sProgArgs {
 	int mTestMode;
 	int mMSAA; // 0:Off, 1:Normal, 2:High
 	int mMaxWrk; // %NUMBER_OF_PROCESSORS%
+	char* mpGeoStats; // geostats=all or geostats=<path>[,<path>...]: print display list cache stats and exit
+	char* mpPktBench; // pktbench=all or pktbench=<path>[,<path>...]: check single/streamed ray hits against plain BVH queries, time them and exit
+	char* mpBvhBench; // bvhbench=all or bvhbench=<path>[,<path>...]: check BVH and FlatBVH queries against brute force ones, time them and exit
+	char* mpGndBench; // gndbench=all or gndbench=<path>[,<path>...]: check batched/cached ground queries against single ones, time them and exit
+	char* mpCalcBench; // calcbench=all or calcbench=<path>[,<path>...]: check parallel tangents/bounds against the serial ones, time them and exit
+	bool mSortBench; // sortbench=1: time display list key sorting and exit
+	bool mPrimSortBench; // primsortbench=1: check transparent triangle sorting against a stable reference, time it and exit
+	bool mGridBench; // gridbench=1: check obstacle grid pairs against all pairs, time the builds and exit
+	bool mBuildBench; // buildbench=1: time BVH builds on 10k..1M triangles, check queries against brute force and exit
+	bool mAnimLODTest; // animlodtest=1: check anim LOD poses of the sample motions against full evaluation and exit
+	bool mCrowdBench; // crowdbench=1: check crowd poses of the sample motions against single evaluation, time 10k instances and exit
 
 	sProgArgs()
-	: mTestNo(0), mTestMode(0), mMSAA(1), mMaxWrk(0) {
+	: mTestNo(0), mTestMode(0), mMSAA(1), mMaxWrk(0), mpGeoStats(nullptr), mpPktBench(nullptr), mpBvhBench(nullptr), mpGndBench(nullptr), mpCalcBench(nullptr), mSortBench(false), mPrimSortBench(false), mGridBench(false), mBuildBench(false), mAnimLODTest(false), mCrowdBench(false) {
 	}
 
 	void parse(const char* pCmd);
+	void reset();
 };
 
 void sProgArgs::parse(const char* pCmd) {
@@ -100,11 +119,51 @@ void sProgArgs::parse(const char* pCmd) {
 			mMSAA = ::atoi(val);
 		} else if (nxCore::str_eq(name, "maxwrk")) {
 			mMaxWrk = ::atoi(val);
+		} else if (nxCore::str_eq(name, "geostats")) {
+			nxCore::mem_free(mpGeoStats);
+			mpGeoStats = nxCore::str_dup(val);
+		} else if (nxCore::str_eq(name, "pktbench")) {
+			nxCore::mem_free(mpPktBench);
+			mpPktBench = nxCore::str_dup(val);
+		} else if (nxCore::str_eq(name, "bvhbench")) {
+			nxCore::mem_free(mpBvhBench);
+			mpBvhBench = nxCore::str_dup(val);
+		} else if (nxCore::str_eq(name, "gndbench")) {
+			nxCore::mem_free(mpGndBench);
+			mpGndBench = nxCore::str_dup(val);
+		} else if (nxCore::str_eq(name, "calcbench")) {
+			nxCore::mem_free(mpCalcBench);
+			mpCalcBench = nxCore::str_dup(val);
+		} else if (nxCore::str_eq(name, "sortbench")) {
+			mSortBench = ::atoi(val) != 0;
+		} else if (nxCore::str_eq(name, "primsortbench")) {
+			mPrimSortBench = ::atoi(val) != 0;
+		} else if (nxCore::str_eq(name, "gridbench")) {
+			mGridBench = ::atoi(val) != 0;
+		} else if (nxCore::str_eq(name, "buildbench")) {
+			mBuildBench = ::atoi(val) != 0;
+		} else if (nxCore::str_eq(name, "animlodtest")) {
+			mAnimLODTest = ::atoi(val) != 0;
+		} else if (nxCore::str_eq(name, "crowdbench")) {
+			mCrowdBench = ::atoi(val) != 0;
 		}
 	}
 	nxCore::mem_free(pBuf);
 }
 
+void sProgArgs::reset() {
+	nxCore::mem_free(mpGeoStats);
+	mpGeoStats = nullptr;
+	nxCore::mem_free(mpPktBench);
+	mpPktBench = nullptr;
+	nxCore::mem_free(mpBvhBench);
+	mpBvhBench = nullptr;
+	nxCore::mem_free(mpGndBench);
+	mpGndBench = nullptr;
+	nxCore::mem_free(mpCalcBench);
+	mpCalcBench = nullptr;
+}
+
 static sProgArgs s_args;
 
 int get_test_mode() {
@@ -115,6 +174,99 @@ int get_max_workers() {
 	return s_args.mMaxWrk;
 }
 
+typedef void (*GeoListFunc)(const char* pGeoPath);
+
+static void geo_cache_stats_func(const char* pGeoPath) {
+	dump_geo_cache_stats(pGeoPath);
+}
+
+static void geo_ray_packet_func(const char* pGeoPath) {
+	geo_ray_packet_bench(pGeoPath);
+}
+
+static void geo_bvh_query_func(const char* pGeoPath) {
+	geo_bvh_query_bench(pGeoPath);
+}
+
+static void with_geo(const char* pGeoPath, void (*func)(const sxGeometryData& geo, FILE* pOut)) {
+	sxData* pData = nxData::load(pGeoPath);
+	sxGeometryData* pGeo = pData ? pData->as<sxGeometryData>() : nullptr;
+	if (pGeo) {
+		::printf("%s: ", pGeoPath);
+		func(*pGeo, stdout);
+	} else {
+		::printf("%s: can't load geometry\n", pGeoPath);
+	}
+	nxData::unload(pData);
+}
+
+static void obst_ground_geo(const sxGeometryData& geo, FILE* pOut) {
+	obstGroundBench(geo, pOut);
+}
+
+static void obst_ground_func(const char* pGeoPath) {
+	with_geo(pGeoPath, obst_ground_geo);
+}
+
+static void geo_calc_func(const char* pGeoPath) {
+	with_geo(pGeoPath, geo_calc_bench);
+}
+
+typedef void (*MotionLibFunc)(const sxRigData& rig, const MOTION_LIB& motLib);
+
+static void with_motion_lib(MotionLibFunc func) {
+	const char* pRigPath = DATA_PATH("test3_chr.xrig");
+	sxData* pData = nxData::load(pRigPath);
+	sxRigData* pRig = pData ? pData->as<sxRigData>() : nullptr;
+	if (pRig) {
+		MOTION_LIB motLib;
+		motLib.init(DATA_PATH("test3_chr_mot"), *pRig);
+		if (motLib.get_motions_num() > 0) {
+			func(*pRig, motLib);
+		} else {
+			::printf("%s: no motions\n", pRigPath);
+		}
+		motLib.reset();
+	} else {
+		::printf("%s: can't load rig\n", pRigPath);
+	}
+	nxData::unload(pData);
+}
+
+static void anim_lod_test_func(const sxRigData& rig, const MOTION_LIB& motLib) {
+	anim_lod_test(rig, motLib.mppKfrs, motLib.mppRigLinks, motLib.get_motions_num());
+}
+
+static void anim_crowd_bench_func(const sxRigData& rig, const MOTION_LIB& motLib) {
+	anim_crowd_bench(rig, motLib.mppKfrs, motLib.mppRigLinks, motLib.get_motions_num(), get_brigade());
+}
+
+static void for_geo_list(const char* pList, GeoListFunc func) {
+	static const char* s_sampleGeos[] = {
+		DATA_PATH("test1.xgeo"),
+		DATA_PATH("test3_chr.xgeo"),
+		DATA_PATH("test3_stg.xgeo"),
+		DATA_PATH("test3_fnc.xgeo"),
+		DATA_PATH("test4_env.xgeo"),
+		DATA_PATH("test4_stg.xgeo"),
+		DATA_PATH("test4_sky.xgeo"),
+		DATA_PATH("dcar.xgeo"),
+		DATA_PATH("dcar_stg.xgeo")
+	};
+	if (nxCore::str_eq(pList, "all")) {
+		for (int i = 0; i < XD_ARY_LEN(s_sampleGeos); ++i) {
+			func(s_sampleGeos[i]);
+		}
+		return;
+	}
+	char* pBuf = nxCore::str_dup(pList);
+	char* pNext = nullptr;
+	for (char* pTok = ::strtok_s(pBuf, ",", &pNext); pTok; pTok = ::strtok_s(nullptr, ",", &pNext)) {
+		func(pTok);
+	}
+	nxCore::mem_free(pBuf);
+}
+
 void con_locate(int x, int y) {
 	HANDLE hstd = ::GetStdHandle(STD_OUTPUT_HANDLE);
 	COORD c;
@@ -267,6 +419,30 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR pCmdLine,
 
 	s_args.parse(pCmdLine);
 
+	if (s_args.mpGeoStats || s_args.mpPktBench || s_args.mpBvhBench || s_args.mpGndBench || s_args.mpCalcBench || s_args.mAnimLODTest) {
+		if (s_args.mpGeoStats) {
+			for_geo_list(s_args.mpGeoStats, geo_cache_stats_func);
+		}
+		if (s_args.mpPktBench) {
+			for_geo_list(s_args.mpPktBench, geo_ray_packet_func);
+		}
+		if (s_args.mpBvhBench) {
+			for_geo_list(s_args.mpBvhBench, geo_bvh_query_func);
+		}
+		if (s_args.mpGndBench) {
+			for_geo_list(s_args.mpGndBench, obst_ground_func);
+		}
+		if (s_args.mpCalcBench) {
+			for_geo_list(s_args.mpCalcBench, geo_calc_func);
+		}
+		if (s_args.mAnimLODTest) {
+			with_motion_lib(anim_lod_test_func);
+		}
+		s_args.reset();
+		close_console();
+		return 0;
+	}
+
 	if (s_args.mMaxWrk <= 0) {
 		s_args.mMaxWrk = get_cpu_count();
 	}
@@ -278,6 +454,29 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR pCmdLine,
 		}
 	}
 
+	if (s_args.mSortBench || s_args.mPrimSortBench || s_args.mGridBench || s_args.mBuildBench || s_args.mCrowdBench) {
+		if (s_args.mSortBench) {
+			key_sort_bench(s_pBrigade);
+		}
+		if (s_args.mPrimSortBench) {
+			prim_sort_bench();
+		}
+		if (s_args.mGridBench) {
+			obstGridBench(s_pBrigade);
+		}
+		if (s_args.mBuildBench) {
+			geo_bvh_bench(s_pBrigade);
+		}
+		if (s_args.mCrowdBench) {
+			with_motion_lib(anim_crowd_bench_func);
+		}
+		tskBrigadeDestroy(s_pBrigade);
+		s_pBrigade = nullptr;
+		s_args.reset();
+		close_console();
+		return 0;
+	}
+
 	TEST_IFC* pTest = &ifc_test1;
 	int w = 1024;
 	int h = 768;
@@ -336,6 +535,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR pCmdLine,
 		s_pBrigade = nullptr;
 	}
 
+	s_args.reset();
 	close_console();
 
 	nxCore::mem_dbg();//////////////////////
@@ -1,4 +1,6 @@
 #include "crossdata.hpp"
+#include "task.hpp"
+#include "timer.hpp"
 #include "obstacle.hpp"
 
 
@@ -468,9 +470,14 @@ public:
 	bool mHitFlg;
 	float mSlopeLim;
 
-	cGroundHitFn(float slopeLim) : mSlopeLim(slopeLim), mHitFlg(false), mPolId(-1), mDist(FLT_MAX) {}
+	float mAnyDistMin; /* over all hits, walkable or not */
+	float mAnyDistMax;
+
+	cGroundHitFn(float slopeLim) : mSlopeLim(slopeLim), mHitFlg(false), mPolId(-1), mDist(FLT_MAX), mAnyDistMin(FLT_MAX), mAnyDistMax(-FLT_MAX) {}
 
 	virtual bool operator()(const sxGeometryData::Polygon& pol, const cxVec& hitPos, const cxVec& hitNrm, float hitDist) {
+		mAnyDistMin = nxCalc::min(mAnyDistMin, hitDist);
+		mAnyDistMax = nxCalc::max(mAnyDistMax, hitDist);
 		if (hitNrm.y > mSlopeLim) {
 			if (hitDist < mDist) {
 				mPos = hitPos;
@@ -490,7 +497,7 @@ int obstGround(const cxVec& pos, const sxGeometryData& geo, cxVec* pPos, cxVec*
 	cxVec posUp = pos;
 	posUp.y += offsUp;
 	cxVec posDn = pos;
-	posDn.y += offsDown;
+	posDn.y -= offsDown;
 	cxLineSeg seg(posUp, posDn);
 	geo.hit_query(seg, hitFn);
 	if (hitFn.mHitFlg) {
@@ -512,3 +519,662 @@ int obstGround(const cxVec& pos, const sxGeometryData& geo, cxVec* pPos, cxVec*
 	return polId;
 }
 
+
+int obstGroundBatch(const cxVec* pPos, int num, const sxGeometryData& geo, cxVec* pGndPos, cxVec* pGndNrm, int* pPolIds, float offsUp, float offsDown, float slopeLim, const cObstGroundCache* pCache) {
+	int nhit = 0;
+	if (!pPos || num <= 0) return nhit;
+	if (pCache && (pCache->get_geo() != &geo || pCache->get_slope_lim() != slopeLim)) {
+		pCache = nullptr;
+	}
+	for (int i = 0; i < num; ++i) {
+		cxVec gpos;
+		cxVec gnrm;
+		int polId = pCache ? pCache->query(pPos[i], &gpos, &gnrm, offsUp, offsDown) : obstGround(pPos[i], geo, &gpos, &gnrm, offsUp, offsDown, slopeLim);
+		if (polId >= 0) {
+			++nhit;
+		}
+		if (pGndPos) {
+			pGndPos[i] = gpos;
+		}
+		if (pGndNrm) {
+			pGndNrm[i] = gnrm;
+		}
+		if (pPolIds) {
+			pPolIds[i] = polId;
+		}
+	}
+	return nhit;
+}
+
+
+bool cObstGroundCache::column_hit(float x, float z, float* pHeight, int* pPolId) const {
+	cxAABB bbox = mpGeo->mBBox;
+	float top = bbox.get_max_pos().y + 1.0f;
+	float btm = bbox.get_min_pos().y - 1.0f;
+	cGroundHitFn hitFn(mSlopeLim);
+	mpGeo->hit_query(cxLineSeg(cxVec(x, top, z), cxVec(x, btm, z)), hitFn);
+	/* a line through shared edges or vertices reports the same surface once per adjacent polygon */
+	bool res = hitFn.mHitFlg && hitFn.mAnyDistMax - hitFn.mAnyDistMin <= 1e-4f;
+	if (res) {
+		*pHeight = hitFn.mPos.y;
+		if (pPolId) {
+			*pPolId = hitFn.mPolId;
+		}
+	}
+	return res;
+}
+
+bool cObstGroundCache::init(const sxGeometryData& geo, float cellSize, float slopeLim, float tolerance) {
+	reset();
+	if (cellSize <= 0.0f) return false;
+	cxVec bmin = geo.mBBox.get_min_pos();
+	cxVec bmax = geo.mBBox.get_max_pos();
+	int nx = nxCalc::max(int(::ceilf((bmax.x - bmin.x) / cellSize)), 1);
+	int nz = nxCalc::max(int(::ceilf((bmax.z - bmin.z) / cellSize)), 1);
+	int tilesX = ((nx + 1) + OBST_GND_TILE_SIZE - 1) >> OBST_GND_TILE_SHIFT;
+	int tilesZ = ((nz + 1) + OBST_GND_TILE_SIZE - 1) >> OBST_GND_TILE_SHIFT;
+	int nsmp = (tilesX * tilesZ) << (OBST_GND_TILE_SHIFT * 2);
+	int smpBytes = XD_BIT_ARY_SIZE(uint32_t, nsmp) * sizeof(uint32_t);
+	mpHeights = (float*)nxCore::mem_alloc(nsmp * sizeof(float), XD_FOURCC('o', 'g', 'h', 'H'));
+	mpCellPolIds = (int32_t*)nxCore::mem_alloc(nx * nz * sizeof(int32_t), XD_FOURCC('o', 'g', 'h', 'P'));
+	uint32_t* pSmpValid = (uint32_t*)nxCore::mem_alloc(smpBytes, XD_TMP_MEM_TAG);
+	if (!mpHeights || !mpCellPolIds || !pSmpValid) {
+		nxCore::mem_free(pSmpValid);
+		reset();
+		return false;
+	}
+	mpGeo = &geo;
+	mOrgX = bmin.x;
+	mOrgZ = bmin.z;
+	mCellSize = cellSize;
+	mInvCellSize = 1.0f / cellSize;
+	mSlopeLim = slopeLim;
+	mCellsX = nx;
+	mCellsZ = nz;
+	mTilesX = tilesX;
+	::memset(pSmpValid, 0, smpBytes);
+	for (int iz = 0; iz <= nz; ++iz) {
+		for (int ix = 0; ix <= nx; ++ix) {
+			int idx = calc_sample_idx(ix, iz);
+			float h = 0.0f;
+			if (column_hit(mOrgX + float(ix) * cellSize, mOrgZ + float(iz) * cellSize, &h, nullptr)) {
+				XD_BIT_ARY_ST(uint32_t, pSmpValid, idx);
+			}
+			mpHeights[idx] = h;
+		}
+	}
+	static const float chkOffs[5][2] = {
+		{ 0.5f, 0.5f }, { 0.5f, 0.0f }, { 0.0f, 0.5f }, { 1.0f, 0.5f }, { 0.5f, 1.0f }
+	};
+	mCachedNum = 0;
+	for (int iz = 0; iz < nz; ++iz) {
+		for (int ix = 0; ix < nx; ++ix) {
+			int cellPolId = -1;
+			int i00 = calc_sample_idx(ix, iz);
+			int i10 = calc_sample_idx(ix + 1, iz);
+			int i01 = calc_sample_idx(ix, iz + 1);
+			int i11 = calc_sample_idx(ix + 1, iz + 1);
+			bool flg = XD_BIT_ARY_CK(uint32_t, pSmpValid, i00) && XD_BIT_ARY_CK(uint32_t, pSmpValid, i10)
+			        && XD_BIT_ARY_CK(uint32_t, pSmpValid, i01) && XD_BIT_ARY_CK(uint32_t, pSmpValid, i11);
+			for (int i = 0; flg && i < 5; ++i) {
+				float tx = chkOffs[i][0];
+				float tz = chkOffs[i][1];
+				float est = nxCalc::lerp(nxCalc::lerp(mpHeights[i00], mpHeights[i10], tx), nxCalc::lerp(mpHeights[i01], mpHeights[i11], tx), tz);
+				float h = 0.0f;
+				int polId = -1;
+				flg = column_hit(mOrgX + (float(ix) + tx) * cellSize, mOrgZ + (float(iz) + tz) * cellSize, &h, i == 0 ? &polId : nullptr);
+				flg = flg && ::fabsf(est - h) <= tolerance;
+				if (i == 0) {
+					cellPolId = polId;
+					flg = flg && polId >= 0;
+				}
+			}
+			mpCellPolIds[iz * nx + ix] = flg ? cellPolId : -1;
+			if (flg) {
+				++mCachedNum;
+			}
+		}
+	}
+	nxCore::mem_free(pSmpValid);
+	return true;
+}
+
+void cObstGroundCache::reset() {
+	nxCore::mem_free(mpHeights);
+	mpHeights = nullptr;
+	nxCore::mem_free(mpCellPolIds);
+	mpCellPolIds = nullptr;
+	mpGeo = nullptr;
+	mCellsX = 0;
+	mCellsZ = 0;
+	mTilesX = 0;
+	mCachedNum = 0;
+}
+
+bool cObstGroundCache::is_cached(const cxVec& pos) const {
+	if (!mpGeo) return false;
+	float fx = (pos.x - mOrgX) * mInvCellSize;
+	float fz = (pos.z - mOrgZ) * mInvCellSize;
+	if (!(fx >= 0.0f && fz >= 0.0f && fx < float(mCellsX) && fz < float(mCellsZ))) return false;
+	return mpCellPolIds[int(fz) * mCellsX + int(fx)] >= 0;
+}
+
+int cObstGroundCache::query(const cxVec& pos, cxVec* pPos, cxVec* pNrm, float offsUp, float offsDown) const {
+	if (!mpGeo) {
+		if (pPos) {
+			*pPos = pos;
+		}
+		if (pNrm) {
+			*pNrm = nxVec::get_axis(exAxis::PLUS_Y);
+		}
+		return -1;
+	}
+	float fx = (pos.x - mOrgX) * mInvCellSize;
+	float fz = (pos.z - mOrgZ) * mInvCellSize;
+	int polId = -1;
+	if (fx >= 0.0f && fz >= 0.0f && fx < float(mCellsX) && fz < float(mCellsZ)) {
+		int ix = int(fx);
+		int iz = int(fz);
+		polId = mpCellPolIds[iz * mCellsX + ix];
+		if (polId >= 0) {
+			float tx = fx - float(ix);
+			float tz = fz - float(iz);
+			float h00 = mpHeights[calc_sample_idx(ix, iz)];
+			float h10 = mpHeights[calc_sample_idx(ix + 1, iz)];
+			float h01 = mpHeights[calc_sample_idx(ix, iz + 1)];
+			float h11 = mpHeights[calc_sample_idx(ix + 1, iz + 1)];
+			float h0 = nxCalc::lerp(h00, h10, tx);
+			float h1 = nxCalc::lerp(h01, h11, tx);
+			float h = nxCalc::lerp(h0, h1, tz);
+			if (h <= pos.y + offsUp && h >= pos.y - offsDown) {
+				if (pPos) {
+					*pPos = cxVec(pos.x, h, pos.z);
+				}
+				if (pNrm) {
+					float dx = nxCalc::lerp(h10 - h00, h11 - h01, tz);
+					float dz = h1 - h0;
+					*pNrm = cxVec(-dx, mCellSize, -dz).get_normalized();
+				}
+			} else {
+				polId = -1;
+				if (pPos) {
+					*pPos = pos;
+				}
+				if (pNrm) {
+					*pNrm = nxVec::get_axis(exAxis::PLUS_Y);
+				}
+			}
+			return polId;
+		}
+	}
+	return obstGround(pos, *mpGeo, pPos, pNrm, offsUp, offsDown, mSlopeLim);
+}
+
+
+#define OBST_GRID_JOBS_PER_WRK 4
+
+void cObstGrid::init(int maxAgents, int maxWorkers) {
+	reset();
+	if (maxAgents <= 0) return;
+	mAgentsMax = maxAgents;
+	mWrkNum = nxCalc::max(maxWorkers, 1);
+	mTblSize = 1;
+	while (mTblSize < maxAgents * 2) {
+		mTblSize <<= 1;
+	}
+	mpSph = (cxSphere*)nxCore::mem_alloc(maxAgents * sizeof(cxSphere), XD_FOURCC('o', 'g', 'r', 'S'));
+	mpCell = (int32_t*)nxCore::mem_alloc(maxAgents * 3 * sizeof(int32_t), XD_FOURCC('o', 'g', 'r', 'C'));
+	mpBucketOrg = (int32_t*)nxCore::mem_alloc((mTblSize + 1) * sizeof(int32_t), XD_FOURCC('o', 'g', 'r', 'B'));
+	mpBucketLst = (int32_t*)nxCore::mem_alloc(maxAgents * sizeof(int32_t), XD_FOURCC('o', 'g', 'r', 'L'));
+	mpNbrOrg = (int32_t*)nxCore::mem_alloc((maxAgents + 1) * sizeof(int32_t), XD_FOURCC('o', 'g', 'r', 'O'));
+	mpNbrNum = (int32_t*)nxCore::mem_alloc(maxAgents * sizeof(int32_t), XD_FOURCC('o', 'g', 'r', 'N'));
+	if (!mpSph || !mpCell || !mpBucketOrg || !mpBucketLst || !mpNbrOrg || !mpNbrNum || !realloc_nbrs(maxAgents * 8)) {
+		reset();
+		return;
+	}
+	mpNbrOrg[0] = 0;
+	if (mWrkNum > 1) {
+		mJobsMax = mWrkNum * OBST_GRID_JOBS_PER_WRK;
+		mpQueue = tskQueueCreate(mJobsMax);
+		mpJobs = tskJobsAlloc(mJobsMax);
+		mpJobInfo = (JobInfo*)nxCore::mem_alloc(mJobsMax * sizeof(JobInfo), XD_FOURCC('o', 'g', 'r', 'J'));
+		if (mpQueue && mpJobs && mpJobInfo) {
+			for (int i = 0; i < mJobsMax; ++i) {
+				mpJobs[i].mFunc = phase_job;
+				mpJobs[i].mpData = this;
+			}
+		} else {
+			tskQueueDestroy(mpQueue);
+			mpQueue = nullptr;
+			tskJobsFree(mpJobs);
+			mpJobs = nullptr;
+			nxCore::mem_free(mpJobInfo);
+			mpJobInfo = nullptr;
+			mJobsMax = 0;
+		}
+	}
+}
+
+void cObstGrid::reset() {
+	nxCore::mem_free(mpSph);
+	mpSph = nullptr;
+	nxCore::mem_free(mpCell);
+	mpCell = nullptr;
+	nxCore::mem_free(mpBucketOrg);
+	mpBucketOrg = nullptr;
+	nxCore::mem_free(mpBucketLst);
+	mpBucketLst = nullptr;
+	nxCore::mem_free(mpNbrOrg);
+	mpNbrOrg = nullptr;
+	nxCore::mem_free(mpNbrNum);
+	mpNbrNum = nullptr;
+	nxCore::mem_free(mpNbrLst);
+	mpNbrLst = nullptr;
+	tskQueueDestroy(mpQueue);
+	mpQueue = nullptr;
+	tskJobsFree(mpJobs);
+	mpJobs = nullptr;
+	nxCore::mem_free(mpJobInfo);
+	mpJobInfo = nullptr;
+	mAgentsNum = 0;
+	mAgentsMax = 0;
+	mTblSize = 0;
+	mNbrMax = 0;
+	mPairsNum = 0;
+	mJobsMax = 0;
+	mWrkNum = 0;
+}
+
+bool cObstGrid::realloc_nbrs(int nnbr) {
+	if (nnbr <= mNbrMax) return true;
+	nxCore::mem_free(mpNbrLst);
+	mpNbrLst = (int32_t*)nxCore::mem_alloc(nnbr * sizeof(int32_t), XD_FOURCC('o', 'g', 'r', 'P'));
+	mNbrMax = mpNbrLst ? nnbr : 0;
+	return mpNbrLst != nullptr;
+}
+
+template<typename FUNC> void cObstGrid::scan_nbrs(int idx, FUNC& fun) const {
+	const int32_t* pCell = &mpCell[idx * 3];
+	cxVec c = mpSph[idx].get_center();
+	float r = mpSph[idx].get_radius() + mMargin;
+	for (int dz = -1; dz <= 1; ++dz) {
+		for (int dy = -1; dy <= 1; ++dy) {
+			for (int dx = -1; dx <= 1; ++dx) {
+				int32_t ix = pCell[0] + dx;
+				int32_t iy = pCell[1] + dy;
+				int32_t iz = pCell[2] + dz;
+				uint32_t bkt = calc_bucket(ix, iy, iz);
+				int org = mpBucketOrg[bkt];
+				int end = mpBucketOrg[bkt + 1];
+				for (int k = org; k < end; ++k) {
+					int j = mpBucketLst[k];
+					if (j == idx) continue;
+					const int32_t* pNbrCell = &mpCell[j * 3];
+					if (pNbrCell[0] != ix || pNbrCell[1] != iy || pNbrCell[2] != iz) continue;
+					float rr = r + mpSph[j].get_radius();
+					if (nxVec::dist2(c, mpSph[j].get_center()) <= rr*rr) {
+						fun(j);
+					}
+				}
+			}
+		}
+	}
+}
+
+struct sObstGridCounter {
+	int mCount;
+	void operator()(int j) { ++mCount; }
+};
+
+struct sObstGridWriter {
+	int32_t* mpDst;
+	int mCount;
+	void operator()(int j) {
+		/* insertion keeps the list in index order */
+		int k = mCount++;
+		while (k > 0 && mpDst[k - 1] > j) {
+			mpDst[k] = mpDst[k - 1];
+			--k;
+		}
+		mpDst[k] = j;
+	}
+};
+
+void cObstGrid::count_range(int org, int num) {
+	for (int i = org; i < org + num; ++i) {
+		sObstGridCounter cnt;
+		cnt.mCount = 0;
+		scan_nbrs(i, cnt);
+		mpNbrNum[i] = cnt.mCount;
+	}
+}
+
+void cObstGrid::fill_range(int org, int num) {
+	for (int i = org; i < org + num; ++i) {
+		sObstGridWriter wr;
+		wr.mpDst = &mpNbrLst[mpNbrOrg[i]];
+		wr.mCount = 0;
+		scan_nbrs(i, wr);
+	}
+}
+
+void cObstGrid::resolve_range(int org, int num, bool pillars) {
+	const ResolveParams& prm = mResolve;
+	for (int i = org; i < org + num; ++i) {
+		cxVec pos = prm.mpNewPos[i];
+		const int32_t* pNbr = &mpNbrLst[mpNbrOrg[i]];
+		int n = mpNbrOrg[i + 1] - mpNbrOrg[i];
+		for (int k = 0; k < n; ++k) {
+			int j = pNbr[k];
+			cxVec adjPos;
+			bool flg = false;
+			if (pillars) {
+				flg = obstPillarToPillar(pos, prm.mpOldPos[i], prm.mpRadius[i], prm.mpHeight[i], prm.mpNewPos[j], prm.mpRadius[j], prm.mpHeight[j], &adjPos, prm.mReflectFactor, prm.mMargin);
+			} else {
+				flg = obstBallToBall(pos, prm.mpOldPos[i], prm.mpRadius[i], prm.mpNewPos[j], prm.mpRadius[j], &adjPos, prm.mReflectFactor, prm.mMargin);
+			}
+			if (flg) {
+				pos = adjPos;
+			}
+		}
+		prm.mpAdjPos[i] = pos;
+	}
+}
+
+/*static*/ void cObstGrid::phase_job(TSK_CONTEXT* pCtx) {
+	TSK_JOB* pJob = pCtx->mpJob;
+	cObstGrid* pSelf = (cObstGrid*)pJob->mpData;
+	JobInfo* pInfo = &pSelf->mpJobInfo[pJob->mId];
+	switch (pSelf->mPhase) {
+		case ePhase::COUNT: pSelf->count_range(pInfo->mOrg, pInfo->mNum); break;
+		case ePhase::FILL: pSelf->fill_range(pInfo->mOrg, pInfo->mNum); break;
+		case ePhase::BALLS: pSelf->resolve_range(pInfo->mOrg, pInfo->mNum, false); break;
+		case ePhase::PILLARS: pSelf->resolve_range(pInfo->mOrg, pInfo->mNum, true); break;
+	}
+}
+
+void cObstGrid::exec_phase(ePhase phase, TSK_BRIGADE* pBgd) {
+	int n = mAgentsNum;
+	mPhase = phase;
+	bool tskFlg = pBgd && mpQueue && mpJobs && mpJobInfo && n >= mJobsMax * 16;
+	if (!tskFlg) {
+		switch (phase) {
+			case ePhase::COUNT: count_range(0, n); break;
+			case ePhase::FILL: fill_range(0, n); break;
+			case ePhase::BALLS: resolve_range(0, n, false); break;
+			case ePhase::PILLARS: resolve_range(0, n, true); break;
+		}
+		return;
+	}
+	tskQueuePurge(mpQueue);
+	int chunk = (n + mJobsMax - 1) / mJobsMax;
+	int njobs = 0;
+	for (int org = 0; org < n; org += chunk) {
+		mpJobInfo[njobs].mOrg = org;
+		mpJobInfo[njobs].mNum = nxCalc::min(chunk, n - org);
+		tskQueueAdd(mpQueue, &mpJobs[njobs]);
+		++njobs;
+	}
+	tskBrigadeSetActiveWorkers(pBgd, nxCalc::min(tskBrigadeGetNumWorkers(pBgd), mWrkNum));
+	tskQueueExec(mpQueue, pBgd);
+	tskBrigadeResetActiveWorkers(pBgd);
+}
+
+void cObstGrid::build(const cxSphere* pSph, int num, float margin, TSK_BRIGADE* pBgd, float cellSize) {
+	mAgentsNum = 0;
+	mPairsNum = 0;
+	if (!pSph || num <= 0 || !mpSph) return;
+	num = nxCalc::min(num, mAgentsMax);
+	mAgentsNum = num;
+	mMargin = nxCalc::max(margin, 0.0f);
+	float maxRad = 0.0f;
+	for (int i = 0; i < num; ++i) {
+		mpSph[i] = pSph[i];
+		maxRad = nxCalc::max(maxRad, pSph[i].get_radius());
+	}
+	if (cellSize < (maxRad * 2.0f + mMargin)) {
+		cellSize = maxRad * 2.0f + mMargin;
+	}
+	mCellSize = nxCalc::max(cellSize, 1e-4f);
+	mInvCellSize = 1.0f / mCellSize;
+
+	for (int i = 0; i <= mTblSize; ++i) {
+		mpBucketOrg[i] = 0;
+	}
+	for (int i = 0; i < num; ++i) {
+		cxVec c = mpSph[i].get_center() * mInvCellSize;
+		int32_t* pCell = &mpCell[i * 3];
+		pCell[0] = (int32_t)::floorf(c.x);
+		pCell[1] = (int32_t)::floorf(c.y);
+		pCell[2] = (int32_t)::floorf(c.z);
+		++mpBucketOrg[calc_bucket(pCell[0], pCell[1], pCell[2])];
+	}
+	for (int i = 1; i < mTblSize; ++i) {
+		mpBucketOrg[i] += mpBucketOrg[i - 1];
+	}
+	mpBucketOrg[mTblSize] = num;
+	/* filled backwards, so bucket ends become bucket starts and every bucket lists agents in index order */
+	for (int i = num; --i >= 0;) {
+		const int32_t* pCell = &mpCell[i * 3];
+		mpBucketLst[--mpBucketOrg[calc_bucket(pCell[0], pCell[1], pCell[2])]] = i;
+	}
+
+	exec_phase(ePhase::COUNT, pBgd);
+	mpNbrOrg[0] = 0;
+	for (int i = 0; i < num; ++i) {
+		mpNbrOrg[i + 1] = mpNbrOrg[i] + mpNbrNum[i];
+	}
+	int nnbr = mpNbrOrg[num];
+	if (!realloc_nbrs(nnbr)) {
+		mAgentsNum = 0;
+		return;
+	}
+	exec_phase(ePhase::FILL, pBgd);
+	mPairsNum = nnbr / 2;
+}
+
+void cObstGrid::resolve_balls(const cxVec* pNewPos, const cxVec* pOldPos, const float* pRadius, int num, cxVec* pAdjPos, TSK_BRIGADE* pBgd, float reflectFactor, float margin) {
+	if (!pNewPos || !pOldPos || !pRadius || !pAdjPos || !mpSph) return;
+	num = nxCalc::min(num, mAgentsMax);
+	for (int i = 0; i < num; ++i) {
+		mpSph[i] = cxSphere(pNewPos[i], pRadius[i]);
+	}
+	build(mpSph, num, margin, pBgd);
+	mResolve.mpNewPos = pNewPos;
+	mResolve.mpOldPos = pOldPos;
+	mResolve.mpRadius = pRadius;
+	mResolve.mpHeight = nullptr;
+	mResolve.mpAdjPos = pAdjPos;
+	mResolve.mReflectFactor = reflectFactor;
+	mResolve.mMargin = margin;
+	exec_phase(ePhase::BALLS, pBgd);
+}
+
+void cObstGrid::resolve_pillars(const cxVec* pNewPos, const cxVec* pOldPos, const float* pRadius, const float* pHeight, int num, cxVec* pAdjPos, TSK_BRIGADE* pBgd, float reflectFactor, float margin) {
+	if (!pNewPos || !pOldPos || !pRadius || !pHeight || !pAdjPos || !mpSph) return;
+	num = nxCalc::min(num, mAgentsMax);
+	for (int i = 0; i < num; ++i) {
+		/* bounding sphere of the pillar */
+		float hh = pHeight[i] * 0.5f;
+		cxVec c = pNewPos[i];
+		c.y += hh;
+		mpSph[i] = cxSphere(c, ::sqrtf(pRadius[i]*pRadius[i] + hh*hh));
+	}
+	build(mpSph, num, margin, pBgd);
+	mResolve.mpNewPos = pNewPos;
+	mResolve.mpOldPos = pOldPos;
+	mResolve.mpRadius = pRadius;
+	mResolve.mpHeight = pHeight;
+	mResolve.mpAdjPos = pAdjPos;
+	mResolve.mReflectFactor = reflectFactor;
+	mResolve.mMargin = margin;
+	exec_phase(ePhase::PILLARS, pBgd);
+}
+
+
+/* obstGroundBatch against per-point obstGround: identical without the cache, same hits and heights within
+   the cache tolerance with it; a cache built with another slope limit must be ignored */
+void obstGroundBench(const sxGeometryData& geo, FILE* pOut, int num) {
+	if (!pOut) {
+		pOut = stdout;
+	}
+	const float cellSize = 0.5f;
+	const float tol = 1e-2f;
+	const float slopeLim = 0.5f;
+	cxVec* pPos = (cxVec*)nxCore::mem_alloc(num * sizeof(cxVec), XD_TMP_MEM_TAG);
+	cxVec* pRefPos = (cxVec*)nxCore::mem_alloc(num * sizeof(cxVec), XD_TMP_MEM_TAG);
+	cxVec* pRefNrm = (cxVec*)nxCore::mem_alloc(num * sizeof(cxVec), XD_TMP_MEM_TAG);
+	int* pRefIds = (int*)nxCore::mem_alloc(num * sizeof(int), XD_TMP_MEM_TAG);
+	cxVec* pGndPos = (cxVec*)nxCore::mem_alloc(num * sizeof(cxVec), XD_TMP_MEM_TAG);
+	cxVec* pGndNrm = (cxVec*)nxCore::mem_alloc(num * sizeof(cxVec), XD_TMP_MEM_TAG);
+	int* pIds = (int*)nxCore::mem_alloc(num * sizeof(int), XD_TMP_MEM_TAG);
+	if (pPos && pRefPos && pRefNrm && pRefIds && pGndPos && pGndNrm && pIds) {
+		cxVec bmin = geo.mBBox.get_min_pos();
+		cxVec bmax = geo.mBBox.get_max_pos();
+		float offsUp = bmax.y - bmin.y + 1.0f;
+		float offsDown = offsUp;
+		sxRNG rng;
+		nxCore::rng_seed(&rng, 9);
+		for (int i = 0; i < num; ++i) {
+			pPos[i].set(nxCalc::lerp(bmin.x, bmax.x, nxCore::rng_f01(&rng)), (bmin.y + bmax.y) * 0.5f, nxCalc::lerp(bmin.z, bmax.z, nxCore::rng_f01(&rng)));
+		}
+		int nerr = 0;
+		double t0 = time_micros();
+		for (int i = 0; i < num; ++i) {
+			pRefIds[i] = obstGround(pPos[i], geo, &pRefPos[i], &pRefNrm[i], offsUp, offsDown, slopeLim);
+		}
+		double tray = time_micros() - t0;
+		int nhit = obstGroundBatch(pPos, num, geo, pGndPos, pGndNrm, pIds, offsUp, offsDown, slopeLim);
+		for (int i = 0; i < num; ++i) {
+			if (pIds[i] != pRefIds[i]) ++nerr;
+			if (::memcmp(&pGndPos[i], &pRefPos[i], sizeof(cxVec)) != 0) ++nerr;
+			if (::memcmp(&pGndNrm[i], &pRefNrm[i], sizeof(cxVec)) != 0) ++nerr;
+		}
+
+		cObstGroundCache cache;
+		t0 = time_micros();
+		cache.init(geo, cellSize, slopeLim, tol);
+		double tbuild = time_micros() - t0;
+		t0 = time_micros();
+		int nhitCache = obstGroundBatch(pPos, num, geo, pGndPos, pGndNrm, pIds, offsUp, offsDown, slopeLim, &cache);
+		double tcache = time_micros() - t0;
+		float maxErr = 0.0f;
+		for (int i = 0; i < num; ++i) {
+			if ((pIds[i] >= 0) != (pRefIds[i] >= 0)) {
+				++nerr;
+			} else if (pIds[i] >= 0) {
+				maxErr = nxCalc::max(maxErr, ::fabsf(pGndPos[i].y - pRefPos[i].y));
+			}
+		}
+		/* bilinear vs. the polygons inside a checked cell */
+		if (maxErr > tol * 2.0f) ++nerr;
+		if (nhitCache != nhit) ++nerr;
+
+		obstGroundBatch(pPos, num, geo, pGndPos, nullptr, pIds, offsUp, offsDown, slopeLim * 0.5f, &cache);
+		for (int i = 0; i < num; ++i) {
+			int refId = obstGround(pPos[i], geo, &pRefPos[i], nullptr, offsUp, offsDown, slopeLim * 0.5f);
+			if (pIds[i] != refId || ::memcmp(&pGndPos[i], &pRefPos[i], sizeof(cxVec)) != 0) ++nerr;
+		}
+
+		int ncell = cache.get_cells_num();
+		::fprintf(pOut, "ground: %d polygons, %d hits/%d, cache %.1f%% of %d cells, build %.2f ms, ray %.2f ms, cache %.2f ms, max err %f: %d errors\n",
+		          geo.get_pol_num(), nhit, num, ncell ? float(cache.get_cached_num()) * 100.0f / float(ncell) : 0.0f, ncell,
+		          tbuild / 1e3, tray / 1e3, tcache / 1e3, maxErr, nerr);
+	}
+	nxCore::mem_free(pPos);
+	nxCore::mem_free(pRefPos);
+	nxCore::mem_free(pRefNrm);
+	nxCore::mem_free(pRefIds);
+	nxCore::mem_free(pGndPos);
+	nxCore::mem_free(pGndNrm);
+	nxCore::mem_free(pIds);
+}
+
+
+struct sObstGridBenchPairs {
+	const int32_t* mpRef; /* i, j of the reference pairs */
+	int mRefNum;
+	int mNum;
+	int mErrs;
+
+	void operator()(int i, int j) {
+		if (mNum >= mRefNum || mpRef[mNum * 2] != i || mpRef[mNum * 2 + 1] != j) {
+			++mErrs;
+		}
+		++mNum;
+	}
+};
+
+/* cObstGrid::for_each_pair against all pairs checked in O(n^2): same pairs in the same order, serial and on pBgd */
+void obstGridBench(TSK_BRIGADE* pBgd, FILE* pOut) {
+	static const int s_nums[] = { 1000, 5000, 20000, 50000 };
+	if (!pOut) {
+		pOut = stdout;
+	}
+	const float margin = c_obstSepMargin;
+	const int maxNum = s_nums[XD_ARY_LEN(s_nums) - 1];
+	int refMax = maxNum * 16;
+	int nwrk = pBgd ? tskBrigadeGetNumWorkers(pBgd) : 1;
+	cxSphere* pSph = (cxSphere*)nxCore::mem_alloc(maxNum * sizeof(cxSphere), XD_TMP_MEM_TAG);
+	int32_t* pRef = (int32_t*)nxCore::mem_alloc(refMax * 2 * sizeof(int32_t), XD_TMP_MEM_TAG);
+	if (pSph && pRef) {
+		for (int inum = 0; inum < (int)XD_ARY_LEN(s_nums); ++inum) {
+			int n = s_nums[inum];
+			/* same density at every count */
+			float ext = ::sqrtf((float)n) * 1.5f;
+			sxRNG rng;
+			nxCore::rng_seed(&rng, 21);
+			for (int i = 0; i < n; ++i) {
+				float x = nxCore::rng_f01(&rng) * ext;
+				float y = nxCore::rng_f01(&rng) * 2.0f;
+				float z = nxCore::rng_f01(&rng) * ext;
+				pSph[i] = cxSphere(x, y, z, 0.3f + nxCore::rng_f01(&rng) * 0.4f);
+			}
+			int nerr = 0;
+			int nref = 0;
+			double t0 = time_micros();
+			for (int i = 0; i < n; ++i) {
+				cxVec c = pSph[i].get_center();
+				float r = pSph[i].get_radius() + margin;
+				for (int j = i + 1; j < n; ++j) {
+					float rr = r + pSph[j].get_radius();
+					if (nxVec::dist2(c, pSph[j].get_center()) <= rr*rr) {
+						if (nref < refMax) {
+							pRef[nref * 2] = i;
+							pRef[nref * 2 + 1] = j;
+						}
+						++nref;
+					}
+				}
+			}
+			double tref = time_micros() - t0;
+			if (nref > refMax) ++nerr;
+			double tbld[2] = { 0.0, 0.0 };
+			for (int mode = 0; mode < 2; ++mode) {
+				TSK_BRIGADE* pWrk = mode ? pBgd : nullptr;
+				cObstGrid grid;
+				grid.init(n, mode ? nwrk : 1);
+				for (int rep = 0; rep < 5; ++rep) {
+					t0 = time_micros();
+					grid.build(pSph, n, margin, pWrk);
+					double dt = time_micros() - t0;
+					tbld[mode] = rep ? nxCalc::min(tbld[mode], dt) : dt;
+				}
+				sObstGridBenchPairs pairs;
+				pairs.mpRef = pRef;
+				pairs.mRefNum = nxCalc::min(nref, refMax);
+				pairs.mNum = 0;
+				pairs.mErrs = 0;
+				grid.for_each_pair(pairs);
+				if (pairs.mNum != nref) ++nerr;
+				if (grid.get_pairs_num() != nref) ++nerr;
+				nerr += pairs.mErrs;
+				grid.reset();
+			}
+			::fprintf(pOut, "obst grid: %d agents, %d pairs, O(n^2) %.2f ms, build %.2f ms, %.2f ms on %d workers: %d errors\n",
+			          n, nref, tref / 1e3, tbld[0] / 1e3, tbld[1] / 1e3, nwrk, nerr);
+		}
+	}
+	nxCore::mem_free(pSph);
+	nxCore::mem_free(pRef);
+}
@@ -20,3 +20,175 @@ bool obstPillarToPillar(const cxVec& newPos, const cxVec& oldPos, float radius,
 bool obstSeparateSpheres(const cxSphere& movSph, const cxVec& vel, const cxSphere& staticSph, cxVec* pSepVec, float margin = c_obstSepMargin);
 bool obstSeparateSphereCapsule(const cxSphere& movSph, const cxVec& vel, const cxCapsule& staticCap, cxVec* pSepVec, cxVec* pAxisPnt, float margin = c_obstSepMargin);
 int obstGround(const cxVec& pos, const sxGeometryData& geo, cxVec* pPos, cxVec* pNrm, float offsUp = 0.5, float offsDown = 1.5f, float slopeLim = 0.5f);
+
+class cObstGroundCache;
+
+/* pGndPos/pGndNrm/pPolIds are optional, returns the number of points with ground */
+int obstGroundBatch(const cxVec* pPos, int num, const sxGeometryData& geo, cxVec* pGndPos, cxVec* pGndNrm, int* pPolIds, float offsUp = 0.5f, float offsDown = 1.5f, float slopeLim = 0.5f, const cObstGroundCache* pCache = nullptr);
+
+struct TSK_BRIGADE;
+struct TSK_QUEUE;
+struct TSK_JOB;
+struct TSK_CONTEXT;
+
+/* Spatial hash broadphase: agents are binned by sphere center into cells at least one diameter wide,
+   so candidates come from the 27 surrounding cells. Neighbor lists are sorted by agent index,
+   results do not depend on the number of workers. */
+class cObstGrid {
+protected:
+	enum class ePhase {
+		COUNT,
+		FILL,
+		BALLS,
+		PILLARS
+	};
+
+	struct JobInfo {
+		int32_t mOrg;
+		int32_t mNum;
+	};
+
+	struct ResolveParams {
+		const cxVec* mpNewPos;
+		const cxVec* mpOldPos;
+		const float* mpRadius;
+		const float* mpHeight;
+		cxVec* mpAdjPos;
+		float mReflectFactor;
+		float mMargin;
+	};
+
+	cxSphere* mpSph;
+	int32_t* mpCell;      /* xyz cell coords per agent */
+	int32_t* mpBucketOrg; /* mTblSize + 1 */
+	int32_t* mpBucketLst;
+	int32_t* mpNbrOrg;    /* mAgentsNum + 1 */
+	int32_t* mpNbrNum;
+	int32_t* mpNbrLst;
+	TSK_JOB* mpJobs;
+	JobInfo* mpJobInfo;
+	TSK_QUEUE* mpQueue;
+	ResolveParams mResolve;
+	ePhase mPhase;
+	float mCellSize;
+	float mInvCellSize;
+	float mMargin;
+	int mAgentsNum;
+	int mAgentsMax;
+	int mTblSize;
+	int mNbrMax;
+	int mPairsNum;
+	int mJobsMax;
+	int mWrkNum;
+
+	uint32_t calc_bucket(int32_t ix, int32_t iy, int32_t iz) const {
+		uint32_t h = (uint32_t)ix * 73856093U ^ (uint32_t)iy * 19349663U ^ (uint32_t)iz * 83492791U;
+		return h & (uint32_t)(mTblSize - 1);
+	}
+
+	template<typename FUNC> void scan_nbrs(int idx, FUNC& fun) const;
+	void count_range(int org, int num);
+	void fill_range(int org, int num);
+	void resolve_range(int org, int num, bool pillars);
+	void exec_phase(ePhase phase, TSK_BRIGADE* pBgd);
+	bool realloc_nbrs(int nnbr);
+
+	static void phase_job(TSK_CONTEXT* pCtx);
+
+public:
+	cObstGrid()
+	: mpSph(nullptr), mpCell(nullptr), mpBucketOrg(nullptr), mpBucketLst(nullptr),
+	mpNbrOrg(nullptr), mpNbrNum(nullptr), mpNbrLst(nullptr), mpJobs(nullptr), mpJobInfo(nullptr), mpQueue(nullptr),
+	mPhase(ePhase::COUNT), mCellSize(0.0f), mInvCellSize(0.0f), mMargin(0.0f),
+	mAgentsNum(0), mAgentsMax(0), mTblSize(0), mNbrMax(0), mPairsNum(0), mJobsMax(0), mWrkNum(0) {
+		::memset(&mResolve, 0, sizeof(mResolve));
+	}
+
+	~cObstGrid() { reset(); }
+
+	void init(int maxAgents, int maxWorkers = 1);
+	void reset();
+
+	/* cellSize <= 0: twice the largest radius plus margin */
+	void build(const cxSphere* pSph, int num, float margin = c_obstSepMargin, TSK_BRIGADE* pBgd = nullptr, float cellSize = 0.0f);
+
+	int get_agents_num() const { return mAgentsNum; }
+	bool ck_agent_idx(int idx) const { return (uint32_t)idx < (uint32_t)mAgentsNum; }
+	int get_pairs_num() const { return mPairsNum; }
+	int get_nbrs_num(int idx) const { return ck_agent_idx(idx) ? mpNbrOrg[idx + 1] - mpNbrOrg[idx] : 0; }
+	const int32_t* get_nbrs(int idx) const { return ck_agent_idx(idx) ? &mpNbrLst[mpNbrOrg[idx]] : nullptr; }
+
+	/* FUNC: void(int i, int j), i < j, ascending (i, j) order */
+	template<typename FUNC> void for_each_pair(FUNC& fun) const {
+		for (int i = 0; i < mAgentsNum; ++i) {
+			const int32_t* pNbr = &mpNbrLst[mpNbrOrg[i]];
+			int n = mpNbrOrg[i + 1] - mpNbrOrg[i];
+			for (int k = 0; k < n; ++k) {
+				if (pNbr[k] > i) {
+					fun(i, pNbr[k]);
+				}
+			}
+		}
+	}
+
+	/* every agent is moved against its neighbors' new positions (obstBallToBall / obstPillarToPillar), neighbors in index order */
+	void resolve_balls(const cxVec* pNewPos, const cxVec* pOldPos, const float* pRadius, int num, cxVec* pAdjPos, TSK_BRIGADE* pBgd = nullptr, float reflectFactor = 0.5f, float margin = c_obstSepMargin);
+	void resolve_pillars(const cxVec* pNewPos, const cxVec* pOldPos, const float* pRadius, const float* pHeight, int num, cxVec* pAdjPos, TSK_BRIGADE* pBgd = nullptr, float reflectFactor = 0.5f, float margin = c_obstSepMargin);
+};
+
+/* checks cObstGrid pairs against all pairs for 1k..50k agents and times the builds */
+void obstGridBench(TSK_BRIGADE* pBgd = nullptr, FILE* pOut = nullptr);
+
+#define OBST_GND_TILE_SHIFT 3
+#define OBST_GND_TILE_SIZE (1 << OBST_GND_TILE_SHIFT)
+
+/* Heightfield sampled from static ground geometry, stored in OBST_GND_TILE_SIZE^2 sample tiles.
+   A cell answers with bilinear filtering when its corners see a single walkable surface and the estimate
+   at its center and edge midpoints is within tolerance of the ray result; other cells (overhangs, holes,
+   steep or creased ground) fall back to obstGround. */
+class cObstGroundCache {
+protected:
+	const sxGeometryData* mpGeo;
+	float* mpHeights;
+	int32_t* mpCellPolIds; /* polygon under the cell center, -1: not cached */
+	float mOrgX;
+	float mOrgZ;
+	float mCellSize;
+	float mInvCellSize;
+	float mSlopeLim;
+	int mCellsX;
+	int mCellsZ;
+	int mTilesX;
+	int mCachedNum;
+
+	int calc_sample_idx(int ix, int iz) const {
+		int tile = (iz >> OBST_GND_TILE_SHIFT) * mTilesX + (ix >> OBST_GND_TILE_SHIFT);
+		int mask = OBST_GND_TILE_SIZE - 1;
+		return (tile << (OBST_GND_TILE_SHIFT * 2)) + ((iz & mask) << OBST_GND_TILE_SHIFT) + (ix & mask);
+	}
+
+	/* true if the vertical line through (x, z) crosses a single surface and it is walkable */
+	bool column_hit(float x, float z, float* pHeight, int* pPolId) const;
+
+public:
+	cObstGroundCache()
+	: mpGeo(nullptr), mpHeights(nullptr), mpCellPolIds(nullptr), mOrgX(0.0f), mOrgZ(0.0f), mCellSize(0.0f), mInvCellSize(0.0f),
+	mSlopeLim(0.0f), mCellsX(0), mCellsZ(0), mTilesX(0), mCachedNum(0) {}
+
+	~cObstGroundCache() { reset(); }
+
+	bool init(const sxGeometryData& geo, float cellSize = 0.5f, float slopeLim = 0.5f, float tolerance = 1e-2f);
+	void reset();
+
+	const sxGeometryData* get_geo() const { return mpGeo; }
+	float get_slope_lim() const { return mSlopeLim; }
+	int get_cells_num() const { return mCellsX * mCellsZ; }
+	int get_cached_num() const { return mCachedNum; }
+	bool is_cached(const cxVec& pos) const;
+
+	/* same contract as obstGround, the polygon id of a cached answer is the one under the cell center */
+	int query(const cxVec& pos, cxVec* pPos, cxVec* pNrm, float offsUp = 0.5f, float offsDown = 1.5f) const;
+};
+
+/* checks obstGroundBatch with and without cObstGroundCache against obstGround and times them */
+void obstGroundBench(const sxGeometryData& geo, FILE* pOut = nullptr, int num = 20000);
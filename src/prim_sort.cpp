@@ -0,0 +1,331 @@
+#include "crossdata.hpp"
+#include "timer.hpp"
+#include "key_sort.hpp"
+#include "prim_sort.hpp"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#	define PRIM_SORT_SSE 1
+#	include <emmintrin.h>
+#else
+#	define PRIM_SORT_SSE 0
+#endif
+
+bool cPrimSorter::init(int ntri, int nvtx) {
+	reset();
+	if (ntri <= 0 || nvtx <= 0) return false;
+	mpVtxDist = (float*)nxCore::mem_alloc(nvtx * sizeof(float), XD_FOURCC('P', 's', 'V', 'D'));
+	mpOrder = (uint32_t*)nxCore::mem_alloc(ntri * sizeof(uint32_t), XD_FOURCC('P', 's', 'O', 'r'));
+	mpKeys = (sSortKey*)nxCore::mem_alloc(ntri * 2 * sizeof(sSortKey), XD_FOURCC('P', 's', 'K', 'y'));
+	if (!mpVtxDist || !mpOrder || !mpKeys) {
+		reset();
+		return false;
+	}
+	mTriNum = ntri;
+	mVtxNum = nvtx;
+	mOrderValid = false;
+	return true;
+}
+
+void cPrimSorter::reset() {
+	nxCore::mem_free(mpVtxDist);
+	mpVtxDist = nullptr;
+	nxCore::mem_free(mpOrder);
+	mpOrder = nullptr;
+	nxCore::mem_free(mpKeys);
+	mpKeys = nullptr;
+	mTriNum = 0;
+	mVtxNum = 0;
+	mOrderValid = false;
+}
+
+/*static*/ uint32_t cPrimSorter::float_key(float val, bool descending) {
+	uint32_t bits;
+	::memcpy(&bits, &val, sizeof(bits));
+	uint32_t mask = (uint32_t)(-(int32_t)(bits >> 31)) | 0x80000000U;
+	uint32_t key = bits ^ mask;
+	return descending ? ~key : key;
+}
+
+void cPrimSorter::calc_vtx_dist(const cxVec* pPnts, const xt_float4& plane) {
+	int n = mVtxNum;
+	float* pDist = mpVtxDist;
+	int i = 0;
+#if PRIM_SORT_SSE
+	/* 4 points are 12 floats: 3 loads, transposed to xxxx/yyyy/zzzz */
+	__m128 nx = _mm_set1_ps(plane.x);
+	__m128 ny = _mm_set1_ps(plane.y);
+	__m128 nz = _mm_set1_ps(plane.z);
+	__m128 nw = _mm_set1_ps(plane.w);
+	for (; i + 4 <= n; i += 4) {
+		const float* pSrc = &pPnts[i].x;
+		__m128 p0 = _mm_loadu_ps(pSrc);
+		__m128 p1 = _mm_loadu_ps(pSrc + 4);
+		__m128 p2 = _mm_loadu_ps(pSrc + 8);
+		__m128 x = _mm_shuffle_ps(_mm_shuffle_ps(p0, p0, _MM_SHUFFLE(3, 3, 0, 0)), _mm_shuffle_ps(p1, p2, _MM_SHUFFLE(1, 1, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 y = _mm_shuffle_ps(_mm_shuffle_ps(p0, p1, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(p1, p2, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 z = _mm_shuffle_ps(_mm_shuffle_ps(p0, p1, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(p2, p2, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+		__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, nx), _mm_mul_ps(y, ny)), _mm_mul_ps(z, nz));
+		_mm_storeu_ps(&pDist[i], _mm_add_ps(d, nw));
+	}
+#endif
+	for (; i < n; ++i) {
+		const cxVec& p = pPnts[i];
+		pDist[i] = p.x*plane.x + p.y*plane.y + p.z*plane.z + plane.w;
+	}
+}
+
+float cPrimSorter::get_tri_dist(const uint16_t* pIdx16, const uint32_t* pIdx32, int itri, eDepth depth) const {
+	float d[3];
+	if (pIdx16) {
+		const uint16_t* pTri = &pIdx16[itri * 3];
+		for (int j = 0; j < 3; ++j) {
+			d[j] = mpVtxDist[pTri[j]];
+		}
+	} else {
+		const uint32_t* pTri = &pIdx32[itri * 3];
+		for (int j = 0; j < 3; ++j) {
+			d[j] = mpVtxDist[pTri[j]];
+		}
+	}
+	float dist;
+	switch (depth) {
+		case eDepth::NEAR_PNT:
+		default:
+			dist = nxCalc::min(d[0], d[1], d[2]);
+			break;
+		case eDepth::CENTER:
+			dist = (d[0] + d[1] + d[2]) * (1.0f / 3.0f);
+			break;
+		case eDepth::FAR_PNT:
+			dist = nxCalc::max(d[0], d[1], d[2]);
+			break;
+	}
+	return dist;
+}
+
+cPrimSorter::eResult cPrimSorter::sort(const cxVec* pPnts, const uint16_t* pIdx16, const uint32_t* pIdx32, const xt_wmtx* pMtx,
+                                       const cxVec& viewPos, const cxVec& viewDir, eDepth depth, bool backToFront) {
+	if (!pPnts || !(pIdx16 || pIdx32) || !mpOrder) return eResult::NONE;
+	/* view distance dot(dir, M*p - pos) as a plane in the space of pPnts */
+	xt_float4 plane;
+	if (pMtx) {
+		const float (*m)[4] = pMtx->m;
+		plane.x = viewDir.x*m[0][0] + viewDir.y*m[1][0] + viewDir.z*m[2][0];
+		plane.y = viewDir.x*m[0][1] + viewDir.y*m[1][1] + viewDir.z*m[2][1];
+		plane.z = viewDir.x*m[0][2] + viewDir.y*m[1][2] + viewDir.z*m[2][2];
+		plane.w = viewDir.x*m[0][3] + viewDir.y*m[1][3] + viewDir.z*m[2][3] - viewDir.dot(viewPos);
+	} else {
+		plane.set(viewDir.x, viewDir.y, viewDir.z, -viewDir.dot(viewPos));
+	}
+	calc_vtx_dist(pPnts, plane);
+
+	int n = mTriNum;
+	bool prevFlg = mOrderValid;
+	if (!prevFlg) {
+		for (int i = 0; i < n; ++i) {
+			mpOrder[i] = i;
+		}
+		mOrderValid = true;
+	}
+	sSortKey* pKeys = mpKeys;
+	bool orderedFlg = true;
+	uint32_t prevKey = 0;
+	for (int i = 0; i < n; ++i) {
+		uint32_t itri = mpOrder[i];
+		uint32_t key = float_key(get_tri_dist(pIdx16, pIdx32, itri, depth), backToFront);
+		pKeys[i].mKey = key;
+		pKeys[i].mIdx = itri;
+		if (key < prevKey) {
+			orderedFlg = false;
+		}
+		prevKey = key;
+	}
+	if (prevFlg && orderedFlg) return eResult::KEPT;
+
+	eResult res = eResult::RADIX;
+	if (prevFlg) {
+		/* small view changes move few triangles a short way, give up once the moves exceed the list size */
+		int moves = 0;
+		bool doneFlg = true;
+		for (int i = 1; i < n; ++i) {
+			sSortKey cur = pKeys[i];
+			int j = i;
+			while (j > 0 && pKeys[j - 1].mKey > cur.mKey && moves < n) {
+				pKeys[j] = pKeys[j - 1];
+				--j;
+				++moves;
+			}
+			pKeys[j] = cur;
+			if (moves >= n) {
+				doneFlg = false;
+				break;
+			}
+		}
+		if (doneFlg) {
+			res = eResult::INSERTION;
+		}
+	}
+	if (res == eResult::RADIX) {
+		/* the partial insertion pass is stable too, so the result is the same */
+		key_sort(pKeys, pKeys + n, n);
+	}
+	for (int i = 0; i < n; ++i) {
+		mpOrder[i] = pKeys[i].mIdx;
+	}
+	return res;
+}
+
+
+static int prim_sort_bench_cmp(const void* pA, const void* pB) {
+	const sSortKey* pKey1 = (const sSortKey*)pA;
+	const sSortKey* pKey2 = (const sSortKey*)pB;
+	if (pKey1->mKey > pKey2->mKey) return 1;
+	if (pKey1->mKey < pKey2->mKey) return -1;
+	/* mIdx is the position in the previous order: stable with respect to it */
+	if (pKey1->mIdx > pKey2->mIdx) return 1;
+	if (pKey1->mIdx < pKey2->mIdx) return -1;
+	return 0;
+}
+
+/* scalar depths, then the previous order stably sorted by them (qsort with a position tie-break) */
+static void prim_sort_bench_ref(const cxVec* pPnts, const uint32_t* pIdx, int ntri, int nvtx, const xt_wmtx* pMtx,
+                                const cxVec& viewPos, const cxVec& viewDir, cPrimSorter::eDepth depth, bool backToFront,
+                                uint32_t* pOrder, float* pDist, sSortKey* pKeys) {
+	/* same plane as sort(), so the distances are bit-exact and only the ordering is checked */
+	xt_float4 plane;
+	if (pMtx) {
+		const float (*m)[4] = pMtx->m;
+		plane.x = viewDir.x*m[0][0] + viewDir.y*m[1][0] + viewDir.z*m[2][0];
+		plane.y = viewDir.x*m[0][1] + viewDir.y*m[1][1] + viewDir.z*m[2][1];
+		plane.z = viewDir.x*m[0][2] + viewDir.y*m[1][2] + viewDir.z*m[2][2];
+		plane.w = viewDir.x*m[0][3] + viewDir.y*m[1][3] + viewDir.z*m[2][3] - viewDir.dot(viewPos);
+	} else {
+		plane.set(viewDir.x, viewDir.y, viewDir.z, -viewDir.dot(viewPos));
+	}
+	for (int i = 0; i < nvtx; ++i) {
+		const cxVec& p = pPnts[i];
+		pDist[i] = p.x*plane.x + p.y*plane.y + p.z*plane.z + plane.w;
+	}
+	for (int i = 0; i < ntri; ++i) {
+		uint32_t itri = pOrder[i];
+		float d0 = pDist[pIdx[itri*3]];
+		float d1 = pDist[pIdx[itri*3 + 1]];
+		float d2 = pDist[pIdx[itri*3 + 2]];
+		float d;
+		switch (depth) {
+			case cPrimSorter::eDepth::NEAR_PNT:
+			default:
+				d = nxCalc::min(d0, d1, d2);
+				break;
+			case cPrimSorter::eDepth::CENTER:
+				d = (d0 + d1 + d2) * (1.0f / 3.0f);
+				break;
+			case cPrimSorter::eDepth::FAR_PNT:
+				d = nxCalc::max(d0, d1, d2);
+				break;
+		}
+		pKeys[i].mKey = cPrimSorter::float_key(d, backToFront);
+		pKeys[i].mIdx = i;
+	}
+	::qsort(pKeys, ntri, sizeof(sSortKey), prim_sort_bench_cmp);
+	for (int i = 0; i < ntri; ++i) {
+		pKeys[i].mIdx = pOrder[pKeys[i].mIdx];
+	}
+	for (int i = 0; i < ntri; ++i) {
+		pOrder[i] = pKeys[i].mIdx;
+	}
+}
+
+void prim_sort_bench(FILE* pOut) {
+	if (!pOut) {
+		pOut = stdout;
+	}
+	const int nvtx = 20000;
+	const int ntri = 40000;
+	const int nframes = 40;
+	cxVec* pPnts = (cxVec*)nxCore::mem_alloc(nvtx * sizeof(cxVec), XD_TMP_MEM_TAG);
+	uint32_t* pIdx32 = (uint32_t*)nxCore::mem_alloc(ntri * 3 * sizeof(uint32_t), XD_TMP_MEM_TAG);
+	uint16_t* pIdx16 = (uint16_t*)nxCore::mem_alloc(ntri * 3 * sizeof(uint16_t), XD_TMP_MEM_TAG);
+	uint32_t* pOrder = (uint32_t*)nxCore::mem_alloc(ntri * sizeof(uint32_t), XD_TMP_MEM_TAG);
+	float* pDist = (float*)nxCore::mem_alloc(nvtx * sizeof(float), XD_TMP_MEM_TAG);
+	sSortKey* pKeys = (sSortKey*)nxCore::mem_alloc(ntri * sizeof(sSortKey), XD_TMP_MEM_TAG);
+	cPrimSorter sorter;
+	if (pPnts && pIdx32 && pIdx16 && pOrder && pDist && pKeys && sorter.init(ntri, nvtx)) {
+		sxRNG rng;
+		nxCore::rng_seed(&rng, 3);
+		for (int i = 0; i < nvtx; ++i) {
+			pPnts[i].set(nxCore::rng_f01(&rng) * 10.0f - 5.0f, nxCore::rng_f01(&rng) * 10.0f - 5.0f, nxCore::rng_f01(&rng) * 10.0f - 5.0f);
+		}
+		for (int i = 0; i < ntri * 3; ++i) {
+			pIdx32[i] = nxCore::rng_next(&rng) % nvtx;
+			pIdx16[i] = (uint16_t)pIdx32[i];
+		}
+		xt_wmtx wm = nxMtx::wmtx_from_deg_pos(10.0f, 20.0f, 30.0f, cxVec(1.0f, 2.0f, 3.0f));
+		int nerr = 0;
+		int nres[4] = { 0, 0, 0, 0 };
+		for (int cfg = 0; cfg < 2 * 3 * 2 * 2; ++cfg) {
+			bool mtxFlg = !!(cfg & 1);
+			bool idx16Flg = !!(cfg & 2);
+			bool backToFront = !!(cfg & 4);
+			cPrimSorter::eDepth depth = (cPrimSorter::eDepth)(cfg >> 3);
+			sorter.invalidate();
+			for (int i = 0; i < ntri; ++i) {
+				pOrder[i] = i;
+			}
+			for (int f = 0; f < nframes; ++f) {
+				/* still, then small moves (insertion), then jumps (radix) */
+				float ang = f < 10 ? 0.0f : (f < 20 ? f * 2e-5f : (f < 30 ? f * 2e-3f : f * 0.3f));
+				cxVec pos(20.0f * ::cosf(ang), 3.0f, 20.0f * ::sinf(ang));
+				cxVec dir = pos.neg_val().get_normalized();
+				cPrimSorter::eResult res = sorter.sort(pPnts, idx16Flg ? pIdx16 : nullptr, idx16Flg ? nullptr : pIdx32, mtxFlg ? &wm : nullptr,
+				                                       pos, dir, depth, backToFront);
+				++nres[(int)res];
+				prim_sort_bench_ref(pPnts, pIdx32, ntri, nvtx, mtxFlg ? &wm : nullptr, pos, dir, depth, backToFront, pOrder, pDist, pKeys);
+				const uint32_t* pSorted = sorter.get_order();
+				if (!pSorted || ::memcmp(pSorted, pOrder, ntri * sizeof(uint32_t)) != 0) ++nerr;
+			}
+		}
+		/* every path must have been taken */
+		if (!nres[(int)cPrimSorter::eResult::KEPT] || !nres[(int)cPrimSorter::eResult::INSERTION] || !nres[(int)cPrimSorter::eResult::RADIX]) ++nerr;
+		::fprintf(pOut, "prim sort, %d tris: kept %d, insertion %d, radix %d sorts vs stable reference%s\n",
+		          ntri, nres[(int)cPrimSorter::eResult::KEPT], nres[(int)cPrimSorter::eResult::INSERTION], nres[(int)cPrimSorter::eResult::RADIX],
+		          nerr ? " MISMATCH" : "");
+
+		double tref = 0.0;
+		double tsml = 0.0;
+		double tbig = 0.0;
+		const int nrep = 100;
+		sorter.invalidate();
+		for (int i = 0; i < nrep; ++i) {
+			float ang = i * 2e-5f;
+			cxVec pos(20.0f * ::cosf(ang), 3.0f, 20.0f * ::sinf(ang));
+			cxVec dir = pos.neg_val().get_normalized();
+			for (int j = 0; j < ntri; ++j) {
+				pOrder[j] = j;
+			}
+			double t0 = time_micros();
+			prim_sort_bench_ref(pPnts, pIdx32, ntri, nvtx, nullptr, pos, dir, cPrimSorter::eDepth::CENTER, true, pOrder, pDist, pKeys);
+			tref += time_micros() - t0;
+			t0 = time_micros();
+			sorter.sort(pPnts, nullptr, pIdx32, nullptr, pos, dir, cPrimSorter::eDepth::CENTER, true);
+			tsml += time_micros() - t0;
+		}
+		for (int i = 0; i < nrep; ++i) {
+			float ang = i * 0.7f;
+			cxVec pos(20.0f * ::cosf(ang), 3.0f, 20.0f * ::sinf(ang));
+			cxVec dir = pos.neg_val().get_normalized();
+			double t0 = time_micros();
+			sorter.sort(pPnts, nullptr, pIdx32, nullptr, pos, dir, cPrimSorter::eDepth::CENTER, true);
+			tbig += time_micros() - t0;
+		}
+		::fprintf(pOut, " per sort (ms): qsort reference %.3f, coherent view %.3f, view jumps %.3f\n",
+		          tref / nrep / 1000.0, tsml / nrep / 1000.0, tbig / nrep / 1000.0);
+	}
+	sorter.reset();
+	nxCore::mem_free(pPnts);
+	nxCore::mem_free(pIdx32);
+	nxCore::mem_free(pIdx16);
+	nxCore::mem_free(pOrder);
+	nxCore::mem_free(pDist);
+	nxCore::mem_free(pKeys);
+}
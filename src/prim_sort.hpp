@@ -0,0 +1,56 @@
+struct sSortKey;
+
+/* Per-batch triangle depth ordering for sorted (transparent) batches.
+   Depth is the view distance of a triangle's nearest vertex, centroid or farthest vertex,
+   computed from per-vertex distances to the view plane (SSE when available).
+   Each call re-sorts starting from the previous order: an already ordered list is kept as is,
+   small changes are fixed by insertion sort and anything else goes to the radix sort,
+   the result is always the stable sort of the previous order by depth.
+   The all-zero state equals the reset state, so the sorter can live in zero-allocated structs. */
+class cPrimSorter {
+public:
+	enum class eDepth {
+		NEAR_PNT,
+		CENTER,
+		FAR_PNT
+	};
+
+	enum class eResult {
+		NONE,
+		KEPT,
+		INSERTION,
+		RADIX
+	};
+
+protected:
+	float* mpVtxDist;
+	uint32_t* mpOrder;
+	sSortKey* mpKeys; /* keys + radix sort work */
+	int mTriNum;
+	int mVtxNum;
+	bool mOrderValid;
+
+	void calc_vtx_dist(const cxVec* pPnts, const xt_float4& plane);
+	float get_tri_dist(const uint16_t* pIdx16, const uint32_t* pIdx32, int itri, eDepth depth) const;
+
+public:
+	cPrimSorter() : mpVtxDist(nullptr), mpOrder(nullptr), mpKeys(nullptr), mTriNum(0), mVtxNum(0), mOrderValid(false) {}
+	~cPrimSorter() { reset(); }
+
+	bool init(int ntri, int nvtx);
+	void reset();
+
+	/* pIdx16 or pIdx32 index pPnts[0, nvtx), pMtx (optional) takes pPnts to the space of viewPos/viewDir */
+	eResult sort(const cxVec* pPnts, const uint16_t* pIdx16, const uint32_t* pIdx32, const xt_wmtx* pMtx,
+	             const cxVec& viewPos, const cxVec& viewDir, eDepth depth, bool backToFront);
+	/* forgets the previous order, the next sort starts from the source triangle order */
+	void invalidate() { mOrderValid = false; }
+
+	int get_tri_num() const { return mTriNum; }
+	const uint32_t* get_order() const { return mOrderValid ? mpOrder : nullptr; }
+
+	static uint32_t float_key(float val, bool descending);
+};
+
+/* KEPT/INSERTION/RADIX results against the stable sort of the previous order, and per-sort times */
+void prim_sort_bench(FILE* pOut = nullptr);
@@ -150,6 +150,8 @@ TSK_WORKER* tskWorkerCreate(TSK_WRK_FUNC func, void* pData) {
 		pWrk->mhThread = ::CreateThread(NULL, 0, winWrkEntry, pWrk, CREATE_SUSPENDED, &pWrk->mTID);
 		if (pWrk->mhThread) {
 			::ResumeThread(pWrk->mhThread);
+			/* the thread signals done once running: take that here, not as the end of the first exec */
+			tskSignalWait(pWrk->mpSigDone);
 		}
 	}
 	return pWrk;
@@ -181,7 +183,7 @@ void tskWorkerStop(TSK_WORKER* pWrk) {
 	if (pWrk && !pWrk->mEndFlg) {
 		pWrk->mEndFlg = true;
 		tskWorkerExec(pWrk);
-		tskWorkerWait(pWrk);
+		/* a worker between its done signal and the loop check exits without another one, only the join is reliable */
 		::WaitForSingleObject(pWrk->mhThread, INFINITE);
 		::CloseHandle(pWrk->mhThread);
 	}
@@ -339,6 +341,8 @@ TSK_WORKER* tskWorkerCreate(TSK_WRK_FUNC func, void* pData) {
 		pWrk->mpSigDone = tskSignalCreate();
 		pWrk->mEndFlg = false;
 		::new ((void*)&pWrk->mThread) thread(workerFunc, pWrk);
+		/* the thread signals done once running: take that here, not as the end of the first exec */
+		tskSignalWait(pWrk->mpSigDone);
 	}
 	return pWrk;
 }
@@ -370,7 +374,7 @@ void tskWorkerStop(TSK_WORKER* pWrk) {
 	if (pWrk && !pWrk->mEndFlg) {
 		pWrk->mEndFlg = true;
 		tskWorkerExec(pWrk);
-		tskWorkerWait(pWrk);
+		/* a worker between its done signal and the loop check exits without another one, only the join is reliable */
 		pWrk->mThread.join();
 	}
 }
@@ -7,6 +7,7 @@
 #include "util.hpp"
 #include "test.hpp"
 
+#include "anim_lod.hpp"
 #include "test3_chr.hpp"
 #include "test3_stg.hpp"
 
@@ -20,6 +21,7 @@
 static struct TEST3_WK {
 	cCharacter3 chr;
 	cStage3 stg;
+	cAnimLODScheduler animLOD;
 	GEX_CAM* pCam;
 	GEX_LIT* pLit;
 	GEX_LIT* pConstLit;
@@ -67,6 +69,8 @@ void test3_init() {
 
 	WK.chr.create();
 	WK.stg.create();
+	WK.animLOD.init(1);
+	WK.animLOD.add(WK.chr.get_anim_lod());
 	WK.pCam = gexCamCreate("test3_cam");
 
 	WK.pLit = gexLitCreate("test3_lit");
@@ -379,6 +383,8 @@ void test3_loop() {
 		pLit = WK.pConstLit;
 	}
 
+	WK.chr.set_view_dist(gexCalcViewDist(pCam, WK.chr.get_world_pos()));
+	WK.animLOD.exec();
 	WK.chr.update();
 	cam_ctrl();
 	WK.stg.update();
@@ -399,6 +405,7 @@ void test3_loop() {
 }
 
 void test3_end() {
+	WK.animLOD.reset();
 	WK.chr.destroy();
 	WK.stg.destroy();
 	gexLitDestroy(WK.pConstLit);
@@ -5,6 +5,7 @@
 #include "task.hpp"
 #include "util.hpp"
 #include "obstacle.hpp"
+#include "anim_lod.hpp"
 
 #include "test3_chr.hpp"
 
@@ -113,6 +114,13 @@ void cCharacter3::create() {
 		nxCore::mem_free(pRestIW);
 	}
 
+	mAnimLODRig.init(*mpRig);
+	mAnimLODRig.lock_node(mMovementNodeId);
+	mAnimLODRig.lock_node("j_Head");
+	mAnimLOD.alloc(nnodes);
+	mAnimLODMotId = -1;
+	mpMotEvalLst = (int16_t*)nxCore::mem_alloc(nnodes * sizeof(int16_t), XD_FOURCC('M', 'E', 'L', 's'));
+
 	mpMotEvalJobs = tskJobsAlloc(nnodes);
 	mpMotEvalQueue = tskQueueCreate(nnodes);
 	if (mpMotEvalJobs) {
@@ -169,6 +177,10 @@ void cCharacter3::destroy() {
 	mpMotEvalQueue = nullptr;
 	tskJobsFree(mpMotEvalJobs);
 	mpMotEvalJobs = nullptr;
+	nxCore::mem_free(mpMotEvalLst);
+	mpMotEvalLst = nullptr;
+	mAnimLOD.free();
+	mAnimLODRig.free();
 	mInitFlg = false;
 }
 
@@ -206,21 +218,21 @@ void cCharacter3::calc_blend() {
 	if (!pLink) return;
 	sxKeyframesData* pKfr = pSelf->mpMotEvalKfr;
 	if (!pKfr) return;
-	pKfr->eval_rig_link_node(pLink, pJob->mId, pSelf->mMotEvalFrame, pSelf->mpRig, pSelf->mpRigMtxL);
+	int nodeIdx = pSelf->mpMotEvalLst ? pSelf->mpMotEvalLst[pJob->mId] : pJob->mId;
+	pKfr->eval_rig_link_node(pLink, nodeIdx, pSelf->mMotEvalFrame, pSelf->mpRig, pSelf->mpRigMtxL);
 }
 
-float cCharacter3::calc_motion(int motId, float frame, float frameStep) {
-	if (!mInitFlg) return frame;
-	sxKeyframesData* pKfr = mMotLib.get_keyframes(motId);
-	if (!pKfr) return frame;
-	sxKeyframesData::RigLink* pLink = mMotLib.get_riglink(motId);
-	if (!pLink) return frame;
+void cCharacter3::mot_eval(sxKeyframesData* pKfr, sxKeyframesData::RigLink* pLink, float frame, int skipHgt) {
 	mpMotEvalKfr = pKfr;
 	mpMotEvalLink = pLink;
 	mMotEvalFrame = frame;
+	int njobs = pLink->mNodeNum;
+	if (mpMotEvalLst) {
+		njobs = mAnimLODRig.make_link_list(*pLink, skipHgt, mpMotEvalLst);
+	}
+	mAnimLOD.mCost = njobs;
 	TSK_BRIGADE* pBgd = get_brigade();
 	bool tskFlg = pBgd && mpMotEvalJobs && mpMotEvalQueue;
-	int njobs = pLink->mNodeNum;
 	int nwrk = tskBrigadeGetNumWorkers(pBgd);
 	if (tskFlg) {
 		if (nwrk > 3) {
@@ -229,14 +241,41 @@ float cCharacter3::calc_motion(int motId, float frame, float frameStep) {
 		tskBrigadeSetActiveWorkers(pBgd, nwrk);
 		tskQueueAdjust(mpMotEvalQueue, njobs);
 		tskBrigadeExec(pBgd, mpMotEvalQueue);
+		tskBrigadeWait(pBgd);
+	} else if (mpMotEvalLst) {
+		for (int i = 0; i < njobs; ++i) {
+			pKfr->eval_rig_link_node(pLink, mpMotEvalLst[i], frame, mpRig, mpRigMtxL);
+		}
 	} else {
 		pKfr->eval_rig_link(pLink, frame, mpRig, mpRigMtxL);
 	}
 
+	if (0 && pBgd) {
+		::printf("%d/%d -> ", njobs, nwrk);
+		int nwrk = tskBrigadeGetNumActiveWorkers(pBgd);
+		for (int i = 0; i < nwrk; ++i) {
+			TSK_CONTEXT* pCtx = tskBrigadeGetContext(pBgd, i);
+			::printf("%d:%d ", i, pCtx->mJobsDone);
+		}
+		::printf("\n");
+	}
+}
+
+int cCharacter3::mot_eval_lod_func(void* pData, float frame, int skipHgt) {
+	cCharacter3* pSelf = (cCharacter3*)pData;
+	pSelf->mot_eval(pSelf->mpMotEvalKfr, pSelf->mpMotEvalLink, frame, skipHgt);
+	return pSelf->mAnimLOD.mCost;
+}
+
+float cCharacter3::calc_motion(int motId, float frame, float frameStep, bool loop) {
+	if (!mInitFlg) return frame;
+	sxKeyframesData* pKfr = mMotLib.get_keyframes(motId);
+	if (!pKfr) return frame;
+	sxKeyframesData::RigLink* pLink = mMotLib.get_riglink(motId);
+	if (!pLink) return frame;
+
 	int moveGrpId = -1;
 	sxKeyframesData::RigLink::Val* pMoveVal = nullptr;
-	cxVec prevPos;
-	float prevFrame = nxCalc::max(frame - frameStep, 0.0f);
 	if (mpRig->ck_node_idx(mMovementNodeId)) {
 		mMotVelFrame = frame;
 		int16_t* pMotToRig = pLink->get_rig_map();
@@ -244,23 +283,37 @@ float cCharacter3::calc_motion(int motId, float frame, float frameStep) {
 			moveGrpId = pMotToRig[mMovementNodeId];
 			if (moveGrpId >= 0) {
 				pMoveVal = pLink->mNodes[moveGrpId].get_pos_val();
-				if (frame > 0.0f) {
-					for (int i = 0; i < 3; ++i) {
-						sxKeyframesData::FCurve fcv = pKfr->get_fcv(pMoveVal->fcvId[i]);
-						prevPos.set_at(i, fcv.is_valid() ? fcv.eval(prevFrame) : 0.0f);
-					}
-				}
 			}
 		}
 	}
 
-	if (tskFlg) {
-		tskBrigadeWait(pBgd);
+	bool lodFlg = frameStep > 0.0f && mAnimLOD.mNodesNum > 0;
+	if (lodFlg) {
+		if (motId != mAnimLODMotId) {
+			mAnimLOD.invalidate();
+			mAnimLODMotId = motId;
+		}
+		mpMotEvalKfr = pKfr;
+		mpMotEvalLink = pLink;
+		mAnimLOD.update(frame, frameStep, (float)pKfr->get_max_fno(), loop, mot_eval_lod_func, this, mpRigMtxL);
+		if (moveGrpId >= 0) {
+			pKfr->eval_rig_link_node(pLink, moveGrpId, frame, mpRig, mpRigMtxL);
+		}
+		mAnimLOD.interpolate(mpRigMtxL);
+		mAnimLOD.advance();
+	} else {
+		mot_eval(pKfr, pLink, frame, 0);
 	}
 
 	if (pMoveVal) {
 		cxVec vel = pMoveVal->get_vec();
 		if (frame > 0.0f) {
+			cxVec prevPos;
+			float prevFrame = nxCalc::max(frame - frameStep, 0.0f);
+			for (int i = 0; i < 3; ++i) {
+				sxKeyframesData::FCurve fcv = pKfr->get_fcv(pMoveVal->fcvId[i]);
+				prevPos.set_at(i, fcv.is_valid() ? fcv.eval(prevFrame) : 0.0f);
+			}
 			vel -= prevPos;
 		} else {
 			vel *= frameStep;
@@ -273,16 +326,6 @@ float cCharacter3::calc_motion(int motId, float frame, float frameStep) {
 		frame = 0.0f;
 	}
 
-	if (0 && pBgd) {
-		::printf("%d/%d -> ", njobs, nwrk);
-		int nwrk = tskBrigadeGetNumActiveWorkers(pBgd);
-		for (int i = 0; i < nwrk; ++i) {
-			TSK_CONTEXT* pCtx = tskBrigadeGetContext(pBgd, i);
-			::printf("%d:%d ", i, pCtx->mJobsDone);
-		}
-		::printf("\n");
-	}
-
 	return frame;
 }
 
@@ -475,7 +518,7 @@ void cCharacter3::dance_act_ctrl() {
 }
 
 void cCharacter3::dance_act_exec() {
-	mMotFrame = calc_motion(mStateParams[0], mMotFrame, get_anim_speed());
+	mMotFrame = calc_motion(mStateParams[0], mMotFrame, get_anim_speed(), false);
 	calc_blend();
 	calc_world();
 	if (mMotFrame == 0.0f) {
@@ -550,7 +593,7 @@ void cCharacter3::turn_ctrl() {
 }
 
 void cCharacter3::turn_exec() {
-	mMotFrame = calc_motion(mStateParams[0], mMotFrame, get_anim_speed());
+	mMotFrame = calc_motion(mStateParams[0], mMotFrame, get_anim_speed(), false);
 	update_coord();
 	calc_blend();
 	calc_world();
@@ -67,6 +67,11 @@ protected:
 	sxKeyframesData::RigLink* mpMotEvalLink;
 	sxKeyframesData* mpMotEvalKfr;
 	float mMotEvalFrame;
+	int16_t* mpMotEvalLst;
+
+	sAnimLODRig mAnimLODRig;
+	sAnimLODInst mAnimLOD;
+	int mAnimLODMotId;
 
 	bool mInitFlg;
 
@@ -79,7 +84,7 @@ protected:
 
 	void blend_init(int duration);
 	void calc_blend();
-	float calc_motion(int motId, float frame, float frameStep);
+	float calc_motion(int motId, float frame, float frameStep, bool loop = true);
 	void update_coord();
 	void calc_world();
 
@@ -110,6 +115,8 @@ protected:
 	bool prop_adj();
 
 	static void mot_node_eval_job(TSK_CONTEXT* pCtx);
+	void mot_eval(sxKeyframesData* pKfr, sxKeyframesData::RigLink* pLink, float frame, int skipHgt);
+	static int mot_eval_lod_func(void* pData, float frame, int skipHgt);
 
 public:
 	cCharacter3()
@@ -117,7 +124,8 @@ public:
 	mpObj(nullptr), mpTexB(nullptr), mpTexS(nullptr), mpTexN(nullptr), mpRig(nullptr),
 	mpRigMtxL(nullptr), mpRigMtxW(nullptr), mpObjMtxW(nullptr), mpBlendMtxL(nullptr), mpObjToRig(nullptr),
 	mSkinNodesNum(0), mRigNodesNum(0), mRootNodeId(-1), mMovementNodeId(-1),
-	mpMotEvalJobs(nullptr), mpMotEvalQueue(nullptr), mpMotEvalLink(nullptr), mpMotEvalKfr(nullptr), mMotEvalFrame(0.0f),
+	mpMotEvalJobs(nullptr), mpMotEvalQueue(nullptr), mpMotEvalLink(nullptr), mpMotEvalKfr(nullptr), mMotEvalFrame(0.0f), mpMotEvalLst(nullptr),
+	mAnimLODMotId(-1),
 	mStateMain(STATE::DANCE_LOOP), mStateSub(0),
 	mMotFrame(0.0f), mBlendDuration(0.0f), mBlendCount(0.0f), mMotVel(0.0f),
 	mPrevWorldPos(0.0f), mWorldPos(0.0f), mWorldRot(0.0f)
@@ -133,4 +141,7 @@ public:
 
 	cxMtx get_movement_mtx() const;
 	cxVec get_world_pos() const { return mWorldPos; }
+
+	sAnimLODInst* get_anim_lod() { return &mAnimLOD; }
+	void set_view_dist(float dist) { mAnimLOD.mDist = dist; }
 };
@@ -4,6 +4,7 @@
 #include "remote.hpp"
 #include "util.hpp"
 
+#include "anim_lod.hpp"
 #include "test3_chr.hpp"
 #include "test3_stg.hpp"
 
@@ -2,6 +2,7 @@
 
 #include "crossdata.hpp"
 #include "gex.hpp"
+#include "timer.hpp"
 
 #include "util.hpp"
 
@@ -1068,3 +1069,322 @@ void dump_riglink_info(sxKeyframesData* pKfr, sxKeyframesData::RigLink* pLink, F
 	}
 }
 
+void dump_geo_cache_stats(const char* pGeoPath, FILE* pOut, int cacheSize) {
+	if (!pOut) {
+		pOut = stdout;
+	}
+	sxData* pData = nxData::load(pGeoPath);
+	sxGeometryData* pGeo = pData ? pData->as<sxGeometryData>() : nullptr;
+	if (!pGeo) {
+		::fprintf(pOut, "%s: can't load geometry\n", pGeoPath);
+		nxData::unload(pData);
+		return;
+	}
+	static struct {
+		const char* pName;
+		uint32_t flags;
+	} modes[] = {
+		{ "source", 0 },
+		{ "vtx_cache", sxGeometryData::DisplayList::OPT_VTX_CACHE },
+		{ "overdraw", sxGeometryData::DisplayList::OPT_OVERDRAW },
+		{ "overdraw+fetch", sxGeometryData::DisplayList::OPT_OVERDRAW | sxGeometryData::DisplayList::OPT_VTX_FETCH }
+	};
+	::fprintf(pOut, "%s: %d points, %d polygons, cache %d\n", pGeoPath, pGeo->get_pnt_num(), pGeo->get_pol_num(), cacheSize);
+	for (int i = 0; i < XD_ARY_LEN(modes); ++i) {
+		double t0 = time_micros();
+		sxGeometryData::DisplayList* pLst = pGeo->create_display_list(nullptr, true, modes[i].flags);
+		double t1 = time_micros();
+		if (pLst) {
+			sxVtxCacheStats stats;
+			pLst->calc_cache_stats(&stats, cacheSize);
+			::fprintf(pOut, " %-16s batches %d, tris %d, ACMR %.3f, ATVR %.3f, build %.2f ms\n",
+			          modes[i].pName, pLst->get_bat_num(), stats.mTriNum, stats.get_ACMR(), stats.get_ATVR(), (t1 - t0) / 1000.0);
+			sxGeometryData::release_display_list(pLst);
+		}
+	}
+	nxData::unload(pData);
+}
+
+/* probes: vertical through the whole bbox, otherwise random directions, some with zero components */
+static void geo_bench_segs(const cxAABB& bbox, cxLineSeg* pSegs, int nseg, bool probes, uint64_t seed) {
+	sxRNG rng;
+	nxCore::rng_seed(&rng, seed);
+	cxVec bmin = bbox.get_min_pos();
+	cxVec bmax = bbox.get_max_pos();
+	cxVec size = bbox.get_size_vec();
+	float len = size.mag() * 0.05f;
+	for (int i = 0; i < nseg; ++i) {
+		cxVec p0 = bmin + size * cxVec(nxCore::rng_f01(&rng), nxCore::rng_f01(&rng), nxCore::rng_f01(&rng));
+		cxVec p1;
+		if (probes) {
+			p0.y = bmax.y + 1.0f;
+			p1 = p0;
+			p1.y = bmin.y - 1.0f;
+		} else {
+			cxVec dir(nxCore::rng_f01(&rng) - 0.5f, nxCore::rng_f01(&rng) - 0.5f, nxCore::rng_f01(&rng) - 0.5f);
+			if ((i % 13) == 0) dir.x = 0.0f;
+			if ((i % 17) == 0) dir.set(0.0f, 0.0f, 1.0f);
+			p1 = p0 + dir.get_normalized() * (len * nxCore::rng_f01(&rng));
+		}
+		pSegs[i].set(p0, p1);
+	}
+}
+
+static bool geo_bench_same_hit(const sxGeometryData::FlatBVH::NearestHit& ref, const sxGeometryData::FlatBVH::NearestHit& hit) {
+	if (ref.mPolId != hit.mPolId) return false;
+	if (!ref.is_hit()) return true;
+	return ref.mDist == hit.mDist && ::memcmp(&ref.mPos, &hit.mPos, sizeof(cxVec)) == 0 && ::memcmp(&ref.mNrm, &hit.mNrm, sizeof(cxVec)) == 0;
+}
+
+/* reference nearest hit straight from FlatBVH::hit_query */
+struct sGeoBenchNearest {
+	sxGeometryData::FlatBVH::NearestHit mHit;
+
+	void init(const cxLineSeg& seg) {
+		mHit.mPos = seg.get_pos0();
+		mHit.mNrm.zero();
+		mHit.mDist = 0.0f;
+		mHit.mPolId = -1;
+	}
+
+	bool operator()(const sxGeometryData::Polygon& pol, const cxVec& hitPos, const cxVec& hitNrm, float hitDist) {
+		if (mHit.mPolId < 0 || hitDist < mHit.mDist) {
+			mHit.mPos = hitPos;
+			mHit.mNrm = hitNrm;
+			mHit.mDist = hitDist;
+			mHit.mPolId = pol.get_id();
+		}
+		return true;
+	}
+};
+
+void geo_ray_packet_bench(const char* pGeoPath, FILE* pOut, int nseg) {
+	if (!pOut) {
+		pOut = stdout;
+	}
+	sxData* pData = nxData::load(pGeoPath);
+	sxGeometryData* pGeo = pData ? pData->as<sxGeometryData>() : nullptr;
+	if (!pGeo) {
+		::fprintf(pOut, "%s: can't load geometry\n", pGeoPath);
+		nxData::unload(pData);
+		return;
+	}
+	typedef sxGeometryData::FlatBVH::NearestHit NearestHit;
+	int nrep = 5;
+	if (!pGeo->has_BVH()) {
+		/* brute force, keep it short */
+		nseg = nxCalc::min(nseg, 500);
+		nrep = 1;
+	}
+	cxLineSeg* pSegs = (cxLineSeg*)nxCore::mem_alloc(nseg * sizeof(cxLineSeg), XD_TMP_MEM_TAG);
+	NearestHit* pRef = (NearestHit*)nxCore::mem_alloc(nseg * sizeof(NearestHit), XD_TMP_MEM_TAG);
+	NearestHit* pHits = (NearestHit*)nxCore::mem_alloc(nseg * sizeof(NearestHit), XD_TMP_MEM_TAG);
+	int32_t* pWk = (int32_t*)nxCore::mem_alloc(nseg * 2 * sizeof(int32_t), XD_TMP_MEM_TAG);
+	sxGeometryData::FlatBVH bvh;
+	bvh.create(*pGeo);
+	::fprintf(pOut, "%s: %d polygons, %s, %d segments (min of %d runs, Kseg/s):\n", pGeoPath, pGeo->get_pol_num(), pGeo->has_BVH() ? "BVH" : "no BVH", nseg, nrep);
+	if (pSegs && pRef && pHits && pWk) {
+		for (int mode = 0; mode < 2; ++mode) {
+			geo_bench_segs(pGeo->mBBox, pSegs, nseg, mode == 0, 1 + mode);
+			for (int i = 0; i < nseg; ++i) {
+				sGeoBenchNearest ref;
+				ref.init(pSegs[i]);
+				bvh.hit_query(pSegs[i], ref);
+				pRef[i] = ref.mHit;
+			}
+			double tone = 0.0;
+			double tstm = 0.0;
+			int nbad = 0;
+			for (int j = 0; j < nrep; ++j) {
+				double t0 = time_micros();
+				for (int i = 0; i < nseg; ++i) {
+					pHits[i] = bvh.nearest_hit(pSegs[i]);
+				}
+				double t = time_micros() - t0;
+				tone = j ? nxCalc::min(tone, t) : t;
+				for (int i = 0; i < nseg; ++i) {
+					nbad += geo_bench_same_hit(pRef[i], pHits[i]) ? 0 : 1;
+				}
+
+				t0 = time_micros();
+				bvh.nearest_hit_stream(pSegs, pHits, nseg, pWk);
+				t = time_micros() - t0;
+				tstm = j ? nxCalc::min(tstm, t) : t;
+				for (int i = 0; i < nseg; ++i) {
+					nbad += geo_bench_same_hit(pRef[i], pHits[i]) ? 0 : 1;
+				}
+			}
+			int nhit = 0;
+			for (int i = 0; i < nseg; ++i) {
+				nhit += pRef[i].is_hit() ? 1 : 0;
+			}
+			::fprintf(pOut, " %-10s hits %6d, single %8.1f, stream %8.1f%s\n", mode ? "incoherent" : "probes", nhit,
+			          nseg / tone * 1e3, nseg / tstm * 1e3, nbad ? " MISMATCH" : "");
+		}
+	}
+	bvh.destroy();
+	nxCore::mem_free(pSegs);
+	nxCore::mem_free(pRef);
+	nxCore::mem_free(pHits);
+	nxCore::mem_free(pWk);
+	nxData::unload(pData);
+}
+
+struct sGeoBenchIds : public sxGeometryData::HitFunc, public sxGeometryData::RangeFunc {
+	int32_t* mpIds;
+	int mNum;
+	int mMax;
+
+	void add(int id) {
+		if (mNum < mMax) {
+			mpIds[mNum] = id;
+		}
+		++mNum;
+	}
+
+	virtual bool operator()(const sxGeometryData::Polygon& pol, const cxVec& hitPos, const cxVec& hitNrm, float hitDist) {
+		add(pol.get_id());
+		return true;
+	}
+
+	virtual bool operator()(const sxGeometryData::Polygon& pol) {
+		add(pol.get_id());
+		return true;
+	}
+};
+
+static int geo_bench_id_cmp(const void* pA, const void* pB) {
+	int32_t a = *(const int32_t*)pA;
+	int32_t b = *(const int32_t*)pB;
+	return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+/* polygon id sets are compared sorted, the traversal order differs between the paths */
+static bool geo_bench_same_ids(sGeoBenchIds& ref, sGeoBenchIds& ids) {
+	if (ref.mNum != ids.mNum) return false;
+	int n = nxCalc::min(ref.mNum, ref.mMax);
+	::qsort(ref.mpIds, n, sizeof(int32_t), geo_bench_id_cmp);
+	::qsort(ids.mpIds, n, sizeof(int32_t), geo_bench_id_cmp);
+	return ::memcmp(ref.mpIds, ids.mpIds, n * sizeof(int32_t)) == 0;
+}
+
+void geo_bvh_query_bench(const char* pGeoPath, FILE* pOut, int nqry) {
+	if (!pOut) {
+		pOut = stdout;
+	}
+	sxData* pData = nxData::load(pGeoPath);
+	sxGeometryData* pGeo = pData ? pData->as<sxGeometryData>() : nullptr;
+	if (!pGeo) {
+		::fprintf(pOut, "%s: can't load geometry\n", pGeoPath);
+		nxData::unload(pData);
+		return;
+	}
+	if (!pGeo->has_BVH()) {
+		::fprintf(pOut, "%s: no BVH, nothing to compare\n", pGeoPath);
+		nxData::unload(pData);
+		return;
+	}
+	const int nrep = 5;
+	/* brute force reference only on the first queries */
+	int nchk = nxCalc::min(nqry, 500);
+	int npol = pGeo->get_pol_num();
+	cxLineSeg* pSegs = (cxLineSeg*)nxCore::mem_alloc(nqry * sizeof(cxLineSeg), XD_TMP_MEM_TAG);
+	cxAABB* pBoxes = (cxAABB*)nxCore::mem_alloc(nqry * sizeof(cxAABB), XD_TMP_MEM_TAG);
+	int32_t* pIdMem = (int32_t*)nxCore::mem_alloc(npol * 2 * sizeof(int32_t), XD_TMP_MEM_TAG);
+	sxGeometryData::FlatBVH bvh;
+	bvh.create(*pGeo);
+	::fprintf(pOut, "%s: %d polygons, %d flat nodes, %d queries (min of %d runs, Kq/s):\n", pGeoPath, npol, bvh.get_nodes_num(), nqry, nrep);
+	if (pSegs && pBoxes && pIdMem) {
+		sGeoBenchIds ref;
+		ref.mpIds = pIdMem;
+		ref.mMax = npol;
+		sGeoBenchIds ids;
+		ids.mpIds = pIdMem + npol;
+		ids.mMax = npol;
+		geo_bench_segs(pGeo->mBBox, pSegs, nqry, false, 3);
+		sxRNG rng;
+		nxCore::rng_seed(&rng, 4);
+		cxVec bmin = pGeo->mBBox.get_min_pos();
+		cxVec size = pGeo->mBBox.get_size_vec();
+		for (int i = 0; i < nqry; ++i) {
+			cxVec c = bmin + size * cxVec(nxCore::rng_f01(&rng), nxCore::rng_f01(&rng), nxCore::rng_f01(&rng));
+			cxVec r = size * (0.005f + nxCore::rng_f01(&rng) * 0.02f);
+			pBoxes[i].set(c - r, c + r);
+		}
+
+		int nbad = 0;
+		int nhit = 0;
+		int nrng = 0;
+		double thitRef = 0.0;
+		double trngRef = 0.0;
+		for (int i = 0; i < nchk; ++i) {
+			ref.mNum = 0;
+			double t0 = time_micros();
+			pGeo->hit_query_nobvh(pSegs[i], ref);
+			thitRef += time_micros() - t0;
+			nhit += ref.mNum;
+			ids.mNum = 0;
+			pGeo->hit_query(pSegs[i], ids);
+			nbad += geo_bench_same_ids(ref, ids) ? 0 : 1;
+			ids.mNum = 0;
+			bvh.hit_query(pSegs[i], ids);
+			nbad += geo_bench_same_ids(ref, ids) ? 0 : 1;
+
+			ref.mNum = 0;
+			t0 = time_micros();
+			pGeo->range_query_nobvh(pBoxes[i], ref);
+			trngRef += time_micros() - t0;
+			nrng += ref.mNum;
+			ids.mNum = 0;
+			pGeo->range_query(pBoxes[i], ids);
+			nbad += geo_bench_same_ids(ref, ids) ? 0 : 1;
+			ids.mNum = 0;
+			bvh.range_query(pBoxes[i], ids);
+			nbad += geo_bench_same_ids(ref, ids) ? 0 : 1;
+		}
+
+		double thit = 0.0;
+		double thitFlat = 0.0;
+		double trng = 0.0;
+		double trngFlat = 0.0;
+		for (int j = 0; j < nrep; ++j) {
+			double t0 = time_micros();
+			for (int i = 0; i < nqry; ++i) {
+				ids.mNum = 0;
+				pGeo->hit_query(pSegs[i], ids);
+			}
+			double t = time_micros() - t0;
+			thit = j ? nxCalc::min(thit, t) : t;
+			t0 = time_micros();
+			for (int i = 0; i < nqry; ++i) {
+				ids.mNum = 0;
+				bvh.hit_query(pSegs[i], ids);
+			}
+			t = time_micros() - t0;
+			thitFlat = j ? nxCalc::min(thitFlat, t) : t;
+			t0 = time_micros();
+			for (int i = 0; i < nqry; ++i) {
+				ids.mNum = 0;
+				pGeo->range_query(pBoxes[i], ids);
+			}
+			t = time_micros() - t0;
+			trng = j ? nxCalc::min(trng, t) : t;
+			t0 = time_micros();
+			for (int i = 0; i < nqry; ++i) {
+				ids.mNum = 0;
+				bvh.range_query(pBoxes[i], ids);
+			}
+			t = time_micros() - t0;
+			trngFlat = j ? nxCalc::min(trngFlat, t) : t;
+		}
+		::fprintf(pOut, " hit   %6d hits in %d checked, brute %8.1f, recursive %8.1f, flat %8.1f%s\n", nhit, nchk,
+		          nchk / thitRef * 1e3, nqry / thit * 1e3, nqry / thitFlat * 1e3, nbad ? " MISMATCH" : "");
+		::fprintf(pOut, " range %6d pols in %d checked, brute %8.1f, recursive %8.1f, flat %8.1f%s\n", nrng, nchk,
+		          nchk / trngRef * 1e3, nqry / trng * 1e3, nqry / trngFlat * 1e3, nbad ? " MISMATCH" : "");
+	}
+	bvh.destroy();
+	nxCore::mem_free(pSegs);
+	nxCore::mem_free(pBoxes);
+	nxCore::mem_free(pIdMem);
+	nxData::unload(pData);
+}
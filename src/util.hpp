@@ -220,3 +220,9 @@ void mtl_sh_refl_detail(const GEX_OBJ& obj, const char* pMtlName, float dtl);
 void mtl_shadow_density(const GEX_OBJ& obj, const char* pMtlName, float density);
 
 void dump_riglink_info(sxKeyframesData* pKfr, sxKeyframesData::RigLink* pLink, FILE* pOut = nullptr);
+/* ACMR/ATVR of the geometry display list in source order and with each DisplayList optimization */
+void dump_geo_cache_stats(const char* pGeoPath, FILE* pOut = nullptr, int cacheSize = 16);
+/* hit/range queries of the recursive BVH and of FlatBVH against the brute force ones (same polygon sets), Kq/s of each */
+void geo_bvh_query_bench(const char* pGeoPath, FILE* pOut = nullptr, int nqry = 10000);
+/* FlatBVH nearest hits, single and streamed, against plain hit_query results (probes and incoherent segments), Kseg/s of each */
+void geo_ray_packet_bench(const char* pGeoPath, FILE* pOut = nullptr, int nseg = 20000);